@@ -33,10 +33,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
 
 #include <rdma/fi_errno.h>
 
 #include "shared.h"
+#include "hmem.h"
 #include "benchmark_shared.h"
 
 /* when the -j option is set, user supplied inject_size must be honored,
@@ -53,6 +57,218 @@ static int inject_size_set;
  */
 static int offset_rma_start = 0;
 
+/* Latency samples of the pingpong tests are binned into a log-linear
+ * histogram, in the style of HdrHistogram: each power of two range is
+ * split into LAT_SUB_CNT linear buckets, which bounds the error of the
+ * reported percentiles to 1/LAT_SUB_CNT of the value.  Raw samples are
+ * only kept when they are written to a file with -r.
+ */
+#define LAT_SUB_BITS 4
+#define LAT_SUB_CNT (1 << LAT_SUB_BITS)
+#define LAT_BUCKETS ((64 - LAT_SUB_BITS + 1) * LAT_SUB_CNT)
+
+static struct {
+	int enabled;
+	char *dump_path;
+	int dump_cnt;
+	uint64_t begin;
+	uint64_t hist[LAT_BUCKETS];
+	uint64_t cnt;
+	uint64_t max;
+	uint64_t *samples;
+} lat;
+
+/* With -X, the message tests run for each pair of client and server
+ * memory types in the list, switching the buffers of the test between
+ * pairs.
+ */
+static const char *hmem_names[] = {
+	[FI_HMEM_SYSTEM] = "host",
+	[FI_HMEM_CUDA] = "cuda",
+	[FI_HMEM_ROCR] = "rocr",
+	[FI_HMEM_ZE] = "ze",
+	[FI_HMEM_NEURON] = "neuron",
+};
+
+static struct {
+	enum fi_hmem_iface ifaces[ARRAY_SIZE(hmem_names)];
+	int cnt;
+	uint64_t init_mask;
+} matrix;
+
+static int lat_bucket(uint64_t val)
+{
+	int shift;
+
+	if (val < LAT_SUB_CNT)
+		return (int) val;
+
+	shift = 63 - __builtin_clzll(val) - LAT_SUB_BITS;
+	return (shift + 1) * LAT_SUB_CNT + (int) ((val >> shift) - LAT_SUB_CNT);
+}
+
+/* Highest value that falls into the bucket */
+static uint64_t lat_bucket_val(int bucket)
+{
+	int shift;
+
+	if (bucket < LAT_SUB_CNT)
+		return bucket;
+
+	shift = bucket / LAT_SUB_CNT - 1;
+	return (((uint64_t) LAT_SUB_CNT + bucket % LAT_SUB_CNT) << shift) +
+	       ((1ULL << shift) - 1);
+}
+
+static int lat_init(void)
+{
+	if (!lat.enabled)
+		return 0;
+
+	memset(lat.hist, 0, sizeof(lat.hist));
+	lat.cnt = 0;
+	lat.max = 0;
+
+	if (!lat.dump_path)
+		return 0;
+
+	free(lat.samples);
+	lat.samples = calloc(opts.iterations, sizeof(*lat.samples));
+	return lat.samples ? 0 : -FI_ENOMEM;
+}
+
+static void lat_begin(void)
+{
+	if (lat.enabled)
+		lat.begin = ft_gettime_ns();
+}
+
+/* Record half of the round trip, to match usec/xfer of show_perf() */
+static void lat_end(int iter)
+{
+	uint64_t val;
+
+	if (!lat.enabled || iter < opts.warmup_iterations)
+		return;
+
+	val = (ft_gettime_ns() - lat.begin) / 2;
+	lat.hist[lat_bucket(val)]++;
+	lat.max = MAX(lat.max, val);
+	if (lat.samples)
+		lat.samples[lat.cnt] = val;
+	lat.cnt++;
+}
+
+/* Nearest rank, starting at 1, of percentile pct among cnt samples */
+static uint64_t lat_rank(uint64_t cnt, double pct)
+{
+	uint64_t rank;
+
+	rank = (uint64_t) (cnt * pct / 100.0 + 0.5);
+	return rank ? MIN(rank, cnt) : 1;
+}
+
+static int lat_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+void ft_lat_sort(uint64_t *samples, size_t cnt)
+{
+	qsort(samples, cnt, sizeof(*samples), lat_cmp);
+}
+
+/* Percentile of samples sorted by ft_lat_sort, using the same ranks as -L */
+uint64_t ft_lat_pctl(const uint64_t *samples, size_t cnt, double pct)
+{
+	return cnt ? samples[lat_rank(cnt, pct) - 1] : 0;
+}
+
+/* Start a report row with a name column and the transfer size */
+void ft_show_row_start(const char *name)
+{
+	char str[FT_STR_LEN];
+
+	printf("%-8s%-8s", name, size_str(str, opts.transfer_size));
+}
+
+static double lat_pctl(double pct)
+{
+	uint64_t target, sum = 0;
+	int i;
+
+	target = lat_rank(lat.cnt, pct);
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		sum += lat.hist[i];
+		if (sum >= target)
+			return MIN(lat_bucket_val(i), lat.max) / 1000.0;
+	}
+	return lat.max / 1000.0;
+}
+
+static int lat_dump(void)
+{
+	FILE *file;
+	uint64_t i;
+
+	file = fopen(lat.dump_path, lat.dump_cnt++ ? "a" : "w");
+	if (!file) {
+		FT_PRINTERR("fopen", -errno);
+		return -errno;
+	}
+
+	for (i = 0; i < lat.cnt; i++)
+		fprintf(file, "%zu %" PRIu64 " %" PRIu64 "\n",
+			opts.transfer_size, i, lat.samples[i]);
+	fclose(file);
+	return 0;
+}
+
+static int lat_show(void)
+{
+	if (!lat.enabled || !lat.cnt)
+		return 0;
+
+	if (opts.machr) {
+		printf("- { xfer_size: %zu, p50: %f, p90: %f, p99: %f, "
+		       "p99.9: %f, max: %f }\n", opts.transfer_size,
+		       lat_pctl(50), lat_pctl(90), lat_pctl(99),
+		       lat_pctl(99.9), lat.max / 1000.0);
+	} else {
+		printf("%-8s%-8s usec p50 %.2f p90 %.2f p99 %.2f "
+		       "p99.9 %.2f max %.2f\n", "", "", lat_pctl(50),
+		       lat_pctl(90), lat_pctl(99), lat_pctl(99.9),
+		       lat.max / 1000.0);
+	}
+
+	return lat.samples ? lat_dump() : 0;
+}
+
+static void matrix_parse(char *optarg)
+{
+	char *tok, *save;
+	int i;
+
+	matrix.cnt = 0;
+	for (tok = strtok_r(optarg, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		for (i = 0; i < ARRAY_SIZE(hmem_names); i++) {
+			if (hmem_names[i] && !strcasecmp(tok, hmem_names[i]))
+				break;
+		}
+		if (i == ARRAY_SIZE(hmem_names) ||
+		    matrix.cnt == ARRAY_SIZE(matrix.ifaces)) {
+			printf("Unsupported memory type %s\n", tok);
+			continue;
+		}
+		matrix.ifaces[matrix.cnt++] = i;
+		if (i != FI_HMEM_SYSTEM)
+			opts.options |= FT_OPT_ENABLE_HMEM;
+	}
+}
+
 void ft_parse_benchmark_opts(int op, char *optarg)
 {
 	switch (op) {
@@ -69,6 +285,16 @@ void ft_parse_benchmark_opts(int op, char *optarg)
 	case 'W':
 		opts.window_size = atoi(optarg);
 		break;
+	case 'L':
+		lat.enabled = 1;
+		break;
+	case 'r':
+		lat.enabled = 1;
+		lat.dump_path = optarg;
+		break;
+	case 'X':
+		matrix_parse(optarg);
+		break;
 	default:
 		break;
 	}
@@ -83,6 +309,196 @@ void ft_benchmark_usage(void)
 			"* The following condition is required to have at least "
 			"one window\nsize # of messsages to be sent: "
 			"# of iterations > window size");
+	FT_PRINT_OPTS_USAGE("-L", "report latency percentiles (for pingpong "
+			"tests)");
+	FT_PRINT_OPTS_USAGE("-r <file>", "write the latency of each iteration "
+			"to file, implies -L");
+	FT_PRINT_OPTS_USAGE("-X <list>", "run message tests for each pair of "
+			"client and server memory types in the list of host, "
+			"cuda, rocr, ze and neuron");
+}
+
+static int bench_sizes(int (*test)(void))
+{
+	int i, ret;
+
+	if (opts.options & FT_OPT_SIZE) {
+		init_test(&opts, test_name, sizeof(test_name));
+		return test();
+	}
+
+	for (i = 0; i < TEST_CNT; i++) {
+		if (!ft_use_size(i, opts.sizes_enabled))
+			continue;
+		opts.transfer_size = test_size[i].size;
+		init_test(&opts, test_name, sizeof(test_name));
+		ret = test();
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+/* The receive kept posted by the common code points into the buffer.
+ * Its sequence number, which is also its tag, is reused by the receive
+ * posted into the new buffer.
+ */
+static int matrix_cancel_rx(void)
+{
+	struct fi_cq_err_entry comp = {0};
+	int ret;
+
+	ret = fi_cancel(&ep->fid, &rx_ctx);
+	if (ret) {
+		FT_PRINTERR("fi_cancel", ret);
+		return ret;
+	}
+
+	do {
+		ret = fi_cq_read(rxcq, &comp, 1);
+	} while (ret == -FI_EAGAIN);
+
+	if (ret == -FI_EAVAIL) {
+		ret = fi_cq_readerr(rxcq, &comp, 0);
+		if (ret < 0) {
+			FT_PRINTERR("fi_cq_readerr", ret);
+			return ret;
+		}
+		if (comp.err != FI_ECANCELED) {
+			FT_ERR("unexpected receive error %d\n", comp.err);
+			return -comp.err;
+		}
+	} else if (ret < 0) {
+		FT_PRINTERR("fi_cq_read", ret);
+		return ret;
+	} else {
+		FT_ERR("receive completed while being canceled\n");
+		return -FI_EOTHER;
+	}
+
+	rx_seq--;
+	return 0;
+}
+
+static int matrix_realloc(enum fi_hmem_iface iface)
+{
+	int ret;
+
+	ret = matrix_cancel_rx();
+	if (ret)
+		return ret;
+
+	free(tx_ctx_arr);
+	free(rx_ctx_arr);
+	tx_ctx_arr = NULL;
+	rx_ctx_arr = NULL;
+	if (mr != &no_mr)
+		FT_CLOSE_FID(mr);
+	if (dev_host_buf)
+		ft_free_host_tx_buf();
+	ret = ft_hmem_free(opts.iface, buf);
+	if (ret)
+		FT_PRINTERR("ft_hmem_free", ret);
+	buf = rx_buf = tx_buf = NULL;
+
+	if (!(matrix.init_mask & (1ULL << iface))) {
+		ret = ft_hmem_init(iface);
+		if (ret) {
+			FT_PRINTERR("ft_hmem_init", ret);
+			return ret;
+		}
+		matrix.init_mask |= 1ULL << iface;
+	}
+
+	opts.iface = iface;
+	if (iface == FI_HMEM_SYSTEM)
+		opts.options &= ~FT_OPT_USE_DEVICE;
+	else
+		opts.options |= FT_OPT_USE_DEVICE;
+
+	ret = ft_alloc_msgs();
+	if (ret)
+		return ret;
+
+	return ft_post_rx(ep, MAX(rx_size, FT_MAX_CTRL_MSG), &rx_ctx);
+}
+
+/* The server switches its buffers first, then lets the client switch.
+ * Each side only sends once the other side waits for the message, so no
+ * message can arrive while the receive is being moved.
+ */
+static int matrix_set_iface(enum fi_hmem_iface iface)
+{
+	int ret;
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	if (opts.dst_addr) {
+		ret = ft_rx(ep, 1);
+		if (ret)
+			return ret;
+
+		if (iface != opts.iface) {
+			ret = matrix_realloc(iface);
+			if (ret)
+				return ret;
+		}
+
+		return ft_tx(ep, remote_fi_addr, 1, &tx_ctx);
+	}
+
+	if (iface != opts.iface) {
+		ret = matrix_realloc(iface);
+		if (ret)
+			return ret;
+	}
+
+	ret = ft_tx(ep, remote_fi_addr, 1, &tx_ctx);
+	if (ret)
+		return ret;
+
+	return ft_rx(ep, 1);
+}
+
+static int matrix_run(int (*test)(void))
+{
+	enum fi_hmem_iface local;
+	int i, j, ret = 0;
+
+	if (!rxcq || fi->ep_attr->type == FI_EP_DGRAM ||
+	    ft_check_opts(FT_OPT_ALLOC_MULT_MR)) {
+		FT_ERR("-X needs reliable endpoints with an rx CQ\n");
+		return -FI_EINVAL;
+	}
+
+	matrix.init_mask |= 1ULL << opts.iface;
+	for (i = 0; i < matrix.cnt && !ret; i++) {
+		for (j = 0; j < matrix.cnt && !ret; j++) {
+			local = opts.dst_addr ? matrix.ifaces[i] :
+				matrix.ifaces[j];
+			ret = matrix_set_iface(local);
+			if (ret)
+				break;
+
+			printf("# client %s, server %s\n",
+			       hmem_names[matrix.ifaces[i]],
+			       hmem_names[matrix.ifaces[j]]);
+			ret = bench_sizes(test);
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(hmem_names); i++) {
+		if (i != opts.iface && (matrix.init_mask & (1ULL << i)))
+			ft_hmem_cleanup(i);
+	}
+	return ret;
+}
+
+int ft_benchmark_run(int (*test)(void))
+{
+	return matrix.cnt ? matrix_run(test) : bench_sizes(test);
 }
 
 int pingpong(void)
@@ -99,10 +515,15 @@ int pingpong(void)
 	if (ret)
 		return ret;
 
+	ret = lat_init();
+	if (ret)
+		return ret;
+
 	if (opts.dst_addr) {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			lat_begin();
 
 			if (opts.transfer_size <= inject_size)
 				ret = ft_inject(ep, remote_fi_addr, opts.transfer_size);
@@ -114,11 +535,14 @@ int pingpong(void)
 			ret = ft_rx(ep, opts.transfer_size);
 			if (ret)
 				return ret;
+
+			lat_end(i);
 		}
 	} else {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			lat_begin();
 
 			ret = ft_rx(ep, opts.transfer_size);
 			if (ret)
@@ -130,6 +554,8 @@ int pingpong(void)
 				ret = ft_tx(ep, remote_fi_addr, opts.transfer_size, &tx_ctx);
 			if (ret)
 				return ret;
+
+			lat_end(i);
 		}
 	}
 	ft_stop();
@@ -140,7 +566,7 @@ int pingpong(void)
 	else
 		show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end, 2);
 
-	return 0;
+	return lat_show();
 }
 
 int pingpong_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
@@ -162,6 +588,10 @@ int pingpong_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 	if (ret)
 		return ret;
 
+	ret = lat_init();
+	if (ret)
+		return ret;
+
 	if (opts.transfer_size == 0) {
 		FT_ERR("Zero-sized transfers not supported");
 		return EXIT_FAILURE;
@@ -176,6 +606,7 @@ int pingpong_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 
 			if (i == opts.warmup_iterations)
 				ft_start();
+			lat_begin();
 
 			if (rma_op == FT_RMA_WRITE)
 				*(tx_buf + opts.transfer_size - 1) = (char)i;
@@ -193,11 +624,14 @@ int pingpong_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 			ret = ft_rx_rma(i, rma_op, ep, opts.transfer_size);
 			if (ret)
 				return ret;
+
+			lat_end(i);
 		}
 	} else {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			lat_begin();
 
 			ret = ft_rx_rma(i, rma_op, ep, opts.transfer_size);
 			if (ret)
@@ -215,6 +649,8 @@ int pingpong_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 						opts.transfer_size, &tx_ctx);
 			if (ret)
 				return ret;
+
+			lat_end(i);
 		}
 	}
 	ft_stop();
@@ -225,7 +661,7 @@ int pingpong_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 	else
 		show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end, 2);
 
-	return 0;
+	return lat_show();
 }
 
 static int bw_tx_comp()
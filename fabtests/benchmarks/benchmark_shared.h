@@ -40,16 +40,21 @@ extern "C" {
 
 #include <rdma/fi_rma.h>
 
-#define BENCHMARK_OPTS "vkj:W:"
+#define BENCHMARK_OPTS "vkj:W:Lr:X:"
 #define FT_BENCHMARK_MAX_MSG_SIZE (test_size[TEST_CNT - 1].size)
 
 void ft_parse_benchmark_opts(int op, char *optarg);
 void ft_benchmark_usage(void);
+int ft_benchmark_run(int (*test)(void));
 int pingpong(void);
 int bandwidth(void);
 int pingpong_rma(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote);
 int bandwidth_rma(enum ft_rma_opcodes op, struct fi_rma_iov *remote);
 
+void ft_lat_sort(uint64_t *samples, size_t cnt);
+uint64_t ft_lat_pctl(const uint64_t *samples, size_t cnt, double pct);
+void ft_show_row_start(const char *name);
+
 #ifdef __cplusplus
 }
 #endif
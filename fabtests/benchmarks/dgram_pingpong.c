@@ -44,7 +44,7 @@
 
 static int run(void)
 {
-	int i, ret;
+	int ret;
 
 	ret = ft_init_fabric();
 	if (ret)
@@ -58,22 +58,9 @@ static int run(void)
 	if (ret)
 		return ret;
 
-	if (!(opts.options & FT_OPT_SIZE)) {
-		for (i = 0; i < TEST_CNT; i++) {
-			if (!ft_use_size(i, opts.sizes_enabled))
-				continue;
-			opts.transfer_size = test_size[i].size;
-			init_test(&opts, test_name, sizeof(test_name));
-			ret = pingpong();
-			if (ret)
-				return ret;
-		}
-	} else {
-		init_test(&opts, test_name, sizeof(test_name));
-		ret = pingpong();
-		if (ret)
-			return ret;
-	}
+	ret = ft_benchmark_run(pingpong);
+	if (ret)
+		return ret;
 
 	return ft_finalize();
 }
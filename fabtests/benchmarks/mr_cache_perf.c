@@ -0,0 +1,564 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <sys/mman.h>
+
+#include <rdma/fi_cm.h>
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+#include "benchmark_shared.h"
+
+/*
+ * Registration cost test.  Buffers are carved out of an mmap'ed region
+ * following one of several reuse patterns, and are either registered and
+ * closed with fi_mr_reg()/fi_close(), or sent to the local endpoint so
+ * that the provider registers them internally.  Registration caches are
+ * not visible to applications, so a registration is counted as a hit
+ * when it is at least MR_HIT_SPEEDUP times faster than the registration
+ * of a buffer never seen before.  Run with FI_LOG_LEVEL=info for the
+ * exact counters of ofi_mr_cache at domain close.
+ */
+#define MR_HIT_SPEEDUP		5
+#define MR_COLD_SAMPLES		64
+#define MR_REGION_SIZE		(64 * 1024 * 1024)
+
+enum mr_pattern {
+	MR_SLIDE,
+	MR_RANDOM,
+	MR_CHURN,
+	MR_PATTERN_CNT,
+};
+
+static const char *mr_pattern_str[] = {
+	[MR_SLIDE] = "slide",
+	[MR_RANDOM] = "random",
+	[MR_CHURN] = "churn",
+};
+
+struct mr_result {
+	uint64_t *reg_ns;
+	uint64_t dereg_ns;
+	uint64_t unmap_ns;
+	size_t unmap_cnt;
+};
+
+static char *region;
+static size_t region_size = MR_REGION_SIZE;
+static size_t page_size;
+static uint64_t mr_key = FT_MR_KEY + 1;
+static uint64_t cold_ns;
+static uint64_t unmap_ns;
+static int churn_interval = 1;
+static bool use_send;
+static fi_addr_t self_addr;
+static char *rx_region;
+static size_t rx_region_size;
+static struct fid_mr *rx_mr;
+
+enum {
+	LONG_OPT_PATTERN = 1,
+	LONG_OPT_CHURN,
+	LONG_OPT_SEND,
+};
+
+static int mr_map(char **buf, size_t size)
+{
+	*buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (*buf == MAP_FAILED) {
+		*buf = NULL;
+		FT_PRINTERR("mmap", -errno);
+		return -errno;
+	}
+
+	/* Fault the pages in, which is not part of the registration cost */
+	memset(*buf, 0, size);
+	return 0;
+}
+
+static int mr_reg(void *buf, size_t len, struct fid_mr **mr, uint64_t *ns)
+{
+	uint64_t start;
+	int ret;
+
+	start = ft_gettime_ns();
+	ret = fi_mr_reg(domain, buf, len, ft_info_to_mr_access(fi), 0,
+			mr_key++, 0, mr, NULL);
+	*ns = ft_gettime_ns() - start;
+	if (ret) {
+		FT_PRINTERR("fi_mr_reg", ret);
+		return ret;
+	}
+
+	if (fi->domain_attr->mr_mode & FI_MR_ENDPOINT) {
+		ret = fi_mr_bind(*mr, &ep->fid, 0);
+		if (!ret)
+			ret = fi_mr_enable(*mr);
+		if (ret)
+			FT_CLOSE_FID(*mr);
+	}
+	return ret;
+}
+
+/*
+ * Registrations of fresh mappings cannot hit in a cache, and give the
+ * reference cost that hits are compared against.  The cost of unmapping
+ * memory that was never registered is the baseline of the invalidation
+ * overhead.
+ */
+static int mr_calibrate(void)
+{
+	uint64_t samples[MR_COLD_SAMPLES], start, total = 0;
+	struct fid_mr *mr;
+	char *buf;
+	int i, ret;
+
+	for (i = 0; i < MR_COLD_SAMPLES; i++) {
+		ret = mr_map(&buf, opts.transfer_size);
+		if (ret)
+			return ret;
+
+		ret = mr_reg(buf, opts.transfer_size, &mr, &samples[i]);
+		if (ret) {
+			munmap(buf, opts.transfer_size);
+			return ret;
+		}
+		FT_CLOSE_FID(mr);
+		munmap(buf, opts.transfer_size);
+
+		ret = mr_map(&buf, opts.transfer_size);
+		if (ret)
+			return ret;
+
+		start = ft_gettime_ns();
+		munmap(buf, opts.transfer_size);
+		total += ft_gettime_ns() - start;
+	}
+
+	ft_lat_sort(samples, MR_COLD_SAMPLES);
+	cold_ns = ft_lat_pctl(samples, MR_COLD_SAMPLES, 50);
+	unmap_ns = total / MR_COLD_SAMPLES;
+	return 0;
+}
+
+static void mr_next(enum mr_pattern pattern, int iter, size_t *off,
+		    size_t *len)
+{
+	size_t max_off = region_size - opts.transfer_size;
+
+	switch (pattern) {
+	case MR_SLIDE:
+		/* Each buffer overlaps three quarters of the previous one */
+		*len = opts.transfer_size;
+		*off = ((size_t) iter * MAX(opts.transfer_size / 4, 1)) %
+		       (max_off + 1);
+		break;
+	case MR_RANDOM:
+		*len = 1 + rand() % opts.transfer_size;
+		*off = rand() % (region_size - *len + 1);
+		break;
+	default:
+		*len = opts.transfer_size;
+		*off = 0;
+		break;
+	}
+}
+
+/*
+ * Unmapping the buffer lets the memory monitor invalidate its entries.
+ * The pages are mapped again at the same address, as an allocator would
+ * reuse them, so stale entries would be found by the next registration.
+ */
+static int mr_churn(struct mr_result *res)
+{
+	size_t len = ft_get_aligned_size(opts.transfer_size, page_size);
+	uint64_t start;
+	void *buf;
+
+	start = ft_gettime_ns();
+	munmap(region, len);
+	res->unmap_ns += ft_gettime_ns() - start;
+	res->unmap_cnt++;
+
+	buf = mmap(region, len, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+	if (buf == MAP_FAILED) {
+		FT_PRINTERR("mmap", -errno);
+		return -errno;
+	}
+	memset(buf, 0, len);
+	return 0;
+}
+
+static int mr_send(void *buf, size_t len, uint64_t *ns)
+{
+	struct fid_mr *mr = NULL;
+	void *desc = NULL;
+	uint64_t start;
+	int ret;
+
+	start = ft_gettime_ns();
+	if (fi->domain_attr->mr_mode & FI_MR_LOCAL) {
+		ret = mr_reg(buf, len, &mr, ns);
+		if (ret)
+			return ret;
+		desc = fi_mr_desc(mr);
+	}
+
+	ret = ft_post_rx_buf(ep, len, &rx_ctx, rx_region,
+			     fi_mr_desc(rx_mr), 0);
+	if (ret)
+		goto out;
+
+	ret = ft_post_tx_buf(ep, self_addr, len, NO_CQ_DATA, &tx_ctx, buf,
+			     desc, 0);
+	if (ret)
+		goto out;
+
+	ret = ft_get_tx_comp(tx_seq);
+	if (!ret)
+		ret = ft_get_rx_comp(rx_seq);
+out:
+	FT_CLOSE_FID(mr);
+	*ns = ft_gettime_ns() - start;
+	return ret;
+}
+
+static int mr_run(enum mr_pattern pattern, struct mr_result *res)
+{
+	struct fid_mr *mr;
+	uint64_t start, ns;
+	size_t off, len;
+	int i, ret;
+
+	memset(res->reg_ns, 0, sizeof(*res->reg_ns) * opts.iterations);
+	res->dereg_ns = 0;
+	res->unmap_ns = 0;
+	res->unmap_cnt = 0;
+
+	for (i = -opts.warmup_iterations; i < opts.iterations; i++) {
+		if (pattern == MR_CHURN && i > -opts.warmup_iterations &&
+		    !(i % churn_interval)) {
+			ret = mr_churn(res);
+			if (ret)
+				return ret;
+		}
+
+		mr_next(pattern, i + opts.warmup_iterations, &off, &len);
+		if (use_send) {
+			ret = mr_send(region + off, len, &ns);
+		} else {
+			ret = mr_reg(region + off, len, &mr, &ns);
+			if (ret)
+				return ret;
+
+			start = ft_gettime_ns();
+			FT_CLOSE_FID(mr);
+			if (i >= 0)
+				res->dereg_ns += ft_gettime_ns() - start;
+		}
+		if (ret)
+			return ret;
+
+		if (i >= 0)
+			res->reg_ns[i] = ns;
+	}
+	return 0;
+}
+
+static void mr_show(enum mr_pattern pattern, struct mr_result *res)
+{
+	static int header = 1;
+	char str[FT_STR_LEN];
+	size_t i, hits = 0;
+
+	if (header) {
+		printf("cold registration %.2f usec, unmap %.2f usec\n",
+		       cold_ns / 1000.0, unmap_ns / 1000.0);
+		printf("%-8s%-8s%-8s%8s%12s%12s%12s%12s\n", "pattern",
+		       "bytes", "iters", "hit%", "p50 usec", "p99 usec",
+		       "close usec", "unmap usec");
+		header = 0;
+	}
+
+	ft_lat_sort(res->reg_ns, opts.iterations);
+	for (i = 0; i < opts.iterations; i++) {
+		if (res->reg_ns[i] * MR_HIT_SPEEDUP <= cold_ns)
+			hits++;
+	}
+
+	ft_show_row_start(mr_pattern_str[pattern]);
+	printf("%-8s", cnt_str(str, opts.iterations));
+	if (use_send)
+		printf("%8s", "-");
+	else
+		printf("%8.1f", 100.0 * hits / opts.iterations);
+	printf("%12.2f%12.2f",
+	       ft_lat_pctl(res->reg_ns, opts.iterations, 50) / 1000.0,
+	       ft_lat_pctl(res->reg_ns, opts.iterations, 99) / 1000.0);
+	if (use_send)
+		printf("%12s", "-");
+	else
+		printf("%12.2f", res->dereg_ns / 1000.0 / opts.iterations);
+	printf("%12.2f\n", res->unmap_cnt ?
+	       res->unmap_ns / 1000.0 / res->unmap_cnt : 0.0);
+}
+
+/*
+ * The endpoint is needed to bind registrations with FI_MR_ENDPOINT, and
+ * is the target of the transfers, so no peer is needed.
+ */
+static int mr_init_ep(void)
+{
+	char name[FT_MAX_CTRL_MSG];
+	size_t len = sizeof(name);
+	uint64_t ns;
+	int ret;
+
+	ret = ft_alloc_active_res(fi);
+	if (ret)
+		return ret;
+
+	ret = ft_enable_ep(ep, eq, av, txcq, rxcq, NULL, NULL, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_getname(&ep->fid, name, &len);
+	if (ret) {
+		FT_PRINTERR("fi_getname", ret);
+		return ret;
+	}
+
+	ret = ft_av_insert(av, name, 1, &self_addr, 0, NULL);
+	if (ret)
+		return ret;
+
+	if (!use_send)
+		return 0;
+
+	rx_region_size = ft_get_aligned_size(MAX(opts.transfer_size,
+					  FT_MAX_CTRL_MSG) +
+				      ft_rx_prefix_size(), page_size);
+	ret = mr_map(&rx_region, rx_region_size);
+	if (ret)
+		return ret;
+
+	return mr_reg(rx_region, rx_region_size, &rx_mr, &ns);
+}
+
+static int run(bool *patterns)
+{
+	struct mr_result res;
+	int i, ret;
+
+	ret = ft_init();
+	if (ret)
+		return ret;
+
+	ret = ft_getinfo(hints, &fi);
+	if (ret)
+		return ret;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	ret = mr_init_ep();
+	if (ret)
+		goto out;
+
+	res.reg_ns = calloc(opts.iterations, sizeof(*res.reg_ns));
+	if (!res.reg_ns) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	ret = mr_calibrate();
+	if (ret)
+		goto free;
+
+	ret = mr_map(&region, region_size);
+	if (ret)
+		goto free;
+
+	for (i = 0; i < MR_PATTERN_CNT; i++) {
+		if (!patterns[i])
+			continue;
+
+		ret = mr_run(i, &res);
+		if (ret)
+			break;
+		mr_show(i, &res);
+	}
+
+	munmap(region, region_size);
+free:
+	free(res.reg_ns);
+out:
+	FT_CLOSE_FID(rx_mr);
+	if (rx_region)
+		munmap(rx_region, rx_region_size);
+	return ret;
+}
+
+static int mr_parse_patterns(char *str, bool *patterns)
+{
+	char *tok, *save;
+	int i;
+
+	memset(patterns, 0, sizeof(*patterns) * MR_PATTERN_CNT);
+	for (tok = strtok_r(str, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		for (i = 0; i < MR_PATTERN_CNT; i++) {
+			if (!strcasecmp(tok, mr_pattern_str[i]))
+				break;
+		}
+		if (i == MR_PATTERN_CNT)
+			return -FI_EINVAL;
+		patterns[i] = true;
+	}
+	return 0;
+}
+
+static void mr_usage(char *name)
+{
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "  %s [OPTIONS]\n", name);
+	fprintf(stderr, "\nMemory registration cost test with buffer reuse "
+		"patterns.\n");
+	fprintf(stderr, "\nOptions:\n");
+	FT_PRINT_OPTS_USAGE("-f <fabric>", "fabric name");
+	FT_PRINT_OPTS_USAGE("-d <domain>", "domain name");
+	FT_PRINT_OPTS_USAGE("-p <provider>", "specific provider name eg "
+			    "sockets, verbs");
+	FT_PRINT_OPTS_USAGE("-s <address>", "source address, --send needs "
+			    "an address the endpoint can send to");
+	FT_PRINT_OPTS_USAGE("-I <int>", "registrations per pattern "
+			    "(def 10000)");
+	FT_PRINT_OPTS_USAGE("-S <size>", "buffer size, the upper bound for "
+			    "the random pattern (def 64k)");
+	FT_PRINT_OPTS_USAGE("-w <int>", "warm-up registrations (def 10)");
+	FT_PRINT_OPTS_USAGE("-R <size>", "size of the region the buffers "
+			    "are taken from (def 64m)");
+	FT_PRINT_OPTS_USAGE("--pattern <list>", "slide, random and/or churn "
+			    "(def all)");
+	FT_PRINT_OPTS_USAGE("--churn <int>", "registrations between unmaps "
+			    "of the region in the churn pattern (def 1)");
+	FT_PRINT_OPTS_USAGE("--send", "send the buffers to the local "
+			    "endpoint rather than registering them");
+	FT_PRINT_OPTS_USAGE("-h", "display this help output");
+}
+
+int main(int argc, char **argv)
+{
+	bool patterns[MR_PATTERN_CNT] = {true, true, true};
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.transfer_size = 64 * 1024;
+	opts.iterations = 10000;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	int lopt_idx = 0;
+	struct option long_opts[] = {
+		{"pattern", required_argument, NULL, LONG_OPT_PATTERN},
+		{"churn", required_argument, NULL, LONG_OPT_CHURN},
+		{"send", no_argument, NULL, LONG_OPT_SEND},
+		{0, 0, 0, 0}
+	};
+
+	while ((op = getopt_long(argc, argv, FAB_OPTS "I:S:w:R:s:h",
+				 long_opts, &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case 'I':
+			opts.iterations = atoi(optarg);
+			break;
+		case 'S':
+			opts.transfer_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			opts.warmup_iterations = atoi(optarg);
+			break;
+		case 's':
+			opts.src_addr = optarg;
+			break;
+		case 'R':
+			region_size = strtoul(optarg, NULL, 0);
+			break;
+		case LONG_OPT_PATTERN:
+			if (mr_parse_patterns(optarg, patterns))
+				goto usage;
+			break;
+		case LONG_OPT_CHURN:
+			churn_interval = atoi(optarg);
+			break;
+		case LONG_OPT_SEND:
+			use_send = true;
+			break;
+		case '?':
+		case 'h':
+			goto usage;
+		}
+	}
+
+	page_size = sysconf(_SC_PAGESIZE);
+	region_size = ft_get_aligned_size(region_size, page_size);
+	if (opts.iterations < 1 || churn_interval < 1 ||
+	    !opts.transfer_size || opts.transfer_size > region_size)
+		goto usage;
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG;
+	hints->mode |= FI_CONTEXT | FI_CONTEXT2;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->addr_format = opts.address_format;
+
+	ret = run(patterns);
+
+	ft_free_res();
+	return ft_exit_code(ret);
+
+usage:
+	mr_usage(argv[0]);
+	return EXIT_FAILURE;
+}
@@ -38,7 +38,7 @@
 
 static int run(void)
 {
-	int i, ret;
+	int ret;
 
 	if (!opts.dst_addr) {
 		ret = ft_start_server();
@@ -51,22 +51,9 @@ static int run(void)
 		return ret;
 	}
 
-	if (!(opts.options & FT_OPT_SIZE)) {
-		for (i = 0; i < TEST_CNT; i++) {
-			if (!ft_use_size(i, opts.sizes_enabled))
-				continue;
-			opts.transfer_size = test_size[i].size;
-			init_test(&opts, test_name, sizeof(test_name));
-			ret = bandwidth();
-			if (ret)
-				goto out;
-		}
-	} else {
-		init_test(&opts, test_name, sizeof(test_name));
-		ret = bandwidth();
-		if (ret)
-			goto out;
-	}
+	ret = ft_benchmark_run(bandwidth);
+	if (ret)
+		goto out;
 
 	ft_finalize();
 out:
@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <limits.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_tagged.h>
+
+#include "shared.h"
+#include "hmem.h"
+
+/*
+ * Measures the cost of tag matching with deep receive queues.  In the
+ * posted test, the server keeps a number of receives posted that never
+ * match ahead of the ones being measured.  In the unexpected test, the
+ * client first sends messages that the server never receives, and the
+ * measured receives are posted after their messages arrived.  A share
+ * of the measured receives may be posted with a wildcard tag.
+ *
+ * Tags are split in two classes above the sequence tags of ft_tx() and
+ * ft_rx(): targets, which are measured, and fillers, which make up the
+ * queues.
+ */
+#define MATCH_TARGET		(1ULL << 30)
+#define MATCH_FILLER		(2ULL << 30)
+#define MATCH_SEQ_MASK		(MATCH_TARGET - 1)
+#define MATCH_MAX_STEPS		16
+
+enum match_test {
+	MATCH_POSTED,
+	MATCH_UNEXPECTED,
+};
+
+struct match_steps {
+	int cnt;
+	int val[MATCH_MAX_STEPS];
+};
+
+static struct match_steps posted = {3, {0, 64, 1024}};
+/* Some providers stop reading from a peer with too many unexpected
+ * messages, e.g. tcp beyond FI_TCP_MAX_SAVED (64), so the default stays
+ * below that with the window included.
+ */
+static struct match_steps unexp = {3, {0, 16, 32}};
+static struct match_steps wildcard = {2, {0, 100}};
+
+static struct fi_context2 *match_ctx;
+static char *match_buf;
+static struct fid_mr *match_mr;
+static void *match_desc;
+
+enum {
+	LONG_OPT_POSTED = 1,
+	LONG_OPT_UNEXPECTED,
+	LONG_OPT_WILDCARD,
+};
+
+static int match_parse_steps(char *str, struct match_steps *steps, int max)
+{
+	char *tok, *save;
+
+	steps->cnt = 0;
+	for (tok = strtok_r(str, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		if (steps->cnt == MATCH_MAX_STEPS)
+			return -FI_E2BIG;
+		steps->val[steps->cnt] = atoi(tok);
+		if (steps->val[steps->cnt] < 0 ||
+		    steps->val[steps->cnt] > max)
+			return -FI_EINVAL;
+		steps->cnt++;
+	}
+	return steps->cnt ? 0 : -FI_EINVAL;
+}
+
+static int match_max(struct match_steps *steps)
+{
+	int i, max = 0;
+
+	for (i = 0; i < steps->cnt; i++)
+		max = MAX(max, steps->val[i]);
+	return max;
+}
+
+static void match_free_res(void)
+{
+	FT_CLOSE_FID(match_mr);
+	if (match_buf)
+		ft_hmem_free(opts.iface, match_buf);
+	free(match_ctx);
+}
+
+static int match_alloc_res(void)
+{
+	size_t cnt;
+	int ret;
+
+	cnt = MAX(match_max(&posted), match_max(&unexp)) + opts.window_size;
+	match_ctx = calloc(cnt, sizeof(*match_ctx));
+	if (!match_ctx)
+		return -FI_ENOMEM;
+
+	/* The contents are never checked, so all transfers share a buffer */
+	ret = ft_hmem_alloc(opts.iface, opts.device, (void **) &match_buf,
+			    MAX(opts.transfer_size, 1));
+	if (ret)
+		return ret;
+
+	return ft_reg_mr(fi, match_buf, MAX(opts.transfer_size, 1),
+			 ft_info_to_mr_access(fi), FT_MR_KEY + 1, opts.iface,
+			 opts.device, &match_mr, &match_desc);
+}
+
+static int match_reap(struct fid_cq *cq, int cnt)
+{
+	struct fi_cq_tagged_entry comp[16];
+	ssize_t ret;
+
+	while (cnt > 0) {
+		ret = fi_cq_read(cq, comp, MIN(cnt, 16));
+		if (ret > 0) {
+			cnt -= (int) ret;
+		} else if (ret == -FI_EAVAIL) {
+			return ft_cq_readerr(cq);
+		} else if (ret != -FI_EAGAIN) {
+			FT_PRINTERR("fi_cq_read", ret);
+			return (int) ret;
+		}
+	}
+	return 0;
+}
+
+static int match_recv(uint64_t tag, uint64_t ignore, struct fi_context2 *ctx)
+{
+	ssize_t ret;
+
+	do {
+		ret = fi_trecv(ep, match_buf, opts.transfer_size, match_desc,
+			       remote_fi_addr, tag, ignore, ctx);
+		if (ret == -FI_EAGAIN)
+			(void) fi_cq_read(rxcq, NULL, 0);
+	} while (ret == -FI_EAGAIN);
+
+	if (ret)
+		FT_PRINTERR("fi_trecv", ret);
+	return (int) ret;
+}
+
+static int match_send(uint64_t tag, struct fi_context2 *ctx)
+{
+	ssize_t ret;
+
+	do {
+		ret = fi_tsend(ep, match_buf, opts.transfer_size, match_desc,
+			       remote_fi_addr, tag, ctx);
+		if (ret == -FI_EAGAIN)
+			(void) fi_cq_read(txcq, NULL, 0);
+	} while (ret == -FI_EAGAIN);
+
+	if (ret)
+		FT_PRINTERR("fi_tsend", ret);
+	return (int) ret;
+}
+
+/*
+ * Fully specified receives are posted first.  A message then only
+ * reaches a wildcard receive if no receive was posted for its tag.
+ */
+static int match_post_targets(int wild_pct)
+{
+	int i, wild, ret;
+
+	wild = opts.window_size * wild_pct / 100;
+	for (i = 0; i < opts.window_size; i++) {
+		if (i < opts.window_size - wild)
+			ret = match_recv(MATCH_TARGET | i, 0, &match_ctx[i]);
+		else
+			ret = match_recv(MATCH_TARGET, MATCH_SEQ_MASK,
+					 &match_ctx[i]);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int match_send_range(uint64_t tag, int cnt)
+{
+	int i, ret;
+
+	for (i = 0; i < cnt; i++) {
+		ret = match_send(tag | i, &match_ctx[i]);
+		if (ret)
+			return ret;
+	}
+	return match_reap(txcq, cnt);
+}
+
+static int match_recv_range(uint64_t tag, int cnt)
+{
+	int i, ret;
+
+	for (i = 0; i < cnt; i++) {
+		ret = match_recv(tag | i, 0, &match_ctx[i]);
+		if (ret)
+			return ret;
+	}
+	return match_reap(rxcq, cnt);
+}
+
+/*
+ * The fillers stay queued for the whole run, and are only consumed once
+ * the measurement is done.  The server signals with ft_tx() when the
+ * client may send the next window, so the CQs only ever hold the
+ * completions that are waited for.
+ */
+static int match_server(enum match_test test, int depth, int wild_pct,
+			uint64_t *elapsed)
+{
+	struct fi_context2 *filler_ctx = &match_ctx[opts.window_size];
+	uint64_t start;
+	int i, j, ret;
+
+	for (j = 0; test == MATCH_POSTED && j < depth; j++) {
+		ret = match_recv(MATCH_FILLER | j, 0, &filler_ctx[j]);
+		if (ret)
+			return ret;
+	}
+
+	*elapsed = 0;
+	for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
+		if (test == MATCH_POSTED) {
+			ret = match_post_targets(wild_pct);
+			if (ret)
+				return ret;
+
+			ret = (int) ft_tx(ep, remote_fi_addr, 1, &tx_ctx);
+			if (ret)
+				return ret;
+
+			start = ft_gettime_ns();
+		} else {
+			/* Messages are ordered, so the targets are queued */
+			ret = (int) ft_rx(ep, 1);
+			if (ret)
+				return ret;
+
+			start = ft_gettime_ns();
+			ret = match_post_targets(wild_pct);
+			if (ret)
+				return ret;
+		}
+
+		ret = match_reap(rxcq, opts.window_size);
+		if (ret)
+			return ret;
+
+		if (i >= opts.warmup_iterations)
+			*elapsed += ft_gettime_ns() - start;
+
+		if (test == MATCH_UNEXPECTED) {
+			ret = (int) ft_tx(ep, remote_fi_addr, 1, &tx_ctx);
+			if (ret)
+				return ret;
+		}
+	}
+
+	if (test == MATCH_POSTED) {
+		ret = (int) ft_tx(ep, remote_fi_addr, 1, &tx_ctx);
+		return ret ? ret : match_reap(rxcq, depth);
+	}
+	return match_recv_range(MATCH_FILLER, depth);
+}
+
+static int match_client(enum match_test test, int depth)
+{
+	int i, ret;
+
+	if (test == MATCH_UNEXPECTED) {
+		ret = match_send_range(MATCH_FILLER, depth);
+		if (ret)
+			return ret;
+	}
+
+	for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
+		if (test == MATCH_POSTED) {
+			ret = (int) ft_rx(ep, 1);
+			if (ret)
+				return ret;
+		}
+
+		ret = match_send_range(MATCH_TARGET, opts.window_size);
+		if (ret)
+			return ret;
+
+		if (test == MATCH_UNEXPECTED) {
+			ret = (int) ft_tx(ep, remote_fi_addr, 1, &tx_ctx);
+			if (ret)
+				return ret;
+
+			ret = (int) ft_rx(ep, 1);
+			if (ret)
+				return ret;
+		}
+	}
+
+	if (test == MATCH_POSTED) {
+		ret = (int) ft_rx(ep, 1);
+		return ret ? ret : match_send_range(MATCH_FILLER, depth);
+	}
+	return 0;
+}
+
+static void match_show(enum match_test test, int depth, int wild_pct,
+		       uint64_t elapsed)
+{
+	static int header = 1;
+	char str[FT_STR_LEN];
+	long long msgs = (long long) opts.iterations * opts.window_size;
+
+	if (header) {
+		printf("%-12s%-8s%-8s%-8s%-8s%12s\n", "queue", "depth",
+		       "wild%", "bytes", "msgs", "usec/msg");
+		header = 0;
+	}
+
+	printf("%-12s%-8d%-8d", test == MATCH_POSTED ? "posted" :
+	       "unexpected", depth, wild_pct);
+	printf("%-8s", size_str(str, opts.transfer_size));
+	printf("%-8s", cnt_str(str, msgs));
+	printf("%12.3f\n", elapsed / 1000.0 / msgs);
+}
+
+static int match_run(enum match_test test, struct match_steps *depths)
+{
+	uint64_t elapsed;
+	int i, j, ret;
+
+	for (i = 0; i < depths->cnt; i++) {
+		for (j = 0; j < wildcard.cnt; j++) {
+			ret = ft_sync();
+			if (ret)
+				return ret;
+
+			if (opts.dst_addr) {
+				ret = match_client(test, depths->val[i]);
+			} else {
+				ret = match_server(test, depths->val[i],
+						   wildcard.val[j], &elapsed);
+				if (!ret)
+					match_show(test, depths->val[i],
+						   wildcard.val[j], elapsed);
+			}
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+static int run(void)
+{
+	int ret;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	/* One more receive is posted by ft_rx() */
+	if (match_max(&posted) + opts.window_size + 1 > fi->rx_attr->size) {
+		FT_ERR("posted depth exceeds the receive queue size of %zu",
+		       fi->rx_attr->size);
+		return -FI_EINVAL;
+	}
+
+	ret = match_alloc_res();
+	if (ret)
+		goto out;
+
+	ret = match_run(MATCH_POSTED, &posted);
+	if (ret)
+		goto out;
+
+	ret = match_run(MATCH_UNEXPECTED, &unexp);
+	if (ret)
+		goto out;
+
+	ft_finalize();
+out:
+	match_free_res();
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.transfer_size = 8;
+	opts.iterations = 100;
+	opts.window_size = 16;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	int lopt_idx = 0;
+	struct option long_opts[] = {
+		{"posted", required_argument, NULL, LONG_OPT_POSTED},
+		{"unexpected", required_argument, NULL, LONG_OPT_UNEXPECTED},
+		{"wildcard", required_argument, NULL, LONG_OPT_WILDCARD},
+		{0, 0, 0, 0}
+	};
+
+	while ((op = getopt_long(argc, argv, "W:h" CS_OPTS INFO_OPTS,
+				 long_opts, &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'W':
+			opts.window_size = atoi(optarg);
+			break;
+		case LONG_OPT_POSTED:
+			if (match_parse_steps(optarg, &posted, INT_MAX))
+				goto usage;
+			break;
+		case LONG_OPT_UNEXPECTED:
+			if (match_parse_steps(optarg, &unexp, INT_MAX))
+				goto usage;
+			break;
+		case LONG_OPT_WILDCARD:
+			if (match_parse_steps(optarg, &wildcard, 100))
+				goto usage;
+			break;
+		case '?':
+		case 'h':
+			goto usage;
+		}
+	}
+
+	if (opts.window_size < 1 || opts.window_size > MATCH_SEQ_MASK)
+		goto usage;
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_TAGGED;
+	hints->mode |= FI_CONTEXT | FI_CONTEXT2;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->domain_attr->resource_mgmt = FI_RM_ENABLED;
+	hints->tx_attr->msg_order = FI_ORDER_SAS;
+	hints->rx_attr->msg_order = FI_ORDER_SAS;
+	hints->rx_attr->size = match_max(&posted) + opts.window_size + 1;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	ft_free_res();
+	return ft_exit_code(ret);
+
+usage:
+	ft_csusage(argv[0], "Tag matching test with deep posted and "
+		   "unexpected queues, for RDM endpoints.");
+	FT_PRINT_OPTS_USAGE("-W <int>", "receives measured per iteration "
+			    "(def 16)");
+	FT_PRINT_OPTS_USAGE("--posted <list>", "posted queue depths to "
+			    "sweep (def 0,64,1024)");
+	FT_PRINT_OPTS_USAGE("--unexpected <list>", "unexpected queue "
+			    "depths to sweep (def 0,16,32)");
+	FT_PRINT_OPTS_USAGE("--wildcard <list>", "percentages of wildcard "
+			    "receives to sweep (def 0,100)");
+	return EXIT_FAILURE;
+}
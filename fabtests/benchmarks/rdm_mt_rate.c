@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_tagged.h>
+
+#include "shared.h"
+#include "hmem.h"
+#include "benchmark_shared.h"
+
+/* Threads sharing an endpoint only match the messages of their peer */
+#define MT_TAG_BASE	(1ULL << 30)
+#define MT_CQ_BATCH	16
+
+struct mt_ctx {
+	struct fi_context2 context;
+	uint64_t post_ns;
+	uint64_t done_ns;
+};
+
+struct mt_thread {
+	pthread_t thread;
+	int idx;
+	struct fid_ep *ep;
+	struct fid_cq *txcq;
+	struct fid_cq *rxcq;
+	fi_addr_t addr;
+	uint64_t tag;
+	char *buf;
+	struct mt_ctx *ctx;
+	uint64_t *lat;
+	size_t lat_cnt;
+	uint64_t start_ns;
+	uint64_t end_ns;
+	int ret;
+};
+
+static struct mt_thread *threads;
+static struct mt_ctx *mt_ctxs;
+static uint64_t *mt_lat;
+static char *mt_buf;
+static struct fid_mr *mt_mr;
+static void *mt_desc;
+static int num_threads = 1;
+static bool shared_ep = false;
+static volatile int mt_abort;
+
+enum {
+	LONG_OPT_SHARED_EP = 1,
+};
+
+static void mt_free_res(void)
+{
+	int i, cnt;
+
+	FT_CLOSE_FID(mt_mr);
+	cnt = shared_ep ? 1 : num_threads;
+	for (i = 0; threads && i < cnt; i++) {
+		FT_CLOSE_FID(threads[i].ep);
+		FT_CLOSE_FID(threads[i].txcq);
+		FT_CLOSE_FID(threads[i].rxcq);
+	}
+
+	if (mt_buf)
+		ft_hmem_free(opts.iface, mt_buf);
+	free(mt_lat);
+	free(mt_ctxs);
+	free(threads);
+}
+
+static int mt_alloc_res(void)
+{
+	size_t buf_size;
+	int i, ret;
+
+	buf_size = MAX(opts.transfer_size, 1);
+	threads = calloc(num_threads, sizeof(*threads));
+	mt_ctxs = calloc(num_threads * opts.window_size, sizeof(*mt_ctxs));
+	mt_lat = calloc(num_threads * opts.iterations, sizeof(*mt_lat));
+	if (!threads || !mt_ctxs || !mt_lat)
+		return -FI_ENOMEM;
+
+	ret = ft_hmem_alloc(opts.iface, opts.device, (void **) &mt_buf,
+			    num_threads * buf_size);
+	if (ret)
+		return ret;
+
+	ret = ft_reg_mr(fi, mt_buf, num_threads * buf_size,
+			ft_info_to_mr_access(fi), FT_MR_KEY + 1, opts.iface,
+			opts.device, &mt_mr, &mt_desc);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num_threads; i++) {
+		threads[i].idx = i;
+		threads[i].tag = MT_TAG_BASE + i;
+		threads[i].buf = mt_buf + buf_size * i;
+		threads[i].ctx = &mt_ctxs[opts.window_size * i];
+		threads[i].lat = &mt_lat[opts.iterations * i];
+	}
+	return 0;
+}
+
+/*
+ * Give the thread an endpoint of its own, with separate CQs, and resolve
+ * the address of the peer thread's endpoint through the main endpoint.
+ */
+static int mt_setup_ep(struct mt_thread *t)
+{
+	struct fi_info *info;
+	int ret;
+
+	/* Query without a service so that the endpoint gets its own port */
+	ret = fi_getinfo(FT_FIVERSION, opts.src_addr, NULL, 0, hints, &info);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		return ret;
+	}
+
+	ret = fi_endpoint(domain, info, &t->ep, NULL);
+	fi_freeinfo(info);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	ret = ft_alloc_ep_res(fi, &t->txcq, &t->rxcq, NULL, NULL, NULL, &av);
+	if (ret)
+		return ret;
+
+	ret = ft_enable_ep(t->ep, eq, av, t->txcq, t->rxcq, NULL, NULL, NULL);
+	if (ret)
+		return ret;
+
+	return ft_init_av_addr(av, t->ep, &t->addr);
+}
+
+/*
+ * The shared endpoint is separate from the main one, so that threads
+ * never reap the completions of ft_sync().
+ */
+static void mt_share_ep(struct mt_thread *t, struct mt_thread *owner)
+{
+	t->ep = owner->ep;
+	t->txcq = owner->txcq;
+	t->rxcq = owner->rxcq;
+	t->addr = owner->addr;
+}
+
+/*
+ * With a shared endpoint a thread may reap the completions of another
+ * thread, so completions are only stamped into the context of the
+ * request.  Each thread then checks its own contexts.
+ */
+static int mt_poll(struct mt_thread *t)
+{
+	struct fi_cq_tagged_entry comp[MT_CQ_BATCH];
+	struct fid_cq *cq = opts.dst_addr ? t->txcq : t->rxcq;
+	struct mt_ctx *ctx;
+	uint64_t now;
+	ssize_t ret;
+	int i;
+
+	if (mt_abort)
+		return -FI_ECANCELED;
+
+	ret = fi_cq_read(cq, comp, MT_CQ_BATCH);
+	if (ret == -FI_EAGAIN)
+		return 0;
+
+	if (ret == -FI_EAVAIL)
+		return ft_cq_readerr(cq);
+
+	if (ret < 0) {
+		FT_PRINTERR("fi_cq_read", ret);
+		return (int) ret;
+	}
+
+	now = ft_gettime_ns();
+	for (i = 0; i < ret; i++) {
+		ctx = comp[i].op_context;
+		__atomic_store_n(&ctx->done_ns, now, __ATOMIC_RELEASE);
+	}
+	return 0;
+}
+
+static int mt_post(struct mt_thread *t, struct mt_ctx *ctx)
+{
+	ssize_t ret;
+
+	ctx->done_ns = 0;
+	ctx->post_ns = ft_gettime_ns();
+	for (;;) {
+		if (opts.dst_addr)
+			ret = fi_tsend(t->ep, t->buf, opts.transfer_size,
+				       mt_desc, t->addr, t->tag, &ctx->context);
+		else
+			ret = fi_trecv(t->ep, t->buf, opts.transfer_size,
+				       mt_desc, t->addr, t->tag, 0,
+				       &ctx->context);
+		if (ret != -FI_EAGAIN)
+			break;
+
+		ret = mt_poll(t);
+		if (ret)
+			return (int) ret;
+	}
+
+	if (ret)
+		FT_PRINTERR(opts.dst_addr ? "fi_tsend" : "fi_trecv", ret);
+	return (int) ret;
+}
+
+static int mt_wait(struct mt_thread *t, size_t cnt)
+{
+	size_t i;
+	int ret;
+
+	for (i = 0; i < cnt; i++) {
+		while (!__atomic_load_n(&t->ctx[i].done_ns, __ATOMIC_ACQUIRE)) {
+			ret = mt_poll(t);
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+/*
+ * The client sends and the server receives windows of messages.  The
+ * latency of a message is the time from posting it to reaping its
+ * completion.
+ */
+static int mt_transfer(struct mt_thread *t, size_t iters, bool record)
+{
+	size_t i, j, cnt;
+	int ret;
+
+	if (record)
+		t->start_ns = ft_gettime_ns();
+
+	for (i = 0; i < iters; i += cnt) {
+		cnt = MIN(iters - i, opts.window_size);
+		for (j = 0; j < cnt; j++) {
+			ret = mt_post(t, &t->ctx[j]);
+			if (ret)
+				return ret;
+		}
+
+		ret = mt_wait(t, cnt);
+		if (ret)
+			return ret;
+
+		for (j = 0; record && j < cnt; j++) {
+			t->lat[t->lat_cnt++] = t->ctx[j].done_ns -
+					       t->ctx[j].post_ns;
+		}
+	}
+
+	if (record)
+		t->end_ns = ft_gettime_ns();
+	return 0;
+}
+
+static void *mt_run(void *arg)
+{
+	struct mt_thread *t = arg;
+
+	t->ret = mt_transfer(t, opts.warmup_iterations, false);
+	if (!t->ret)
+		t->ret = mt_transfer(t, opts.iterations, true);
+	if (t->ret)
+		mt_abort = 1;
+	return NULL;
+}
+
+static void mt_show_row(const char *name, size_t cnt, uint64_t elapsed_ns,
+			uint64_t *lat)
+{
+	char str[FT_STR_LEN];
+
+	ft_lat_sort(lat, cnt);
+	ft_show_row_start(name);
+	printf("%-10s", cnt_str(str, cnt));
+	printf("%8.2fs%12.3f%12.2f%12.2f\n", elapsed_ns / 1000000000.0,
+	       elapsed_ns ? cnt * 1000.0 / elapsed_ns : 0,
+	       ft_lat_pctl(lat, cnt, 50) / 1000.0,
+	       ft_lat_pctl(lat, cnt, 99) / 1000.0);
+}
+
+static void mt_show_perf(void)
+{
+	uint64_t start = UINT64_MAX, end = 0;
+	char name[FT_STR_LEN];
+	size_t total = 0;
+	int i;
+
+	printf("%-8s%-8s%-10s%9s%12s%12s%12s\n", "thread", "bytes", "msgs",
+	       "time", "Mmsgs/sec", "p50 usec", "p99 usec");
+	for (i = 0; i < num_threads; i++) {
+		snprintf(name, sizeof(name), "%d", i);
+		mt_show_row(name, threads[i].lat_cnt,
+			    threads[i].end_ns - threads[i].start_ns,
+			    threads[i].lat);
+		start = MIN(start, threads[i].start_ns);
+		end = MAX(end, threads[i].end_ns);
+		total += threads[i].lat_cnt;
+	}
+
+	/* The per-thread samples are contiguous, so sort them all at once */
+	mt_show_row("total", total, end - start, mt_lat);
+}
+
+static int run(void)
+{
+	int i, ret;
+
+	opts.av_size = num_threads + 1;
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	ret = mt_alloc_res();
+	if (ret)
+		goto out;
+
+	for (i = 0; i < num_threads; i++) {
+		if (shared_ep && i) {
+			mt_share_ep(&threads[i], &threads[0]);
+		} else {
+			ret = mt_setup_ep(&threads[i]);
+			if (ret)
+				goto out;
+		}
+	}
+
+	ret = ft_sync();
+	if (ret)
+		goto out;
+
+	for (i = 0; i < num_threads; i++) {
+		ret = pthread_create(&threads[i].thread, NULL, mt_run,
+				     &threads[i]);
+		if (ret) {
+			FT_PRINTERR("pthread_create", ret);
+			mt_abort = 1;
+			break;
+		}
+	}
+
+	while (i--) {
+		pthread_join(threads[i].thread, NULL);
+		if (!ret)
+			ret = threads[i].ret;
+	}
+	if (ret)
+		goto out;
+
+	ret = ft_sync();
+	if (ret)
+		goto out;
+
+	mt_show_perf();
+	ft_finalize();
+out:
+	mt_free_res();
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.transfer_size = 8;
+	opts.iterations = 10000;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	int lopt_idx = 0;
+	struct option long_opts[] = {
+		{"shared-ep", no_argument, NULL, LONG_OPT_SHARED_EP},
+		{0, 0, 0, 0}
+	};
+
+	while ((op = getopt_long(argc, argv, "T:W:Uh" CS_OPTS INFO_OPTS,
+				 long_opts, &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			break;
+		case 'T':
+			num_threads = atoi(optarg);
+			break;
+		case 'W':
+			opts.window_size = atoi(optarg);
+			break;
+		case 'U':
+			hints->tx_attr->op_flags |= FI_DELIVERY_COMPLETE;
+			break;
+		case LONG_OPT_SHARED_EP:
+			shared_ep = true;
+			break;
+		case '?':
+		case 'h':
+			ft_csusage(argv[0], "Multi-threaded message rate test "
+				   "for RDM endpoints using tagged messages.");
+			FT_PRINT_OPTS_USAGE("-T <int>",
+				"number of threads, the peer must use the "
+				"same count (def 1)");
+			FT_PRINT_OPTS_USAGE("-W <int>",
+				"messages in flight per thread (def 64)");
+			FT_PRINT_OPTS_USAGE("-U", "use FI_DELIVERY_COMPLETE");
+			FT_PRINT_OPTS_USAGE("--shared-ep",
+				"Share one FI_THREAD_SAFE endpoint among "
+				"threads. \nBy default each thread has its "
+				"own endpoint and CQs");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (num_threads < 1 || opts.window_size < 1) {
+		FT_ERR("thread count and window size must be positive");
+		return EXIT_FAILURE;
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->domain_attr->resource_mgmt = FI_RM_ENABLED;
+	hints->caps = FI_TAGGED;
+	hints->mode |= FI_CONTEXT | FI_CONTEXT2;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->domain_attr->threading = shared_ep ?
+				FI_THREAD_SAFE : FI_THREAD_ENDPOINT;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	ft_free_res();
+	return ft_exit_code(ret);
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <rdma/fi_errno.h>
+
+#include "shared.h"
+
+/*
+ * Communication/computation overlap test.  The client posts a transfer,
+ * computes without calling into libfabric, and then waits for the
+ * transfer to complete.  Transfers that only progress from within
+ * libfabric calls are serialized with the computation, while providers
+ * that progress them in the background hide them behind it.  The
+ * overlap is the share of the transfer time that was hidden:
+ *
+ *   overlap = (comm + compute - total) / comm
+ *
+ * where comm is the time of the transfer alone.  The computation lasts
+ * as long as the transfer alone, unless set with --compute.
+ */
+#define OVERLAP_MIN_SIZE	(64 * 1024)
+
+static long compute_ns;
+static bool use_rma;
+
+enum {
+	LONG_OPT_COMPUTE = 1,
+	LONG_OPT_PROGRESS,
+};
+
+/* Stands for application work: no libfabric call is made */
+static void overlap_compute(uint64_t ns)
+{
+	uint64_t end = ft_gettime_ns() + ns;
+
+	while (ft_gettime_ns() < end)
+		;
+}
+
+static int overlap_post(void)
+{
+	if (use_rma)
+		return ft_post_rma(opts.rma_op, opts.rma_op == FT_RMA_READ ?
+				   rx_buf : tx_buf, opts.transfer_size,
+				   &remote, &tx_ctx);
+
+	return ft_post_tx(ep, remote_fi_addr, opts.transfer_size, NO_CQ_DATA,
+			  &tx_ctx);
+}
+
+/*
+ * Time the transfers of the client, with compute_ns of computation
+ * between posting each transfer and waiting for it.  The server only
+ * receives the messages.
+ */
+static int overlap_run(uint64_t ns, uint64_t *total, uint64_t *wait)
+{
+	uint64_t start, wait_start;
+	int i, ret;
+
+	ret = ft_sync();
+	if (ret)
+		return ret;
+
+	*total = *wait = 0;
+	for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
+		if (!opts.dst_addr) {
+			if (use_rma)
+				continue;
+
+			ret = ft_rx(ep, opts.transfer_size);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		start = ft_gettime_ns();
+		ret = overlap_post();
+		if (ret)
+			return ret;
+
+		overlap_compute(ns);
+
+		wait_start = ft_gettime_ns();
+		ret = ft_get_tx_comp(tx_seq);
+		if (ret)
+			return ret;
+
+		if (i >= opts.warmup_iterations) {
+			*wait += ft_gettime_ns() - wait_start;
+			*total += ft_gettime_ns() - start;
+		}
+	}
+
+	*total /= opts.iterations;
+	*wait /= opts.iterations;
+	return 0;
+}
+
+static int overlap_test(void)
+{
+	uint64_t comm, total, wait, ns;
+	double overlap;
+	char str[FT_STR_LEN];
+	int ret;
+
+	ret = overlap_run(0, &comm, &wait);
+	if (ret)
+		return ret;
+
+	ns = compute_ns ? compute_ns : comm;
+	ret = overlap_run(ns, &total, &wait);
+	if (ret)
+		return ret;
+
+	if (!opts.dst_addr)
+		return 0;
+
+	overlap = comm ? 100.0 * ((double) comm + ns - total) / comm : 0;
+	overlap = MIN(MAX(overlap, 0), 100);
+
+	printf("%-10s", size_str(str, opts.transfer_size));
+	printf("%-8s", cnt_str(str, opts.iterations));
+	printf("%14.2f%14.2f%14.2f%14.2f%12.1f\n", comm / 1000.0,
+	       ns / 1000.0, total / 1000.0, wait / 1000.0, overlap);
+	return 0;
+}
+
+static int run(void)
+{
+	int i, ret;
+
+	ret = ft_init_fabric();
+	if (ret)
+		return ret;
+
+	if (use_rma) {
+		ret = ft_exchange_keys(&remote);
+		if (ret)
+			return ret;
+	}
+
+	if (opts.dst_addr) {
+		printf("%s, data progress %s\n", use_rma ? "rma" : "msg",
+		       fi_tostr(&fi->domain_attr->data_progress,
+				FI_TYPE_PROGRESS));
+		printf("%-10s%-8s%14s%14s%14s%14s%12s\n", "bytes", "iters",
+		       "comm usec", "compute usec", "total usec",
+		       "wait usec", "overlap%");
+	}
+
+	if (opts.options & FT_OPT_SIZE)
+		return overlap_test();
+
+	for (i = 0; i < TEST_CNT; i++) {
+		if (!ft_use_size(i, opts.sizes_enabled) ||
+		    test_size[i].size < OVERLAP_MIN_SIZE)
+			continue;
+		opts.transfer_size = test_size[i].size;
+		ret = overlap_test();
+		if (ret)
+			return ret;
+	}
+
+	return ft_finalize();
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret;
+
+	opts = INIT_OPTS;
+	opts.iterations = 100;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	int lopt_idx = 0;
+	struct option long_opts[] = {
+		{"compute", required_argument, NULL, LONG_OPT_COMPUTE},
+		{"progress", required_argument, NULL, LONG_OPT_PROGRESS},
+		{0, 0, 0, 0}
+	};
+
+	while ((op = getopt_long(argc, argv, "h" CS_OPTS INFO_OPTS API_OPTS,
+				 long_opts, &lopt_idx)) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			ft_parsecsopts(op, optarg, &opts);
+			ret = ft_parse_api_opts(op, optarg, hints, &opts);
+			if (ret)
+				return ret;
+			break;
+		case LONG_OPT_COMPUTE:
+			compute_ns = atol(optarg) * 1000;
+			break;
+		case LONG_OPT_PROGRESS:
+			if (!strcasecmp(optarg, "auto")) {
+				hints->domain_attr->data_progress =
+					FI_PROGRESS_AUTO;
+			} else if (!strcasecmp(optarg, "manual")) {
+				hints->domain_attr->data_progress =
+					FI_PROGRESS_MANUAL;
+			} else {
+				goto usage;
+			}
+			break;
+		case '?':
+		case 'h':
+			goto usage;
+		}
+	}
+
+	if (optind < argc)
+		opts.dst_addr = argv[optind];
+
+	use_rma = hints->caps & (FI_READ | FI_WRITE);
+	if (use_rma && opts.rma_op == FT_RMA_WRITEDATA) {
+		fprintf(stderr, "writedata is not supported\n");
+		goto usage;
+	}
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps |= use_rma ? FI_MSG | FI_RMA : FI_MSG;
+	hints->mode |= FI_CONTEXT | FI_CONTEXT2;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+	hints->domain_attr->threading = FI_THREAD_DOMAIN;
+	hints->tx_attr->tclass = FI_TC_BULK_DATA;
+	hints->addr_format = opts.address_format;
+
+	ret = run();
+
+	ft_free_res();
+	return ft_exit_code(ret);
+
+usage:
+	ft_csusage(argv[0], "Communication and computation overlap test.");
+	FT_PRINT_OPTS_USAGE("-o <op>", "read|write, to overlap RMA rather "
+			    "than messages");
+	FT_PRINT_OPTS_USAGE("--compute <usec>", "computation between "
+			    "posting and waiting (def: time of the transfer)");
+	FT_PRINT_OPTS_USAGE("--progress <model>", "request auto or manual "
+			    "data progress");
+	return EXIT_FAILURE;
+}
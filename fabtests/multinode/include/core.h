@@ -75,6 +75,7 @@ struct pm_job_info {
 	void		*names;
 	size_t		name_len;
 	fi_addr_t	*fi_addrs;
+	size_t		av_scale_count;
 	enum multi_xfer transfer_method;
 	enum multi_pattern pattern;
 };
@@ -42,6 +42,18 @@ struct multi_timer {
 	int rank;
 };
 
+/* Per-rank duration of the startup phases, in ns */
+struct multi_startup {
+	long getinfo;
+	long open;
+	long av_insert;
+	long av_scale;
+	long first_msg;
+	long warm_msg;
+};
+
+extern struct multi_startup startup;
+
 void multi_timer_init(struct multi_timer *timer, int rank);
 void multi_timer_start(struct multi_timer *timer);
 void multi_timer_stop(struct multi_timer *timer);
@@ -50,3 +62,4 @@ int multi_timer_gather(struct multi_timer *all_timer,
 		       struct multi_timer *timers, int timer_count);
 int multi_timer_iter_gather(struct multi_timer *gather_timers,
 				struct multi_timer *timers, int iteration);
+int multi_startup_analyze(struct multi_startup *timer);
@@ -79,12 +79,112 @@ struct multi_xfer_method multi_xfer_methods[] = {
 	}
 };
 
+/*
+ * Generate count distinct addresses from the local one by varying the
+ * port and the low bits of the IP address.  The addresses are never
+ * used for communication, so they do not need to be reachable.
+ */
+static int multi_gen_addrs(void *name, size_t len, void *addrs, size_t count)
+{
+	struct sockaddr_in *sin;
+	struct sockaddr_in6 *sin6;
+	uint32_t *low;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		memcpy((char *) addrs + i * len, name, len);
+		switch (((struct sockaddr *) name)->sa_family) {
+		case AF_INET:
+			sin = (struct sockaddr_in *) ((char *) addrs + i * len);
+			sin->sin_port = htons(1024 + i % 64512);
+			sin->sin_addr.s_addr = htonl(ntohl(sin->sin_addr.s_addr) +
+						     i / 64512);
+			break;
+		case AF_INET6:
+			sin6 = (struct sockaddr_in6 *) ((char *) addrs + i * len);
+			sin6->sin6_port = htons(1024 + i % 64512);
+			low = (uint32_t *) &sin6->sin6_addr.s6_addr[12];
+			*low = htonl(ntohl(*low) + i / 64512);
+			break;
+		default:
+			return -FI_ENOSYS;
+		}
+	}
+	return 0;
+}
+
+/* Time inserting a large number of addresses, as a job at scale would */
+static int multi_av_scale(void *name, size_t len)
+{
+	struct fi_av_attr attr = {0};
+	struct fid_av *scale_av;
+	fi_addr_t *fi_addrs;
+	size_t i, cnt;
+	void *addrs;
+	long start;
+	int ret;
+
+	switch (fi->addr_format) {
+	case FI_SOCKADDR:
+	case FI_SOCKADDR_IN:
+	case FI_SOCKADDR_IN6:
+		break;
+	default:
+		printf("Warn: AV insert scaling needs a sockaddr address "
+		       "format, skipping\n");
+		pm_job.av_scale_count = 0;
+		return 0;
+	}
+
+	addrs = malloc(len * pm_job.av_scale_count);
+	fi_addrs = calloc(pm_job.av_scale_count, sizeof(*fi_addrs));
+	if (!addrs || !fi_addrs) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	ret = multi_gen_addrs(name, len, addrs, pm_job.av_scale_count);
+	if (ret) {
+		FT_PRINTERR("multi_gen_addrs", ret);
+		goto out;
+	}
+
+	attr.type = fi->domain_attr->av_type;
+	attr.count = pm_job.av_scale_count;
+	ret = fi_av_open(domain, &attr, &scale_av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		goto out;
+	}
+
+	start = ft_gettime_ns();
+	for (i = 0; i < pm_job.av_scale_count; i += cnt) {
+		cnt = MIN(pm_job.av_scale_count - i, 1024);
+		ret = fi_av_insert(scale_av, (char *) addrs + i * len, cnt,
+				   &fi_addrs[i], 0, NULL);
+		if (ret != cnt) {
+			FT_ERR("unable to insert all addresses into AV table\n");
+			ret = -FI_EOTHER;
+			break;
+		}
+		ret = 0;
+	}
+	startup.av_scale = ft_gettime_ns() - start;
+
+	FT_CLOSE_FID(scale_av);
+out:
+	free(fi_addrs);
+	free(addrs);
+	return ret;
+}
+
 static int multi_setup_fabric(int argc, char **argv)
 {
 	char my_name[FT_MAX_CTRL_MSG];
 	size_t len;
 	int i, ret;
 	struct fi_rma_iov remote;
+	long start;
 
 	hints->ep_attr->type = FI_EP_RDM;
 	hints->mode = FI_CONTEXT;
@@ -116,10 +216,13 @@ static int multi_setup_fabric(int argc, char **argv)
 	if (pm_job.my_rank != 0)
 		pm_barrier();
 
+	start = ft_gettime_ns();
 	ret = ft_getinfo(hints, &fi);
 	if (ret)
 		return ret;
+	startup.getinfo = ft_gettime_ns() - start;
 
+	start = ft_gettime_ns();
 	ret = ft_open_fabric_res();
 	if (ret)
 		return ret;
@@ -132,6 +235,7 @@ static int multi_setup_fabric(int argc, char **argv)
 	ret = ft_enable_ep(ep, eq, av, txcq, rxcq, txcntr, rxcntr, rma_cntr);
 	if (ret)
 		return ret;
+	startup.open = ft_gettime_ns() - start;
 
 	ret = ft_alloc_msgs();
 	if (ret)
@@ -168,6 +272,7 @@ static int multi_setup_fabric(int argc, char **argv)
 		goto err;
 	}
 
+	start = ft_gettime_ns();
 	for (i = 0; i < pm_job.num_ranks; i++) {
 		ret = fi_av_insert(av, (char *)pm_job.names + i * pm_job.name_len,
 				   1, &pm_job.fi_addrs[i], 0, NULL);
@@ -177,6 +282,13 @@ static int multi_setup_fabric(int argc, char **argv)
 			goto err;
 		}
 	}
+	startup.av_insert = ft_gettime_ns() - start;
+
+	if (ft_check_opts(FT_OPT_PERF) && pm_job.av_scale_count) {
+		ret = multi_av_scale(my_name, len);
+		if (ret)
+			goto err;
+	}
 
 	pm_job.multi_iovs = malloc(sizeof(*(pm_job.multi_iovs)) * pm_job.num_ranks);
 	if (!pm_job.multi_iovs) {
@@ -477,6 +589,41 @@ static int multi_run_test(void)
 	return 0;
 }
 
+/*
+ * Time the first full mesh exchange, which includes connection setup on
+ * connection-based providers, and a second one for reference.
+ */
+static int multi_run_startup(void)
+{
+	struct pattern_ops *cur_pattern = pattern;
+	int iterations = opts.iterations;
+	long start;
+	int ret;
+
+	pattern = &patterns[PATTERN_MESH];
+	opts.iterations = 1;
+
+	pm_barrier();
+	start = ft_gettime_ns();
+	ret = multi_run_test();
+	if (ret)
+		goto out;
+	startup.first_msg = ft_gettime_ns() - start;
+
+	pm_barrier();
+	start = ft_gettime_ns();
+	ret = multi_run_test();
+	if (ret)
+		goto out;
+	startup.warm_msg = ft_gettime_ns() - start;
+
+	ret = multi_startup_analyze(&startup);
+out:
+	pattern = cur_pattern;
+	opts.iterations = iterations;
+	return ret;
+}
+
 static void pm_job_free_res(void)
 {
 	free(timers);
@@ -496,9 +643,14 @@ int multinode_run_tests(int argc, char **argv)
 	if (ret)
 		return ret;
 
-	if (ft_check_opts(FT_OPT_PERF))
+	if (ft_check_opts(FT_OPT_PERF)) {
 		timers = calloc(opts.iterations * pm_job.num_ranks, sizeof(*timers));
 
+		ret = multi_run_startup();
+		if (ret)
+			goto out;
+	}
+
 	if (pm_job.pattern != -1) {
 		printf("starting %s... ", patterns[pm_job.pattern].name);
 		pattern = &patterns[pm_job.pattern];
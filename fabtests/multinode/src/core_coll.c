@@ -135,14 +135,14 @@ static int wait_for_comp(void *ctx)
 	return err;
 }
 
-static int coll_setup_w_start_addr_stride(int start_addr, int stride)
+static int coll_setup_range(int start_addr, int end_addr, int stride)
 {
 	uint64_t done_flag;
 	int err;
 
 	av_set_attr.count = 0;
 	av_set_attr.start_addr = start_addr;
-	av_set_attr.end_addr = pm_job.num_ranks - 1;
+	av_set_attr.end_addr = end_addr;
 	av_set_attr.stride = stride;
 
 	if (!is_my_rank_participating())
@@ -167,6 +167,11 @@ static int coll_setup_w_start_addr_stride(int start_addr, int stride)
 	return wait_for_event(FI_JOIN_COMPLETE, &done_flag);
 }
 
+static int coll_setup_w_start_addr_stride(int start_addr, int stride)
+{
+	return coll_setup_range(start_addr, pm_job.num_ranks - 1, stride);
+}
+
 static int coll_setup(void)
 {
 	return coll_setup_w_start_addr_stride(0, 1);
@@ -520,6 +525,219 @@ struct coll_test tests[] = {
 	},
 };
 
+/*
+ * Performance mode, selected with -T.  Each collective is timed for every
+ * message size and for communicators of increasing size, made of the
+ * first ranks of the job.  Latency is reported OSU-style, per rank, along
+ * with the bus bandwidth, which normalizes the algorithm bandwidth by the
+ * data each rank must move for the operation, as in nccl-tests.
+ */
+#define COLL_PERF_LARGE	8192
+
+struct coll_perf_op {
+	char *name;
+	enum fi_collective_op coll_op;
+	enum fi_op op;
+	enum fi_datatype datatype;
+};
+
+static struct coll_perf_op perf_ops[] = {
+	{ "fi_barrier", FI_BARRIER, FI_NOOP, FI_VOID },
+	{ "fi_broadcast", FI_BROADCAST, FI_NOOP, FI_UINT64 },
+	{ "fi_allreduce", FI_ALLREDUCE, FI_SUM, FI_UINT64 },
+	{ "fi_allgather", FI_ALLGATHER, FI_NOOP, FI_UINT64 },
+};
+
+static uint64_t *perf_buf, *perf_result;
+
+static ssize_t coll_perf_post(struct coll_perf_op *perf, size_t count,
+			      void *ctx)
+{
+	switch (perf->coll_op) {
+	case FI_BARRIER:
+		return fi_barrier(ep, coll_addr, ctx);
+	case FI_BROADCAST:
+		return fi_broadcast(ep, perf_buf, count, NULL, coll_addr, 0,
+				    perf->datatype, 0, ctx);
+	case FI_ALLREDUCE:
+		return fi_allreduce(ep, perf_buf, count, NULL, perf_result,
+				    NULL, coll_addr, perf->datatype, perf->op,
+				    0, ctx);
+	case FI_ALLGATHER:
+		return fi_allgather(ep, perf_buf, count, NULL, perf_result,
+				    NULL, coll_addr, perf->datatype, 0, ctx);
+	default:
+		return -FI_ENOSYS;
+	}
+}
+
+/* Bus bandwidth factor of each operation, for a size of data per rank */
+static double coll_perf_bus_factor(struct coll_perf_op *perf, size_t ranks)
+{
+	switch (perf->coll_op) {
+	case FI_ALLREDUCE:
+		return 2.0 * (ranks - 1) / ranks;
+	case FI_ALLGATHER:
+		return ranks - 1;
+	default:
+		return 1.0;
+	}
+}
+
+static int coll_perf_run(struct coll_perf_op *perf, size_t size,
+			 double *lat)
+{
+	uint64_t done_flag;
+	int i, iterations;
+	long start = 0;
+	int ret;
+
+	iterations = size > COLL_PERF_LARGE ?
+		     MAX(opts.iterations / 10, 1) : opts.iterations;
+
+	coll_addr = fi_mc_addr(coll_mc);
+	for (i = -opts.warmup_iterations; i < iterations; i++) {
+		if (i == 0)
+			start = ft_gettime_ns();
+
+		ret = coll_perf_post(perf, size / sizeof(*perf_buf),
+				     &done_flag);
+		if (ret) {
+			FT_ERR("%s failed: %d (%s)\n", perf->name, ret,
+			       fi_strerror(-ret));
+			return ret;
+		}
+
+		ret = wait_for_comp(&done_flag);
+		if (ret)
+			return ret;
+	}
+
+	*lat = (ft_gettime_ns() - start) / 1000.0 / iterations;
+	return 0;
+}
+
+static int coll_perf_show(struct coll_perf_op *perf, size_t ranks,
+			  size_t size, double lat)
+{
+	double min = 0, max = 0, sum = 0, *lats;
+	size_t i;
+	int ret;
+
+	lats = calloc(pm_job.num_ranks, sizeof(*lats));
+	if (!lats)
+		return -FI_ENOMEM;
+
+	ret = pm_allgather(&lat, lats, sizeof(lat));
+	if (ret || pm_job.my_rank != 0)
+		goto out;
+
+	for (i = 0; i < ranks; i++) {
+		sum += lats[i];
+		if (!i || lats[i] < min)
+			min = lats[i];
+		if (lats[i] > max)
+			max = lats[i];
+	}
+
+	printf("%-10zu %16.2f %16.2f %16.2f", size, sum / ranks, min, max);
+	if (perf->coll_op == FI_BARRIER)
+		printf(" %16s\n", "-");
+	else
+		printf(" %16.2f\n", size * coll_perf_bus_factor(perf, ranks) /
+		       (sum / ranks) / 1000.0);
+	fflush(stdout);
+out:
+	free(lats);
+	return ret;
+}
+
+static int coll_perf_comm(struct coll_perf_op *perf, size_t ranks)
+{
+	double lat = 0;
+	size_t size;
+	int i, ret;
+
+	pm_barrier();
+	ret = coll_setup_range(0, ranks - 1, 1);
+	if (ret)
+		return ret;
+
+	if (pm_job.my_rank == 0) {
+		printf("# %s, %zu ranks\n", perf->name, ranks);
+		printf("%-10s %16s %16s %16s %16s\n", "Size",
+		       "Avg Lat(us)", "Min Lat(us)", "Max Lat(us)",
+		       "Bus BW(GB/s)");
+	}
+
+	for (i = 0; i < TEST_CNT; i++) {
+		if (perf->coll_op == FI_BARRIER) {
+			size = 0;
+		} else {
+			size = test_size[i].size;
+			if (!ft_use_size(i, opts.sizes_enabled) ||
+			    size < sizeof(*perf_buf))
+				continue;
+		}
+
+		if (is_my_rank_participating()) {
+			ret = coll_perf_run(perf, size, &lat);
+			if (ret)
+				return ret;
+		}
+
+		ret = coll_perf_show(perf, ranks, size, lat);
+		if (ret || perf->coll_op == FI_BARRIER)
+			break;
+	}
+
+	pm_barrier();
+	if (ret)
+		return ret;
+
+	return coll_teardown();
+}
+
+static int coll_perf_test(void)
+{
+	size_t max_size = 0, ranks;
+	int i, ret = 0;
+
+	for (i = 0; i < TEST_CNT; i++) {
+		if (ft_use_size(i, opts.sizes_enabled))
+			max_size = MAX(max_size, test_size[i].size);
+	}
+
+	perf_buf = calloc(1, max_size);
+	perf_result = calloc(pm_job.num_ranks, max_size);
+	if (!perf_buf || !perf_result) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(perf_ops) && !ret; i++) {
+		if (test_query(perf_ops[i].coll_op, perf_ops[i].op,
+			       perf_ops[i].datatype)) {
+			if (pm_job.my_rank == 0)
+				printf("# %s not supported, skipping\n",
+				       perf_ops[i].name);
+			continue;
+		}
+
+		for (ranks = MIN(2, pm_job.num_ranks); !ret;
+		     ranks = MIN(ranks * 2, pm_job.num_ranks)) {
+			ret = coll_perf_comm(&perf_ops[i], ranks);
+			if (ranks == pm_job.num_ranks)
+				break;
+		}
+	}
+
+out:
+	free(perf_result);
+	free(perf_buf);
+	return ret;
+}
+
 static inline void setup_hints(void)
 {
 	hints->ep_attr->type = FI_EP_RDM;
@@ -614,6 +832,11 @@ int multinode_run_tests(int argc, char **argv)
 	if (ret)
 		return ret;
 
+	if (ft_check_opts(FT_OPT_PERF)) {
+		ret = coll_perf_test();
+		goto out;
+	}
+
 	for (test = tests; test->run && !ret; test++) {
 		FT_DEBUG("Running Test: %s", test->name);
 		ret = test_query(test->coll_op, test->op, test->datatype);
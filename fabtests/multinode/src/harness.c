@@ -321,7 +321,7 @@ int main(int argc, char **argv)
 	if (!hints)
 		return EXIT_FAILURE;
 
-	while ((c = getopt(argc, argv, "n:C:z:Th" CS_OPTS INFO_OPTS)) != -1) {
+	while ((c = getopt(argc, argv, "n:C:z:A:Th" CS_OPTS INFO_OPTS)) != -1) {
 		switch (c) {
 		default:
 			ft_parse_addr_opts(c, optarg, &opts);
@@ -340,9 +340,17 @@ int main(int argc, char **argv)
 		case 'z':
 			pm_job.pattern = parse_pattern(optarg);
 			break;
+		case 'A':
+			pm_job.av_scale_count = strtoul(optarg, NULL, 0);
+			break;
 		case '?':
 		case 'h':
 			ft_usage(argv[0], "A simple multinode test");
+			FT_PRINT_OPTS_USAGE("-T", "report timings, including "
+					    "the startup phases");
+			FT_PRINT_OPTS_USAGE("-A <int>", "with -T, also time "
+					    "inserting <int> generated "
+					    "addresses into an AV");
 			return EXIT_FAILURE;
 		}
 	}
@@ -29,6 +29,7 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#include <stddef.h>
 #include <string.h>
 #include <limits.h>
 #include <shared.h>
@@ -196,3 +197,63 @@ int multi_timer_iter_gather(struct multi_timer *gather_timers,
 	free(iter_timers);
 	return ret;
 }
+
+struct multi_startup startup;
+
+static void print_startup(struct multi_startup *all, size_t offset,
+			  char *phase)
+{
+	long val, min = LONG_MAX, max = 0;
+	double sum = 0;
+	int i;
+
+	for (i = 0; i < pm_job.num_ranks; i++) {
+		val = *(long *) ((char *) &all[i] + offset);
+		sum += val;
+		if (val < min)
+			min = val;
+		if (val > max)
+			max = val;
+	}
+
+	printf("%-22s %16ld %16ld %16.3f\n", phase, min, max,
+	       sum / pm_job.num_ranks);
+}
+
+int multi_startup_analyze(struct multi_startup *timer)
+{
+	struct multi_startup *all;
+	char str[FT_STR_LEN];
+	int ret;
+
+	all = calloc(pm_job.num_ranks, sizeof(*all));
+	if (!all)
+		return -FI_ENOMEM;
+
+	ret = pm_allgather(timer, all, sizeof(*timer));
+	if (ret || pm_job.my_rank != 0)
+		goto out;
+
+	printf("%-22s %16s %16s %16s\n", "Startup", "Min (ns)", "Max (ns)",
+	       "Average (ns)");
+	print_startup(all, offsetof(struct multi_startup, getinfo),
+		      "fi_getinfo");
+	print_startup(all, offsetof(struct multi_startup, open),
+		      "open resources");
+	print_startup(all, offsetof(struct multi_startup, av_insert),
+		      "av insert ranks");
+	if (pm_job.av_scale_count) {
+		snprintf(str, sizeof(str), "av insert %zu",
+			 pm_job.av_scale_count);
+		print_startup(all, offsetof(struct multi_startup, av_scale),
+			      str);
+	}
+	print_startup(all, offsetof(struct multi_startup, first_msg),
+		      "first full_mesh");
+	print_startup(all, offsetof(struct multi_startup, warm_msg),
+		      "warm full_mesh");
+	fflush(stdout);
+out:
+	free(all);
+	return ret;
+}
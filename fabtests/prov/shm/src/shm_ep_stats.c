@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Incast benchmark for the shm provider.  For each rank count in the sweep,
+ * local processes are forked and every rank but 0 streams messages to rank
+ * 0.  The shm endpoint counters of all ranks are then summed and printed,
+ * showing which protocols were used and where the senders were held back.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_ext_shm.h>
+
+#include <shared.h>
+
+#define SHM_STATS_MAX_RANKS	64
+#define SHM_STATS_NAME_LEN	64
+#define SHM_STATS_BARRIERS	3
+
+struct shm_stats_shared {
+	pthread_barrier_t	barrier;
+	char			name[SHM_STATS_MAX_RANKS][SHM_STATS_NAME_LEN];
+	size_t			name_len[SHM_STATS_MAX_RANKS];
+	struct fi_shm_ep_stats	stats[SHM_STATS_MAX_RANKS];
+	uint64_t		elapsed_ns;
+};
+
+static const char *proto_names[FI_SHM_PROTO_MAX] = {
+	[FI_SHM_PROTO_INLINE] = "inline",
+	[FI_SHM_PROTO_INJECT] = "inject",
+	[FI_SHM_PROTO_IOV] = "iov",
+	[FI_SHM_PROTO_MMAP] = "mmap",
+	[FI_SHM_PROTO_SAR] = "sar",
+	[FI_SHM_PROTO_IPC] = "ipc",
+	[FI_SHM_PROTO_EXPORT] = "export",
+};
+
+static struct shm_stats_shared *shared;
+static int max_ranks = 8;
+static int iterations = 10000;
+static size_t msg_size = 4096;
+static int window = 64;
+
+static struct fid_fabric *st_fabric;
+static struct fid_domain *st_domain;
+static struct fid_ep *st_ep;
+static struct fid_av *st_av;
+static struct fid_cq *st_cq;
+static struct fi_info *st_info;
+
+static int st_open(void)
+{
+	struct fi_info *hints;
+	struct fi_cq_attr cq_attr = { 0 };
+	struct fi_av_attr av_attr = { 0 };
+	int ret;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return -FI_ENOMEM;
+
+	hints->caps = FI_MSG;
+	hints->mode = FI_CONTEXT;
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->fabric_attr->prov_name = strdup("shm");
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, NULL, 0, hints, &st_info);
+	fi_freeinfo(hints);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		return ret;
+	}
+
+	ret = fi_fabric(st_info->fabric_attr, &st_fabric, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_fabric", ret);
+		return ret;
+	}
+
+	ret = fi_domain(st_fabric, st_info, &st_domain, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_domain", ret);
+		return ret;
+	}
+
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	cq_attr.size = window * SHM_STATS_MAX_RANKS;
+	ret = fi_cq_open(st_domain, &cq_attr, &st_cq, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_cq_open", ret);
+		return ret;
+	}
+
+	av_attr.type = FI_AV_TABLE;
+	av_attr.count = SHM_STATS_MAX_RANKS;
+	ret = fi_av_open(st_domain, &av_attr, &st_av, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_open", ret);
+		return ret;
+	}
+
+	ret = fi_endpoint(st_domain, st_info, &st_ep, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	ret = fi_ep_bind(st_ep, &st_av->fid, 0);
+	if (ret) {
+		FT_PRINTERR("fi_ep_bind", ret);
+		return ret;
+	}
+
+	ret = fi_ep_bind(st_ep, &st_cq->fid, FI_TRANSMIT | FI_RECV);
+	if (ret) {
+		FT_PRINTERR("fi_ep_bind", ret);
+		return ret;
+	}
+
+	ret = fi_enable(st_ep);
+	if (ret)
+		FT_PRINTERR("fi_enable", ret);
+	return ret;
+}
+
+static void st_close(void)
+{
+	if (st_ep)
+		fi_close(&st_ep->fid);
+	if (st_av)
+		fi_close(&st_av->fid);
+	if (st_cq)
+		fi_close(&st_cq->fid);
+	if (st_domain)
+		fi_close(&st_domain->fid);
+	if (st_fabric)
+		fi_close(&st_fabric->fid);
+	fi_freeinfo(st_info);
+}
+
+static int st_wait(int *outstanding)
+{
+	struct fi_cq_entry comp[16];
+	struct fi_cq_err_entry err_entry = { 0 };
+	ssize_t ret;
+
+	ret = fi_cq_read(st_cq, comp, ARRAY_SIZE(comp));
+	if (ret > 0) {
+		*outstanding -= ret;
+		return (int) ret;
+	}
+	if (ret == -FI_EAVAIL) {
+		(void) fi_cq_readerr(st_cq, &err_entry, 0);
+		FT_CQ_ERR(st_cq, err_entry, NULL, 0);
+		return -err_entry.err;
+	}
+	if (ret != -FI_EAGAIN) {
+		FT_PRINTERR("fi_cq_read", ret);
+		return (int) ret;
+	}
+	return 0;
+}
+
+static int st_recv(char *buf, int ranks, struct fi_context *ctx)
+{
+	int total = (ranks - 1) * iterations, posted = 0, outstanding = 0;
+	int ret;
+
+	while (posted < total || outstanding) {
+		while (posted < total && outstanding < window) {
+			ret = fi_recv(st_ep, buf + (posted % window) * msg_size,
+				      msg_size, NULL, FI_ADDR_UNSPEC,
+				      &ctx[posted % window]);
+			if (ret == -FI_EAGAIN)
+				break;
+			if (ret) {
+				FT_PRINTERR("fi_recv", ret);
+				return ret;
+			}
+			posted++;
+			outstanding++;
+		}
+
+		ret = st_wait(&outstanding);
+		if (ret < 0)
+			return ret;
+	}
+	return 0;
+}
+
+static int st_send(char *buf, struct fi_context *ctx)
+{
+	int sent = 0, outstanding = 0, ret;
+
+	while (sent < iterations || outstanding) {
+		while (sent < iterations && outstanding < window) {
+			ret = fi_send(st_ep, buf + (sent % window) * msg_size,
+				      msg_size, NULL, 0, &ctx[sent % window]);
+			if (ret == -FI_EAGAIN)
+				break;
+			if (ret) {
+				FT_PRINTERR("fi_send", ret);
+				return ret;
+			}
+			sent++;
+			outstanding++;
+		}
+
+		ret = st_wait(&outstanding);
+		if (ret < 0)
+			return ret;
+	}
+	return 0;
+}
+
+static int st_rank(int rank, int ranks)
+{
+	struct fi_shm_ops_stats *stats_ops;
+	struct fi_context *ctx = NULL;
+	fi_addr_t addr;
+	char *buf = NULL;
+	uint64_t start;
+	int i, ret, barriers = 0;
+
+	ret = st_open();
+	if (ret)
+		goto out;
+
+	ret = fi_open_ops(&st_ep->fid, FI_SHM_STATS_OPS, 0,
+			  (void **) &stats_ops, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_open_ops", ret);
+		goto out;
+	}
+
+	buf = calloc(window, msg_size);
+	ctx = calloc(window, sizeof(*ctx));
+	if (!buf || !ctx) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	shared->name_len[rank] = SHM_STATS_NAME_LEN;
+	ret = fi_getname(&st_ep->fid, shared->name[rank],
+			 &shared->name_len[rank]);
+	if (ret) {
+		FT_PRINTERR("fi_getname", ret);
+		goto out;
+	}
+	pthread_barrier_wait(&shared->barrier);
+	barriers++;
+
+	for (i = 0; i < ranks; i++) {
+		ret = fi_av_insert(st_av, shared->name[i], 1, &addr, 0, NULL);
+		if (ret != 1) {
+			FT_PRINTERR("fi_av_insert", ret);
+			ret = -FI_EINVAL;
+			goto out;
+		}
+	}
+	(void) stats_ops->read(st_ep, &shared->stats[rank],
+			       FI_SHM_STATS_RESET);
+	pthread_barrier_wait(&shared->barrier);
+	barriers++;
+
+	start = ft_gettime_ns();
+	ret = rank ? st_send(buf, ctx) : st_recv(buf, ranks, ctx);
+	if (!rank)
+		shared->elapsed_ns = ft_gettime_ns() - start;
+
+	(void) stats_ops->read(st_ep, &shared->stats[rank], 0);
+out:
+	/* keep the endpoint open until every peer is done with it */
+	while (barriers++ < SHM_STATS_BARRIERS)
+		pthread_barrier_wait(&shared->barrier);
+	free(ctx);
+	free(buf);
+	st_close();
+	return ret;
+}
+
+static void st_report(int ranks)
+{
+	struct fi_shm_ep_stats sum = { 0 };
+	double mbps, lat;
+	int i, j;
+
+	for (i = 0; i < ranks; i++) {
+		for (j = 0; j < FI_SHM_PROTO_MAX; j++) {
+			sum.tx_cnt[j] += shared->stats[i].tx_cnt[j];
+			sum.tx_bytes[j] += shared->stats[i].tx_bytes[j];
+		}
+		sum.queue_full += shared->stats[i].queue_full;
+		sum.sar_stall += shared->stats[i].sar_stall;
+		sum.cma_bytes += shared->stats[i].cma_bytes;
+		sum.resp_cnt += shared->stats[i].resp_cnt;
+		sum.resp_ns += shared->stats[i].resp_ns;
+		sum.resp_max_ns = MAX(sum.resp_max_ns,
+				      shared->stats[i].resp_max_ns);
+	}
+
+	mbps = (double) (ranks - 1) * iterations * msg_size * 1000 /
+	       shared->elapsed_ns;
+	lat = sum.resp_cnt ? (double) sum.resp_ns / sum.resp_cnt / 1000 : 0;
+
+	printf("%-6d %-10zu %-12.2f %-12" PRIu64 " %-10" PRIu64
+	       " %-14" PRIu64 " %-10.2f %-10.2f", ranks, msg_size, mbps,
+	       sum.queue_full, sum.sar_stall, sum.cma_bytes, lat,
+	       (double) sum.resp_max_ns / 1000);
+	for (j = 0; j < FI_SHM_PROTO_MAX; j++) {
+		if (sum.tx_cnt[j])
+			printf(" %s:%" PRIu64, proto_names[j], sum.tx_cnt[j]);
+	}
+	printf("\n");
+}
+
+static int st_run(int ranks)
+{
+	pthread_barrierattr_t attr;
+	pid_t pids[SHM_STATS_MAX_RANKS];
+	int i, status, ret = 0;
+
+	memset(shared, 0, sizeof(*shared));
+	pthread_barrierattr_init(&attr);
+	pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_barrier_init(&shared->barrier, &attr, ranks);
+	pthread_barrierattr_destroy(&attr);
+
+	fflush(stdout);
+	for (i = 0; i < ranks; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			FT_PRINTERR("fork", -errno);
+			exit(EXIT_FAILURE);
+		}
+		if (!pids[i])
+			exit(ft_exit_code(st_rank(i, ranks)));
+	}
+
+	for (i = 0; i < ranks; i++) {
+		if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status))
+			ret = -FI_EOTHER;
+	}
+	pthread_barrier_destroy(&shared->barrier);
+
+	if (!ret)
+		st_report(ranks);
+	return ret;
+}
+
+static void usage(char *name)
+{
+	fprintf(stderr, "Usage: %s [OPTIONS]\n", name);
+	fprintf(stderr, "  shm endpoint counters under incast\n\n");
+	FT_PRINT_OPTS_USAGE("-n <ranks>", "largest local rank count to sweep "
+			    "(default 8)");
+	FT_PRINT_OPTS_USAGE("-I <iters>", "messages sent by each rank "
+			    "(default 10000)");
+	FT_PRINT_OPTS_USAGE("-S <size>", "message size (default 4096)");
+	FT_PRINT_OPTS_USAGE("-W <window>", "outstanding messages per rank "
+			    "(default 64)");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ranks, ret = 0;
+
+	while ((op = getopt(argc, argv, "n:I:S:W:h")) != -1) {
+		switch (op) {
+		case 'n':
+			max_ranks = atoi(optarg);
+			break;
+		case 'I':
+			iterations = atoi(optarg);
+			break;
+		case 'S':
+			msg_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'W':
+			window = atoi(optarg);
+			break;
+		case '?':
+		case 'h':
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (max_ranks < 2 || max_ranks > SHM_STATS_MAX_RANKS ||
+	    iterations < 1 || window < 1 || !msg_size) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+		      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		FT_PRINTERR("mmap", -errno);
+		return EXIT_FAILURE;
+	}
+
+	printf("%-6s %-10s %-12s %-12s %-10s %-14s %-10s %-10s %s\n",
+	       "ranks", "bytes", "MB/sec", "queue_full", "sar_stall",
+	       "cma_bytes", "resp_usec", "resp_max", "protocols");
+
+	for (ranks = 2; !ret; ranks *= 2) {
+		ranks = MIN(ranks, max_ranks);
+		ret = st_run(ranks);
+		if (ranks == max_ranks)
+			break;
+	}
+
+	munmap(shared, sizeof(*shared));
+	return ft_exit_code(ret);
+}
@@ -141,6 +141,24 @@ def has_neuron(ip):
     return num_neuron_devices(ip) > 0
 
 
+@functools.lru_cache(10)
+@retry(retry_on_exception=is_ssh_connection_error, stop_max_attempt_number=3, wait_fixed=5000)
+def hardware_name(ip):
+    """
+    name the hardware of a host for performance baselines, which is the
+    product name from DMI, e.g. the instance type on cloud instances
+    """
+    proc = run("ssh {} cat /sys/devices/virtual/dmi/id/product_name".format(ip), shell=True,
+               stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+               timeout=60, encoding="utf-8")
+
+    if has_ssh_connection_err_msg(proc.stderr):
+        raise SshConnectionError()
+
+    name = proc.stdout.strip() if proc.returncode == 0 else ""
+    return re.sub(r"[^\w.-]", "_", name) or "unknown"
+
+
 @retry(retry_on_exception=is_ssh_connection_error, stop_max_attempt_number=3, wait_fixed=5000)
 def has_hmem_support(cmdline_args, ip):
     binpath = cmdline_args.binpath or ""
@@ -317,6 +335,7 @@ class ClientServerTest:
 
         self._server_command = self._cmdline_args.populate_command(self._server_base_command, "server", self._timeout, server_additonal_environment)
         self._client_command = self._cmdline_args.populate_command(self._client_base_command, "client", self._timeout, client_additonal_environment)
+        self._client_output_file = None
 
     def prepare_base_command(self, command_type, executable,
                              iteration_type=None,
@@ -492,7 +511,8 @@ class ClientServerTest:
                 retry_on_exception=is_ssh_connection_error,
                 stop_max_delay=self._timeout * 1000,  # Convert to milliseconds
                 wait_fixed=CLIENT_RETRY_INTERVAL_MS,
-            )(self._run_client_command)(server_process, self._client_command).returncode
+            )(self._run_client_command)(server_process, self._client_command,
+                                        self._client_output_file).returncode
         except Exception as e:
             print("Client error: {}".format(e))
             # Clean up server if client is terminated unexpectedly
@@ -623,3 +643,162 @@ class MultinodeTest(ClientServerTest):
             returncode_list.append(client_process_list[i].returncode)
 
         check_returncode_list(returncode_list, strict)
+
+
+# metric name: (field of the machine readable output (-m), whether higher is better)
+PERF_METRICS = {
+    "latency": ("usec/xfer", False),
+    "bandwidth": ("MB/sec", True),
+    "message_rate": ("Mxfers/sec", True),
+}
+
+# one-sided 95% critical values of Student's t distribution, by degrees of freedom
+T_CRITICAL_95 = [(1, 6.314), (2, 2.920), (3, 2.353), (4, 2.132), (5, 2.015),
+                 (6, 1.943), (7, 1.895), (8, 1.860), (9, 1.833), (10, 1.812),
+                 (12, 1.782), (15, 1.753), (20, 1.725), (30, 1.697), (60, 1.671)]
+
+
+def parse_perf_output(output):
+    """
+    parse the machine readable output of a benchmark
+    @return: a dict from transfer size (as a string) to a dict of the fields
+    """
+    results = {}
+    for line in output.split("\n"):
+        match = re.match(r"^- \{ (.*) \}$", line.strip())
+        if not match:
+            continue
+
+        fields = {}
+        for field in match.group(1).split(", "):
+            key, value = field.split(": ")
+            fields[key] = float(value)
+
+        results[str(int(fields["xfer_size"]))] = fields
+
+    return results
+
+
+def mean_and_variance(samples):
+    mean = sum(samples) / len(samples)
+    if len(samples) < 2:
+        return mean, 0.0
+
+    return mean, sum((x - mean) ** 2 for x in samples) / (len(samples) - 1)
+
+
+def is_significant_regression(baseline, current, higher_is_better, threshold):
+    """
+    check whether the current samples of a metric are worse than the baseline
+    samples by more than threshold percent, and whether the difference is
+    significant under a one-sided Welch's t-test at the 95% level
+    @return: a tuple with the result and the relative change in percent
+    """
+    base_mean, base_var = mean_and_variance(baseline)
+    cur_mean, cur_var = mean_and_variance(current)
+    if base_mean == 0:
+        return False, 0.0
+
+    worse = base_mean - cur_mean if higher_is_better else cur_mean - base_mean
+    change = 100.0 * (cur_mean - base_mean) / base_mean
+    if worse <= 0 or 100.0 * worse / base_mean <= threshold:
+        return False, change
+
+    base_se = base_var / len(baseline)
+    cur_se = cur_var / len(current)
+    if base_se + cur_se == 0:
+        return True, change
+
+    t = worse / (base_se + cur_se) ** 0.5
+    dof = (base_se + cur_se) ** 2 / (
+        (base_se ** 2 / (len(baseline) - 1) if len(baseline) > 1 else 0) +
+        (cur_se ** 2 / (len(current) - 1) if len(current) > 1 else 0))
+
+    critical = T_CRITICAL_95[0][1]
+    for table_dof, value in T_CRITICAL_95:
+        if table_dof <= dof:
+            critical = value
+
+    return t > critical, change
+
+
+class PerfTest(ClientServerTest):
+    """
+    run a benchmark several times and compare its results with a baseline
+
+    Baselines are stored in JSON under <perf_baseline_dir>/<provider>/<hardware>.json,
+    with the samples of each metric per test and transfer size.  Without a baseline
+    directory, the results are only printed.
+    """
+
+    def __init__(self, cmdline_args, executable, test_name, metrics,
+                 message_size=None, timeout=None):
+        super().__init__(cmdline_args, executable + " -m",
+                         message_size=message_size, timeout=timeout)
+        self._test_name = test_name
+        self._metrics = metrics
+        self._client_output_file = NamedTemporaryFile(prefix="fabtests_client.out.").name
+
+    def _baseline_file(self):
+        hardware = self._cmdline_args.perf_hardware or hardware_name(self._cmdline_args.server_id)
+        provider = self._cmdline_args.provider.replace(";", "_")
+        return os.path.join(self._cmdline_args.perf_baseline_dir, provider, hardware + ".json")
+
+    def _collect(self):
+        """
+        @return: a dict from transfer size to a dict from metric to samples
+        """
+        samples = {}
+        for _ in range(self._cmdline_args.perf_repeat):
+            super().run()
+            results = parse_perf_output(open(self._client_output_file).read())
+            os.unlink(self._client_output_file)
+            assert results, "no machine readable output"
+
+            for size, fields in results.items():
+                for metric in self._metrics:
+                    field, _ = PERF_METRICS[metric]
+                    samples.setdefault(size, {}).setdefault(metric, []).append(fields[field])
+
+        return samples
+
+    def run(self):
+        samples = self._collect()
+        if not self._cmdline_args.perf_baseline_dir:
+            return
+
+        baseline_file = self._baseline_file()
+        baselines = {}
+        if os.path.exists(baseline_file):
+            baselines = json.load(open(baseline_file))
+
+        if self._cmdline_args.perf_update_baseline:
+            baselines[self._test_name] = samples
+            os.makedirs(os.path.dirname(baseline_file), exist_ok=True)
+            with open(baseline_file, "w") as f:
+                json.dump(baselines, f, indent=2, sort_keys=True)
+            print("baseline updated: " + baseline_file)
+            return
+
+        if self._test_name not in baselines:
+            pytest.skip("no baseline in " + baseline_file)
+
+        regressions = []
+        print("{:<10}{:<14}{:>14}{:>14}{:>10}".format("bytes", "metric", "baseline", "current", "change%"))
+        for size, metrics in samples.items():
+            for metric, current in metrics.items():
+                baseline = baselines[self._test_name].get(size, {}).get(metric)
+                if not baseline:
+                    continue
+
+                _, higher_is_better = PERF_METRICS[metric]
+                regressed, change = is_significant_regression(baseline, current, higher_is_better,
+                                                               self._cmdline_args.perf_threshold)
+                print("{:<10}{:<14}{:>14.2f}{:>14.2f}{:>10.1f}{}".format(
+                      size, metric, sum(baseline) / len(baseline), sum(current) / len(current),
+                      change, "  regression" if regressed else ""))
+                if regressed:
+                    regressions.append("{} {} {:+.1f}%".format(size, metric, change))
+
+        if regressions:
+            pytest.fail("performance regression: " + ", ".join(regressions))
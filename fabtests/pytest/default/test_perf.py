@@ -0,0 +1,36 @@
+import pytest
+
+# Curated benchmarks guarding the latency, bandwidth and message rate of the
+# hot paths.  Results are compared against the baselines in --perf-baseline-dir.
+
+
+@pytest.mark.performance
+@pytest.mark.serial
+def test_rdm_pingpong_perf(cmdline_args):
+    from common import PerfTest
+    test = PerfTest(cmdline_args, "fi_rdm_pingpong", "rdm_pingpong", ["latency"])
+    test.run()
+
+@pytest.mark.performance
+@pytest.mark.serial
+def test_rdm_tagged_pingpong_perf(cmdline_args):
+    from common import PerfTest
+    test = PerfTest(cmdline_args, "fi_rdm_tagged_pingpong", "rdm_tagged_pingpong", ["latency"])
+    test.run()
+
+@pytest.mark.performance
+@pytest.mark.serial
+def test_rdm_tagged_bw_perf(cmdline_args):
+    from common import PerfTest
+    test = PerfTest(cmdline_args, "fi_rdm_tagged_bw", "rdm_tagged_bw",
+                    ["bandwidth", "message_rate"])
+    test.run()
+
+@pytest.mark.performance
+@pytest.mark.serial
+@pytest.mark.parametrize("operation_type", ["read", "write"])
+def test_rma_bw_perf(cmdline_args, operation_type):
+    from common import PerfTest
+    test = PerfTest(cmdline_args, "fi_rma_bw -e rdm -o " + operation_type,
+                    "rma_bw_" + operation_type, ["bandwidth"])
+    test.run()
@@ -0,0 +1,2 @@
+from default.test_perf import test_rdm_pingpong_perf, test_rdm_tagged_pingpong_perf, \
+    test_rdm_tagged_bw_perf
@@ -179,6 +179,11 @@ short_tests=(
 	"fi_rdm_tagged_bw -I 5 -U"
 	"fi_rdm_tagged_bw -I 5 -v"
 	"fi_rdm_tagged_bw -I 5 -v -U"
+	"fi_rdm_mt_rate -I 5 -T 2"
+	"fi_rdm_mt_rate -I 5 -T 2 --shared-ep"
+	"fi_rdm_match -I 5"
+	"fi_rdm_overlap -I 5"
+	"fi_rdm_overlap -I 5 -o write"
 	"fi_dgram_pingpong -I 5"
 )
 
@@ -219,6 +224,8 @@ standard_tests=(
 	"fi_rdm_tagged_bw -U"
 	"fi_rdm_tagged_bw -v"
 	"fi_rdm_tagged_bw -v -U"
+	"fi_rdm_mt_rate -T 4"
+	"fi_rdm_mt_rate -T 4 --shared-ep"
 	"fi_dgram_pingpong"
 	"fi_dgram_pingpong -k"
 )
@@ -233,6 +240,7 @@ unit_tests=(
 	"fi_mr_test"
 	"fi_cntr_test"
 	"fi_setopt_test"
+	"fi_mr_cache_perf -I 100 -s SERVER_ADDR"
 )
 
 regression_tests=(
@@ -249,6 +257,18 @@ multinode_tests=(
 	"fi_multinode_coll"
 )
 
+# Run with large tagged transfers striped over extra connections, which
+# exercises the version 2 rdm connection and lane handshake.
+prov_tcp_env="export FI_TCP_RDM_RENDEZVOUS_SIZE=65536 ; \
+export FI_TCP_RDM_STRIPE_CNT=4 ; export FI_TCP_RDM_STRIPE_SIZE=65536 ;"
+
+prov_tcp_tests=(
+	"fi_rdm_tagged_bw -e rdm -S 1048576 -v"
+	"fi_rdm_tagged_bw -e rdm -S 1048576 -v -U"
+	"fi_rdm_tagged_pingpong -e rdm -S 4194304 -v"
+	"fi_unexpected_msg -e rdm -I 10 -S 1048576 -v"
+)
+
 prov_efa_tests=( \
 	"fi_efa_rnr_read_cq_error"
 	"fi_efa_rnr_queue_resend -c 0 -S 1048576"
@@ -750,6 +770,16 @@ function prov_efa_test {
 	done
 }
 
+function prov_tcp_test {
+	local saved_env="$EXPORT_ENV"
+
+	EXPORT_ENV="$saved_env $prov_tcp_env"
+	for test in "${prov_tcp_tests[@]}"; do
+		cs_test "$test"
+	done
+	EXPORT_ENV="$saved_env"
+}
+
 function set_core_util {
 	prov_arr=$(echo $PROV | tr ";" " ")
 	CORE=""
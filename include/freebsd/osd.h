@@ -71,6 +71,34 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return -FI_ENOSYS;
 }
 
+struct fi_pci_attr;
+
+static inline int ofi_alloc_sized_hugepage_buf(void **memptr, size_t size,
+					       size_t page_size)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_numa_bind(void *addr, size_t size, int node)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_numa_node_self(void)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_pci_numa_node(const struct fi_pci_attr *pci)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_numa_distance(int from, int to)
+{
+	return -FI_ENOSYS;
+}
+
 static inline size_t ofi_ifaddr_get_speed(struct ifaddrs *ifa)
 {
 	return 0;
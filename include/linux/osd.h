@@ -70,6 +70,15 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return ofi_mmap_anon_pages(memptr, size, MAP_HUGETLB);
 }
 
+struct fi_pci_attr;
+
+int ofi_alloc_sized_hugepage_buf(void **memptr, size_t size,
+				 size_t page_size);
+int ofi_numa_bind(void *addr, size_t size, int node);
+int ofi_numa_node_self(void);
+int ofi_pci_numa_node(const struct fi_pci_attr *pci);
+int ofi_numa_distance(int from, int to);
+
 static inline int ofi_hugepage_enabled(void)
 {
 	size_t len;
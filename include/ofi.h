@@ -220,6 +220,8 @@ enum {
 	OFI_CLFLUSHOPT_BIT	= (1 << 23),
 	OFI_CLFLUSH_REG		= 3,
 	OFI_CLFLUSH_BIT		= (1 << 19),
+	OFI_WAITPKG_REG		= 2,
+	OFI_WAITPKG_BIT		= (1 << 5),
 };
 
 int ofi_cpu_supports(unsigned func, unsigned reg, unsigned bit);
@@ -291,6 +293,15 @@ struct ipc_info {
 	uint8_t		ipc_handle[MAX_MR_HANDLE_SIZE];
 };
 
+/* Spread threads over cnt slots, where cnt is a power of two */
+static inline size_t ofi_thread_slot(size_t cnt)
+{
+	uint64_t id = (uint64_t) (uintptr_t) pthread_self();
+
+	id = (id ^ (id >> 32)) * 0x9E3779B97F4A7C15ULL;
+	return (size_t) (id >> 32) & (cnt - 1);
+}
+
 static inline uint64_t roundup_power_of_two(uint64_t n)
 {
 	if (!n || !(n & (n - 1)))
@@ -361,6 +372,12 @@ uint8_t ofi_lsb(uint64_t num);
 
 extern size_t ofi_universe_size;
 extern int ofi_av_remove_cleanup;
+extern size_t ofi_srx_tag_buckets;
+extern int ofi_srx_shared_pool;
+extern int ofi_cntr_batch;
+extern size_t ofi_srx_mrecv_slot;
+extern int ofi_wait_spin;
+extern int ofi_cq_lockfree_write;
 extern char *ofi_offload_coll_prov_name;
 extern int ofi_prefer_sysconfig;
 
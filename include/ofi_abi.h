@@ -120,7 +120,18 @@ extern "C" {
 #endif
 
 /* symbol -> external symbol mappings */
-#if HAVE_SYMVER_SUPPORT
+#if HAVE_SYMVER_SUPPORT && HAVE_SYMVER_ATTRIBUTE
+
+/* Link-time optimization drops top-level .symver directives */
+#define COMPAT_SYMVER(name, api, ver) \
+	extern typeof (name) name __attribute__((symver(#api "@" #ver)))
+#define DEFAULT_SYMVER(name, api, ver) \
+	extern typeof (name) name __attribute__((symver(#api "@@" #ver)))
+#define CURRENT_SYMVER(name, api) \
+	extern typeof (name) name \
+		__attribute__((symver(#api "@@" CURRENT_ABI)))
+
+#elif HAVE_SYMVER_SUPPORT
 
 #define COMPAT_SYMVER(name, api, ver) \
 	asm(".symver " #name "," #api "@" #ver "\n")
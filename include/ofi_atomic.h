@@ -86,6 +86,11 @@ extern void (*ofi_atomic_swap_handlers[OFI_SWAP_OP_CNT][OFI_DATATYPE_CNT])
 	ofi_atomic_swap_handlers[op - OFI_SWAP_OP_START][datatype](dst, src, \
 								cmp, res, cnt)
 
+/* Non-atomic reduction of src into dst, for buffers private to the caller */
+void ofi_reduce(enum fi_op op, enum fi_datatype datatype, void *dst,
+		const void *src, size_t cnt);
+void ofi_reduce_init(void);
+
 int ofi_atomic_valid(const struct fi_provider *prov,
 		     enum fi_datatype datatype, enum fi_op op, uint64_t flags);
 
@@ -86,6 +86,8 @@
  *     . if the entry is a no-op it will be released and another entry
  *       will be fetched off the queue.
  *  . Call _release() after reader is done with the entry
+ *  . _head_batch() claims several entries at once, each of which is
+ *    released as above
  */
 
 #ifdef __cplusplus
@@ -219,6 +221,54 @@ again:								\
 	}							\
 	return FI_SUCCESS;					\
 }								\
+/* Claim up to max committed entries with one update of	\
+ * read_pos.  bufs[i] is the entry at *pos + i and must be	\
+ * released once handled.  No-op entries are released here	\
+ * and returned as NULL.  Returns the number claimed.		\
+ */								\
+static inline int name ## _head_batch(struct name *aq,		\
+		entrytype **bufs, int64_t *pos, int max)	\
+{								\
+	struct name ## _entry *ce;				\
+	int64_t diff, seq;					\
+	int i, cnt;						\
+	*pos = ofi_atomic_load_explicit64(&aq->read_pos,	\
+			memory_order_relaxed);			\
+	for (;;) {						\
+		for (cnt = 0; cnt < max; cnt++) {		\
+			ce = &aq->entry[(*pos + cnt) &		\
+					aq->size_mask];		\
+			seq = ofi_atomic_load_explicit64(	\
+				&(ce->seq),			\
+				memory_order_acquire);		\
+			diff = seq - (*pos + cnt + 1);		\
+			if (diff)				\
+				break;				\
+		}						\
+		if (cnt) {					\
+			if (ofi_atomic_compare_exchange_weak64(	\
+				&aq->read_pos, pos,		\
+				*pos + cnt))			\
+				break;				\
+		} else if (diff < 0) {				\
+			return 0;				\
+		} else {					\
+			*pos = ofi_atomic_load_explicit64(	\
+				&aq->read_pos,			\
+				memory_order_relaxed);		\
+		}						\
+	}							\
+	for (i = 0; i < cnt; i++) {				\
+		ce = &aq->entry[(*pos + i) & aq->size_mask];	\
+		bufs[i] = &ce->buf;				\
+		if (ce->noop) {					\
+			ce->noop = false;			\
+			name ##_release(aq, bufs[i], *pos + i);	\
+			bufs[i] = NULL;				\
+		}						\
+	}							\
+	return cnt;						\
+}								\
 static inline void name ## _commit(entrytype *buf,		\
 				int64_t pos)			\
 {								\
@@ -50,6 +50,11 @@ enum util_coll_op_type {
 	UTIL_COLL_BROADCAST_OP,
 	UTIL_COLL_ALLGATHER_OP,
 	UTIL_COLL_SCATTER_OP,
+	UTIL_COLL_ALLTOALL_OP,
+	UTIL_COLL_REDUCE_SCATTER_OP,
+	UTIL_COLL_REDUCE_OP,
+	UTIL_COLL_GATHER_OP,
+	UTIL_COLL_TOPO_OP,
 };
 
 static const char * const log_util_coll_op_type[] = {
@@ -58,7 +63,12 @@ static const char * const log_util_coll_op_type[] = {
 	[UTIL_COLL_ALLREDUCE_OP] = "COLL_ALLREDUCE",
 	[UTIL_COLL_BROADCAST_OP] = "COLL_BROADCAST",
 	[UTIL_COLL_ALLGATHER_OP] = "COLL_ALLGATHER",
-	[UTIL_COLL_SCATTER_OP] = "COLL_SCATTER"
+	[UTIL_COLL_SCATTER_OP] = "COLL_SCATTER",
+	[UTIL_COLL_ALLTOALL_OP] = "COLL_ALLTOALL",
+	[UTIL_COLL_REDUCE_SCATTER_OP] = "COLL_REDUCE_SCATTER",
+	[UTIL_COLL_REDUCE_OP] = "COLL_REDUCE",
+	[UTIL_COLL_GATHER_OP] = "COLL_GATHER",
+	[UTIL_COLL_TOPO_OP] = "COLL_TOPO"
 };
 
 enum coll_work_type {
@@ -85,7 +95,7 @@ struct util_coll_operation;
 
 struct util_coll_work_item {
 	struct slist_entry		ready_entry;
-	struct dlist_entry		waiting_entry;
+	struct dlist_entry		sched_entry;
 	struct util_coll_operation 	*coll_op;
 	enum coll_work_type		type;
 	enum coll_state			state;
@@ -97,7 +107,6 @@ struct util_coll_xfer_item {
 	void 				*buf;
 	int				count;
 	enum fi_datatype		datatype;
-	uint64_t			tag;
 	int				remote_rank;
 };
 
@@ -125,6 +134,7 @@ struct join_data {
 };
 
 struct barrier_data {
+	uint64_t send;
 	uint64_t data;
 	uint64_t tmp;
 };
@@ -140,6 +150,46 @@ struct broadcast_data {
 	void	*scatter;
 };
 
+struct topo_data {
+	uint64_t	host_id;
+	uint64_t	*host_ids;
+	/* latency in ns and bandwidth in bytes/s, agreed on by the group */
+	uint64_t	cost_in[2];
+	uint64_t	cost[2];
+	uint64_t	cost_tmp[2];
+	/* shortest step of the allgather, timed at each receive */
+	uint64_t	step_start;
+	uint64_t	step_min;
+	size_t		step_cnt;
+};
+
+/*
+ * Placement of the ranks of a group on nodes, found when joining it.  The
+ * leader of a node is its lowest rank.
+ */
+struct util_coll_topo {
+	size_t		node_cnt;
+	size_t		node_idx;
+	/* leader rank of every node */
+	uint64_t	*leaders;
+	size_t		local_cnt;
+	size_t		local_idx;
+	/* ranks on the local node, leader first */
+	uint64_t	*local_ranks;
+};
+
+/* Arguments that identify a reusable schedule */
+struct util_coll_key {
+	struct fid_ep			*ep;
+	enum util_coll_op_type		type;
+	const void			*buf;
+	void				*result;
+	size_t				count;
+	enum fi_datatype		datatype;
+	enum fi_op			op;
+	uint64_t			root;
+};
+
 struct util_coll_operation;
 
 typedef void (*util_coll_comp_fn_t)(struct util_coll_operation *coll_op);
@@ -149,7 +199,28 @@ struct util_coll_operation {
 	void				*context;
 	struct fid_ep			*ep;
 	struct util_coll_mc		*mc;
-	struct dlist_entry		work_queue;
+	/* every work item, in schedule order */
+	struct dlist_entry		sched_list;
+
+	/* Items are released an epoch at a time, an epoch ending with a
+	 * fenced item.  pending counts the released items not yet complete,
+	 * and the next epoch starts at release_pos once it drops to zero.
+	 */
+	struct dlist_entry		*release_pos;
+	size_t				pending;
+
+	/* Persistent operations keep their schedule and buffers after
+	 * completing, and are restarted by a call with the same key.
+	 */
+	struct dlist_entry		persist_entry;
+	struct util_coll_key		key;
+	bool				persistent;
+	bool				active;
+
+	/* copy of the send data into the result that precedes the schedule */
+	const void			*init_src;
+	void				*init_dst;
+	size_t				init_size;
 
 	union {
 		struct join_data	join;
@@ -157,6 +228,9 @@ struct util_coll_operation {
 		struct allreduce_data	allreduce;
 		void			*scatter;
 		struct broadcast_data	broadcast;
+		/* temporary buffers of alltoall, reductions and gather */
+		void			*scratch;
+		struct topo_data	topo;
 	} data;
 	util_coll_comp_fn_t		comp_fn;
 	uint64_t			flags;
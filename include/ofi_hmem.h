@@ -41,6 +41,7 @@
 #include <rdma/fi_domain.h>
 #include <stdbool.h>
 #include "ofi_mr.h"
+#include "ofi_iov.h"
 
 extern bool ofi_hmem_disable_p2p;
 
@@ -260,7 +261,7 @@ int synapseai_host_unregister(void *ptr);
 static inline int ofi_memcpy(uint64_t device, void *dest, const void *src,
 			     size_t size)
 {
-	memcpy(dest, src, size);
+	ofi_copy(dest, src, size);
 	return FI_SUCCESS;
 }
 
@@ -373,6 +374,44 @@ ssize_t ofi_async_copy_to_hmem_iov(enum fi_hmem_iface hmem_iface, uint64_t devic
 int ofi_async_copy_query(enum fi_hmem_iface iface,
 			 ofi_hmem_async_event_t event);
 
+/*
+ * Pipelined copy - Splits a large copy between a host buffer and device
+ * memory into chunks which are issued on up to OFI_HMEM_COPY_MAX_EVENTS
+ * async copy events at a time.  The provider polls the copy from its
+ * progress loop with ofi_hmem_copy_progress().  Interfaces without async
+ * copy support complete the copy synchronously in ofi_hmem_copy_start().
+ * Only ROCr implements the async copy ops, and sm2 IPC receives are the
+ * only caller, so other interfaces and providers do not pipeline yet.
+ * The iov array must remain valid until the copy completes.
+ */
+#define OFI_HMEM_COPY_MAX_EVENTS 4
+
+struct ofi_hmem_copy {
+	enum fi_hmem_iface		iface;
+	uint64_t			device;
+	const struct iovec		*iov;
+	size_t				iov_count;
+	uint64_t			iov_offset;
+	char				*buf;
+	size_t				size;
+	int				dir;
+
+	size_t				issued;
+	size_t				completed;
+	size_t				head;
+	size_t				tail;
+	ofi_hmem_async_event_t		events[OFI_HMEM_COPY_MAX_EVENTS];
+	size_t				lens[OFI_HMEM_COPY_MAX_EVENTS];
+	size_t				event_cnt;
+};
+
+int ofi_hmem_copy_start(struct ofi_hmem_copy *copy,
+			enum fi_hmem_iface iface, uint64_t device,
+			const struct iovec *iov, size_t iov_count,
+			uint64_t iov_offset, void *buf, size_t size, int dir);
+int ofi_hmem_copy_progress(struct ofi_hmem_copy *copy);
+void ofi_hmem_copy_cleanup(struct ofi_hmem_copy *copy);
+
 ssize_t ofi_copy_from_hmem_iov(void *dest, size_t size,
 			       enum fi_hmem_iface hmem_iface, uint64_t device,
 			       const struct iovec *hmem_iov,
@@ -427,6 +466,28 @@ enum fi_hmem_iface ofi_get_hmem_iface(const void *addr, uint64_t *device,
 				      uint64_t *flags);
 int ofi_hmem_host_register(void *addr, size_t size);
 int ofi_hmem_host_unregister(void *addr);
+
+/*
+ * Host staging memory is allocated and registered with all initialized
+ * HMEM ifaces once, when the owning domain is opened, and handed out in
+ * page aligned pieces for bounce buffers.  Copies between device memory
+ * and staging memory therefore always run at pinned memory bandwidth.
+ * The owner may also register the whole area with the NIC once and keep
+ * that registration in context.
+ */
+struct ofi_hmem_staging {
+	char			*base;
+	size_t			size;
+	struct dlist_entry	free_list;
+	struct dlist_entry	used_list;
+	ofi_mutex_t		lock;
+	void			*context;
+};
+
+int ofi_hmem_staging_init(struct ofi_hmem_staging *staging, size_t size);
+void ofi_hmem_staging_cleanup(struct ofi_hmem_staging *staging);
+void *ofi_hmem_staging_alloc(struct ofi_hmem_staging *staging, size_t size);
+void ofi_hmem_staging_free(struct ofi_hmem_staging *staging, void *buf);
 bool ofi_hmem_is_ipc_enabled(enum fi_hmem_iface iface);
 size_t ofi_hmem_get_ipc_handle_size(enum fi_hmem_iface iface);
 bool ofi_hmem_any_ipc_enabled(void);
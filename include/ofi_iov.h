@@ -105,6 +105,45 @@ static inline size_t ofi_iov_bytes_to_copy(const struct iovec *iov,
 	return len;
 }
 
+/*
+ * Copy engine - Bounce buffer copies of at least ofi_copy_nt_threshold
+ * bytes use non-temporal stores, so that large copies do not evict the
+ * working set of the copying core.  Selected with FI_COPY_ENGINE.
+ */
+void ofi_copy_init(void);
+
+extern size_t ofi_copy_nt_threshold;
+extern void (*ofi_copy_nt)(void *dst, const void *src, size_t len);
+
+static inline void ofi_copy(void *dst, const void *src, size_t len)
+{
+	if (OFI_UNLIKELY(len >= ofi_copy_nt_threshold))
+		ofi_copy_nt(dst, src, len);
+	else
+		memcpy(dst, src, len);
+}
+
+/*
+ * CRC32C (Castagnoli) of a buffer, continuing from crc.  Start from 0.
+ * Uses SSE4.2 or the ARMv8 CRC extension when the CPU supports it; long
+ * buffers are split into three interleaved crc32 streams rather than
+ * folded with PCLMUL.  Only tcp's FI_TCP_INTEGRITY uses it today.
+ */
+void ofi_crc32c_init(void);
+
+extern uint32_t (*ofi_crc32c_fn)(uint32_t crc, const void *buf, size_t len);
+/* Table driven reference, used when no CRC instructions are available */
+uint32_t ofi_crc32c_sw(uint32_t crc, const void *buf, size_t len);
+
+static inline uint32_t ofi_crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	return ofi_crc32c_fn(crc, buf, len);
+}
+
+/* CRC32C of the first len bytes described by iov */
+uint32_t ofi_crc32c_iov(uint32_t crc, const struct iovec *iov,
+			size_t iov_count, size_t len);
+
 uint64_t ofi_copy_iov_buf(const struct iovec *iov, size_t iov_count, uint64_t iov_offset,
 			  void *buf, uint64_t bufsize, int dir);
 
@@ -116,7 +155,7 @@ ofi_copy_to_iov(const struct iovec *iov, size_t iov_count, uint64_t iov_offset,
 		uint64_t size = ((iov_offset > iov[0].iov_len) ?
 				 0 : MIN(bufsize, iov[0].iov_len - iov_offset));
 
-		memcpy((char *)iov[0].iov_base + iov_offset, buf, size);
+		ofi_copy((char *)iov[0].iov_base + iov_offset, buf, size);
 		return size;
 	} else {
 		return ofi_copy_iov_buf(iov, iov_count, iov_offset, buf, bufsize,
@@ -132,7 +171,7 @@ ofi_copy_from_iov(void *buf, uint64_t bufsize,
 		uint64_t size = ((iov_offset > iov[0].iov_len) ?
 				 0 : MIN(bufsize, iov[0].iov_len - iov_offset));
 
-		memcpy(buf, (char *)iov[0].iov_base + iov_offset, size);
+		ofi_copy(buf, (char *)iov[0].iov_base + iov_offset, size);
 		return size;
 	} else {
 		return ofi_copy_iov_buf(iov, iov_count, iov_offset, buf, bufsize,
@@ -359,9 +359,11 @@ enum ofi_lock_type {
 	OFI_LOCK_NONE,
 };
 
-typedef int  (*ofi_genlock_lockheld_t)(void *baselock);
-typedef void (*ofi_genlock_lockop_t)(void *baselock);
-
+/*
+ * The lock type is fixed when the lock is initialized, so the dispatch below
+ * is a well-predicted branch rather than an indirect call.  The no-op types
+ * are tested first, as they guard the hot paths of FI_THREAD_DOMAIN users.
+ */
 struct ofi_genlock {
 	enum ofi_lock_type	lock_type;
 	union {
@@ -369,10 +371,6 @@ struct ofi_genlock {
 		ofi_spin_t	spinlock;
 		void		*nolock;
 	} base;
-
-	ofi_genlock_lockheld_t	held;
-	ofi_genlock_lockop_t	lock;
-	ofi_genlock_lockop_t	unlock;
 };
 
 int ofi_genlock_init(struct ofi_genlock *lock,
@@ -381,17 +379,31 @@ void ofi_genlock_destroy(struct ofi_genlock *lock);
 
 static inline int ofi_genlock_held(struct ofi_genlock *lock)
 {
-	return lock->held(&lock->base);
+	if (lock->lock_type == OFI_LOCK_NONE)
+		return ofi_nolock_held_op(lock->base.nolock);
+	if (lock->lock_type == OFI_LOCK_SPINLOCK)
+		return ofi_spin_held(&lock->base.spinlock);
+	return ofi_mutex_held(&lock->base.mutex);
 }
 
 static inline void ofi_genlock_lock(struct ofi_genlock *lock)
 {
-	lock->lock(&lock->base);
+	if (lock->lock_type == OFI_LOCK_NOOP)
+		ofi_mutex_lock_noop(&lock->base.mutex);
+	else if (lock->lock_type == OFI_LOCK_MUTEX)
+		ofi_mutex_lock(&lock->base.mutex);
+	else if (lock->lock_type == OFI_LOCK_SPINLOCK)
+		ofi_spin_lock(&lock->base.spinlock);
 }
 
 static inline void ofi_genlock_unlock(struct ofi_genlock *lock)
 {
-	lock->unlock(&lock->base);
+	if (lock->lock_type == OFI_LOCK_NOOP)
+		ofi_mutex_unlock_noop(&lock->base.mutex);
+	else if (lock->lock_type == OFI_LOCK_MUTEX)
+		ofi_mutex_unlock(&lock->base.mutex);
+	else if (lock->lock_type == OFI_LOCK_SPINLOCK)
+		ofi_spin_unlock(&lock->base.spinlock);
 }
 
 #ifdef __cplusplus
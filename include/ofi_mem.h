@@ -327,9 +327,55 @@ enum {
 	OFI_BUFPOOL_NO_TRACK		= 1 << 2,
 	OFI_BUFPOOL_HUGEPAGES		= 1 << 3,
 	OFI_BUFPOOL_NONSHARED		= 1 << 4,
+	OFI_BUFPOOL_PERTHREAD		= 1 << 5,
+	OFI_BUFPOOL_NUMA		= 1 << 6,
+	OFI_BUFPOOL_STAGING		= 1 << 7,
 };
 
+/*
+ * OFI_BUFPOOL_NUMA places regions on attr.numa_node, or on the node of
+ * the thread creating the pool if numa_node is OFI_BUFPOOL_NUMA_LOCAL.
+ * Placement is a preference; allocations fall back to other nodes when
+ * the requested node is out of memory.
+ *
+ * OFI_BUFPOOL_HUGEPAGES regions try 1 GiB pages, then 2 MiB pages, then
+ * base pages.  A page size is only tried if a region spans at least one
+ * page, and a size that fails is not retried for the pool.
+ *
+ * When attr.staging is set, regions are taken from that pre-registered
+ * host staging area while it has room, and are marked with
+ * OFI_BUFPOOL_STAGING.  alloc_fn may then skip per-region registration.
+ */
+#define OFI_BUFPOOL_NUMA_LOCAL		(-1)
+
+enum {
+	OFI_BUFPOOL_PAGE_1G,
+	OFI_BUFPOOL_PAGE_2M,
+	OFI_BUFPOOL_PAGE_BASE,
+	OFI_BUFPOOL_PAGE_MAX,
+};
+
+/*
+ * OFI_BUFPOOL_PERTHREAD pools are thread safe without caller locking.
+ * Each thread allocates from and frees to one of a fixed set of small
+ * magazines, selected by thread id, which are refilled from and drained
+ * back to the shared free list in batches.  Not supported for indexed
+ * pools.
+ */
+enum {
+	OFI_BUFPOOL_MAG_CNT		= 16,
+	OFI_BUFPOOL_MAG_SIZE		= 32,
+	OFI_BUFPOOL_MAG_BATCH		= OFI_BUFPOOL_MAG_SIZE / 2,
+};
+
+struct ofi_bufpool_mag {
+	ofi_spin_t			lock;
+	struct slist			entries;
+	size_t				cnt;
+} __attribute__((__aligned__(64)));
+
 struct ofi_bufpool_region;
+struct ofi_hmem_staging;
 
 struct ofi_bufpool_attr {
 	size_t 		size;
@@ -341,6 +387,8 @@ struct ofi_bufpool_attr {
 	void		(*init_fn)(struct ofi_bufpool_region *region, void *buf);
 	void 		*context;
 	int		flags;
+	int		numa_node;
+	struct ofi_hmem_staging *staging;
 };
 
 struct ofi_bufpool {
@@ -357,6 +405,20 @@ struct ofi_bufpool {
 	size_t				alloc_size;
 	size_t				region_size;
 	struct ofi_bufpool_attr		attr;
+
+	/* Buffers handed out from the free list.  For per-thread pools
+	 * this includes buffers cached in the magazines.
+	 */
+	size_t				inuse_cnt;
+	size_t				inuse_hwm;
+
+	struct ofi_bufpool_mag		*mags;
+	ofi_spin_t			lock;
+
+	/* Regions obtained with each page size */
+	size_t				page_cnt[OFI_BUFPOOL_PAGE_MAX];
+	int				huge_index;
+	int				numa_node;
 };
 
 struct ofi_bufpool_region {
@@ -410,6 +472,18 @@ void ofi_bufpool_destroy(struct ofi_bufpool *pool);
 
 int ofi_bufpool_grow(struct ofi_bufpool *pool);
 
+struct ofi_bufpool_hdr *ofi_bufpool_mag_alloc(struct ofi_bufpool *pool);
+void ofi_bufpool_mag_free(struct ofi_bufpool *pool,
+			  struct ofi_bufpool_hdr *buf_hdr);
+
+static inline void ofi_bufpool_track_alloc(struct ofi_bufpool *pool,
+					   size_t cnt)
+{
+	pool->inuse_cnt += cnt;
+	if (pool->inuse_cnt > pool->inuse_hwm)
+		pool->inuse_hwm = pool->inuse_cnt;
+}
+
 static inline struct ofi_bufpool_hdr *ofi_buf_hdr(void *buf)
 {
 	return (struct ofi_bufpool_hdr *)
@@ -435,16 +509,24 @@ static inline struct ofi_bufpool *ofi_buf_pool(void *buf)
 
 static inline void ofi_buf_free(void *buf)
 {
+	struct ofi_bufpool *pool = ofi_buf_pool(buf);
+
 	assert(ofi_atomic_dec32(&ofi_buf_region(buf)->use_cnt) >= 0);
-	assert(!(ofi_buf_pool(buf)->attr.flags & OFI_BUFPOOL_INDEXED));
+	assert(!(pool->attr.flags & OFI_BUFPOOL_INDEXED));
 	assert(ofi_buf_hdr(buf)->magic == OFI_MAGIC_SIZE_T);
 	assert(ofi_buf_hdr(buf)->ftr->magic == OFI_MAGIC_SIZE_T);
 	assert(ofi_buf_hdr(buf)->allocated == true);
 
 	OFI_DBG_SET(ofi_buf_hdr(buf)->allocated, false);
 
+	if (pool->attr.flags & OFI_BUFPOOL_PERTHREAD) {
+		ofi_bufpool_mag_free(pool, ofi_buf_hdr(buf));
+		return;
+	}
+
 	slist_insert_head(&ofi_buf_hdr(buf)->entry.slist,
-			  &ofi_buf_pool(buf)->free_list.entries);
+			  &pool->free_list.entries);
+	pool->inuse_cnt--;
 }
 
 int ofi_ibuf_is_lower(struct dlist_entry *item, const void *arg);
@@ -464,6 +546,7 @@ static inline void ofi_ibuf_free(void *buf)
 
 	OFI_DBG_SET(buf_hdr->allocated, false);
 
+	buf_hdr->region->pool->inuse_cnt--;
 	dlist_insert_order(&buf_hdr->region->free_list,
 			   ofi_ibuf_is_lower, &buf_hdr->entry.dlist);
 	if (dlist_empty(&buf_hdr->region->entry)) {
@@ -508,13 +591,20 @@ static inline void *ofi_buf_alloc(struct ofi_bufpool *pool)
 	struct ofi_bufpool_hdr *buf_hdr;
 
 	assert(!(pool->attr.flags & OFI_BUFPOOL_INDEXED));
-	if (ofi_bufpool_empty(pool)) {
-		if (ofi_bufpool_grow(pool))
+	if (pool->attr.flags & OFI_BUFPOOL_PERTHREAD) {
+		buf_hdr = ofi_bufpool_mag_alloc(pool);
+		if (!buf_hdr)
 			return NULL;
-	}
+	} else {
+		if (ofi_bufpool_empty(pool)) {
+			if (ofi_bufpool_grow(pool))
+				return NULL;
+		}
 
-	slist_remove_head_container(&pool->free_list.entries,
+		slist_remove_head_container(&pool->free_list.entries,
 				struct ofi_bufpool_hdr, buf_hdr, entry.slist);
+		ofi_bufpool_track_alloc(pool, 1);
+	}
 	assert(ofi_atomic_inc32(&buf_hdr->region->use_cnt));
 	assert(buf_hdr->allocated == false);
 
@@ -551,6 +641,7 @@ static inline void *ofi_ibuf_alloc(struct ofi_bufpool *pool)
 				  struct ofi_bufpool_region, entry);
 	dlist_pop_front(&buf_region->free_list, struct ofi_bufpool_hdr,
 			buf_hdr, entry.dlist);
+	ofi_bufpool_track_alloc(pool, 1);
 	assert(ofi_atomic_inc32(&buf_hdr->region->use_cnt));
 	assert(buf_hdr->allocated == false);
 
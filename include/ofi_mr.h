@@ -48,6 +48,7 @@
 #include <ofi_lock.h>
 #include <ofi_list.h>
 #include <ofi_tree.h>
+#include <ofi_indexer.h>
 
 int ofi_open_mr_cache(uint32_t version, void *attr, size_t attr_len,
 		      uint64_t flags, struct fid **fid, void *context);
@@ -136,6 +137,7 @@ struct ofi_mr_entry {
 	int				use_cnt;
 	struct dlist_entry		list_entry;
 	union ofi_mr_hmem_info		hmem_info;
+	uint64_t			lru_tick;
 	uint8_t				data[];
 };
 
@@ -172,6 +174,25 @@ struct ofi_mem_monitor {
 	bool (*valid)(struct ofi_mem_monitor *notifier,
 		      const struct ofi_mr_info *info, struct ofi_mr_entry *entry);
 	const char *name;
+
+	/* Batched notification counters, updated under mm_lock */
+	size_t				queued_cnt;
+	size_t				coalesced_cnt;
+	size_t				flushed_cnt;
+};
+
+/*
+ * Notification batch - Collects invalidated address ranges, merging
+ * overlapping and adjacent ranges, so that a burst of events can be
+ * reported to the MR caches under a single acquisition of mm_lock.
+ */
+#define OFI_MONITOR_BATCH_SIZE 64
+
+struct ofi_monitor_batch {
+	struct iovec			iov[OFI_MONITOR_BATCH_SIZE];
+	size_t				cnt;
+	size_t				queued_cnt;
+	size_t				coalesced_cnt;
 };
 
 void ofi_monitor_init(struct ofi_mem_monitor *monitor);
@@ -187,6 +208,18 @@ void ofi_monitor_notify(struct ofi_mem_monitor *monitor,
 			const void *addr, size_t len);
 void ofi_monitor_flush(struct ofi_mem_monitor *monitor);
 
+static inline void ofi_monitor_batch_init(struct ofi_monitor_batch *batch)
+{
+	batch->cnt = 0;
+	batch->queued_cnt = 0;
+	batch->coalesced_cnt = 0;
+}
+
+bool ofi_monitor_batch_add(struct ofi_monitor_batch *batch,
+			   const void *addr, size_t len);
+void ofi_monitor_batch_notify(struct ofi_mem_monitor *monitor,
+			      struct ofi_monitor_batch *batch);
+
 int ofi_monitor_subscribe(struct ofi_mem_monitor *monitor,
 			  const void *addr, size_t len,
 			  union ofi_mr_hmem_info *hmem_info);
@@ -241,11 +274,21 @@ extern struct ofi_mem_monitor *xpmem_monitor;
  * is used by the ofi_mr_xxx calls below, and may be accessed by a
  * provider when processing incoming RMA operations to verify that
  * a region has been registered for the specified operation.
+ *
+ * With FI_MR_PROV_KEY, regions are kept in an indexer and the key is
+ * formed from a generation number and the region's index, so that
+ * lookups are an array access rather than a tree search.  Requested
+ * keys are stored in the rbtree, as are provider keys once the indexer
+ * holds OFI_IDX_MAX_INDEX regions.
  */
+#define OFI_MR_MAP_IDX_BITS	32
+#define OFI_MR_MAP_IDX_MASK	((1ULL << OFI_MR_MAP_IDX_BITS) - 1)
+#define OFI_MR_MAP_IDX_NONE	OFI_MR_MAP_IDX_MASK
 
 struct ofi_mr_map {
 	const struct fi_provider *prov;
 	struct ofi_rbmap	*rbtree;
+	struct indexer		key_idx;
 	uint64_t		key;
 	int			mode;
 };
@@ -351,12 +394,38 @@ struct ofi_mr_cache_params {
 	int				cuda_monitor_enabled;
 	int				rocr_monitor_enabled;
 	int				ze_monitor_enabled;
+	size_t				shard_cnt;
+	size_t				merge_max_size;
 };
 
 extern struct ofi_mr_cache_params	cache_params;
 
 #define OFI_HMEM_MAX 6
 
+/* Address space is split into OFI_MR_CACHE_SHARD_SHIFT sized chunks that
+ * are distributed round-robin over the shards.  A region that fits in one
+ * chunk is held by that chunk's shard.  A region crossing a chunk boundary
+ * is held by an extra spanning shard, shards[shard_cnt], which lookups
+ * check whenever the chunk's shard has no match.
+ */
+#define OFI_MR_CACHE_SHARD_SHIFT 21
+
+/*
+ * In sharded mode, the shard lock protects the shard tree and LRU list, and
+ * the use_cnt, node and LRU linkage of the entries it holds.  mm_lock still
+ * protects the cache counters, the dead region list and monitor state.  When
+ * both are needed, mm_lock is acquired first.  Cache hits only take shard
+ * locks, one at a time.
+ */
+struct ofi_mr_cache_shard {
+	pthread_mutex_t			lock;
+	struct ofi_rbmap		tree;
+	struct dlist_entry		lru_list;
+	size_t				search_cnt;
+	size_t				hit_cnt;
+	size_t				delete_cnt;
+} __attribute__((__aligned__(64)));
+
 struct ofi_mr_cache {
 	struct util_domain		*domain;
 	const struct fi_provider	*prov;
@@ -381,6 +450,12 @@ struct ofi_mr_cache {
 	size_t				notify_cnt;
 	struct ofi_bufpool		*entry_pool;
 
+	/* Only set when the cache runs in sharded mode */
+	struct ofi_mr_cache_shard	*shards;
+	size_t				shard_cnt;
+	ofi_atomic32_t			dead_pending;
+	ofi_atomic64_t			lru_tick;
+
 	int				(*add_region)(struct ofi_mr_cache *cache,
 						      struct ofi_mr_entry *entry);
 	void				(*delete_region)(struct ofi_mr_cache *cache,
@@ -72,9 +72,11 @@ typedef long double long_double;
 #ifdef __GNUC__
 #define OFI_LIKELY(x)	__builtin_expect((x), 1)
 #define OFI_UNLIKELY(x)	__builtin_expect((x), 0)
+#define OFI_PREFETCH(addr)	__builtin_prefetch(addr)
 #else
 #define OFI_LIKELY(x)	(x)
 #define OFI_UNLIKELY(x)	(x)
+#define OFI_PREFETCH(addr)	((void) (addr))
 #endif
 
 enum {
@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <string.h>
 #include <ofi_osd.h>
+#include <rdma/fi_ext.h>
 #include <rdma/providers/fi_prov.h>
 
 
@@ -62,6 +63,8 @@ enum {
 enum {
 	OFI_PMC_CPU_CYCLES,
 	OFI_PMC_CPU_INSTR,
+	OFI_PMC_CPU_CACHE_MISSES,
+	OFI_PMC_CPU_BRANCH_MISSES,
 };
 
 enum {
@@ -69,6 +72,7 @@ enum {
 	OFI_PMC_CACHE_L1_INSTR,
 	OFI_PMC_CACHE_TLB_DATA,
 	OFI_PMC_CACHE_TLB_INSTR,
+	OFI_PMC_CACHE_LL,
 };
 
 enum {
@@ -89,6 +93,23 @@ extern enum ofi_perf_domain	perf_domain;
 extern uint32_t			perf_cntr;
 extern uint32_t			perf_flags;
 
+/*
+ * FI_PERF_CNTR may list several counters.  The first one is also exposed
+ * through perf_domain, perf_cntr and perf_flags.  Events flagged with
+ * OFI_PMC_FLAG_MISS count memory stalls.
+ */
+#define OFI_PERF_MAX_EVENTS	4
+
+struct ofi_perf_event {
+	const char		*name;
+	enum ofi_perf_domain	domain;
+	uint32_t		cntr;
+	uint32_t		flags;
+};
+
+extern struct ofi_perf_event	perf_events[OFI_PERF_MAX_EVENTS];
+extern size_t			perf_event_cnt;
+
 
 /*
  * Performance management unit:
@@ -180,6 +201,85 @@ static inline void ofi_perfset_end(struct ofi_perfset *set, size_t index)
 }
 
 
+/*
+ * Latency histograms:
+ *
+ * Probe points bracket a code path with ofi_hist_start() and ofi_hist_end().
+ * Samples are recorded in nanoseconds into log-linear buckets, with
+ * OFI_HIST_SUB_BUCKETS linear buckets per power of two.  Counters are
+ * spread over OFI_HIST_SLOTS cache aligned slots indexed by the calling
+ * thread, so that concurrent threads rarely touch the same lines.  When
+ * histograms are disabled, a probe costs a single branch.
+ */
+enum ofi_hist_id {
+	OFI_HIST_CQ_WRITE,
+	OFI_HIST_MR_CACHE_SEARCH,
+	OFI_HIST_PROGRESS,
+	OFI_HIST_MAX
+};
+
+#define OFI_HIST_SUB_SHIFT	3
+#define OFI_HIST_SUB_BUCKETS	(1 << OFI_HIST_SUB_SHIFT)
+#define OFI_HIST_MAX_SHIFT	40
+#define OFI_HIST_BUCKETS	((OFI_HIST_MAX_SHIFT - OFI_HIST_SUB_SHIFT + 1) * \
+				 OFI_HIST_SUB_BUCKETS)
+#define OFI_HIST_SLOTS		16
+
+extern int ofi_hist_enabled;
+
+/* A histogram owned by a single object, updated under the object's lock */
+struct ofi_hist {
+	uint64_t	sum;
+	uint64_t	bucket[OFI_HIST_BUCKETS];
+};
+
+struct fi_perf_hist_stat;
+
+void ofi_hist_add(struct ofi_hist *hist, uint64_t val);
+void ofi_hist_read(const struct ofi_hist *hist, const char *name,
+		   struct fi_perf_hist_stat *stat);
+
+/*
+ * Histograms of an object, returned by fi_open_ops("perf_hist") on it.
+ * Reads and resets take the lock that serializes updates.  The set is
+ * released with the object, so closing hist_fid is a no-op.
+ */
+struct ofi_genlock;
+
+struct ofi_hist_set {
+	/* hist_fid.fid.context references the owning object */
+	struct fid_perf_hist	hist_fid;
+	struct ofi_genlock	*lock;
+	const char * const	*names;
+	size_t			count;
+	struct ofi_hist		hist[];
+};
+
+struct ofi_hist_set *ofi_hist_set_alloc(struct fid *owner,
+					struct ofi_genlock *lock,
+					const char * const *names,
+					size_t count);
+void ofi_hist_set_free(struct fid *owner, struct ofi_hist_set *set);
+
+void ofi_hist_init(void);
+void ofi_hist_fini(void);
+uint64_t ofi_hist_time(void);
+void ofi_hist_record(enum ofi_hist_id id, uint64_t start);
+int ofi_open_perf_hist(uint32_t version, void *attr, size_t attr_len,
+		       uint64_t flags, struct fid **fid, void *context);
+
+static inline uint64_t ofi_hist_start(void)
+{
+	return ofi_hist_enabled ? ofi_hist_time() : 0;
+}
+
+static inline void ofi_hist_end(enum ofi_hist_id id, uint64_t start)
+{
+	if (start)
+		ofi_hist_record(id, start);
+}
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _OFI_TRACE_REC_H_
+#define _OFI_TRACE_REC_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary trace records written by the trace hook and read by
+ * fi_trace_analyze.
+ *
+ * Each thread writes to its own file: a header followed by a ring of
+ * fixed size records.  The ring holds a power of two number of records.
+ * head counts every record ever written, so the ring holds the last
+ * MIN(head, capacity) records, the oldest one at index head % capacity
+ * once the ring has wrapped.
+ */
+#define OFI_TRACE_MAGIC		0x74696f66	/* "foit" */
+#define OFI_TRACE_VERSION	1
+#define OFI_TRACE_PEER_UNSPEC	UINT32_MAX
+
+enum ofi_trace_op {
+	OFI_TRACE_RECV,
+	OFI_TRACE_SEND,
+	OFI_TRACE_INJECT,
+	OFI_TRACE_READ,
+	OFI_TRACE_WRITE,
+	OFI_TRACE_INJECT_WRITE,
+	OFI_TRACE_TRECV,
+	OFI_TRACE_TSEND,
+	OFI_TRACE_TINJECT,
+	OFI_TRACE_COMP,
+	OFI_TRACE_COMP_ERR,
+	OFI_TRACE_OP_MAX
+};
+
+struct ofi_trace_hdr {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	rec_size;
+	uint32_t	pid;
+	uint32_t	thread;
+	uint64_t	capacity;
+	uint64_t	head;
+	uint64_t	start_time;
+	char		host[24];
+};
+
+/*
+ * time is in nanoseconds, from the same monotonic clock in all the threads
+ * of a process.  peer is the fi_addr_t of the operation, or
+ * OFI_TRACE_PEER_UNSPEC if it is unknown or does not fit.  Completions
+ * carry the received length and, on error, the positive error code.
+ */
+struct ofi_trace_rec {
+	uint64_t	time;
+	uint64_t	context;
+	uint64_t	len;
+	uint32_t	peer;
+	uint16_t	op;
+	uint16_t	err;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OFI_TRACE_REC_H_ */
@@ -46,6 +46,7 @@
 #define _OFI_TREE_H_
 
 #include <stdlib.h>
+#include <stdint.h>
 
 
 enum ofi_node_color {
@@ -59,6 +60,8 @@ struct ofi_rbnode {
 	struct ofi_rbnode	*parent;
 	enum ofi_node_color	color;
 	void			*data;
+	/* largest end() in this subtree, for interval maps */
+	uint64_t		max_end;
 };
 
 struct ofi_rbmap {
@@ -73,6 +76,11 @@ struct ofi_rbmap {
 	 */
 	int			(*compare)(struct ofi_rbmap *map,
 					   void *key, void *data);
+	/* end(): exclusive end of the interval covered by data.  Set for
+	 * interval maps, which order intervals by start and support
+	 * overlap queries.
+	 */
+	uint64_t		(*end)(void *data);
 };
 
 struct ofi_rbmap *
@@ -81,6 +89,9 @@ void ofi_rbmap_destroy(struct ofi_rbmap *map);
 void ofi_rbmap_init(struct ofi_rbmap *map,
 		int (*compare)(struct ofi_rbmap *map, void *key, void *data));
 void ofi_rbmap_cleanup(struct ofi_rbmap *map);
+void ofi_rbmap_init_interval(struct ofi_rbmap *map,
+		int (*compare)(struct ofi_rbmap *map, void *key, void *data),
+		uint64_t (*end)(void *data));
 
 struct ofi_rbnode *ofi_rbmap_get_root(struct ofi_rbmap *map);
 struct ofi_rbnode *ofi_rbmap_find(struct ofi_rbmap *map, void *key);
@@ -92,5 +103,17 @@ void ofi_rbmap_delete(struct ofi_rbmap *map, struct ofi_rbnode *node);
 int ofi_rbmap_find_delete(struct ofi_rbmap *map, void *key);
 int ofi_rbmap_empty(struct ofi_rbmap *map);
 
+/* Iterate, in order, over the nodes of an interval map that overlap key.
+ * start is the first address covered by key.  overlap() orders key
+ * against data as compare() does and returns 0 if they intersect.  A
+ * node may be deleted once the following node has been found.
+ */
+struct ofi_rbnode *ofi_rbmap_overlap_first(struct ofi_rbmap *map,
+		uint64_t start, void *key,
+		int (*overlap)(struct ofi_rbmap *map, void *key, void *data));
+struct ofi_rbnode *ofi_rbmap_overlap_next(struct ofi_rbmap *map,
+		struct ofi_rbnode *node, uint64_t start, void *key,
+		int (*overlap)(struct ofi_rbmap *map, void *key, void *data));
+
 
 #endif /* OFI_TREE_H_ */
@@ -58,8 +58,10 @@
 #include <ofi.h>
 #include <ofi_mr.h>
 #include <ofi_list.h>
+#include <ofi_perf.h>
 #include <ofi_mem.h>
 #include <ofi_rbuf.h>
+#include <ofi_atomic_queue.h>
 #include <ofi_signal.h>
 #include <ofi_enosys.h>
 #include <ofi_osd.h>
@@ -200,6 +202,7 @@ struct util_domain {
 	struct util_fabric	*fabric;
 	struct util_eq		*eq;
 	struct fid_peer_srx	*srx;
+	struct util_srx_pool	*srx_pool;
 
 	struct ofi_genlock	lock;
 	ofi_atomic32_t		ref;
@@ -434,6 +437,11 @@ struct util_wait_fd {
 		struct ofi_pollfds	*pollfds;
 	};
 	uint64_t		change_index;
+
+	/* Adaptive polling before sleeping, see FI_WAIT_SPIN */
+	uint64_t		last_event;
+	uint64_t		event_gap;
+	bool			tpause;
 };
 
 typedef int (*ofi_wait_try_func)(void *arg);
@@ -497,7 +505,17 @@ struct util_cq_aux_entry {
 
 OFI_DECLARE_CIRQUE(struct fi_cq_tagged_entry, util_comp_cirq);
 
+struct util_cq_ring_comp {
+	struct fi_cq_tagged_entry	comp;
+	fi_addr_t			src;
+};
+
+OFI_DECLARE_ATOMIC_Q(struct util_cq_ring_comp, util_cq_ring);
+
 typedef void (*ofi_cq_progress_func)(struct util_cq *cq);
+/* Copies count entries from the head of cirq, none of which are aux */
+typedef void (*ofi_cq_read_batch_func)(struct util_cq *cq, void *buf,
+				       size_t count, fi_addr_t *src_addr);
 
 struct util_cq {
 	struct fid_cq		cq_fid;
@@ -525,6 +543,13 @@ struct util_cq {
 	fi_addr_t		*src;
 	struct slist		aux_queue;
 	fi_cq_read_func		read_entry;
+	ofi_cq_read_batch_func	read_batch;
+
+	/* Lock-free staging ring used with FI_THREAD_SAFE.  Writers post
+	 * successful completions here without taking cq_lock.  Entries are
+	 * moved into cirq, in ring order, by whoever next holds cq_lock.
+	 */
+	struct util_cq_ring	*ring;
 };
 
 int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
@@ -552,6 +577,43 @@ const char *ofi_cq_strerror(struct fid_cq *cq, int prov_errno,
 int ofi_cq_write_overflow(struct util_cq *cq, void *context, uint64_t flags,
 			  size_t len, void *buf, uint64_t data, uint64_t tag,
 			  fi_addr_t src);
+void ofi_cq_drain_ring(struct util_cq *cq);
+
+static inline bool ofi_cq_ring_isempty(struct util_cq *cq)
+{
+	return !cq->ring ||
+	       ofi_atomic_load_explicit64(&cq->ring->read_pos,
+					  memory_order_acquire) ==
+	       ofi_atomic_load_explicit64(&cq->ring->write_pos,
+					  memory_order_acquire);
+}
+
+static inline bool ofi_cq_isempty(struct util_cq *cq)
+{
+	return ofi_cirque_isempty(cq->cirq) && ofi_cq_ring_isempty(cq);
+}
+
+static inline int
+ofi_cq_write_ring(struct util_cq *cq, void *context, uint64_t flags,
+		  size_t len, void *buf, uint64_t data, uint64_t tag,
+		  fi_addr_t src)
+{
+	struct util_cq_ring_comp *entry;
+	int64_t pos;
+
+	if (util_cq_ring_next(cq->ring, &entry, &pos))
+		return -FI_EAGAIN;
+
+	entry->comp.op_context = context;
+	entry->comp.flags = flags;
+	entry->comp.len = len;
+	entry->comp.buf = buf;
+	entry->comp.data = data;
+	entry->comp.tag = tag;
+	entry->src = src;
+	util_cq_ring_commit(entry, pos);
+	return 0;
+}
 
 static inline
 ssize_t ofi_cq_read_entries(struct util_cq *cq, void *buf, size_t count,
@@ -562,6 +624,8 @@ ssize_t ofi_cq_read_entries(struct util_cq *cq, void *buf, size_t count,
 	ssize_t i;
 
 	ofi_genlock_lock(&cq->cq_lock);
+	if (cq->ring)
+		ofi_cq_drain_ring(cq);
 
 	if (cq->err_data) {
 		free(cq->err_data);
@@ -576,6 +640,13 @@ ssize_t ofi_cq_read_entries(struct util_cq *cq, void *buf, size_t count,
 	if (count > ofi_cirque_usedcnt(cq->cirq))
 		count = ofi_cirque_usedcnt(cq->cirq);
 
+	/* Without pending aux entries, nothing in the batch is special */
+	if (slist_empty(&cq->aux_queue)) {
+		cq->read_batch(cq, buf, count, src_addr);
+		i = count;
+		goto out;
+	}
+
 	for (i = 0; i < (ssize_t) count; i++) {
 		entry = ofi_cirque_head(cq->cirq);
 		if (!(entry->flags & UTIL_FLAG_AUX)) {
@@ -644,9 +715,18 @@ static inline int
 ofi_cq_write(struct util_cq *cq, void *context, uint64_t flags, size_t len,
 	     void *buf, uint64_t data, uint64_t tag)
 {
+	uint64_t start = ofi_hist_start();
 	int ret;
 
+	if (cq->ring && !ofi_cq_write_ring(cq, context, flags, len, buf,
+					   data, tag, FI_ADDR_NOTAVAIL)) {
+		ret = 0;
+		goto out;
+	}
+
 	ofi_genlock_lock(&cq->cq_lock);
+	if (cq->ring)
+		ofi_cq_drain_ring(cq);
 	if (ofi_cirque_freecnt(cq->cirq) > 1) {
 		ofi_cq_write_entry(cq, context, flags, len, buf, data, tag);
 		ret = 0;
@@ -655,6 +735,8 @@ ofi_cq_write(struct util_cq *cq, void *context, uint64_t flags, size_t len,
 					    buf, data, tag, FI_ADDR_NOTAVAIL);
 	}
 	ofi_genlock_unlock(&cq->cq_lock);
+out:
+	ofi_hist_end(OFI_HIST_CQ_WRITE, start);
 	return ret;
 }
 
@@ -662,9 +744,18 @@ static inline int
 ofi_cq_write_src(struct util_cq *cq, void *context, uint64_t flags, size_t len,
 		 void *buf, uint64_t data, uint64_t tag, fi_addr_t src)
 {
+	uint64_t start = ofi_hist_start();
 	int ret;
 
+	if (cq->ring && !ofi_cq_write_ring(cq, context, flags, len, buf,
+					   data, tag, src)) {
+		ret = 0;
+		goto out;
+	}
+
 	ofi_genlock_lock(&cq->cq_lock);
+	if (cq->ring)
+		ofi_cq_drain_ring(cq);
 	if (ofi_cirque_freecnt(cq->cirq) > 1) {
 		ofi_cq_write_src_entry(cq, context, flags, len, buf, data,
 				       tag, src);
@@ -674,6 +765,8 @@ ofi_cq_write_src(struct util_cq *cq, void *context, uint64_t flags, size_t len,
 					    buf, data, tag, src);
 	}
 	ofi_genlock_unlock(&cq->cq_lock);
+out:
+	ofi_hist_end(OFI_HIST_CQ_WRITE, start);
 	return ret;
 }
 
@@ -698,6 +791,28 @@ static inline int ofi_peer_cq_write_error(struct util_cq *cq,
 	return cq->peer_cq->owner_ops->writeerr(cq->peer_cq, err_entry);
 }
 
+/* Owners built against an older fi_peer.h may not support writev */
+static inline ssize_t
+ofi_peer_cq_writev(struct util_cq *cq, const struct fi_cq_tagged_entry *buf,
+		   size_t count, const fi_addr_t *src)
+{
+	struct fi_ops_cq_owner *ops = cq->peer_cq->owner_ops;
+	ssize_t ret = 0;
+	size_t i;
+
+	if (FI_CHECK_OP(ops, struct fi_ops_cq_owner, writev))
+		return ops->writev(cq->peer_cq, buf, count, src);
+
+	for (i = 0; i < count; i++) {
+		ret = ops->write(cq->peer_cq, buf[i].op_context, buf[i].flags,
+				 buf[i].len, buf[i].buf, buf[i].data,
+				 buf[i].tag, src ? src[i] : FI_ADDR_NOTAVAIL);
+		if (ret)
+			break;
+	}
+	return i ? (ssize_t) i : ret;
+}
+
 int ofi_peer_cq_write_error_peek(struct util_cq *cq, uint64_t tag,
 				 void *context);
 
@@ -730,6 +845,18 @@ static inline uint64_t ofi_tx_cq_flags(uint32_t op)
  */
 typedef void (*ofi_cntr_progress_func)(struct util_cntr *cntr);
 
+/*
+ * Batched counters (FI_CNTR_BATCH): successful completions are added to
+ * per-thread deltas rather than to cnt, and the wait object is signaled
+ * only when the value crosses the lowest threshold armed by a thread in
+ * fi_cntr_wait.  The counter value is cnt plus the sum of the deltas.
+ */
+#define OFI_CNTR_DELTA_CNT 16
+
+struct util_cntr_delta {
+	ofi_atomic64_t		cnt;
+} __attribute__((__aligned__(64)));
+
 struct util_cntr {
 	struct fid_cntr		cntr_fid;
 	struct util_domain	*domain;
@@ -750,6 +877,9 @@ struct util_cntr {
 
 	struct fid_peer_cntr	*peer_cntr;
 	uint64_t		flags;
+
+	struct util_cntr_delta	*deltas;
+	ofi_atomic64_t		threshold;
 };
 
 #define OFI_TIMEOUT_QUANTUM_MS 50
@@ -759,6 +889,8 @@ int ofi_cntr_init(const struct fi_provider *prov, struct fid_domain *domain,
 		  struct fi_cntr_attr *attr, struct util_cntr *cntr,
 		  ofi_cntr_progress_func progress, void *context);
 int ofi_cntr_cleanup(struct util_cntr *cntr);
+uint64_t ofi_cntr_value(struct util_cntr *cntr);
+void ofi_cntr_arm(struct util_cntr *cntr, uint64_t threshold);
 uint64_t ofi_cntr_read(struct fid_cntr *cntr_fid);
 uint64_t ofi_cntr_readerr(struct fid_cntr *cntr_fid);
 int ofi_cntr_add(struct fid_cntr *cntr_fid, uint64_t value);
@@ -839,6 +971,8 @@ struct util_av;
 struct util_av_set;
 struct util_peer_addr;
 
+struct util_coll_topo;
+
 struct util_coll_mc {
 	struct fid_mc		mc_fid;
 	struct util_av_set	*av_set;
@@ -846,6 +980,13 @@ struct util_coll_mc {
 	uint16_t		group_id;
 	uint16_t		seq;
 	ofi_atomic32_t		ref;
+	struct dlist_entry	persist_list;
+	size_t			persist_cnt;
+	struct ofi_bufpool	*work_pool;
+	struct util_coll_topo	*topo;
+	/* cost model, calibrated when joining the group */
+	double			latency;
+	double			bandwidth;
 };
 
 struct util_av_set {
@@ -882,6 +1023,11 @@ struct util_av {
 
 	struct util_av_entry	*hash;
 	struct ofi_bufpool	*av_entry_pool;
+	/* Address of each pool entry's data, indexed by fi_addr.  Costs one
+	 * pointer per pool slot, grown a pool region at a time.
+	 */
+	char			**addr_table;
+	size_t			addr_table_cnt;
 
 	struct util_av_set	*av_set;
 	void			*context;
@@ -984,6 +1130,13 @@ int ofi_av_bind(struct fid *av_fid, struct fid *eq_fid, uint64_t flags);
 void ofi_av_write_event(struct util_av *av, uint64_t data,
 			int err, void *context);
 
+int ofi_av_set_union(struct fid_av_set *dst, const struct fid_av_set *src);
+int ofi_av_set_intersect(struct fid_av_set *dst, const struct fid_av_set *src);
+int ofi_av_set_diff(struct fid_av_set *dst, const struct fid_av_set *src);
+int ofi_av_set_insert(struct fid_av_set *set, fi_addr_t addr);
+int ofi_av_set_remove(struct fid_av_set *set, fi_addr_t addr);
+int ofi_av_set_addr(struct fid_av_set *set, fi_addr_t *coll_addr);
+
 int ofi_ip_av_create(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 		     struct fid_av **av, void *context);
 
@@ -1258,11 +1411,14 @@ struct ofi_ops_flow_ctrl {
 			ssize_t (*send_handler)(struct fid_ep *ep, uint64_t credits));
 };
 
+struct util_mrecv_slab;
+
 struct util_rx_entry {
 	struct fi_peer_rx_entry	peer_entry;
 	uint64_t		seq_no;
 	uint64_t		ignore;
 	int			multi_recv_ref;
+	struct util_mrecv_slab	*slab;
 	/* extra memory allocated at the end of each entry to hold iovecs and
 	 * MR descriptors. The amount of memory is determined by the provider's
 	 * iov limit.
@@ -1271,6 +1427,19 @@ struct util_rx_entry {
 	 */
 };
 
+/* Multi-recv buffer split into fixed size slots when FI_SRX_MRECV_SLOT
+ * is set.  There is one pre-initialized entry per slot, so matching a
+ * message does not allocate.  Messages larger than a slot consume
+ * consecutive slots, reported through the entry of the first one.
+ */
+struct util_mrecv_slab {
+	char			*base;
+	size_t			slot_size;
+	size_t			slot_cnt;
+	size_t			stride;
+	char			entries[];
+};
+
 struct util_srx_ctx;
 
 typedef void(*ofi_update_func_t)(struct util_srx_ctx *srx,
@@ -1283,6 +1452,65 @@ struct util_unexp_peer {
 	int			cnt;
 };
 
+/*
+ * Tagged receives that have no ignore bits may be hashed by (source, tag)
+ * into buckets, so that matching an incoming message does not walk every
+ * posted receive.  The bucket count comes from FI_SRX_TAG_BUCKETS or the
+ * FI_OPT_TAG_BUCKETS endpoint option, and is rounded up to a power of
+ * two.  Receives using ignore bits stay on ordered wildcard lists.
+ */
+static inline size_t ofi_tag_bucket_mask(size_t bucket_cnt)
+{
+	return bucket_cnt ? roundup_power_of_two(bucket_cnt) - 1 : 0;
+}
+
+static inline size_t
+ofi_tag_bucket(size_t bucket_mask, fi_addr_t addr, uint64_t tag)
+{
+	uint64_t key;
+
+	key = tag ^ ((uint64_t) addr * 0x9e3779b97f4a7c15ULL);
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return key & bucket_mask;
+}
+
+/* Allocates bucket_cnt empty lists, rounded up to a power of two.  No
+ * lists are allocated if bucket_cnt is 0.
+ */
+static inline int ofi_tag_buckets_alloc(size_t bucket_cnt,
+					struct slist **buckets,
+					size_t *bucket_mask)
+{
+	size_t i;
+
+	*buckets = NULL;
+	*bucket_mask = 0;
+	if (!bucket_cnt)
+		return 0;
+
+	*bucket_mask = ofi_tag_bucket_mask(bucket_cnt);
+	*buckets = calloc(*bucket_mask + 1, sizeof(**buckets));
+	if (!*buckets)
+		return -FI_ENOMEM;
+
+	for (i = 0; i <= *bucket_mask; i++)
+		slist_init(&(*buckets)[i]);
+	return 0;
+}
+
+/*
+ * Receive entry pool shared by the util_srx contexts of a domain when
+ * FI_SRX_SHARED_POOL is set.  The pool is thread safe, so contexts
+ * protected by different locks may allocate from it concurrently.
+ */
+struct util_srx_pool {
+	struct ofi_bufpool	*rx_pool;
+	size_t			iov_limit;
+	int			ref;
+};
+
 struct util_srx_ctx {
 	struct fid_peer_srx	peer_srx;
 	bool			dir_recv;
@@ -1300,6 +1528,13 @@ struct util_srx_ctx {
 	struct ofi_dyn_arr	src_recv_queues;
 	struct ofi_dyn_arr	src_trecv_queues;
 
+	/* Optional hash of posted tagged receives with ignore == 0, keyed by
+	 * (addr, tag).  Wildcard receives stay on tag_queue/src_trecv_queues
+	 * and seq_no ordering is used to pick the oldest match.
+	 */
+	struct slist		*tag_buckets;
+	size_t			tag_bucket_mask;
+
 	struct dlist_entry	unspec_unexp_msg_queue;
 	struct dlist_entry	unspec_unexp_tag_queue;
 
@@ -1307,6 +1542,8 @@ struct util_srx_ctx {
 	struct ofi_dyn_arr	src_unexp_peers;
 
 	struct ofi_bufpool	*rx_pool;
+	struct util_srx_pool	*shared_pool;
+	struct util_domain	*domain;
 	struct ofi_genlock	*lock;
 };
 
@@ -1323,7 +1560,7 @@ static inline struct fid_peer_srx *util_get_peer_srx(struct fid_ep *rx_ep)
 
 int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 			size_t iov_limit, size_t default_min_mr,
-			ofi_update_func_t update_func,
+			size_t tag_buckets, ofi_update_func_t update_func,
 			struct ofi_genlock *lock, struct fid_ep **rx_ep);
 int util_srx_close(struct fid *fid);
 int util_srx_bind(struct fid *fid, struct fid *bfid, uint64_t flags);
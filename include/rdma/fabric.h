@@ -776,6 +776,8 @@ enum fi_type {
 char *fi_tostr(const void *data, enum fi_type datatype);
 char *fi_tostr_r(char *buf, size_t len, const void *data,
 		 enum fi_type datatype);
+char *fi_tostr_json_r(char *buf, size_t len, const void *data,
+		      enum fi_type datatype);
 
 enum fi_param_type {
 	FI_PARAM_STRING,
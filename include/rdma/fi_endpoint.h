@@ -70,6 +70,7 @@ enum {
 	FI_OPT_XPU_TRIGGER,		/* struct fi_trigger_xpu */
 	FI_OPT_CUDA_API_PERMITTED,	/* bool */
 	FI_OPT_SHARED_MEMORY_PERMITTED, /* bool */
+	FI_OPT_TAG_BUCKETS,		/* size_t */
 };
 
 /*
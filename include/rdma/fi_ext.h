@@ -37,6 +37,7 @@
 
 #include <stdbool.h>
 #include <rdma/fabric.h>
+#include <rdma/fi_collective.h>
 #include <rdma/fi_eq.h>
 #include <rdma/fi_endpoint.h>
 #include <rdma/providers/fi_prov.h>
@@ -65,6 +66,7 @@ extern "C" {
 
 #define FI_PROV_SPECIFIC_EFA   (0xefa << 16)
 #define FI_PROV_SPECIFIC_TCP   (0x7cb << 16)
+#define FI_PROV_SPECIFIC_VERBS (0x7eb << 16)
 
 
 /* negative options are provider specific */
@@ -78,6 +80,54 @@ enum {
 	FI_OPT_EFA_WRITE_IN_ORDER_ALIGNED_128_BYTES, /* bool */
 };
 
+enum {
+	FI_OPT_TCP_PRECONNECT = -FI_PROV_SPECIFIC_TCP, /* fi_addr_t[] */
+};
+
+/* fi_control commands */
+enum {
+	FI_VERBS_CQ_MODERATE = -FI_PROV_SPECIFIC_VERBS, /* struct fi_verbs_cq_moderate */
+};
+
+struct fi_verbs_cq_moderate {
+	uint16_t count;
+	uint16_t period;	/* usec */
+};
+
+#define FI_VERBS_DOMAIN_OPS "verbs domain ops"
+
+struct fi_verbs_ops_domain {
+	size_t	size;
+	int	(*alloc_dm)(struct fid_domain *domain, size_t len,
+			    uint64_t access, struct fid_mr **mr, void *context);
+	int	(*copy_to_dm)(struct fid_mr *mr, uint64_t offset,
+			      const void *buf, size_t len);
+	int	(*copy_from_dm)(struct fid_mr *mr, void *buf,
+				uint64_t offset, size_t len);
+};
+
+/*
+ * Cost model of the offloaded collectives of a multicast group, as used by
+ * the coll provider to pick an algorithm.  Open with fi_open_ops() on the
+ * fid of a group returned by fi_join_collective().  Times are estimates in
+ * microseconds, from a latency measured when joining the group.
+ */
+#define FI_COLL_MC_OPS "coll mc ops"
+
+struct fi_coll_cost {
+	const char	*algorithm;	/* algorithm that would be used */
+	double		time;		/* usec */
+	double		latency;	/* usec per message */
+	double		bandwidth;	/* bytes per usec */
+};
+
+struct fi_coll_ops_mc {
+	size_t	size;
+	int	(*query_cost)(struct fid_mc *mc, enum fi_collective_op coll,
+			      enum fi_datatype datatype, size_t count,
+			      struct fi_coll_cost *cost);
+};
+
 struct fi_fid_export {
 	struct fid **fid;
 	uint64_t flags;
@@ -184,6 +234,53 @@ static inline int fi_import_log(uint32_t version, uint64_t flags,
 			 log_fid);
 }
 
+
+/*
+ * Latency histogram extension:
+ * To use, set FI_PERF_HIST=1 and open the "perf_hist" fid with fi_open.
+ * All latencies are reported in nanoseconds.  Percentiles report the upper
+ * bound of the histogram bucket that contains the requested sample.
+ */
+
+struct fi_perf_hist_stat {
+	const char	*name;
+	uint64_t	count;
+	uint64_t	sum;
+	uint64_t	p50;
+	uint64_t	p90;
+	uint64_t	p99;
+	uint64_t	p999;
+	uint64_t	max;
+};
+
+struct fid_perf_hist;
+
+struct fi_ops_perf_hist {
+	size_t	size;
+	size_t	(*count)(struct fid_perf_hist *hist);
+	int	(*read)(struct fid_perf_hist *hist, size_t index,
+			struct fi_perf_hist_stat *stat);
+	void	(*reset)(struct fid_perf_hist *hist);
+};
+
+struct fid_perf_hist {
+	struct fid		fid;
+	struct fi_ops_perf_hist	*ops;
+};
+
+static inline int fi_open_perf_hist(uint32_t version, uint64_t flags,
+				    struct fid_perf_hist **hist_fid,
+				    void *context)
+{
+	struct fid *fid;
+	int ret;
+
+	ret = fi_open(version, "perf_hist", NULL, 0, flags, &fid, context);
+	if (!ret)
+		*hist_fid = container_of(fid, struct fid_perf_hist, fid);
+	return ret;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -305,6 +305,21 @@ ofi_cpuid(unsigned func, unsigned subfunc, unsigned cpuinfo[4])
 #define ofi_clflush(addr) \
 	asm volatile("clflush %0" : "+m" (*(volatile char *) addr))
 #define ofi_sfence() asm volatile("sfence" ::: "memory")
+#define ofi_pause() asm volatile("pause" ::: "memory")
+
+/* Requires WAITPKG.  Pause in the C0.1 state for the given TSC cycles */
+static inline void ofi_tpause(uint64_t cycles)
+{
+	uint32_t lo, hi;
+	uint64_t deadline;
+
+	asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	deadline = (((uint64_t) hi << 32) | lo) + cycles;
+	asm volatile(".byte 0x66, 0x0f, 0xae, 0xf1"
+		     :: "c" (1), "a" ((uint32_t) deadline),
+			"d" ((uint32_t) (deadline >> 32))
+		     : "cc", "memory");
+}
 
 #elif  (defined(__riscv) && \
 	defined(__riscv_xlen) && \
@@ -316,6 +331,8 @@ ofi_cpuid(unsigned func, unsigned subfunc, unsigned cpuinfo[4])
 #define ofi_clflushopt(addr)
 #define ofi_clflush(addr)
 #define ofi_sfence() asm volatile("fence w,w" ::: "memory")
+#define ofi_pause()
+#define ofi_tpause(cycles)
 
 #else /* defined(__x86_64__) || defined(__amd64__) || defined(__riscv) */
 
@@ -324,6 +341,8 @@ ofi_cpuid(unsigned func, unsigned subfunc, unsigned cpuinfo[4])
 #define ofi_clflushopt(addr)
 #define ofi_clflush(addr)
 #define ofi_sfence()
+#define ofi_pause()
+#define ofi_tpause(cycles)
 
 #endif /* defined(__x86_64__) || defined(__amd64__) */
 
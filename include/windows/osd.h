@@ -979,6 +979,34 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return -FI_ENOSYS;
 }
 
+struct fi_pci_attr;
+
+static inline int ofi_alloc_sized_hugepage_buf(void **memptr, size_t size,
+					       size_t page_size)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_numa_bind(void *addr, size_t size, int node)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_numa_node_self(void)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_pci_numa_node(const struct fi_pci_attr *pci)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_numa_distance(int from, int to)
+{
+	return -FI_ENOSYS;
+}
+
 static inline int ofi_hugepage_enabled(void)
 {
 	return 0;
@@ -1124,6 +1152,8 @@ ofi_cpuid(unsigned func, unsigned subfunc, unsigned cpuinfo[4])
 #define ofi_clflushopt(addr) do { _mm_clflush((void const *)addr); _mm_sfence(); } while (0)
 #define ofi_clflush(addr) _mm_clflush((void const *)addr)
 #define ofi_sfence() _mm_sfence()
+#define ofi_pause() _mm_pause()
+#define ofi_tpause(cycles) _mm_pause()
 
 #else /* defined(_M_X64) || defined(_M_AMD64) */
 
@@ -1132,6 +1162,8 @@ ofi_cpuid(unsigned func, unsigned subfunc, unsigned cpuinfo[4])
 #define ofi_clflushopt(addr)
 #define ofi_clflush(addr)
 #define ofi_sfence()
+#define ofi_pause()
+#define ofi_tpause(cycles)
 
 #endif /* defined(_M_X64) || defined(_M_AMD64) */
 
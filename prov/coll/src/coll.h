@@ -150,6 +150,9 @@ int coll_join_collective(struct fid_ep *ep, const void *addr,
 
 void coll_ep_progress(struct util_ep *util_ep);
 
+int coll_mc_init_sched(struct util_coll_mc *coll_mc);
+void coll_mc_free_sched(struct util_coll_mc *coll_mc);
+
 ssize_t coll_ep_barrier(struct fid_ep *ep, fi_addr_t coll_addr, void *context);
 
 ssize_t coll_ep_barrier2(struct fid_ep *ep, fi_addr_t coll_addr, uint64_t flags,
@@ -171,6 +174,29 @@ ssize_t coll_ep_scatter(struct fid_ep *ep, const void *buf, size_t count,
 			enum fi_datatype datatype, uint64_t flags,
 		        void *context);
 
+ssize_t coll_ep_alltoall(struct fid_ep *ep, const void *buf, size_t count,
+			 void *desc, void *result, void *result_desc,
+			 fi_addr_t coll_addr, enum fi_datatype datatype,
+			 uint64_t flags, void *context);
+
+ssize_t coll_ep_reduce_scatter(struct fid_ep *ep, const void *buf,
+			       size_t count, void *desc, void *result,
+			       void *result_desc, fi_addr_t coll_addr,
+			       enum fi_datatype datatype, enum fi_op op,
+			       uint64_t flags, void *context);
+
+ssize_t coll_ep_reduce(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, enum fi_op op,
+		       uint64_t flags, void *context);
+
+ssize_t coll_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, uint64_t flags,
+		       void *context);
+
 ssize_t coll_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 			  void *desc, fi_addr_t coll_addr, fi_addr_t root_addr,
 			  enum fi_datatype datatype, uint64_t flags,
@@ -32,155 +32,13 @@
 
 #include "coll.h"
 
-static int
-coll_av_set_union(struct fid_av_set *dst, const struct fid_av_set *src)
-{
-	struct util_av_set *src_av_set;
-	struct util_av_set *dst_av_set;
-	int i,j;
-
-	src_av_set = container_of(src, struct util_av_set, av_set_fid);
-	dst_av_set = container_of(dst, struct util_av_set, av_set_fid);
-
-	assert(src_av_set->av == dst_av_set->av);
-
-	for (i = 0; i < src_av_set->fi_addr_count; i++) {
-		for (j = 0; j < dst_av_set->fi_addr_count; j++) {
-			if (dst_av_set->fi_addr_array[j] ==
-			    src_av_set->fi_addr_array[i])
-				break;
-		}
-		if (j == dst_av_set->fi_addr_count) {
-			if (dst_av_set->fi_addr_count >=
-			    dst_av_set->max_array_size) {
-				FI_INFO(dst_av_set->av->prov, FI_LOG_AV,
-					"destination AV is full\n");
-				return -FI_ENOMEM;
-			}
-
-			dst_av_set->fi_addr_array[dst_av_set->fi_addr_count++] =
-						src_av_set->fi_addr_array[i];
-			FI_DBG(dst_av_set->av->prov, FI_LOG_AV,
-				"Adding fi_addr: %" PRIu64 "\n",
-				src_av_set->fi_addr_array[i]);
-		}
-	}
-	return FI_SUCCESS;
-}
-
-static int
-coll_av_set_intersect(struct fid_av_set *dst, const struct fid_av_set *src)
-{
-	struct util_av_set *src_av_set;
-	struct util_av_set *dst_av_set;
-	int i,j, temp;
-
-	src_av_set = container_of(src, struct util_av_set, av_set_fid);
-	dst_av_set = container_of(dst, struct util_av_set, av_set_fid);
-
-	assert(src_av_set->av == dst_av_set->av);
-
-	temp = 0;
-	for (i = 0; i < src_av_set->fi_addr_count; i++) {
-		for (j = temp; j < dst_av_set->fi_addr_count; j++) {
-			if (dst_av_set->fi_addr_array[j] ==
-			    src_av_set->fi_addr_array[i]) {
-				dst_av_set->fi_addr_array[temp++] =
-					dst_av_set->fi_addr_array[j];
-				break;
-			}
-		}
-	}
-	dst_av_set->fi_addr_count = temp;
-	return FI_SUCCESS;
-}
-
-static int
-coll_av_set_diff(struct fid_av_set *dst, const struct fid_av_set *src)
-{
-
-	struct util_av_set *src_av_set;
-	struct util_av_set *dst_av_set;
-	int i,j;
-	size_t temp;
-
-	src_av_set = container_of(src, struct util_av_set, av_set_fid);
-	dst_av_set = container_of(dst, struct util_av_set, av_set_fid);
-
-	assert(src_av_set->av == dst_av_set->av);
-
-	temp = dst_av_set->fi_addr_count;
-	for (i = 0; i < src_av_set->fi_addr_count; i++) {
-		for (j = 0; j < temp; j++) {
-			if (dst_av_set->fi_addr_array[j] ==
-			    src_av_set->fi_addr_array[i]) {
-				dst_av_set->fi_addr_array[--temp] =
-					dst_av_set->fi_addr_array[j];
-				break;
-			}
-		}
-	}
-	dst_av_set->fi_addr_count = temp;
-	return FI_SUCCESS;
-}
-
-static int coll_av_set_insert(struct fid_av_set *set, fi_addr_t addr)
-{
-	struct util_av_set *av_set;
-	int i;
-
-	av_set = container_of(set, struct util_av_set, av_set_fid);
-	if (av_set->fi_addr_count >= av_set->max_array_size)  {
-		FI_INFO(av_set->av->prov, FI_LOG_AV, "AV set full\n");
-		return -FI_ENOMEM;
-	}
-
-	for (i = 0; i < av_set->fi_addr_count; i++) {
-		if (av_set->fi_addr_array[i] == addr)
-			return -FI_EINVAL;
-	}
-
-	av_set->fi_addr_array[av_set->fi_addr_count++] = addr;
-	FI_DBG(av_set->av->prov, FI_LOG_AV,
-		"fi_addr: %" PRIu64 "\n", addr);
-	return FI_SUCCESS;
-}
-
-static int coll_av_set_remove(struct fid_av_set *set, fi_addr_t addr)
-{
-	struct util_av_set *av_set;
-	int i;
-
-	av_set = container_of(set, struct util_av_set, av_set_fid);
-
-	for (i = 0; i < av_set->fi_addr_count; i++) {
-		if (av_set->fi_addr_array[i] == addr) {
-			av_set->fi_addr_array[i] =
-				av_set->fi_addr_array[--av_set->fi_addr_count];
-			return FI_SUCCESS;
-		}
-	}
-	return -FI_EINVAL;
-}
-
-static int coll_av_set_addr(struct fid_av_set *set, fi_addr_t *coll_addr)
-{
-	struct util_av_set *av_set;
-
-	av_set = container_of(set, struct util_av_set, av_set_fid);
-
-	*coll_addr = (uintptr_t) &av_set->coll_mc;
-
-	return FI_SUCCESS;
-}
-
 static struct fi_ops_av_set coll_av_set_ops = {
-	.set_union	= coll_av_set_union,
-	.intersect	= coll_av_set_intersect,
-	.diff		= coll_av_set_diff,
-	.insert		= coll_av_set_insert,
-	.remove		= coll_av_set_remove,
-	.addr		= coll_av_set_addr,
+	.set_union	= ofi_av_set_union,
+	.intersect	= ofi_av_set_intersect,
+	.diff		= ofi_av_set_diff,
+	.insert		= ofi_av_set_insert,
+	.remove		= ofi_av_set_remove,
+	.addr		= ofi_av_set_addr,
 };
 
 static int coll_av_set_close(struct fid *fid)
@@ -191,6 +49,7 @@ static int coll_av_set_close(struct fid *fid)
 	if (ofi_atomic_get32(&av_set->ref) > 0)
 		return -FI_EBUSY;
 
+	coll_mc_free_sched(&av_set->coll_mc);
 	ofi_atomic_dec32(&av_set->av->ref);
 	free(av_set->fi_addr_array);
 	free(av_set);
@@ -244,6 +103,8 @@ int coll_av_set(struct fid_av *av_fid, struct fi_av_set_attr *attr,
 
 	ofi_atomic_initialize32(&av_set->ref, 0);
 	av_set->coll_mc.av_set = av_set;
+	if (coll_mc_init_sched(&av_set->coll_mc))
+		goto err3;
 	av_set->av_set_fid.ops = &coll_av_set_ops;
 	av_set->av_set_fid.fid.fclass = FI_CLASS_AV_SET;
 	av_set->av_set_fid.fid.context = context;
@@ -33,6 +33,23 @@
 #include "coll.h"
 #include "ofi_coll.h"
 
+/* Schedules kept for reuse per multicast group */
+#define COLL_PERSIST_MAX 8
+
+/* Allreduces below this size in bytes may funnel through node leaders */
+#define COLL_ALLREDUCE_SHORT_MSG	2048
+
+/* Segment size of pipelined broadcasts, in bytes */
+#define COLL_BCAST_SEGMENT		(32 * 1024)
+
+/*
+ * Cost model defaults, used until a group is calibrated: latency in usec,
+ * and bandwidth and local reduction rate in bytes per usec.
+ */
+#define COLL_COST_LATENCY		2.0
+#define COLL_COST_BANDWIDTH		12500.0
+#define COLL_COST_REDUCE_RATE		4000.0
+
 static uint64_t coll_form_tag(uint32_t coll_id, uint32_t rank)
 {
 	uint64_t tag;
@@ -44,6 +61,16 @@ static uint64_t coll_form_tag(uint32_t coll_id, uint32_t rank)
 	return tag;
 }
 
+/* Transfers are tagged with the id of the operation and the sending rank */
+static uint64_t coll_xfer_tag(struct util_coll_xfer_item *item)
+{
+	struct util_coll_operation *coll_op = item->hdr.coll_op;
+
+	return coll_form_tag(coll_op->cid, item->hdr.type == UTIL_COLL_SEND ?
+			     (uint32_t) coll_op->mc->local_rank :
+			     (uint32_t) item->remote_rank);
+}
+
 static uint32_t coll_get_next_id(struct util_coll_mc *coll_mc)
 {
 	uint32_t cid = coll_mc->group_id;
@@ -68,26 +95,201 @@ coll_create_op(struct fid_ep *ep, struct util_coll_mc *coll_mc,
 	coll_op->flags = flags;
 	coll_op->context = context;
 	coll_op->comp_fn = comp_fn;
-	dlist_init(&coll_op->work_queue);
+	coll_op->active = true;
+	dlist_init(&coll_op->sched_list);
+	coll_op->release_pos = &coll_op->sched_list;
+	dlist_init(&coll_op->persist_entry);
 
 	return coll_op;
 }
 
+static void coll_free_op_data(struct util_coll_operation *coll_op)
+{
+	switch (coll_op->type) {
+	case UTIL_COLL_ALLREDUCE_OP:
+		free(coll_op->data.allreduce.data);
+		break;
+
+	case UTIL_COLL_SCATTER_OP:
+		free(coll_op->data.scatter);
+		break;
+
+	case UTIL_COLL_BROADCAST_OP:
+		free(coll_op->data.broadcast.chunk);
+		free(coll_op->data.broadcast.scatter);
+		break;
+
+	case UTIL_COLL_TOPO_OP:
+		free(coll_op->data.topo.host_ids);
+		break;
+
+	case UTIL_COLL_ALLTOALL_OP:
+	case UTIL_COLL_REDUCE_SCATTER_OP:
+	case UTIL_COLL_REDUCE_OP:
+	case UTIL_COLL_GATHER_OP:
+		free(coll_op->data.scratch);
+		break;
+
+	case UTIL_COLL_JOIN_OP:
+	case UTIL_COLL_BARRIER_OP:
+	case UTIL_COLL_ALLGATHER_OP:
+	default:
+		/* nothing to clean up */
+		break;
+	}
+}
+
+/* Work items of every type are carved from the pool of their group */
+union coll_work_buf {
+	struct util_coll_work_item	hdr;
+	struct util_coll_xfer_item	xfer;
+	struct util_coll_copy_item	copy;
+	struct util_coll_reduce_item	reduce;
+};
+
+static void *coll_alloc_work(struct util_coll_operation *coll_op, size_t size)
+{
+	void *item;
+
+	assert(size <= sizeof(union coll_work_buf));
+	item = ofi_buf_alloc(coll_op->mc->work_pool);
+	if (item)
+		memset(item, 0, size);
+	return item;
+}
+
+/* Releases the schedule and the operation, without its data */
+static void coll_free_op(struct util_coll_operation *coll_op)
+{
+	struct util_coll_work_item *item;
+
+	while (!dlist_empty(&coll_op->sched_list)) {
+		dlist_pop_front(&coll_op->sched_list, struct util_coll_work_item,
+				item, sched_entry);
+		ofi_buf_free(item);
+	}
+	free(coll_op);
+}
+
+static void coll_free_persist_op(struct util_coll_operation *coll_op)
+{
+	assert(!coll_op->active);
+	dlist_remove(&coll_op->persist_entry);
+	coll_op->mc->persist_cnt--;
+
+	coll_free_op_data(coll_op);
+	coll_free_op(coll_op);
+}
+
+int coll_mc_init_sched(struct util_coll_mc *coll_mc)
+{
+	dlist_init(&coll_mc->persist_list);
+	coll_mc->persist_cnt = 0;
+	coll_mc->latency = COLL_COST_LATENCY;
+	coll_mc->bandwidth = COLL_COST_BANDWIDTH;
+
+	return ofi_bufpool_create(&coll_mc->work_pool,
+				  sizeof(union coll_work_buf), 0, 0, 64, 0);
+}
+
+void coll_mc_free_sched(struct util_coll_mc *coll_mc)
+{
+	struct util_coll_operation *coll_op;
+
+	while (!dlist_empty(&coll_mc->persist_list)) {
+		coll_op = container_of(coll_mc->persist_list.next,
+				       struct util_coll_operation,
+				       persist_entry);
+		coll_free_persist_op(coll_op);
+	}
+
+	if (coll_mc->work_pool)
+		ofi_bufpool_destroy(coll_mc->work_pool);
+	free(coll_mc->topo);
+}
+
+static bool coll_key_match(const struct util_coll_key *a,
+			   const struct util_coll_key *b)
+{
+	return a->ep == b->ep && a->type == b->type && a->buf == b->buf &&
+	       a->result == b->result && a->count == b->count &&
+	       a->datatype == b->datatype && a->op == b->op &&
+	       a->root == b->root;
+}
+
+/* Keep a newly scheduled operation for reuse, replacing the least recently
+ * used idle schedule once the group holds COLL_PERSIST_MAX of them.
+ */
+static void coll_persist_op(struct util_coll_operation *coll_op,
+			    const struct util_coll_key *key)
+{
+	struct util_coll_mc *coll_mc = coll_op->mc;
+	struct util_coll_operation *victim = NULL, *cur;
+
+	if (coll_mc->persist_cnt >= COLL_PERSIST_MAX) {
+		dlist_foreach_container_reverse(&coll_mc->persist_list,
+						struct util_coll_operation,
+						cur, persist_entry) {
+			if (!cur->active) {
+				victim = cur;
+				break;
+			}
+		}
+		if (!victim)
+			return;
+		coll_free_persist_op(victim);
+	}
+
+	coll_op->key = *key;
+	coll_op->persistent = true;
+	dlist_insert_head(&coll_op->persist_entry, &coll_mc->persist_list);
+	coll_mc->persist_cnt++;
+}
+
+/*
+ * Rearm an idle persistent schedule under a new id.  Tags derive from the
+ * id when transfers are posted, so the items themselves are left as is.
+ */
+static void coll_restart_op(struct util_coll_operation *coll_op,
+			    uint64_t flags, void *context)
+{
+	coll_op->cid = coll_get_next_id(coll_op->mc);
+	coll_op->flags = flags;
+	coll_op->context = context;
+	coll_op->active = true;
+
+	if (coll_op->init_size)
+		memcpy(coll_op->init_dst, coll_op->init_src,
+		       coll_op->init_size);
+
+	dlist_remove(&coll_op->persist_entry);
+	dlist_insert_head(&coll_op->persist_entry,
+			  &coll_op->mc->persist_list);
+}
+
 static void coll_log_work(struct util_coll_operation *coll_op)
 {
 #if ENABLE_DEBUG
 	struct util_coll_work_item *cur_item = NULL;
 	struct util_coll_xfer_item *xfer_item;
-	struct dlist_entry *tmp = NULL;
+	enum coll_state state;
+	bool released = true;
 	size_t count = 0;
 
 	FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
 	       "Remaining Work for %s:\n",
 	       log_util_coll_op_type[coll_op->type]);
-	dlist_foreach_container_safe(&coll_op->work_queue,
-				     struct util_coll_work_item,
-				     cur_item, waiting_entry, tmp)
+	dlist_foreach_container(&coll_op->sched_list,
+				struct util_coll_work_item,
+				cur_item, sched_entry)
 	{
+		/* items not released yet keep their state of the last run */
+		if (&cur_item->sched_entry == coll_op->release_pos)
+			released = false;
+		state = released ? cur_item->state : UTIL_COLL_WAITING;
+		if (state == UTIL_COLL_COMPLETE)
+			continue;
+
 		switch (cur_item->type) {
 		case UTIL_COLL_SEND:
 			xfer_item = container_of(cur_item,
@@ -97,11 +299,11 @@ static void coll_log_work(struct util_coll_operation *coll_op)
 			       "\t%ld: { %p [%s] SEND TO: 0x%02x FROM: 0x%02lx "
 			       "cnt: %d typesize: %ld tag: 0x%02lx }\n",
 			       count, cur_item,
-			       log_util_coll_state[cur_item->state],
+			       log_util_coll_state[state],
 			       xfer_item->remote_rank, coll_op->mc->local_rank,
 			       xfer_item->count,
 			       ofi_datatype_size(xfer_item->datatype),
-			       xfer_item->tag);
+			       coll_xfer_tag(xfer_item));
 			break;
 
 		case UTIL_COLL_RECV:
@@ -112,36 +314,36 @@ static void coll_log_work(struct util_coll_operation *coll_op)
 			       "\t%ld: { %p [%s] RECV FROM: 0x%02x TO: 0x%02lx "
 			       "cnt: %d typesize: %ld tag: 0x%02lx }\n",
 			       count, cur_item,
-			       log_util_coll_state[cur_item->state],
+			       log_util_coll_state[state],
 			       xfer_item->remote_rank, coll_op->mc->local_rank,
 			       xfer_item->count,
 			       ofi_datatype_size(xfer_item->datatype),
-			       xfer_item->tag);
+			       coll_xfer_tag(xfer_item));
 			break;
 
 		case UTIL_COLL_REDUCE:
 			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
 			       "\t%ld: { %p [%s] REDUCTION }\n",
 			       count, cur_item,
-			       log_util_coll_state[cur_item->state]);
+			       log_util_coll_state[state]);
 			break;
 
 		case UTIL_COLL_COPY:
 			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
 			       "\t%ld: { %p [%s] COPY }\n", count, cur_item,
-			       log_util_coll_state[cur_item->state]);
+			       log_util_coll_state[state]);
 			break;
 
 		case UTIL_COLL_COMP:
 			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
 			       "\t%ld: { %p [%s] COMPLETION }\n", count, cur_item,
-			       log_util_coll_state[cur_item->state]);
+			       log_util_coll_state[state]);
 			break;
 
 		default:
 			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
 			       "\t%ld: { %p [%s] UNKNOWN }\n", count, cur_item,
-			       log_util_coll_state[cur_item->state]);
+			       log_util_coll_state[state]);
 			break;
 		}
 		count++;
@@ -149,87 +351,100 @@ static void coll_log_work(struct util_coll_operation *coll_op)
 #endif
 }
 
-static void coll_progress_work(struct util_ep *util_ep,
-		   	       struct util_coll_operation *coll_op)
+/*
+ * Queue the next epoch of the schedule: every item up to and including the
+ * next fenced item.  An epoch is released once every item of the previous
+ * one has completed, so completions only count down pending instead of
+ * scanning the schedule.
+ */
+static void coll_release_work(struct util_ep *util_ep,
+			      struct util_coll_operation *coll_op)
 {
-	struct util_coll_work_item *next_ready = NULL;
-	struct util_coll_work_item *cur_item = NULL;
-	struct util_coll_work_item *prev_item = NULL;
-	struct dlist_entry *tmp = NULL;
-	int previous_is_head;
-
-	/* clean up any completed items while searching for the next ready */
-	dlist_foreach_container_safe(&coll_op->work_queue,
-				     struct util_coll_work_item,
-				     cur_item, waiting_entry, tmp) {
-
-		previous_is_head = (cur_item->waiting_entry.prev ==
-				    &cur_item->coll_op->work_queue);
-		if (!previous_is_head) {
-			prev_item = container_of(cur_item->waiting_entry.prev,
-						 struct util_coll_work_item,
-						 waiting_entry);
-		}
-
-		if (cur_item->state == UTIL_COLL_COMPLETE) {
-			/*
-			 * If there is work before cur and cur is fencing,
-			 * we can't complete.
-			 */
-			if (cur_item->fence && !previous_is_head)
-				continue;
+	struct util_coll_work_item *item;
 
-			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
-			       "Removing Completed Work item: %p \n", cur_item);
-			dlist_remove(&cur_item->waiting_entry);
-			free(cur_item);
-
-			/* if the work queue is empty, we're done */
-			if (dlist_empty(&coll_op->work_queue)) {
-				free(coll_op);
-				return;
-			}
-			continue;
-		}
+	assert(!coll_op->pending);
+	while (coll_op->release_pos != &coll_op->sched_list) {
+		item = container_of(coll_op->release_pos,
+				    struct util_coll_work_item, sched_entry);
 
-		/* we can't progress if prior work is fencing */
-		if (!previous_is_head && prev_item && prev_item->fence) {
-			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
-			       "%p fenced by: %p \n", cur_item, prev_item);
-			return;
-		}
+		/* the completion is only reported once all work is done */
+		if (item->type == UTIL_COLL_COMP && coll_op->pending)
+			break;
 
-		/*
-		 * If the current item isn't waiting, it's not the next
-		 * ready item.
-		 */
-		if (cur_item->state != UTIL_COLL_WAITING) {
-			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
-			       "Work item not waiting: %p [%s]\n", cur_item,
-			       log_util_coll_state[cur_item->state]);
-			continue;
-		}
+		coll_op->release_pos = item->sched_entry.next;
 
 		FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
-		       "Ready item: %p \n", cur_item);
-		next_ready = cur_item;
-		break;
+		       "Ready item: %p \n", item);
+		item->state = UTIL_COLL_PROCESSING;
+		slist_insert_tail(&item->ready_entry,
+				  &util_ep->coll_ready_queue);
+		coll_op->pending++;
+		if (item->fence)
+			break;
+	}
+
+	if (coll_op->pending) {
+		coll_log_work(coll_op);
+		return;
 	}
 
-	if (!next_ready)
+	/* the whole schedule has completed */
+	if (coll_op->persistent)
+		coll_op->active = false;
+	else
+		coll_free_op(coll_op);
+}
+
+static void coll_start_work(struct util_ep *util_ep,
+			    struct util_coll_operation *coll_op)
+{
+	coll_op->release_pos = coll_op->sched_list.next;
+	coll_op->pending = 0;
+	coll_release_work(util_ep, coll_op);
+}
+
+/*
+ * Time the steps of the allgather of a group being joined.  Only the first
+ * step can wait on ranks that join late, so the shortest one measures the
+ * latency of a message.  Its value seeds the allreduce that follows, which
+ * agrees on the lowest one in the group.
+ */
+static void coll_topo_sample(struct util_coll_operation *coll_op)
+{
+	struct topo_data *topo = &coll_op->data.topo;
+	uint64_t now;
+
+	if (topo->step_cnt == coll_op->mc->av_set->fi_addr_count - 1)
 		return;
 
-	coll_log_work(coll_op);
+	now = ofi_gettime_ns();
+	topo->step_min = MIN(topo->step_min, now - topo->step_start);
+	topo->step_start = now;
+	if (++topo->step_cnt == coll_op->mc->av_set->fi_addr_count - 1)
+		topo->cost[0] = MAX(topo->step_min, 1);
+}
+
+/* The operation may be freed once its last item completes */
+static void coll_complete_work(struct util_ep *util_ep,
+			       struct util_coll_work_item *item)
+{
+	struct util_coll_operation *coll_op = item->coll_op;
 
-	next_ready->state = UTIL_COLL_PROCESSING;
-	slist_insert_tail(&next_ready->ready_entry, &util_ep->coll_ready_queue);
+	FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
+	       "Completed Work item: %p \n", item);
+	item->state = UTIL_COLL_COMPLETE;
+	if (coll_op->type == UTIL_COLL_TOPO_OP && item->type == UTIL_COLL_RECV)
+		coll_topo_sample(coll_op);
+	assert(coll_op->pending);
+	if (!--coll_op->pending)
+		coll_release_work(util_ep, coll_op);
 }
 
 static void coll_bind_work(struct util_coll_operation *coll_op,
 			   struct util_coll_work_item *item)
 {
 	item->coll_op = coll_op;
-	dlist_insert_tail(&item->waiting_entry, &coll_op->work_queue);
+	dlist_insert_tail(&item->sched_entry, &coll_op->sched_list);
 }
 
 static int coll_sched_send(struct util_coll_operation *coll_op,
@@ -238,15 +453,13 @@ static int coll_sched_send(struct util_coll_operation *coll_op,
 {
 	struct util_coll_xfer_item *xfer_item;
 
-	xfer_item = calloc(1, sizeof(*xfer_item));
+	xfer_item = coll_alloc_work(coll_op, sizeof(*xfer_item));
 	if (!xfer_item)
 		return -FI_ENOMEM;
 
 	xfer_item->hdr.type = UTIL_COLL_SEND;
 	xfer_item->hdr.state = UTIL_COLL_WAITING;
 	xfer_item->hdr.fence = fence;
-	xfer_item->tag = coll_form_tag(coll_op->cid,
-				       (uint32_t) coll_op->mc->local_rank);
 	xfer_item->buf = buf;
 	xfer_item->count = (int) count;
 	xfer_item->datatype = datatype;
@@ -262,14 +475,13 @@ static int coll_sched_recv(struct util_coll_operation *coll_op,
 {
 	struct util_coll_xfer_item *xfer_item;
 
-	xfer_item = calloc(1, sizeof(*xfer_item));
+	xfer_item = coll_alloc_work(coll_op, sizeof(*xfer_item));
 	if (!xfer_item)
 		return -FI_ENOMEM;
 
 	xfer_item->hdr.type = UTIL_COLL_RECV;
 	xfer_item->hdr.state = UTIL_COLL_WAITING;
 	xfer_item->hdr.fence = fence;
-	xfer_item->tag = coll_form_tag(coll_op->cid, (uint32_t) src);
 	xfer_item->buf = buf;
 	xfer_item->count = (int) count;
 	xfer_item->datatype = datatype;
@@ -286,7 +498,7 @@ static int coll_sched_reduce(struct util_coll_operation *coll_op,
 {
 	struct util_coll_reduce_item *reduce_item;
 
-	reduce_item = calloc(1, sizeof(*reduce_item));
+	reduce_item = coll_alloc_work(coll_op, sizeof(*reduce_item));
 	if (!reduce_item)
 		return -FI_ENOMEM;
 
@@ -309,7 +521,7 @@ static int coll_sched_copy(struct util_coll_operation *coll_op,
 {
 	struct util_coll_copy_item *copy_item;
 
-	copy_item = calloc(1, sizeof(*copy_item));
+	copy_item = coll_alloc_work(coll_op, sizeof(*copy_item));
 	if (!copy_item)
 		return -FI_ENOMEM;
 
@@ -329,7 +541,7 @@ static int coll_sched_comp(struct util_coll_operation *coll_op)
 {
 	struct util_coll_work_item *comp_item;
 
-	comp_item = calloc(1, sizeof(*comp_item));
+	comp_item = coll_alloc_work(coll_op, sizeof(*comp_item));
 	if (!comp_item)
 		return -FI_ENOMEM;
 
@@ -341,37 +553,64 @@ static int coll_sched_comp(struct util_coll_operation *coll_op)
 	return FI_SUCCESS;
 }
 
+/* Restarts a persistent schedule matching key, if one is idle */
+static bool coll_resume_op(struct fid_ep *ep, struct util_coll_mc *coll_mc,
+			   const struct util_coll_key *key, uint64_t flags,
+			   void *context)
+{
+	struct util_coll_operation *coll_op;
+
+	dlist_foreach_container(&coll_mc->persist_list,
+				struct util_coll_operation, coll_op,
+				persist_entry) {
+		if (coll_op->active || !coll_key_match(&coll_op->key, key))
+			continue;
+
+		coll_restart_op(coll_op, flags, context);
+		coll_start_work(container_of(ep, struct util_ep, ep_fid),
+				coll_op);
+		return true;
+	}
+	return false;
+}
+
+/* Allreduce implemented using recursive doubling algorithm */
+/* Rank of the group at index i of ranks, or i itself without a list */
+static inline uint64_t coll_rank(const uint64_t *ranks, uint64_t i)
+{
+	return ranks ? ranks[i] : i;
+}
+
 /*
- * TODO:
- * when this fails, clean up the already scheduled work in this function
+ * Recursive doubling among numranks ranks of the group, listed by ranks,
+ * local being the index of the caller in that list.
  */
-static int coll_do_allreduce(struct util_coll_operation *coll_op,
-			     const void *send_buf, void *result,
-			     void* tmp_buf, uint64_t count,
-			     enum fi_datatype datatype, enum fi_op op)
+static int coll_do_allreduce_rdouble(struct util_coll_operation *coll_op,
+				     const uint64_t *ranks, uint64_t numranks,
+				     uint64_t local, void *result,
+				     void *tmp_buf, uint64_t count,
+				     enum fi_datatype datatype, enum fi_op op)
 {
 	uint64_t rem, pof2, my_new_id;
-	uint64_t local, remote, next_remote;
+	uint64_t remote, next_remote;
 	int ret;
 	uint64_t mask = 1;
 
-	pof2 = rounddown_power_of_two(coll_op->mc->av_set->fi_addr_count);
-	rem = coll_op->mc->av_set->fi_addr_count - pof2;
-	local = coll_op->mc->local_rank;
-
-	/* copy initial send data to result */
-	memcpy(result, send_buf, count * ofi_datatype_size(datatype));
+	pof2 = rounddown_power_of_two(numranks);
+	rem = numranks - pof2;
 
 	if (local < 2 * rem) {
 		if (local % 2 == 0) {
-			ret = coll_sched_send(coll_op, local + 1, result,
-					      count, datatype, 1);
+			ret = coll_sched_send(coll_op,
+					      coll_rank(ranks, local + 1),
+					      result, count, datatype, 1);
 			if (ret)
 				return ret;
 
 			my_new_id = (uint64_t)-1;
 		} else {
-			ret = coll_sched_recv(coll_op, local - 1,
+			ret = coll_sched_recv(coll_op,
+					      coll_rank(ranks, local - 1),
 					      tmp_buf, count, datatype, 1);
 			if (ret)
 				return ret;
@@ -394,14 +633,14 @@ static int coll_do_allreduce(struct util_coll_operation *coll_op,
 				next_remote + rem;
 
 			/* receive remote data into tmp buf */
-			ret = coll_sched_recv(coll_op, remote, tmp_buf,
-					      count, datatype, 0);
+			ret = coll_sched_recv(coll_op, coll_rank(ranks, remote),
+					      tmp_buf, count, datatype, 0);
 			if (ret)
 				return ret;
 
 			/* send result buf, which has the current total */
-			ret = coll_sched_send(coll_op, remote, result,
-					      count, datatype, 1);
+			ret = coll_sched_send(coll_op, coll_rank(ranks, remote),
+					      result, count, datatype, 1);
 			if (ret)
 				return ret;
 
@@ -433,13 +672,15 @@ static int coll_do_allreduce(struct util_coll_operation *coll_op,
 
 	if (local < 2 * rem) {
 		if (local % 2) {
-			ret = coll_sched_send(coll_op, local - 1, result,
-					      count, datatype, 1);
+			ret = coll_sched_send(coll_op,
+					      coll_rank(ranks, local - 1),
+					      result, count, datatype, 1);
 			if (ret)
 				return ret;
 		} else {
-			ret = coll_sched_recv(coll_op, local + 1, result,
-					      count, datatype, 1);
+			ret = coll_sched_recv(coll_op,
+					      coll_rank(ranks, local + 1),
+					      result, count, datatype, 1);
 			if (ret)
 				return ret;
 		}
@@ -447,275 +688,1374 @@ static int coll_do_allreduce(struct util_coll_operation *coll_op,
 	return FI_SUCCESS;
 }
 
-/* allgather implemented using ring algorithm */
-static int coll_do_allgather(struct util_coll_operation *coll_op,
-			     const void *send_buf, void *result, size_t count,
-			     enum fi_datatype datatype)
+/* Offset of chunk i when count elements are split among n ranks */
+static uint64_t coll_chunk_offset(uint64_t count, uint64_t n, uint64_t i)
 {
-	uint64_t i, cur_offset, next_offset;
-	int ret;
-	size_t nbytes, numranks;
-	uint64_t local_rank, left_rank, right_rank;
+	return (count / n) * i + MIN(i, count % n);
+}
 
-	local_rank = coll_op->mc->local_rank;
-	nbytes = ofi_datatype_size(datatype) * count;
-	numranks = coll_op->mc->av_set->fi_addr_count;
+/* Offset and count of chunks [first, last) */
+static void coll_chunk_range(uint64_t count, uint64_t n, uint64_t first,
+			     uint64_t last, uint64_t *offset, uint64_t *cnt)
+{
+	*offset = coll_chunk_offset(count, n, first);
+	*cnt = coll_chunk_offset(count, n, last) - *offset;
+}
 
-	/* copy the local value to the appropriate place in result buffer */
-	ret = coll_sched_copy(coll_op, (void *) send_buf,
-			      (char *) result + (local_rank * nbytes),
-			      count, datatype, 1);
-	if (ret)
-		return ret;
+/*
+ * Allreduce implemented using Rabenseifner's algorithm: a reduce-scatter
+ * by recursive halving followed by an allgather by recursive doubling.
+ * Ranks beyond the largest power of two fold their data into a neighbor
+ * first, as with recursive doubling.
+ */
+static int coll_do_allreduce_rhalving(struct util_coll_operation *coll_op,
+				      void *result, void *tmp_buf,
+				      uint64_t count, enum fi_datatype datatype,
+				      enum fi_op op)
+{
+	uint64_t rem, pof2, my_new_id, local, remote, next_remote, mask;
+	uint64_t send_idx, recv_idx, last_idx;
+	uint64_t send_off, send_cnt, recv_off, recv_cnt;
+	size_t dsize = ofi_datatype_size(datatype);
+	int ret;
 
-	/* send to right, recv from left */
-	left_rank = (numranks + local_rank - 1) % numranks;
-	right_rank = (local_rank + 1) % numranks;
+	pof2 = rounddown_power_of_two(coll_op->mc->av_set->fi_addr_count);
+	rem = coll_op->mc->av_set->fi_addr_count - pof2;
+	local = coll_op->mc->local_rank;
 
-	cur_offset = local_rank;
-	next_offset = left_rank;
+	if (local < 2 * rem) {
+		if (local % 2 == 0) {
+			ret = coll_sched_send(coll_op, local + 1, result,
+					      count, datatype, 1);
+			if (ret)
+				return ret;
 
-	/* fill in result with data going right to left */
-	for (i = 1; i < numranks; i++) {
-		ret = coll_sched_send(coll_op, right_rank,
-				      (char *) result + (cur_offset * nbytes),
-				      count, datatype, 0);
-		if (ret)
-			return ret;
+			my_new_id = (uint64_t) -1;
+		} else {
+			ret = coll_sched_recv(coll_op, local - 1,
+					      tmp_buf, count, datatype, 1);
+			if (ret)
+				return ret;
 
-		ret = coll_sched_recv(coll_op, left_rank,
-				      (char *) result + (next_offset * nbytes),
-				      count, datatype, 1);
-		if (ret)
-			return ret;
+			my_new_id = local / 2;
 
-		cur_offset = next_offset;
-		next_offset = (numranks + next_offset - 1) % numranks;
+			ret = coll_sched_reduce(coll_op, tmp_buf, result,
+						count, datatype, op, 1);
+			if (ret)
+				return ret;
+		}
+	} else {
+		my_new_id = local - rem;
 	}
 
-	return FI_SUCCESS;
-}
+	if (my_new_id != -1) {
+		/* reduce-scatter, halving the exchanged data at each step */
+		send_idx = recv_idx = 0;
+		last_idx = pof2;
+		for (mask = 1; mask < pof2; ) {
+			next_remote = my_new_id ^ mask;
+			remote = (next_remote < rem) ? next_remote * 2 + 1 :
+				next_remote + rem;
 
-static size_t util_binomial_tree_values_to_recv(uint64_t rank, size_t numranks)
-{
-	size_t nvalues = 0x1ULL << (ofi_lsb(rank) - 1);
-	if (numranks < rank + nvalues)
-		nvalues = numranks - rank;
+			if (my_new_id < next_remote) {
+				send_idx = recv_idx + pof2 / (mask * 2);
+				coll_chunk_range(count, pof2, send_idx,
+						 last_idx, &send_off, &send_cnt);
+				coll_chunk_range(count, pof2, recv_idx,
+						 send_idx, &recv_off, &recv_cnt);
+			} else {
+				recv_idx = send_idx + pof2 / (mask * 2);
+				coll_chunk_range(count, pof2, send_idx,
+						 recv_idx, &send_off, &send_cnt);
+				coll_chunk_range(count, pof2, recv_idx,
+						 last_idx, &recv_off, &recv_cnt);
+			}
 
-	return nvalues;
-}
+			ret = coll_sched_recv(coll_op, remote,
+					      (char *) tmp_buf + recv_off * dsize,
+					      recv_cnt, datatype, 0);
+			if (ret)
+				return ret;
 
-/* Scatter implemented with binomial tree algorithm */
-static int coll_do_scatter(struct util_coll_operation *coll_op,
-			   const void *data, void *result, void **temp,
-			   size_t count, uint64_t root,
-			   enum fi_datatype datatype)
-{
-	int64_t remote_rank;
-	uint64_t local_rank, relative_rank, mask;
-	size_t nbytes, numranks, send_cnt, cur_cnt = 0;
-	int ret;
-	void *send_data;
+			ret = coll_sched_send(coll_op, remote,
+					      (char *) result + send_off * dsize,
+					      send_cnt, datatype, 1);
+			if (ret)
+				return ret;
 
-	local_rank = coll_op->mc->local_rank;
-	numranks = coll_op->mc->av_set->fi_addr_count;
-	relative_rank = (local_rank >= root) ?
-			local_rank - root : local_rank - root + numranks;
-	nbytes = count * ofi_datatype_size(datatype);
+			ret = coll_sched_reduce(coll_op,
+						(char *) tmp_buf + recv_off * dsize,
+						(char *) result + recv_off * dsize,
+						recv_cnt, datatype, op, 1);
+			if (ret)
+				return ret;
 
-	/* check if we need to participate */
-	if (count == 0)
-		return FI_SUCCESS;
+			send_idx = recv_idx;
+			mask <<= 1;
+			/* last_idx of the final step is kept for the allgather */
+			if (mask < pof2)
+				last_idx = recv_idx + pof2 / mask;
+		}
 
-	/*
-	 * Non-root even nodes get a temp buffer for receiving data.
-	 * These nodes may need to send part of what they receive.
-	 */
-	if (relative_rank && !(relative_rank % 2)) {
-		cur_cnt = count *
-			  util_binomial_tree_values_to_recv(relative_rank,
-							    numranks);
-		*temp = malloc(cur_cnt * ofi_datatype_size(datatype));
-		if (!*temp)
-			return -FI_ENOMEM;
-	}
+		/* allgather, doubling the exchanged data at each step */
+		for (mask >>= 1; mask > 0; mask >>= 1) {
+			next_remote = my_new_id ^ mask;
+			remote = (next_remote < rem) ? next_remote * 2 + 1 :
+				next_remote + rem;
 
-	if (local_rank == root) {
-		cur_cnt = count * numranks;
-		if (root != 0) {
-			/*
-			 * If we're root but not rank 0, we need to reorder the
-			 * send buffer according to destination rank.
-			 * E.g. if we're rank 3, data intended for ranks 0-2
-			 * will be moved to the end
-			 */
-			*temp = malloc(cur_cnt * ofi_datatype_size(datatype));
-			if (!*temp)
-				return -FI_ENOMEM;
+			if (my_new_id < next_remote) {
+				if (mask != pof2 / 2)
+					last_idx += pof2 / (mask * 2);
 
-			ret = coll_sched_copy(coll_op,
-					      (char *) data + nbytes * local_rank,
-					      *temp,
-					      (numranks - local_rank) * count,
-					      datatype, 1);
+				recv_idx = send_idx + pof2 / (mask * 2);
+				coll_chunk_range(count, pof2, send_idx,
+						 recv_idx, &send_off, &send_cnt);
+				coll_chunk_range(count, pof2, recv_idx,
+						 last_idx, &recv_off, &recv_cnt);
+			} else {
+				recv_idx = send_idx - pof2 / (mask * 2);
+				coll_chunk_range(count, pof2, send_idx,
+						 last_idx, &send_off, &send_cnt);
+				coll_chunk_range(count, pof2, recv_idx,
+						 send_idx, &recv_off, &recv_cnt);
+			}
+
+			ret = coll_sched_recv(coll_op, remote,
+					      (char *) result + recv_off * dsize,
+					      recv_cnt, datatype, 0);
 			if (ret)
 				return ret;
 
-			ret = coll_sched_copy(coll_op, (char *) data,
-					      (char *) *temp + (numranks - local_rank) * nbytes,
-					      local_rank * count, datatype, 1);
+			ret = coll_sched_send(coll_op, remote,
+					      (char *) result + send_off * dsize,
+					      send_cnt, datatype, 1);
 			if (ret)
 				return ret;
+
+			if (my_new_id > next_remote)
+				send_idx = recv_idx;
 		}
 	}
 
-	/* set up all receives */
-	mask = 0x1;
-	while (mask < numranks) {
-		if (relative_rank & mask) {
-			remote_rank = local_rank - mask;
-			if (remote_rank < 0)
-				remote_rank += numranks;
-
-			if (relative_rank % 2) {
-				/* leaf node, receive our data */
-				ret = coll_sched_recv(coll_op, remote_rank,
-						      result, count, datatype,
-						      1);
-				if (ret)
-					return ret;
-			} else {
-				/* branch node, receive data to forward */
-				ret = coll_sched_recv(coll_op, remote_rank,
-						      *temp, cur_cnt, datatype,
-						      1);
-				if (ret)
-					return ret;
-			}
-			break;
+	if (local < 2 * rem) {
+		if (local % 2) {
+			ret = coll_sched_send(coll_op, local - 1, result,
+					      count, datatype, 1);
+			if (ret)
+				return ret;
+		} else {
+			ret = coll_sched_recv(coll_op, local + 1, result,
+					      count, datatype, 1);
+			if (ret)
+				return ret;
 		}
-		mask <<= 1;
 	}
+	return FI_SUCCESS;
+}
 
-	/* set up all sends */
-	send_data = root == local_rank && root == 0 ? (void *) data : *temp;
-	mask >>= 1;
-	while (mask > 0) {
-		if (relative_rank + mask < numranks) {
-			/*
-			 * To this point, cur_cnt has represented the number of
-			 * values to expect to store in our data buf.  From here
-			 * on, cur_cnt is the number of values we have left to
-			 * forward from the data buf.
-			 */
-			send_cnt = cur_cnt - count * mask;
+/*
+ * Allreduce implemented using ring algorithm: a ring reduce-scatter leaves
+ * chunk (rank + 1) fully reduced on each rank, and a ring allgather then
+ * passes the reduced chunks around.  Each rank sends 2 (p - 1) / p of the
+ * vector in total.
+ */
+static int coll_do_allreduce_ring(struct util_coll_operation *coll_op,
+				  void *result, void *tmp_buf,
+				  uint64_t count, enum fi_datatype datatype,
+				  enum fi_op op)
+{
+	uint64_t i, send_chunk, recv_chunk;
+	uint64_t send_off, send_cnt, recv_off, recv_cnt;
+	uint64_t local_rank, left_rank, right_rank;
+	size_t dsize = ofi_datatype_size(datatype);
+	size_t numranks;
+	int ret;
 
-			remote_rank = local_rank + mask;
-			if ((uint64_t) remote_rank >= numranks)
-				remote_rank -= numranks;
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	left_rank = (numranks + local_rank - 1) % numranks;
+	right_rank = (local_rank + 1) % numranks;
 
-			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
-			       "MASK: 0x%0lx CUR_CNT: %ld SENDING: %ld TO: %ld\n",
-			       mask, cur_cnt, send_cnt, remote_rank);
+	for (i = 0; i < numranks - 1; i++) {
+		send_chunk = (local_rank + numranks - i) % numranks;
+		recv_chunk = (send_chunk + numranks - 1) % numranks;
+		coll_chunk_range(count, numranks, send_chunk, send_chunk + 1,
+				 &send_off, &send_cnt);
+		coll_chunk_range(count, numranks, recv_chunk, recv_chunk + 1,
+				 &recv_off, &recv_cnt);
 
-			assert(send_cnt > 0);
+		ret = coll_sched_send(coll_op, right_rank,
+				      (char *) result + send_off * dsize,
+				      send_cnt, datatype, 0);
+		if (ret)
+			return ret;
 
-			ret = coll_sched_send(coll_op, remote_rank,
-					      (char *) send_data + nbytes * mask,
-					      send_cnt, datatype, 1);
-			if (ret)
-				return ret;
+		ret = coll_sched_recv(coll_op, left_rank, tmp_buf,
+				      recv_cnt, datatype, 1);
+		if (ret)
+			return ret;
 
-			cur_cnt -= send_cnt;
-		}
-		mask >>= 1;
+		ret = coll_sched_reduce(coll_op, tmp_buf,
+					(char *) result + recv_off * dsize,
+					recv_cnt, datatype, op, 1);
+		if (ret)
+			return ret;
 	}
 
-	if (!(relative_rank % 2)) {
-		/*
-		 * for the root and all even nodes, we've got to copy
-		 * our local data to the result buffer
-		 */
-		ret = coll_sched_copy(coll_op, send_data, result,
+	for (i = 0; i < numranks - 1; i++) {
+		send_chunk = (local_rank + 1 + numranks - i) % numranks;
+		recv_chunk = (send_chunk + numranks - 1) % numranks;
+		coll_chunk_range(count, numranks, send_chunk, send_chunk + 1,
+				 &send_off, &send_cnt);
+		coll_chunk_range(count, numranks, recv_chunk, recv_chunk + 1,
+				 &recv_off, &recv_cnt);
+
+		ret = coll_sched_send(coll_op, right_rank,
+				      (char *) result + send_off * dsize,
+				      send_cnt, datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_recv(coll_op, left_rank,
+				      (char *) result + recv_off * dsize,
+				      recv_cnt, datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/*
+ * Allreduce in three phases: the ranks of each node reduce into their
+ * leader, the leaders run recursive doubling among themselves, and each
+ * leader returns the total to its node.  Only one message per node then
+ * crosses the network at each step.
+ */
+static int coll_do_allreduce_hier(struct util_coll_operation *coll_op,
+				  void *result, void *tmp_buf, uint64_t count,
+				  enum fi_datatype datatype, enum fi_op op)
+{
+	struct util_coll_topo *topo = coll_op->mc->topo;
+	size_t i;
+	int ret;
+
+	if (topo->local_idx) {
+		ret = coll_sched_send(coll_op, topo->local_ranks[0], result,
+				      count, datatype, 0);
+		if (ret)
+			return ret;
+
+		return coll_sched_recv(coll_op, topo->local_ranks[0], result,
+				       count, datatype, 1);
+	}
+
+	for (i = 1; i < topo->local_cnt; i++) {
+		ret = coll_sched_recv(coll_op, topo->local_ranks[i], tmp_buf,
 				      count, datatype, 1);
 		if (ret)
 			return ret;
+
+		ret = coll_sched_reduce(coll_op, tmp_buf, result, count,
+					datatype, op, 1);
+		if (ret)
+			return ret;
+	}
+
+	ret = coll_do_allreduce_rdouble(coll_op, topo->leaders,
+					topo->node_cnt, topo->node_idx,
+					result, tmp_buf, count, datatype, op);
+	if (ret)
+		return ret;
+
+	for (i = 1; i < topo->local_cnt; i++) {
+		ret = coll_sched_send(coll_op, topo->local_ranks[i], result,
+				      count, datatype, 0);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/* The group spans several nodes, and some node holds several ranks */
+static bool coll_is_hier(struct util_coll_mc *coll_mc)
+{
+	return coll_mc->topo && coll_mc->topo->node_cnt > 1 &&
+	       coll_mc->topo->node_cnt < coll_mc->av_set->fi_addr_count;
+}
+
+/*
+ * Collective algorithms, chosen per call by coll_select() and reported
+ * through FI_COLL_MC_OPS.
+ */
+enum coll_alg {
+	COLL_ALG_RDOUBLE,
+	COLL_ALG_RHALVING,
+	COLL_ALG_RING,
+	COLL_ALG_HIER,
+	COLL_ALG_BINOMIAL,
+	COLL_ALG_PIPELINE,
+	COLL_ALG_SCATTER_ALLGATHER,
+	COLL_ALG_PAIRWISE,
+	COLL_ALG_BRUCK,
+	COLL_ALG_RSGATHER,
+	COLL_ALG_NONE,
+};
+
+static const char *coll_alg_names[] = {
+	[COLL_ALG_RDOUBLE] = "recursive doubling",
+	[COLL_ALG_RHALVING] = "recursive halving",
+	[COLL_ALG_RING] = "ring",
+	[COLL_ALG_HIER] = "hierarchical",
+	[COLL_ALG_BINOMIAL] = "binomial tree",
+	[COLL_ALG_PIPELINE] = "pipeline",
+	[COLL_ALG_SCATTER_ALLGATHER] = "scatter allgather",
+	[COLL_ALG_PAIRWISE] = "pairwise",
+	[COLL_ALG_BRUCK] = "bruck",
+	[COLL_ALG_RSGATHER] = "reduce-scatter gather",
+	[COLL_ALG_NONE] = "none",
+};
+
+struct coll_choice {
+	enum coll_alg	alg;
+	double		time;
+};
+
+/*
+ * Time of steps that send msgs messages of bytes in total and reduce
+ * reduced bytes, along the critical path.
+ */
+static double coll_cost(struct util_coll_mc *coll_mc, double msgs,
+			double bytes, double reduced)
+{
+	return msgs * coll_mc->latency + bytes / coll_mc->bandwidth +
+	       reduced / COLL_COST_REDUCE_RATE;
+}
+
+static double coll_log2(size_t n)
+{
+	double steps = 0;
+
+	while (((size_t) 1 << (size_t) steps) < n)
+		steps++;
+	return steps;
+}
+
+static void coll_choose(struct coll_choice *choice, enum coll_alg alg,
+			double time)
+{
+	if (choice->alg == COLL_ALG_NONE || time < choice->time) {
+		choice->alg = alg;
+		choice->time = time;
+	}
+}
+
+/*
+ * Recursive doubling exchanges the whole vector log(p) times.  Ranks past
+ * the largest power of two fold their vector into a partner first, and
+ * get the result back at the end.
+ */
+static double coll_cost_rdouble(struct util_coll_mc *coll_mc, size_t numranks,
+				double nbytes)
+{
+	size_t pof2 = rounddown_power_of_two(numranks);
+	double extra = pof2 < numranks ? 1 : 0;
+	double steps = coll_log2(pof2);
+
+	return coll_cost(coll_mc, steps + 2 * extra,
+			 (steps + 2 * extra) * nbytes, (steps + extra) * nbytes);
+}
+
+/*
+ * Estimate the cost of each algorithm able to run the collective, with
+ * count elements per rank, and pick the cheapest.  The model only depends
+ * on values that every rank of the group shares, so that all of them pick
+ * the same algorithm.
+ */
+static struct coll_choice coll_select(struct util_coll_mc *coll_mc,
+				      enum fi_collective_op coll,
+				      size_t count, enum fi_datatype datatype)
+{
+	struct coll_choice choice = { .alg = COLL_ALG_NONE };
+	struct util_coll_topo *topo = coll_mc->topo;
+	size_t numranks = coll_mc->av_set->fi_addr_count;
+	size_t pof2 = rounddown_power_of_two(numranks);
+	double p = numranks, logp = coll_log2(numranks);
+	double nbytes = (double) count * ofi_datatype_size(datatype);
+	double extra = pof2 < numranks ? nbytes : 0;
+	double frac = (p - 1) / p, seg, segs;
+
+	switch (coll) {
+	case FI_BARRIER:
+		nbytes = sizeof(uint64_t);
+		count = 1;
+		/* fall through */
+	case FI_ALLREDUCE:
+		/*
+		 * The model has one latency for all links, so it cannot tell
+		 * when funneling a node through its leader pays off.  It does
+		 * while the messages are latency bound.
+		 */
+		if (nbytes < COLL_ALLREDUCE_SHORT_MSG && coll_is_hier(coll_mc)) {
+			coll_choose(&choice, COLL_ALG_HIER,
+				    2 * coll_cost(coll_mc, topo->local_cnt - 1,
+						  nbytes, 0) +
+				    coll_cost_rdouble(coll_mc, topo->node_cnt,
+						      nbytes));
+			break;
+		}
+
+		coll_choose(&choice, COLL_ALG_RDOUBLE,
+			    coll_cost_rdouble(coll_mc, numranks, nbytes));
+		if (count < numranks)
+			break;
+
+		/* reduce-scatter and allgather, each moving the vector once */
+		coll_choose(&choice, COLL_ALG_RHALVING,
+			    coll_cost(coll_mc, 2 * coll_log2(pof2) +
+				      (extra ? 2 : 0),
+				      2 * (pof2 - 1.0) / pof2 * nbytes +
+				      2 * extra,
+				      (pof2 - 1.0) / pof2 * nbytes + extra));
+		coll_choose(&choice, COLL_ALG_RING,
+			    coll_cost(coll_mc, 2 * (p - 1), 2 * frac * nbytes,
+				      frac * nbytes));
+		break;
+	case FI_BROADCAST:
+		coll_choose(&choice, COLL_ALG_SCATTER_ALLGATHER,
+			    coll_cost(coll_mc, logp + p - 1,
+				      2 * frac * nbytes, 0));
+		seg = MIN(nbytes, COLL_BCAST_SEGMENT);
+		segs = MAX((count * ofi_datatype_size(datatype) +
+			    COLL_BCAST_SEGMENT - 1) / COLL_BCAST_SEGMENT, 1);
+		coll_choose(&choice, COLL_ALG_PIPELINE,
+			    MAX(segs + p - 2, 1) * coll_cost(coll_mc, 1, seg, 0));
+		break;
+	case FI_ALLTOALL:
+		coll_choose(&choice, COLL_ALG_PAIRWISE,
+			    coll_cost(coll_mc, p - 1, (p - 1) * nbytes, 0));
+		/* half the blocks move per step, plus the local shuffles */
+		coll_choose(&choice, COLL_ALG_BRUCK,
+			    coll_cost(coll_mc, logp, logp * p / 2 * nbytes,
+				      (2 + logp) * p * nbytes));
+		break;
+	case FI_REDUCE:
+		coll_choose(&choice, COLL_ALG_BINOMIAL,
+			    coll_cost(coll_mc, logp, logp * nbytes,
+				      logp * nbytes));
+		if (count < numranks)
+			break;
+
+		coll_choose(&choice, COLL_ALG_RSGATHER,
+			    coll_cost(coll_mc, 2 * (p - 1), 2 * frac * nbytes,
+				      frac * nbytes));
+		break;
+	case FI_REDUCE_SCATTER:
+		coll_choose(&choice, COLL_ALG_PAIRWISE,
+			    coll_cost(coll_mc, p - 1, (p - 1) * nbytes,
+				      (p - 1) * nbytes));
+		break;
+	case FI_ALLGATHER:
+		coll_choose(&choice, COLL_ALG_RING,
+			    coll_cost(coll_mc, p - 1, (p - 1) * nbytes, 0));
+		break;
+	case FI_SCATTER:
+	case FI_GATHER:
+		coll_choose(&choice, COLL_ALG_BINOMIAL,
+			    coll_cost(coll_mc, logp, (p - 1) * nbytes, 0));
+		break;
+	default:
+		break;
+	}
+
+	return choice;
+}
+
+/*
+ * Short vectors use recursive doubling, which has the fewest steps.  Longer
+ * ones are reduce-scattered and allgathered so that each rank moves the
+ * vector about twice instead of log(p) times: by recursive halving, or
+ * around a ring, which takes more steps but avoids the extra exchanges of
+ * groups that are not a power of two.
+ *
+ * TODO:
+ * when this fails, clean up the already scheduled work in this function
+ */
+static int coll_do_allreduce(struct util_coll_operation *coll_op,
+			     const void *send_buf, void *result,
+			     void* tmp_buf, uint64_t count,
+			     enum fi_datatype datatype, enum fi_op op)
+{
+	size_t numranks = coll_op->mc->av_set->fi_addr_count;
+	size_t nbytes = count * ofi_datatype_size(datatype);
+
+	/* copy initial send data to result */
+	coll_op->init_src = send_buf;
+	coll_op->init_dst = result;
+	coll_op->init_size = nbytes;
+	memcpy(result, send_buf, coll_op->init_size);
+
+	switch (coll_select(coll_op->mc, FI_ALLREDUCE, count, datatype).alg) {
+	case COLL_ALG_HIER:
+		return coll_do_allreduce_hier(coll_op, result, tmp_buf, count,
+					      datatype, op);
+	case COLL_ALG_RHALVING:
+		return coll_do_allreduce_rhalving(coll_op, result, tmp_buf,
+						  count, datatype, op);
+	case COLL_ALG_RING:
+		return coll_do_allreduce_ring(coll_op, result, tmp_buf, count,
+					      datatype, op);
+	default:
+		return coll_do_allreduce_rdouble(coll_op, NULL, numranks,
+						 coll_op->mc->local_rank,
+						 result, tmp_buf, count,
+						 datatype, op);
+	}
+}
+
+/* allgather implemented using ring algorithm */
+static int coll_do_allgather(struct util_coll_operation *coll_op,
+			     const void *send_buf, void *result, size_t count,
+			     enum fi_datatype datatype)
+{
+	uint64_t i, cur_offset, next_offset;
+	int ret;
+	size_t nbytes, numranks;
+	uint64_t local_rank, left_rank, right_rank;
+
+	local_rank = coll_op->mc->local_rank;
+	nbytes = ofi_datatype_size(datatype) * count;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+
+	/* copy the local value to the appropriate place in result buffer */
+	ret = coll_sched_copy(coll_op, (void *) send_buf,
+			      (char *) result + (local_rank * nbytes),
+			      count, datatype, 1);
+	if (ret)
+		return ret;
+
+	/* send to right, recv from left */
+	left_rank = (numranks + local_rank - 1) % numranks;
+	right_rank = (local_rank + 1) % numranks;
+
+	cur_offset = local_rank;
+	next_offset = left_rank;
+
+	/* fill in result with data going right to left */
+	for (i = 1; i < numranks; i++) {
+		ret = coll_sched_send(coll_op, right_rank,
+				      (char *) result + (cur_offset * nbytes),
+				      count, datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_recv(coll_op, left_rank,
+				      (char *) result + (next_offset * nbytes),
+				      count, datatype, 1);
+		if (ret)
+			return ret;
+
+		cur_offset = next_offset;
+		next_offset = (numranks + next_offset - 1) % numranks;
+	}
+
+	return FI_SUCCESS;
+}
+
+static size_t util_binomial_tree_values_to_recv(uint64_t rank, size_t numranks)
+{
+	size_t nvalues = 0x1ULL << (ofi_lsb(rank) - 1);
+	if (numranks < rank + nvalues)
+		nvalues = numranks - rank;
+
+	return nvalues;
+}
+
+/* Scatter implemented with binomial tree algorithm */
+static int coll_do_scatter(struct util_coll_operation *coll_op,
+			   const void *data, void *result, void **temp,
+			   size_t count, uint64_t root,
+			   enum fi_datatype datatype)
+{
+	int64_t remote_rank;
+	uint64_t local_rank, relative_rank, mask;
+	size_t nbytes, numranks, send_cnt, cur_cnt = 0;
+	int ret;
+	void *send_data;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	relative_rank = (local_rank >= root) ?
+			local_rank - root : local_rank - root + numranks;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	/* check if we need to participate */
+	if (count == 0)
+		return FI_SUCCESS;
+
+	/*
+	 * Non-root even nodes get a temp buffer for receiving data.
+	 * These nodes may need to send part of what they receive.
+	 */
+	if (relative_rank && !(relative_rank % 2)) {
+		cur_cnt = count *
+			  util_binomial_tree_values_to_recv(relative_rank,
+							    numranks);
+		*temp = malloc(cur_cnt * ofi_datatype_size(datatype));
+		if (!*temp)
+			return -FI_ENOMEM;
+	}
+
+	if (local_rank == root) {
+		cur_cnt = count * numranks;
+		if (root != 0) {
+			/*
+			 * If we're root but not rank 0, we need to reorder the
+			 * send buffer according to destination rank.
+			 * E.g. if we're rank 3, data intended for ranks 0-2
+			 * will be moved to the end
+			 */
+			*temp = malloc(cur_cnt * ofi_datatype_size(datatype));
+			if (!*temp)
+				return -FI_ENOMEM;
+
+			ret = coll_sched_copy(coll_op,
+					      (char *) data + nbytes * local_rank,
+					      *temp,
+					      (numranks - local_rank) * count,
+					      datatype, 1);
+			if (ret)
+				return ret;
+
+			ret = coll_sched_copy(coll_op, (char *) data,
+					      (char *) *temp + (numranks - local_rank) * nbytes,
+					      local_rank * count, datatype, 1);
+			if (ret)
+				return ret;
+		}
+	}
+
+	/* set up all receives */
+	mask = 0x1;
+	while (mask < numranks) {
+		if (relative_rank & mask) {
+			remote_rank = local_rank - mask;
+			if (remote_rank < 0)
+				remote_rank += numranks;
+
+			if (relative_rank % 2) {
+				/* leaf node, receive our data */
+				ret = coll_sched_recv(coll_op, remote_rank,
+						      result, count, datatype,
+						      1);
+				if (ret)
+					return ret;
+			} else {
+				/* branch node, receive data to forward */
+				ret = coll_sched_recv(coll_op, remote_rank,
+						      *temp, cur_cnt, datatype,
+						      1);
+				if (ret)
+					return ret;
+			}
+			break;
+		}
+		mask <<= 1;
+	}
+
+	/* set up all sends */
+	send_data = root == local_rank && root == 0 ? (void *) data : *temp;
+	mask >>= 1;
+	while (mask > 0) {
+		if (relative_rank + mask < numranks) {
+			/*
+			 * To this point, cur_cnt has represented the number of
+			 * values to expect to store in our data buf.  From here
+			 * on, cur_cnt is the number of values we have left to
+			 * forward from the data buf.
+			 */
+			send_cnt = cur_cnt - count * mask;
+
+			remote_rank = local_rank + mask;
+			if ((uint64_t) remote_rank >= numranks)
+				remote_rank -= numranks;
+
+			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
+			       "MASK: 0x%0lx CUR_CNT: %ld SENDING: %ld TO: %ld\n",
+			       mask, cur_cnt, send_cnt, remote_rank);
+
+			assert(send_cnt > 0);
+
+			ret = coll_sched_send(coll_op, remote_rank,
+					      (char *) send_data + nbytes * mask,
+					      send_cnt, datatype, 1);
+			if (ret)
+				return ret;
+
+			cur_cnt -= send_cnt;
+		}
+		mask >>= 1;
+	}
+
+	if (!(relative_rank % 2)) {
+		/*
+		 * for the root and all even nodes, we've got to copy
+		 * our local data to the result buffer
+		 */
+		ret = coll_sched_copy(coll_op, send_data, result,
+				      count, datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/*
+ * Alltoall by pairwise exchange: at step i, each rank sends its block for
+ * rank + i and receives the block of rank - i.  Every block crosses the
+ * network once, in p - 1 steps.
+ */
+static int coll_do_alltoall_pairwise(struct util_coll_operation *coll_op,
+				     const void *buf, void *result,
+				     size_t count, enum fi_datatype datatype)
+{
+	uint64_t local, dest, src, i;
+	size_t nbytes, numranks;
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	ret = coll_sched_copy(coll_op, (char *) buf + local * nbytes,
+			      (char *) result + local * nbytes, count,
+			      datatype, 0);
+	if (ret)
+		return ret;
+
+	for (i = 1; i < numranks; i++) {
+		dest = (local + i) % numranks;
+		src = (local + numranks - i) % numranks;
+
+		ret = coll_sched_send(coll_op, dest,
+				      (char *) buf + dest * nbytes, count,
+				      datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_recv(coll_op, src,
+				      (char *) result + src * nbytes, count,
+				      datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/*
+ * Alltoall using Bruck's algorithm, for short blocks: after rotating the
+ * blocks so that block i goes to rank + i, step k sends every block whose
+ * index has bit k set to rank + k.  This takes log(p) steps instead of
+ * p - 1, at the cost of packing the blocks of each step.
+ */
+static int coll_do_alltoall_bruck(struct util_coll_operation *coll_op,
+				  const void *buf, void *result,
+				  void *scratch, size_t count,
+				  enum fi_datatype datatype)
+{
+	uint64_t local, dest, src, i, k, n;
+	size_t nbytes, numranks;
+	char *tmp, *pack, *unpack;
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+	tmp = scratch;
+	pack = tmp + numranks * nbytes;
+	unpack = pack + numranks * nbytes;
+
+	ret = coll_sched_copy(coll_op, (char *) buf + local * nbytes, tmp,
+			      (numranks - local) * count, datatype, 1);
+	if (ret)
+		return ret;
+
+	if (local) {
+		ret = coll_sched_copy(coll_op, (void *) buf,
+				      tmp + (numranks - local) * nbytes,
+				      local * count, datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	for (k = 1; k < numranks; k <<= 1) {
+		dest = (local + k) % numranks;
+		src = (local + numranks - k) % numranks;
+
+		for (i = 0, n = 0; i < numranks; i++) {
+			if (!(i & k))
+				continue;
+			ret = coll_sched_copy(coll_op, tmp + i * nbytes,
+					      pack + n++ * nbytes, count,
+					      datatype, 1);
+			if (ret)
+				return ret;
+		}
+
+		ret = coll_sched_send(coll_op, dest, pack, n * count,
+				      datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_recv(coll_op, src, unpack, n * count,
+				      datatype, 1);
+		if (ret)
+			return ret;
+
+		for (i = 0, n = 0; i < numranks; i++) {
+			if (!(i & k))
+				continue;
+			ret = coll_sched_copy(coll_op, unpack + n++ * nbytes,
+					      tmp + i * nbytes, count,
+					      datatype, 1);
+			if (ret)
+				return ret;
+		}
+	}
+
+	/* block i now holds the data of rank - i */
+	for (i = 0; i < numranks; i++) {
+		ret = coll_sched_copy(coll_op,
+				      tmp + ((local + numranks - i) % numranks) *
+					    nbytes,
+				      (char *) result + i * nbytes, count,
+				      datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/*
+ * Reduce-scatter by pairwise exchange: at step i, each rank sends the
+ * block of rank + i and reduces the block it receives from rank - i into
+ * its own.
+ */
+static int coll_do_reduce_scatter(struct util_coll_operation *coll_op,
+				  const void *buf, void *result,
+				  void *tmp_buf, size_t count,
+				  enum fi_datatype datatype, enum fi_op op)
+{
+	uint64_t local, dest, src, i;
+	size_t nbytes, numranks;
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	ret = coll_sched_copy(coll_op, (char *) buf + local * nbytes, result,
+			      count, datatype, 1);
+	if (ret)
+		return ret;
+
+	for (i = 1; i < numranks; i++) {
+		dest = (local + i) % numranks;
+		src = (local + numranks - i) % numranks;
+
+		ret = coll_sched_send(coll_op, dest,
+				      (char *) buf + dest * nbytes, count,
+				      datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_recv(coll_op, src, tmp_buf, count,
+				      datatype, 1);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_reduce(coll_op, tmp_buf, result, count,
+					datatype, op, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/* Reduce to the root along a binomial tree, for short vectors */
+static int coll_do_reduce_binomial(struct util_coll_operation *coll_op,
+				   const void *buf, void *acc, void *tmp_buf,
+				   size_t count, uint64_t root,
+				   enum fi_datatype datatype, enum fi_op op)
+{
+	uint64_t local, relative_rank, mask;
+	size_t numranks;
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	relative_rank = (local + numranks - root) % numranks;
+
+	ret = coll_sched_copy(coll_op, (void *) buf, acc, count, datatype, 1);
+	if (ret)
+		return ret;
+
+	for (mask = 1; mask < numranks; mask <<= 1) {
+		if (relative_rank & mask)
+			return coll_sched_send(coll_op,
+					       (local + numranks - mask) %
+					       numranks, acc, count,
+					       datatype, 1);
+
+		if (relative_rank + mask >= numranks)
+			continue;
+
+		ret = coll_sched_recv(coll_op, (local + mask) % numranks,
+				      tmp_buf, count, datatype, 1);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_reduce(coll_op, tmp_buf, acc, count,
+					datatype, op, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/*
+ * Reduce to the root for long vectors: a pairwise reduce-scatter leaves
+ * chunk i of the total on rank i, and the root gathers the chunks.  Each
+ * rank then sends about one vector instead of log(p) of them.
+ */
+static int coll_do_reduce_rsgather(struct util_coll_operation *coll_op,
+				   const void *buf, void *acc, void *tmp_buf,
+				   size_t count, uint64_t root,
+				   enum fi_datatype datatype, enum fi_op op)
+{
+	uint64_t local, dest, src, i;
+	uint64_t off, cnt, dest_off, dest_cnt;
+	size_t dsize = ofi_datatype_size(datatype);
+	size_t numranks;
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	coll_chunk_range(count, numranks, local, local + 1, &off, &cnt);
+
+	ret = coll_sched_copy(coll_op, (char *) buf + off * dsize,
+			      (char *) acc + off * dsize, cnt, datatype, 1);
+	if (ret)
+		return ret;
+
+	for (i = 1; i < numranks; i++) {
+		dest = (local + i) % numranks;
+		src = (local + numranks - i) % numranks;
+		coll_chunk_range(count, numranks, dest, dest + 1,
+				 &dest_off, &dest_cnt);
+
+		ret = coll_sched_send(coll_op, dest,
+				      (char *) buf + dest_off * dsize,
+				      dest_cnt, datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_recv(coll_op, src, tmp_buf, cnt, datatype, 1);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_reduce(coll_op, tmp_buf,
+					(char *) acc + off * dsize, cnt,
+					datatype, op, 1);
+		if (ret)
+			return ret;
+	}
+
+	if (local != root)
+		return coll_sched_send(coll_op, root,
+				       (char *) acc + off * dsize, cnt,
+				       datatype, 1);
+
+	for (i = 0; i < numranks; i++) {
+		if (i == root)
+			continue;
+
+		coll_chunk_range(count, numranks, i, i + 1, &off, &cnt);
+		ret = coll_sched_recv(coll_op, i, (char *) acc + off * dsize,
+				      cnt, datatype, 0);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/* Gather implemented with binomial tree algorithm */
+static int coll_do_gather(struct util_coll_operation *coll_op,
+			  const void *buf, void *result, void *scratch,
+			  size_t count, uint64_t root,
+			  enum fi_datatype datatype)
+{
+	uint64_t local, relative_rank, child, mask;
+	size_t nbytes, numranks, subtree;
+	char *gather_buf;
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	relative_rank = (local + numranks - root) % numranks;
+	nbytes = count * ofi_datatype_size(datatype);
+	subtree = relative_rank ?
+		  util_binomial_tree_values_to_recv(relative_rank, numranks) :
+		  numranks;
+
+	/* data is gathered in relative rank order */
+	gather_buf = (local == root && !root) ? result : scratch;
+	ret = coll_sched_copy(coll_op, (void *) buf, gather_buf, count,
+			      datatype, 1);
+	if (ret)
+		return ret;
+
+	for (mask = 1; mask < numranks; mask <<= 1) {
+		if (relative_rank & mask)
+			return coll_sched_send(coll_op,
+					       (local + numranks - mask) %
+					       numranks, gather_buf,
+					       subtree * count, datatype, 1);
+
+		child = relative_rank + mask;
+		if (child >= numranks)
+			continue;
+
+		ret = coll_sched_recv(coll_op, (local + mask) % numranks,
+				      gather_buf + mask * nbytes,
+				      MIN(mask, numranks - child) * count,
+				      datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	if (!root)
+		return FI_SUCCESS;
+
+	ret = coll_sched_copy(coll_op, gather_buf,
+			      (char *) result + root * nbytes,
+			      (numranks - root) * count, datatype, 1);
+	if (ret)
+		return ret;
+
+	return coll_sched_copy(coll_op, gather_buf + (numranks - root) * nbytes,
+			       result, root * count, datatype, 1);
+}
+
+static int coll_close(struct fid *fid)
+{
+	struct util_coll_mc *coll_mc;
+
+	coll_mc = container_of(fid, struct util_coll_mc, mc_fid.fid);
+
+	coll_mc_free_sched(coll_mc);
+	ofi_atomic_dec32(&coll_mc->av_set->ref);
+	free(coll_mc);
+
+	return FI_SUCCESS;
+}
+
+static int coll_query_cost(struct fid_mc *mc, enum fi_collective_op coll,
+			   enum fi_datatype datatype, size_t count,
+			   struct fi_coll_cost *cost)
+{
+	struct util_coll_mc *coll_mc;
+	struct coll_choice choice;
+
+	coll_mc = container_of(mc, struct util_coll_mc, mc_fid);
+	if (!cost || !ofi_datatype_size(datatype))
+		return -FI_EINVAL;
+
+	choice = coll_select(coll_mc, coll, count, datatype);
+	if (choice.alg == COLL_ALG_NONE)
+		return -FI_ENOSYS;
+
+	cost->algorithm = coll_alg_names[choice.alg];
+	cost->time = choice.time;
+	cost->latency = coll_mc->latency;
+	cost->bandwidth = coll_mc->bandwidth;
+	return FI_SUCCESS;
+}
+
+static struct fi_coll_ops_mc coll_ops_mc = {
+	.size = sizeof(struct fi_coll_ops_mc),
+	.query_cost = coll_query_cost,
+};
+
+static int coll_ops_open(struct fid *fid, const char *name, uint64_t flags,
+			 void **ops, void *context)
+{
+	if (flags)
+		return -FI_EBADFLAGS;
+
+	if (!strcasecmp(name, FI_COLL_MC_OPS)) {
+		*ops = &coll_ops_mc;
+		return 0;
+	}
+
+	return -FI_ENOSYS;
+}
+
+static struct fi_ops util_coll_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = coll_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = coll_ops_open,
+};
+
+static int coll_find_local_rank(struct fid_ep *ep,
+				struct util_coll_mc *coll_mc)
+{
+	struct coll_av *av = container_of(coll_mc->av_set->av, struct coll_av,
+					  util_av.av_fid);
+	fi_addr_t my_addr;
+	int i;
+
+	my_addr = av->peer_av->owner_ops->ep_addr(av->peer_av, ep);
+
+	coll_mc->local_rank = FI_ADDR_NOTAVAIL;
+	if (my_addr != FI_ADDR_NOTAVAIL) {
+		for (i = 0; i < coll_mc->av_set->fi_addr_count; i++)
+			if (coll_mc->av_set->fi_addr_array[i] == my_addr) {
+				coll_mc->local_rank = i;
+				break;
+			}
+	}
+
+	return FI_SUCCESS;
+}
+
+static void coll_join_report(struct util_coll_operation *coll_op,
+			     struct util_coll_mc *coll_mc)
+{
+	struct fi_eq_entry entry;
+	struct coll_ep *ep;
+	struct ofi_coll_eq *eq;
+
+	ep = container_of(coll_op->ep, struct coll_ep, util_ep.ep_fid);
+	eq = container_of(ep->util_ep.eq, struct ofi_coll_eq, util_eq.eq_fid);
+
+	/* write to the eq */
+	memset(&entry, 0, sizeof(entry));
+	entry.fid = &coll_mc->mc_fid.fid;
+	entry.context = coll_op->context;
+
+	if (fi_eq_write(eq->peer_eq, FI_JOIN_COMPLETE, &entry,
+			sizeof(struct fi_eq_entry), FI_COLLECTIVE) < 0)
+		FI_WARN(ep->util_ep.domain->fabric->prov, FI_LOG_DOMAIN,
+			"join collective - eq write failed\n");
+}
+
+/* Ranks on the same node share a host name */
+static uint64_t coll_host_id(void)
+{
+	char name[256] = { 0 };
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	/* FNV-1a */
+	(void) gethostname(name, sizeof(name) - 1);
+	for (i = 0; name[i]; i++) {
+		hash ^= (uint8_t) name[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+struct coll_host_rank {
+	uint64_t	host_id;
+	uint64_t	rank;
+};
+
+static int coll_host_rank_cmp(const void *a, const void *b)
+{
+	const struct coll_host_rank *x = a, *y = b;
+
+	if (x->host_id != y->host_id)
+		return x->host_id < y->host_id ? -1 : 1;
+	return x->rank < y->rank ? -1 : x->rank > y->rank;
+}
+
+/*
+ * Group the ranks by host.  Every member sorts the same host ids, so they
+ * all agree on the order of the nodes and on their leaders.
+ */
+static struct util_coll_topo *coll_build_topo(const uint64_t *host_ids,
+					      size_t numranks,
+					      uint64_t local_rank)
+{
+	struct util_coll_topo *topo = NULL;
+	struct coll_host_rank *order;
+	uint64_t local_host = host_ids[local_rank];
+	size_t i, node_cnt = 0, local_cnt = 0;
+	bool first;
+
+	order = malloc(numranks * sizeof(*order));
+	if (!order)
+		return NULL;
+
+	for (i = 0; i < numranks; i++) {
+		order[i].host_id = host_ids[i];
+		order[i].rank = i;
 	}
+	qsort(order, numranks, sizeof(*order), coll_host_rank_cmp);
 
-	return FI_SUCCESS;
+	for (i = 0; i < numranks; i++) {
+		if (!i || order[i].host_id != order[i - 1].host_id)
+			node_cnt++;
+		if (order[i].host_id == local_host)
+			local_cnt++;
+	}
+
+	topo = calloc(1, sizeof(*topo) +
+			 (node_cnt + local_cnt) * sizeof(uint64_t));
+	if (!topo)
+		goto out;
+
+	topo->leaders = (uint64_t *) (topo + 1);
+	topo->local_ranks = topo->leaders + node_cnt;
+	for (i = 0; i < numranks; i++) {
+		first = !i || order[i].host_id != order[i - 1].host_id;
+		if (order[i].host_id == local_host) {
+			if (first)
+				topo->node_idx = topo->node_cnt;
+			if (order[i].rank == local_rank)
+				topo->local_idx = topo->local_cnt;
+			topo->local_ranks[topo->local_cnt++] = order[i].rank;
+		}
+		if (first)
+			topo->leaders[topo->node_cnt++] = order[i].rank;
+	}
+out:
+	free(order);
+	return topo;
 }
 
-static int coll_close(struct fid *fid)
+static void coll_topo_comp(struct util_coll_operation *coll_op)
 {
-	struct util_coll_mc *coll_mc;
+	struct util_coll_mc *coll_mc = coll_op->mc;
+
+	coll_mc->topo = coll_build_topo(coll_op->data.topo.host_ids,
+					coll_mc->av_set->fi_addr_count,
+					coll_mc->local_rank);
+	if (coll_mc->topo)
+		FI_INFO(coll_mc->av_set->av->prov, FI_LOG_EP_CTRL,
+			"group %d: %zu ranks on %zu nodes\n",
+			coll_mc->group_id, coll_mc->av_set->fi_addr_count,
+			coll_mc->topo->node_cnt);
+
+	coll_mc->latency = coll_op->data.topo.cost[0] / 1000.0;
+	coll_mc->bandwidth = coll_op->data.topo.cost[1] / 1000000.0;
+	FI_INFO(coll_mc->av_set->av->prov, FI_LOG_EP_CTRL,
+		"group %d: latency %.2f usec, bandwidth %.0f bytes/usec\n",
+		coll_mc->group_id, coll_mc->latency, coll_mc->bandwidth);
+
+	coll_join_report(coll_op, coll_mc);
+	coll_free_op_data(coll_op);
+}
 
-	coll_mc = container_of(fid, struct util_coll_mc, mc_fid.fid);
+/* Link speed of the peer provider, in bytes per second */
+static uint64_t coll_link_bandwidth(struct fid_ep *ep_fid)
+{
+	struct coll_ep *ep = container_of(ep_fid, struct coll_ep,
+					  util_ep.ep_fid);
+	struct fi_info *info = ep->peer_info;
 
-	ofi_atomic_dec32(&coll_mc->av_set->ref);
-	free(coll_mc);
+	if (info && info->nic && info->nic->link_attr &&
+	    info->nic->link_attr->speed)
+		return info->nic->link_attr->speed / 8;
 
-	return FI_SUCCESS;
+	return COLL_COST_BANDWIDTH * 1000000;
 }
 
-static struct fi_ops util_coll_fi_ops = {
-	.size = sizeof(struct fi_ops),
-	.close = coll_close,
-	.bind = fi_no_bind,
-	.control = fi_no_control,
-	.ops_open = fi_no_ops_open,
-};
-
-static int coll_find_local_rank(struct fid_ep *ep,
-				struct util_coll_mc *coll_mc)
+/*
+ * Gather the host of every rank of a newly joined group, to place its
+ * ranks on nodes before reporting the join.  The allgather also calibrates
+ * the cost model of the group, see coll_topo_sample().
+ */
+static int coll_join_topo(struct util_coll_operation *join_op)
 {
-	struct coll_av *av = container_of(coll_mc->av_set->av, struct coll_av,
-					  util_av.av_fid);
-	fi_addr_t my_addr;
-	int i;
+	struct util_coll_mc *coll_mc = join_op->data.join.new_mc;
+	struct util_coll_operation *topo_op;
+	struct topo_data *topo;
+	int ret;
 
-	my_addr = av->peer_av->owner_ops->ep_addr(av->peer_av, ep);
+	topo_op = coll_create_op(join_op->ep, coll_mc, UTIL_COLL_TOPO_OP,
+				 join_op->flags, join_op->context,
+				 coll_topo_comp);
+	if (!topo_op)
+		return -FI_ENOMEM;
 
-	coll_mc->local_rank = FI_ADDR_NOTAVAIL;
-	if (my_addr != FI_ADDR_NOTAVAIL) {
-		for (i = 0; i < coll_mc->av_set->fi_addr_count; i++)
-			if (coll_mc->av_set->fi_addr_array[i] == my_addr) {
-				coll_mc->local_rank = i;
-				break;
-			}
+	topo_op->data.topo.host_id = coll_host_id();
+	topo_op->data.topo.host_ids = calloc(coll_mc->av_set->fi_addr_count,
+					     sizeof(uint64_t));
+	if (!topo_op->data.topo.host_ids) {
+		ret = -FI_ENOMEM;
+		goto err;
 	}
 
+	ret = coll_do_allgather(topo_op, &topo_op->data.topo.host_id,
+				topo_op->data.topo.host_ids, 1, FI_UINT64);
+	if (ret)
+		goto err;
+
+	topo = &topo_op->data.topo;
+	topo->cost_in[0] = (uint64_t) (coll_mc->latency * 1000);
+	topo->cost_in[1] = coll_link_bandwidth(join_op->ep);
+	ret = coll_do_allreduce(topo_op, topo->cost_in, topo->cost,
+				topo->cost_tmp, 2, FI_UINT64, FI_MIN);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(topo_op);
+	if (ret)
+		goto err;
+
+	topo->step_min = UINT64_MAX;
+	topo->step_start = ofi_gettime_ns();
+	coll_start_work(container_of(join_op->ep, struct util_ep, ep_fid),
+			topo_op);
 	return FI_SUCCESS;
+
+err:
+	coll_free_op_data(topo_op);
+	coll_free_op(topo_op);
+	return ret;
 }
 
 void coll_join_comp(struct util_coll_operation *coll_op)
 {
-	struct fi_eq_entry entry;
+	struct util_coll_mc *new_mc = coll_op->data.join.new_mc;
 	struct coll_ep *ep;
-	struct ofi_coll_eq *eq;
 
 	ep = container_of(coll_op->ep, struct coll_ep, util_ep.ep_fid);
-	eq = container_of(ep->util_ep.eq, struct ofi_coll_eq, util_eq.eq_fid);
 
-	coll_op->data.join.new_mc->seq = 0;
-	coll_op->data.join.new_mc->group_id =
+	new_mc->seq = 0;
+	new_mc->group_id =
 		(uint16_t) ofi_bitmask_get_lsbset(coll_op->data.join.data);
 
 	/* mark the local mask bit */
-	ofi_bitmask_unset(ep->util_ep.coll_cid_mask,
-			  coll_op->data.join.new_mc->group_id);
-
-	/* write to the eq */
-	memset(&entry, 0, sizeof(entry));
-	entry.fid = &coll_op->mc->mc_fid.fid;
-	entry.context = coll_op->context;
-
-	if (fi_eq_write(eq->peer_eq, FI_JOIN_COMPLETE, &entry,
-			sizeof(struct fi_eq_entry), FI_COLLECTIVE) < 0)
-		FI_WARN(ep->util_ep.domain->fabric->prov, FI_LOG_DOMAIN,
-			"join collective - eq write failed\n");
+	ofi_bitmask_unset(ep->util_ep.coll_cid_mask, new_mc->group_id);
 
 	ofi_bitmask_free(&coll_op->data.join.data);
 	ofi_bitmask_free(&coll_op->data.join.tmp);
+
+	if (new_mc->local_rank == FI_ADDR_NOTAVAIL ||
+	    new_mc->av_set->fi_addr_count < 2 || coll_join_topo(coll_op))
+		coll_join_report(coll_op, new_mc);
 }
 
 void coll_collective_comp(struct util_coll_operation *coll_op)
@@ -731,27 +2071,8 @@ void coll_collective_comp(struct util_coll_operation *coll_op)
 		FI_WARN(ep->util_ep.domain->fabric->prov, FI_LOG_DOMAIN,
 			"collective - cq write failed\n");
 
-	switch (coll_op->type) {
-	case UTIL_COLL_ALLREDUCE_OP:
-		free(coll_op->data.allreduce.data);
-		break;
-
-	case UTIL_COLL_SCATTER_OP:
-		free(coll_op->data.scatter);
-		break;
-
-	case UTIL_COLL_BROADCAST_OP:
-		free(coll_op->data.broadcast.chunk);
-		free(coll_op->data.broadcast.scatter);
-		break;
-
-	case UTIL_COLL_JOIN_OP:
-	case UTIL_COLL_BARRIER_OP:
-	case UTIL_COLL_ALLGATHER_OP:
-	default:
-		/* nothing to clean up */
-		break;
-	}
+	if (!coll_op->persistent)
+		coll_free_op_data(coll_op);
 }
 
 static ssize_t coll_process_reduce_item(struct util_coll_reduce_item *reduce_item)
@@ -759,10 +2080,9 @@ static ssize_t coll_process_reduce_item(struct util_coll_reduce_item *reduce_ite
 	if (reduce_item->op < FI_MIN || reduce_item->op > FI_BXOR)
 		return -FI_ENOSYS;
 
-	ofi_atomic_write_handler(reduce_item->op, reduce_item->datatype,
-				 reduce_item->inout_buf,
-				 reduce_item->in_buf,
-				 reduce_item->count);
+	ofi_reduce(reduce_item->op, reduce_item->datatype,
+		   reduce_item->inout_buf, reduce_item->in_buf,
+		   reduce_item->count);
 	return FI_SUCCESS;
 }
 
@@ -783,7 +2103,7 @@ static ssize_t coll_process_xfer_item(struct util_coll_xfer_item *item)
 	msg.ignore = 0;
 	msg.context = item;
 	msg.data = 0;
-	msg.tag = item->tag;
+	msg.tag = coll_xfer_tag(item);
 	msg.addr = coll_op->mc->av_set->fi_addr_array[item->remote_rank];
 
 	iov.iov_base = item->buf;
@@ -818,14 +2138,12 @@ void coll_ep_progress(struct util_ep *util_ep)
 	struct util_coll_reduce_item *reduce_item;
 	struct util_coll_copy_item *copy_item;
 	struct util_coll_xfer_item *xfer_item;
-	struct util_coll_operation *coll_op;
 	ssize_t ret;
 
 	while (!slist_empty(&util_ep->coll_ready_queue)) {
 		slist_remove_head_container(&util_ep->coll_ready_queue,
 					    struct util_coll_work_item,
 					    work_item, ready_entry);
-		coll_op = work_item->coll_op;
 		switch (work_item->type) {
 		case UTIL_COLL_SEND:
 			xfer_item = container_of(work_item,
@@ -856,7 +2174,7 @@ void coll_ep_progress(struct util_ep *util_ep)
 			if (ret)
 				goto out;
 
-			reduce_item->hdr.state = UTIL_COLL_COMPLETE;
+			coll_complete_work(util_ep, work_item);
 			break;
 
 		case UTIL_COLL_COPY:
@@ -867,21 +2185,19 @@ void coll_ep_progress(struct util_ep *util_ep)
 			       copy_item->count *
 				       ofi_datatype_size(copy_item->datatype));
 
-			copy_item->hdr.state = UTIL_COLL_COMPLETE;
+			coll_complete_work(util_ep, work_item);
 			break;
 
 		case UTIL_COLL_COMP:
 			if (work_item->coll_op->comp_fn)
 				work_item->coll_op->comp_fn(work_item->coll_op);
 
-			work_item->state = UTIL_COLL_COMPLETE;
+			coll_complete_work(util_ep, work_item);
 			break;
 
 		default:
 			goto out;
 		}
-
-		coll_progress_work(util_ep, coll_op);
 	}
 
 out:
@@ -901,6 +2217,10 @@ static struct util_coll_mc *coll_create_mc(struct util_av_set *av_set,
 	coll_mc->mc_fid.fid.context = context;
 	coll_mc->mc_fid.fid.ops = &util_coll_fi_ops;
 	coll_mc->mc_fid.fi_addr = (uintptr_t) coll_mc;
+	if (coll_mc_init_sched(coll_mc)) {
+		free(coll_mc);
+		return NULL;
+	}
 
 	ofi_atomic_inc32(&av_set->ref);
 	coll_mc->av_set = av_set;
@@ -975,7 +2295,7 @@ int coll_join_collective(struct fid_ep *ep, const void *addr,
 	if (ret)
 		goto err4;
 
-	coll_progress_work(util_ep, join_op);
+	coll_start_work(util_ep, join_op);
 
 	*mc = &new_coll_mc->mc_fid;
 	return FI_SUCCESS;
@@ -985,7 +2305,7 @@ err4:
 err3:
 	ofi_bitmask_free(&join_op->data.join.data);
 err2:
-	free(join_op);
+	coll_free_op(join_op);
 err1:
 	fi_close(&new_coll_mc->mc_fid.fid);
 	return ret;
@@ -997,10 +2317,15 @@ ssize_t coll_ep_barrier2(struct fid_ep *ep, fi_addr_t coll_addr, uint64_t flags,
 	struct util_coll_mc *coll_mc;
 	struct util_coll_operation *barrier_op;
 	struct util_ep *util_ep;
-	uint64_t send;
+	struct util_coll_key key = {
+		.ep = ep,
+		.type = UTIL_COLL_BARRIER_OP,
+	};
 	int ret;
 
 	coll_mc = (struct util_coll_mc*) ((uintptr_t) coll_addr);
+	if (coll_resume_op(ep, coll_mc, &key, flags, context))
+		return FI_SUCCESS;
 
 	barrier_op = coll_create_op(ep, coll_mc, UTIL_COLL_BARRIER_OP,
 				    flags, context,
@@ -1008,8 +2333,8 @@ ssize_t coll_ep_barrier2(struct fid_ep *ep, fi_addr_t coll_addr, uint64_t flags,
 	if (!barrier_op)
 		return -FI_ENOMEM;
 
-	send = ~barrier_op->mc->local_rank;
-	ret = coll_do_allreduce(barrier_op, &send,
+	barrier_op->data.barrier.send = ~barrier_op->mc->local_rank;
+	ret = coll_do_allreduce(barrier_op, &barrier_op->data.barrier.send,
 				&barrier_op->data.barrier.data,
 				&barrier_op->data.barrier.tmp, 1, FI_UINT64,
 				FI_BAND);
@@ -1020,12 +2345,13 @@ ssize_t coll_ep_barrier2(struct fid_ep *ep, fi_addr_t coll_addr, uint64_t flags,
 	if (ret)
 		goto err1;
 
+	coll_persist_op(barrier_op, &key);
 	util_ep = container_of(ep, struct util_ep, ep_fid);
-	coll_progress_work(util_ep, barrier_op);
+	coll_start_work(util_ep, barrier_op);
 
 	return FI_SUCCESS;
 err1:
-	free(barrier_op);
+	coll_free_op(barrier_op);
 	return ret;
 }
 
@@ -1042,9 +2368,21 @@ ssize_t coll_ep_allreduce(struct fid_ep *ep, const void *buf, size_t count,
 	struct util_coll_mc *coll_mc;
 	struct util_coll_operation *allreduce_op;
 	struct util_ep *util_ep;
+	struct util_coll_key key = {
+		.ep = ep,
+		.type = UTIL_COLL_ALLREDUCE_OP,
+		.buf = buf,
+		.result = result,
+		.count = count,
+		.datatype = datatype,
+		.op = op,
+	};
 	int ret;
 
 	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	if (coll_resume_op(ep, coll_mc, &key, flags, context))
+		return FI_SUCCESS;
+
 	allreduce_op = coll_create_op(ep, coll_mc, UTIL_COLL_ALLREDUCE_OP,
 				      flags, context,
 				      coll_collective_comp);
@@ -1069,15 +2407,16 @@ ssize_t coll_ep_allreduce(struct fid_ep *ep, const void *buf, size_t count,
 	if (ret)
 		goto err2;
 
+	coll_persist_op(allreduce_op, &key);
 	util_ep = container_of(ep, struct util_ep, ep_fid);
-	coll_progress_work(util_ep, allreduce_op);
+	coll_start_work(util_ep, allreduce_op);
 
 	return FI_SUCCESS;
 
 err2:
 	free(allreduce_op->data.allreduce.data);
 err1:
-	free(allreduce_op);
+	coll_free_op(allreduce_op);
 	return ret;
 }
 
@@ -1089,9 +2428,20 @@ ssize_t coll_ep_allgather(struct fid_ep *ep, const void *buf, size_t count,
 	struct util_coll_mc *coll_mc;
 	struct util_coll_operation *allgather_op;
 	struct util_ep *util_ep;
+	struct util_coll_key key = {
+		.ep = ep,
+		.type = UTIL_COLL_ALLGATHER_OP,
+		.buf = buf,
+		.result = result,
+		.count = count,
+		.datatype = datatype,
+	};
 	int ret;
 
 	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	if (coll_resume_op(ep, coll_mc, &key, flags, context))
+		return FI_SUCCESS;
+
 	allgather_op = coll_create_op(ep, coll_mc, UTIL_COLL_ALLGATHER_OP,
 				      flags, context,
 				      coll_collective_comp);
@@ -1106,12 +2456,13 @@ ssize_t coll_ep_allgather(struct fid_ep *ep, const void *buf, size_t count,
 	if (ret)
 		goto err;
 
+	coll_persist_op(allgather_op, &key);
 	util_ep = container_of(ep, struct util_ep, ep_fid);
-	coll_progress_work(util_ep, allgather_op);
+	coll_start_work(util_ep, allgather_op);
 
 	return FI_SUCCESS;
 err:
-	free(allgather_op);
+	coll_free_op(allgather_op);
 	return ret;
 }
 
@@ -1124,9 +2475,21 @@ ssize_t coll_ep_scatter(struct fid_ep *ep, const void *buf, size_t count,
 	struct util_coll_mc *coll_mc;
 	struct util_coll_operation *scatter_op;
 	struct util_ep *util_ep;
+	struct util_coll_key key = {
+		.ep = ep,
+		.type = UTIL_COLL_SCATTER_OP,
+		.buf = buf,
+		.result = result,
+		.count = count,
+		.datatype = datatype,
+		.root = root_addr,
+	};
 	int ret;
 
 	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	if (coll_resume_op(ep, coll_mc, &key, flags, context))
+		return FI_SUCCESS;
+
 	scatter_op = coll_create_op(ep, coll_mc, UTIL_COLL_SCATTER_OP,
 				    flags, context,
 				    coll_collective_comp);
@@ -1143,15 +2506,324 @@ ssize_t coll_ep_scatter(struct fid_ep *ep, const void *buf, size_t count,
 	if (ret)
 		goto err;
 
+	coll_persist_op(scatter_op, &key);
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_start_work(util_ep, scatter_op);
+
+	return FI_SUCCESS;
+err:
+	coll_free_op(scatter_op);
+	return ret;
+}
+
+ssize_t coll_ep_alltoall(struct fid_ep *ep, const void *buf, size_t count,
+			 void *desc, void *result, void *result_desc,
+			 fi_addr_t coll_addr, enum fi_datatype datatype,
+			 uint64_t flags, void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *alltoall_op;
+	struct util_ep *util_ep;
+	struct util_coll_key key = {
+		.ep = ep,
+		.type = UTIL_COLL_ALLTOALL_OP,
+		.buf = buf,
+		.result = result,
+		.count = count,
+		.datatype = datatype,
+	};
+	size_t nbytes, numranks;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	if (coll_resume_op(ep, coll_mc, &key, flags, context))
+		return FI_SUCCESS;
+
+	alltoall_op = coll_create_op(ep, coll_mc, UTIL_COLL_ALLTOALL_OP,
+				     flags, context, coll_collective_comp);
+	if (!alltoall_op)
+		return -FI_ENOMEM;
+
+	nbytes = count * ofi_datatype_size(datatype);
+	numranks = coll_mc->av_set->fi_addr_count;
+	if (coll_select(coll_mc, FI_ALLTOALL, count, datatype).alg ==
+	    COLL_ALG_BRUCK) {
+		/* rotated blocks, plus packed blocks to send and receive */
+		alltoall_op->data.scratch = malloc(3 * numranks * nbytes);
+		if (!alltoall_op->data.scratch) {
+			ret = -FI_ENOMEM;
+			goto err;
+		}
+
+		ret = coll_do_alltoall_bruck(alltoall_op, buf, result,
+					     alltoall_op->data.scratch, count,
+					     datatype);
+	} else {
+		ret = coll_do_alltoall_pairwise(alltoall_op, buf, result,
+						count, datatype);
+	}
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(alltoall_op);
+	if (ret)
+		goto err;
+
+	coll_persist_op(alltoall_op, &key);
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_start_work(util_ep, alltoall_op);
+
+	return FI_SUCCESS;
+err:
+	free(alltoall_op->data.scratch);
+	coll_free_op(alltoall_op);
+	return ret;
+}
+
+ssize_t coll_ep_reduce_scatter(struct fid_ep *ep, const void *buf,
+			       size_t count, void *desc, void *result,
+			       void *result_desc, fi_addr_t coll_addr,
+			       enum fi_datatype datatype, enum fi_op op,
+			       uint64_t flags, void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *reduce_scatter_op;
+	struct util_ep *util_ep;
+	struct util_coll_key key = {
+		.ep = ep,
+		.type = UTIL_COLL_REDUCE_SCATTER_OP,
+		.buf = buf,
+		.result = result,
+		.count = count,
+		.datatype = datatype,
+		.op = op,
+	};
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	if (coll_resume_op(ep, coll_mc, &key, flags, context))
+		return FI_SUCCESS;
+
+	reduce_scatter_op = coll_create_op(ep, coll_mc,
+					   UTIL_COLL_REDUCE_SCATTER_OP, flags,
+					   context, coll_collective_comp);
+	if (!reduce_scatter_op)
+		return -FI_ENOMEM;
+
+	reduce_scatter_op->data.scratch = malloc(count *
+						 ofi_datatype_size(datatype));
+	if (!reduce_scatter_op->data.scratch) {
+		ret = -FI_ENOMEM;
+		goto err;
+	}
+
+	ret = coll_do_reduce_scatter(reduce_scatter_op, buf, result,
+				     reduce_scatter_op->data.scratch, count,
+				     datatype, op);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(reduce_scatter_op);
+	if (ret)
+		goto err;
+
+	coll_persist_op(reduce_scatter_op, &key);
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_start_work(util_ep, reduce_scatter_op);
+
+	return FI_SUCCESS;
+err:
+	free(reduce_scatter_op->data.scratch);
+	coll_free_op(reduce_scatter_op);
+	return ret;
+}
+
+ssize_t coll_ep_reduce(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, enum fi_op op,
+		       uint64_t flags, void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *reduce_op;
+	struct util_ep *util_ep;
+	struct util_coll_key key = {
+		.ep = ep,
+		.type = UTIL_COLL_REDUCE_OP,
+		.buf = buf,
+		.result = result,
+		.count = count,
+		.datatype = datatype,
+		.op = op,
+		.root = root_addr,
+	};
+	size_t nbytes;
+	void *acc, *tmp_buf;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	if (coll_resume_op(ep, coll_mc, &key, flags, context))
+		return FI_SUCCESS;
+
+	reduce_op = coll_create_op(ep, coll_mc, UTIL_COLL_REDUCE_OP, flags,
+				   context, coll_collective_comp);
+	if (!reduce_op)
+		return -FI_ENOMEM;
+
+	/* the root reduces into result, other ranks into scratch */
+	nbytes = count * ofi_datatype_size(datatype);
+	reduce_op->data.scratch = malloc(2 * nbytes);
+	if (!reduce_op->data.scratch) {
+		ret = -FI_ENOMEM;
+		goto err;
+	}
+
+	if (coll_mc->local_rank == root_addr) {
+		acc = result;
+		tmp_buf = reduce_op->data.scratch;
+	} else {
+		acc = reduce_op->data.scratch;
+		tmp_buf = (char *) reduce_op->data.scratch + nbytes;
+	}
+
+	if (coll_select(coll_mc, FI_REDUCE, count, datatype).alg ==
+	    COLL_ALG_BINOMIAL)
+		ret = coll_do_reduce_binomial(reduce_op, buf, acc, tmp_buf,
+					      count, root_addr, datatype, op);
+	else
+		ret = coll_do_reduce_rsgather(reduce_op, buf, acc, tmp_buf,
+					      count, root_addr, datatype, op);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(reduce_op);
+	if (ret)
+		goto err;
+
+	coll_persist_op(reduce_op, &key);
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_start_work(util_ep, reduce_op);
+
+	return FI_SUCCESS;
+err:
+	free(reduce_op->data.scratch);
+	coll_free_op(reduce_op);
+	return ret;
+}
+
+ssize_t coll_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, uint64_t flags,
+		       void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *gather_op;
+	struct util_ep *util_ep;
+	struct util_coll_key key = {
+		.ep = ep,
+		.type = UTIL_COLL_GATHER_OP,
+		.buf = buf,
+		.result = result,
+		.count = count,
+		.datatype = datatype,
+		.root = root_addr,
+	};
+	uint64_t relative_rank;
+	size_t numranks, subtree;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	if (coll_resume_op(ep, coll_mc, &key, flags, context))
+		return FI_SUCCESS;
+
+	gather_op = coll_create_op(ep, coll_mc, UTIL_COLL_GATHER_OP, flags,
+				   context, coll_collective_comp);
+	if (!gather_op)
+		return -FI_ENOMEM;
+
+	/* room for the data of the subtree, except at a root of rank 0 */
+	numranks = coll_mc->av_set->fi_addr_count;
+	relative_rank = (coll_mc->local_rank + numranks - root_addr) %
+			numranks;
+	subtree = relative_rank ?
+		  util_binomial_tree_values_to_recv(relative_rank, numranks) :
+		  numranks;
+	if (relative_rank || root_addr) {
+		gather_op->data.scratch = malloc(subtree * count *
+						 ofi_datatype_size(datatype));
+		if (!gather_op->data.scratch) {
+			ret = -FI_ENOMEM;
+			goto err;
+		}
+	}
+
+	ret = coll_do_gather(gather_op, buf, result, gather_op->data.scratch,
+			     count, root_addr, datatype);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(gather_op);
+	if (ret)
+		goto err;
+
+	coll_persist_op(gather_op, &key);
 	util_ep = container_of(ep, struct util_ep, ep_fid);
-	coll_progress_work(util_ep, scatter_op);
+	coll_start_work(util_ep, gather_op);
 
 	return FI_SUCCESS;
 err:
-	free(scatter_op);
+	free(gather_op->data.scratch);
+	coll_free_op(gather_op);
 	return ret;
 }
 
+/*
+ * Broadcast implemented as a segmented pipeline along a chain of ranks
+ * starting at the root.  Each segment is forwarded as soon as it arrives,
+ * while the next one is being received, so a broadcast of S segments takes
+ * about S + p - 2 segment times.
+ */
+static int coll_do_bcast_pipeline(struct util_coll_operation *coll_op,
+				  void *buf, size_t count, uint64_t root,
+				  enum fi_datatype datatype)
+{
+	uint64_t local_rank, prev_rank, next_rank, relative_rank;
+	size_t dsize = ofi_datatype_size(datatype);
+	size_t numranks, seg_cnt, cnt, i;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	relative_rank = (local_rank + numranks - root) % numranks;
+	prev_rank = (local_rank + numranks - 1) % numranks;
+	next_rank = (local_rank + 1) % numranks;
+	seg_cnt = MAX(COLL_BCAST_SEGMENT / dsize, 1);
+
+	for (i = 0; i < count; i += seg_cnt) {
+		cnt = MIN(seg_cnt, count - i);
+
+		/* the forward of a segment overlaps the receive of the next */
+		if (relative_rank) {
+			ret = coll_sched_recv(coll_op, prev_rank,
+					      (char *) buf + i * dsize, cnt,
+					      datatype, 1);
+			if (ret)
+				return ret;
+		}
+
+		if (relative_rank + 1 < numranks) {
+			ret = coll_sched_send(coll_op, next_rank,
+					      (char *) buf + i * dsize, cnt,
+					      datatype, 0);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return FI_SUCCESS;
+}
+
 ssize_t coll_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 			  void *desc, fi_addr_t coll_addr, fi_addr_t root_addr,
 			  enum fi_datatype datatype, uint64_t flags,
@@ -1160,10 +2832,21 @@ ssize_t coll_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 	struct util_coll_mc *coll_mc;
 	struct util_coll_operation *broadcast_op;
 	struct util_ep *util_ep;
+	struct util_coll_key key = {
+		.ep = ep,
+		.type = UTIL_COLL_BROADCAST_OP,
+		.buf = buf,
+		.count = count,
+		.datatype = datatype,
+		.root = root_addr,
+	};
 	uint64_t chunk_cnt, numranks, local;
 	int ret;
 
 	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	if (coll_resume_op(ep, coll_mc, &key, flags, context))
+		return FI_SUCCESS;
+
 	broadcast_op = coll_create_op(ep, coll_mc, UTIL_COLL_BROADCAST_OP,
 				      flags, context,
 				      coll_collective_comp);
@@ -1172,6 +2855,20 @@ ssize_t coll_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 
 	local = broadcast_op->mc->local_rank;
 	numranks = broadcast_op->mc->av_set->fi_addr_count;
+
+	/*
+	 * Once there are enough segments, filling the pipeline costs less
+	 * than the second pass over the data of scatter plus allgather.
+	 */
+	if (coll_select(coll_mc, FI_BROADCAST, count, datatype).alg ==
+	    COLL_ALG_PIPELINE) {
+		ret = coll_do_bcast_pipeline(broadcast_op, buf, count,
+					     root_addr, datatype);
+		if (ret)
+			goto err1;
+		goto comp;
+	}
+
 	chunk_cnt = (count + numranks - 1) / numranks;
 	if (chunk_cnt * local > count &&
 	    chunk_cnt * local - (int) count > chunk_cnt)
@@ -1197,18 +2894,20 @@ ssize_t coll_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 	if (ret)
 		goto err2;
 
+comp:
 	ret = coll_sched_comp(broadcast_op);
 	if (ret)
 		goto err2;
 
+	coll_persist_op(broadcast_op, &key);
 	util_ep = container_of(ep, struct util_ep, ep_fid);
-	coll_progress_work(util_ep, broadcast_op);
+	coll_start_work(util_ep, broadcast_op);
 
 	return FI_SUCCESS;
 err2:
 	free(broadcast_op->data.broadcast.chunk);
 err1:
-	free(broadcast_op);
+	coll_free_op(broadcast_op);
 	return ret;
 }
 
@@ -1221,8 +2920,6 @@ ssize_t coll_peer_xfer_complete(struct fid_ep *ep,
 	struct util_coll_xfer_item *xfer_item;
 
 	xfer_item = cqe->op_context;
-	xfer_item->hdr.state = UTIL_COLL_COMPLETE;
-
 	coll_op = xfer_item->hdr.coll_op;
 	FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
 	       "\tXfer complete: { %p %s Remote: 0x%02x Local: "
@@ -1232,7 +2929,7 @@ ssize_t coll_peer_xfer_complete(struct fid_ep *ep,
 	       xfer_item->count, ofi_datatype_size(xfer_item->datatype));
 
 	util_ep = container_of(coll_op->ep, struct util_ep, ep_fid);
-	coll_progress_work(util_ep, coll_op);
+	coll_complete_work(util_ep, &xfer_item->hdr);
 
 	return 0;
 }
@@ -1241,13 +2938,10 @@ ssize_t coll_peer_xfer_error(struct fid_ep *ep, struct fi_cq_err_entry *cqerr)
 {
 	struct util_coll_operation *coll_op;
 	struct util_coll_xfer_item *xfer_item;
+	struct util_ep *util_ep;
 
 	xfer_item = cqerr->op_context;
-	xfer_item->hdr.state = UTIL_COLL_COMPLETE;
-
 	coll_op = xfer_item->hdr.coll_op;
-	/* Eliminate non-debug build warning */
-	(void) coll_op;
 
 	FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
 	       "\tXfer error: { %p %s Remote: 0x%02x Local: "
@@ -1257,6 +2951,8 @@ ssize_t coll_peer_xfer_error(struct fid_ep *ep, struct fi_cq_err_entry *cqerr)
 	       xfer_item->count, ofi_datatype_size(xfer_item->datatype));
 
 	/* TODO: finish the work with error */
+	util_ep = container_of(coll_op->ep, struct util_ep, ep_fid);
+	coll_complete_work(util_ep, &xfer_item->hdr);
 
 	return 0;
 }
@@ -1278,9 +2974,13 @@ int coll_query_collective(struct fid_domain *dom_fid,
 	case FI_ALLGATHER:
 	case FI_SCATTER:
 	case FI_BROADCAST:
+	case FI_ALLTOALL:
+	case FI_GATHER:
 		ret = FI_SUCCESS;
 		break;
 	case FI_ALLREDUCE:
+	case FI_REDUCE_SCATTER:
+	case FI_REDUCE:
 		if (FI_MIN <= attr->op && FI_BXOR >= attr->op)
 			ret = fi_query_atomic(peer_domain, attr->datatype,
 					      attr->op, &attr->datatype_attr,
@@ -1288,10 +2988,6 @@ int coll_query_collective(struct fid_domain *dom_fid,
 		else
 			return -FI_ENOSYS;
 		break;
-	case FI_ALLTOALL:
-	case FI_REDUCE_SCATTER:
-	case FI_REDUCE:
-	case FI_GATHER:
 	default:
 		return -FI_ENOSYS;
 	}
@@ -109,6 +109,12 @@
 
 #define CXIP_PTE_IGNORE_DROPS		((1 << 24) - 1)
 #define CXIP_RDZV_THRESHOLD		2048
+#define CXIP_RDZV_ADAPT_INTERVAL	64
+#define CXIP_TXQ_MORE_MAX		32
+#define CXIP_MAP_PREFETCH_ALIGN		(1UL << 21)
+#define CXIP_RDZV_ADAPT_LAT_USEC	100
+#define CXIP_HYBRID_HW_RECOVERY_USEC	100000
+#define CXIP_TELEMETRY_RING_SIZE	1024
 #define CXIP_OFLOW_BUF_SIZE		(2*1024*1024)
 #define CXIP_OFLOW_BUF_MIN_POSTED	3
 #define CXIP_OFLOW_BUF_MAX_CACHED	(CXIP_OFLOW_BUF_MIN_POSTED * 3)
@@ -176,6 +182,7 @@
 #define CXIP_WIRE_PROTO_VERSION		1
 
 #define	CXIP_COLL_MAX_CONCUR		8
+#define	CXIP_COLL_MAX_PENDING		64
 #define	CXIP_COLL_MIN_RX_BUFS		8
 #define	CXIP_COLL_MIN_RX_SIZE		4096
 #define	CXIP_COLL_MIN_MULTI_RECV	64
@@ -252,6 +259,8 @@ struct cxip_environment {
 	size_t rdzv_threshold;
 	size_t rdzv_get_min;
 	size_t rdzv_eager_size;
+	int rdzv_adaptive;
+	size_t rdzv_adaptive_lat_usec;
 	int rdzv_aligned_sw_rget;
 	int disable_non_inject_msg_idc;
 	int disable_host_register;
@@ -280,6 +289,7 @@ struct cxip_environment {
 	size_t default_vni;
 
 	size_t eq_ack_batch_size;
+	size_t eq_progress_budget;
 	int fc_retry_usec_delay;
 	size_t ctrl_rx_eq_max_size;
 	char *device_name;
@@ -292,6 +302,7 @@ struct cxip_environment {
 	char *coll_job_step_id;
 	size_t coll_retry_usec;
 	size_t coll_timeout_usec;
+	size_t coll_max_pending;
 	char *coll_fabric_mgr_url;
 	char *coll_mcast_token;
 	size_t hwcoll_addrs_per_job;
@@ -301,12 +312,16 @@ struct cxip_environment {
 	char hostname[255];
 	char *telemetry;
 	int telemetry_rgid;
+	size_t telemetry_sample_msec;
+	size_t telemetry_ring_size;
 	int disable_hmem_dev_register;
 	int ze_hmem_supported;
 	enum cxip_rdzv_proto  rdzv_proto;
 	int enable_trig_op_limit;
 	int hybrid_posted_recv_preemptive;
 	int hybrid_unexpected_msg_preemptive;
+	int hybrid_hw_recovery;
+	size_t hybrid_hw_recovery_usec;
 };
 
 extern struct cxip_environment cxip_env;
@@ -738,6 +753,7 @@ struct cxip_cmdq {
 	struct cxi_cq *dev_cmdq;
 	struct c_cstate_cmd c_state;
 	enum cxip_llring_mode llring_mode;
+	unsigned int more_cnt;		// Commands waiting on a doorbell
 
 	struct cxi_cp *cur_cp;
 	struct cxip_lni *lni;
@@ -797,12 +813,29 @@ struct cxip_telemetry {
 
 	/* List of telemetry entries to being monitored. */
 	struct dlist_entry telemetry_list;
+
+	/* Optional sampler thread recording telemetry deltas into a ring of
+	 * samples. The ring lock also protects sampler_stop.
+	 */
+	pthread_t sampler;
+	bool sampler_running;
+	bool sampler_stop;
+	pthread_mutex_t ring_lock;
+	pthread_cond_t sampler_cond;
+	struct fi_cxi_telemetry_sample *ring;
+	size_t ring_size;
+	size_t ring_head;
+	size_t ring_cnt;
+	uint64_t ring_lost;
 };
 
 void cxip_telemetry_dump_delta(struct cxip_telemetry *telemetry);
 void cxip_telemetry_free(struct cxip_telemetry *telemetry);
 int cxip_telemetry_alloc(struct cxip_domain *dom,
 			 struct cxip_telemetry **telemetry);
+ssize_t cxip_telemetry_read(struct cxip_telemetry *telemetry,
+			    struct fi_cxi_telemetry_sample *samples,
+			    size_t count, uint64_t *lost);
 
 #define TELEMETRY_ENTRY_NAME_SIZE 64U
 
@@ -815,6 +848,9 @@ struct cxip_telemetry_entry {
 
 	/* Telemetry value. */
 	unsigned long value;
+
+	/* Telemetry value at the previous sample. */
+	unsigned long sample_value;
 };
 
 struct cxip_domain_cmdq {
@@ -1156,6 +1192,7 @@ struct cxip_req_send {
 	};
 	int rc;				// DMA return code
 	int rdzv_send_events;		// Processed event count
+	uint64_t rdzv_start_ns;		// Rendezvous start, adaptive mode
 };
 
 struct cxip_req_rdzv_src {
@@ -1604,9 +1641,9 @@ enum cxip_rxc_state {
 	 * RX matching mode.
 	 *
 	 * Validate state changes:
-	 * RXC_PENDING_PTLTE_HARDWARE: TODO: When able, software may
-	 * initiate a transition from software managed mode back to
-	 * fully offloaded operation.
+	 * RXC_PENDING_PTLTE_HARDWARE: With FI_CXI_HYBRID_HW_RECOVERY, a
+	 * hybrid RXC which stayed quiet long enough initiates a transition
+	 * from software managed mode back to fully offloaded operation.
 	 * RXC_ONLODAD_FLOW_CONTROL_REENABLE: Hardware was unable to match
 	 * on the request list or the EQ is full. Hardware has disabled the
 	 * PtlTE initiating flow control. Operation can continue if LE
@@ -1615,9 +1652,14 @@ enum cxip_rxc_state {
 	 */
 	RXC_ENABLED_SOFTWARE,
 
-	/* TODO: Hybrid RX match mode PtlTE is transitioning from software
+	/* Hybrid RX match mode PtlTE is transitioning from software
 	 * managed operation back to fully offloaded operation.
 	 *
+	 * Overflow buffers have been linked and the PtlTE enable command
+	 * issued. Messages landing on the request list are still matched in
+	 * software. When the enable event arrives, receives queued in
+	 * software are appended to the priority list in order.
+	 *
 	 * Validate state changes:
 	 * RXC_ENABLED: Hybrid software managed PtlTE successfully
 	 * transitions back to fully offloaded operation.
@@ -1798,6 +1840,12 @@ struct cxip_rxc {
 	int num_fc_req_full;
 	int num_sc_nic_hw2sw_append_fail;
 	int num_sc_nic_hw2sw_unexp;
+	int num_sc_sw2hw;
+
+	/* Time after which a software managed RXC attempts to return to
+	 * hardware matching, see FI_CXI_HYBRID_HW_RECOVERY.
+	 */
+	uint64_t hw_recovery_ns;
 
 	/* Unexpected message handling */
 	struct cxip_ptelist_bufpool *req_list_bufpool;
@@ -2107,6 +2155,13 @@ struct cxip_txc {
 	int rdzv_eager_size;
 	struct cxip_cmdq *rx_cmdq;	// Target cmdq for Rendezvous buffers
 
+	/* Eager/rendezvous cut-over in adaptive mode, protected by
+	 * ep_obj->lock
+	 */
+	size_t eager_limit;
+	unsigned int eager_adapt_cnt;
+	uint64_t rdzv_lat_ns;		// Short rendezvous latency average
+
 #if ENABLE_DEBUG
 	uint64_t force_err;
 #endif
@@ -2606,6 +2661,16 @@ struct cxip_coll_reduction {
 	uint8_t tx_msg[64];			// static packet memory
 };
 
+/* Reduction waiting in software for its reduction ID to be released */
+struct cxip_coll_pending {
+	struct dlist_entry entry;		// Link to mc pending list
+	struct cxip_req *req;			// operation request
+	struct cxip_coll_data coll_data;	// converted user data
+	void *op_rslt_data;			// user recv buffer (or NULL)
+	int op_data_bytcnt;			// bytes in send/recv buffers
+	void *op_context;			// caller's context
+};
+
 struct cxip_coll_mc {
 	struct fid_mc mc_fid;
 	struct dlist_entry entry;		// Link to mc object list
@@ -2621,6 +2686,8 @@ struct cxip_coll_mc {
 	int tail_red_id;			// tail active red_id
 	int next_red_id;			// next available red_id
 	int max_red_id;				// limit total concurrency
+	struct dlist_entry pending_list;	// reductions past max_red_id
+	size_t pending_cnt;			// length of pending_list
 	int seqno;				// rolling seqno for packets
 	bool arm_disable;			// arm-disable for testing
 	bool is_joined;				// true if joined
@@ -2836,6 +2903,7 @@ int cxip_recv_cancel(struct cxip_req *req);
 int cxip_fc_process_drops(struct cxip_ep_obj *ep_obj, uint32_t nic_addr,
 			  uint32_t pid, uint16_t vni, uint16_t drops);
 void cxip_recv_pte_cb(struct cxip_pte *pte, const union c_event *event);
+void cxip_recv_hw_recovery(struct cxip_rxc *rxc);
 void cxip_rxc_req_fini(struct cxip_rxc *rxc);
 int cxip_rxc_oflow_init(struct cxip_rxc *rxc);
 void cxip_rxc_oflow_fini(struct cxip_rxc *rxc);
@@ -2910,6 +2978,8 @@ void cxip_iomm_fini(struct cxip_domain *dom);
 int cxip_map(struct cxip_domain *dom, const void *buf, unsigned long len,
 	     uint64_t flags, struct cxip_md **md);
 void cxip_unmap(struct cxip_md *md);
+int cxip_map_prefetch(struct cxip_domain *dom, const void *buf,
+		      unsigned long len);
 
 int cxip_ctrl_msg_send(struct cxip_ctrl_req *req);
 void cxip_ep_ctrl_progress(struct cxip_ep_obj *ep_obj);
@@ -2988,25 +3058,47 @@ static inline int cxip_fc_reason(const union c_event *event)
 	return event->tgt_long.initiator.state_change.sc_reason;
 }
 
+/* Ring the doorbell for commands deferred with FI_MORE. Used by progress,
+ * and when the command queue is full so that the NIC can drain it. Caller
+ * must hold the lock protecting the command queue.
+ */
+static inline void cxip_txq_flush(struct cxip_cmdq *cmdq)
+{
+	if (cmdq->more_cnt) {
+		cmdq->more_cnt = 0;
+		cxi_cq_ring(cmdq->dev_cmdq);
+	}
+}
+
 static inline void cxip_txq_ring(struct cxip_cmdq *cmdq, bool more,
 				 int otx_reqs)
 {
-	if (!more) {
-		switch (cmdq->llring_mode) {
-		case CXIP_LLRING_IDLE:
-			if (!otx_reqs)
-				cxi_cq_ll_ring(cmdq->dev_cmdq);
-			else
-				cxi_cq_ring(cmdq->dev_cmdq);
-			break;
-		case CXIP_LLRING_ALWAYS:
+	/* FI_MORE defers the doorbell, bounded so that a long stream of
+	 * FI_MORE operations still reaches the NIC.
+	 */
+	if (more && ++cmdq->more_cnt < CXIP_TXQ_MORE_MAX)
+		return;
+
+	/* A low-latency ring only carries the last command */
+	if (cmdq->more_cnt) {
+		cxip_txq_flush(cmdq);
+		return;
+	}
+
+	switch (cmdq->llring_mode) {
+	case CXIP_LLRING_IDLE:
+		if (!otx_reqs)
 			cxi_cq_ll_ring(cmdq->dev_cmdq);
-			break;
-		case CXIP_LLRING_NEVER:
-		default:
+		else
 			cxi_cq_ring(cmdq->dev_cmdq);
-			break;
-		}
+		break;
+	case CXIP_LLRING_ALWAYS:
+		cxi_cq_ll_ring(cmdq->dev_cmdq);
+		break;
+	case CXIP_LLRING_NEVER:
+	default:
+		cxi_cq_ring(cmdq->dev_cmdq);
+		break;
 	}
 }
 
@@ -117,6 +117,39 @@ struct fi_cxi_cntr_ops {
 	int (*get_mmio_addr)(struct fid *fid, void **addr, size_t *len);
 };
 
+/*
+ * Telemetry sampling extension, opened on the domain with fi_open_ops(). The
+ * FI_CXI_TELEMETRY_SAMPLE_MSEC environment variable enables a sampler thread
+ * which periodically records the change of each FI_CXI_TELEMETRY entry into a
+ * ring of samples. Only non-zero deltas are recorded.
+ */
+#define FI_CXI_TELEMETRY_OPS "cxi_telemetry_ops"
+
+struct fi_cxi_telemetry_sample {
+	/* Monotonic time, in nanoseconds, at which the sample was taken. */
+	uint64_t timestamp;
+
+	/* Telemetry file name. Valid until the domain is closed. */
+	const char *name;
+
+	/* Change of the telemetry value since the previous sample. */
+	uint64_t delta;
+};
+
+struct fi_cxi_telemetry_ops {
+	/*
+	 * Remove up to count of the oldest samples from the ring and copy
+	 * them to samples. If lost is not NULL, it is set to the number of
+	 * samples overwritten since the previous read because the ring was
+	 * full.
+	 *
+	 * Return: Number of samples copied, or -FI_ENOSYS if telemetry
+	 * sampling is not enabled on the domain.
+	 */
+	ssize_t (*read)(struct fid *fid, struct fi_cxi_telemetry_sample *samples,
+			size_t count, uint64_t *lost);
+};
+
 /* Success values cannot exceed FI_CXI_CNTR_SUCCESS_MAX */
 #define FI_CXI_CNTR_SUCCESS_MAX ((1ULL << 48) - 1)
 
@@ -223,6 +256,7 @@ static inline void *fi_cxi_get_cntr_reseterr_addr(void *cntr_mmio)
 #define FI_CXI_DOM_OPS_4 "dom_ops_v4"
 #define FI_CXI_DOM_OPS_5 "dom_ops_v5"
 #define FI_CXI_DOM_OPS_6 "dom_ops_v6"
+#define FI_CXI_DOM_OPS_7 "dom_ops_v7"
 
 /* v1 to v6 can use the same struct since they only appended a routine */
 struct fi_cxi_dom_ops {
@@ -296,6 +330,23 @@ struct fi_cxi_dom_ops {
 	 */
 	int (*enable_mr_match_events)(struct fid *fid, bool enable);
 	int (*enable_optimized_mrs)(struct fid *fid, bool enable);
+
+	/* Map local buffers for the NIC ahead of use.
+	 *
+	 * Buffers used without a memory descriptor are mapped on first use,
+	 * which can stall the first transfer from a large buffer. Prefetching
+	 * establishes the mappings at a time of the user's choosing; they
+	 * remain cached until the memory is freed or evicted from the cache.
+	 *
+	 * @fid: Domain FID.
+	 * @iov: Buffers to map.
+	 * @count: Number of entries in iov.
+	 *
+	 * Return: FI_SUCCESS on success, -FI_EOPNOTSUPP if the memory
+	 * registration cache is disabled, or another -FI_ERRNO.
+	 */
+	int (*map_prefetch)(struct fid *fid, const struct iovec *iov,
+			    size_t count);
 };
 
 /*
@@ -1911,6 +1911,52 @@ bool _is_red_timed_out(struct cxip_coll_reduction *reduction)
 	return true;
 }
 
+/* Start a reduction on the next reduction ID, which must be free */
+static void _start_reduction(struct cxip_coll_mc *mc_obj, struct cxip_req *req,
+			     const struct cxip_coll_data *coll_data,
+			     void *op_rslt_data, int bytcnt, void *context)
+{
+	struct cxip_coll_reduction *reduction;
+
+	reduction = &mc_obj->reduction[mc_obj->next_red_id];
+	assert(!reduction->in_use);
+
+	/* advance next_red_id, reserving this one for us */
+	INCMOD(mc_obj->next_red_id, mc_obj->max_red_id);
+	reduction->in_use = true;
+
+	/* Set up the reduction structure */
+	reduction->op_rslt_data = op_rslt_data;
+	reduction->op_data_bytcnt = bytcnt;
+	reduction->op_context = context;
+	reduction->op_inject_req = req;
+	reduction->op_inject_req->context = (uint64_t)context;
+
+	/* reduce data into accumulator */
+	_reduce(&reduction->accum, coll_data, false);
+	_dump_coll_data("coll_data initialized inj", coll_data);
+
+	/* Progress the collective */
+	_progress_coll(reduction, NULL);
+}
+
+/* Start queued reductions, in order, as their reduction IDs are released */
+static void _start_pending(struct cxip_coll_mc *mc_obj)
+{
+	struct cxip_coll_pending *pending;
+
+	while (!dlist_empty(&mc_obj->pending_list) &&
+	       !mc_obj->reduction[mc_obj->next_red_id].in_use) {
+		dlist_pop_front(&mc_obj->pending_list,
+				struct cxip_coll_pending, pending, entry);
+		mc_obj->pending_cnt--;
+		_start_reduction(mc_obj, pending->req, &pending->coll_data,
+				 pending->op_rslt_data, pending->op_data_bytcnt,
+				 pending->op_context);
+		free(pending);
+	}
+}
+
 /* Root node state machine progress.
  * !pkt means this is progressing from injection call (e.g. fi_reduce())
  *  pkt means this is progressing from event callback (leaf packet)
@@ -1997,6 +2043,7 @@ post_complete:
 		INCMOD(mc_obj->tail_red_id, mc_obj->max_red_id);
 		reduction = &mc_obj->reduction[mc_obj->tail_red_id];
 	}
+	_start_pending(mc_obj);
 }
 
 /* Leaf node state machine progress.
@@ -2075,6 +2122,7 @@ post_complete:
 		INCMOD(mc_obj->tail_red_id, mc_obj->max_red_id);
 		reduction = &mc_obj->reduction[mc_obj->tail_red_id];
 	}
+	_start_pending(mc_obj);
 }
 
 /* Root or leaf progress state machine.
@@ -2117,30 +2165,55 @@ _cxip_coll_prereduce(int cxi_opcode, const void *op_send_data,
 	_reduce(accum, coll_data_ptr, true);
 }
 
+/* Queue a reduction until its reduction ID is released */
+static int _queue_reduction(struct cxip_coll_mc *mc_obj, struct cxip_req *req,
+			    const struct cxip_coll_data *coll_data,
+			    void *op_rslt_data, int bytcnt, void *context)
+{
+	struct cxip_coll_pending *pending;
+
+	pending = calloc(1, sizeof(*pending));
+	if (!pending)
+		return -FI_ENOMEM;
+
+	pending->req = req;
+	pending->req->context = (uint64_t)context;
+	memcpy(&pending->coll_data, coll_data, sizeof(*coll_data));
+	pending->op_rslt_data = op_rslt_data;
+	pending->op_data_bytcnt = bytcnt;
+	pending->op_context = context;
+	dlist_insert_tail(&pending->entry, &mc_obj->pending_list);
+	mc_obj->pending_cnt++;
+
+	return FI_SUCCESS;
+}
+
 /* Generic collective injection into fabric.
  *
  * Reduction ID is normally hidden. Can be exposed by calling _capture_red_id()
  * just before calling a reduction operation.
  *
- * - Acquires next available reduction structure in MC, or returns -FI_EAGAIN.
  * - Acquires evtq request, or return -FI_EAGAIN.
- * - Marks reduction structure in-use.
- * - Advances next available reduction pointer.
- * - Initializes:
- *   - result data pointer
- *   - source data (pre-reduced or raw)
- *   - data byte count
- * - Reduces user data into reduction accumulator (may already contain data)
- * - Progresses reduction (no packet supplied)
+ * - Converts user data (raw) to a cxip_coll_data structure, or uses the
+ *   pre-reduced structure supplied by the caller as-is.
+ * - If the next reduction ID is free, starts the reduction on it:
+ *   - Marks reduction structure in-use.
+ *   - Advances next available reduction pointer.
+ *   - Reduces user data into reduction accumulator (may already contain data)
+ *   - Progresses reduction (no packet supplied)
+ * - Otherwise queues the reduction, up to cxip_env.coll_max_pending of them,
+ *   or returns -FI_EAGAIN. Queued reductions start in order as reductions
+ *   complete, so every node still uses the same reduction ID for them.
  */
 static ssize_t
 _cxip_coll_inject(struct cxip_coll_mc *mc_obj, int cxi_opcode,
 		  const void *op_send_data, void *op_rslt_data,
 		  size_t bytcnt, uint64_t flags, void *context)
 {
-	struct cxip_coll_reduction *reduction;
+	const struct cxip_coll_data *coll_data_ptr;
 	struct cxip_coll_data coll_data;
 	struct cxip_req *req;
+	bool queue;
 	int ret;
 
 	TRACE_DEBUG("%s entry\n", __func__);
@@ -2148,8 +2221,9 @@ _cxip_coll_inject(struct cxip_coll_mc *mc_obj, int cxi_opcode,
 	ofi_genlock_lock(&mc_obj->ep_obj->lock);
 
 	/* must observe strict round-robin across all nodes */
-	reduction = &mc_obj->reduction[mc_obj->next_red_id];
-	if (reduction->in_use) {
+	queue = mc_obj->reduction[mc_obj->next_red_id].in_use ||
+		!dlist_empty(&mc_obj->pending_list);
+	if (queue && mc_obj->pending_cnt >= cxip_env.coll_max_pending) {
 		ret = -FI_EAGAIN;
 		goto quit;
 	}
@@ -2163,33 +2237,30 @@ _cxip_coll_inject(struct cxip_coll_mc *mc_obj, int cxi_opcode,
 
 	/* Used for debugging */
 	if (_injected_red_id_buf) {
-		*_injected_red_id_buf = reduction->red_id;
+		*_injected_red_id_buf = (mc_obj->next_red_id +
+					 mc_obj->pending_cnt) %
+					mc_obj->max_red_id;
 		_injected_red_id_buf = NULL;
 	}
 
-	/* advance next_red_id, reserving this one for us */
-	INCMOD(mc_obj->next_red_id, mc_obj->max_red_id);
-	reduction->in_use = true;
-
-	/* Set up the reduction structure */
-	reduction->op_rslt_data = op_rslt_data;
-	reduction->op_data_bytcnt = bytcnt;
-	reduction->op_context = context;
-	reduction->op_inject_req = req;
-	reduction->op_inject_req->context = (uint64_t)context;
-
 	/* Convert user data to local coll_data structure */
-	if (flags & FI_CXI_PRE_REDUCED)
-		memcpy(&coll_data, op_send_data, sizeof(coll_data));
-	else
+	if (flags & FI_CXI_PRE_REDUCED) {
+		coll_data_ptr = op_send_data;
+	} else {
 		_init_coll_data(&coll_data, cxi_opcode, op_send_data, bytcnt);
+		coll_data_ptr = &coll_data;
+	}
 
-	/* reduce data into accumulator */
-	_reduce(&reduction->accum, &coll_data, false);
-	_dump_coll_data("coll_data initialized inj", &coll_data);
+	if (queue) {
+		ret = _queue_reduction(mc_obj, req, coll_data_ptr,
+				       op_rslt_data, bytcnt, context);
+		if (ret)
+			cxip_evtq_req_free(req);
+		goto quit;
+	}
 
-	/* Progress the collective */
-	_progress_coll(reduction, NULL);
+	_start_reduction(mc_obj, req, coll_data_ptr, op_rslt_data, bytcnt,
+			 context);
 	ret = FI_SUCCESS;
 
 quit:
@@ -2548,6 +2619,7 @@ fail:
 /* Close multicast collective object */
 static void _close_mc(struct cxip_coll_mc *mc_obj)
 {
+	struct cxip_coll_pending *pending;
 	int count;
 
 	if (!mc_obj)
@@ -2559,6 +2631,14 @@ static void _close_mc(struct cxip_coll_mc *mc_obj)
 	/* clear the avset alteration lockout */
 	mc_obj->av_set_obj->mc_obj = NULL;
 
+	/* drop reductions that never started */
+	while (!dlist_empty(&mc_obj->pending_list)) {
+		dlist_pop_front(&mc_obj->pending_list,
+				struct cxip_coll_pending, pending, entry);
+		cxip_evtq_req_free(pending->req);
+		free(pending);
+	}
+
 	/* unmap the reduction mem descriptor for DMA */
 	if (mc_obj->reduction_md)
 		cxil_unmap(mc_obj->reduction_md);
@@ -2633,6 +2713,7 @@ static int _initialize_mc(void *ptr)
 	mc_obj = calloc(1, sizeof(*mc_obj));
 	if (!mc_obj)
 		return -FI_ENOMEM;
+	dlist_init(&mc_obj->pending_list);
 
 	/* COMM_KEY_RANK model needs a distinct PTE for every MC object.
 	 * All other models share a single PTE for all MCs using an EP.
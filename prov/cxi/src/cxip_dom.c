@@ -1445,6 +1445,35 @@ static int cxip_domain_get_dwq_depth(struct fid *fid, size_t *depth)
 	return FI_SUCCESS;
 }
 
+static int cxip_domain_map_prefetch(struct fid *fid, const struct iovec *iov,
+				    size_t count)
+{
+	struct cxip_domain *dom;
+	size_t i;
+	int ret;
+
+	if (fid->fclass != FI_CLASS_DOMAIN) {
+		CXIP_WARN("Invalid FID: %p\n", fid);
+		return -FI_EINVAL;
+	}
+
+	dom = container_of(fid, struct cxip_domain,
+			   util_domain.domain_fid.fid);
+	if (!dom->enabled)
+		return -FI_EOPBADSTATE;
+
+	for (i = 0; i < count; i++) {
+		ret = cxip_map_prefetch(dom, iov[i].iov_base, iov[i].iov_len);
+		if (ret) {
+			CXIP_WARN("Failed to prefetch mapping (%p, %lu): %d\n",
+				  iov[i].iov_base, iov[i].iov_len, ret);
+			return ret;
+		}
+	}
+
+	return FI_SUCCESS;
+}
+
 static struct fi_cxi_dom_ops cxip_dom_ops_ext = {
 	.cntr_read = cxip_domain_cntr_read,
 	.topology = cxip_domain_topology,
@@ -1453,6 +1482,25 @@ static struct fi_cxi_dom_ops cxip_dom_ops_ext = {
 	.get_dwq_depth = cxip_domain_get_dwq_depth,
 	.enable_mr_match_events = cxip_domain_enable_mr_match_events,
 	.enable_optimized_mrs = cxip_domain_enable_optimized_mrs,
+	.map_prefetch = cxip_domain_map_prefetch,
+};
+
+static ssize_t cxip_dom_telemetry_read(struct fid *fid,
+				       struct fi_cxi_telemetry_sample *samples,
+				       size_t count, uint64_t *lost)
+{
+	struct cxip_domain *dom;
+
+	if (fid->fclass != FI_CLASS_DOMAIN)
+		return -FI_EINVAL;
+
+	dom = container_of(fid, struct cxip_domain, util_domain.domain_fid.fid);
+
+	return cxip_telemetry_read(dom->telemetry, samples, count, lost);
+}
+
+static struct fi_cxi_telemetry_ops cxip_dom_telemetry_ops = {
+	.read = cxip_dom_telemetry_read,
 };
 
 static int cxip_dom_ops_open(struct fid *fid, const char *ops_name,
@@ -1464,11 +1512,17 @@ static int cxip_dom_ops_open(struct fid *fid, const char *ops_name,
 	    !strcmp(ops_name, FI_CXI_DOM_OPS_3) ||
 	    !strcmp(ops_name, FI_CXI_DOM_OPS_4) ||
 	    !strcmp(ops_name, FI_CXI_DOM_OPS_5) ||
-	    !strcmp(ops_name, FI_CXI_DOM_OPS_6)) {
+	    !strcmp(ops_name, FI_CXI_DOM_OPS_6) ||
+	    !strcmp(ops_name, FI_CXI_DOM_OPS_7)) {
 		*ops = &cxip_dom_ops_ext;
 		return FI_SUCCESS;
 	}
 
+	if (!strcmp(ops_name, FI_CXI_TELEMETRY_OPS)) {
+		*ops = &cxip_dom_telemetry_ops;
+		return FI_SUCCESS;
+	}
+
 	return -FI_EINVAL;
 }
 
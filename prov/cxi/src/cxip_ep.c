@@ -183,6 +183,9 @@ void cxip_ep_progress(struct fid *fid)
 		cxip_evtq_progress(&ep_obj->rxc.rx_evtq);
 		cxip_evtq_progress(&ep_obj->txc.tx_evtq);
 		cxip_ep_ctrl_progress_locked(ep_obj);
+		cxip_recv_hw_recovery(&ep_obj->rxc);
+		if (ep_obj->txc.tx_cmdq)
+			cxip_txq_flush(ep_obj->txc.tx_cmdq);
 		ofi_genlock_unlock(&ep_obj->lock);
 	}
 }
@@ -355,6 +355,7 @@ void cxip_evtq_progress(struct cxip_evtq *evtq)
 {
 	const union c_event *event;
 	struct cxip_req *req;
+	size_t budget = cxip_env.eq_progress_budget;
 	int ret = FI_SUCCESS;
 
 	if (!evtq->eq || !evtq->cq)
@@ -391,6 +392,10 @@ void cxip_evtq_progress(struct cxip_evtq *evtq)
 			cxi_eq_ack_events(evtq->eq);
 			evtq->unacked_events = 0;
 		}
+
+		/* Leave remaining events to the next progress call */
+		if (budget && !--budget)
+			break;
 	}
 
 	if (cxi_eq_get_drops(evtq->eq)) {
@@ -584,6 +584,8 @@ struct cxip_environment cxip_env = {
 	.rdzv_threshold = CXIP_RDZV_THRESHOLD,
 	.rdzv_get_min = 2049, /* Avoid single packet Gets */
 	.rdzv_eager_size = CXIP_RDZV_THRESHOLD,
+	.rdzv_adaptive = false,
+	.rdzv_adaptive_lat_usec = CXIP_RDZV_ADAPT_LAT_USEC,
 	.rdzv_aligned_sw_rget = 1,
 	.disable_non_inject_msg_idc = 0,
 	.disable_host_register = 0,
@@ -598,6 +600,7 @@ struct cxip_environment cxip_env = {
 	.cq_policy = CXI_CQ_UPDATE_LOW_FREQ_EMPTY,
 	.default_vni = 10,
 	.eq_ack_batch_size = 32,
+	.eq_progress_budget = 0,
 	.req_buf_size = CXIP_REQ_BUF_SIZE,
 	.req_buf_min_posted = CXIP_REQ_BUF_MIN_POSTED,
 	.req_buf_max_cached = CXIP_REQ_BUF_MAX_CACHED,
@@ -608,6 +611,8 @@ struct cxip_environment cxip_env = {
 	.hybrid_recv_preemptive = 0,
 	.hybrid_posted_recv_preemptive = 0,
 	.hybrid_unexpected_msg_preemptive = 0,
+	.hybrid_hw_recovery = 0,
+	.hybrid_hw_recovery_usec = CXIP_HYBRID_HW_RECOVERY_USEC,
 	.fc_retry_usec_delay = 1000,
 	.ctrl_rx_eq_max_size = 67108864,
 	.default_cq_size = CXIP_CQ_DEF_SZ,
@@ -627,8 +632,11 @@ struct cxip_environment cxip_env = {
 	.coll_fabric_mgr_url = NULL,
 	.coll_retry_usec = CXIP_COLL_MAX_RETRY_USEC,
 	.coll_timeout_usec = CXIP_COLL_MAX_TIMEOUT_USEC,
+	.coll_max_pending = CXIP_COLL_MAX_PENDING,
 	.coll_use_dma_put = false,
 	.telemetry_rgid = -1,
+	.telemetry_sample_msec = 0,
+	.telemetry_ring_size = CXIP_TELEMETRY_RING_SIZE,
 	.disable_hmem_dev_register = 0,
 	.ze_hmem_supported = 0,
 	.rdzv_proto = CXIP_RDZV_PROTO_DEFAULT,
@@ -770,6 +778,23 @@ static void cxip_env_init(void)
 	fi_param_get_int(&cxip_prov, "telemetry_rgid",
 			 &cxip_env.telemetry_rgid);
 
+	fi_param_define(&cxip_prov, "telemetry_sample_msec", FI_PARAM_SIZE_T,
+			"Interval in milliseconds at which telemetry deltas are sampled into a ring readable with the FI_CXI_TELEMETRY_OPS extension. "
+			"Default is 0 (sampling disabled).");
+	fi_param_get_size_t(&cxip_prov, "telemetry_sample_msec",
+			    &cxip_env.telemetry_sample_msec);
+
+	fi_param_define(&cxip_prov, "telemetry_ring_size", FI_PARAM_SIZE_T,
+			"Number of telemetry samples held before the oldest is overwritten (default: %u).",
+			CXIP_TELEMETRY_RING_SIZE);
+	fi_param_get_size_t(&cxip_prov, "telemetry_ring_size",
+			    &cxip_env.telemetry_ring_size);
+	if (!cxip_env.telemetry_ring_size) {
+		CXIP_WARN("Invalid telemetry_ring_size, using default %u\n",
+			  CXIP_TELEMETRY_RING_SIZE);
+		cxip_env.telemetry_ring_size = CXIP_TELEMETRY_RING_SIZE;
+	}
+
 	fi_param_define(&cxip_prov, "rx_match_mode", FI_PARAM_STRING,
 			"Sets RX message match mode (hardware | software | hybrid).");
 	fi_param_get_str(&cxip_prov, "rx_match_mode", &param_str);
@@ -834,6 +859,18 @@ static void cxip_env_init(void)
 			  cxip_env.rdzv_eager_size);
 	}
 
+	fi_param_define(&cxip_prov, "rdzv_adaptive", FI_PARAM_BOOL,
+			"Adapt the eager/rendezvous cut-over to unexpected message pressure (default: %d).",
+			cxip_env.rdzv_adaptive);
+	fi_param_get_bool(&cxip_prov, "rdzv_adaptive",
+			  &cxip_env.rdzv_adaptive);
+
+	fi_param_define(&cxip_prov, "rdzv_adaptive_lat_usec", FI_PARAM_SIZE_T,
+			"Short rendezvous latency (usec) treated as pressure in adaptive mode (default: %lu).",
+			cxip_env.rdzv_adaptive_lat_usec);
+	fi_param_get_size_t(&cxip_prov, "rdzv_adaptive_lat_usec",
+			    &cxip_env.rdzv_adaptive_lat_usec);
+
 	fi_param_define(&cxip_prov, "oflow_buf_size", FI_PARAM_SIZE_T,
 			"Overflow buffer size.");
 	fi_param_get_size_t(&cxip_prov, "oflow_buf_size",
@@ -957,6 +994,12 @@ static void cxip_env_init(void)
 	if (!cxip_env.eq_ack_batch_size)
 		cxip_env.eq_ack_batch_size = 1;
 
+	fi_param_define(&cxip_prov, "eq_progress_budget", FI_PARAM_SIZE_T,
+			"Maximum number of EQ events processed per progress call, 0 for no limit (default: %lu).",
+			cxip_env.eq_progress_budget);
+	fi_param_get_size_t(&cxip_prov, "eq_progress_budget",
+			    &cxip_env.eq_progress_budget);
+
 	fi_param_define(&cxip_prov, "msg_lossless", FI_PARAM_BOOL,
 			"Enable/Disable lossless message matching.");
 	fi_param_get_bool(&cxip_prov, "msg_lossless", &cxip_env.msg_lossless);
@@ -1028,6 +1071,23 @@ static void cxip_env_init(void)
 		cxip_env.hybrid_unexpected_msg_preemptive = 0;
 	}
 
+	fi_param_define(&cxip_prov, "hybrid_hw_recovery", FI_PARAM_BOOL,
+			"Return to hardware matching after a quiet period in software endpoint mode");
+	fi_param_get_bool(&cxip_prov, "hybrid_hw_recovery",
+			  &cxip_env.hybrid_hw_recovery);
+
+	if (cxip_env.rx_match_mode != CXIP_PTLTE_HYBRID_MODE &&
+	    cxip_env.hybrid_hw_recovery) {
+		CXIP_WARN("Not in hybrid mode, ignore hybrid_hw_recovery\n");
+		cxip_env.hybrid_hw_recovery = 0;
+	}
+
+	fi_param_define(&cxip_prov, "hybrid_hw_recovery_usec", FI_PARAM_SIZE_T,
+			"Quiet period before returning to hardware matching (default: %lu).",
+			cxip_env.hybrid_hw_recovery_usec);
+	fi_param_get_size_t(&cxip_prov, "hybrid_hw_recovery_usec",
+			    &cxip_env.hybrid_hw_recovery_usec);
+
 	if (cxip_software_pte_allowed()) {
 		min_free = CXIP_REQ_BUF_HEADER_MAX_SIZE +
 			cxip_env.rdzv_threshold + cxip_env.rdzv_get_min;
@@ -1190,6 +1250,13 @@ static void cxip_env_init(void)
 	if (cxip_env.coll_timeout_usec > CXIP_COLL_MAX_TIMEOUT_USEC)
 		cxip_env.coll_timeout_usec = CXIP_COLL_MAX_TIMEOUT_USEC;
 
+	fi_param_define(&cxip_prov, "coll_max_pending", FI_PARAM_SIZE_T,
+		"Reductions queued in software while all reduction IDs of a "
+		"multicast object are in use (default %d).",
+		cxip_env.coll_max_pending);
+	fi_param_get_size_t(&cxip_prov, "coll_max_pending",
+			    &cxip_env.coll_max_pending);
+
 	fi_param_define(&cxip_prov, "default_tx_size", FI_PARAM_SIZE_T,
 			"Default provider tx_attr.size (default: %lu).",
 			cxip_env.default_tx_size);
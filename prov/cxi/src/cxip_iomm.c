@@ -575,6 +575,64 @@ int cxip_map(struct cxip_domain *dom, const void *buf, unsigned long len,
 	return cxip_map_nocache(dom, &attr, flags, md);
 }
 
+/*
+ * cxip_map_prefetch() - Establish an IO mapping ahead of use.
+ *
+ * Map buf into the IO memory map cache and drop the reference, leaving the
+ * mapping cached for later cxip_map() calls on any part of it. System memory
+ * is extended to huge page boundaries so that neighbouring buffers share one
+ * mapping. If the extended range cannot be mapped, e.g. it is not entirely
+ * backed by the process, the exact range is mapped instead.
+ */
+int cxip_map_prefetch(struct cxip_domain *dom, const void *buf,
+		      unsigned long len)
+{
+	enum fi_hmem_iface iface = FI_HMEM_SYSTEM;
+	uint64_t hmem_flags = 0;
+	struct cxip_md *md;
+	void *start;
+	unsigned long map_len;
+	int ret;
+
+	if (!len)
+		return FI_SUCCESS;
+
+	if (dom->hmem)
+		iface = ofi_get_hmem_iface(buf, NULL, &hmem_flags);
+
+	/* ATS mappings are established by the IOMMU on demand. */
+	if (dom->scalable_iomm && iface == FI_HMEM_SYSTEM)
+		return FI_SUCCESS;
+
+	/* Without the cache, a mapping does not outlive the reference. */
+	if (!cxip_domain_mr_cache_iface_enabled(dom, iface))
+		return -FI_EOPNOTSUPP;
+
+	if (iface == FI_HMEM_SYSTEM) {
+		start = ofi_get_page_start(buf, CXIP_MAP_PREFETCH_ALIGN);
+		map_len = ofi_get_page_bytes(buf, len,
+					     CXIP_MAP_PREFETCH_ALIGN);
+
+		ret = cxip_map(dom, start, map_len, 0, &md);
+		if (ret == FI_SUCCESS) {
+			cxip_unmap(md);
+			return FI_SUCCESS;
+		}
+
+		CXIP_DBG("Huge page extent %p-%p not mapped, using %p-%p\n",
+			 start, (char *)start + map_len, buf,
+			 (char *)buf + len);
+	}
+
+	ret = cxip_map(dom, buf, len, 0, &md);
+	if (ret)
+		return ret;
+
+	cxip_unmap(md);
+
+	return FI_SUCCESS;
+}
+
 static void cxip_unmap_cache(struct cxip_md *md)
 {
 	struct ofi_mr_entry *entry =
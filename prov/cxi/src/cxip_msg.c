@@ -1318,6 +1318,16 @@ static int cxip_oflow_cb(struct cxip_req *req, const union c_event *event)
 
 		RXC_DBG(rxc, "Oflow LE append failed\n");
 
+		/* Appended while returning to hardware matching. Hybrid mode
+		 * transitions back to software once LEs run out.
+		 */
+		if (rxc->state == RXC_ENABLED_SOFTWARE ||
+		    rxc->state == RXC_PENDING_PTLTE_HARDWARE) {
+			cxip_ptelist_buf_link_err(oflow_buf,
+						  cxi_event_rc(event));
+			return FI_SUCCESS;
+		}
+
 		ret = cxip_recv_pending_ptlte_disable(rxc, true);
 		if (ret != FI_SUCCESS)
 			RXC_WARN(rxc, "Force disable failed %d %s\n",
@@ -2491,6 +2501,124 @@ replay:
 	}
 }
 
+/*
+ * cxip_post_hw_recovery() - Software managed to enabled PtlTE transition
+ * complete.
+ *
+ * Messages which landed on the request list before the transition were
+ * matched in software ahead of the enable event. Receives still queued in
+ * software are appended to the priority list in order; hardware matches them
+ * against unexpected messages which arrived since.
+ *
+ * Caller must hold ep_obj->lock.
+ */
+static void cxip_post_hw_recovery(struct cxip_rxc *rxc)
+{
+	struct cxip_req *req;
+	struct dlist_entry *tmp;
+	int ret __attribute__((unused));
+
+	assert(dlist_empty(&rxc->replay_queue));
+
+	rxc->msg_offload = 1;
+	rxc->state = RXC_ENABLED;
+	rxc->num_sc_sw2hw++;
+
+	dlist_foreach_container_safe(&rxc->sw_recv_queue, struct cxip_req, req,
+				     recv.rxc_entry, tmp) {
+		dlist_remove(&req->recv.rxc_entry);
+		req->recv.software_list = false;
+		dlist_insert_tail(&req->recv.rxc_entry, &rxc->replay_queue);
+	}
+
+	ret = cxip_recv_replay(rxc);
+	assert(ret == FI_SUCCESS);
+
+	RXC_WARN(rxc, "Now in RXC_ENABLED\n");
+}
+
+/*
+ * cxip_recv_hw_recovery_ready() - Check if a software managed RXC can return
+ * to hardware matching.
+ *
+ * Posted receives and unexpected messages must have dropped well below the
+ * RX size so that hardware LEs are not exhausted again right away. Multi-recv
+ * buffers matched in software are left to complete in software.
+ */
+static bool cxip_recv_hw_recovery_ready(struct cxip_rxc *rxc)
+{
+	struct cxip_req *req;
+
+	if (ofi_atomic_get32(&rxc->orx_reqs) > rxc->attr.size / 2 ||
+	    rxc->sw_ux_list_len > rxc->attr.size / 2 ||
+	    !dlist_empty(&rxc->replay_queue) ||
+	    !dlist_empty(&rxc->fc_drops))
+		return false;
+
+	dlist_foreach_container(&rxc->sw_recv_queue, struct cxip_req, req,
+				recv.rxc_entry) {
+		if (req->recv.multi_recv)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * cxip_recv_hw_recovery() - Return a hybrid RXC to hardware matching.
+ *
+ * A NIC initiated transition to software managed mode otherwise lasts for the
+ * life of the endpoint. With FI_CXI_HYBRID_HW_RECOVERY, once the RXC has been
+ * quiet for FI_CXI_HYBRID_HW_RECOVERY_USEC, overflow buffers are linked and
+ * the PtlTE is enabled. Receives keep being matched in software until the
+ * enable event arrives; the PtlTE is never disabled and no peer is flow
+ * controlled.
+ *
+ * Caller must hold ep_obj->lock.
+ */
+void cxip_recv_hw_recovery(struct cxip_rxc *rxc)
+{
+	struct cxi_pte_status pte_status = {};
+	uint64_t now;
+	int ret;
+
+	if (!cxip_env.hybrid_hw_recovery ||
+	    rxc->state != RXC_ENABLED_SOFTWARE || !rxc->oflow_list_bufpool)
+		return;
+
+	now = ofi_gettime_ns();
+	if (!rxc->hw_recovery_ns) {
+		rxc->hw_recovery_ns = now +
+			cxip_env.hybrid_hw_recovery_usec * 1000;
+		return;
+	}
+
+	if (now < rxc->hw_recovery_ns)
+		return;
+
+	rxc->hw_recovery_ns = 0;
+	if (!cxip_recv_hw_recovery_ready(rxc))
+		return;
+
+	ret = cxip_ptelist_buf_replenish(rxc->oflow_list_bufpool, true);
+	if (ret != FI_SUCCESS) {
+		RXC_WARN(rxc, "Overflow buffer replenish failed %d %s\n",
+			 ret, fi_strerror(-ret));
+		return;
+	}
+
+	ret = cxil_pte_status(rxc->rx_pte->pte, &pte_status);
+	assert(!ret);
+
+	ret = cxip_pte_set_state(rxc->rx_pte, rxc->rx_cmdq, C_PTLTE_ENABLED,
+				 pte_status.drop_count);
+	if (ret != FI_SUCCESS)
+		return;
+
+	rxc->state = RXC_PENDING_PTLTE_HARDWARE;
+	RXC_WARN(rxc, "Transitioning to HW EP\n");
+}
+
 /*
  * cxip_ux_onload_complete() - Unexpected list entry onload complete.
  *
@@ -2853,6 +2981,11 @@ void cxip_recv_pte_cb(struct cxip_pte *pte, const union c_event *event)
 			RXC_WARN(rxc, "Now in RXC_ENABLED\n");
 		}
 
+		if (rxc->state == RXC_PENDING_PTLTE_HARDWARE) {
+			cxip_post_hw_recovery(rxc);
+			break;
+		}
+
 		rxc->state = RXC_ENABLED;
 		break;
 
@@ -2893,6 +3026,16 @@ void cxip_recv_pte_cb(struct cxip_pte *pte, const union c_event *event)
 			break;
 		}
 
+		/* Flow control raced with a software to hardware transition.
+		 * The PtlTE was still software managed, re-enable it as such.
+		 * The enable command will fail on the drop count.
+		 */
+		if (rxc->state == RXC_PENDING_PTLTE_HARDWARE) {
+			RXC_WARN(rxc,
+				 "Flow control during SW to HW transition\n");
+			rxc->state = RXC_ENABLED_SOFTWARE;
+		}
+
 		/* Check for flow control during flow control */
 		if (rxc->state != RXC_ENABLED &&
 		    rxc->state != RXC_ENABLED_SOFTWARE &&
@@ -3005,6 +3148,15 @@ void cxip_recv_pte_cb(struct cxip_pte *pte, const union c_event *event)
 		if (rxc->state == RXC_PENDING_PTLTE_DISABLE)
 			break;
 
+		/* The PtlTE could not leave software managed mode, keep
+		 * matching in software and retry after another quiet period.
+		 */
+		if (rxc->state == RXC_PENDING_PTLTE_HARDWARE) {
+			RXC_WARN(rxc, "SW to HW EP transition failed\n");
+			rxc->state = RXC_ENABLED_SOFTWARE;
+			break;
+		}
+
 		RXC_DBG(rxc, "SW Managed: nic auto: %d, reason: %d\n",
 			event->tgt_long.initiator.state_change.sc_nic_auto,
 			event->tgt_long.initiator.state_change.sc_nic_auto ?
@@ -4402,6 +4554,18 @@ static void report_send_completion(struct cxip_req *req, bool sw_cntr)
  */
 static void rdzv_send_req_complete(struct cxip_req *req)
 {
+	struct cxip_txc *txc = req->send.txc;
+	uint64_t lat_ns;
+
+	/* Only rendezvous Sends near the cut-over tell about pressure, longer
+	 * ones are dominated by the transfer itself.
+	 */
+	if (req->send.rdzv_start_ns && req->send.rc == C_RC_OK &&
+	    req->send.len <= 2 * (size_t)txc->max_eager_size) {
+		lat_ns = ofi_gettime_ns() - req->send.rdzv_start_ns;
+		txc->rdzv_lat_ns = (7 * txc->rdzv_lat_ns + lat_ns) / 8;
+	}
+
 	cxip_rdzv_id_free(req->send.txc, req->send.rdzv_id);
 
 	cxip_send_buf_fini(req);
@@ -4633,6 +4797,7 @@ static ssize_t _cxip_send_rdzv_put(struct cxip_req *req)
 	req->send.rdzv_id = rdzv_id;
 	req->cb = cxip_send_rdzv_put_cb;
 	req->send.rdzv_send_events = 0;
+	req->send.rdzv_start_ns = 0;
 
 	/* Build Put command descriptor */
 	cmd.command.cmd_type = C_CMD_TYPE_DMA;
@@ -4670,6 +4835,8 @@ static ssize_t _cxip_send_rdzv_put(struct cxip_req *req)
 	}
 
 	req->triggered = false;
+	if (cxip_env.rdzv_adaptive)
+		req->send.rdzv_start_ns = ofi_gettime_ns();
 
 	return FI_SUCCESS;
 
@@ -4942,6 +5109,67 @@ static bool cxip_send_eager_idc(struct cxip_req *req)
 		!cxip_env.disable_non_inject_msg_idc;
 }
 
+/*
+ * cxip_txc_eager_limit() - Return the eager/rendezvous cut-over.
+ *
+ * Unexpected eager messages hold their payload in target overflow buffers,
+ * and exhausting those or the unexpected list entries forces a transition
+ * to software matching. In adaptive mode, the cut-over is halved while
+ * pressure builds and regrows while it is absent. Pressure is sensed on the
+ * local RX context, standing in for peers in symmetric traffic, and from the
+ * completion latency of short rendezvous Sends, which grows while targets
+ * leave them unmatched.
+ *
+ * The cut-over never drops below the rendezvous eager portion plus the
+ * minimum Get, so rendezvous Sends keep their usual shape.
+ *
+ * Caller must hold ep_obj->lock.
+ */
+static size_t cxip_txc_eager_limit(struct cxip_txc *txc)
+{
+	struct cxip_rxc *rxc = &txc->ep_obj->rxc;
+	struct cxip_ptelist_bufpool *oflow = rxc->oflow_list_bufpool;
+	size_t max_size = txc->max_eager_size;
+	size_t min_size;
+	int linked;
+	int used;
+	bool pressure;
+
+	if (!cxip_env.rdzv_adaptive)
+		return max_size;
+
+	if (++txc->eager_adapt_cnt < CXIP_RDZV_ADAPT_INTERVAL)
+		return txc->eager_limit;
+	txc->eager_adapt_cnt = 0;
+
+	pressure = ofi_atomic_get32(&rxc->orx_hw_ule_cnt) > rxc->attr.size / 2 ||
+		rxc->sw_ux_list_len > rxc->attr.size / 2 ||
+		txc->rdzv_lat_ns > cxip_env.rdzv_adaptive_lat_usec * 1000;
+
+	/* Overflow buffers consumed by unexpected messages outnumber the
+	 * ones still linked.
+	 */
+	if (oflow) {
+		linked = ofi_atomic_get32(&oflow->bufs_linked);
+		used = ofi_atomic_get32(&oflow->bufs_allocated) - linked -
+			ofi_atomic_get32(&oflow->bufs_free);
+		pressure = pressure || used > linked;
+	}
+
+	/* Let the latency average decay without fresh samples */
+	txc->rdzv_lat_ns /= 2;
+
+	min_size = MIN(txc->rdzv_eager_size + cxip_env.rdzv_get_min, max_size);
+	if (pressure)
+		txc->eager_limit = MAX(txc->eager_limit / 2, min_size);
+	else
+		txc->eager_limit = MIN(txc->eager_limit +
+				       MAX((max_size - min_size) / 8, 1),
+				       max_size);
+
+	return txc->eager_limit;
+}
+
 static ssize_t _cxip_send_req(struct cxip_req *req)
 {
 	/* Force all zero-byte operations to use the eager path. This utilizes
@@ -4955,8 +5183,13 @@ static ssize_t _cxip_send_req(struct cxip_req *req)
 	    ((req->send.flags & FI_INJECT) || cxip_send_eager_idc(req)))
 		return _cxip_send_eager_idc(req);
 
-	if (req->send.len <= req->send.txc->max_eager_size)
+	/* Replayed Sends keep the protocol they were first sent with. */
+	if (req->send.fc_peer) {
+		if (req->cb == cxip_send_eager_cb)
+			return _cxip_send_eager(req);
+	} else if (req->send.len <= cxip_txc_eager_limit(req->send.txc)) {
 		return _cxip_send_eager(req);
+	}
 
 	return _cxip_send_rdzv_put(req);
 }
@@ -140,6 +140,7 @@ static int cxip_req_buf_process_ux(struct cxip_ptelist_buf *buf,
 		 * completion of the on-loading.
 		 */
 		if (rxc->state != RXC_ENABLED_SOFTWARE &&
+		    rxc->state != RXC_PENDING_PTLTE_HARDWARE &&
 		    rxc->state != RXC_FLOW_CONTROL) {
 			rxc->sw_ux_list_len--;
 			dlist_insert_tail(&ux->rxc_entry,
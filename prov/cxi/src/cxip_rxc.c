@@ -20,7 +20,7 @@
 
 #define CXIP_SC_STATS "FC/SC stats - EQ full: %d append fail: %d no match: %d"\
 		      " request full: %d unexpected: %d, NIC HW2SW unexp: %d"\
-		      " NIC HW2SW append fail: %d\n"
+		      " NIC HW2SW append fail: %d SW2HW: %d\n"
 
 /*
  * cxip_rxc_msg_enable() - Enable RXC messaging.
@@ -63,6 +63,12 @@ static int rxc_msg_disable(struct cxip_rxc *rxc)
 {
 	int ret;
 
+	/* Let a software to hardware transition in flight land first */
+	while (rxc->state == RXC_PENDING_PTLTE_HARDWARE) {
+		sched_yield();
+		cxip_evtq_progress(&rxc->rx_evtq);
+	}
+
 	if (rxc->state != RXC_ENABLED &&
 	    rxc->state != RXC_ENABLED_SOFTWARE)
 		RXC_FATAL(rxc, "RXC in bad state to be disabled: state=%d\n",
@@ -431,12 +437,13 @@ static void rxc_cleanup(struct cxip_rxc *rxc)
 	if (rxc->num_fc_eq_full || rxc->num_fc_no_match ||
 	    rxc->num_fc_req_full || rxc->num_fc_unexp ||
 	    rxc->num_fc_append_fail || rxc->num_sc_nic_hw2sw_unexp ||
-	    rxc->num_sc_nic_hw2sw_append_fail)
+	    rxc->num_sc_nic_hw2sw_append_fail || rxc->num_sc_sw2hw)
 		CXIP_INFO(CXIP_SC_STATS, rxc->num_fc_eq_full,
 			  rxc->num_fc_append_fail, rxc->num_fc_no_match,
 			  rxc->num_fc_req_full, rxc->num_fc_unexp,
 			  rxc->num_sc_nic_hw2sw_unexp,
-			  rxc->num_sc_nic_hw2sw_append_fail);
+			  rxc->num_sc_nic_hw2sw_append_fail,
+			  rxc->num_sc_sw2hw);
 }
 
 static void cxip_rxc_dump_counters(struct cxip_rxc *rxc)
@@ -220,16 +220,171 @@ void cxip_telemetry_dump_delta(struct cxip_telemetry *telemetry)
 		cxip_telemetry_entry_dump_delta(entry);
 }
 
+/* Record the non-zero deltas since the previous sample into the ring. When the
+ * ring is full, the oldest sample is overwritten.
+ */
+static void cxip_telemetry_sample(struct cxip_telemetry *telemetry)
+{
+	struct cxip_telemetry_entry *entry;
+	struct fi_cxi_telemetry_sample *sample;
+	uint64_t now = ofi_gettime_ns();
+	long value;
+
+	dlist_foreach_container(&telemetry->telemetry_list,
+				struct cxip_telemetry_entry, entry,
+				telemetry_entry) {
+		value = cxip_telemetry_entry_read_value(entry);
+		if (value < 0)
+			continue;
+
+		/* A lower value means the telemetry was reset. Restart the
+		 * delta from the new value.
+		 */
+		if (value <= entry->sample_value) {
+			entry->sample_value = value;
+			continue;
+		}
+
+		pthread_mutex_lock(&telemetry->ring_lock);
+
+		if (telemetry->ring_cnt == telemetry->ring_size) {
+			telemetry->ring_head = (telemetry->ring_head + 1) %
+				telemetry->ring_size;
+			telemetry->ring_cnt--;
+			telemetry->ring_lost++;
+		}
+
+		sample = &telemetry->ring[(telemetry->ring_head +
+					   telemetry->ring_cnt) %
+					  telemetry->ring_size];
+		sample->timestamp = now;
+		sample->name = entry->name;
+		sample->delta = value - entry->sample_value;
+		telemetry->ring_cnt++;
+
+		pthread_mutex_unlock(&telemetry->ring_lock);
+
+		entry->sample_value = value;
+	}
+}
+
+static void *cxip_telemetry_sampler(void *arg)
+{
+	struct cxip_telemetry *telemetry = arg;
+	struct timespec ts;
+
+	pthread_mutex_lock(&telemetry->ring_lock);
+
+	while (!telemetry->sampler_stop) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += cxip_env.telemetry_sample_msec / 1000;
+		ts.tv_nsec += (cxip_env.telemetry_sample_msec % 1000) * 1000000;
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+
+		pthread_cond_timedwait(&telemetry->sampler_cond,
+				       &telemetry->ring_lock, &ts);
+		if (telemetry->sampler_stop)
+			break;
+
+		pthread_mutex_unlock(&telemetry->ring_lock);
+		cxip_telemetry_sample(telemetry);
+		pthread_mutex_lock(&telemetry->ring_lock);
+	}
+
+	pthread_mutex_unlock(&telemetry->ring_lock);
+
+	return NULL;
+}
+
+static int cxip_telemetry_sampler_start(struct cxip_telemetry *telemetry)
+{
+	struct cxip_telemetry_entry *entry;
+	int ret;
+
+	telemetry->ring_size = cxip_env.telemetry_ring_size;
+	telemetry->ring = calloc(telemetry->ring_size,
+				 sizeof(*telemetry->ring));
+	if (!telemetry->ring)
+		return -FI_ENOMEM;
+
+	dlist_foreach_container(&telemetry->telemetry_list,
+				struct cxip_telemetry_entry, entry,
+				telemetry_entry)
+		entry->sample_value = entry->value;
+
+	ret = pthread_create(&telemetry->sampler, NULL,
+			     cxip_telemetry_sampler, telemetry);
+	if (ret) {
+		free(telemetry->ring);
+		telemetry->ring = NULL;
+		return -ret;
+	}
+
+	telemetry->sampler_running = true;
+
+	return FI_SUCCESS;
+}
+
+static void cxip_telemetry_sampler_stop(struct cxip_telemetry *telemetry)
+{
+	if (!telemetry->sampler_running)
+		return;
+
+	pthread_mutex_lock(&telemetry->ring_lock);
+	telemetry->sampler_stop = true;
+	pthread_cond_signal(&telemetry->sampler_cond);
+	pthread_mutex_unlock(&telemetry->ring_lock);
+
+	pthread_join(telemetry->sampler, NULL);
+	telemetry->sampler_running = false;
+}
+
+ssize_t cxip_telemetry_read(struct cxip_telemetry *telemetry,
+			    struct fi_cxi_telemetry_sample *samples,
+			    size_t count, uint64_t *lost)
+{
+	size_t i;
+
+	if (!telemetry || !telemetry->ring)
+		return -FI_ENOSYS;
+
+	pthread_mutex_lock(&telemetry->ring_lock);
+
+	count = MIN(count, telemetry->ring_cnt);
+	for (i = 0; i < count; i++) {
+		samples[i] = telemetry->ring[telemetry->ring_head];
+		telemetry->ring_head = (telemetry->ring_head + 1) %
+			telemetry->ring_size;
+	}
+	telemetry->ring_cnt -= count;
+
+	if (lost)
+		*lost = telemetry->ring_lost;
+	telemetry->ring_lost = 0;
+
+	pthread_mutex_unlock(&telemetry->ring_lock);
+
+	return count;
+}
+
 void cxip_telemetry_free(struct cxip_telemetry *telemetry)
 {
 	struct cxip_telemetry_entry *entry;
 	struct dlist_entry *tmp;
 
+	cxip_telemetry_sampler_stop(telemetry);
+
 	dlist_foreach_container_safe(&telemetry->telemetry_list,
 				     struct cxip_telemetry_entry,
 				     entry, telemetry_entry, tmp)
 		cxip_telemetry_entry_free(entry);
 
+	pthread_cond_destroy(&telemetry->sampler_cond);
+	pthread_mutex_destroy(&telemetry->ring_lock);
+	free(telemetry->ring);
 	free(telemetry);
 }
 
@@ -255,6 +410,8 @@ int cxip_telemetry_alloc(struct cxip_domain *dom,
 
 	_telemetry->dom = dom;
 	dlist_init(&_telemetry->telemetry_list);
+	pthread_mutex_init(&_telemetry->ring_lock, NULL);
+	pthread_cond_init(&_telemetry->sampler_cond, NULL);
 
 	telemetry_copy = malloc(strlen(cxip_env.telemetry) + 1);
 	if (!telemetry_copy) {
@@ -290,6 +447,19 @@ int cxip_telemetry_alloc(struct cxip_domain *dom,
 		goto err_free_telemetry;
 	}
 
+	/* Sampling is optional. Deltas between open and close are still
+	 * captured if the sampler cannot be started.
+	 */
+	if (cxip_env.telemetry_sample_msec) {
+		ret = cxip_telemetry_sampler_start(_telemetry);
+		if (ret)
+			DOM_WARN(dom, "Failed to start telemetry sampler: %d:%s\n",
+				 ret, fi_strerror(-ret));
+		else
+			DOM_INFO(dom, "Telemetry sampled every %lu msec\n",
+				 cxip_env.telemetry_sample_msec);
+	}
+
 	*telemetry = _telemetry;
 
 	return FI_SUCCESS;
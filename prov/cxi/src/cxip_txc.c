@@ -445,6 +445,7 @@ void cxip_txc_struct_init(struct cxip_txc *txc, const struct fi_tx_attr *attr,
 	txc->attr = *attr;
 	txc->max_eager_size = cxip_env.rdzv_threshold + cxip_env.rdzv_get_min;
 	txc->rdzv_eager_size = cxip_env.rdzv_eager_size;
+	txc->eager_limit = txc->max_eager_size;
 	txc->hmem = !!(attr->caps & FI_HMEM);
 }
 
@@ -553,6 +554,7 @@ int cxip_txc_emit_idc_put(struct cxip_txc *txc, uint16_t vni,
 	if (ret) {
 		TXC_WARN(txc, "Failed to emit idc_put command: %d:%s\n", ret,
 			 fi_strerror(-ret));
+		cxip_txq_flush(txc->tx_cmdq);
 		return ret;
 	}
 
@@ -614,6 +616,7 @@ int cxip_txc_emit_dma(struct cxip_txc *txc, uint16_t vni,
 	if (ret) {
 		TXC_WARN(txc, "Failed to emit dma command: %d:%s\n", ret,
 			 fi_strerror(-ret));
+		cxip_txq_flush(txc->tx_cmdq);
 		return ret;
 	}
 
@@ -664,6 +667,7 @@ int cxip_txc_emit_idc_amo(struct cxip_txc *txc, uint16_t vni,
 	if (ret) {
 		TXC_WARN(txc, "Failed to emit idc_put command: %d:%s\n", ret,
 			 fi_strerror(-ret));
+		cxip_txq_flush(txc->tx_cmdq);
 		return ret;
 	}
 
@@ -728,6 +732,7 @@ int cxip_txc_emit_dma_amo(struct cxip_txc *txc, uint16_t vni,
 	if (ret) {
 		TXC_WARN(txc, "Failed to emit DMA amo command: %d:%s\n", ret,
 			 fi_strerror(-ret));
+		cxip_txq_flush(txc->tx_cmdq);
 		return ret;
 	}
 
@@ -778,6 +783,7 @@ int cxip_txc_emit_idc_msg(struct cxip_txc *txc, uint16_t vni,
 	if (ret) {
 		TXC_WARN(txc, "Failed to emit idc_msg command: %d:%s\n", ret,
 			 fi_strerror(-ret));
+		cxip_txq_flush(txc->tx_cmdq);
 		return ret;
 	}
 
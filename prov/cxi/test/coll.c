@@ -1169,6 +1169,16 @@ Test(coll_reduce, concurN)
 	_reduce_test_set(29);
 }
 
+/* Without the software queue, reductions past the IDs in use must retry */
+Test(coll_reduce, concurN_nopending)
+{
+	size_t max_pending = cxip_env.coll_max_pending;
+
+	cxip_env.coll_max_pending = 0;
+	_reduce_test_set(29);
+	cxip_env.coll_max_pending = max_pending;
+}
+
 /***************************************/
 /* Collective operation testing */
 #define	REDUCE_NODES	10
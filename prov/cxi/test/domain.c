@@ -123,6 +123,56 @@ Test(domain, get_dwq_depth)
 	cxit_destroy_domain();
 }
 
+Test(domain, map_prefetch)
+{
+	int ret;
+	size_t len = 4 * 1024 * 1024;
+	struct fi_cxi_dom_ops *ops;
+	struct cxip_domain *cxip_dom;
+	struct cxip_md *md;
+	struct iovec iov;
+	char *buf;
+
+	cxit_create_domain();
+	cr_assert(cxit_domain != NULL);
+
+	ret = fi_open_ops(&cxit_domain->fid, FI_CXI_DOM_OPS_7, 0,
+			  (void **)&ops, NULL);
+	cr_assert_eq(ret, FI_SUCCESS, "fi_open_ops v7: %d", ret);
+	cr_assert(ops->map_prefetch != NULL);
+
+	cxip_dom = container_of(cxit_domain, struct cxip_domain,
+				util_domain.domain_fid);
+
+	buf = malloc(len);
+	cr_assert(buf != NULL);
+
+	iov.iov_base = buf + 4096;
+	iov.iov_len = 8192;
+	ret = ops->map_prefetch(&cxit_domain->fid, &iov, 1);
+	if (cxip_dom->scalable_iomm) {
+		cr_assert_eq(ret, FI_SUCCESS, "map_prefetch: %d", ret);
+		goto out;
+	}
+	if (!cxip_domain_mr_cache_enabled(cxip_dom)) {
+		cr_assert_eq(ret, -FI_EOPNOTSUPP, "map_prefetch: %d", ret);
+		goto out;
+	}
+	cr_assert_eq(ret, FI_SUCCESS, "map_prefetch: %d", ret);
+
+	/* The prefetched mapping covers the requested range */
+	ret = cxip_map(cxip_dom, iov.iov_base, iov.iov_len, 0, &md);
+	cr_assert_eq(ret, FI_SUCCESS, "cxip_map: %d", ret);
+	cr_assert(md->info.iov.iov_base <= iov.iov_base);
+	cr_assert((char *)md->info.iov.iov_base + md->info.iov.iov_len >=
+		  (char *)iov.iov_base + iov.iov_len);
+	cxip_unmap(md);
+
+out:
+	free(buf);
+	cxit_destroy_domain();
+}
+
 Test(domain, enable_mr_match_events)
 {
 	int ret;
@@ -112,26 +112,34 @@ static ssize_t efa_dgram_post_recv(struct efa_dgram_ep *ep, const struct fi_msg
 	struct efa_mr *efa_mr;
 	struct efa_qp *qp = ep->base_ep.qp;
 	struct ibv_recv_wr *bad_wr;
-	struct efa_recv_wr *ewr;
+	struct efa_recv_wr *ewr, direct_ewr;
 	struct ibv_recv_wr *wr;
 	uintptr_t addr;
 	ssize_t err, post_recv_err;
+	bool direct;
 	size_t i;
 
-	ewr = ofi_buf_alloc(ep->recv_wr_pool);
-	if (OFI_UNLIKELY(!ewr))
-		return -FI_ENOMEM;
-
-	memset(ewr, 0, sizeof(*ewr) + sizeof(*ewr->sge) * msg->iov_count);
-	wr = &ewr->wr;
 	dump_msg(msg, "recv");
 
 	err = efa_dgram_post_recv_validate(ep, msg);
-	if (OFI_UNLIKELY(err)) {
-		ofi_buf_free(ewr);
+	if (OFI_UNLIKELY(err))
 		goto out_err;
+
+	/* A receive that is not part of a FI_MORE chain is posted on its
+	 * own, so its WR can live on the stack */
+	direct = !(flags & FI_MORE) && !ep->base_ep.recv_more_wr_head.next &&
+		 msg->iov_count <= ARRAY_SIZE(direct_ewr.sge);
+	if (direct) {
+		ewr = &direct_ewr;
+	} else {
+		ewr = ofi_buf_alloc(ep->recv_wr_pool);
+		if (OFI_UNLIKELY(!ewr))
+			return -FI_ENOMEM;
 	}
 
+	memset(ewr, 0, sizeof(*ewr));
+	wr = &ewr->wr;
+
 	wr->wr_id = (uintptr_t)msg->context;
 	wr->num_sge = msg->iov_count;
 	wr->sg_list = ewr->sge;
@@ -147,6 +155,16 @@ static ssize_t efa_dgram_post_recv(struct efa_dgram_ep *ep, const struct fi_msg
 		wr->sg_list[i].addr = addr;
 	}
 
+	if (direct) {
+#if HAVE_LTTNG
+		efa_tracepoint_wr_id_post_recv((void *) wr->wr_id);
+#endif
+		err = ibv_post_recv(qp->ibv_qp, wr, &bad_wr);
+		if (OFI_UNLIKELY(err))
+			err = (err == ENOMEM) ? -FI_EAGAIN : -err;
+		return err;
+	}
+
 	ep->base_ep.recv_more_wr_tail->next = wr;
 	ep->base_ep.recv_more_wr_tail = wr;
 
@@ -324,29 +342,36 @@ static ssize_t efa_dgram_post_send(struct efa_dgram_ep *ep, const struct fi_msg
 {
 	struct efa_qp *qp = ep->base_ep.qp;
 	struct ibv_send_wr *bad_wr;
-	struct efa_send_wr *ewr;
+	struct efa_send_wr *ewr, direct_ewr;
 	struct ibv_send_wr *wr;
 	struct efa_conn *conn;
+	bool direct;
 	size_t len;
 	int ret;
 
 	dump_msg(msg, "send");
 
-	ewr = ofi_buf_alloc(ep->send_wr_pool);
-	if (OFI_UNLIKELY(!ewr))
-		return -FI_ENOMEM;
-
-	memset(ewr, 0, sizeof(*ewr) + sizeof(*ewr->sge) * msg->iov_count);
-	wr = &ewr->wr;
 	conn = efa_av_addr_to_conn(ep->base_ep.av, msg->addr);
 	assert(conn && conn->ep_addr);
 
 	ret = efa_dgram_post_send_validate(ep, msg, conn, flags, &len);
-	if (OFI_UNLIKELY(ret)) {
-		ofi_buf_free(ewr);
+	if (OFI_UNLIKELY(ret))
 		goto out_err;
+
+	/* A send that is not part of a FI_MORE chain is posted on its own,
+	 * so its WR can live on the stack */
+	direct = !(flags & FI_MORE) && !ep->base_ep.xmit_more_wr_head.next;
+	if (direct) {
+		ewr = &direct_ewr;
+	} else {
+		ewr = ofi_buf_alloc(ep->send_wr_pool);
+		if (OFI_UNLIKELY(!ewr))
+			return -FI_ENOMEM;
 	}
 
+	memset(ewr, 0, sizeof(*ewr));
+	wr = &ewr->wr;
+
 	efa_dgram_post_send_sgl(ep, msg, ewr);
 
 	if (len <= ep->base_ep.domain->device->efa_attr.inline_buf_size &&
@@ -359,6 +384,13 @@ static ssize_t efa_dgram_post_send(struct efa_dgram_ep *ep, const struct fi_msg
 	wr->wr.ud.remote_qpn = conn->ep_addr->qpn;
 	wr->wr.ud.remote_qkey = conn->ep_addr->qkey;
 
+	if (direct) {
+#if HAVE_LTTNG
+		efa_tracepoint_wr_id_post_send((void *) wr->wr_id);
+#endif
+		return ibv_post_send(qp->ibv_qp, wr, &bad_wr);
+	}
+
 	ep->base_ep.xmit_more_wr_tail->next = wr;
 	ep->base_ep.xmit_more_wr_tail = wr;
 
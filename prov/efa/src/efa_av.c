@@ -152,6 +152,41 @@ static inline int efa_av_is_valid_address(struct efa_ep_addr *addr)
 	return memcmp(addr->raw, all_zeros.raw, sizeof(addr->raw));
 }
 
+/**
+ * @brief create the ibv_ah of an efa_ah from its GID, and query its AHN
+ *
+ * @param[in]		ibv_pd	protection domain
+ * @param[in,out]	efa_ah	efa_ah whose gid is set
+ * @return		0 on success, errno on failure
+ */
+static
+int efa_ah_create(struct ibv_pd *ibv_pd, struct efa_ah *efa_ah)
+{
+	struct ibv_ah_attr ibv_ah_attr = { 0 };
+	struct efadv_ah_attr efa_ah_attr = { 0 };
+	int err;
+
+	ibv_ah_attr.port_num = 1;
+	ibv_ah_attr.is_global = 1;
+	memcpy(ibv_ah_attr.grh.dgid.raw, efa_ah->gid, EFA_GID_LEN);
+	efa_ah->ibv_ah = ibv_create_ah(ibv_pd, &ibv_ah_attr);
+	if (!efa_ah->ibv_ah) {
+		EFA_WARN(FI_LOG_AV, "ibv_create_ah failed! errno: %d\n", errno);
+		return errno;
+	}
+
+	err = efadv_query_ah(efa_ah->ibv_ah, &efa_ah_attr, sizeof(efa_ah_attr));
+	if (err) {
+		EFA_WARN(FI_LOG_AV, "efadv_query_ah failed! err: %d\n", err);
+		ibv_destroy_ah(efa_ah->ibv_ah);
+		efa_ah->ibv_ah = NULL;
+		return err;
+	}
+
+	efa_ah->ahn = efa_ah_attr.ahn;
+	return 0;
+}
+
 /**
  * @brief allocate an ibv_ah object from GID.
  * This function use a hash map to store GID to ibv_ah map,
@@ -163,10 +198,7 @@ static inline int efa_av_is_valid_address(struct efa_ep_addr *addr)
 static
 struct efa_ah *efa_ah_alloc(struct efa_av *av, const uint8_t *gid)
 {
-	struct ibv_pd *ibv_pd = av->domain->ibv_pd;
 	struct efa_ah *efa_ah;
-	struct ibv_ah_attr ibv_ah_attr = { 0 };
-	struct efadv_ah_attr efa_ah_attr = { 0 };
 	int err;
 
 	efa_ah = NULL;
@@ -183,33 +215,17 @@ struct efa_ah *efa_ah_alloc(struct efa_av *av, const uint8_t *gid)
 		return NULL;
 	}
 
-	ibv_ah_attr.port_num = 1;
-	ibv_ah_attr.is_global = 1;
-	memcpy(ibv_ah_attr.grh.dgid.raw, gid, EFA_GID_LEN);
-	efa_ah->ibv_ah = ibv_create_ah(ibv_pd, &ibv_ah_attr);
-	if (!efa_ah->ibv_ah) {
-		EFA_WARN(FI_LOG_AV, "ibv_create_ah failed! errno: %d\n", errno);
-		goto err_free_efa_ah;
-	}
-
-	err = efadv_query_ah(efa_ah->ibv_ah, &efa_ah_attr, sizeof(efa_ah_attr));
+	memcpy(efa_ah->gid, gid, EFA_GID_LEN);
+	err = efa_ah_create(av->domain->ibv_pd, efa_ah);
 	if (err) {
 		errno = err;
-		EFA_WARN(FI_LOG_AV, "efadv_query_ah failed! err: %d\n", err);
-		goto err_destroy_ibv_ah;
+		free(efa_ah);
+		return NULL;
 	}
 
 	efa_ah->refcnt = 1;
-	efa_ah->ahn = efa_ah_attr.ahn;
-	memcpy(efa_ah->gid, gid, EFA_GID_LEN);
 	HASH_ADD(hh, av->ah_map, gid, EFA_GID_LEN, efa_ah);
 	return efa_ah;
-
-err_destroy_ibv_ah:
-	ibv_destroy_ah(efa_ah->ibv_ah);
-err_free_efa_ah:
-	free(efa_ah);
-	return NULL;
 }
 
 /**
@@ -634,13 +650,143 @@ out:
 	return ret;
 }
 
+struct efa_ah_create_work {
+	struct ibv_pd *ibv_pd;
+	struct efa_ah **ah;
+	size_t count;
+	ofi_atomic64_t next;
+};
+
+static void *efa_ah_create_thread(void *arg)
+{
+	struct efa_ah_create_work *work = arg;
+	int64_t i;
+
+	while ((i = ofi_atomic_inc64(&work->next) - 1) < (int64_t) work->count)
+		(void) efa_ah_create(work->ibv_pd, work->ah[i]);
+
+	return NULL;
+}
+
+/**
+ * @brief create the AHs of a bulk insert in parallel
+ *
+ * ibv_create_ah() is a command to the device, so creating the AHs of a
+ * large insert one at a time dominates its cost. This function creates
+ * the AH of every GID in addr that is not yet in the AV's ah_map, with
+ * up to EFA_AV_AH_CREATE_MAX_THREADS threads. The new AHs are added to
+ * ah_map with no reference, so that efa_ah_alloc() finds them, and
+ * efa_ah_put_unused() destroys the ones no address ended up using.
+ *
+ * Failures are ignored here: efa_ah_alloc() creates the missing AHs
+ * again, and reports the error.
+ *
+ * @param[in]	av	address vector
+ * @param[in]	addr	addresses to be inserted
+ * @param[in]	count	number of addresses
+ * @return	number of AHs created
+ */
+static
+size_t efa_ah_create_bulk(struct efa_av *av, const void *addr, size_t count)
+{
+	pthread_t threads[EFA_AV_AH_CREATE_MAX_THREADS - 1];
+	struct efa_ah_create_work work;
+	struct efa_ep_addr *addr_i;
+	struct efa_ah *efa_ah, **ah;
+	size_t i, ah_cnt = 0, started = 0;
+
+	ah = malloc(count * sizeof(*ah));
+	if (!ah)
+		return 0;
+
+	ofi_mutex_lock(&av->util_av.lock);
+	for (i = 0; i < count; i++) {
+		addr_i = (struct efa_ep_addr *) ((uint8_t *)addr + i * EFA_EP_ADDR_LEN);
+		HASH_FIND(hh, av->ah_map, addr_i->raw, EFA_GID_LEN, efa_ah);
+		if (efa_ah)
+			continue;
+
+		efa_ah = calloc(1, sizeof(*efa_ah));
+		if (!efa_ah)
+			break;
+
+		memcpy(efa_ah->gid, addr_i->raw, EFA_GID_LEN);
+		HASH_ADD(hh, av->ah_map, gid, EFA_GID_LEN, efa_ah);
+		ah[ah_cnt++] = efa_ah;
+	}
+
+	work.ibv_pd = av->domain->ibv_pd;
+	work.ah = ah;
+	work.count = ah_cnt;
+	ofi_atomic_initialize64(&work.next, 0);
+
+	for (; started + 1 < MIN(ah_cnt, EFA_AV_AH_CREATE_MAX_THREADS); started++) {
+		if (pthread_create(&threads[started], NULL, efa_ah_create_thread, &work))
+			break;
+	}
+
+	efa_ah_create_thread(&work);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	/* drop the ones that failed, so that efa_ah_alloc() retries them */
+	for (i = 0; i < ah_cnt; ) {
+		if (ah[i]->ibv_ah) {
+			i++;
+			continue;
+		}
+		HASH_DEL(av->ah_map, ah[i]);
+		free(ah[i]);
+		ah[i] = ah[--ah_cnt];
+	}
+	ofi_mutex_unlock(&av->util_av.lock);
+
+	free(ah);
+	return ah_cnt;
+}
+
+/**
+ * @brief destroy the AHs from efa_ah_create_bulk() that no address uses
+ *
+ * The AHs are looked up again by GID, as the ones that were used may have
+ * been released meanwhile by another thread.
+ *
+ * @param[in]	av	address vector
+ * @param[in]	addr	addresses passed to efa_ah_create_bulk()
+ * @param[in]	count	number of addresses
+ */
+static
+void efa_ah_put_unused(struct efa_av *av, const void *addr, size_t count)
+{
+	struct efa_ep_addr *addr_i;
+	struct efa_ah *efa_ah;
+	size_t i;
+	int err;
+
+	ofi_mutex_lock(&av->util_av.lock);
+	for (i = 0; i < count; i++) {
+		addr_i = (struct efa_ep_addr *) ((uint8_t *)addr + i * EFA_EP_ADDR_LEN);
+		HASH_FIND(hh, av->ah_map, addr_i->raw, EFA_GID_LEN, efa_ah);
+		if (!efa_ah || efa_ah->refcnt)
+			continue;
+
+		HASH_DEL(av->ah_map, efa_ah);
+		err = ibv_destroy_ah(efa_ah->ibv_ah);
+		if (err)
+			EFA_WARN(FI_LOG_AV, "ibv_destroy_ah failed! err=%d\n", err);
+		free(efa_ah);
+	}
+	ofi_mutex_unlock(&av->util_av.lock);
+}
+
 int efa_av_insert(struct fid_av *av_fid, const void *addr,
 			 size_t count, fi_addr_t *fi_addr,
 			 uint64_t flags, void *context)
 {
 	struct efa_av *av = container_of(av_fid, struct efa_av, util_av.av_fid);
 	int ret = 0, success_cnt = 0;
-	size_t i = 0;
+	size_t i = 0, bulk_ah_cnt = 0;
 	struct efa_ep_addr *addr_i;
 	fi_addr_t fi_addr_res;
 
@@ -657,6 +803,9 @@ int efa_av_insert(struct fid_av *av_fid, const void *addr,
 	if (flags)
 		return -FI_ENOSYS;
 
+	if (count >= EFA_AV_AH_CREATE_BULK_MIN)
+		bulk_ah_cnt = efa_ah_create_bulk(av, addr, count);
+
 	for (i = 0; i < count; i++) {
 		addr_i = (struct efa_ep_addr *) ((uint8_t *)addr + i * EFA_EP_ADDR_LEN);
 
@@ -672,6 +821,9 @@ int efa_av_insert(struct fid_av *av_fid, const void *addr,
 		success_cnt++;
 	}
 
+	if (bulk_ah_cnt)
+		efa_ah_put_unused(av, addr, count);
+
 	/* cancel remaining request and log to event queue */
 	for (; i < count ; i++) {
 		if (av->util_av.eq)
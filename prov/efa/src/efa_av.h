@@ -11,6 +11,10 @@
 #define EFA_MIN_AV_SIZE (16384)
 #define EFA_SHM_MAX_AV_COUNT       (256)
 
+/* fi_av_insert() of at least this many addresses creates their AHs in parallel */
+#define EFA_AV_AH_CREATE_BULK_MIN	(64)
+#define EFA_AV_AH_CREATE_MAX_THREADS	(8)
+
 struct efa_ah {
 	uint8_t		gid[EFA_GID_LEN]; /* efa device GID */
 	struct ibv_ah	*ibv_ah; /* created by ibv_create_ah() using GID */
@@ -34,20 +34,33 @@ int efa_base_ep_bind_av(struct efa_base_ep *base_ep, struct efa_av *av)
 	return 0;
 }
 
-static int efa_base_ep_destruct_qp(struct efa_base_ep *base_ep)
+static void efa_qp_destruct(struct efa_qp *qp)
 {
-	struct efa_domain *domain;
-	struct efa_qp *qp = base_ep->qp;
+	struct efa_domain *domain = qp->base_ep->domain;
 	int err;
 
-	if (qp) {
-		domain = qp->base_ep->domain;
+	if (domain->qp_table[qp->qp_num & domain->qp_table_sz_m1] == qp)
 		domain->qp_table[qp->qp_num & domain->qp_table_sz_m1] = NULL;
-		err = -ibv_destroy_qp(qp->ibv_qp);
-		if (err)
-			EFA_INFO(FI_LOG_CORE, "destroy qp[%u] failed!\n", qp->qp_num);
+	err = -ibv_destroy_qp(qp->ibv_qp);
+	if (err)
+		EFA_INFO(FI_LOG_CORE, "destroy qp[%u] failed!\n", qp->qp_num);
 
-		free(qp);
+	free(qp);
+}
+
+static int efa_base_ep_destruct_qp(struct efa_base_ep *base_ep)
+{
+	size_t i;
+
+	for (i = 0; i < base_ep->rma_qp_cnt; i++)
+		efa_qp_destruct(base_ep->rma_qp[i]);
+	free(base_ep->rma_qp);
+	base_ep->rma_qp = NULL;
+	base_ep->rma_qp_cnt = 0;
+
+	if (base_ep->qp) {
+		efa_qp_destruct(base_ep->qp);
+		base_ep->qp = NULL;
 	}
 
 	return 0;
@@ -149,8 +162,8 @@ static int efa_base_ep_modify_qp_rst2rts(struct efa_base_ep *base_ep,
 					   IBV_QP_STATE | IBV_QP_SQ_PSN);
 }
 
-int efa_base_ep_create_qp(struct efa_base_ep *base_ep,
-			  struct ibv_qp_init_attr_ex *init_attr_ex)
+static int efa_qp_create(struct efa_base_ep *base_ep, struct efa_qp **qp_ptr,
+			 struct ibv_qp_init_attr_ex *init_attr_ex)
 {
 	struct efa_qp *qp;
 	struct efadv_qp_init_attr efa_attr = { 0 };
@@ -177,8 +190,63 @@ int efa_base_ep_create_qp(struct efa_base_ep *base_ep,
 	}
 
 	qp->ibv_qp_ex = ibv_qp_to_qp_ex(qp->ibv_qp);
-	base_ep->qp = qp;
 	qp->base_ep = base_ep;
+	*qp_ptr = qp;
+	return 0;
+}
+
+int efa_base_ep_create_qp(struct efa_base_ep *base_ep,
+			  struct ibv_qp_init_attr_ex *init_attr_ex)
+{
+	return efa_qp_create(base_ep, &base_ep->qp, init_attr_ex);
+}
+
+/**
+ * @brief create extra QPs that RMA requests are spread over
+ *
+ * The QPs share the completion queues in init_attr_ex with the endpoint's
+ * own QP and are enabled together with it, using the same qkey.
+ *
+ * @param[in,out]	base_ep		base endpoint
+ * @param[in]		init_attr_ex	QP attributes
+ * @param[in]		cnt		number of extra QPs to create
+ * @return		0 on success, negative libfabric error code on failure
+ */
+int efa_base_ep_create_rma_qps(struct efa_base_ep *base_ep,
+			       struct ibv_qp_init_attr_ex *init_attr_ex,
+			       size_t cnt)
+{
+	int err;
+
+	assert(!base_ep->rma_qp);
+	base_ep->rma_qp = calloc(cnt, sizeof(*base_ep->rma_qp));
+	if (!base_ep->rma_qp)
+		return -FI_ENOMEM;
+
+	for (; base_ep->rma_qp_cnt < cnt; base_ep->rma_qp_cnt++) {
+		err = efa_qp_create(base_ep, &base_ep->rma_qp[base_ep->rma_qp_cnt],
+				    init_attr_ex);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static int efa_qp_enable(struct efa_base_ep *base_ep, struct efa_qp *qp,
+			 uint32_t qkey)
+{
+	int err;
+
+	qp->qkey = qkey;
+	err = efa_base_ep_modify_qp_rst2rts(base_ep, qp);
+	if (err)
+		return err;
+
+	qp->qp_num = qp->ibv_qp->qp_num;
+	base_ep->domain->qp_table[qp->qp_num & base_ep->domain->qp_table_sz_m1] = qp;
+	EFA_INFO(FI_LOG_EP_CTRL, "QP enabled! qp_n: %d qkey: %d\n", qp->qp_num, qp->qkey);
+
 	return 0;
 }
 
@@ -186,23 +254,26 @@ static
 int efa_base_ep_enable_qp(struct efa_base_ep *base_ep)
 {
 	struct efa_qp *qp;
+	size_t i;
 	int err;
 
 	qp = base_ep->qp;
-	qp->qkey = (base_ep->util_ep.type == FI_EP_DGRAM) ?
-			   EFA_DGRAM_CONNID :
-			   efa_generate_rdm_connid();
-	err = efa_base_ep_modify_qp_rst2rts(base_ep, qp);
+	err = efa_qp_enable(base_ep, qp,
+			    (base_ep->util_ep.type == FI_EP_DGRAM) ?
+				    EFA_DGRAM_CONNID :
+				    efa_generate_rdm_connid());
 	if (err)
 		return err;
 
 	base_ep->efa_qp_enabled = true;
 
-	qp->qp_num = qp->ibv_qp->qp_num;
-	base_ep->domain->qp_table[qp->qp_num & base_ep->domain->qp_table_sz_m1] = qp;
-	EFA_INFO(FI_LOG_EP_CTRL, "QP enabled! qp_n: %d qkey: %d\n", qp->qp_num, qp->qkey);
+	for (i = 0; i < base_ep->rma_qp_cnt; i++) {
+		err = efa_qp_enable(base_ep, base_ep->rma_qp[i], qp->qkey);
+		if (err)
+			return err;
+	}
 
-	return err;
+	return 0;
 }
 
 /* efa_base_ep_create_self_ah() create an address handler for
@@ -18,6 +18,8 @@ struct efa_qp {
 	struct efa_base_ep *base_ep;
 	uint32_t qp_num;
 	uint32_t qkey;
+	/* a WR session is open, to be completed when the TX batch is flushed */
+	bool wr_batched;
 };
 
 struct efa_av;
@@ -39,6 +41,10 @@ struct efa_base_ep {
 	struct util_ep util_ep;
 	struct efa_domain *domain;
 	struct efa_qp *qp;
+	/* extra QPs RMA requests are spread over, round robin with qp */
+	struct efa_qp **rma_qp;
+	size_t rma_qp_cnt;
+	size_t rma_qp_next;
 	struct efa_av *av;
 	struct fi_info *info;
 	size_t rnr_retry;
@@ -72,6 +78,28 @@ int efa_base_ep_getname(fid_t fid, void *addr, size_t *addrlen);
 int efa_base_ep_create_qp(struct efa_base_ep *base_ep,
 			  struct ibv_qp_init_attr_ex *init_attr_ex);
 
+int efa_base_ep_create_rma_qps(struct efa_base_ep *base_ep,
+			       struct ibv_qp_init_attr_ex *init_attr_ex,
+			       size_t cnt);
+
+/**
+ * @brief return the QP to post the next RMA request on
+ *
+ * @param[in]	base_ep	base endpoint
+ * @return	the endpoint's own QP or one of its extra RMA QPs
+ */
+static inline
+struct efa_qp *efa_base_ep_next_rma_qp(struct efa_base_ep *base_ep)
+{
+	size_t i;
+
+	if (!base_ep->rma_qp_cnt)
+		return base_ep->qp;
+
+	i = base_ep->rma_qp_next++ % (base_ep->rma_qp_cnt + 1);
+	return i ? base_ep->rma_qp[i - 1] : base_ep->qp;
+}
+
 bool efa_base_ep_support_op_in_order_aligned_128_bytes(struct efa_base_ep *base_ep,
 						       enum ibv_wr_opcode op);
 
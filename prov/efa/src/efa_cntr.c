@@ -28,7 +28,7 @@ static int efa_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int time
 
 	for (tryid = 0; tryid < numtry; ++tryid) {
 		cntr->progress(cntr);
-		if (threshold <= ofi_atomic_get64(&cntr->cnt)) {
+		if (threshold <= ofi_cntr_value(cntr)) {
 		        ret = FI_SUCCESS;
 			goto unlock;
 		}
@@ -192,42 +192,46 @@ free:
 	return ret;
 }
 
-void efa_cntr_report_tx_completion(struct util_ep *ep, uint64_t flags)
+enum ofi_cntr_index efa_cntr_tx_index(uint64_t flags)
 {
-	struct util_cntr *cntr;
-
 	flags &= (FI_SEND | FI_WRITE | FI_READ);
 	assert(flags == FI_SEND || flags == FI_WRITE || flags == FI_READ);
 
 	if (flags == FI_SEND)
-		cntr = ep->cntrs[CNTR_TX];
+		return CNTR_TX;
 	else if (flags == FI_WRITE)
-		cntr = ep->cntrs[CNTR_WR];
-	else if (flags == FI_READ)
-		cntr = ep->cntrs[CNTR_RD];
+		return CNTR_WR;
 	else
-		cntr = NULL;
-
-	if (cntr)
-		cntr->cntr_fid.ops->add(&cntr->cntr_fid, 1);
+		return CNTR_RD;
 }
 
-void efa_cntr_report_rx_completion(struct util_ep *ep, uint64_t flags)
+enum ofi_cntr_index efa_cntr_rx_index(uint64_t flags)
 {
-	struct util_cntr *cntr;
-
 	flags &= (FI_RECV | FI_REMOTE_WRITE | FI_REMOTE_READ);
 	assert(flags == FI_RECV || flags == FI_REMOTE_WRITE || flags == FI_REMOTE_READ);
 
 	if (flags == FI_RECV)
-		cntr = ep->cntrs[CNTR_RX];
+		return CNTR_RX;
 	else if (flags == FI_REMOTE_READ)
-		cntr = ep->cntrs[CNTR_REM_RD];
-	else if (flags == FI_REMOTE_WRITE)
-		cntr = ep->cntrs[CNTR_REM_WR];
+		return CNTR_REM_RD;
 	else
-		cntr = NULL;
+		return CNTR_REM_WR;
+}
+
+void efa_cntr_report_tx_completion(struct util_ep *ep, uint64_t flags)
+{
+	struct util_cntr *cntr;
+
+	cntr = ep->cntrs[efa_cntr_tx_index(flags)];
+	if (cntr)
+		cntr->cntr_fid.ops->add(&cntr->cntr_fid, 1);
+}
+
+void efa_cntr_report_rx_completion(struct util_ep *ep, uint64_t flags)
+{
+	struct util_cntr *cntr;
 
+	cntr = ep->cntrs[efa_cntr_rx_index(flags)];
 	if (cntr)
 		cntr->cntr_fid.ops->add(&cntr->cntr_fid, 1);
 }
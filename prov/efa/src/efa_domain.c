@@ -409,8 +409,30 @@ efa_domain_query_mr(struct fid_mr *mr, struct fi_efa_mr_attr *mr_attr)
 
 #endif /* HAVE_EFADV_QUERY_MR */
 
+/**
+ * @brief Register memory regions ahead of use and keep them in the MR cache,
+ * so that the first transfers on them do not register memory.
+ *
+ * @param domain_fid ptr to fid_domain
+ * @param attr  array of fi_mr_attr, each with one iov
+ * @param count  number of regions
+ * @param nthreads  maximum number of threads to register with
+ * @return int 0 on success, negative integer on failure
+ */
+static int
+efa_domain_cache_mr(struct fid_domain *domain_fid, const struct fi_mr_attr *attr,
+		    size_t count, size_t nthreads)
+{
+	struct efa_domain *efa_domain;
+
+	efa_domain = container_of(domain_fid, struct efa_domain,
+				  util_domain.domain_fid);
+	return efa_mr_cache_prereg(efa_domain, attr, count, nthreads);
+}
+
 static struct fi_efa_ops_domain efa_ops_domain = {
 	.query_mr = efa_domain_query_mr,
+	.cache_mr = efa_domain_cache_mr,
 };
 
 static int
@@ -33,6 +33,7 @@ struct efa_env efa_env = {
 	.efa_max_gdrcopy_msg_size = 32768,
 	.efa_read_segment_size = 1073741824,
 	.efa_write_segment_size = 1073741824, /* need to confirm this constant. */
+	.rma_qp_count = 1,
 	.rnr_retry = 3, /* Setting this value to EFA_RNR_INFINITE_RETRY makes the firmware retry indefinitey */
 	.host_id_file = "/sys/devices/virtual/dmi/id/board_asset_tag", /* Available on EC2 instances and containers */
 	.use_sm2 = false,
@@ -140,6 +141,7 @@ void efa_env_param_get(void)
 			    &efa_env.efa_read_segment_size);
 	fi_param_get_size_t(&efa_prov, "inter_max_gdrcopy_message_size",
 			    &efa_env.efa_max_gdrcopy_msg_size);
+	fi_param_get_size_t(&efa_prov, "rma_qp_count", &efa_env.rma_qp_count);
 	fi_param_get_bool(&efa_prov, "use_sm2", &efa_env.use_sm2);
 
 	int use_huge_page;
@@ -200,11 +202,15 @@ void efa_env_define()
 	fi_param_define(&efa_prov, "inter_min_read_message_size", FI_PARAM_INT,
 			"The minimum message size in bytes for inter EFA read message protocol. If instance support RDMA read, messages whose size is larger than this value will be sent by read message protocol (Default 1048576).");
 	fi_param_define(&efa_prov, "inter_max_gdrcopy_message_size", FI_PARAM_INT,
-			"The maximum message size to use gdrcopy. If instance support gdrcopy, messages whose size is smaller than this value will be sent by eager/longcts protocol (Default 32768).");
+			"The maximum message size to use gdrcopy. If instance support gdrcopy, messages whose size is smaller than this value will be sent by eager/medium protocol instead of read based protocols (Default 32768).");
+	fi_param_define(&efa_prov, "inter_min_read_tagged_message_size", FI_PARAM_INT,
+			"The minimum message size in bytes for inter EFA tagged messages in host memory to use read message protocol, so that the receiver reads the data directly into the matched receive buffer instead of copying it out of bounce buffers. (Default: FI_EFA_INTER_MIN_READ_MESSAGE_SIZE)");
 	fi_param_define(&efa_prov, "inter_min_read_write_size", FI_PARAM_INT,
 			"The mimimum message size for inter EFA write to use read write protocol. If firmware support RDMA read, and FI_EFA_USE_DEVICE_RDMA is 1, write requests whose size is larger than this value will use the read write protocol (Default 65536).");
 	fi_param_define(&efa_prov, "inter_read_segment_size", FI_PARAM_INT,
 			"Calls to RDMA read is segmented using this value.");
+	fi_param_define(&efa_prov, "rma_qp_count", FI_PARAM_SIZE_T,
+			"Number of QPs an RDM endpoint spreads large RDMA read and write requests over, including its own QP. (Default: 1)");
 	fi_param_define(&efa_prov, "fork_safe", FI_PARAM_BOOL,
 			"Enables fork support and disables internal usage of huge pages. Has no effect on kernels which set copy-on-fork for registered pages, generally 5.13 and later. (Default: false)");
 	fi_param_define(&efa_prov, "runt_size", FI_PARAM_INT,
@@ -47,6 +47,8 @@ struct efa_env {
 	size_t efa_max_gdrcopy_msg_size;
 	size_t efa_read_segment_size;
 	size_t efa_write_segment_size;
+	/* number of QPs an RDM endpoint spreads RDMA read and write over */
+	size_t rma_qp_count;
 	/* If first attempt to send a packet failed,
 	 * this value controls how many times firmware
 	 * retries the send before it report an RNR error
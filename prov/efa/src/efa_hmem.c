@@ -48,11 +48,15 @@ static int efa_domain_hmem_info_init_protocol_thresholds(struct efa_domain *efa_
 		fi_param_get_size_t(&efa_prov, "inter_max_medium_message_size", &info->max_medium_msg_size);
 		fi_param_get_size_t(&efa_prov, "inter_min_read_message_size", &info->min_read_msg_size);
 		fi_param_get_size_t(&efa_prov, "inter_min_read_write_size", &info->min_read_write_size);
+		info->min_read_tagged_msg_size = info->min_read_msg_size;
+		fi_param_get_size_t(&efa_prov, "inter_min_read_tagged_message_size",
+				    &info->min_read_tagged_msg_size);
 		break;
 	case FI_HMEM_CUDA:
 		info->runt_size = EFA_DEFAULT_RUNT_SIZE;
 		info->max_intra_eager_size = cuda_is_gdrcopy_enabled() ? EFA_DEFAULT_INTRA_MAX_GDRCOPY_FROM_DEV_SIZE : 0;
 		info->max_medium_msg_size = 0;
+		info->max_gdrcopy_msg_size = cuda_is_gdrcopy_enabled() ? efa_env.efa_max_gdrcopy_msg_size : 0;
 		info->min_read_msg_size = efa_max_eager_msg_size_with_largest_header(efa_domain) + 1;
 		info->min_read_write_size = efa_max_eager_msg_size_with_largest_header(efa_domain) + 1;
 		fi_param_get_size_t(&efa_prov, "runt_size", &info->runt_size);
@@ -79,6 +83,10 @@ static int efa_domain_hmem_info_init_protocol_thresholds(struct efa_domain *efa_
 	default:
 		break;
 	}
+
+	/* Only the host memory thresholds have a medium protocol for reads to replace */
+	if (iface != FI_HMEM_SYSTEM)
+		info->min_read_tagged_msg_size = info->min_read_msg_size;
 	return 0;
 }
 
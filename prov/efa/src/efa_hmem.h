@@ -29,8 +29,10 @@ struct efa_hmem_info {
 
 	size_t max_intra_eager_size; /* Maximum message size to use eager protocol for intra-node */
 	size_t max_medium_msg_size;
+	size_t max_gdrcopy_msg_size; /* Maximum device message size to copy with gdrcopy instead of reading */
 	size_t runt_size;
 	size_t min_read_msg_size;
+	size_t min_read_tagged_msg_size; /* min_read_msg_size of tagged messages */
 	size_t min_read_write_size;
 };
 
@@ -385,6 +385,98 @@ static int efa_mr_cache_reg(struct fid *fid, const void *buf, size_t len,
 				 flags, mr_fid, context);
 }
 
+struct efa_mr_prereg_work {
+	struct efa_domain *domain;
+	const struct fi_mr_attr *attr;
+	size_t count;
+	ofi_atomic64_t next;
+	ofi_atomic32_t err;
+};
+
+static void *efa_mr_prereg_thread(void *arg)
+{
+	struct efa_mr_prereg_work *work = arg;
+	struct fid_mr *mr_fid;
+	int64_t i;
+	int err;
+
+	while ((i = ofi_atomic_inc64(&work->next) - 1) < (int64_t) work->count) {
+		err = efa_mr_cache_regattr(&work->domain->util_domain.domain_fid.fid,
+					   &work->attr[i], 0, &mr_fid);
+		if (err) {
+			EFA_WARN(FI_LOG_MR, "Unable to cache mr %p (len: %zu): %s\n",
+				 work->attr[i].mr_iov->iov_base,
+				 work->attr[i].mr_iov->iov_len, fi_strerror(-err));
+			ofi_atomic_cas_bool32(&work->err, 0, err);
+			continue;
+		}
+
+		/* The entry stays registered in the cache once unused */
+		fi_close(&mr_fid->fid);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief register regions ahead of use and leave them in the MR cache
+ *
+ * Registration, including ibv_reg_mr and dmabuf pinning, runs outside of
+ * the cache lock, so the regions are spread over nthreads threads,
+ * counting the calling one.  Later registrations of these regions, or of
+ * parts of them, are then cache hits.  Regions dropped because the cache
+ * is full, or evicted later, are registered again on use.
+ *
+ * @param[in]	domain		efa domain
+ * @param[in]	attr		regions to register, each with one iov
+ * @param[in]	count		number of regions
+ * @param[in]	nthreads	maximum number of registering threads
+ * @return	0 if every region was cached, otherwise the first error
+ */
+int efa_mr_cache_prereg(struct efa_domain *domain, const struct fi_mr_attr *attr,
+			size_t count, size_t nthreads)
+{
+	struct efa_mr_prereg_work work;
+	pthread_t *threads = NULL;
+	size_t i, started = 0;
+
+	if (!domain->cache)
+		return -FI_ENOSYS;
+
+	for (i = 0; i < count; i++) {
+		if (attr[i].iov_count != 1 || attr[i].iface == FI_HMEM_NEURON ||
+		    attr[i].iface == FI_HMEM_SYNAPSEAI)
+			return -FI_EINVAL;
+	}
+
+	work.domain = domain;
+	work.attr = attr;
+	work.count = count;
+	ofi_atomic_initialize64(&work.next, 0);
+	ofi_atomic_initialize32(&work.err, 0);
+
+	nthreads = MIN(nthreads, count);
+	if (nthreads > 1) {
+		threads = calloc(nthreads - 1, sizeof(*threads));
+		if (!threads)
+			return -FI_ENOMEM;
+	}
+
+	for (; started + 1 < nthreads; started++) {
+		if (pthread_create(&threads[started], NULL,
+				   efa_mr_prereg_thread, &work))
+			break;
+	}
+
+	efa_mr_prereg_thread(&work);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	return ofi_atomic_get32(&work.err);
+}
+
 struct fi_ops_mr efa_domain_mr_cache_ops = {
 	.size = sizeof(struct fi_ops_mr),
 	.reg = efa_mr_cache_reg,
@@ -52,6 +52,9 @@ int efa_mr_cache_entry_reg(struct ofi_mr_cache *cache,
 void efa_mr_cache_entry_dereg(struct ofi_mr_cache *cache,
 			      struct ofi_mr_entry *entry);
 
+int efa_mr_cache_prereg(struct efa_domain *domain, const struct fi_mr_attr *attr,
+			size_t count, size_t nthreads);
+
 static inline bool efa_mr_is_hmem(struct efa_mr *efa_mr)
 {
 	return efa_mr ? (efa_mr->peer.iface == FI_HMEM_CUDA ||
@@ -21,6 +21,8 @@ enum {
 
 struct fi_efa_ops_domain {
 	int (*query_mr)(struct fid_mr *mr, struct fi_efa_mr_attr *mr_attr);
+	int (*cache_mr)(struct fid_domain *domain, const struct fi_mr_attr *attr,
+			size_t count, size_t nthreads);
 };
 
 #endif /* _FI_EXT_EFA_H_ */
@@ -39,6 +39,45 @@ struct efa_rdm_ep_queued_copy {
 #define EFA_RDM_EP_MAX_WR_PER_IBV_POST_SEND (4096)
 #define EFA_RDM_EP_MAX_WR_PER_IBV_POST_RECV (8192)
 
+/* Max cq_poll_budget, as a multiple of efa_env.efa_cq_read_size */
+#define EFA_RDM_EP_CQ_POLL_BUDGET_MAX_SCALE (8)
+
+/* A packet posted on a QP whose WR session is submitted by efa_rdm_ep_flush_tx_batch() */
+struct efa_rdm_tx_batch_entry {
+	struct efa_rdm_pke *pkt_entry;
+	struct efa_qp *qp;
+};
+
+/* A completion held by the endpoint until efa_rdm_ep_flush_comp_batch() */
+struct efa_rdm_comp_batch_entry {
+	struct util_cq *cq;
+	struct fi_cq_tagged_entry comp;
+	fi_addr_t src;
+};
+
+#define EFA_RDM_EP_COMP_BATCH_SIZE (64)
+
+/* Latency breakdown exported through fi_open_ops(ep, "perf_hist").
+ * The protocol histograms record the time from posting a send until its
+ * completion is reported.  CTS wait is the time a longcts send waits for
+ * its first CTS, RNR queue the time an operation's packets are held after
+ * an RNR, and RNR backoff the time a peer spends in backoff.
+ */
+enum {
+	EFA_RDM_HIST_EAGER,
+	EFA_RDM_HIST_MEDIUM,
+	EFA_RDM_HIST_LONGCTS,
+	EFA_RDM_HIST_LONGREAD,
+	EFA_RDM_HIST_RUNTREAD,
+	EFA_RDM_HIST_CTS_WAIT,
+	EFA_RDM_HIST_RNR_QUEUE,
+	EFA_RDM_HIST_RNR_BACKOFF,
+	EFA_RDM_HIST_MAX
+};
+
+/* Minimum size of the stripes a large RDMA request is cut into */
+#define EFA_RDM_RMA_STRIPE_MIN_SIZE (65536)
+
 struct efa_rdm_ep {
 	struct efa_base_ep base_ep;
 
@@ -117,8 +156,6 @@ struct efa_rdm_ep {
 
 	/* datastructure to maintain send/recv states */
 	struct ofi_bufpool *ope_pool;
-	/* data structure to maintain pkt rx map */
-	struct ofi_bufpool *map_entry_pool;
 	/** a map between sender address + msg_id to RX entry */
 	struct efa_rdm_rxe_map rxe_map;
 	/*
@@ -181,6 +218,13 @@ struct efa_rdm_ep {
 	 */
 	size_t efa_rx_pkts_held;
 
+	/*
+	 * Max number of CQEs to process in one progress pass. It grows while
+	 * passes drain the whole budget and shrinks back to
+	 * efa_env.efa_cq_read_size when completions slow down.
+	 */
+	size_t cq_poll_budget;
+
 	/* number of outstanding tx ops on efa device */
 	size_t efa_outstanding_tx_ops;
 
@@ -208,8 +252,27 @@ struct efa_rdm_ep {
 	bool write_in_order_aligned_128_bytes; /**< whether to support in order write of each aligned 128 bytes memory region */
 	char err_msg[EFA_RDM_ERROR_MSG_BUFFER_LENGTH]; /* A large enough buffer to store CQ/EQ error data used by e.g. fi_cq_readerr */
 	struct efa_rdm_pke **pke_vec;
+	/* while the TX batch is open, WRs posted during a progress pass are
+	 * submitted together, with one doorbell per QP */
+	bool tx_batch_open;
+	size_t tx_batch_cnt;
+	struct efa_rdm_tx_batch_entry *tx_batch;
+	/* while the completion batch is open, CQ entries and counter
+	 * increments are held and written once per progress pass */
+	bool comp_batch_open;
+	size_t comp_batch_cnt;
+	struct efa_rdm_comp_batch_entry comp_batch[EFA_RDM_EP_COMP_BATCH_SIZE];
+	uint64_t cntr_batch[CNTR_CNT];
+	/* latency histograms, allocated on the first fi_open_ops("perf_hist") */
+	struct ofi_hist_set *hist;
 };
 
+static inline void
+efa_rdm_ep_hist_add(struct efa_rdm_ep *ep, int id, uint64_t start)
+{
+	ofi_hist_add(&ep->hist->hist[id], ofi_gettime_ns() - start);
+}
+
 int efa_rdm_ep_flush_queued_blocking_copy_to_hmem(struct efa_rdm_ep *ep);
 
 #define efa_rdm_rx_flags(efa_rdm_ep) ((efa_rdm_ep)->base_ep.util_ep.rx_op_flags)
@@ -241,6 +304,18 @@ void efa_rdm_ep_record_tx_op_submitted(struct efa_rdm_ep *ep, struct efa_rdm_pke
 
 void efa_rdm_ep_record_tx_op_completed(struct efa_rdm_ep *ep, struct efa_rdm_pke *pkt_entry);
 
+void efa_rdm_ep_flush_tx_batch(struct efa_rdm_ep *ep);
+
+int efa_rdm_ep_write_cq(struct efa_rdm_ep *ep, struct util_cq *cq,
+			void *context, uint64_t flags, size_t len, void *buf,
+			uint64_t data, uint64_t tag, fi_addr_t src);
+
+void efa_rdm_ep_report_tx_cntr(struct efa_rdm_ep *ep, uint64_t flags);
+
+void efa_rdm_ep_report_rx_cntr(struct efa_rdm_ep *ep, uint64_t flags);
+
+void efa_rdm_ep_flush_comp_batch(struct efa_rdm_ep *ep);
+
 static inline size_t efa_rdm_ep_get_rx_pool_size(struct efa_rdm_ep *ep)
 {
 	return MIN(ep->efa_max_outstanding_rx_ops, ep->rx_size);
@@ -27,6 +27,7 @@ static
 int efa_rdm_ep_create_base_ep_ibv_qp(struct efa_rdm_ep *ep)
 {
 	struct ibv_qp_init_attr_ex attr_ex = { 0 };
+	int err;
 
 	attr_ex.cap.max_send_wr = ep->base_ep.domain->device->rdm_info->tx_attr->size;
 	attr_ex.cap.max_send_sge = ep->base_ep.domain->device->rdm_info->tx_attr->iov_limit;
@@ -52,7 +53,15 @@ int efa_rdm_ep_create_base_ep_ibv_qp(struct efa_rdm_ep *ep)
 	attr_ex.qp_context = ep;
 	attr_ex.sq_sig_all = 1;
 
-	return efa_base_ep_create_qp(&ep->base_ep, &attr_ex);
+	err = efa_base_ep_create_qp(&ep->base_ep, &attr_ex);
+	if (err || efa_env.rma_qp_count <= 1 ||
+	    !(efa_device_support_rdma_read() || efa_device_support_rdma_write()))
+		return err;
+
+	/* RMA QPs only post RDMA requests, peers always send to the main QP */
+	attr_ex.cap.max_recv_wr = 1;
+	return efa_base_ep_create_rma_qps(&ep->base_ep, &attr_ex,
+					  efa_env.rma_qp_count - 1);
 }
 
 static
@@ -213,15 +222,6 @@ int efa_rdm_ep_create_buffer_pools(struct efa_rdm_ep *ep)
 		ep->rx_readcopy_pkt_pool_max_used = 0;
 	}
 
-	ret = ofi_bufpool_create(&ep->map_entry_pool,
-				 sizeof(struct efa_rdm_rxe_map_entry),
-				 EFA_RDM_BUFPOOL_ALIGNMENT,
-				 0, /* no limit for max_cnt */
-				 ep->rx_size, 0);
-
-	if (ret)
-		goto err_free;
-
 	ret = ofi_bufpool_create(&ep->rx_atomrsp_pool, ep->mtu_size,
 				 EFA_RDM_BUFPOOL_ALIGNMENT,
 				 0, /* no limit for max_cnt */
@@ -244,9 +244,6 @@ err_free:
 	if (ep->rx_atomrsp_pool)
 		ofi_bufpool_destroy(ep->rx_atomrsp_pool);
 
-	if (ep->map_entry_pool)
-		ofi_bufpool_destroy(ep->map_entry_pool);
-
 	if (ep->ope_pool)
 		ofi_bufpool_destroy(ep->ope_pool);
 
@@ -337,6 +334,55 @@ static int efa_rdm_ep_ctrl(struct fid *fid, int command, void *arg);
 
 static int efa_rdm_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags);
 
+static const char * const efa_rdm_hist_names[EFA_RDM_HIST_MAX] = {
+	[EFA_RDM_HIST_EAGER] = "efa_rdm_eager",
+	[EFA_RDM_HIST_MEDIUM] = "efa_rdm_medium",
+	[EFA_RDM_HIST_LONGCTS] = "efa_rdm_longcts",
+	[EFA_RDM_HIST_LONGREAD] = "efa_rdm_longread",
+	[EFA_RDM_HIST_RUNTREAD] = "efa_rdm_runtread",
+	[EFA_RDM_HIST_CTS_WAIT] = "efa_rdm_cts_wait",
+	[EFA_RDM_HIST_RNR_QUEUE] = "efa_rdm_rnr_queue",
+	[EFA_RDM_HIST_RNR_BACKOFF] = "efa_rdm_rnr_backoff",
+};
+
+static int efa_rdm_ep_open_hist(struct efa_rdm_ep *ep, void **ops)
+{
+	struct ofi_genlock *lock;
+	int ret = 0;
+
+	lock = &efa_rdm_ep_domain(ep)->srx_lock;
+	ofi_genlock_lock(lock);
+	if (!ep->hist) {
+		ep->hist = ofi_hist_set_alloc(&ep->base_ep.util_ep.ep_fid.fid,
+					      lock, efa_rdm_hist_names,
+					      EFA_RDM_HIST_MAX);
+		if (!ep->hist)
+			ret = -FI_ENOMEM;
+	}
+	if (!ret)
+		*ops = &ep->hist->hist_fid;
+	ofi_genlock_unlock(lock);
+	return ret;
+}
+
+/**
+ * @brief implement the fi_open_ops() API for EFA RDM endpoint
+ *
+ * "perf_hist" returns the latency histograms of the endpoint, see
+ * EFA_RDM_HIST_MAX.
+ */
+static int efa_rdm_ep_ops_open(struct fid *fid, const char *name,
+			       uint64_t flags, void **ops, void *context)
+{
+	struct efa_rdm_ep *ep;
+
+	if (strcmp(name, "perf_hist"))
+		return -FI_ENOSYS;
+
+	ep = container_of(fid, struct efa_rdm_ep, base_ep.util_ep.ep_fid.fid);
+	return efa_rdm_ep_open_hist(ep, ops);
+}
+
 /**
  * @brief function pointers to libfabric endpoint's fabric interface API
  * These functions applies to a libfabric object
@@ -346,7 +392,7 @@ static struct fi_ops efa_rdm_ep_base_ops = {
 	.close = efa_rdm_ep_close,
 	.bind = efa_rdm_ep_bind,
 	.control = efa_rdm_ep_ctrl,
-	.ops_open = fi_no_ops_open,
+	.ops_open = efa_rdm_ep_ops_open,
 };
 
 /**
@@ -470,6 +516,7 @@ int efa_rdm_ep_open(struct fid_domain *domain, struct fi_info *info,
 	efa_rdm_ep->efa_rx_pkts_to_post = 0;
 	efa_rdm_ep->efa_rx_pkts_held = 0;
 	efa_rdm_ep->efa_outstanding_tx_ops = 0;
+	efa_rdm_ep->cq_poll_budget = efa_env.efa_cq_read_size;
 
 	assert(!efa_rdm_ep->ibv_cq_ex);
 
@@ -520,6 +567,15 @@ int efa_rdm_ep_open(struct fid_domain *domain, struct fi_info *info,
 		goto err_close_core_cq;
 	}
 
+	/* every batched packet is from the TX pool, which cannot grow */
+	efa_rdm_ep->tx_batch = calloc(efa_rdm_ep_get_tx_pool_size(efa_rdm_ep),
+				      sizeof(*efa_rdm_ep->tx_batch));
+	if (!efa_rdm_ep->tx_batch) {
+		EFA_WARN(FI_LOG_EP_CTRL, "cannot alloc memory for efa_rdm_ep->tx_batch!\n");
+		ret = -FI_ENOMEM;
+		goto err_close_core_cq;
+	}
+
 	*ep = &efa_rdm_ep->base_ep.util_ep.ep_fid;
 	(*ep)->msg = &efa_rdm_msg_ops;
 	(*ep)->rma = &efa_rdm_rma_ops;
@@ -712,8 +768,7 @@ static void efa_rdm_ep_destroy_buffer_pools(struct efa_rdm_ep *efa_rdm_ep)
 	if (efa_rdm_ep->ope_pool)
 		ofi_bufpool_destroy(efa_rdm_ep->ope_pool);
 
-	if (efa_rdm_ep->map_entry_pool)
-		ofi_bufpool_destroy(efa_rdm_ep->map_entry_pool);
+	efa_rdm_rxe_map_destruct(&efa_rdm_ep->rxe_map);
 
 	if (efa_rdm_ep->rx_readcopy_pkt_pool) {
 		EFA_INFO(FI_LOG_EP_CTRL, "current usage of read copy packet pool is %d\n",
@@ -825,6 +880,10 @@ static int efa_rdm_ep_close(struct fid *fid)
 
 	if (efa_rdm_ep->pke_vec)
 		free(efa_rdm_ep->pke_vec);
+
+	free(efa_rdm_ep->tx_batch);
+	ofi_hist_set_free(&efa_rdm_ep->base_ep.util_ep.ep_fid.fid,
+			  efa_rdm_ep->hist);
 	free(efa_rdm_ep);
 	return retv;
 }
@@ -118,17 +118,6 @@ int efa_rdm_ep_grow_rx_pools(struct efa_rdm_ep *ep)
 		}
 	}
 
-	if (ep->map_entry_pool) {
-		err = ofi_bufpool_grow(ep->map_entry_pool);
-		if (err) {
-			EFA_WARN(FI_LOG_CQ,
-				 "cannot allocate memory for map entry pool. error: %s\n",
-				 strerror(-err));
-		}
-
-		return err;
-	}
-
 	return 0;
 }
 
@@ -222,6 +211,15 @@ void efa_rdm_ep_progress_post_internal_rx_pkts(struct efa_rdm_ep *ep)
 		}
 		/* only valid for non-zero copy */
 		assert(ep->efa_rx_pkts_to_post + ep->efa_rx_pkts_posted + ep->efa_rx_pkts_held == efa_rdm_ep_get_rx_pool_size(ep));
+
+		/*
+		 * Refill in batches of about one poll budget, the number of
+		 * packets recent passes have received, unless the device
+		 * could run out of buffers before the next refill.
+		 */
+		if (ep->efa_rx_pkts_to_post < ep->cq_poll_budget &&
+		    ep->efa_rx_pkts_posted > 2 * ep->cq_poll_budget)
+			return;
 	}
 
 	err = efa_rdm_ep_bulk_post_internal_rx_pkts(ep);
@@ -240,16 +238,21 @@ void efa_rdm_ep_check_peer_backoff_timer(struct efa_rdm_ep *ep)
 {
 	struct efa_rdm_peer *peer;
 	struct dlist_entry *tmp;
+	uint64_t now;
 
 	if (OFI_LIKELY(dlist_empty(&ep->peer_backoff_list)))
 		return;
 
 	dlist_foreach_container_safe(&ep->peer_backoff_list, struct efa_rdm_peer,
 				     peer, rnr_backoff_entry, tmp) {
-		if (ofi_gettime_us() >= peer->rnr_backoff_begin_ts +
-					peer->rnr_backoff_wait_time) {
+		now = ofi_gettime_us();
+		if (now >= peer->rnr_backoff_begin_ts +
+			   peer->rnr_backoff_wait_time) {
 			peer->flags &= ~EFA_RDM_PEER_IN_BACKOFF;
 			dlist_remove(&peer->rnr_backoff_entry);
+			if (ep->hist)
+				ofi_hist_add(&ep->hist->hist[EFA_RDM_HIST_RNR_BACKOFF],
+					     (now - peer->rnr_backoff_begin_ts) * 1000);
 		}
 	}
 }
@@ -261,6 +264,12 @@ void efa_rdm_ep_check_peer_backoff_timer(struct efa_rdm_ep *ep)
  * remote endpoint.  These do not have a packet context, nor do they have a
  * connid available.
  *
+ * Each of them still consumes a posted receive buffer, because the device
+ * cannot complete a write with immediate data without one. That is why
+ * small messages stay on send/recv rather than being written into a
+ * per-peer receive ring: a ring would neither save the receive queue entry
+ * nor the copy to the user buffer.
+ *
  * @param[in,out]	ep		endpoint
  * @param[in]		imm_data	Data provided in the IMMEDIATE value.
  * @param[in]		len		Payload	length
@@ -280,15 +289,15 @@ void efa_rdm_ep_proc_ibv_recv_rdma_with_imm_completion(struct efa_rdm_ep *ep,
 	target_cq = ep->base_ep.util_ep.rx_cq;
 	efa_av = ep->base_ep.av;
 
-	if (ep->base_ep.util_ep.caps & FI_SOURCE) {
+	if (ep->base_ep.util_ep.caps & FI_SOURCE)
 		src_addr = efa_av_reverse_lookup_rdm(efa_av,
 						ibv_wc_read_slid(ep->ibv_cq_ex),
 						ibv_wc_read_src_qp(ep->ibv_cq_ex),
 						NULL);
-		ret = ofi_cq_write_src(target_cq, NULL, flags, len, NULL, imm_data, 0, src_addr);
-	} else {
-		ret = ofi_cq_write(target_cq, NULL, flags, len, NULL, imm_data, 0);
-	}
+	else
+		src_addr = FI_ADDR_NOTAVAIL;
+
+	ret = efa_rdm_ep_write_cq(ep, target_cq, NULL, flags, len, NULL, imm_data, 0, src_addr);
 
 	if (OFI_UNLIKELY(ret)) {
 		EFA_WARN(FI_LOG_CQ,
@@ -297,7 +306,7 @@ void efa_rdm_ep_proc_ibv_recv_rdma_with_imm_completion(struct efa_rdm_ep *ep,
 		efa_base_ep_write_eq_error(&ep->base_ep, FI_EIO, FI_EFA_ERR_WRITE_SHM_CQ_ENTRY);
 	}
 
-	efa_cntr_report_rx_completion(&ep->base_ep.util_ep, flags);
+	efa_rdm_ep_report_rx_cntr(ep, flags);
 
 	/* Recv with immediate will consume a pkt_entry, but the pkt is not
 	   filled, so free the pkt_entry and record we have one less posted
@@ -413,8 +422,9 @@ fi_addr_t efa_rdm_ep_determine_addr_from_ibv_cq(struct efa_rdm_ep *ep, struct ib
  *
  * @param[in]	ep	RDM endpoint
  * @param[in]	cqe_to_process	Max number of cq entry to poll and process. Must be positive.
+ * @return	number of cq entries processed
  */
-static inline void efa_rdm_ep_poll_ibv_cq(struct efa_rdm_ep *ep, size_t cqe_to_process)
+static inline size_t efa_rdm_ep_poll_ibv_cq(struct efa_rdm_ep *ep, size_t cqe_to_process)
 {
 	bool should_end_poll = false;
 	/* Initialize an empty ibv_poll_cq_attr struct for ibv_start_poll.
@@ -517,6 +527,44 @@ static inline void efa_rdm_ep_poll_ibv_cq(struct efa_rdm_ep *ep, size_t cqe_to_p
 
 	if (should_end_poll)
 		ibv_end_poll(ep->ibv_cq_ex);
+
+	return i;
+}
+
+/**
+ * @brief adapt the CQ poll budget to the rate of completions
+ *
+ * The budget doubles when a pass processed all of it, so bursts are
+ * drained in fewer passes, and halves when a pass used less than half.
+ *
+ * @param[in,out]	ep		RDM endpoint
+ * @param[in]		cqe_processed	number of cq entries the last pass processed
+ */
+static inline void efa_rdm_ep_update_cq_poll_budget(struct efa_rdm_ep *ep,
+						     size_t cqe_processed)
+{
+	if (cqe_processed == ep->cq_poll_budget)
+		ep->cq_poll_budget = MIN(2 * ep->cq_poll_budget,
+					 EFA_RDM_EP_CQ_POLL_BUDGET_MAX_SCALE *
+						 efa_env.efa_cq_read_size);
+	else if (cqe_processed < ep->cq_poll_budget / 2)
+		ep->cq_poll_budget = MAX(ep->cq_poll_budget / 2,
+					 efa_env.efa_cq_read_size);
+}
+
+/**
+ * @brief check whether the endpoint has queued TX work for the progress engine
+ *
+ * @param[in]	ep	RDM endpoint
+ * @return	true if any handshake, RNR, control, long-CTS data or read is queued
+ */
+static inline bool efa_rdm_ep_has_queued_tx(struct efa_rdm_ep *ep)
+{
+	return !dlist_empty(&ep->handshake_queued_peer_list) ||
+	       !dlist_empty(&ep->ope_queued_rnr_list) ||
+	       !dlist_empty(&ep->ope_queued_ctrl_list) ||
+	       !dlist_empty(&ep->ope_longcts_send_list) ||
+	       !dlist_empty(&ep->ope_queued_read_list);
 }
 
 
@@ -572,13 +620,8 @@ ssize_t efa_rdm_ep_post_queued_pkts(struct efa_rdm_ep *ep,
 	return 0;
 }
 
-/**
- * @brief thread unsafe progress engine of EFA RDM endpoint
- * this function should be called only when the caller holds the
- * endpoint lock.
- * @param[in,out]	ep		EFA RDM endpoint
- */
-void efa_rdm_ep_progress_internal(struct efa_rdm_ep *ep)
+static
+void efa_rdm_ep_progress_pass(struct efa_rdm_ep *ep)
 {
 	struct efa_rdm_ope *ope;
 	struct efa_rdm_peer *peer;
@@ -589,11 +632,17 @@ void efa_rdm_ep_progress_internal(struct efa_rdm_ep *ep)
 
 	/* Poll the EFA completion queue. Restrict poll size
 	 * to avoid CQE flooding and thereby blocking user thread. */
-	efa_rdm_ep_poll_ibv_cq(ep, efa_env.efa_cq_read_size);
+	efa_rdm_ep_update_cq_poll_budget(ep,
+		efa_rdm_ep_poll_ibv_cq(ep, ep->cq_poll_budget));
 
 	efa_rdm_ep_progress_post_internal_rx_pkts(ep);
 
+	/* a peer in backoff blocks new sends even when nothing is queued */
 	efa_rdm_ep_check_peer_backoff_timer(ep);
+
+	if (!efa_rdm_ep_has_queued_tx(ep))
+		return;
+
 	/*
 	 * Resend handshake packet for any peers where the first
 	 * handshake send failed.
@@ -651,6 +700,9 @@ void efa_rdm_ep_progress_internal(struct efa_rdm_ep *ep)
 
 		dlist_remove(&ope->queued_rnr_entry);
 		ope->internal_flags &= ~EFA_RDM_OPE_QUEUED_RNR;
+		if (ope->hist_rnr_time && ep->hist)
+			efa_rdm_ep_hist_add(ep, EFA_RDM_HIST_RNR_QUEUE,
+					    ope->hist_rnr_time);
 	}
 
 	dlist_foreach_container_safe(&ep->ope_queued_ctrl_list,
@@ -771,6 +823,32 @@ void efa_rdm_ep_progress_internal(struct efa_rdm_ep *ep)
 	}
 }
 
+/**
+ * @brief thread unsafe progress engine of EFA RDM endpoint
+ * this function should be called only when the caller holds the
+ * endpoint lock.
+ *
+ * Packets posted during the pass are collected in the TX batch, and
+ * submitted at its end with one doorbell per QP. Completions and counter
+ * increments are collected the same way, and written once per CQ.
+ *
+ * @param[in,out]	ep		EFA RDM endpoint
+ */
+void efa_rdm_ep_progress_internal(struct efa_rdm_ep *ep)
+{
+	if (ep->tx_batch_open) {
+		efa_rdm_ep_progress_pass(ep);
+		return;
+	}
+
+	ep->tx_batch_open = true;
+	ep->comp_batch_open = true;
+	efa_rdm_ep_progress_pass(ep);
+	efa_rdm_ep_flush_tx_batch(ep);
+	efa_rdm_ep_flush_comp_batch(ep);
+	ep->comp_batch_open = false;
+}
+
 /**
  * @brief progress engine for the EFA RDM endpoint
  * 
@@ -134,6 +134,7 @@ struct efa_rdm_ope *efa_rdm_ep_alloc_rxe(struct efa_rdm_ep *ep, fi_addr_t addr,
 	rxe->rx_id = ofi_buf_index(rxe);
 	rxe->iov_count = 0;
 	memset(rxe->mr, 0, sizeof(*rxe->mr) * EFA_RDM_IOV_LIMIT);
+	rxe->hist_rnr_time = 0;
 
 	dlist_init(&rxe->queued_pkts);
 
@@ -396,6 +397,186 @@ void efa_rdm_ep_record_tx_op_completed(struct efa_rdm_ep *ep, struct efa_rdm_pke
 		ope->efa_outstanding_tx_ops--;
 }
 
+/**
+ * @brief submit the WRs of the TX batch
+ *
+ * This function completes the WR session of every QP that has WRs
+ * in the batch, and closes the batch. If a QP fails to submit its
+ * WRs, none of them were posted, so each of their packets is handled
+ * as a send error.
+ *
+ * @param[in,out]	ep	endpoint
+ */
+void efa_rdm_ep_flush_tx_batch(struct efa_rdm_ep *ep)
+{
+	struct efa_base_ep *base_ep = &ep->base_ep;
+	struct efa_qp *qp;
+	size_t i, j;
+	int err;
+
+	ep->tx_batch_open = false;
+	for (i = 0; i <= base_ep->rma_qp_cnt; i++) {
+		qp = i ? base_ep->rma_qp[i - 1] : base_ep->qp;
+		if (!qp->wr_batched)
+			continue;
+
+		qp->wr_batched = false;
+		err = ibv_wr_complete(qp->ibv_qp_ex);
+		if (OFI_LIKELY(!err))
+			continue;
+
+		EFA_WARN(FI_LOG_EP_DATA, "Failed to post TX batch on qp[%u]: %s\n",
+			 qp->qp_num, strerror(err));
+		for (j = 0; j < ep->tx_batch_cnt; j++) {
+			if (ep->tx_batch[j].qp == qp)
+				efa_rdm_pke_handle_tx_error(ep->tx_batch[j].pkt_entry,
+							    err, FI_EFA_ERR_PKT_POST);
+		}
+	}
+
+	ep->tx_batch_cnt = 0;
+}
+
+/**
+ * @brief write a completion to a CQ, or hold it in the completion batch
+ *
+ * While the completion batch is open, the completion is written by the
+ * next efa_rdm_ep_flush_comp_batch(), together with the others of the
+ * progress pass. Otherwise it is written right away.
+ *
+ * @param[in,out]	ep	endpoint
+ * @param[in]		cq	the CQ to write to
+ * @param[in]		src	source address, used if the endpoint has FI_SOURCE
+ * @return		0 on success, negative libfabric error code if the
+ *			completion could not be written right away
+ */
+int efa_rdm_ep_write_cq(struct efa_rdm_ep *ep, struct util_cq *cq,
+			void *context, uint64_t flags, size_t len, void *buf,
+			uint64_t data, uint64_t tag, fi_addr_t src)
+{
+	struct efa_rdm_comp_batch_entry *entry;
+
+	if (!ep->comp_batch_open) {
+		if (ep->base_ep.util_ep.caps & FI_SOURCE)
+			return ofi_cq_write_src(cq, context, flags, len, buf,
+						data, tag, src);
+		return ofi_cq_write(cq, context, flags, len, buf, data, tag);
+	}
+
+	if (ep->comp_batch_cnt == EFA_RDM_EP_COMP_BATCH_SIZE)
+		efa_rdm_ep_flush_comp_batch(ep);
+
+	entry = &ep->comp_batch[ep->comp_batch_cnt++];
+	entry->cq = cq;
+	entry->comp.op_context = context;
+	entry->comp.flags = flags;
+	entry->comp.len = len;
+	entry->comp.buf = buf;
+	entry->comp.data = data;
+	entry->comp.tag = tag;
+	entry->src = src;
+	return 0;
+}
+
+void efa_rdm_ep_report_tx_cntr(struct efa_rdm_ep *ep, uint64_t flags)
+{
+	if (ep->comp_batch_open)
+		ep->cntr_batch[efa_cntr_tx_index(flags)]++;
+	else
+		efa_cntr_report_tx_completion(&ep->base_ep.util_ep, flags);
+}
+
+void efa_rdm_ep_report_rx_cntr(struct efa_rdm_ep *ep, uint64_t flags)
+{
+	if (ep->comp_batch_open)
+		ep->cntr_batch[efa_cntr_rx_index(flags)]++;
+	else
+		efa_cntr_report_rx_completion(&ep->base_ep.util_ep, flags);
+}
+
+static inline
+int efa_rdm_ep_write_comp_batch_entry(struct efa_rdm_ep *ep,
+				      struct efa_rdm_comp_batch_entry *entry)
+{
+	struct fi_cq_tagged_entry *comp = &entry->comp;
+	struct util_cq *cq = entry->cq;
+	bool use_src = ep->base_ep.util_ep.caps & FI_SOURCE;
+
+	if (cq->ring)
+		return use_src ? ofi_cq_write_src(cq, comp->op_context, comp->flags,
+						  comp->len, comp->buf, comp->data,
+						  comp->tag, entry->src)
+			       : ofi_cq_write(cq, comp->op_context, comp->flags,
+					      comp->len, comp->buf, comp->data,
+					      comp->tag);
+
+	/* cq_lock is held by the caller */
+	if (ofi_cirque_freecnt(cq->cirq) <= 1)
+		return ofi_cq_write_overflow(cq, comp->op_context, comp->flags,
+					     comp->len, comp->buf, comp->data,
+					     comp->tag, use_src ? entry->src : FI_ADDR_NOTAVAIL);
+
+	if (use_src)
+		ofi_cq_write_src_entry(cq, comp->op_context, comp->flags, comp->len,
+				       comp->buf, comp->data, comp->tag, entry->src);
+	else
+		ofi_cq_write_entry(cq, comp->op_context, comp->flags, comp->len,
+				   comp->buf, comp->data, comp->tag);
+	return 0;
+}
+
+/**
+ * @brief write the completions and counter increments held in the batch
+ *
+ * Consecutive completions to the same CQ are written under one hold of
+ * its lock. A CQ with a lock-free staging ring is written entry by entry,
+ * as that takes no lock. The batch stays open. The operations these
+ * completions belong to may already have been released, so a completion
+ * that cannot be written is reported to the EQ.
+ *
+ * @param[in,out]	ep	endpoint
+ */
+void efa_rdm_ep_flush_comp_batch(struct efa_rdm_ep *ep)
+{
+	struct efa_rdm_comp_batch_entry *entry;
+	struct util_cntr *cntr;
+	struct util_cq *cq;
+	size_t i, j;
+	int ret;
+
+	for (i = 0; i < ep->comp_batch_cnt; i = j) {
+		cq = ep->comp_batch[i].cq;
+		if (!cq->ring)
+			ofi_genlock_lock(&cq->cq_lock);
+
+		for (j = i; j < ep->comp_batch_cnt && ep->comp_batch[j].cq == cq; j++) {
+			entry = &ep->comp_batch[j];
+			ret = efa_rdm_ep_write_comp_batch_entry(ep, entry);
+			if (OFI_UNLIKELY(ret)) {
+				EFA_WARN(FI_LOG_CQ, "Unable to write completion: %s\n",
+					 fi_strerror(-ret));
+				efa_base_ep_write_eq_error(&ep->base_ep, -ret,
+					(entry->comp.flags & (FI_RECV | FI_REMOTE_READ | FI_REMOTE_WRITE)) ?
+					FI_EFA_ERR_WRITE_RECV_COMP : FI_EFA_ERR_WRITE_SEND_COMP);
+			}
+		}
+
+		if (!cq->ring)
+			ofi_genlock_unlock(&cq->cq_lock);
+	}
+	ep->comp_batch_cnt = 0;
+
+	for (i = 0; i < CNTR_CNT; i++) {
+		if (!ep->cntr_batch[i])
+			continue;
+
+		cntr = ep->base_ep.util_ep.cntrs[i];
+		if (cntr)
+			cntr->cntr_fid.ops->add(&cntr->cntr_fid, ep->cntr_batch[i]);
+		ep->cntr_batch[i] = 0;
+	}
+}
+
 /* @brief Queue a packet that encountered RNR error and setup RNR backoff
  *
  * We uses an exponential backoff strategy to handle RNR errors.
@@ -32,6 +32,28 @@
  *  Send function
  */
 
+/**
+ * @brief decide whether a device buffer is cheaper to copy than to read
+ *
+ * The read based protocols move device memory without a host copy, but the
+ * receiver can only complete after a read round trip and the EOR packet.
+ * Small messages in a buffer with a gdrcopy handle are copied into the
+ * packets faster than that, so below max_gdrcopy_msg_size they are staged
+ * through the medium protocol instead.
+ *
+ * @param[in]	txe	contains information of the send operation
+ * @param[in]	hmem_info	hmem info of the send buffer's iface
+ * @return	true if the message should be copied
+ */
+static inline
+bool efa_rdm_msg_use_gdrcopy(struct efa_rdm_ope *txe, struct efa_hmem_info *hmem_info)
+{
+	struct efa_mr *efa_mr = txe->desc[0];
+
+	return efa_mr && (efa_mr->peer.flags & OFI_HMEM_DATA_DEV_REG_HANDLE) &&
+	       txe->total_len < hmem_info->max_gdrcopy_msg_size;
+}
+
 /**
  * @brief select a two-sided protocol for the send operation
  *
@@ -86,9 +108,13 @@ int efa_rdm_msg_select_rtm(struct efa_rdm_ep *efa_rdm_ep, struct efa_rdm_ope *tx
 
 	eager_rtm_max_data_size = efa_rdm_txe_max_req_data_capacity(efa_rdm_ep, txe, eager_rtm);
 
+	if (efa_rdm_msg_use_gdrcopy(txe, &hmem_info[iface]))
+		return (txe->total_len <= eager_rtm_max_data_size) ? eager_rtm : medium_rtm;
+
 	readbase_rtm = efa_rdm_peer_select_readbase_rtm(txe->peer, efa_rdm_ep, txe);
 
-	if (txe->total_len >= hmem_info[iface].min_read_msg_size &&
+	if (txe->total_len >= (tagged ? hmem_info[iface].min_read_tagged_msg_size
+				      : hmem_info[iface].min_read_msg_size) &&
 		efa_rdm_interop_rdma_read(efa_rdm_ep, txe->peer) &&
 		(txe->desc[0] || efa_is_cache_available(efa_rdm_ep_domain(efa_rdm_ep))))
 		return readbase_rtm;
@@ -113,6 +139,24 @@ int efa_rdm_msg_select_rtm(struct efa_rdm_ep *efa_rdm_ep, struct efa_rdm_ope *tx
  * 			which peer does not support.
  * @retval		-FI_EAGAIN for temporary out of resources for send
  */
+/* Map an RTM type to the histogram of its protocol */
+static inline
+int efa_rdm_msg_hist_proto(int rtm_type)
+{
+	if (efa_rdm_pkt_type_is_eager(rtm_type))
+		return EFA_RDM_HIST_EAGER;
+	if (efa_rdm_pkt_type_is_medium(rtm_type))
+		return EFA_RDM_HIST_MEDIUM;
+	if (efa_rdm_pkt_type_is_longcts_req(rtm_type))
+		return EFA_RDM_HIST_LONGCTS;
+	if (efa_rdm_pkt_type_is_runtread(rtm_type))
+		return EFA_RDM_HIST_RUNTREAD;
+
+	assert(rtm_type == EFA_RDM_LONGREAD_MSGRTM_PKT ||
+	       rtm_type == EFA_RDM_LONGREAD_TAGRTM_PKT);
+	return EFA_RDM_HIST_LONGREAD;
+}
+
 ssize_t efa_rdm_msg_post_rtm(struct efa_rdm_ep *ep, struct efa_rdm_ope *txe, int use_p2p)
 {
 	ssize_t err;
@@ -123,6 +167,11 @@ ssize_t efa_rdm_msg_post_rtm(struct efa_rdm_ep *ep, struct efa_rdm_ope *txe, int
 	rtm_type = efa_rdm_msg_select_rtm(ep, txe, use_p2p);
 	assert(rtm_type >= EFA_RDM_REQ_PKT_BEGIN);
 
+	if (ep->hist) {
+		txe->hist_proto = efa_rdm_msg_hist_proto(rtm_type);
+		txe->hist_time = ofi_gettime_ns();
+	}
+
 	if (rtm_type < EFA_RDM_EXTRA_REQ_PKT_BEGIN) {
 		/* rtm requires only baseline feature, which peer should always support. */
 		return efa_rdm_ope_post_send(txe, rtm_type);
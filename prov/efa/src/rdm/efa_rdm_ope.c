@@ -42,6 +42,8 @@ void efa_rdm_txe_construct(struct efa_rdm_ope *txe,
 	txe->rma_iov_count = 0;
 	txe->msg_id = 0;
 	txe->efa_outstanding_tx_ops = 0;
+	txe->hist_time = 0;
+	txe->hist_rnr_time = 0;
 	dlist_init(&txe->queued_pkts);
 
 	memcpy(txe->iov, msg->msg_iov, sizeof(struct iovec) * msg->iov_count);
@@ -626,6 +628,8 @@ void efa_rdm_rxe_handle_error(struct efa_rdm_ope *rxe, int err, int prov_errno)
 	 */
 	//efa_rdm_rxe_release(rxe);
 
+	/* keep the error behind the completions held in the batch */
+	efa_rdm_ep_flush_comp_batch(ep);
 	efa_cntr_report_error(&ep->base_ep.util_ep, err_entry.flags);
 	write_cq_err = ofi_cq_write_error(util_cq, &err_entry);
 	if (write_cq_err) {
@@ -723,6 +727,8 @@ void efa_rdm_txe_handle_error(struct efa_rdm_ope *txe, int err, int prov_errno)
 	 */
 	//efa_rdm_txe_release(txe);
 
+	/* keep the error behind the completions held in the batch */
+	efa_rdm_ep_flush_comp_batch(ep);
 	efa_cntr_report_error(&ep->base_ep.util_ep, txe->cq_entry.flags);
 	write_cq_err = ofi_cq_write_error(util_cq, &err_entry);
 	if (write_cq_err) {
@@ -764,6 +770,7 @@ void efa_rdm_rxe_report_completion(struct efa_rdm_ope *rxe)
 			rxe->cq_entry.tag,	rxe->total_len,
 			rxe->cq_entry.len);
 
+		efa_rdm_ep_flush_comp_batch(ep);
 		ret = ofi_cq_write_error_trunc(ep->base_ep.util_ep.rx_cq,
 					       rxe->cq_entry.op_context,
 					       rxe->cq_entry.flags,
@@ -801,23 +808,14 @@ void efa_rdm_rxe_report_completion(struct efa_rdm_ope *rxe)
 			    rxe->total_len, rxe->cq_entry.tag, rxe->addr);
 
 
-		if (ep->base_ep.util_ep.caps & FI_SOURCE)
-			ret = ofi_cq_write_src(rx_cq,
-					       rxe->cq_entry.op_context,
-					       rxe->cq_entry.flags,
-					       rxe->cq_entry.len,
-					       rxe->cq_entry.buf,
-					       rxe->cq_entry.data,
-					       rxe->cq_entry.tag,
-					       rxe->addr);
-		else
-			ret = ofi_cq_write(rx_cq,
-					   rxe->cq_entry.op_context,
-					   rxe->cq_entry.flags,
-					   rxe->cq_entry.len,
-					   rxe->cq_entry.buf,
-					   rxe->cq_entry.data,
-					   rxe->cq_entry.tag);
+		ret = efa_rdm_ep_write_cq(ep, rx_cq,
+					  rxe->cq_entry.op_context,
+					  rxe->cq_entry.flags,
+					  rxe->cq_entry.len,
+					  rxe->cq_entry.buf,
+					  rxe->cq_entry.data,
+					  rxe->cq_entry.tag,
+					  rxe->addr);
 
 		if (OFI_UNLIKELY(ret)) {
 			EFA_WARN(FI_LOG_CQ,
@@ -830,7 +828,7 @@ void efa_rdm_rxe_report_completion(struct efa_rdm_ope *rxe)
 		rxe->fi_flags |= EFA_RDM_TXE_NO_COMPLETION;
 	}
 
-	efa_cntr_report_rx_completion(&ep->base_ep.util_ep, rxe->cq_entry.flags);
+	efa_rdm_ep_report_rx_cntr(ep, rxe->cq_entry.flags);
 }
 
 /**
@@ -888,6 +886,11 @@ void efa_rdm_txe_report_completion(struct efa_rdm_ope *txe)
 	int ret;
 
 	assert(txe->type == EFA_RDM_TXE);
+	if (txe->hist_time && txe->ep->hist) {
+		efa_rdm_ep_hist_add(txe->ep, txe->hist_proto, txe->hist_time);
+		txe->hist_time = 0;
+	}
+
 	if (efa_rdm_txe_should_update_cq(txe)) {
 		EFA_DBG(FI_LOG_CQ,
 		       "Writing send completion for txe to peer: %" PRIu64
@@ -902,23 +905,14 @@ void efa_rdm_txe_report_completion(struct efa_rdm_ope *txe)
 		    txe->total_len, txe->cq_entry.tag, txe->addr);
 
 		/* TX completions should not send peer address to util_cq */
-		if (txe->ep->base_ep.util_ep.caps & FI_SOURCE)
-			ret = ofi_cq_write_src(tx_cq,
-					       txe->cq_entry.op_context,
-					       txe->cq_entry.flags,
-					       txe->cq_entry.len,
-					       txe->cq_entry.buf,
-					       txe->cq_entry.data,
-					       txe->cq_entry.tag,
-					       FI_ADDR_NOTAVAIL);
-		else
-			ret = ofi_cq_write(tx_cq,
-					   txe->cq_entry.op_context,
-					   txe->cq_entry.flags,
-					   txe->cq_entry.len,
-					   txe->cq_entry.buf,
-					   txe->cq_entry.data,
-					   txe->cq_entry.tag);
+		ret = efa_rdm_ep_write_cq(txe->ep, tx_cq,
+					  txe->cq_entry.op_context,
+					  txe->cq_entry.flags,
+					  txe->cq_entry.len,
+					  txe->cq_entry.buf,
+					  txe->cq_entry.data,
+					  txe->cq_entry.tag,
+					  FI_ADDR_NOTAVAIL);
 
 		if (OFI_UNLIKELY(ret)) {
 			EFA_WARN(FI_LOG_CQ,
@@ -929,7 +923,7 @@ void efa_rdm_txe_report_completion(struct efa_rdm_ope *txe)
 		}
 	}
 
-	efa_cntr_report_tx_completion(&txe->ep->base_ep.util_ep, txe->cq_entry.flags);
+	efa_rdm_ep_report_tx_cntr(txe->ep, txe->cq_entry.flags);
 	txe->fi_flags |= EFA_RDM_TXE_NO_COMPLETION;
 	return;
 }
@@ -985,7 +979,7 @@ void efa_rdm_ope_handle_send_completed(struct efa_rdm_ope *ope)
 			efa_rdm_txe_report_completion(ope);
 		} else {
 			if (!(ope->fi_flags & EFA_RDM_TXE_NO_COUNTER))
-				efa_cntr_report_tx_completion(&ep->base_ep.util_ep, ope->cq_entry.flags);
+				efa_rdm_ep_report_tx_cntr(ep, ope->cq_entry.flags);
 		}
 
 	} else {
@@ -1063,7 +1057,7 @@ void efa_rdm_ope_handle_recv_completed(struct efa_rdm_ope *ope)
 		if (txe->fi_flags & FI_COMPLETION) {
 			efa_rdm_txe_report_completion(txe);
 		} else {
-			efa_cntr_report_tx_completion(&txe->ep->base_ep.util_ep, txe->cq_entry.flags);
+			efa_rdm_ep_report_tx_cntr(txe->ep, txe->cq_entry.flags);
 		}
 	} else {
 		assert(ope->type == EFA_RDM_RXE);
@@ -1266,6 +1260,33 @@ void efa_rdm_ope_prepare_to_post_write(struct efa_rdm_ope *ope)
 	ope->bytes_write_completed = 0;
 }
 
+/**
+ * @brief limit the size of RDMA requests so they are spread over the RMA QPs
+ *
+ * When the endpoint has extra RMA QPs, a large transfer is cut into one stripe
+ * per QP, so that efa_rdm_pke_read() and efa_rdm_pke_write() post them on
+ * different QPs. Stripes are never smaller than EFA_RDM_RMA_STRIPE_MIN_SIZE.
+ *
+ * @param[in]	ep		endpoint
+ * @param[in]	total_len	total length of the transfer
+ * @param[in]	max_once_len	maximum size of one request
+ * @return	maximum size of one request of this transfer
+ */
+static inline
+size_t efa_rdm_ope_rma_stripe_len(struct efa_rdm_ep *ep, size_t total_len,
+				  size_t max_once_len)
+{
+	size_t qp_cnt = ep->base_ep.rma_qp_cnt + 1;
+	size_t stripe_len;
+
+	if (qp_cnt == 1)
+		return max_once_len;
+
+	stripe_len = MAX(ofi_div_ceil(total_len, qp_cnt), EFA_RDM_RMA_STRIPE_MIN_SIZE);
+	stripe_len = ofi_get_aligned_size(stripe_len, EFA_RDM_RMA_STRIPE_MIN_SIZE);
+	return MIN(stripe_len, max_once_len);
+}
+
 /**
  * @brief post read request(s)
  *
@@ -1332,6 +1353,8 @@ int efa_rdm_ope_post_read(struct efa_rdm_ope *ope)
 	efa_rdm_ope_try_fill_desc(ope, 0, FI_RECV);
 
 	max_read_once_len = MIN(efa_env.efa_read_segment_size, efa_rdm_ep_domain(ep)->device->max_rdma_size);
+	max_read_once_len = efa_rdm_ope_rma_stripe_len(ep, ope->bytes_read_total_len,
+						       max_read_once_len);
 	assert(max_read_once_len > 0);
 
 	err = ofi_iov_locate(ope->iov, ope->iov_count,
@@ -1467,6 +1490,10 @@ int efa_rdm_ope_post_remote_write(struct efa_rdm_ope *ope)
 
 	assert(ope->bytes_write_submitted < ope->bytes_write_total_len);
 	max_write_once_len = MIN(efa_env.efa_write_segment_size, efa_rdm_ep_domain(ep)->device->max_rdma_size);
+	/* write with immediate data must be a single request */
+	if (!(ope->fi_flags & FI_REMOTE_CQ_DATA))
+		max_write_once_len = efa_rdm_ope_rma_stripe_len(ep, ope->bytes_write_total_len,
+								max_write_once_len);
 
 	assert(max_write_once_len > 0);
 
@@ -183,6 +183,11 @@ struct efa_rdm_ope {
 
 	/** the source packet entry of a local read operation */
 	struct efa_rdm_pke *local_read_pkt_entry;
+
+	/* start of the latency samples taken while ep->hist is open, or 0 */
+	uint64_t hist_time;
+	uint64_t hist_rnr_time;
+	int hist_proto;
 };
 
 void efa_rdm_txe_construct(struct efa_rdm_ope *txe,
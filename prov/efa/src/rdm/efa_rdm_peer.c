@@ -26,7 +26,9 @@ void efa_rdm_peer_construct(struct efa_rdm_peer *peer, struct efa_rdm_ep *ep, st
 	peer->host_id = peer->is_self ? ep->host_id : 0;	/* Peer host id is exchanged via handshake */
 	peer->num_read_msg_in_flight = 0;
 	peer->num_runt_bytes_in_flight = 0;
-	ofi_recvwin_buf_alloc(&peer->robuf, efa_env.recvwin_size);
+	/* robuf.pending is allocated by the first out-of-order packet */
+	assert(efa_env.recvwin_size == roundup_power_of_two(efa_env.recvwin_size));
+	peer->robuf.win_size = efa_env.recvwin_size;
 	dlist_init(&peer->outstanding_tx_pkts);
 	dlist_init(&peer->txe_list);
 	dlist_init(&peer->rxe_list);
@@ -101,6 +103,50 @@ void efa_rdm_peer_destruct(struct efa_rdm_peer *peer, struct efa_rdm_ep *ep)
 #endif
 }
 
+/**
+ * @brief make room in a peer's reorder buffer for a msg_id
+ *
+ * The buffer is allocated on the first call, and doubled until the
+ * slot of msg_id fits. Queued packets keep their distance from the
+ * expected msg_id.
+ *
+ * @param[in,out]	peer	peer
+ * @param[in]		msg_id	msg_id inside the receive window
+ * @return	0 on success, -FI_ENOMEM if the buffer cannot grow
+ */
+static
+int efa_rdm_peer_robuf_reserve(struct efa_rdm_peer *peer, uint32_t msg_id)
+{
+	struct efa_rdm_robuf *robuf = &peer->robuf;
+	struct recvwin_cirq *pending;
+	size_t i, size, offset;
+
+	offset = msg_id - robuf->exp_msg_id;
+	assert(offset < robuf->win_size);
+	if (robuf->pending && offset < robuf->pending->size)
+		return 0;
+
+	size = robuf->pending ? robuf->pending->size * 2 :
+				EFA_RDM_PEER_INIT_REORDER_BUFFER_SIZE;
+	size = MAX(size, roundup_power_of_two(offset + 1));
+	size = MIN(size, roundup_power_of_two(robuf->win_size));
+
+	pending = recvwin_cirq_create(size);
+	if (!pending)
+		return -FI_ENOMEM;
+
+	if (robuf->pending) {
+		for (i = 0; i < robuf->pending->size; i++)
+			pending->buf[i] = robuf->pending->buf[
+				(robuf->pending->rcnt + i) & robuf->pending->size_mask];
+		pending->wcnt = ofi_cirque_usedcnt(robuf->pending);
+		recvwin_cirq_free(robuf->pending);
+	}
+
+	robuf->pending = pending;
+	return 0;
+}
+
 /**
  * @brief run incoming packet_entry through reorder buffer
  * queue the packe entry if msg_id is larger then expected.
@@ -164,6 +210,12 @@ int efa_rdm_peer_reorder_msg(struct efa_rdm_peer *peer, struct efa_rdm_ep *ep,
 		}
 	}
 
+	if (OFI_UNLIKELY(efa_rdm_peer_robuf_reserve(peer, msg_id))) {
+		EFA_WARN(FI_LOG_EP_CTRL,
+			"Unable to grow reorder buffer for OOO msg\n");
+		return -FI_ENOMEM;
+	}
+
 	if (OFI_LIKELY(efa_env.rx_copy_ooo)) {
 		assert(pkt_entry->alloc_type == EFA_RDM_PKE_FROM_EFA_RX_POOL);
 		ooo_entry = efa_rdm_pke_clone(pkt_entry, ep->rx_ooo_pkt_pool, EFA_RDM_PKE_FROM_OOO_POOL);
@@ -203,6 +255,9 @@ void efa_rdm_peer_proc_pending_items_in_robuf(struct efa_rdm_peer *peer, struct
 	int ret = 0;
 	uint32_t msg_id;
 
+	if (!peer->robuf.pending)
+		return;
+
 	while (1) {
 		pending_pkt = *ofi_recvwin_peek((&peer->robuf));
 		if (!pending_pkt)
@@ -9,6 +9,8 @@
 #include "efa_rdm_protocol.h"
 
 #define EFA_RDM_PEER_DEFAULT_REORDER_BUFFER_SIZE	(16384)
+/* Number of slots allocated for a peer's first out-of-order packet */
+#define EFA_RDM_PEER_INIT_REORDER_BUFFER_SIZE		(16)
 
 OFI_DECL_RECVWIN_BUF(struct efa_rdm_pke*, efa_rdm_robuf, uint32_t);
 
@@ -34,7 +36,9 @@ struct efa_rdm_peer {
 	/**
 	 * @brief reorder buffer
 	 * 
-	 * @details temporarily hold packets that are out-of-order, whose msg_id is larger that the one EP is expecting from the peer
+	 * @details temporarily hold packets that are out-of-order, whose msg_id is larger that the one EP is expecting from the peer.
+	 * robuf.pending is allocated when the first out-of-order packet arrives, and grows up to
+	 * robuf.win_size slots as packets arrive further ahead of the expected msg_id.
 	 */
 	struct efa_rdm_robuf robuf;
 	uint32_t next_msg_id;		/**< msg_id to be assigned to the next packet sent to the peer. */
@@ -253,6 +257,20 @@ int efa_rdm_peer_reorder_msg(struct efa_rdm_peer *peer, struct efa_rdm_ep *ep, s
 
 void efa_rdm_peer_proc_pending_items_in_robuf(struct efa_rdm_peer *peer, struct efa_rdm_ep *ep);
 
+/**
+ * @brief mark the expected message of a peer as processed
+ *
+ * @param[in,out]	peer	peer
+ */
+static inline
+void efa_rdm_peer_robuf_slide(struct efa_rdm_peer *peer)
+{
+	if (peer->robuf.pending)
+		ofi_recvwin_slide((&peer->robuf));
+	else
+		ofi_recvwin_exp_inc((&peer->robuf));
+}
+
 size_t efa_rdm_peer_get_runt_size(struct efa_rdm_peer *peer, struct efa_rdm_ep *ep, struct efa_rdm_ope *ope);
 
 int efa_rdm_peer_select_readbase_rtm(struct efa_rdm_peer *peer, struct efa_rdm_ep *ep, struct efa_rdm_ope *ope);
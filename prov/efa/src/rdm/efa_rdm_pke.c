@@ -120,6 +120,9 @@ void efa_rdm_pke_release_tx(struct efa_rdm_pke *pkt_entry)
 		if (peer->flags & EFA_RDM_PEER_IN_BACKOFF) {
 			dlist_remove(&peer->rnr_backoff_entry);
 			peer->flags &= ~EFA_RDM_PEER_IN_BACKOFF;
+			if (ep->hist)
+				ofi_hist_add(&ep->hist->hist[EFA_RDM_HIST_RNR_BACKOFF],
+					     (ofi_gettime_us() - peer->rnr_backoff_begin_ts) * 1000);
 		}
 		EFA_DBG(FI_LOG_EP_DATA,
 		       "reset backoff timer for peer: %" PRIu64 "\n",
@@ -345,6 +348,58 @@ void efa_rdm_pke_append(struct efa_rdm_pke *dst,
 	dst->next = src;
 }
 
+/**
+ * @brief start posting WRs on a QP
+ *
+ * While the endpoint's TX batch is open, the WR session of the QP is left
+ * open after efa_rdm_pke_wr_complete(), so that the WRs posted during a
+ * progress pass are submitted together by efa_rdm_ep_flush_tx_batch().
+ *
+ * @param[in]	ep	endpoint
+ * @param[in]	qp	QP to post on
+ */
+static inline
+void efa_rdm_pke_wr_start(struct efa_rdm_ep *ep, struct efa_qp *qp)
+{
+	if (qp->wr_batched)
+		return;
+
+	ibv_wr_start(qp->ibv_qp_ex);
+	qp->wr_batched = ep->tx_batch_open;
+}
+
+/**
+ * @brief submit the WRs posted since efa_rdm_pke_wr_start()
+ *
+ * If the TX batch is open, the packets are added to it instead and
+ * submitted when the batch is flushed.
+ *
+ * @param[in]	ep		endpoint
+ * @param[in]	qp		QP the WRs were posted on
+ * @param[in]	pkt_entry_vec	packet entries of the WRs
+ * @param[in]	pkt_entry_cnt	number of packet entries
+ * @return	0 on success, error code of ibv_wr_complete() otherwise
+ */
+static inline
+int efa_rdm_pke_wr_complete(struct efa_rdm_ep *ep, struct efa_qp *qp,
+			    struct efa_rdm_pke **pkt_entry_vec,
+			    int pkt_entry_cnt)
+{
+	int i;
+
+	if (!qp->wr_batched)
+		return ibv_wr_complete(qp->ibv_qp_ex);
+
+	for (i = 0; i < pkt_entry_cnt; i++) {
+		assert(ep->tx_batch_cnt < efa_rdm_ep_get_tx_pool_size(ep));
+		ep->tx_batch[ep->tx_batch_cnt].pkt_entry = pkt_entry_vec[i];
+		ep->tx_batch[ep->tx_batch_cnt].qp = qp;
+		ep->tx_batch_cnt++;
+	}
+
+	return 0;
+}
+
 /**
  * @brief send data over wire using rdma-core API
  *
@@ -379,7 +434,7 @@ ssize_t efa_rdm_pke_sendv(struct efa_rdm_pke **pkt_entry_vec,
 	assert(conn && conn->ep_addr);
 
 	qp = ep->base_ep.qp;
-	ibv_wr_start(qp->ibv_qp_ex);
+	efa_rdm_pke_wr_start(ep, qp);
 	for (pkt_idx = 0; pkt_idx < pkt_entry_cnt; ++pkt_idx) {
 		pkt_entry = pkt_entry_vec[pkt_idx];
 		assert(pkt_entry->pkt_size);
@@ -411,7 +466,7 @@ ssize_t efa_rdm_pke_sendv(struct efa_rdm_pke **pkt_entry_vec,
 				sg_list[1].lkey = ((struct efa_mr *)pkt_entry->payload_mr)->ibv_mr->lkey;
 			}
 
-			ibv_wr_set_sge_list(ep->base_ep.qp->ibv_qp_ex, iov_cnt, sg_list);
+			ibv_wr_set_sge_list(qp->ibv_qp_ex, iov_cnt, sg_list);
 		}
 
 		ibv_wr_set_ud_addr(qp->ibv_qp_ex, conn->ah->ibv_ah,
@@ -429,7 +484,7 @@ ssize_t efa_rdm_pke_sendv(struct efa_rdm_pke **pkt_entry_vec,
 #endif
 	}
 
-	ret = ibv_wr_complete(qp->ibv_qp_ex);
+	ret = efa_rdm_pke_wr_complete(ep, qp, pkt_entry_vec, pkt_entry_cnt);
 	if (OFI_UNLIKELY(ret)) {
 		return ret;
 	}
@@ -472,8 +527,8 @@ int efa_rdm_pke_read(struct efa_rdm_pke *pkt_entry,
 	if (txe->peer == NULL)
 		pkt_entry->flags |= EFA_RDM_PKE_LOCAL_READ;
 
-	qp = ep->base_ep.qp;
-	ibv_wr_start(qp->ibv_qp_ex);
+	qp = efa_base_ep_next_rma_qp(&ep->base_ep);
+	efa_rdm_pke_wr_start(ep, qp);
 	qp->ibv_qp_ex->wr_id = (uintptr_t)pkt_entry;
 	ibv_wr_rdma_read(qp->ibv_qp_ex, remote_key, remote_buf);
 
@@ -484,7 +539,7 @@ int efa_rdm_pke_read(struct efa_rdm_pke *pkt_entry,
 	ibv_wr_set_sge_list(qp->ibv_qp_ex, 1, &sge);
 	if (txe->peer == NULL) {
 		ibv_wr_set_ud_addr(qp->ibv_qp_ex, ep->base_ep.self_ah,
-				   qp->qp_num, qp->qkey);
+				   ep->base_ep.qp->qp_num, ep->base_ep.qp->qkey);
 	} else {
 		conn = efa_av_addr_to_conn(ep->base_ep.av, pkt_entry->addr);
 		assert(conn && conn->ep_addr);
@@ -492,7 +547,7 @@ int efa_rdm_pke_read(struct efa_rdm_pke *pkt_entry,
 				   conn->ep_addr->qpn, conn->ep_addr->qkey);
 	}
 
-	err = ibv_wr_complete(qp->ibv_qp_ex);
+	err = efa_rdm_pke_wr_complete(ep, qp, &pkt_entry, 1);
 
 	if (OFI_UNLIKELY(err))
 		return err;
@@ -548,8 +603,8 @@ int efa_rdm_pke_write(struct efa_rdm_pke *pkt_entry)
 	if (self_comm)
 		pkt_entry->flags |= EFA_RDM_PKE_LOCAL_WRITE;
 
-	qp = ep->base_ep.qp;
-	ibv_wr_start(qp->ibv_qp_ex);
+	qp = efa_base_ep_next_rma_qp(&ep->base_ep);
+	efa_rdm_pke_wr_start(ep, qp);
 	qp->ibv_qp_ex->wr_id = (uintptr_t)pkt_entry;
 
 	if (txe->fi_flags & FI_REMOTE_CQ_DATA) {
@@ -572,7 +627,7 @@ int efa_rdm_pke_write(struct efa_rdm_pke *pkt_entry)
 	ibv_wr_set_sge_list(qp->ibv_qp_ex, 1, &sge);
 	if (self_comm) {
 		ibv_wr_set_ud_addr(qp->ibv_qp_ex, ep->base_ep.self_ah,
-				   qp->qp_num, qp->qkey);
+				   ep->base_ep.qp->qp_num, ep->base_ep.qp->qkey);
 	} else {
 		conn = efa_av_addr_to_conn(ep->base_ep.av, pkt_entry->addr);
 		assert(conn && conn->ep_addr);
@@ -580,7 +635,7 @@ int efa_rdm_pke_write(struct efa_rdm_pke *pkt_entry)
 				   conn->ep_addr->qpn, conn->ep_addr->qkey);
 	}
 
-	err = ibv_wr_complete(qp->ibv_qp_ex);
+	err = efa_rdm_pke_wr_complete(ep, qp, &pkt_entry, 1);
 
 	if (OFI_UNLIKELY(err))
 		return err;
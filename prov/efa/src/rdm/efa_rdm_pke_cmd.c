@@ -474,6 +474,7 @@ void efa_rdm_pke_handle_tx_error(struct efa_rdm_pke *pkt_entry, int err, int pro
 				efa_rdm_ep_queue_rnr_pkt(ep, &txe->queued_pkts, pkt_entry);
 				if (!(txe->internal_flags & EFA_RDM_OPE_QUEUED_RNR)) {
 					txe->internal_flags |= EFA_RDM_OPE_QUEUED_RNR;
+					txe->hist_rnr_time = ep->hist ? ofi_gettime_ns() : 0;
 					dlist_insert_tail(&txe->queued_rnr_entry,
 							  &ep->ope_queued_rnr_list);
 				}
@@ -495,6 +496,7 @@ void efa_rdm_pke_handle_tx_error(struct efa_rdm_pke *pkt_entry, int err, int pro
 			efa_rdm_ep_queue_rnr_pkt(ep, &rxe->queued_pkts, pkt_entry);
 			if (!(rxe->internal_flags & EFA_RDM_OPE_QUEUED_RNR)) {
 				rxe->internal_flags |= EFA_RDM_OPE_QUEUED_RNR;
+				rxe->hist_rnr_time = ep->hist ? ofi_gettime_ns() : 0;
 				dlist_insert_tail(&rxe->queued_rnr_entry,
 						  &ep->ope_queued_rnr_list);
 			}
@@ -186,6 +186,9 @@ void efa_rdm_pke_handle_cts_recv(struct efa_rdm_pke *pkt_entry)
 	efa_rdm_pke_release_rx(pkt_entry);
 
 	if (ope->state != EFA_RDM_TXE_SEND) {
+		if (ope->hist_time && ep->hist)
+			efa_rdm_ep_hist_add(ep, EFA_RDM_HIST_CTS_WAIT,
+					    ope->hist_time);
 		ope->state = EFA_RDM_TXE_SEND;
 		dlist_insert_tail(&ope->entry, &ep->ope_longcts_send_list);
 	}
@@ -569,7 +572,7 @@ void efa_rdm_pke_handle_rma_completion(struct efa_rdm_pke *context_pkt_entry)
 			if (txe->fi_flags & FI_COMPLETION)
 				efa_rdm_txe_report_completion(txe);
 			else
-				efa_cntr_report_tx_completion(&context_pkt_entry->ep->base_ep.util_ep, txe->cq_entry.flags);
+				efa_rdm_ep_report_tx_cntr(context_pkt_entry->ep, txe->cq_entry.flags);
 			efa_rdm_txe_release(txe);
 		}
 		break;
@@ -813,7 +816,7 @@ void efa_rdm_pke_handle_atomrsp_recv(struct efa_rdm_pke *pkt_entry)
 	if (txe->fi_flags & FI_COMPLETION)
 		efa_rdm_txe_report_completion(txe);
 	else
-		efa_cntr_report_tx_completion(&pkt_entry->ep->base_ep.util_ep, txe->cq_entry.flags);
+		efa_rdm_ep_report_tx_cntr(pkt_entry->ep, txe->cq_entry.flags);
 
 	efa_rdm_txe_release(txe);
 	efa_rdm_pke_release_rx(pkt_entry);
@@ -510,7 +510,7 @@ void efa_rdm_pke_handle_rtm_rta_recv(struct efa_rdm_pke *pkt_entry)
 		return;
 
 	if (slide_recvwin) {
-		ofi_recvwin_slide((&peer->robuf));
+		efa_rdm_peer_robuf_slide(peer);
 	}
 	efa_rdm_peer_proc_pending_items_in_robuf(peer, ep);
 }
@@ -6,6 +6,86 @@
 #include "efa_rdm_rxe_map.h"
 #include "efa_rdm_pke_rtm.h"
 
+static inline
+size_t efa_rdm_rxe_map_hash(uint64_t msg_id, fi_addr_t addr)
+{
+	uint64_t h = msg_id ^ (addr * 0x9e3779b97f4a7c15ULL);
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static inline
+struct efa_rdm_rxe_map_entry *efa_rdm_rxe_map_find(struct efa_rdm_rxe_map *rxe_map,
+						   uint64_t msg_id, fi_addr_t addr)
+{
+	struct efa_rdm_rxe_map_entry *slot;
+	size_t i;
+
+	if (!rxe_map->slots)
+		return NULL;
+
+	for (i = efa_rdm_rxe_map_hash(msg_id, addr) & rxe_map->size_mask; ;
+	     i = (i + 1) & rxe_map->size_mask) {
+		slot = &rxe_map->slots[i];
+		if (!slot->rxe)
+			return NULL;
+		if (slot->key.msg_id == msg_id && slot->key.addr == addr)
+			return slot;
+	}
+}
+
+static
+void efa_rdm_rxe_map_add(struct efa_rdm_rxe_map *rxe_map,
+			 struct efa_rdm_rxe_map_key *key,
+			 struct efa_rdm_ope *rxe)
+{
+	size_t i;
+
+	for (i = efa_rdm_rxe_map_hash(key->msg_id, key->addr) & rxe_map->size_mask;
+	     rxe_map->slots[i].rxe; i = (i + 1) & rxe_map->size_mask)
+		;
+
+	rxe_map->slots[i].key = *key;
+	rxe_map->slots[i].rxe = rxe;
+	rxe_map->cnt++;
+}
+
+/**
+ * @brief double the number of slots of an RX entry map
+ *
+ * @param[in,out]	rxe_map		RX entry map
+ * @return	0 on success, -FI_ENOMEM on failure
+ */
+static
+int efa_rdm_rxe_map_grow(struct efa_rdm_rxe_map *rxe_map)
+{
+	struct efa_rdm_rxe_map_entry *old_slots;
+	size_t i, old_size;
+
+	old_slots = rxe_map->slots;
+	old_size = old_slots ? rxe_map->size_mask + 1 : 0;
+
+	rxe_map->slots = calloc(old_size ? 2 * old_size : EFA_RDM_RXE_MAP_INIT_SIZE,
+				sizeof(*rxe_map->slots));
+	if (!rxe_map->slots) {
+		rxe_map->slots = old_slots;
+		return -FI_ENOMEM;
+	}
+
+	rxe_map->size_mask = (old_size ? 2 * old_size : EFA_RDM_RXE_MAP_INIT_SIZE) - 1;
+	rxe_map->cnt = 0;
+	for (i = 0; i < old_size; i++) {
+		if (old_slots[i].rxe)
+			efa_rdm_rxe_map_add(rxe_map, &old_slots[i].key, old_slots[i].rxe);
+	}
+
+	free(old_slots);
+	return 0;
+}
+
 /**
  * @brief find an RX entry for a received RTM packet entry's sender address and msg_id
  *
@@ -17,13 +97,10 @@
 struct efa_rdm_ope *efa_rdm_rxe_map_lookup(struct efa_rdm_rxe_map *rxe_map,
 					   struct efa_rdm_pke *pkt_entry)
 {
-	struct efa_rdm_rxe_map_entry *entry = NULL;
-	struct efa_rdm_rxe_map_key key;
+	struct efa_rdm_rxe_map_entry *entry;
 
-	memset(&key, 0, sizeof(key));
-	key.msg_id = efa_rdm_pke_get_rtm_msg_id(pkt_entry);
-	key.addr = pkt_entry->addr;
-	HASH_FIND(hh, rxe_map->head, &key, sizeof(struct efa_rdm_rxe_map_key), entry);
+	entry = efa_rdm_rxe_map_find(rxe_map, efa_rdm_pke_get_rtm_msg_id(pkt_entry),
+				     pkt_entry->addr);
 	return entry ? entry->rxe : NULL;
 }
 
@@ -42,31 +119,21 @@ void efa_rdm_rxe_map_insert(struct efa_rdm_rxe_map *rxe_map,
 			    struct efa_rdm_pke *pkt_entry,
 			    struct efa_rdm_ope *rxe)
 {
-	struct efa_rdm_rxe_map_entry *entry;
+	struct efa_rdm_rxe_map_key key;
+
+	key.msg_id = efa_rdm_pke_get_rtm_msg_id(pkt_entry);
+	key.addr = pkt_entry->addr;
+	assert(!efa_rdm_rxe_map_find(rxe_map, key.msg_id, key.addr));
 
-	entry = ofi_buf_alloc(pkt_entry->ep->map_entry_pool);
-	if (OFI_UNLIKELY(!entry)) {
+	if (OFI_UNLIKELY(2 * (rxe_map->cnt + 1) > rxe_map->size_mask + 1) &&
+	    efa_rdm_rxe_map_grow(rxe_map)) {
 		EFA_WARN(FI_LOG_CQ,
 			"Map entries for medium size message exhausted.\n");
 		efa_base_ep_write_eq_error(&pkt_entry->ep->base_ep, FI_ENOBUFS, FI_EFA_ERR_RXE_POOL_EXHAUSTED);
 		return;
 	}
 
-	memset(&entry->key, 0, sizeof(entry->key));
-	entry->key.msg_id = efa_rdm_pke_get_rtm_msg_id(pkt_entry);
-	entry->key.addr = pkt_entry->addr;
-
-#if ENABLE_DEBUG
-	{
-		struct efa_rdm_rxe_map_entry *existing_entry = NULL;
-
-		HASH_FIND(hh, rxe_map->head, &entry->key, sizeof(struct efa_rdm_rxe_map_key), existing_entry);
-		assert(!existing_entry);
-	}
-#endif
-
-	entry->rxe = rxe;
-	HASH_ADD(hh, rxe_map->head, key, sizeof(struct efa_rdm_rxe_map_key), entry);
+	efa_rdm_rxe_map_add(rxe_map, &key, rxe);
 }
 
 /**
@@ -76,6 +143,9 @@ void efa_rdm_rxe_map_insert(struct efa_rdm_rxe_map *rxe_map,
  * the removal will use the combination of packet entry sender address and msg_id as key.
  * Caller is responsible to make sure the key does exist in the map.
  *
+ * Entries after the removed one in its probe sequence are moved back,
+ * so that lookups never need to skip deleted slots.
+ *
  * @param[in,out]	rxe_map		RX entry map
  * @param[in]		msg_id		message ID
  * @param[in]		addr		peer address
@@ -85,14 +155,26 @@ void efa_rdm_rxe_map_remove(struct efa_rdm_rxe_map *rxe_map, uint64_t msg_id,
 			    fi_addr_t addr, struct efa_rdm_ope *rxe)
 {
 	struct efa_rdm_rxe_map_entry *entry;
-	struct efa_rdm_rxe_map_key key;
-
-	memset(&key, 0, sizeof(key));
-	key.msg_id = msg_id;
-	key.addr = addr;
+	size_t hole, i, home;
 
-	HASH_FIND(hh, rxe_map->head, &key, sizeof(key), entry);
+	entry = efa_rdm_rxe_map_find(rxe_map, msg_id, addr);
 	assert(entry && entry->rxe == rxe);
-	HASH_DEL(rxe_map->head, entry);
-	ofi_buf_free(entry);
-}
\ No newline at end of file
+	(void) rxe; /* suppress compiler warning for non-debug build */
+
+	hole = entry - rxe_map->slots;
+	for (i = (hole + 1) & rxe_map->size_mask; rxe_map->slots[i].rxe;
+	     i = (i + 1) & rxe_map->size_mask) {
+		home = efa_rdm_rxe_map_hash(rxe_map->slots[i].key.msg_id,
+					    rxe_map->slots[i].key.addr) &
+		       rxe_map->size_mask;
+		/* move the entry back unless its home slot lies in (hole, i] */
+		if (((i - home) & rxe_map->size_mask) >=
+		    ((i - hole) & rxe_map->size_mask)) {
+			rxe_map->slots[hole] = rxe_map->slots[i];
+			hole = i;
+		}
+	}
+
+	rxe_map->slots[hole].rxe = NULL;
+	rxe_map->cnt--;
+}
@@ -5,17 +5,26 @@
 #define EFA_RDM_OPE_RECVMAP
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <rdma/fi_endpoint.h>
-#include "uthash.h"
 
+/* Number of slots allocated by the first insertion into an rxe map */
+#define EFA_RDM_RXE_MAP_INIT_SIZE	(64)
 
 struct efa_rdm_rxe_map_key {
 	uint64_t msg_id;
 	fi_addr_t addr;
 };
 
+struct efa_rdm_ope;
 
-struct efa_rdm_rxe_map_entry;
+/**
+ * @brief a slot of an RX entry map; the slot is empty if rxe is NULL
+ */
+struct efa_rdm_rxe_map_entry {
+	struct efa_rdm_rxe_map_key key;
+	struct efa_rdm_ope *rxe;
+};
 
 /**
  * @brief a hashmap between sender address + msg_id to RX entry
@@ -27,23 +36,31 @@ struct efa_rdm_rxe_map_entry;
  * will be matched with an RX entry and will be inserted
  * to this map, the later arriving RTM packet will use
  * this hashmap to find the RX entry.
+ *
+ * Entries are stored in the slots array with linear probing, so a
+ * lookup reads neighbouring slots and no entry is allocated on insert.
+ * The array is allocated by the first insertion and doubled when it
+ * becomes half full.
  */
 struct efa_rdm_rxe_map {
-	struct efa_rdm_rxe_map_entry *head;
-};
-
-struct efa_rdm_ope;
-
-struct efa_rdm_rxe_map_entry {
-	struct efa_rdm_rxe_map_key key;
-	struct efa_rdm_ope *rxe;
-	UT_hash_handle hh;
+	struct efa_rdm_rxe_map_entry *slots;
+	size_t size_mask;
+	size_t cnt;
 };
 
 static inline
 void efa_rdm_rxe_map_construct(struct efa_rdm_rxe_map *rxe_map)
 {
-	rxe_map->head = NULL;
+	rxe_map->slots = NULL;
+	rxe_map->size_mask = 0;
+	rxe_map->cnt = 0;
+}
+
+static inline
+void efa_rdm_rxe_map_destruct(struct efa_rdm_rxe_map *rxe_map)
+{
+	free(rxe_map->slots);
+	efa_rdm_rxe_map_construct(rxe_map);
 }
 
 struct efa_rdm_pke;
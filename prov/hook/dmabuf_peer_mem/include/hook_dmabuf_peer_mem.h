@@ -35,11 +35,15 @@
 
 #include "ofi_hook.h"
 #include "ofi.h"
+#include "ofi_mr.h"
 
 struct dmabuf_peer_mem_fabric {
 	struct hook_fabric fabric_hook;
 	int dmabuf_reg_fd;
 	ofi_mutex_t mutex;
+	/* Exported dmabuf fds, keyed by allocation */
+	struct ofi_mr_cache cache;
+	bool cache_enabled;
 };
 
 struct dmabuf_peer_mem_mr {
@@ -47,6 +51,7 @@ struct dmabuf_peer_mem_mr {
 	uint64_t base;
 	uint64_t size;
 	int fd;
+	struct ofi_mr_entry *cache_entry;
 };
 
 int hook_dmabuf_peer_mem_destroy(struct fid *fabric);
@@ -153,6 +153,116 @@ static inline void put_dmabuf_fd(int fd)
 		close(fd);
 }
 
+/*
+ * Get the dmabuf fd of an allocation and add a reference to it in the
+ * registry, exporting the allocation if the registry does not cover it
+ * yet.  Return the fd, or -1 on failure.  Called with the fabric mutex
+ * held.
+ */
+static int dmabuf_reg_get(struct dmabuf_peer_mem_fabric *fab, void *buf,
+			  size_t len, uint64_t base, uint64_t size)
+{
+	int fd = -1;
+	int err;
+
+	err = dmabuf_reg_query(fab->dmabuf_reg_fd, base, size, &fd);
+	switch (err) {
+	case -ENOENT:
+		/*
+		 * The region is not covered by any entry in the registry, add a
+		 * new entry to the registry now.
+		 */
+		fd = get_dmabuf_fd(buf, len);
+		if (fd < 0)
+			return -1;
+
+		err = dmabuf_reg_add(fab->dmabuf_reg_fd, base, size, fd);
+		if (err) {
+			put_dmabuf_fd(fd);
+			return -1;
+		}
+
+		FI_INFO(fab->fabric_hook.hprov, FI_LOG_MR,
+			"Add new entry: base 0x%"PRIx64" size %"PRIu64" fd %d\n",
+			base, size, fd);
+		return fd;
+
+	case 0:
+		/*
+		 * The region is already covered by an entry in the registry,
+		 * add a reference to it.
+		 */
+		err = dmabuf_reg_add(fab->dmabuf_reg_fd, base, size, fd);
+		return err ? -1 : fd;
+
+	default:
+		/*
+		 * Error happened: range overflow, range conflict with existing
+		 * entries, or I/O error.
+		 */
+		return -1;
+	}
+}
+
+/*
+ * Remove a reference to the fd in the kernel registry. The fd would be
+ * removed from the registry if the refcnt reaches 0. In that case, the fd
+ * is no longer used by any MR and should be released.  Called with the
+ * fabric mutex held.
+ */
+static void dmabuf_reg_put(struct dmabuf_peer_mem_fabric *fab, uint64_t base,
+			   uint64_t size, int fd)
+{
+	int cur_fd;
+	int err;
+
+	dmabuf_reg_remove(fab->dmabuf_reg_fd, fd);
+	err = dmabuf_reg_query(fab->dmabuf_reg_fd, base, size, &cur_fd);
+	if (err == -ENOENT) {
+		FI_INFO(fab->fabric_hook.hprov, FI_LOG_MR,
+			"Remove entry: base 0x%"PRIx64" size %"PRIu64" fd %d\n",
+			base, size, fd);
+		put_dmabuf_fd(fd);
+	}
+}
+
+/*
+ * Cached allocations keep their dmabuf fd and their registry reference
+ * once the last MR using them is closed, so that registering the same
+ * allocation again does not export it again.  The ze memory monitor
+ * invalidates the entry when the allocation is freed.
+ */
+static int dmabuf_cache_add_region(struct ofi_mr_cache *cache,
+				   struct ofi_mr_entry *entry)
+{
+	struct dmabuf_peer_mem_fabric *fab;
+	int *fd = (int *) entry->data;
+
+	fab = container_of(cache, struct dmabuf_peer_mem_fabric, cache);
+
+	ofi_mutex_lock(&fab->mutex);
+	*fd = dmabuf_reg_get(fab, entry->info.iov.iov_base,
+			     entry->info.iov.iov_len,
+			     (uintptr_t) entry->info.iov.iov_base,
+			     entry->info.iov.iov_len);
+	ofi_mutex_unlock(&fab->mutex);
+
+	return *fd < 0 ? -FI_EIO : 0;
+}
+
+static void dmabuf_cache_delete_region(struct ofi_mr_cache *cache,
+				       struct ofi_mr_entry *entry)
+{
+	struct dmabuf_peer_mem_fabric *fab;
+
+	fab = container_of(cache, struct dmabuf_peer_mem_fabric, cache);
+
+	ofi_mutex_lock(&fab->mutex);
+	dmabuf_reg_put(fab, (uintptr_t) entry->info.iov.iov_base,
+		       entry->info.iov.iov_len, *(int *) entry->data);
+	ofi_mutex_unlock(&fab->mutex);
+}
+
 /*
  * If the MR buffer is associated with a dmabuf, get the dmabuf fd and add to
  * the registry.
@@ -167,14 +277,16 @@ static inline void put_dmabuf_fd(int fd)
 static void get_mr_fd(struct dmabuf_peer_mem_mr *mr,
 		      size_t iov_count, const struct iovec *iov)
 {
-	int fd = -1;
-	int err;
 	struct dmabuf_peer_mem_fabric *fab;
+	struct ofi_mr_info info = {0};
+	struct ofi_mr_entry *entry;
+	int err;
 
 	fab = container_of(mr->mr_hook.domain->fabric,
 			   struct dmabuf_peer_mem_fabric, fabric_hook);
 
 	mr->fd = -1;
+	mr->cache_entry = NULL;
 
 	while (iov_count && !iov->iov_len) {
 		iov_count--;
@@ -182,89 +294,47 @@ static void get_mr_fd(struct dmabuf_peer_mem_mr *mr,
 	}
 
 	if (!iov_count)
-		goto out;
+		return;
 
 	err = ze_hmem_get_base_addr(iov->iov_base, iov->iov_len,
 				    (void **)&mr->base, &mr->size);
 	if (err)
-		goto out;
-
-	ofi_mutex_lock(&fab->mutex);
-
-	err = dmabuf_reg_query(fab->dmabuf_reg_fd, mr->base, mr->size, &fd);
-	switch (err) {
-	case -ENOENT:
-		/*
-		 * The region is not covered by any entry in the registry, add a
-		 * new entry to the registry now.
-		 */
-		fd = get_dmabuf_fd(iov->iov_base, iov->iov_len);
-		if (fd < 0)
-			goto out_unlock;
+		return;
 
-		err = dmabuf_reg_add(fab->dmabuf_reg_fd, mr->base, mr->size, fd);
-		if (err) {
-			put_dmabuf_fd(fd);
-		} else {
-			mr->fd = fd;
-			FI_INFO(fab->fabric_hook.hprov, FI_LOG_MR,
-				"Add new entry: base 0x%"PRIx64" size %"PRIu64" fd %d\n",
-				mr->base, mr->size, mr->fd);
+	if (fab->cache_enabled) {
+		info.iov.iov_base = (void *) (uintptr_t) mr->base;
+		info.iov.iov_len = mr->size;
+		info.iface = FI_HMEM_ZE;
+		if (!ofi_mr_cache_search(&fab->cache, &info, &entry)) {
+			mr->cache_entry = entry;
+			mr->fd = *(int *) entry->data;
+			return;
 		}
-		break;
-
-	case 0:
-		/*
-		 * The region is already covered by an entry in the registry,
-		 * add a reference to it.
-		 */
-		err = dmabuf_reg_add(fab->dmabuf_reg_fd, mr->base, mr->size, fd);
-		if (!err)
-			mr->fd = fd;
-		break;
-
-	default:
-		/*
-		 * Error happened: range overflow, range conflict with existing
-		 * entries, or I/O error.
-		 */
-		break;
 	}
 
-out_unlock:
+	ofi_mutex_lock(&fab->mutex);
+	mr->fd = dmabuf_reg_get(fab, iov->iov_base, iov->iov_len, mr->base,
+				mr->size);
 	ofi_mutex_unlock(&fab->mutex);
-
-out:
-	return;
 }
 
 static void release_mr_fd(struct dmabuf_peer_mem_mr *mr)
 {
-	int fd;
-	int err;
 	struct dmabuf_peer_mem_fabric *fab;
 
 	fab = container_of(mr->mr_hook.domain->fabric,
 			   struct dmabuf_peer_mem_fabric, fabric_hook);
 
+	if (mr->cache_entry) {
+		ofi_mr_cache_delete(&fab->cache, mr->cache_entry);
+		return;
+	}
+
 	if (mr->fd < 0)
 		return;
 
-	/*
-	 * Remove this MR's reference to the fd in the kernel registry. The
-	 * fd would be removed from the registry if the refcnt reaches 0.
-	 * In that case, the fd is no longer used by any MR and should be
-	 * released.
-	 */
 	ofi_mutex_lock(&fab->mutex);
-	dmabuf_reg_remove(fab->dmabuf_reg_fd, mr->fd);
-	err = dmabuf_reg_query(fab->dmabuf_reg_fd, mr->base, mr->size, &fd);
-	if (err == -ENOENT) {
-		FI_INFO(fab->fabric_hook.hprov, FI_LOG_MR,
-			"Remove entry: base 0x%"PRIx64" size %"PRIu64" fd %d\n",
-			mr->base, mr->size, mr->fd);
-		put_dmabuf_fd(mr->fd);
-	}
+	dmabuf_reg_put(fab, mr->base, mr->size, mr->fd);
 	ofi_mutex_unlock(&fab->mutex);
 }
 
@@ -381,6 +451,8 @@ static int hook_dmabuf_peer_mem_fabric_close(struct fid *fid)
 	struct dmabuf_peer_mem_fabric *fab;
 
 	fab = container_of(fid, struct dmabuf_peer_mem_fabric, fabric_hook);
+	if (fab->cache_enabled)
+		ofi_mr_cache_cleanup(&fab->cache);
 	close(fab->dmabuf_reg_fd);
 	ofi_mutex_destroy(&fab->mutex);
 	hook_close(fid);
@@ -402,6 +474,9 @@ static int hook_dmabuf_peer_mem_fabric(struct fi_fabric_attr *attr,
 {
         struct fi_provider *hprov = context;
         struct dmabuf_peer_mem_fabric *fab;
+	struct ofi_mem_monitor *memory_monitors[OFI_HMEM_MAX] = {
+		[FI_HMEM_ZE] = default_ze_monitor,
+	};
 	extern struct hook_prov_ctx hook_dmabuf_peer_mem_ctx;
 	int fd;
 
@@ -429,6 +504,14 @@ static int hook_dmabuf_peer_mem_fabric(struct fi_fabric_attr *attr,
 
 	ofi_mutex_init(&fab->mutex);
 	fab->dmabuf_reg_fd = fd;
+
+	/* Without the cache, allocations are exported for each MR */
+	fab->cache.entry_data_size = sizeof(int);
+	fab->cache.add_region = dmabuf_cache_add_region;
+	fab->cache.delete_region = dmabuf_cache_delete_region;
+	fab->cache_enabled = default_ze_monitor &&
+			     !ofi_mr_cache_init(NULL, memory_monitors,
+						&fab->cache);
 	hook_fabric_init(&fab->fabric_hook, HOOK_DMABUF_PEER_MEM, attr->fabric,
 			 hprov, &dmabuf_peer_mem_fabric_fid_ops,
 			 &hook_dmabuf_peer_mem_ctx);
@@ -50,6 +50,9 @@ struct hook_hmem_domain {
 	struct ofi_bufpool	*ctx_pool;
 	struct ofi_rbmap	rbmap;
 	struct dlist_entry	mr_list;
+	/* Keeps device registrations after their last operation completes */
+	struct ofi_mr_cache	cache;
+	bool			cache_enabled;
 };
 
 struct hook_hmem_ep {
@@ -62,6 +65,7 @@ struct hook_hmem_ep {
 
 struct hook_hmem_desc {
 	struct fid_mr		*mr_fid;
+	struct ofi_mr_entry	*cache_entry;
 	void			*desc;
 	struct iovec		iov;
 	struct dlist_entry	entry;
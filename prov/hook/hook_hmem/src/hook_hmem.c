@@ -50,6 +50,70 @@ static int hook_hmem_iov_compare(struct ofi_rbmap *map, void *key, void *data)
 	return 0;
 }
 
+static int hook_hmem_cache_add_region(struct ofi_mr_cache *cache,
+				      struct ofi_mr_entry *entry)
+{
+	struct hook_hmem_domain *domain;
+	struct fi_mr_attr attr = {0};
+
+	domain = container_of(cache, struct hook_hmem_domain, cache);
+	attr.mr_iov = &entry->info.iov;
+	attr.iov_count = 1;
+	attr.access = FI_SEND | FI_RECV | FI_READ | FI_WRITE |
+		      FI_REMOTE_READ | FI_REMOTE_WRITE;
+	attr.requested_key = (uint64_t) entry;
+	attr.iface = entry->info.iface;
+	attr.device.reserved = entry->info.device;
+
+	return fi_mr_regattr(domain->hook_domain.hdomain, &attr, 0,
+			     (struct fid_mr **) entry->data);
+}
+
+static void hook_hmem_cache_delete_region(struct ofi_mr_cache *cache,
+					  struct ofi_mr_entry *entry)
+{
+	fi_close(&(*(struct fid_mr **) entry->data)->fid);
+}
+
+/*
+ * Registering device memory is expensive, and buffers are usually reused
+ * across operations.  Registrations are kept in the MR cache once the
+ * operations using them complete, and the memory monitors invalidate them
+ * when the device memory is freed.
+ */
+static int hook_hmem_cache_search(struct hook_hmem_domain *domain,
+				  const struct iovec *iov, uint64_t iface,
+				  uint64_t device,
+				  struct hook_hmem_desc *hmem_desc)
+{
+	struct ofi_mr_info info = {0};
+	struct ofi_mr_entry *entry;
+	int ret;
+
+	info.iov = *iov;
+	info.iface = iface;
+	info.device = device;
+
+	ret = ofi_mr_cache_search(&domain->cache, &info, &entry);
+	if (ret)
+		return ret;
+
+	hmem_desc->cache_entry = entry;
+	hmem_desc->mr_fid = *(struct fid_mr **) entry->data;
+	hmem_desc->desc = fi_mr_desc(hmem_desc->mr_fid);
+	hmem_desc->iov = *iov;
+	return 0;
+}
+
+static void hook_hmem_release_region(struct hook_hmem_domain *domain,
+				     struct hook_hmem_desc *hmem_desc)
+{
+	if (hmem_desc->cache_entry)
+		ofi_mr_cache_delete(&domain->cache, hmem_desc->cache_entry);
+	else if (hmem_desc->desc)
+		fi_close(&(hmem_desc->mr_fid)->fid);
+}
+
 static int hook_hmem_add_region(struct hook_hmem_domain *domain,
 		const struct iovec *iov, struct hook_hmem_desc **hmem_desc)
 {
@@ -66,6 +130,7 @@ static int hook_hmem_add_region(struct hook_hmem_domain *domain,
 	if (iface == FI_HMEM_SYSTEM) {
 		(*hmem_desc)->desc = NULL;
 		(*hmem_desc)->iov = *iov;
+		(*hmem_desc)->cache_entry = NULL;
 		goto out;
 	}
 
@@ -76,6 +141,16 @@ static int hook_hmem_add_region(struct hook_hmem_domain *domain,
 		return -FI_EINVAL;
 	}
 
+	if (domain->cache_enabled && domain->cache.monitors[iface]) {
+		ret = hook_hmem_cache_search(domain, &base_iov, iface, device,
+					     *hmem_desc);
+		if (ret) {
+			ofi_buf_free(*hmem_desc);
+			return ret;
+		}
+		goto out;
+	}
+
 	attr.mr_iov = &base_iov;
 	attr.iov_count = 1;
 	attr.access = FI_SEND | FI_RECV | FI_READ | FI_WRITE |
@@ -94,6 +169,7 @@ static int hook_hmem_add_region(struct hook_hmem_domain *domain,
 
 	(*hmem_desc)->desc = fi_mr_desc((*hmem_desc)->mr_fid);
 	(*hmem_desc)->iov = base_iov;
+	(*hmem_desc)->cache_entry = NULL;
 out:
 	(*hmem_desc)->count = 0;
 	dlist_insert_tail(&(*hmem_desc)->entry, &domain->mr_list);
@@ -140,8 +216,7 @@ static void hook_hmem_uncache_mr(struct hook_hmem_domain *domain,
 		return;
 
 	ofi_rbmap_delete(&domain->rbmap, node);
-	if (hmem_desc->desc)
-		fi_close(&(hmem_desc->mr_fid)->fid);
+	hook_hmem_release_region(domain, hmem_desc);
 
 	dlist_remove(&hmem_desc->entry);
 	ofi_buf_free(hmem_desc);
@@ -1759,13 +1834,13 @@ static int hook_hmem_domain_close(struct fid *fid)
 	while (!dlist_empty(&hmem_domain->mr_list)) {
 		dlist_pop_front(&hmem_domain->mr_list, struct hook_hmem_desc,
 				hmem_desc, entry);
-		if (hmem_desc->desc)
-			fi_close(&(hmem_desc->mr_fid)->fid);
-		dlist_remove(&hmem_desc->entry);
+		hook_hmem_release_region(hmem_domain, hmem_desc);
 		ofi_buf_free(hmem_desc);
 	}
 
 	ofi_rbmap_cleanup(&hmem_domain->rbmap);
+	if (hmem_domain->cache_enabled)
+		ofi_mr_cache_cleanup(&hmem_domain->cache);
 
 	ret = fi_close(&hmem_domain->hook_domain.hdomain->fid);
 	if (ret)
@@ -1868,6 +1943,11 @@ static struct fi_ops_domain hook_hmem_domain_ops = {
 static int hook_hmem_domain(struct fid_fabric *fabric, struct fi_info *info,
 			    struct fid_domain **domain, void *context)
 {
+	struct ofi_mem_monitor *memory_monitors[OFI_HMEM_MAX] = {
+		[FI_HMEM_CUDA] = default_cuda_monitor,
+		[FI_HMEM_ROCR] = default_rocr_monitor,
+		[FI_HMEM_ZE] = default_ze_monitor,
+	};
 	struct hook_hmem_domain *hmem_domain;
 	int ret;
 
@@ -1906,6 +1986,13 @@ static int hook_hmem_domain(struct fid_fabric *fabric, struct fi_info *info,
 	dlist_init(&hmem_domain->mr_list);
 	ofi_mutex_init(&hmem_domain->lock);
 
+	/* Without the cache, device memory is registered per operation */
+	hmem_domain->cache.entry_data_size = sizeof(struct fid_mr *);
+	hmem_domain->cache.add_region = hook_hmem_cache_add_region;
+	hmem_domain->cache.delete_region = hook_hmem_cache_delete_region;
+	hmem_domain->cache_enabled = !ofi_mr_cache_init(NULL, memory_monitors,
+							&hmem_domain->cache);
+
 	return 0;
 out:
 	free(hmem_domain);
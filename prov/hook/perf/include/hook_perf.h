@@ -38,9 +38,24 @@
 #include "ofi_perf.h"
 
 
+/*
+ * Each counter listed in FI_PERF_CNTR has its own perf set.  Entries in a
+ * set are indexed by API and by the size bucket of the transfer.
+ */
+enum {
+	PERF_BUCKET_64,
+	PERF_BUCKET_1K,
+	PERF_BUCKET_16K,
+	PERF_BUCKET_256K,
+	PERF_BUCKET_LARGE,
+	PERF_BUCKETS
+};
+
 struct perf_fabric {
 	struct hook_fabric fabric_hook;
-	struct ofi_perfset perf_set;
+	struct ofi_perfset perf_set[OFI_PERF_MAX_EVENTS];
+	struct ofi_perf_event *event[OFI_PERF_MAX_EVENTS];
+	size_t set_cnt;
 };
 
 int hook_perf_destroy(struct fid *fabric);
@@ -30,7 +30,11 @@
  * SOFTWARE.
  */
 
+#include <stdio.h>
+#include <inttypes.h>
+
 #include "ofi_perf.h"
+#include "ofi_iov.h"
 #include "ofi_prov.h"
 #include "hook_prov.h"
 
@@ -40,22 +44,62 @@ const char *perf_counters_str[] = {
 };
 
 
-static inline struct ofi_perfset *perf_set(struct hook_ep *ep)
+static const char *perf_bucket_str[PERF_BUCKETS] = {
+	[PERF_BUCKET_64] = "<=64",
+	[PERF_BUCKET_1K] = "<=1K",
+	[PERF_BUCKET_16K] = "<=16K",
+	[PERF_BUCKET_256K] = "<=256K",
+	[PERF_BUCKET_LARGE] = ">256K",
+};
+
+/* Rows whose share of a miss counter reaches this percentage are flagged */
+#define PERF_STALL_PCT 20
+
+
+static inline struct perf_fabric *perf_fab(struct hook_ep *ep)
 {
-	return &container_of(ep->domain->fabric, struct perf_fabric,
-			     fabric_hook)->perf_set;
+	return container_of(ep->domain->fabric, struct perf_fabric,
+			    fabric_hook);
 }
 
-static inline struct ofi_perfset *perf_set_cq(struct hook_cq *cq)
+static inline struct perf_fabric *perf_fab_cq(struct hook_cq *cq)
 {
-	return &container_of(cq->domain->fabric, struct perf_fabric,
-			     fabric_hook)->perf_set;
+	return container_of(cq->domain->fabric, struct perf_fabric,
+			    fabric_hook);
 }
 
-static inline struct ofi_perfset *perf_set_cntr(struct hook_cntr *cntr)
+static inline struct perf_fabric *perf_fab_cntr(struct hook_cntr *cntr)
 {
-	return &container_of(cntr->domain->fabric, struct perf_fabric,
-			     fabric_hook)->perf_set;
+	return container_of(cntr->domain->fabric, struct perf_fabric,
+			    fabric_hook);
+}
+
+static inline size_t perf_index(size_t api, size_t len)
+{
+	size_t bucket = 0;
+
+	for (len = len ? (len - 1) >> 6 : 0; len && bucket < PERF_BUCKETS - 1;
+	     len >>= 4)
+		bucket++;
+
+	return api * PERF_BUCKETS + bucket;
+}
+
+static inline void perf_start(struct perf_fabric *fab, size_t api, size_t len)
+{
+	size_t i, index = perf_index(api, len);
+
+	for (i = 0; i < fab->set_cnt; i++)
+		ofi_perfset_start(&fab->perf_set[i], index);
+}
+
+/* Stop the counters in reverse order, so that the reads nest */
+static inline void perf_end(struct perf_fabric *fab, size_t api, size_t len)
+{
+	size_t i, index = perf_index(api, len);
+
+	for (i = fab->set_cnt; i > 0; i--)
+		ofi_perfset_end(&fab->perf_set[i - 1], index);
 }
 
 /*
@@ -269,9 +313,9 @@ perf_msg_recv(struct fid_ep *ep, void *buf, size_t len, void *desc,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_recv);
+	perf_start(perf_fab(myep), perf_recv, len);
 	ret = fi_recv(myep->hep, buf, len, desc, src_addr, context);
-	ofi_perfset_end(perf_set(myep), perf_recv);
+	perf_end(perf_fab(myep), perf_recv, len);
 	return ret;
 }
 
@@ -280,11 +324,12 @@ perf_msg_recvv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	       size_t count, fi_addr_t src_addr, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(iov, count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_recvv);
+	perf_start(perf_fab(myep), perf_recvv, len);
 	ret = fi_recvv(myep->hep, iov, desc, count, src_addr, context);
-	ofi_perfset_end(perf_set(myep), perf_recvv);
+	perf_end(perf_fab(myep), perf_recvv, len);
 	return ret;
 }
 
@@ -292,11 +337,12 @@ static ssize_t
 perf_msg_recvmsg(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_recvmsg);
+	perf_start(perf_fab(myep), perf_recvmsg, len);
 	ret = fi_recvmsg(myep->hep, msg, flags);
-	ofi_perfset_end(perf_set(myep), perf_recvmsg);
+	perf_end(perf_fab(myep), perf_recvmsg, len);
 	return ret;
 }
 
@@ -307,9 +353,9 @@ perf_msg_send(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_send);
+	perf_start(perf_fab(myep), perf_send, len);
 	ret = fi_send(myep->hep, buf, len, desc, dest_addr, context);
-	ofi_perfset_end(perf_set(myep), perf_send);
+	perf_end(perf_fab(myep), perf_send, len);
 	return ret;
 }
 
@@ -318,11 +364,12 @@ perf_msg_sendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	       size_t count, fi_addr_t dest_addr, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(iov, count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_sendv);
+	perf_start(perf_fab(myep), perf_sendv, len);
 	ret = fi_sendv(myep->hep, iov, desc, count, dest_addr, context);
-	ofi_perfset_end(perf_set(myep), perf_sendv);
+	perf_end(perf_fab(myep), perf_sendv, len);
 	return ret;
 }
 
@@ -331,11 +378,12 @@ perf_msg_sendmsg(struct fid_ep *ep, const struct fi_msg *msg,
 		 uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_sendmsg);
+	perf_start(perf_fab(myep), perf_sendmsg, len);
 	ret = fi_sendmsg(myep->hep, msg, flags);
-	ofi_perfset_end(perf_set(myep), perf_sendmsg);
+	perf_end(perf_fab(myep), perf_sendmsg, len);
 	return ret;
 }
 
@@ -346,9 +394,9 @@ perf_msg_inject(struct fid_ep *ep, const void *buf, size_t len,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_inject);
+	perf_start(perf_fab(myep), perf_inject, len);
 	ret = fi_inject(myep->hep, buf, len, dest_addr);
-	ofi_perfset_end(perf_set(myep), perf_inject);
+	perf_end(perf_fab(myep), perf_inject, len);
 	return ret;
 }
 
@@ -359,9 +407,9 @@ perf_msg_senddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_senddata);
+	perf_start(perf_fab(myep), perf_senddata, len);
 	ret = fi_senddata(myep->hep, buf, len, desc, data, dest_addr, context);
-	ofi_perfset_end(perf_set(myep), perf_senddata);
+	perf_end(perf_fab(myep), perf_senddata, len);
 	return ret;
 }
 
@@ -372,9 +420,9 @@ perf_msg_injectdata(struct fid_ep *ep, const void *buf, size_t len,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_injectdata);
+	perf_start(perf_fab(myep), perf_injectdata, len);
 	ret = fi_injectdata(myep->hep, buf, len, data, dest_addr);
-	ofi_perfset_end(perf_set(myep), perf_injectdata);
+	perf_end(perf_fab(myep), perf_injectdata, len);
 	return ret;
 }
 
@@ -399,9 +447,9 @@ perf_rma_read(struct fid_ep *ep, void *buf, size_t len, void *desc,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_read);
+	perf_start(perf_fab(myep), perf_read, len);
 	ret = fi_read(myep->hep, buf, len, desc, src_addr, addr, key, context);
-	ofi_perfset_end(perf_set(myep), perf_read);
+	perf_end(perf_fab(myep), perf_read, len);
 	return ret;
 }
 
@@ -411,12 +459,13 @@ perf_rma_readv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	       void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(iov, count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_readv);
+	perf_start(perf_fab(myep), perf_readv, len);
 	ret = fi_readv(myep->hep, iov, desc, count, src_addr,
 		       addr, key, context);
-	ofi_perfset_end(perf_set(myep), perf_readv);
+	perf_end(perf_fab(myep), perf_readv, len);
 	return ret;
 }
 
@@ -425,11 +474,12 @@ perf_rma_readmsg(struct fid_ep *ep, const struct fi_msg_rma *msg,
 		 uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_readmsg);
+	perf_start(perf_fab(myep), perf_readmsg, len);
 	ret = fi_readmsg(myep->hep, msg, flags);
-	ofi_perfset_end(perf_set(myep), perf_readmsg);
+	perf_end(perf_fab(myep), perf_readmsg, len);
 	return ret;
 }
 
@@ -440,10 +490,10 @@ perf_rma_write(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_write);
+	perf_start(perf_fab(myep), perf_write, len);
 	ret = fi_write(myep->hep, buf, len, desc, dest_addr,
 		       addr, key, context);
-	ofi_perfset_end(perf_set(myep), perf_write);
+	perf_end(perf_fab(myep), perf_write, len);
 	return ret;
 }
 
@@ -453,12 +503,13 @@ perf_rma_writev(struct fid_ep *ep, const struct iovec *iov, void **desc,
 		void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(iov, count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_writev);
+	perf_start(perf_fab(myep), perf_writev, len);
 	ret = fi_writev(myep->hep, iov, desc, count, dest_addr,
 			addr, key, context);
-	ofi_perfset_end(perf_set(myep), perf_writev);
+	perf_end(perf_fab(myep), perf_writev, len);
 	return ret;
 }
 
@@ -467,11 +518,12 @@ perf_rma_writemsg(struct fid_ep *ep, const struct fi_msg_rma *msg,
 		  uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_writemsg);
+	perf_start(perf_fab(myep), perf_writemsg, len);
 	ret = fi_writemsg(myep->hep, msg, flags);
-	ofi_perfset_end(perf_set(myep), perf_writemsg);
+	perf_end(perf_fab(myep), perf_writemsg, len);
 	return ret;
 }
 
@@ -482,9 +534,9 @@ perf_rma_inject(struct fid_ep *ep, const void *buf, size_t len,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_inject_write);
+	perf_start(perf_fab(myep), perf_inject_write, len);
 	ret = fi_inject_write(myep->hep, buf, len, dest_addr, addr, key);
-	ofi_perfset_end(perf_set(myep), perf_inject_write);
+	perf_end(perf_fab(myep), perf_inject_write, len);
 	return ret;
 }
 
@@ -496,10 +548,10 @@ perf_rma_writedata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_writedata);
+	perf_start(perf_fab(myep), perf_writedata, len);
 	ret = fi_writedata(myep->hep, buf, len, desc, data,
 			   dest_addr, addr, key, context);
-	ofi_perfset_end(perf_set(myep), perf_writedata);
+	perf_end(perf_fab(myep), perf_writedata, len);
 	return ret;
 }
 
@@ -511,10 +563,10 @@ perf_rma_injectdata(struct fid_ep *ep, const void *buf, size_t len,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_inject_writedata);
+	perf_start(perf_fab(myep), perf_inject_writedata, len);
 	ret = fi_inject_writedata(myep->hep, buf, len, data, dest_addr,
 				  addr, key);
-	ofi_perfset_end(perf_set(myep), perf_inject_writedata);
+	perf_end(perf_fab(myep), perf_inject_writedata, len);
 	return ret;
 }
 
@@ -540,10 +592,10 @@ perf_tagged_recv(struct fid_ep *ep, void *buf, size_t len, void *desc,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_trecv);
+	perf_start(perf_fab(myep), perf_trecv, len);
 	ret = fi_trecv(myep->hep, buf, len, desc, src_addr,
 		       tag, ignore, context);
-	ofi_perfset_end(perf_set(myep), perf_trecv);
+	perf_end(perf_fab(myep), perf_trecv, len);
 	return ret;
 }
 
@@ -553,12 +605,13 @@ perf_tagged_recvv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 		  uint64_t ignore, void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(iov, count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_trecvv);
+	perf_start(perf_fab(myep), perf_trecvv, len);
 	ret = fi_trecvv(myep->hep, iov, desc, count, src_addr,
 			tag, ignore, context);
-	ofi_perfset_end(perf_set(myep), perf_trecvv);
+	perf_end(perf_fab(myep), perf_trecvv, len);
 	return ret;
 }
 
@@ -567,11 +620,12 @@ perf_tagged_recvmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 		    uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_trecvmsg);
+	perf_start(perf_fab(myep), perf_trecvmsg, len);
 	ret = fi_trecvmsg(myep->hep, msg, flags);
-	ofi_perfset_end(perf_set(myep), perf_trecvmsg);
+	perf_end(perf_fab(myep), perf_trecvmsg, len);
 	return ret;
 }
 
@@ -582,9 +636,9 @@ perf_tagged_send(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_tsend);
+	perf_start(perf_fab(myep), perf_tsend, len);
 	ret = fi_tsend(myep->hep, buf, len, desc, dest_addr, tag, context);
-	ofi_perfset_end(perf_set(myep), perf_tsend);
+	perf_end(perf_fab(myep), perf_tsend, len);
 	return ret;
 }
 
@@ -594,11 +648,12 @@ perf_tagged_sendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 		  void *context)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(iov, count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_tsendv);
+	perf_start(perf_fab(myep), perf_tsendv, len);
 	ret = fi_tsendv(myep->hep, iov, desc, count, dest_addr, tag, context);
-	ofi_perfset_end(perf_set(myep), perf_tsendv);
+	perf_end(perf_fab(myep), perf_tsendv, len);
 	return ret;
 }
 
@@ -607,11 +662,12 @@ perf_tagged_sendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 		    uint64_t flags)
 {
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
+	size_t len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_tsendmsg);
+	perf_start(perf_fab(myep), perf_tsendmsg, len);
 	ret = fi_tsendmsg(myep->hep, msg, flags);
-	ofi_perfset_end(perf_set(myep), perf_tsendmsg);
+	perf_end(perf_fab(myep), perf_tsendmsg, len);
 	return ret;
 }
 
@@ -622,9 +678,9 @@ perf_tagged_inject(struct fid_ep *ep, const void *buf, size_t len,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_tinject);
+	perf_start(perf_fab(myep), perf_tinject, len);
 	ret = fi_tinject(myep->hep, buf, len, dest_addr, tag);
-	ofi_perfset_end(perf_set(myep), perf_tinject);
+	perf_end(perf_fab(myep), perf_tinject, len);
 	return ret;
 }
 
@@ -636,10 +692,10 @@ perf_tagged_senddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_tsenddata);
+	perf_start(perf_fab(myep), perf_tsenddata, len);
 	ret = fi_tsenddata(myep->hep, buf, len, desc, data,
 			   dest_addr, tag, context);
-	ofi_perfset_end(perf_set(myep), perf_tsenddata);
+	perf_end(perf_fab(myep), perf_tsenddata, len);
 	return ret;
 }
 
@@ -650,9 +706,9 @@ perf_tagged_injectdata(struct fid_ep *ep, const void *buf, size_t len,
 	struct hook_ep *myep = container_of(ep, struct hook_ep, ep);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set(myep), perf_tinjectdata);
+	perf_start(perf_fab(myep), perf_tinjectdata, len);
 	ret = fi_tinjectdata(myep->hep, buf, len, data, dest_addr, tag);
-	ofi_perfset_end(perf_set(myep), perf_tinjectdata);
+	perf_end(perf_fab(myep), perf_tinjectdata, len);
 	return ret;
 }
 
@@ -675,9 +731,9 @@ static ssize_t perf_cq_read_op(struct fid_cq *cq, void *buf, size_t count)
 	struct hook_cq *mycq = container_of(cq, struct hook_cq, cq);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set_cq(mycq), perf_cq_read);
+	perf_start(perf_fab_cq(mycq), perf_cq_read, 0);
 	ret = fi_cq_read(mycq->hcq, buf, count);
-	ofi_perfset_end(perf_set_cq(mycq), perf_cq_read);
+	perf_end(perf_fab_cq(mycq), perf_cq_read, 0);
 	return ret;
 }
 
@@ -687,9 +743,9 @@ perf_cq_readerr_op(struct fid_cq *cq, struct fi_cq_err_entry *buf, uint64_t flag
 	struct hook_cq *mycq = container_of(cq, struct hook_cq, cq);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set_cq(mycq), perf_cq_readerr);
+	perf_start(perf_fab_cq(mycq), perf_cq_readerr, 0);
 	ret = fi_cq_readerr(mycq->hcq, buf, flags);
-	ofi_perfset_end(perf_set_cq(mycq), perf_cq_readerr);
+	perf_end(perf_fab_cq(mycq), perf_cq_readerr, 0);
 	return ret;
 }
 
@@ -699,9 +755,9 @@ perf_cq_readfrom_op(struct fid_cq *cq, void *buf, size_t count, fi_addr_t *src_a
 	struct hook_cq *mycq = container_of(cq, struct hook_cq, cq);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set_cq(mycq), perf_cq_readfrom);
+	perf_start(perf_fab_cq(mycq), perf_cq_readfrom, 0);
 	ret = fi_cq_readfrom(mycq->hcq, buf, count, src_addr);
-	ofi_perfset_end(perf_set_cq(mycq), perf_cq_readfrom);
+	perf_end(perf_fab_cq(mycq), perf_cq_readfrom, 0);
 	return ret;
 }
 
@@ -712,9 +768,9 @@ perf_cq_sread_op(struct fid_cq *cq, void *buf, size_t count,
 	struct hook_cq *mycq = container_of(cq, struct hook_cq, cq);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set_cq(mycq), perf_cq_sread);
+	perf_start(perf_fab_cq(mycq), perf_cq_sread, 0);
 	ret = fi_cq_sread(mycq->hcq, buf, count, cond, timeout);
-	ofi_perfset_end(perf_set_cq(mycq), perf_cq_sread);
+	perf_end(perf_fab_cq(mycq), perf_cq_sread, 0);
 	return ret;
 }
 
@@ -725,9 +781,9 @@ perf_cq_sreadfrom_op(struct fid_cq *cq, void *buf, size_t count,
 	struct hook_cq *mycq = container_of(cq, struct hook_cq, cq);
 	ssize_t ret;
 
-	ofi_perfset_start(perf_set_cq(mycq), perf_cq_sreadfrom);
+	perf_start(perf_fab_cq(mycq), perf_cq_sreadfrom, 0);
 	ret = fi_cq_sreadfrom(mycq->hcq, buf, count, src_addr, cond, timeout);
-	ofi_perfset_end(perf_set_cq(mycq), perf_cq_sreadfrom);
+	perf_end(perf_fab_cq(mycq), perf_cq_sreadfrom, 0);
 	return ret;
 }
 
@@ -736,9 +792,9 @@ static int perf_cq_signal_op(struct fid_cq *cq)
 	struct hook_cq *mycq = container_of(cq, struct hook_cq, cq);
 	int ret;
 
-	ofi_perfset_start(perf_set_cq(mycq), perf_cq_signal);
+	perf_start(perf_fab_cq(mycq), perf_cq_signal, 0);
 	ret = fi_cq_signal(mycq->hcq);
-	ofi_perfset_end(perf_set_cq(mycq), perf_cq_signal);
+	perf_end(perf_fab_cq(mycq), perf_cq_signal, 0);
 	return ret;
 }
 
@@ -759,9 +815,9 @@ static uint64_t perf_cntr_read_op(struct fid_cntr *cntr)
 	struct hook_cntr *mycntr = container_of(cntr, struct hook_cntr, cntr);
 	uint64_t ret;
 
-	ofi_perfset_start(perf_set_cntr(mycntr), perf_cntr_read);
+	perf_start(perf_fab_cntr(mycntr), perf_cntr_read, 0);
 	ret = fi_cntr_read(mycntr->hcntr);
-	ofi_perfset_end(perf_set_cntr(mycntr), perf_cntr_read);
+	perf_end(perf_fab_cntr(mycntr), perf_cntr_read, 0);
 	return ret;
 }
 
@@ -770,9 +826,9 @@ static uint64_t perf_cntr_readerr_op(struct fid_cntr *cntr)
 	struct hook_cntr *mycntr = container_of(cntr, struct hook_cntr, cntr);
 	uint64_t ret;
 
-	ofi_perfset_start(perf_set_cntr(mycntr), perf_cntr_readerr);
+	perf_start(perf_fab_cntr(mycntr), perf_cntr_readerr, 0);
 	ret = fi_cntr_readerr(mycntr->hcntr);
-	ofi_perfset_end(perf_set_cntr(mycntr), perf_cntr_readerr);
+	perf_end(perf_fab_cntr(mycntr), perf_cntr_readerr, 0);
 	return ret;
 }
 
@@ -781,9 +837,9 @@ static int perf_cntr_add_op(struct fid_cntr *cntr, uint64_t value)
 	struct hook_cntr *mycntr = container_of(cntr, struct hook_cntr, cntr);
 	int ret;
 
-	ofi_perfset_start(perf_set_cntr(mycntr), perf_cntr_add);
+	perf_start(perf_fab_cntr(mycntr), perf_cntr_add, 0);
 	ret = fi_cntr_add(mycntr->hcntr, value);
-	ofi_perfset_end(perf_set_cntr(mycntr), perf_cntr_add);
+	perf_end(perf_fab_cntr(mycntr), perf_cntr_add, 0);
 	return ret;
 }
 
@@ -792,9 +848,9 @@ static int perf_cntr_set_op(struct fid_cntr *cntr, uint64_t value)
 	struct hook_cntr *mycntr = container_of(cntr, struct hook_cntr, cntr);
 	int ret;
 
-	ofi_perfset_start(perf_set_cntr(mycntr), perf_cntr_set);
+	perf_start(perf_fab_cntr(mycntr), perf_cntr_set, 0);
 	ret = fi_cntr_set(mycntr->hcntr, value);
-	ofi_perfset_end(perf_set_cntr(mycntr), perf_cntr_set);
+	perf_end(perf_fab_cntr(mycntr), perf_cntr_set, 0);
 	return ret;
 }
 
@@ -803,9 +859,9 @@ static int perf_cntr_wait_op(struct fid_cntr *cntr, uint64_t threshold, int time
 	struct hook_cntr *mycntr = container_of(cntr, struct hook_cntr, cntr);
 	int ret;
 
-	ofi_perfset_start(perf_set_cntr(mycntr), perf_cntr_wait);
+	perf_start(perf_fab_cntr(mycntr), perf_cntr_wait, 0);
 	ret = fi_cntr_wait(mycntr->hcntr, threshold, timeout);
-	ofi_perfset_end(perf_set_cntr(mycntr), perf_cntr_wait);
+	perf_end(perf_fab_cntr(mycntr), perf_cntr_wait, 0);
 	return ret;
 }
 
@@ -814,9 +870,9 @@ static int perf_cntr_adderr_op(struct fid_cntr *cntr, uint64_t value)
 	struct hook_cntr *mycntr = container_of(cntr, struct hook_cntr, cntr);
 	int ret;
 
-	ofi_perfset_start(perf_set_cntr(mycntr), perf_cntr_adderr);
+	perf_start(perf_fab_cntr(mycntr), perf_cntr_adderr, 0);
 	ret = fi_cntr_adderr(mycntr->hcntr, value);
-	ofi_perfset_end(perf_set_cntr(mycntr), perf_cntr_adderr);
+	perf_end(perf_fab_cntr(mycntr), perf_cntr_adderr, 0);
 	return ret;
 }
 
@@ -825,9 +881,9 @@ static int perf_cntr_seterr_op(struct fid_cntr *cntr, uint64_t value)
 	struct hook_cntr *mycntr = container_of(cntr, struct hook_cntr, cntr);
 	int ret;
 
-	ofi_perfset_start(perf_set_cntr(mycntr), perf_cntr_seterr);
+	perf_start(perf_fab_cntr(mycntr), perf_cntr_seterr, 0);
 	ret = fi_cntr_seterr(mycntr->hcntr, value);
-	ofi_perfset_end(perf_set_cntr(mycntr), perf_cntr_seterr);
+	perf_end(perf_fab_cntr(mycntr), perf_cntr_seterr, 0);
 	return ret;
 }
 
@@ -851,13 +907,80 @@ static struct fi_ops perf_fabric_fid_ops = {
 	.ops_open = hook_ops_open,
 };
 
+/*
+ * Log the average of every counter per API and size bucket.  For counters
+ * of memory misses, rows that account for a large share of all misses are
+ * flagged, which points at the hot paths stalled on memory.
+ */
+static void perf_report(struct perf_fabric *fab)
+{
+	struct fi_provider *prov = fab->fabric_hook.hprov;
+	struct ofi_perf_data *data;
+	uint64_t total[OFI_PERF_MAX_EVENTS] = {0};
+	char line[256], stall[64];
+	size_t i, index, api, len, pct;
+
+	for (i = 0; i < fab->set_cnt; i++) {
+		for (index = 0; index < fab->perf_set[i].size; index++)
+			total[i] += fab->perf_set[i].data[index].sum;
+	}
+
+	len = snprintf(line, sizeof line, "\t%-20s%-8s%-10s", "Name", "Size",
+		       "Events");
+	for (i = 0; i < fab->set_cnt && len < sizeof line; i++)
+		len += snprintf(line + len, sizeof line - len, "%-15s",
+				fab->event[i]->name);
+
+	FI_TRACE(prov, FI_LOG_CORE, "\n");
+	FI_TRACE(prov, FI_LOG_CORE, "\tPERF: per API and size\n");
+	FI_TRACE(prov, FI_LOG_CORE, "%s\n", line);
+
+	for (index = 0; index < fab->perf_set[0].size; index++) {
+		data = &fab->perf_set[0].data[index];
+		if (!data->events)
+			continue;
+
+		api = index / PERF_BUCKETS;
+		len = snprintf(line, sizeof line, "\t%-20s%-8s%-10" PRIu64,
+			       perf_counters_str[api], api < perf_cq_read ?
+			       perf_bucket_str[index % PERF_BUCKETS] : "-",
+			       data->events);
+		stall[0] = '\0';
+
+		for (i = 0; i < fab->set_cnt && len < sizeof line; i++) {
+			data = &fab->perf_set[i].data[index];
+			len += snprintf(line + len, sizeof line - len, "%-15g",
+					(double) data->sum / data->events);
+
+			if (!(fab->event[i]->flags & OFI_PMC_FLAG_MISS) ||
+			    !total[i] || stall[0])
+				continue;
+
+			pct = data->sum * 100 / total[i];
+			if (pct >= PERF_STALL_PCT)
+				snprintf(stall, sizeof stall, "<- %zu%% of %s",
+					 pct, fab->event[i]->name);
+		}
+
+		FI_TRACE(prov, FI_LOG_CORE, "%s%s\n", line, stall);
+	}
+}
+
+static void perf_close_sets(struct perf_fabric *fab)
+{
+	size_t i;
+
+	for (i = 0; i < fab->set_cnt; i++)
+		ofi_perfset_close(&fab->perf_set[i]);
+}
+
 int hook_perf_destroy(struct fid *fid)
 {
 	struct perf_fabric *fab;
 
 	fab = container_of(fid, struct perf_fabric, fabric_hook);
-	ofi_perfset_log(&fab->perf_set, perf_counters_str);
-	ofi_perfset_close(&fab->perf_set);
+	perf_report(fab);
+	perf_close_sets(fab);
 	hook_close(fid);
 
 	return FI_SUCCESS;
@@ -870,16 +993,29 @@ static int hook_perf_fabric(struct fi_fabric_attr *attr,
 {
 	struct fi_provider *hprov = context;
 	struct perf_fabric *fab;
-	int ret;
+	size_t i;
+	int ret = -FI_ENOSYS;
 
 	FI_TRACE(hprov, FI_LOG_FABRIC, "Installing perf hook\n");
 	fab = calloc(1, sizeof *fab);
 	if (!fab)
 		return -FI_ENOMEM;
 
-	ret = ofi_perfset_create(hprov, &fab->perf_set, perf_size,
-				 perf_domain, perf_cntr, perf_flags);
-	if (ret) {
+	/* Counters that cannot be opened are skipped */
+	for (i = 0; i < perf_event_cnt; i++) {
+		ret = ofi_perfset_create(hprov, &fab->perf_set[fab->set_cnt],
+					 perf_size * PERF_BUCKETS,
+					 perf_events[i].domain, perf_events[i].cntr,
+					 perf_events[i].flags);
+		if (ret) {
+			FI_WARN(hprov, FI_LOG_FABRIC,
+				"Unable to count %s\n", perf_events[i].name);
+			continue;
+		}
+		fab->event[fab->set_cnt++] = &perf_events[i];
+	}
+
+	if (!fab->set_cnt) {
 		free(fab);
 		return ret;
 	}
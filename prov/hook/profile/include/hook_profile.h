@@ -118,9 +118,60 @@ struct profile_data {
 	uint64_t sum[PROF_SIZE_MAX];
 };
 
+/* End to end time, in ns, of the sampled operations of an API */
+struct profile_latency {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+};
+
+/* Transmit traffic to one destination fi_addr */
+struct profile_peer {
+	uint64_t count;
+	uint64_t sum;
+};
+
+#define PROF_FILE_MAGIC    0x666f7270  /* "prof" */
+#define PROF_FILE_VERSION  1
+
+/*
+ * Header of the counter region.  When a dump file is requested, the region
+ * is a shared mapping of the file, so the counters can be read by other
+ * processes while the application runs.  The header is followed by
+ * api_size profile_data, api_size profile_latency and peer_cnt + 1
+ * profile_peer entries, the last one counting all other destinations.
+ */
+struct profile_file_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t api_size;
+	uint32_t size_max;
+	uint64_t peer_cnt;
+};
+
+#define PROF_SAMPLE_SLOTS  256
+
+/* Sampled operation waiting for its completion */
+struct profile_sample {
+	void *context;
+	uint64_t start;
+	int api;
+};
+
 struct profile_context {
 	const struct fi_provider *hprov;
-	struct profile_data data[prof_api_size];
+	struct profile_file_hdr *hdr;
+	size_t hdr_size;
+	int fd;
+	struct profile_data *data;
+	struct profile_latency *latency;
+	struct profile_peer *peers;
+	size_t peer_cnt;
+
+	uint32_t sample_rate;
+	uint32_t sample_cnt;
+	size_t samples_out;
+	struct profile_sample samples[PROF_SAMPLE_SLOTS];
 };
 
 struct profile_fabric {
@@ -128,6 +179,14 @@ struct profile_fabric {
 	struct profile_context prof_ctx;
 };
 
+extern int prof_sample_rate;
+extern size_t prof_peer_cnt;
+extern char *prof_dump_file;
+
 void prof_report(const struct fi_provider *hprov,  struct profile_data *data);
+void prof_report_latency(const struct fi_provider *hprov,
+                         struct profile_latency *latency);
+void prof_report_peers(const struct fi_provider *hprov,
+                       struct profile_peer *peers, size_t peer_cnt);
 
 #endif /* _HOOK_PROFILE_H_ */
@@ -30,6 +30,13 @@
  * SOFTWARE.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
 #include "ofi_hook.h"
 #include "ofi_prov.h"
 #include "ofi_iov.h"
@@ -159,15 +166,111 @@ prof_add_cntr(struct profile_context *ctx, int cntr, int index, size_t size) {
 	}
 }
 
+static inline void
+prof_add_peer(struct profile_context *ctx, fi_addr_t addr, size_t size)
+{
+	struct profile_peer *peer;
+
+	if (!ctx->peers)
+		return;
+
+	peer = &ctx->peers[addr < ctx->peer_cnt ? addr : ctx->peer_cnt];
+	peer->count++;
+	peer->sum += size;
+}
+
+static inline struct profile_sample *
+prof_sample_slot(struct profile_context *ctx, void *context)
+{
+	uint64_t hash = (uintptr_t) context * 0x9e3779b97f4a7c15ULL;
+
+	return &ctx->samples[hash >> 56 & (PROF_SAMPLE_SLOTS - 1)];
+}
+
+/*
+ * Time 1 in sample_rate operations from the return of the posting call to
+ * the read of their completion.  An operation whose slot is taken by an
+ * earlier sample is skipped, and the next operation is tried instead.
+ */
+static inline void
+prof_sample(struct profile_context *ctx, int api, void *context)
+{
+	struct profile_sample *sample;
+
+	if (!ctx->sample_rate || !context ||
+	    ++ctx->sample_cnt < ctx->sample_rate)
+		return;
+
+	sample = prof_sample_slot(ctx, context);
+	if (sample->context)
+		return;
+
+	ctx->sample_cnt = 0;
+	ctx->samples_out++;
+	sample->context = context;
+	sample->api = api;
+	sample->start = ofi_gettime_ns();
+}
+
+static inline void
+prof_sample_done(struct profile_context *ctx, void *context, bool success)
+{
+	struct profile_sample *sample;
+	struct profile_latency *latency;
+	uint64_t time;
+
+	sample = prof_sample_slot(ctx, context);
+	if (!context || sample->context != context)
+		return;
+
+	if (success) {
+		time = ofi_gettime_ns() - sample->start;
+		latency = &ctx->latency[sample->api];
+		latency->count++;
+		latency->sum += time;
+		latency->max = MAX(latency->max, time);
+	}
+	sample->context = NULL;
+	ctx->samples_out--;
+}
+
+static inline void
+prof_add_xfer(struct profile_context *ctx, int cntr, size_t size,
+              fi_addr_t addr, void *context)
+{
+	prof_add_cntr(ctx, cntr, prof_size_bucket(size), size);
+	prof_add_peer(ctx, addr, size);
+	prof_sample(ctx, cntr, context);
+}
+
+static const size_t prof_cq_entry_size[] = {
+	[FI_CQ_FORMAT_UNSPEC] = 0,
+	[FI_CQ_FORMAT_CONTEXT] = sizeof(struct fi_cq_entry),
+	[FI_CQ_FORMAT_MSG] = sizeof(struct fi_cq_msg_entry),
+	[FI_CQ_FORMAT_DATA] = sizeof(struct fi_cq_data_entry),
+	[FI_CQ_FORMAT_TAGGED] = sizeof(struct fi_cq_tagged_entry),
+};
+
 static inline void
 prof_add_cq_cntr(struct profile_context *ctx, int cntr,
                  enum fi_cq_format format, void *buf, int ret)
 {
+	struct fi_cq_entry *entry;
 	uint64_t len;
 	for (int i = 0; i < ret; i++) {
 		if (get_cq_entry[format](buf, i, &cntr, &len))
 			prof_add_cntr(ctx, cntr, prof_size_bucket(len), len);
 	}
+
+	if (!ctx->samples_out || format == FI_CQ_FORMAT_UNSPEC)
+		return;
+
+	/* op_context is the first field of every cq entry format */
+	for (int i = 0; i < ret; i++) {
+		entry = (struct fi_cq_entry *) ((char *) buf +
+		        i * prof_cq_entry_size[format]);
+		prof_sample_done(ctx, entry->op_context, true);
+	}
 }
 
 /*
@@ -183,6 +286,7 @@ profile_recv(struct fid_ep *ep, void *buf, size_t len, void *desc,
 	ret = fi_recv(myep->hep, buf, len, desc, src_addr, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_recv, 0, PROF_IGNORE_SIZE);
+		prof_sample(profile_ctx(myep), prof_recv, context);
 	}
 	return ret;
 }
@@ -197,6 +301,7 @@ profile_recvv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	ret = fi_recvv(myep->hep, iov, desc, count, src_addr, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_recvv, 0, PROF_IGNORE_SIZE);
+		prof_sample(profile_ctx(myep), prof_recvv, context);
 	}
 	return ret;
 }
@@ -210,6 +315,7 @@ profile_recvmsg(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags)
 	ret = fi_recvmsg(myep->hep, msg, flags);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_recvmsg, 0, PROF_IGNORE_SIZE);
+		prof_sample(profile_ctx(myep), prof_recvmsg, msg->context);
 	}
 
 	return ret;
@@ -224,8 +330,8 @@ profile_send(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 
 	ret = fi_send(myep->hep, buf, len, desc, dest_addr, context);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_send,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_send, len,
+		              dest_addr, context);
 	}
 
 	return ret;
@@ -242,8 +348,8 @@ profile_sendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	ret = fi_sendv(myep->hep, iov, desc, count, dest_addr, context);
 	if (!ret) {
 		len = ofi_total_iov_len(iov, count);
-		prof_add_cntr(profile_ctx(myep), prof_sendv,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_sendv, len,
+		              dest_addr, context);
 	}
 
 	return ret;
@@ -259,8 +365,8 @@ profile_sendmsg(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags)
 	ret = fi_sendmsg(myep->hep, msg, flags);
 	if (!ret) {
 		len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
-		prof_add_cntr(profile_ctx(myep), prof_sendmsg,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_sendmsg, len,
+		              msg->addr, msg->context);
 	}
 
 	return ret;
@@ -275,8 +381,8 @@ profile_inject(struct fid_ep *ep, const void *buf, size_t len,
 
 	ret = fi_inject(myep->hep, buf, len, dest_addr);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_inject,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_inject, len,
+		              dest_addr, NULL);
 	}
 
 	return ret;
@@ -291,8 +397,8 @@ profile_senddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 
 	ret = fi_senddata(myep->hep, buf, len, desc, data, dest_addr, context);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_senddata,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_senddata, len,
+		              dest_addr, context);
 
 	}
 
@@ -308,8 +414,8 @@ profile_injectdata(struct fid_ep *ep, const void *buf, size_t len,
 
 	ret = fi_injectdata(myep->hep, buf, len, data, dest_addr);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_injectdata,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_injectdata, len,
+		              dest_addr, NULL);
 	}
 
 	return ret;
@@ -338,8 +444,8 @@ profile_read(struct fid_ep *ep, void *buf, size_t len, void *desc,
 
 	ret = fi_read(myep->hep, buf, len, desc, src_addr, addr, key, context);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_read,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_read, len,
+		              src_addr, context);
 	}
 
 	return ret;
@@ -358,8 +464,8 @@ profile_readv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	               addr, key, context);
 	if (!ret) {
 		len = ofi_total_iov_len(iov, count);
-		prof_add_cntr(profile_ctx(myep), prof_readv,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_readv, len,
+		              src_addr, context);
 	}
 
 	return ret;
@@ -376,8 +482,8 @@ profile_readmsg(struct fid_ep *ep, const struct fi_msg_rma *msg,
 	ret = fi_readmsg(myep->hep, msg, flags);
 	if (!ret) {
 		len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
-		prof_add_cntr(profile_ctx(myep), prof_readmsg,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_readmsg, len,
+		              msg->addr, msg->context);
 	}
 
 	return ret;
@@ -392,8 +498,8 @@ profile_write(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 
 	ret = fi_write(myep->hep, buf, len, desc, dest_addr, addr, key, context);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_write,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_write, len,
+		              dest_addr, context);
 	}
 
 	return ret;
@@ -412,8 +518,8 @@ profile_writev(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	                addr, key, context);
 	if (!ret) {
 		len =  ofi_total_iov_len(iov, count);
-		prof_add_cntr(profile_ctx(myep), prof_writev,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_writev, len,
+		              dest_addr, context);
 	}
 
 	return ret;
@@ -430,8 +536,8 @@ profile_writemsg(struct fid_ep *ep, const struct fi_msg_rma *msg,
 	ret = fi_writemsg(myep->hep, msg, flags);
 	if (!ret) {
 		len =  ofi_total_iov_len(msg->msg_iov, msg->iov_count);
-		prof_add_cntr(profile_ctx(myep), prof_writemsg,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_writemsg, len,
+		              msg->addr, msg->context);
 	}
 	return ret;
 }
@@ -445,8 +551,8 @@ profile_inject_write(struct fid_ep *ep, const void *buf, size_t len,
 
 	ret = fi_inject_write(myep->hep, buf, len, dest_addr, addr, key);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_inject_write,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_inject_write, len,
+		              dest_addr, NULL);
 	}
 
 	return ret;
@@ -463,8 +569,8 @@ profile_writedata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	ret = fi_writedata(myep->hep, buf, len, desc, data,
 	                   dest_addr, addr, key, context);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_writedata,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_writedata, len,
+		              dest_addr, context);
 	}
 
 	return ret;
@@ -481,8 +587,8 @@ profile_inject_writedata(struct fid_ep *ep, const void *buf, size_t len,
 	ret = fi_inject_writedata(myep->hep, buf, len, data, dest_addr,
 	                          addr, key);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_injectdata,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_injectdata, len,
+		              dest_addr, NULL);
 	}
 
 	return ret;
@@ -513,6 +619,7 @@ profile_trecv(struct fid_ep *ep, void *buf, size_t len, void *desc,
 	ret = fi_trecv(myep->hep, buf, len, desc, src_addr, tag, ignore, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_trecv, 0, PROF_IGNORE_SIZE);
+		prof_sample(profile_ctx(myep), prof_trecv, context);
 	}
 
 	return ret;
@@ -530,6 +637,7 @@ profile_trecvv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	                tag, ignore, context);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_trecvv, 0, PROF_IGNORE_SIZE);
+		prof_sample(profile_ctx(myep), prof_trecvv, context);
 	}
 
 	return ret;
@@ -545,6 +653,7 @@ profile_trecvmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 	ret = fi_trecvmsg(myep->hep, msg, flags);
 	if (!ret) {
 		prof_add_cntr(profile_ctx(myep), prof_trecvmsg, 0, PROF_IGNORE_SIZE);
+		prof_sample(profile_ctx(myep), prof_trecvmsg, msg->context);
 	}
 
 	return ret;
@@ -559,8 +668,8 @@ profile_tsend(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 
 	ret = fi_tsend(myep->hep, buf, len, desc, dest_addr, tag, context);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_tsend,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_tsend, len,
+		              dest_addr, context);
 	}
 
 	return ret;
@@ -578,8 +687,8 @@ profile_tsendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	ret = fi_tsendv(myep->hep, iov, desc, count, dest_addr, tag, context);
 	if (!ret) {
 		len = ofi_total_iov_len(iov, count);
-		prof_add_cntr(profile_ctx(myep), prof_tsendv,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_tsendv, len,
+		              dest_addr, context);
 	}
 
 	return ret;
@@ -596,8 +705,8 @@ profile_tsendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 	ret = fi_tsendmsg(myep->hep, msg, flags);
 	if (!ret) {
 		len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
-		prof_add_cntr(profile_ctx(myep), prof_tsendmsg,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_tsendmsg, len,
+		              msg->addr, msg->context);
 	}
 
 	return ret;
@@ -612,8 +721,8 @@ profile_tinject(struct fid_ep *ep, const void *buf, size_t len,
 
 	ret = fi_tinject(myep->hep, buf, len, dest_addr, tag);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_tinject,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_tinject, len,
+		              dest_addr, NULL);
 	}
 
 	return ret;
@@ -630,8 +739,8 @@ profile_tsenddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	ret = fi_tsenddata(myep->hep, buf, len, desc, data,
 	                   dest_addr, tag, context);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_tsenddata,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_tsenddata, len,
+		              dest_addr, context);
 	}
 
 	return ret;
@@ -646,8 +755,8 @@ profile_tinjectdata(struct fid_ep *ep, const void *buf, size_t len,
 
 	ret = fi_tinjectdata(myep->hep, buf, len, data, dest_addr, tag);
 	if (!ret) {
-		prof_add_cntr(profile_ctx(myep), prof_tinjectdata,
-		              prof_size_bucket(len), len);
+		prof_add_xfer(profile_ctx(myep), prof_tinjectdata, len,
+		              dest_addr, NULL);
 	}
 
 	return ret;
@@ -700,6 +809,8 @@ profile_cq_readerr(struct fid_cq *cq, struct fi_cq_err_entry *buf, uint64_t flag
 	ssize_t ret;
 
 	ret = fi_cq_readerr(mycq->hcq, buf, flags);
+	if (ret > 0 && profile_ctx_cq(mycq)->samples_out)
+		prof_sample_done(profile_ctx_cq(mycq), buf->op_context, false);
 
 	return ret;
 }
@@ -822,12 +933,99 @@ static int profile_domain_init(struct fid *fid)
 	return 0;
 }
 
+/*
+ * Map the counters from a file named after the dump_file prefix, the pid
+ * and the fabric, so they can be read while the application runs.
+ */
+static void *prof_map_file(struct profile_context *ctx, size_t size)
+{
+	static ofi_atomic32_t fabric_cnt;
+	char path[PATH_MAX];
+	void *addr;
+
+	snprintf(path, sizeof(path), "%s.%d.%d", prof_dump_file, getpid(),
+	         ofi_atomic_inc32(&fabric_cnt) - 1);
+	ctx->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (ctx->fd < 0)
+		goto err;
+
+	if (ftruncate(ctx->fd, size))
+		goto err;
+
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ctx->fd, 0);
+	if (addr == MAP_FAILED)
+		goto err;
+
+	return addr;
+err:
+	FI_WARN(ctx->hprov, FI_LOG_CORE, "unable to map profile file %s: %s\n",
+	        path, strerror(errno));
+	if (ctx->fd >= 0)
+		close(ctx->fd);
+	ctx->fd = -1;
+	return NULL;
+}
+
+static int prof_ctx_init(struct profile_context *ctx,
+                         const struct fi_provider *hprov)
+{
+	char *region;
+	size_t size;
+
+	ctx->hprov = hprov;
+	ctx->fd = -1;
+	ctx->sample_rate = prof_sample_rate;
+	ctx->peer_cnt = prof_peer_cnt;
+
+	size = sizeof(*ctx->hdr) +
+	       sizeof(*ctx->data) * prof_api_size +
+	       sizeof(*ctx->latency) * prof_api_size +
+	       (ctx->peer_cnt ? sizeof(*ctx->peers) * (ctx->peer_cnt + 1) : 0);
+
+	region = prof_dump_file ? prof_map_file(ctx, size) : NULL;
+	if (!region) {
+		region = calloc(1, size);
+		if (!region)
+			return -FI_ENOMEM;
+	}
+
+	ctx->hdr = (struct profile_file_hdr *) region;
+	ctx->hdr_size = size;
+	ctx->data = (struct profile_data *) (ctx->hdr + 1);
+	ctx->latency = (struct profile_latency *) (ctx->data + prof_api_size);
+	if (ctx->peer_cnt)
+		ctx->peers = (struct profile_peer *)
+			     (ctx->latency + prof_api_size);
+
+	ctx->hdr->api_size = prof_api_size;
+	ctx->hdr->size_max = PROF_SIZE_MAX;
+	ctx->hdr->peer_cnt = ctx->peer_cnt;
+	ctx->hdr->version = PROF_FILE_VERSION;
+	ctx->hdr->magic = PROF_FILE_MAGIC;
+	return 0;
+}
+
+static void prof_ctx_cleanup(struct profile_context *ctx)
+{
+	if (ctx->fd >= 0) {
+		munmap(ctx->hdr, ctx->hdr_size);
+		close(ctx->fd);
+	} else {
+		free(ctx->hdr);
+	}
+}
+
 static int hook_profile_close(struct fid *fid)
 {
 	struct profile_context *ctx = 
 		&(container_of(fid, struct profile_fabric, fabric_hook)->prof_ctx);
 
 	prof_report(ctx->hprov, ctx->data);
+	if (ctx->sample_rate)
+		prof_report_latency(ctx->hprov, ctx->latency);
+	if (ctx->peers)
+		prof_report_peers(ctx->hprov, ctx->peers, ctx->peer_cnt);
+	prof_ctx_cleanup(ctx);
 
 	hook_close(fid);
 	return FI_SUCCESS;
@@ -855,8 +1053,10 @@ hook_profile_fabric(struct fi_fabric_attr *attr,
 	if (!fab)
 		return -FI_ENOMEM;
 
-	fab->prof_ctx.hprov = hprov;
-	memset(&fab->prof_ctx.data, 0, sizeof (fab->prof_ctx.data));
+	if (prof_ctx_init(&fab->prof_ctx, hprov)) {
+		free(fab);
+		return -FI_ENOMEM;
+	}
 	hook_fabric_init(&fab->fabric_hook, HOOK_PROFILE, attr->fabric, hprov,
 	                 &profile_fabric_fid_ops, &hook_profile_ctx);
 	*fabric = &fab->fabric_hook.fabric;
@@ -893,8 +1093,33 @@ static int profile_ep_init(struct fid *fid)
 	return 0;
 }
 
+int prof_sample_rate;
+size_t prof_peer_cnt;
+char *prof_dump_file;
+
 HOOK_PROFILE_INI
 {
+	fi_param_define(&hook_profile_ctx.prov, "sample_rate", FI_PARAM_INT,
+	                "Time 1 in N data transfer operations from post to "
+	                "completion, set to 0 to disable (default: %d)",
+	                prof_sample_rate);
+	fi_param_get_int(&hook_profile_ctx.prov, "sample_rate",
+	                 &prof_sample_rate);
+	if (prof_sample_rate < 0)
+		prof_sample_rate = 0;
+
+	fi_param_define(&hook_profile_ctx.prov, "peers", FI_PARAM_SIZE_T,
+	                "Number of destination fi_addr_t values to count "
+	                "transmit traffic for, set to 0 to disable "
+	                "(default: %zu)", prof_peer_cnt);
+	fi_param_get_size_t(&hook_profile_ctx.prov, "peers", &prof_peer_cnt);
+
+	fi_param_define(&hook_profile_ctx.prov, "dump_file", FI_PARAM_STRING,
+	                "Prefix of a file the counters are kept in while the "
+	                "application runs, suffixed with the pid and fabric "
+	                "number (default: none)");
+	fi_param_get_str(&hook_profile_ctx.prov, "dump_file", &prof_dump_file);
+
 	hook_profile_ctx.ini_fid[FI_CLASS_DOMAIN] = profile_domain_init;
 	hook_profile_ctx.ini_fid[FI_CLASS_CQ] = profile_cq_init;
 	hook_profile_ctx.ini_fid[FI_CLASS_EP] = profile_ep_init;
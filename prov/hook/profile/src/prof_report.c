@@ -238,3 +238,69 @@ void prof_report(const struct fi_provider *prov,  struct profile_data *data)
 	prof_log_apis(prov, "MR REG", "Iface", "mr reg", PROF_HMEM_IFACE_MAX,
 	                data, PROF_MR_API_START, PROF_MR_API_END, &with_title);
 }
+
+void prof_report_latency(const struct fi_provider *prov,
+                         struct profile_latency *latency)
+{
+	char str1[PROF_STR_LEN];
+	char str2[PROF_STR_LEN];
+	char str3[PROF_STR_LEN];
+	bool with_title = true;
+
+	for (int i = 0; i < prof_api_size; i++) {
+		if (!latency[i].count)
+			continue;
+
+		if (with_title) {
+			FI_TRACE(prov, FI_LOG_CORE, PROF_OUTPUT_FORMAT,
+			         "SAMPLED", "API", "Count", "Avg (us)",
+			         "Max (us)", "");
+			with_title = false;
+		}
+		str1[0] = '\0';
+		snprintf(str2, sizeof(str2), "%.2f",
+		         latency[i].sum / 1000.0 / latency[i].count);
+		snprintf(str3, sizeof(str3), "%.2f", latency[i].max / 1000.0);
+		FI_TRACE(prov, FI_LOG_CORE, PROF_OUTPUT_FORMAT, "",
+		         prof_api_disp_str[i],
+		         ofi_tostr_count(str1, sizeof(str1), latency[i].count),
+		         str2, str3, "");
+	}
+	if (!with_title)
+		FI_TRACE(prov, FI_LOG_CORE, "\n");
+}
+
+/* Entry peer_cnt counts the destinations at or above peer_cnt */
+void prof_report_peers(const struct fi_provider *prov,
+                       struct profile_peer *peers, size_t peer_cnt)
+{
+	char name[PROF_STR_LEN];
+	uint64_t count = 0;
+	uint64_t amount = 0;
+	bool with_title = true;
+
+	for (size_t i = 0; i <= peer_cnt; i++) {
+		count += peers[i].count;
+		amount += peers[i].sum;
+	}
+
+	for (size_t i = 0; i <= peer_cnt; i++) {
+		if (!peers[i].count)
+			continue;
+
+		if (with_title) {
+			FI_TRACE(prov, FI_LOG_CORE, PROF_OUTPUT_FORMAT,
+			         "PEER", "fi_addr", "Count", "Amount",
+			         "% Count", "% Amount");
+			with_title = false;
+		}
+		if (i < peer_cnt)
+			snprintf(name, sizeof(name), "%zu", i);
+		else
+			snprintf(name, sizeof(name), "other");
+		prof_log_data(prov, "", name, peers[i].count, peers[i].sum,
+		              count, amount);
+	}
+	if (!with_title)
+		FI_TRACE(prov, FI_LOG_CORE, "\n");
+}
@@ -32,8 +32,14 @@
 #include "ofi_hook.h"
 #include "ofi_prov.h"
 #include "ofi_iov.h"
+#include "ofi_trace_rec.h"
 #include <config.h>
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
 #include <rdma/fi_profile.h>
 struct hook_trace_ep {
 	struct hook_ep hook_ep;
@@ -218,8 +224,152 @@ static void hook_trace_prof_init(void *context)
 				"addr", addr);	\
 	}
 
-#define TRACE_EP_MSG(ret, ep, buf, len, addr, data, flags, context) \
+/*
+ * Binary records: when FI_OFI_HOOK_TRACE_RECORD_FILE is set, every thread
+ * appends compact records to a ring mapped from its own file.  The cost
+ * of a record is a clock read and a few stores, so it can stay enabled at
+ * full message rates.  See ofi_trace_rec.h for the file format.
+ */
+struct trace_ring {
+	struct ofi_trace_hdr	*hdr;
+	struct ofi_trace_rec	*rec;
+	size_t			size;
+	int			fd;
+};
+
+extern struct hook_prov_ctx hook_trace_ctx;
+
+static char *trace_rec_file;
+static size_t trace_rec_cnt = 1 << 16;
+static pthread_key_t trace_ring_key;
+static ofi_atomic32_t trace_thread_cnt;
+
+/* Marks threads whose file could not be mapped */
+static struct trace_ring trace_ring_none;
+
+static void trace_ring_close(void *arg)
+{
+	struct trace_ring *ring = arg;
+
+	if (ring == &trace_ring_none)
+		return;
+
+	munmap(ring->hdr, ring->size);
+	close(ring->fd);
+	free(ring);
+}
+
+static struct trace_ring *trace_ring_open(void)
+{
+	struct trace_ring *ring;
+	char path[PATH_MAX], host[sizeof(ring->hdr->host)] = "";
+	int thread;
+
+	thread = ofi_atomic_inc32(&trace_thread_cnt) - 1;
+	gethostname(host, sizeof(host) - 1);
+	snprintf(path, sizeof(path), "%s.%s.%d.%d", trace_rec_file, host,
+		 getpid(), thread);
+
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		goto err1;
+
+	ring->size = sizeof(*ring->hdr) + sizeof(*ring->rec) * trace_rec_cnt;
+	ring->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (ring->fd < 0)
+		goto err2;
+
+	if (ftruncate(ring->fd, ring->size))
+		goto err3;
+
+	ring->hdr = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 ring->fd, 0);
+	if (ring->hdr == MAP_FAILED)
+		goto err3;
+
+	ring->rec = (struct ofi_trace_rec *) (ring->hdr + 1);
+	ring->hdr->version = OFI_TRACE_VERSION;
+	ring->hdr->rec_size = sizeof(*ring->rec);
+	ring->hdr->pid = getpid();
+	ring->hdr->thread = thread;
+	ring->hdr->capacity = trace_rec_cnt;
+	ring->hdr->start_time = ofi_gettime_ns();
+	memcpy(ring->hdr->host, host, sizeof(host));
+	ring->hdr->magic = OFI_TRACE_MAGIC;
+
+	pthread_setspecific(trace_ring_key, ring);
+	return ring;
+
+err3:
+	close(ring->fd);
+err2:
+	free(ring);
+err1:
+	FI_WARN(&hook_trace_ctx.prov, FI_LOG_CORE,
+		"unable to map trace file %s: %s\n", path, strerror(errno));
+	pthread_setspecific(trace_ring_key, &trace_ring_none);
+	return &trace_ring_none;
+}
+
+static inline void
+trace_record(enum ofi_trace_op op, size_t len, fi_addr_t peer,
+	     void *context, int err)
+{
+	struct trace_ring *ring;
+	struct ofi_trace_rec *rec;
+
+	if (!trace_rec_file)
+		return;
+
+	ring = pthread_getspecific(trace_ring_key);
+	if (!ring)
+		ring = trace_ring_open();
+	if (!ring->hdr)
+		return;
+
+	rec = &ring->rec[ring->hdr->head & (ring->hdr->capacity - 1)];
+	rec->time = ofi_gettime_ns();
+	rec->context = (uintptr_t) context;
+	rec->len = len;
+	rec->peer = peer < OFI_TRACE_PEER_UNSPEC ?
+		    (uint32_t) peer : OFI_TRACE_PEER_UNSPEC;
+	rec->op = op;
+	rec->err = err;
+	ring->hdr->head++;
+}
+
+static const size_t trace_cq_entry_size[] = {
+	[FI_CQ_FORMAT_UNSPEC] = 0,
+	[FI_CQ_FORMAT_CONTEXT] = sizeof(struct fi_cq_entry),
+	[FI_CQ_FORMAT_MSG] = sizeof(struct fi_cq_msg_entry),
+	[FI_CQ_FORMAT_DATA] = sizeof(struct fi_cq_data_entry),
+	[FI_CQ_FORMAT_TAGGED] = sizeof(struct fi_cq_tagged_entry),
+};
+
+/* All CQ formats start with the context, and all but one with the length */
+static inline void
+trace_cq_record(struct hook_cq *cq, ssize_t count, void *buf,
+		fi_addr_t *src_addr)
+{
+	struct fi_cq_msg_entry *entry;
+	ssize_t i;
+
+	if (!trace_rec_file || !trace_cq_entry_size[cq->format])
+		return;
+
+	for (i = 0; i < count; i++) {
+		entry = (struct fi_cq_msg_entry *) ((char *) buf +
+			i * trace_cq_entry_size[cq->format]);
+		trace_record(OFI_TRACE_COMP,
+			     cq->format == FI_CQ_FORMAT_CONTEXT ? 0 : entry->len,
+			     src_addr ? src_addr[i] : FI_ADDR_UNSPEC,
+			     entry->op_context, 0);
+	}
+}
+
+#define TRACE_EP_MSG(op, ret, ep, buf, len, addr, data, flags, context) \
 	if (!(ret)) { \
+		trace_record(op, len, addr, context, 0); \
 		FI_TRACE((ep)->domain->fabric->hprov, FI_LOG_EP_DATA, \
 			"buf %p len %zu addr %zu data %lu " \
 			"flags 0x%zx ctx %p\n", \
@@ -227,8 +377,9 @@ static void hook_trace_prof_init(void *context)
 			(uint64_t)flags, context); \
 	}
 
-#define TRACE_EP_RMA(ret, ep, buf, len, addr, raddr, data, flags, key, context) \
+#define TRACE_EP_RMA(op, ret, ep, buf, len, addr, raddr, data, flags, key, context) \
 	if (!(ret)) { \
+		trace_record(op, len, addr, context, 0); \
 		FI_TRACE((ep)->domain->fabric->hprov, FI_LOG_EP_DATA, \
 			"buf %p len %zu addr %zu raddr %lu data %lu " \
 			"flags 0x%zx key 0x%zx ctx %p\n", \
@@ -236,8 +387,9 @@ static void hook_trace_prof_init(void *context)
 			(uint64_t)flags, (uint64_t)key, context); \
 	}
 
-#define TRACE_EP_TAGGED(ret, ep, buf, len, addr, data, flags, tag, ignore, context) \
+#define TRACE_EP_TAGGED(op, ret, ep, buf, len, addr, data, flags, tag, ignore, context) \
 	if (!(ret)) { \
+		trace_record(op, len, addr, context, 0); \
 		FI_TRACE((ep)->domain->fabric->hprov, FI_LOG_EP_DATA, \
 			"buf %p len %zu addr %zu data %lu " \
 			"flags 0x%zx tag 0x%lx ignore 0x%zx ctx %p\n", \
@@ -615,7 +767,7 @@ trace_recv(struct fid_ep *ep, void *buf, size_t len, void *desc,
 	ssize_t ret;
 
 	ret = fi_recv(myep->hep, buf, len, desc, src_addr, context);
-	TRACE_EP_MSG(ret, myep, buf, len, src_addr, 0, 0, context);
+	TRACE_EP_MSG(OFI_TRACE_RECV, ret, myep, buf, len, src_addr, 0, 0, context);
 
 	return ret;
 }
@@ -628,7 +780,7 @@ trace_recvv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	ssize_t ret;
 
 	ret = fi_recvv(myep->hep, iov, desc, count, src_addr, context);
-	TRACE_EP_MSG(ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
+	TRACE_EP_MSG(OFI_TRACE_RECV, ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
 		     src_addr, 0, 0, context);
 
 	return ret;
@@ -641,7 +793,7 @@ trace_recvmsg(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags)
 	ssize_t ret;
 
 	ret = fi_recvmsg(myep->hep, msg, flags);
-	TRACE_EP_MSG(ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
+	TRACE_EP_MSG(OFI_TRACE_RECV, ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
 		     IOV_LEN(msg->msg_iov, msg->iov_count), msg->addr,
 		     flags & FI_REMOTE_CQ_DATA ? msg->data : 0,
 		     flags, msg->context);
@@ -657,7 +809,7 @@ trace_send(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	ssize_t ret;
 
 	ret = fi_send(myep->hep, buf, len, desc, dest_addr, context);
-	TRACE_EP_MSG(ret, myep, buf, len, dest_addr, 0, 0, context);
+	TRACE_EP_MSG(OFI_TRACE_SEND, ret, myep, buf, len, dest_addr, 0, 0, context);
 
 	return ret;
 }
@@ -670,7 +822,7 @@ trace_sendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	ssize_t ret;
 
 	ret = fi_sendv(myep->hep, iov, desc, count, dest_addr, context);
-	TRACE_EP_MSG(ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
+	TRACE_EP_MSG(OFI_TRACE_SEND, ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
 		     dest_addr, 0, 0, context);
 
 	return ret;
@@ -683,7 +835,7 @@ trace_sendmsg(struct fid_ep *ep, const struct fi_msg *msg, uint64_t flags)
 	ssize_t ret;
 
 	ret = fi_sendmsg(myep->hep, msg, flags);
-	TRACE_EP_MSG(ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
+	TRACE_EP_MSG(OFI_TRACE_SEND, ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
 		     IOV_LEN(msg->msg_iov, msg->iov_count), msg->addr,
 		     MSG_DATA(msg->data, flags), flags, msg->context);
 
@@ -698,7 +850,7 @@ trace_inject(struct fid_ep *ep, const void *buf, size_t len,
 	ssize_t ret;
 
 	ret = fi_inject(myep->hep, buf, len, dest_addr);
-	TRACE_EP_MSG(ret, myep, buf, len, dest_addr, 0, 0, NULL);
+	TRACE_EP_MSG(OFI_TRACE_INJECT, ret, myep, buf, len, dest_addr, 0, 0, NULL);
 
 	return ret;
 }
@@ -711,7 +863,7 @@ trace_senddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	ssize_t ret;
 
 	ret = fi_senddata(myep->hep, buf, len, desc, data, dest_addr, context);
-	TRACE_EP_MSG(ret, myep, buf, len, dest_addr, data, 0, context);
+	TRACE_EP_MSG(OFI_TRACE_SEND, ret, myep, buf, len, dest_addr, data, 0, context);
 
 	return ret;
 }
@@ -724,7 +876,7 @@ trace_injectdata(struct fid_ep *ep, const void *buf, size_t len,
 	ssize_t ret;
 
 	ret = fi_injectdata(myep->hep, buf, len, data, dest_addr);
-	TRACE_EP_MSG(ret, myep, buf, len, dest_addr, data, 0,  NULL);
+	TRACE_EP_MSG(OFI_TRACE_INJECT, ret, myep, buf, len, dest_addr, data, 0,  NULL);
 
 	return ret;
 }
@@ -751,7 +903,7 @@ trace_read(struct fid_ep *ep, void *buf, size_t len, void *desc,
 	ssize_t ret;
 
 	ret = fi_read(myep->hep, buf, len, desc, src_addr, addr, key, context);
-	TRACE_EP_RMA(ret, myep, buf, len, src_addr, addr, 0, 0, key, context);
+	TRACE_EP_RMA(OFI_TRACE_READ, ret, myep, buf, len, src_addr, addr, 0, 0, key, context);
 
 	return ret;
 }
@@ -766,7 +918,7 @@ trace_readv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 
 	ret = fi_readv(myep->hep, iov, desc, count, src_addr,
 		       addr, key, context);
-	TRACE_EP_RMA(ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
+	TRACE_EP_RMA(OFI_TRACE_READ, ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
 		     src_addr, addr, 0, 0, key, context);
 
 	return ret;
@@ -779,7 +931,7 @@ trace_readmsg(struct fid_ep *ep, const struct fi_msg_rma *msg, uint64_t flags)
 	ssize_t ret;
 
 	ret = fi_readmsg(myep->hep, msg, flags);
-	TRACE_EP_RMA(ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
+	TRACE_EP_RMA(OFI_TRACE_READ, ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
 		     IOV_LEN(msg->msg_iov, msg->iov_count), msg->addr,
 		     msg->rma_iov_count ? msg->rma_iov[0].addr : 0,
 		     MSG_DATA(msg->data, flags), flags,
@@ -798,7 +950,7 @@ trace_write(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 
 	ret = fi_write(myep->hep, buf, len, desc, dest_addr,
 		       addr, key, context);
-	TRACE_EP_RMA(ret, myep, buf, len, dest_addr, addr, 0, 0, key, context);
+	TRACE_EP_RMA(OFI_TRACE_WRITE, ret, myep, buf, len, dest_addr, addr, 0, 0, key, context);
 
 	return ret;
 }
@@ -813,7 +965,7 @@ trace_writev(struct fid_ep *ep, const struct iovec *iov, void **desc,
 
 	ret = fi_writev(myep->hep, iov, desc, count, dest_addr,
 			addr, key, context);
-	TRACE_EP_RMA(ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
+	TRACE_EP_RMA(OFI_TRACE_WRITE, ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
 		     dest_addr, addr, 0, 0, key, context);
 
 	return ret;
@@ -826,7 +978,7 @@ trace_writemsg(struct fid_ep *ep, const struct fi_msg_rma *msg, uint64_t flags)
 	ssize_t ret;
 
 	ret = fi_writemsg(myep->hep, msg, flags);
-	TRACE_EP_RMA(ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
+	TRACE_EP_RMA(OFI_TRACE_WRITE, ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
 		     IOV_LEN(msg->msg_iov, msg->iov_count), msg->addr,
 		     msg->rma_iov_count ? msg->rma_iov[0].addr : 0,
 		     MSG_DATA(msg->data, flags), flags,
@@ -844,7 +996,7 @@ trace_inject_write(struct fid_ep *ep, const void *buf, size_t len,
 	ssize_t ret;
 
 	ret = fi_inject_write(myep->hep, buf, len, dest_addr, addr, key);
-	TRACE_EP_RMA(ret, myep, buf, len, dest_addr, addr, 0, 0, key, NULL);
+	TRACE_EP_RMA(OFI_TRACE_INJECT_WRITE, ret, myep, buf, len, dest_addr, addr, 0, 0, key, NULL);
 
 	return ret;
 }
@@ -859,7 +1011,7 @@ trace_writedata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 
 	ret = fi_writedata(myep->hep, buf, len, desc, data,
 			   dest_addr, addr, key, context);
-	TRACE_EP_RMA(ret, myep, buf, len, dest_addr, addr, data, 0, key, context);
+	TRACE_EP_RMA(OFI_TRACE_WRITE, ret, myep, buf, len, dest_addr, addr, data, 0, key, context);
 
 	return ret;
 }
@@ -874,7 +1026,7 @@ trace_inject_writedata(struct fid_ep *ep, const void *buf, size_t len,
 
 	ret = fi_inject_writedata(myep->hep, buf, len, data, dest_addr,
 				  addr, key);
-	TRACE_EP_RMA(ret, myep, buf, len, dest_addr, addr, data, 0, key, NULL);
+	TRACE_EP_RMA(OFI_TRACE_INJECT_WRITE, ret, myep, buf, len, dest_addr, addr, data, 0, key, NULL);
 
 	return ret;
 }
@@ -903,7 +1055,7 @@ trace_trecv(struct fid_ep *ep, void *buf, size_t len, void *desc,
 
 	ret = fi_trecv(myep->hep, buf, len, desc, src_addr,
 		       tag, ignore, context);
-	TRACE_EP_TAGGED(ret, myep, buf, len, src_addr, 0, 0, tag, ignore, context);
+	TRACE_EP_TAGGED(OFI_TRACE_TRECV, ret, myep, buf, len, src_addr, 0, 0, tag, ignore, context);
 
 	return ret;
 }
@@ -918,7 +1070,7 @@ trace_trecvv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 
 	ret = fi_trecvv(myep->hep, iov, desc, count, src_addr,
 			tag, ignore, context);
-	TRACE_EP_TAGGED(ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
+	TRACE_EP_TAGGED(OFI_TRACE_TRECV, ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
 			src_addr, 0, 0, tag, ignore, context);
 
 	return ret;
@@ -932,7 +1084,7 @@ trace_trecvmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 	ssize_t ret;
 
 	ret = fi_trecvmsg(myep->hep, msg, flags);
-	TRACE_EP_TAGGED(ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
+	TRACE_EP_TAGGED(OFI_TRACE_TRECV, ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
 			IOV_LEN(msg->msg_iov, msg->iov_count), msg->addr,
 			MSG_DATA(msg->data, flags), flags,
 			msg->tag, msg->ignore, msg->context);
@@ -948,7 +1100,7 @@ trace_tsend(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	ssize_t ret;
 
 	ret = fi_tsend(myep->hep, buf, len, desc, dest_addr, tag, context);
-	TRACE_EP_TAGGED(ret, myep, buf, len, dest_addr, 0, 0, tag, 0, context);
+	TRACE_EP_TAGGED(OFI_TRACE_TSEND, ret, myep, buf, len, dest_addr, 0, 0, tag, 0, context);
 
 	return ret;
 }
@@ -961,7 +1113,7 @@ trace_tsendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	ssize_t ret;
 
 	ret = fi_tsendv(myep->hep, iov, desc, count, dest_addr, tag, context);
-	TRACE_EP_TAGGED(ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
+	TRACE_EP_TAGGED(OFI_TRACE_TSEND, ret, myep, IOV_BASE(iov, count), IOV_LEN(iov, count),
 			dest_addr, 0, 0, tag, 0, context);
 
 	return ret;
@@ -975,7 +1127,7 @@ trace_tsendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 	ssize_t ret;
 
 	ret = fi_tsendmsg(myep->hep, msg, flags);
-	TRACE_EP_TAGGED(ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
+	TRACE_EP_TAGGED(OFI_TRACE_TSEND, ret, myep, IOV_BASE(msg->msg_iov, msg->iov_count),
 			IOV_LEN(msg->msg_iov, msg->iov_count), msg->addr,
 			MSG_DATA(msg->data, flags), flags,
 			msg->tag, 0, msg->context);
@@ -991,7 +1143,7 @@ trace_tinject(struct fid_ep *ep, const void *buf, size_t len,
 	ssize_t ret;
 
 	ret = fi_tinject(myep->hep, buf, len, dest_addr, tag);
-	TRACE_EP_TAGGED(ret, myep, buf, len, dest_addr, 0, 0, tag, 0, NULL);
+	TRACE_EP_TAGGED(OFI_TRACE_TINJECT, ret, myep, buf, len, dest_addr, 0, 0, tag, 0, NULL);
 
 	return ret;
 }
@@ -1006,7 +1158,7 @@ trace_tsenddata(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 
 	ret = fi_tsenddata(myep->hep, buf, len, desc, data,
 			   dest_addr, tag, context);
-	TRACE_EP_TAGGED(ret, myep, buf, len, dest_addr, data, 0, tag, 0, context);
+	TRACE_EP_TAGGED(OFI_TRACE_TSEND, ret, myep, buf, len, dest_addr, data, 0, tag, 0, context);
 
 	return ret;
 }
@@ -1019,7 +1171,7 @@ trace_tinjectdata(struct fid_ep *ep, const void *buf, size_t len,
 	ssize_t ret;
 
 	ret = fi_tinjectdata(myep->hep, buf, len, data, dest_addr, tag);
-	TRACE_EP_TAGGED(ret, myep, buf, len, dest_addr, data, 0, tag, 0, NULL);
+	TRACE_EP_TAGGED(OFI_TRACE_TINJECT, ret, myep, buf, len, dest_addr, data, 0, tag, 0, NULL);
 
 	return ret;
 }
@@ -1179,6 +1331,7 @@ static ssize_t trace_cq_read(struct fid_cq *cq, void *buf, size_t count)
 	ssize_t ret;
 
 	ret = fi_cq_read(mycq->hcq, buf, count);
+	trace_cq_record(mycq, ret, buf, NULL);
 	trace_cq(mycq, __func__, __LINE__, ret, buf, 0);
 	return ret;
 }
@@ -1190,8 +1343,11 @@ trace_cq_readerr(struct fid_cq *cq, struct fi_cq_err_entry *buf, uint64_t flags)
 	ssize_t ret;
 
 	ret = fi_cq_readerr(mycq->hcq, buf, flags);
-	if (ret > 0)
+	if (ret > 0) {
+		trace_record(OFI_TRACE_COMP_ERR, buf->len, FI_ADDR_UNSPEC,
+			     buf->op_context, buf->err);
 		trace_cq_err(mycq, __func__, __LINE__, buf, flags);
+	}
 	return ret;
 }
 
@@ -1202,6 +1358,7 @@ trace_cq_readfrom(struct fid_cq *cq, void *buf, size_t count, fi_addr_t *src_add
 	ssize_t ret;
 
 	ret = fi_cq_readfrom(mycq->hcq, buf, count, src_addr);
+	trace_cq_record(mycq, ret, buf, src_addr);
 	trace_cq(mycq, __func__, __LINE__, ret, buf, src_addr ? *src_addr : 0);
 	return ret;
 }
@@ -1214,6 +1371,7 @@ trace_cq_sread(struct fid_cq *cq, void *buf, size_t count,
 	ssize_t ret;
 
 	ret = fi_cq_sread(mycq->hcq, buf, count, cond, timeout);
+	trace_cq_record(mycq, ret, buf, NULL);
 	trace_cq(mycq, __func__, __LINE__, ret, buf, 0);
 	return ret;
 }
@@ -1226,6 +1384,7 @@ trace_cq_sreadfrom(struct fid_cq *cq, void *buf, size_t count,
 	ssize_t ret;
 
 	ret = fi_cq_sreadfrom(mycq->hcq, buf, count, src_addr, cond, timeout);
+	trace_cq_record(mycq, ret, buf, src_addr);
 	trace_cq(mycq, __func__, __LINE__, ret, buf, src_addr ? *src_addr : 0);
 	return ret;
 }
@@ -1625,5 +1784,23 @@ HOOK_TRACE_INI
 	hook_trace_ctx.ini_fid[FI_CLASS_DOMAIN] = trace_domain_init;
 	hook_trace_ctx.ini_fid[FI_CLASS_PEP] = trace_pep_init;
 
+	fi_param_define(&hook_trace_ctx.prov, "record_file", FI_PARAM_STRING,
+			"Path prefix of binary trace record files.  Each "
+			"thread writes to <record_file>.<host>.<pid>.<thread> "
+			"(default: none)");
+	fi_param_get_str(&hook_trace_ctx.prov, "record_file", &trace_rec_file);
+
+	fi_param_define(&hook_trace_ctx.prov, "record_count", FI_PARAM_SIZE_T,
+			"Number of records kept per thread, rounded up to a "
+			"power of two (default: 65536)");
+	fi_param_get_size_t(&hook_trace_ctx.prov, "record_count",
+			    &trace_rec_cnt);
+	trace_rec_cnt = roundup_power_of_two(MAX(trace_rec_cnt, 1));
+
+	if (trace_rec_file && pthread_key_create(&trace_ring_key,
+						 trace_ring_close))
+		trace_rec_file = NULL;
+	ofi_atomic_initialize32(&trace_thread_cnt, 0);
+
 	return &hook_trace_ctx.prov;
 }
@@ -79,7 +79,8 @@ extern size_t mrail_num_info;
 enum {
 	MRAIL_POLICY_FIXED,
 	MRAIL_POLICY_ROUND_ROBIN,
-	MRAIL_POLICY_STRIPING
+	MRAIL_POLICY_STRIPING,
+	MRAIL_POLICY_LEAST_LOADED
 };
 
 #define MRAIL_MAX_CONFIG		8
@@ -178,6 +179,8 @@ struct mrail_tx_buf {
 	struct mrail_rndv_hdr	rndv_hdr;
 	struct mrail_rndv_req	*rndv_req;
 	fid_t			rndv_mr_fid;
+	uint32_t		rail;
+	size_t			len;
 };
 
 struct mrail_pkt {
@@ -242,15 +245,20 @@ struct mrail_av {
 	size_t num_avs;
 };
 
+#define MRAIL_OOO_RING_MIN_SIZE	64
+
+struct mrail_ooo_recv;
+
 struct mrail_peer_info {
-	struct slist	ooo_recv_queue;
-	fi_addr_t	addr;
-	uint32_t	seq_no;
-	uint32_t	expected_seq_no;
+	/* early receives, indexed by seq_no & ooo_ring_mask */
+	struct mrail_ooo_recv	**ooo_ring;
+	uint32_t		ooo_ring_mask;
+	fi_addr_t		addr;
+	uint32_t		seq_no;
+	uint32_t		expected_seq_no;
 };
 
 struct mrail_ooo_recv {
-	struct slist_entry 		entry;
 	struct fi_cq_tagged_entry 	comp;
 	uint32_t 			seq_no;
 };
@@ -270,6 +278,10 @@ struct mrail_ep {
 	struct {
 		struct fid_ep 		*ep;
 		struct fi_info		*info;
+		/* bytes posted and not yet completed */
+		ofi_atomic64_t		tx_bytes;
+		/* link speed relative to the slowest rail */
+		uint64_t		weight;
 	}			*rails;
 	size_t			num_eps;
 	ofi_atomic32_t		tx_rail;
@@ -282,8 +294,11 @@ struct mrail_ep {
 
 	struct ofi_bufpool	*req_pool;
 	struct ofi_bufpool 	*ooo_recv_pool;
+	struct ofi_bufpool	*unexp_msg_pool;
 	struct ofi_bufpool 	*tx_buf_pool;
 	struct slist		deferred_reqs;
+	/* deliver receives in sequence order (FI_ORDER_SAS) */
+	int			ordered_recv;
 };
 
 struct mrail_addr_key {
@@ -377,12 +392,51 @@ static inline int mrail_get_policy(size_t size)
 	return mrail_config[i].policy;
 }
 
+/*
+ * Pick the rail with the fewest outstanding bytes for its bandwidth.  The
+ * search starts at the round-robin rail so that idle rails share ties.
+ */
+static inline size_t mrail_get_tx_rail_ll(struct mrail_ep *mrail_ep)
+{
+	size_t i, rail, start, best;
+	uint64_t bytes, best_bytes;
+
+	start = best = mrail_get_tx_rail_rr(mrail_ep);
+	best_bytes = ofi_atomic_get64(&mrail_ep->rails[best].tx_bytes);
+	for (i = 1; i < mrail_ep->num_eps && best_bytes; i++) {
+		rail = (start + i) % mrail_ep->num_eps;
+		bytes = ofi_atomic_get64(&mrail_ep->rails[rail].tx_bytes);
+		if (bytes * mrail_ep->rails[best].weight <
+		    best_bytes * mrail_ep->rails[rail].weight) {
+			best = rail;
+			best_bytes = bytes;
+		}
+	}
+	return best;
+}
+
 static inline size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep, int policy)
 {
-	return policy == MRAIL_POLICY_FIXED ?
-				mrail_ep->default_tx_rail :
-				mrail_get_tx_rail_rr(mrail_ep);
+	switch (policy) {
+	case MRAIL_POLICY_FIXED:
+		return mrail_ep->default_tx_rail;
+	case MRAIL_POLICY_LEAST_LOADED:
+		return mrail_get_tx_rail_ll(mrail_ep);
+	default:
+		return mrail_get_tx_rail_rr(mrail_ep);
+	}
+}
+
+static inline void mrail_rail_tx_start(struct mrail_ep *mrail_ep,
+				       uint32_t rail, size_t len)
+{
+	ofi_atomic_add64(&mrail_ep->rails[rail].tx_bytes, len);
+}
 
+static inline void mrail_rail_tx_done(struct mrail_ep *mrail_ep,
+				      uint32_t rail, size_t len)
+{
+	ofi_atomic_sub64(&mrail_ep->rails[rail].tx_bytes, len);
 }
 
 struct mrail_subreq {
@@ -393,6 +447,8 @@ struct mrail_subreq {
 	struct fi_rma_iov rma_iov[MRAIL_IOV_LIMIT];
 	size_t iov_count;
 	size_t rma_iov_count;
+	uint32_t rail;
+	size_t len;
 };
 
 struct mrail_req {
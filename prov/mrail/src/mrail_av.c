@@ -36,6 +36,8 @@ static int mrail_av_close(struct fid *fid)
 {
 	struct mrail_av *mrail_av = container_of(fid, struct mrail_av,
 						 util_av.av_fid);
+	struct mrail_peer_info *peer_info;
+	struct util_av_entry *entry, *tmp;
 	int ret, retv = 0;
 
 	ret = mrail_close_fids((struct fid **)mrail_av->avs, mrail_av->num_avs);
@@ -44,6 +46,11 @@ static int mrail_av_close(struct fid *fid)
 	free(mrail_av->avs);
 	free(mrail_av->rail_addrlen);
 
+	HASH_ITER(hh, mrail_av->util_av.hash, entry, tmp) {
+		peer_info = (struct mrail_peer_info *) entry->data;
+		free(peer_info->ooo_ring);
+	}
+
 	ret = ofi_av_close(&mrail_av->util_av);
 	if (ret)
 		retv = ret;
@@ -115,7 +122,6 @@ static int mrail_av_insert(struct fid_av *av_fid, const void *addr, size_t count
 	peer_info = calloc(1, mrail_av->util_av.addrlen);
 	if (!peer_info)
 		return -FI_ENOMEM;
-	slist_init(&peer_info->ooo_recv_queue);
 
 	for (i = 0; i < count; i++) {
 		offset = i * mrail_domain->addrlen;
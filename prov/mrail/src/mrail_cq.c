@@ -300,7 +300,7 @@ static struct mrail_recv *mrail_match_recv(struct mrail_ep *mrail_ep,
 		FI_DBG(&mrail_prov, FI_LOG_CQ, "Got MSG op\n");
 		recv = mrail_match_recv_handle_unexp(&mrail_ep->recv_queue, 0,
 						     src_addr, (char *)comp,
-						     sizeof(*comp), NULL);
+						     sizeof(*comp), mrail_ep);
 	} else {
 		assert(hdr->op == ofi_op_tagged);
 		FI_DBG(&mrail_prov, FI_LOG_CQ, "Got TAGGED op with tag: 0x%"
@@ -308,7 +308,7 @@ static struct mrail_recv *mrail_match_recv(struct mrail_ep *mrail_ep,
 		recv = mrail_match_recv_handle_unexp(&mrail_ep->trecv_queue,
 						     hdr->tag, src_addr,
 						     (char *)comp,
-						     sizeof(*comp), NULL);
+						     sizeof(*comp), mrail_ep);
 	}
 
 	return recv;
@@ -317,19 +317,21 @@ static struct mrail_recv *mrail_match_recv(struct mrail_ep *mrail_ep,
 static
 struct mrail_ooo_recv *mrail_get_next_recv(struct mrail_peer_info *peer_info)
 {
-	struct slist *queue = &peer_info->ooo_recv_queue;
+	struct mrail_ooo_recv **slot;
 	struct mrail_ooo_recv *ooo_recv;
 
-	if (!slist_empty(queue)) {
-		ooo_recv = container_of(queue->head, struct mrail_ooo_recv,
-				entry);
-		if (ooo_recv->seq_no == peer_info->expected_seq_no) {
-			slist_remove_head(queue);
-			peer_info->expected_seq_no++;
-			return ooo_recv;
-		}
+	if (!peer_info->ooo_ring)
+		return NULL;
+
+	slot = &peer_info->ooo_ring[peer_info->expected_seq_no &
+				    peer_info->ooo_ring_mask];
+	ooo_recv = *slot;
+	if (ooo_recv) {
+		assert(ooo_recv->seq_no == peer_info->expected_seq_no);
+		*slot = NULL;
+		peer_info->expected_seq_no++;
 	}
-	return NULL;
+	return ooo_recv;
 }
 
 static int mrail_process_ooo_recvs(struct mrail_ep *mrail_ep,
@@ -364,14 +366,36 @@ static int mrail_process_ooo_recvs(struct mrail_ep *mrail_ep,
 	return 0;
 }
 
-static int mrail_ooo_recv_before(struct slist_entry *item, const void *arg)
+/*
+ * Grow the out-of-order ring of a peer so that it holds seq_no, which is
+ * dist ahead of the expected one.  Saved receives are always less than
+ * the ring size ahead of expected_seq_no, so each has a slot of its own.
+ */
+static int mrail_grow_ooo_ring(struct mrail_peer_info *peer_info,
+			       uint32_t dist)
 {
-	struct mrail_ooo_recv *ooo_recv;
-	struct mrail_ooo_recv *new_recv;
+	struct mrail_ooo_recv **ring;
+	size_t size, old_size, i;
+
+	old_size = peer_info->ooo_ring ? peer_info->ooo_ring_mask + 1 : 0;
+	size = MAX(old_size, MRAIL_OOO_RING_MIN_SIZE);
+	while (size <= dist)
+		size <<= 1;
+
+	ring = calloc(size, sizeof(*ring));
+	if (!ring)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < old_size; i++) {
+		if (peer_info->ooo_ring[i])
+			ring[peer_info->ooo_ring[i]->seq_no & (size - 1)] =
+				peer_info->ooo_ring[i];
+	}
 
-	ooo_recv = container_of(item, struct mrail_ooo_recv, entry);
-	new_recv = container_of(arg, struct mrail_ooo_recv, entry);
-	return (new_recv->seq_no < ooo_recv->seq_no);
+	free(peer_info->ooo_ring);
+	peer_info->ooo_ring = ring;
+	peer_info->ooo_ring_mask = size - 1;
+	return 0;
 }
 
 /* Should only be called while holding the EP's lock */
@@ -380,8 +404,15 @@ static void mrail_save_ooo_recv(struct mrail_ep *mrail_ep,
 				uint32_t seq_no,
 				struct fi_cq_tagged_entry *comp)
 {
-	struct slist *queue = &peer_info->ooo_recv_queue;
 	struct mrail_ooo_recv *ooo_recv;
+	uint32_t dist = seq_no - peer_info->expected_seq_no;
+
+	if ((!peer_info->ooo_ring || dist > peer_info->ooo_ring_mask) &&
+	    mrail_grow_ooo_ring(peer_info, dist)) {
+		FI_WARN(&mrail_prov, FI_LOG_CQ, "Cannot grow ooo_recv ring\n");
+		assert(0);
+		return;
+	}
 
 	ooo_recv = ofi_buf_alloc(mrail_ep->ooo_recv_pool);
 	if (!ooo_recv) {
@@ -389,12 +420,11 @@ static void mrail_save_ooo_recv(struct mrail_ep *mrail_ep,
 		assert(0);
 		return;
 	}
-	ooo_recv->entry.next = NULL;
 	ooo_recv->seq_no = seq_no;
 	memcpy(&ooo_recv->comp, comp, sizeof(*comp));
 
-	slist_insert_before_first_match(queue, mrail_ooo_recv_before,
-					&ooo_recv->entry);
+	assert(!peer_info->ooo_ring[seq_no & peer_info->ooo_ring_mask]);
+	peer_info->ooo_ring[seq_no & peer_info->ooo_ring_mask] = ooo_recv;
 
 	FI_DBG(&mrail_prov, FI_LOG_CQ, "saved ooo_recv seq=%d\n", seq_no);
 }
@@ -433,6 +463,15 @@ static int mrail_handle_recv_completion(struct fi_cq_tagged_entry *comp,
 	    hdr->protocol_cmd == MRAIL_RNDV_ACK)
 		return mrail_cq_process_rndv_ack(comp);
 
+	if (!mrail_ep->ordered_recv) {
+		/* Without FI_ORDER_SAS the rails need not be reordered */
+		ofi_genlock_lock(&mrail_ep->util_ep.lock);
+		recv = mrail_match_recv(mrail_ep, comp, (int) src_addr);
+		ofi_genlock_unlock(&mrail_ep->util_ep.lock);
+		ret = recv ? mrail_cq_process_buf_recv(comp, recv) : 0;
+		goto exit;
+	}
+
 	seq_no = ntohl(hdr->seq);
 	peer_info = ofi_av_get_addr(mrail_ep->util_ep.av, (int) src_addr);
 	FI_DBG(&mrail_prov, FI_LOG_CQ,
@@ -517,6 +556,7 @@ static void mrail_handle_rma_completion(struct util_cq *cq,
 
 	subreq = comp->op_context;
 	req = subreq->parent;
+	mrail_rail_tx_done(req->mrail_ep, subreq->rail, subreq->len);
 
 	if (ofi_atomic_dec32(&req->expected_subcomps) == 0) {
 		if (req->comp.flags & MRAIL_RNDV_FLAG) {
@@ -578,6 +618,8 @@ void mrail_poll_cq(struct util_cq *cq)
 			mrail_handle_rma_completion(cq, &comp);
 		} else if (comp.flags & FI_SEND) {
 			tx_buf = comp.op_context;
+			mrail_rail_tx_done(tx_buf->ep, tx_buf->rail,
+					   tx_buf->len);
 			if (tx_buf->hdr.protocol == MRAIL_PROTO_RNDV) {
 				if (tx_buf->hdr.protocol_cmd == MRAIL_RNDV_REQ) {
 					/* buf will be freed when ACK comes */
@@ -214,6 +214,7 @@ mrail_recv_common(struct mrail_ep *mrail_ep, struct mrail_recv_queue *recv_queue
 {
 	struct mrail_recv *recv;
 	struct mrail_unexp_msg_entry *unexp_msg_entry;
+	ssize_t ret;
 
 	recv = mrail_pop_recv(mrail_ep);
 	if (!recv)
@@ -253,8 +254,13 @@ mrail_recv_common(struct mrail_ep *mrail_ep, struct mrail_recv_queue *recv_queue
 	       "0x%" PRIx64 " found in unexpected msg queue\n",
 	       recv->addr, recv->tag, recv->ignore);
 
-	return mrail_cq_process_buf_recv((struct fi_cq_tagged_entry *)
-					 unexp_msg_entry->data, recv);
+	ret = mrail_cq_process_buf_recv((struct fi_cq_tagged_entry *)
+					unexp_msg_entry->data, recv);
+
+	ofi_genlock_lock(&mrail_ep->util_ep.lock);
+	ofi_buf_free(unexp_msg_entry);
+	ofi_genlock_unlock(&mrail_ep->util_ep.lock);
+	return ret;
 }
 
 static ssize_t mrail_recv(struct fid_ep *ep_fid, void *buf, size_t len,
@@ -377,6 +383,9 @@ int mrail_send_rndv_ack_blocking(struct mrail_ep *mrail_ep,
 	if (iov_dest.iov_len < mrail_ep->rails[i].info->tx_attr->inject_size)
 		flags |= FI_INJECT;
 
+	tx_buf->rail = i;
+	tx_buf->len = iov_dest.iov_len;
+
 	FI_DBG(&mrail_prov, FI_LOG_EP_DATA, "Posting rdnv ack "
 	       " dest_addr: 0x%" PRIx64 " on rail: %d\n", dest_addr, i);
 
@@ -394,6 +403,8 @@ int mrail_send_rndv_ack_blocking(struct mrail_ep *mrail_ep,
 		FI_WARN(&mrail_prov, FI_LOG_EP_DATA,
 			"Unable to fi_sendmsg on rail: %" PRIu32 "\n", i);
 		ofi_buf_free(tx_buf);
+	} else {
+		mrail_rail_tx_start(mrail_ep, i, tx_buf->len);
 	}
 
 	ofi_genlock_unlock(&mrail_ep->util_ep.lock);
@@ -534,6 +545,9 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	if (total_len < mrail_ep->rails[rail].info->tx_attr->inject_size)
 		flags |= FI_INJECT;
 
+	tx_buf->rail = rail;
+	tx_buf->len = total_len;
+
 	FI_DBG(&mrail_prov, FI_LOG_EP_DATA, "Posting send of length: %zu"
 	       " dest_addr: 0x%" PRIx64 " tag: 0x%" PRIx64 " seq: %d"
 	       " on rail: %d\n", len, dest_addr, tag, peer_info->seq_no - 1, rail);
@@ -543,9 +557,10 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 		FI_WARN(&mrail_prov, FI_LOG_EP_DATA,
 			"Unable to fi_sendmsg on rail: %" PRIu32 "\n", rail);
 		goto err2;
-	} else if (!(flags & FI_COMPLETION)) {
-		ofi_ep_cntr_inc(&mrail_ep->util_ep, CNTR_TX);
 	}
+	mrail_rail_tx_start(mrail_ep, rail, total_len);
+	if (!(flags & FI_COMPLETION))
+		ofi_ep_cntr_inc(&mrail_ep->util_ep, CNTR_TX);
 	ofi_genlock_unlock(&mrail_ep->util_ep.lock);
 	return ret;
 err2:
@@ -662,14 +677,13 @@ static ssize_t mrail_tinjectdata(struct fid_ep *ep_fid, const void *buf,
 					      FI_REMOTE_CQ_DATA), FI_TAGGED);
 }
 
+/* Should only be called while holding the EP's lock */
 static struct mrail_unexp_msg_entry *
 mrail_get_unexp_msg_entry(struct mrail_recv_queue *recv_queue, void *context)
 {
-	// TODO use buf pool
-	// context would be mrail_ep from which u can get the buf pool
-	struct mrail_unexp_msg_entry *unexp_msg_entry =
-		malloc(sizeof(*unexp_msg_entry) + sizeof(struct fi_cq_tagged_entry));
-	return unexp_msg_entry;
+	struct mrail_ep *mrail_ep = context;
+
+	return ofi_buf_alloc(mrail_ep->unexp_msg_pool);
 }
 
 static int mrail_getname(fid_t fid, void *addr, size_t *addrlen)
@@ -721,6 +735,9 @@ static void mrail_ep_free_bufs(struct mrail_ep *mrail_ep)
 	if (mrail_ep->ooo_recv_pool)
 		ofi_bufpool_destroy(mrail_ep->ooo_recv_pool);
 
+	if (mrail_ep->unexp_msg_pool)
+		ofi_bufpool_destroy(mrail_ep->unexp_msg_pool);
+
 	if (mrail_ep->tx_buf_pool)
 		ofi_bufpool_destroy(mrail_ep->tx_buf_pool);
 
@@ -755,6 +772,13 @@ static int mrail_ep_alloc_bufs(struct mrail_ep *mrail_ep)
 	if (!mrail_ep->ooo_recv_pool)
 		goto err;
 
+	ret = ofi_bufpool_create(&mrail_ep->unexp_msg_pool,
+				 sizeof(struct mrail_unexp_msg_entry) +
+				 sizeof(struct fi_cq_tagged_entry),
+				 sizeof(void *), 0, 64, 0);
+	if (ret)
+		goto err;
+
 	ret = ofi_bufpool_create_attr(&attr, &mrail_ep->tx_buf_pool);
 	if (!mrail_ep->tx_buf_pool)
 		goto err;
@@ -968,6 +992,33 @@ void mrail_ep_progress(struct util_ep *ep)
 	mrail_progress_deferred_reqs(mrail_ep);
 }
 
+static size_t mrail_rail_speed(struct fi_info *fi)
+{
+	return (fi->nic && fi->nic->link_attr) ? fi->nic->link_attr->speed : 0;
+}
+
+/*
+ * Weigh each rail by its link speed relative to the slowest rail.  If any
+ * rail does not report a speed, all rails are treated as equal.
+ */
+static void mrail_ep_set_rail_weights(struct mrail_ep *mrail_ep)
+{
+	size_t i, speed, min_speed = SIZE_MAX;
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		ofi_atomic_initialize64(&mrail_ep->rails[i].tx_bytes, 0);
+		speed = mrail_rail_speed(mrail_ep->rails[i].info);
+		min_speed = MIN(min_speed, speed);
+	}
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		mrail_ep->rails[i].weight = min_speed ?
+			mrail_rail_speed(mrail_ep->rails[i].info) / min_speed : 1;
+		FI_INFO(&mrail_prov, FI_LOG_EP_CTRL, "rail %zu weight %" PRIu64
+			"\n", i, mrail_ep->rails[i].weight);
+	}
+}
+
 int mrail_ep_open(struct fid_domain *domain_fid, struct fi_info *info,
 		  struct fid_ep **ep_fid, void *context)
 {
@@ -1020,6 +1071,7 @@ int mrail_ep_open(struct fid_domain *domain_fid, struct fi_info *info,
 		}
 		mrail_ep->rails[i].info = fi;
 	}
+	mrail_ep_set_rail_weights(mrail_ep);
 
 	ret = mrail_ep_alloc_bufs(mrail_ep);
 	if (ret)
@@ -1049,6 +1101,8 @@ int mrail_ep_open(struct fid_domain *domain_fid, struct fi_info *info,
 
 	ofi_atomic_initialize32(&mrail_ep->tx_rail, 0);
 	ofi_atomic_initialize32(&mrail_ep->rx_rail, 0);
+	mrail_ep->ordered_recv = !info || !info->rx_attr ||
+				 (info->rx_attr->msg_order & FI_ORDER_SAS);
 	mrail_ep->default_tx_rail = mrail_local_rank % mrail_ep->num_eps;
 
 	*ep_fid = &mrail_ep->util_ep.ep_fid;
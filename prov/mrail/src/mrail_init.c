@@ -68,7 +68,7 @@ static int mrail_parse_env_vars(void)
 	fi_param_define(&mrail_prov, "config", FI_PARAM_STRING,
 			"Comma separated list of '<max_size>:<policy>' pairs, "
 			"with <max_size> in ascending order and <policy> being "
-			"fixed, round-robin, or striping");
+			"fixed, round-robin, striping, or least-loaded");
 	ret = fi_param_get_str(&mrail_prov, "config", &str);
 	if (!ret) {
 		for (i = 0; i < MRAIL_MAX_CONFIG; i++) {
@@ -92,6 +92,8 @@ static int mrail_parse_env_vars(void)
 				mrail_config[i].policy = MRAIL_POLICY_ROUND_ROBIN;
 			} else if (!strcasecmp(alg, "striping")) {
 				mrail_config[i].policy = MRAIL_POLICY_STRIPING;
+			} else if (!strcasecmp(alg, "least-loaded")) {
+				mrail_config[i].policy = MRAIL_POLICY_LEAST_LOADED;
 			} else {
 				FI_WARN(&mrail_prov, FI_LOG_CORE, "Invalid policy "
 					"specification %s\n", alg);
@@ -392,6 +394,10 @@ static void mrail_adjust_info(struct fi_info *info, const struct fi_info *hints)
 		if (hints->tx_attr->op_flags & FI_COMPLETION)
 			info->tx_attr->op_flags |= FI_COMPLETION;
 	}
+
+	/* Receives are only reordered across rails when asked to */
+	if (hints->rx_attr)
+		info->rx_attr->msg_order = hints->rx_attr->msg_order;
 }
 
 static struct fi_info *mrail_get_prefix_info(struct fi_info *core_info, int id)
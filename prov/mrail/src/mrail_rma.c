@@ -98,22 +98,29 @@ static ssize_t mrail_post_subreq(uint32_t rail,
 		ret = fi_writemsg(mrail_ep->rails[rail].ep, &msg, flags);
 	}
 
+	if (!ret) {
+		subreq->rail = rail;
+		mrail_rail_tx_start(mrail_ep, rail, subreq->len);
+	}
 	return ret;
 }
 
 static ssize_t mrail_post_req(struct mrail_req *req)
 {
+	struct mrail_subreq *subreq;
 	size_t i;
 	uint32_t rail;
 	ssize_t ret = 0;
 
 	while (req->pending_subreq >= 0) {
-		/* Try all rails before giving up */
+		subreq = &req->subreqs[req->pending_subreq];
+
+		/* Start with the rail the subreq was sized for, and try all
+		 * rails before giving up */
 		for (i = 0; i < req->mrail_ep->num_eps; ++i) {
-			rail = mrail_get_tx_rail_rr(req->mrail_ep);
+			rail = (subreq->rail + i) % req->mrail_ep->num_eps;
 
-			ret = mrail_post_subreq(rail,
-					&req->subreqs[req->pending_subreq]);
+			ret = mrail_post_subreq(rail, subreq);
 			if (ret != -FI_EAGAIN) {
 				break;
 			} else {
@@ -187,24 +194,29 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 	struct mrail_subreq *subreq;
 	size_t subreq_count;
 	size_t total_len;
-	size_t chunk_len;
+	size_t assigned_len;
 	size_t subreq_len;
+	uint64_t total_weight;
 	size_t iov_index;
 	size_t iov_offset;
 	size_t rma_iov_index;
 	size_t rma_iov_offset;
+	int policy;
 	int i;
 
-	/* For now, stripe across all rails.
-	 * This could be determined by a dynamic scheduler instead.
-	 */
-	subreq_count = mrail_ep->num_eps;
+	total_len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
 
-	total_len = ofi_total_iov_len(msg->msg_iov, msg->iov_count); 
-	chunk_len = total_len / subreq_count;
+	/* Transfers the config stripes are split across all rails, one
+	 * subreq per rail, with each chunk proportional to the bandwidth of
+	 * its rail.  Other transfers go on a single rail picked by the
+	 * policy for their size.
+	 */
+	policy = mrail_get_policy(total_len);
+	subreq_count = policy == MRAIL_POLICY_STRIPING ? mrail_ep->num_eps : 1;
+	for (i = 0, total_weight = 0; i < subreq_count; i++)
+		total_weight += mrail_ep->rails[i].weight;
 
-	/* The first chunk is the longest */
-	subreq_len =  chunk_len + (total_len % subreq_count);
+	assigned_len = 0;
 	iov_index = 0;
 	iov_offset = 0;
 	rma_iov_index = 0;
@@ -221,7 +233,18 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 	for (i = (subreq_count - 1); i >= 0; --i) {
 		subreq = &req->subreqs[i];
 
+		/* The last subreq in the array takes the remainder */
+		if (i)
+			subreq_len = total_len * mrail_ep->rails[i].weight /
+				     total_weight;
+		else
+			subreq_len = total_len - assigned_len;
+		assigned_len += subreq_len;
+
 		subreq->parent = req;
+		subreq->rail = subreq_count > 1 ? i :
+			       mrail_get_tx_rail(mrail_ep, policy);
+		subreq->len = subreq_len;
 
 		ret = ofi_copy_iov_desc(subreq->iov, subreq->descs,
 				&subreq->iov_count,
@@ -239,9 +262,6 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		if (ret) {
 			goto out;
 		}
-
-		/* All the other chunks have the same length */
-		subreq_len = chunk_len;
 	}
 
 	ofi_atomic_initialize32(&req->expected_subcomps, subreq_count);
@@ -80,4 +80,12 @@ struct fi_opx_hfi1_rx_rzv_rts_params;
 int opx_register_for_rzv(struct fi_opx_hfi1_rx_rzv_rts_params *params,
 			 const uint64_t tid_vaddr, const uint64_t tid_length);
 
+/* Register a posted receive buffer for TID rendezvous ahead of the RTS,
+ * leaving the TIDs cached for the RTS to reuse.
+ * return 0 on success (or if already registered)
+ * returns non-zero if the buffer was not registered
+ */
+int opx_tid_cache_preregister(struct fi_opx_ep *opx_ep, const uint64_t vaddr,
+			      const uint64_t length);
+
 #endif /* _FI_PROV_OPX_TID_CACHE_H_ */
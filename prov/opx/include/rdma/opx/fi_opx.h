@@ -49,6 +49,7 @@
 #include <ofi_lock.h>
 #include <uthash.h>
 #include <ofi_list.h>
+#include <ofi_atom.h>
 
 // #define FI_OPX_TRACE 1
 
@@ -159,8 +160,10 @@ struct fi_opx_global_data {
 	struct fi_provider 	*prov;
 	struct fi_opx_daos_hfi_rank	*daos_hfi_rank_hashmap;
 	enum fi_progress	progress;
+	bool			reliability_thread;
 	struct dlist_entry	tid_domain_list;
 	struct fi_opx_hfi_local_info hfi_local_info;
+	ofi_atomic32_t		hfi_context_count;
 };
 
 extern struct fi_opx_global_data fi_opx_global;
@@ -175,6 +175,7 @@ struct fi_opx_debug_counters {
 		uint64_t	tid_invalidate_needed;
 		uint64_t	tid_replays;
 		uint64_t	rts_fallback_eager;
+		uint64_t	tid_preregistered;
 		uint64_t	tid_buckets[4];
 		uint64_t	first_tidpair_minlen;
 		uint64_t	first_tidpair_maxlen;
@@ -337,6 +338,7 @@ void fi_opx_debug_counters_print(struct fi_opx_debug_counters *counters)
 		FI_OPX_DEBUG_COUNTERS_PRINT_COUNTER(pid, expected_receive.tid_invalidate_needed);
 		FI_OPX_DEBUG_COUNTERS_PRINT_COUNTER(pid, expected_receive.tid_replays);
 		FI_OPX_DEBUG_COUNTERS_PRINT_COUNTER(pid, expected_receive.rts_fallback_eager);
+		FI_OPX_DEBUG_COUNTERS_PRINT_COUNTER(pid, expected_receive.tid_preregistered);
 		FI_OPX_DEBUG_COUNTERS_PRINT_COUNTER_ARR(pid, expected_receive.tid_buckets, 4);
 		FI_OPX_DEBUG_COUNTERS_PRINT_COUNTER(pid, expected_receive.first_tidpair_minlen);
 		FI_OPX_DEBUG_COUNTERS_PRINT_COUNTER(pid, expected_receive.first_tidpair_maxlen);
@@ -522,7 +522,8 @@ struct fi_opx_ep {
 	bool					is_tx_cq_bound;
 	bool					is_rx_cq_bound;
 	bool					use_expected_tid_rzv;
-	uint8_t				        unused_cacheline5[3];
+	bool					use_tid_preregister;
+	uint8_t				        unused_cacheline5[2];
 
 	uint32_t				unused_cacheline5_u32[1];
 	uint32_t				mcache_flush_counter;
@@ -3387,6 +3388,12 @@ ssize_t fi_opx_ep_rx_recv_internal (struct fi_opx_ep *opx_ep,
 	} else
 #endif
 	{
+		/* Program the TIDs now, while the sender is still getting to
+		 * its RTS, instead of on the RTS -> CTS path. */
+		if (opx_ep->use_tid_preregister && len >= FI_OPX_SDMA_MIN_LENGTH) {
+			opx_tid_cache_preregister(opx_ep, (uint64_t)buf, len);
+		}
+
 		fi_opx_ep_rx_process_context(opx_ep,
 					static_flags,
 					OPX_CANCEL_CONTEXT_FALSE,
@@ -712,6 +712,11 @@ void fi_opx_hfi1_poll_many (struct fid_ep *ep,
 				service->usec_next = fi_opx_timer_next_event_usec(timer, timestamp, service->usec_max);
 			}// End timer fired
 
+			if (service->ack_usec_max && OFI_UNLIKELY(compare > service->ack_usec_next)) {
+				fi_reliability_service_ack_remote(ep, service);
+				service->ack_usec_next = fi_opx_timer_next_event_usec(timer, timestamp, service->ack_usec_max);
+			}
+
 
 		}
 	}
@@ -188,14 +188,15 @@ struct fi_opx_reliability_service {
 	/* == CACHE LINE == */
 	int				is_backoff_enabled;
 	enum ofi_reliability_kind	reliability_kind;	/* 4 bytes */
-	uint16_t			unused[3];
+	uint32_t			ack_usec_max;
+	uint16_t			unused;
 	uint8_t				fifo_max;
 	uint8_t				hfi1_max;
 	RbtHandle			handshake_init;		/*  1 qw  =   8 bytes */
 	struct ofi_bufpool 		*uepkt_pool;
 	struct slist			work_pending;		/* 16 bytes */
 	struct ofi_bufpool 		*work_pending_pool;
-	/* 8 bytes left in cacheline */
+	uint64_t			ack_usec_next;
 
 } __attribute__((__aligned__(64))) __attribute__((__packed__));
 
@@ -217,6 +218,7 @@ struct fi_opx_reliability_flow {
 	union fi_opx_reliability_service_flow_key	key;
 	struct fi_opx_reliability_rx_uepkt *		uepkt;
 	uint8_t						origin_rx;
+	uint64_t					acked_psn;	/* next PSN not covered by a timer ACK */
 };
 
 struct fi_opx_pending_rx_reliability_op_key {
@@ -376,6 +378,7 @@ uint8_t fi_opx_reliability_service_init (struct fi_opx_reliability_service * ser
 void fi_opx_reliability_service_fini (struct fi_opx_reliability_service * service);
 
 void fi_reliability_service_ping_remote (struct fid_ep *ep, struct fi_opx_reliability_service * service);
+void fi_reliability_service_ack_remote (struct fid_ep *ep, struct fi_opx_reliability_service * service);
 unsigned fi_opx_reliability_service_poll_hfi1 (struct fid_ep *ep, struct fi_opx_reliability_service * service);
 
 void fi_opx_reliability_service_process_pending (struct fi_opx_reliability_service * service);
@@ -715,6 +718,7 @@ void fi_opx_reliability_create_rx_flow(struct fi_opx_reliability_client_state *
 	assert(rc==0);
 
 	flow->next_psn = 0;
+	flow->acked_psn = 0;
 	flow->key.value = key;
 	flow->uepkt = NULL;
 	flow->origin_rx = origin_rx;
@@ -317,6 +317,11 @@ int fi_opx_domain(struct fid_fabric *fabric,
 				"FI_OPX_AUTO_PROGRESS_INTERVAL_USEC must be an integer >= 0 using default value\n");
 			env_var_progress_interval = 0;
 		}
+	} else if (fi_opx_global.reliability_thread) {
+		/* The thread only needs to keep up with the reliability timers */
+		int usec_max = 500;
+		fi_param_get_int(fi_opx_global.prov, "reliability_service_usec_max", &usec_max);
+		env_var_progress_interval = MAX(usec_max / 2, 1);
 	} else {
 		env_var_progress_interval = 0;
 	}
@@ -2137,6 +2137,15 @@ int fi_opx_endpoint_rx_tx (struct fid_domain *dom, struct fi_info *info,
 		opx_ep->use_expected_tid_rzv = 0;
 	}
 
+	/* pre-register posted receive buffers for expected receive (TID) */
+	int tid_preregister = 0; /* get bool takes an int */
+	if (opx_ep->use_expected_tid_rzv &&
+	    fi_param_get_bool(fi_opx_global.prov, "tid_preregister", &tid_preregister) == FI_SUCCESS) {
+		FI_INFO(fi_opx_global.prov, FI_LOG_EP_DATA,
+			"tid_preregister parm specified as %0X\n", tid_preregister);
+	}
+	opx_ep->use_tid_preregister = tid_preregister;
+
 #if defined(OPX_HMEM) && !defined(OPX_DEV_OVERRIDE)
 	if (!opx_hfi_drv_version_check("10.14")) {
 		FI_WARN(fi_opx_global.prov, FI_LOG_EP_DATA,
@@ -573,6 +573,16 @@ struct fi_opx_hfi1_context *fi_opx_hfi1_context_open(struct fid_ep *ep, uuid_t u
 			}
 		}
 
+		// With FI_OPX_HFI_SPREAD, each context opened by this pid
+		// starts one HFI further along, so that a process with several
+		// endpoints drives all of the closest HFIs.
+		int hfi_spread = 0;
+		int hfi_offset = 0;
+		fi_param_get_bool(fi_opx_global.prov, "hfi_spread", &hfi_spread);
+		if (hfi_spread) {
+			hfi_offset = ofi_atomic_inc32(&fi_opx_global.hfi_context_count) - 1;
+		}
+
 		// At this point we have a list of HFIs, sorted by distance from this
 		// pid (and by unit # as an implied key).  Pick from the closest HFIs
 		// based on the modulo of the pid. If we fail to open that HFI, try
@@ -593,7 +603,7 @@ struct fi_opx_hfi1_context *fi_opx_hfi1_context_open(struct fid_ep *ep, uuid_t u
 			// is to use HFIs evenly rather than have many pids open
 			// the 1st HFi then have many select the next HFI, etc...
 			int range = higher - lower;
-			hfi_candidate_index = getpid() % range + lower;
+			hfi_candidate_index = (getpid() + hfi_offset) % range + lower;
 			hfi_unit_number = hfi_candidates[hfi_candidate_index];
 
 			// Try to open the HFI. If we fail, try the other HFIs
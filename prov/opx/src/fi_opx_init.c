@@ -422,6 +422,30 @@ err:
 
 struct fi_opx_global_data fi_opx_global;
 
+/*
+ * With FI_OPX_RELIABILITY_SERVICE_THREAD, manual progress runs with the
+ * FI_PROGRESS_AUTO machinery: locking is forced and each CQ gets a progress
+ * thread, so pings and replays are serviced while the application computes.
+ * The application still drives progress itself, as the domain attribute
+ * stays FI_PROGRESS_MANUAL.
+ */
+static void fi_opx_set_reliability_thread(void)
+{
+	int reliability_thread = 0; /* get bool takes an int */
+
+	if (fi_opx_global.progress != FI_PROGRESS_MANUAL ||
+	    fi_param_get_bool(fi_opx_global.prov, "reliability_service_thread",
+			      &reliability_thread) != FI_SUCCESS ||
+	    !reliability_thread) {
+		return;
+	}
+
+	FI_INFO(fi_opx_global.prov, FI_LOG_FABRIC,
+		"Locking is forced by FI_OPX_RELIABILITY_SERVICE_THREAD\n");
+	fi_opx_global.progress = FI_PROGRESS_AUTO;
+	fi_opx_global.reliability_thread = true;
+}
+
 static int fi_opx_getinfo_hfi(int hfi, uint32_t version, const char *node,
 		const char *service, uint64_t flags,
 		const struct fi_info *hints,
@@ -452,6 +476,8 @@ static int fi_opx_getinfo_hfi(int hfi, uint32_t version, const char *node,
 			if (hints->domain_attr->data_progress == FI_PROGRESS_AUTO) {
 				FI_INFO(fi_opx_global.prov, FI_LOG_FABRIC, "Locking is forced in FI_PROGRESS_AUTO\n");
 			}
+			fi_opx_global.reliability_thread = false;
+			fi_opx_set_reliability_thread();
 		}
 		if (ret || ret_auto) {
 			ret = ret?ret:ret_auto;
@@ -652,6 +678,7 @@ OPX_INI
 {
 	fi_opx_count = 1;
 	fi_opx_global.progress = FI_PROGRESS_MANUAL;
+	fi_opx_global.reliability_thread = false;
 	fi_opx_set_default_info(); // TODO: fold into fi_opx_set_defaults
 
 	/* Refrain from allocating memory dynamically in this INI function. 
@@ -675,12 +702,16 @@ OPX_INI
 		OPX_DEFAULT_JOB_KEY_STR);
 	fi_param_define(&fi_opx_provider, "force_cpuaffinity", FI_PARAM_BOOL, "Causes the thread to bind itself to the cpu core it is running on. Defaults to \"No\"");
 	fi_param_define(&fi_opx_provider, "reliability_service_usec_max", FI_PARAM_INT, "The number of microseconds between pings for un-acknowledged packets. Defaults to 500 usec.");
+	fi_param_define(&fi_opx_provider, "reliability_service_thread", FI_PARAM_BOOL, "Services pings and replays from a background thread under FI_PROGRESS_MANUAL, pinned according to prog_affinity. Forces locking as in FI_PROGRESS_AUTO. Defaults to \"No\".");
+	fi_param_define(&fi_opx_provider, "reliability_service_ack_usec", FI_PARAM_INT, "The number of microseconds between cumulative ACKs for packets received since the last one, sent at most once per sender per interval. 0 disables them. Defaults to half of reliability_service_usec_max.");
 	fi_param_define(&fi_opx_provider, "reliability_service_pre_ack_rate", FI_PARAM_INT, "The number of packets to receive from a particular sender before preemptively acknowledging them without waiting for a ping. Valid values are powers of 2 in the range of 0-32,768, where 0 indicates no preemptive acking. Defaults to 64.");
 	fi_param_define(&fi_opx_provider, "selinux", FI_PARAM_BOOL, "Set to true if you're running a security-enhanced Linux. This enables updating the Jkey used based on system settings. Defaults to \"No\"");
 	fi_param_define(&fi_opx_provider, "hfi_select", FI_PARAM_STRING, "Overrides the normal algorithm used to choose which HFI a process will use. See the documentation for more information.");
+	fi_param_define(&fi_opx_provider, "hfi_spread", FI_PARAM_BOOL, "Spreads the contexts opened by a process across the closest HFIs instead of opening all of them on the same HFI. Defaults to \"No\".");
 	fi_param_define(&fi_opx_provider, "delivery_completion_threshold", FI_PARAM_INT, "The minimum message length in bytes to force delivery completion.  Value must be between %d and %d. Defaults to %d.", OPX_MIN_DCOMP_THRESHOLD, OPX_MAX_DCOMP_THRESHOLD, OPX_DEFAULT_DCOMP_THRESHOLD);
  	fi_param_define(&fi_opx_provider, "sdma_disable", FI_PARAM_INT, "Disables SDMA offload hardware. Default is 0");
 	fi_param_define(&fi_opx_provider, "expected_receive_enable", FI_PARAM_BOOL, "Enables expected receive rendezvous using Token ID (TID). Defaults to \"No\". This feature is not currently supported.");
+	fi_param_define(&fi_opx_provider, "tid_preregister", FI_PARAM_BOOL, "Registers the TIDs of large posted receive buffers when the receive is posted, instead of when the rendezvous RTS arrives. Requires expected_receive_enable. Defaults to \"No\".");
 	fi_param_define(&fi_opx_provider, "prog_affinity", FI_PARAM_STRING,
                         "When set, specify the set of CPU cores to set the progress "
                         "thread affinity to. The format is "
@@ -692,8 +723,11 @@ OPX_INI
 	fi_param_define(&fi_opx_provider, "sl", FI_PARAM_INT, "Service Level.  This will also determine Service Class and Virtual Lane.  Default is %d\n", FI_OPX_HFI1_SL_DEFAULT);
 	// fi_param_define(&fi_opx_provider, "varname", FI_PARAM_*, "help");
 
+	fi_opx_set_reliability_thread();
+
 	/* Track TID domains so cache can be cleared on exit */
 	dlist_init(&fi_opx_global.tid_domain_list);
+	ofi_atomic_initialize32(&fi_opx_global.hfi_context_count, 0);
 
 	return (&fi_opx_provider);
 }
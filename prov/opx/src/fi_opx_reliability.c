@@ -1948,6 +1948,45 @@ void fi_reliability_service_ping_remote (struct fid_ep *ep,
 	}
 }
 
+/*
+ * Send one cumulative ACK for each receive flow that has delivered packets
+ * since its last timer ACK. This retires the sender's replays for the tail
+ * of a burst (the packets after the last preemptive ACK) without waiting for
+ * a ping, while sending at most one ACK per flow per ack_usec_max.
+ */
+void fi_reliability_service_ack_remote (struct fid_ep *ep,
+		struct fi_opx_reliability_service * service)
+{
+	RbtIterator itr = rbtBegin(service->rx.flow);
+
+	while (itr) {
+		struct fi_opx_reliability_flow *flow;
+		void *key_ptr;
+
+		fi_opx_rbt_key_value(service->rx.flow, itr, &key_ptr, (void **)&flow);
+
+		const uint64_t next_psn = flow->next_psn;
+		if (next_psn > flow->acked_psn) {
+			/* The sender never has more than PSN_LOW_WINDOW replays
+			   outstanding, so older PSNs need no ACK and must not be
+			   aliased onto newer ones by the 24-bit PSN */
+			const uint64_t psn_start = MAX(flow->acked_psn,
+				next_psn - MIN(next_psn, PSN_LOW_WINDOW));
+			ssize_t rc = fi_opx_hfi1_rx_reliability_ping_response(ep,
+					flow->key.value, psn_start, next_psn - 1,
+					flow->key.slid, flow->origin_rx,
+					FI_OPX_HFI_UD_OPCODE_RELIABILITY_ACK);
+			if (rc != FI_SUCCESS) {
+				/* Out of credits, try again on the next timer */
+				return;
+			}
+			flow->acked_psn = next_psn;
+		}
+
+		itr = rbtNext(service->rx.flow, itr);
+	}
+}
+
 void fi_opx_reliability_service_process_pending (struct fi_opx_reliability_service * service)
 {
 	assert(!slist_empty(&service->work_pending));
@@ -2337,6 +2376,25 @@ uint8_t fi_opx_reliability_service_init (struct fi_opx_reliability_service * ser
 
 	service->usec_next = fi_opx_timer_next_event_usec(&service->tx.timer, &service->tx.timestamp, service->usec_max);
 
+	/*
+	 * How often to send coalesced ACKs for received packets
+	 *
+	 * ONLOAD only
+	 */
+	int ack_usec;
+	rc = fi_param_get_int(fi_opx_global.prov, "reliability_service_ack_usec", &ack_usec);
+	if (rc == FI_SUCCESS && ack_usec >= 0) {
+		FI_TRACE(fi_opx_global.prov, FI_LOG_EP_DATA, "FI_OPX_RELIABILITY_SERVICE_ACK_USEC set to %d%s\n", ack_usec, ack_usec ? "" : " (disabled)");
+	} else {
+		if (rc == FI_SUCCESS) {
+			FI_WARN(fi_opx_global.prov, FI_LOG_EP_DATA, "FI_OPX_RELIABILITY_SERVICE_ACK_USEC has value %d which is negative. Using default value of %d\n", ack_usec, usec / 2);
+		}
+		ack_usec = usec / 2;
+	}
+	service->ack_usec_max = ack_usec;
+
+	service->ack_usec_next = fi_opx_timer_next_event_usec(&service->tx.timer, &service->tx.timestamp, service->ack_usec_max);
+
 	/*
 	 * Maximum number of commands to process from atomic fifo before
 	 * stopping to do something else
@@ -3378,6 +3436,7 @@ void fi_opx_hfi1_rx_reliability_resynch (struct fid_ep *ep,
 
 		/* Reset next expected inbound packet PSN value */
 		flow->next_psn = 0;
+		flow->acked_psn = 0;
 
 		FI_DBG_TRACE(fi_opx_global.prov, FI_LOG_EP_DATA,
 			"(rx) Server flow__ %016lx is reset.\n", rx_key.value);
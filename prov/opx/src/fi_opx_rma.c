@@ -1073,8 +1073,26 @@ err:
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-function"
 
-FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, OPX_AV, 0x0018000000000000ull, OPX_RELIABILITY)
-FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, OPX_AV, 0x0018000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_MAP, 0x0018000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, FI_AV_MAP, 0x0018000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_TABLE, 0x0018000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, FI_AV_TABLE, 0x0018000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_UNSPEC, 0x0018000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, FI_AV_UNSPEC, 0x0018000000000000ull, OPX_RELIABILITY)
+
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_MAP, 0x0008000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, FI_AV_MAP, 0x0008000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_TABLE, 0x0008000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, FI_AV_TABLE, 0x0008000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_UNSPEC, 0x0008000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, FI_AV_UNSPEC, 0x0008000000000000ull, OPX_RELIABILITY)
+
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_MAP, 0x0010000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, FI_AV_MAP, 0x0010000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_TABLE, 0x0010000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, FI_AV_TABLE, 0x0010000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_UNSPEC, 0x0010000000000000ull, OPX_RELIABILITY)
+FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, FI_AV_UNSPEC, 0x0010000000000000ull, OPX_RELIABILITY)
 
 #define FI_OPX_RMA_OPS_STRUCT_NAME(LOCK, AV, CAPS, RELIABILITY)                                    \
 	FI_OPX_RMA_OPS_STRUCT_NAME_(LOCK, AV, CAPS, RELIABILITY)
@@ -1097,8 +1115,34 @@ FI_OPX_RMA_SPECIALIZED_FUNC(FI_OPX_LOCK_REQUIRED, OPX_AV, 0x0018000000000000ull,
 		.writedata = fi_no_rma_writedata,                                                  \
 	}
 
-FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, OPX_AV, 0x0018000000000000ull, OPX_RELIABILITY);
-FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, OPX_AV, 0x0018000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_MAP, 0x0018000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, FI_AV_MAP, 0x0018000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_TABLE, 0x0018000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, FI_AV_TABLE, 0x0018000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_UNSPEC, 0x0018000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, FI_AV_UNSPEC, 0x0018000000000000ull, OPX_RELIABILITY);
+
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_MAP, 0x0008000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, FI_AV_MAP, 0x0008000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_TABLE, 0x0008000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, FI_AV_TABLE, 0x0008000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_UNSPEC, 0x0008000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, FI_AV_UNSPEC, 0x0008000000000000ull, OPX_RELIABILITY);
+
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_MAP, 0x0010000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, FI_AV_MAP, 0x0010000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_TABLE, 0x0010000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, FI_AV_TABLE, 0x0010000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_NOT_REQUIRED, FI_AV_UNSPEC, 0x0010000000000000ull, OPX_RELIABILITY);
+FI_OPX_RMA_OPS_STRUCT(FI_OPX_LOCK_REQUIRED, FI_AV_UNSPEC, 0x0010000000000000ull, OPX_RELIABILITY);
+
+/* Select the ops specialized for the comm caps of the endpoint */
+#define FI_OPX_RMA_OPS_STRUCT_SELECT(LOCK, AV, COMM_CAPS)                                          \
+	((COMM_CAPS) == FI_LOCAL_COMM ?                                                            \
+		 &FI_OPX_RMA_OPS_STRUCT_NAME(LOCK, AV, 0x0008000000000000ull, OPX_RELIABILITY) :   \
+	 (COMM_CAPS) == FI_REMOTE_COMM ?                                                           \
+		 &FI_OPX_RMA_OPS_STRUCT_NAME(LOCK, AV, 0x0010000000000000ull, OPX_RELIABILITY) :   \
+		 &FI_OPX_RMA_OPS_STRUCT_NAME(LOCK, AV, 0x0018000000000000ull, OPX_RELIABILITY))
 
 #pragma GCC diagnostic pop
 
@@ -1128,16 +1172,31 @@ int fi_opx_enable_rma_ops(struct fid_ep *ep)
 		goto err;
 	}
 
+	uint64_t comm_caps = caps & (FI_LOCAL_COMM | FI_REMOTE_COMM);
+	if (comm_caps == 0)
+		comm_caps = FI_LOCAL_COMM | FI_REMOTE_COMM;
+
 	const int lock_required = fi_opx_threading_lock_required(threading, fi_opx_global.progress);
 	if (!lock_required) {
-		opx_ep->ep_fid.rma = &FI_OPX_RMA_OPS_STRUCT_NAME(FI_OPX_LOCK_NOT_REQUIRED,
-								OPX_AV, 0x0018000000000000ull,
-								OPX_RELIABILITY);
+		if (opx_ep->av->type == FI_AV_TABLE)
+			opx_ep->ep_fid.rma = FI_OPX_RMA_OPS_STRUCT_SELECT(FI_OPX_LOCK_NOT_REQUIRED,
+									  FI_AV_TABLE, comm_caps);
+		else if (opx_ep->av->type == FI_AV_MAP)
+			opx_ep->ep_fid.rma = FI_OPX_RMA_OPS_STRUCT_SELECT(FI_OPX_LOCK_NOT_REQUIRED,
+									  FI_AV_MAP, comm_caps);
+		else
+			opx_ep->ep_fid.rma = FI_OPX_RMA_OPS_STRUCT_SELECT(FI_OPX_LOCK_NOT_REQUIRED,
+									  FI_AV_UNSPEC, comm_caps);
 	} else {
-		opx_ep->ep_fid.rma = &FI_OPX_RMA_OPS_STRUCT_NAME(FI_OPX_LOCK_REQUIRED,
-								OPX_AV, 0x0018000000000000ull,
-								OPX_RELIABILITY);
-
+		if (opx_ep->av->type == FI_AV_TABLE)
+			opx_ep->ep_fid.rma = FI_OPX_RMA_OPS_STRUCT_SELECT(FI_OPX_LOCK_REQUIRED,
+									  FI_AV_TABLE, comm_caps);
+		else if (opx_ep->av->type == FI_AV_MAP)
+			opx_ep->ep_fid.rma = FI_OPX_RMA_OPS_STRUCT_SELECT(FI_OPX_LOCK_REQUIRED,
+									  FI_AV_MAP, comm_caps);
+		else
+			opx_ep->ep_fid.rma = FI_OPX_RMA_OPS_STRUCT_SELECT(FI_OPX_LOCK_REQUIRED,
+									  FI_AV_UNSPEC, comm_caps);
 	}
 
 	return 0;
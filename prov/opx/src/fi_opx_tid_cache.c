@@ -1346,6 +1346,7 @@ int opx_tid_cache_close_region(struct ofi_mr_cache *tid_cache,
  * - opx_tid_cache_setup
  * - opx_deregister_for_rzv
  * - opx_register_for_rzv
+ * - opx_tid_cache_preregister
  * - opx_tid_cache_flush
  ****************************************************/
 
@@ -1608,6 +1609,58 @@ void opx_deregister_for_rzv(struct fi_opx_ep *opx_ep, const uint64_t tid_vaddr,
 	}
 }
 
+int opx_tid_cache_preregister(struct fi_opx_ep *opx_ep, const uint64_t vaddr,
+			      const uint64_t length)
+{
+	struct opx_tid_domain *tid_domain = opx_ep->domain->tid_domain;
+	struct ofi_mr_cache *tid_cache = tid_domain->tid_cache;
+	struct ofi_mr_entry *entry = NULL;
+	struct ofi_mr_info find_info = {0};
+	const uint64_t page_alignment_mask = -(int64_t)OPX_HFI1_TID_PAGESIZE;
+	/* Same alignment as the RTS, so the RTS finds this entry */
+	const uint64_t tid_vaddr = vaddr & page_alignment_mask;
+	const uint64_t tid_length = ((vaddr + length) - tid_vaddr +
+				     (OPX_HFI1_TID_PAGESIZE - 1)) &
+				    page_alignment_mask;
+
+	pthread_mutex_lock(&mm_lock);
+
+	find_info.iov.iov_base = (void *)tid_vaddr;
+	find_info.iov.iov_len = tid_length;
+
+	FI_DBG(fi_opx_global.prov, FI_LOG_MR,
+	       "OPX_DEBUG_ENTRY tid vaddr [%#lx - %#lx] , tid length %lu/%#lX\n",
+	       tid_vaddr, tid_vaddr + tid_length, tid_length, tid_length);
+
+	/* Only register buffers the cache knows nothing about. Overlaps
+	 * are left to the RTS, which can combine entries. */
+	int find = opx_tid_cache_find(opx_ep, &find_info, &entry);
+	if (find != OPX_ENTRY_NOT_FOUND) {
+		pthread_mutex_unlock(&mm_lock);
+		return (find == OPX_ENTRY_FOUND) ? 0 : -FI_EALREADY;
+	}
+
+	opx_tid_cache_crte(tid_cache, &find_info, &entry, opx_ep);
+	struct opx_mr_tid_info *cached_tid_entry =
+		&((struct opx_tid_mr *)entry->data)->tid_info;
+
+	/* opx_register_tid_region was done in add region, check result */
+	if (OPX_TID_NINFO(cached_tid_entry) == 0) { /* failed */
+		pthread_mutex_unlock(&mm_lock);
+		opx_cache_free_entry(tid_cache, entry);
+		return -FI_EFAULT;
+	}
+
+	/* Drop the reference taken by create, leaving the entry on the
+	 * LRU list for the RTS to find */
+	opx_tid_cache_close_region(tid_cache, entry, false);
+	pthread_mutex_unlock(&mm_lock);
+
+	FI_OPX_DEBUG_COUNTERS_INC(
+		opx_ep->debug_counters.expected_receive.tid_preregistered);
+	return 0;
+}
+
 /* opx_process_entry()
  *
  *  Process the entry found in a region
@@ -191,7 +191,7 @@ psm3_ep_open_udp_internal(psm2_ep_t ep, int unit, int port,
 
 		psm3_getenv("PSM3_UDP_GRO",
 				"Enable UDP GRO Coalesced Receive Offload (0 disables GRO)",
-				PSMI_ENVVAR_LEVEL_HIDDEN, PSMI_ENVVAR_TYPE_INT,
+				PSMI_ENVVAR_LEVEL_USER, PSMI_ENVVAR_TYPE_INT,
 				(union psmi_envvar_val) 0, &env_gro);
 		ep->sockets_ep.udp_gro = env_gro.e_int;
 		if (ep->sockets_ep.udp_gro) {
@@ -217,7 +217,7 @@ psm3_ep_open_udp_internal(psm2_ep_t ep, int unit, int port,
 		// additional stuff related to gro
 		if (ep->sockets_ep.udp_gro) {
 			int val = 1;
-			if (-1 == setsockopt(ep->sockets_ep.udp_tx_fd, SOL_IP, UDP_GRO, &val, sizeof(val))) {
+			if (-1 == setsockopt(ep->sockets_ep.udp_rx_fd, SOL_UDP, UDP_GRO, &val, sizeof(val))) {
 				_HFI_ERROR("Failed setsockopt GRO for %s: %s\n", ep->dev_name, strerror(errno));
 				goto fail;
 			}
@@ -1026,6 +1026,15 @@ psm3_sockets_ips_proto_init(struct ips_proto *proto, uint32_t cksum_sz)
 		_HFI_ERROR( "Unable to allocate UDP buffers pools\n");
 		goto fail;
 	}
+	if (ep->sockets_ep.udp_gro) {
+		// the kernel coalesces up to 64K of packets from one sender
+		ep->sockets_ep.rbuf_udp_gro = (uint8_t *)psmi_calloc(ep, NETWORK_BUFFERS,
+						UDP_GRO_BUF_SIZE, 1);
+		if (! ep->sockets_ep.rbuf_udp_gro) {
+			_HFI_ERROR( "Unable to allocate UDP GRO buffer\n");
+			goto fail;
+		}
+	}
 
 #ifdef PSM_BYTE_FLOW_CREDITS
 	if (ep->sockets_ep.sockets_mode == PSM3_SOCKETS_TCP) {
@@ -1289,6 +1298,11 @@ void psm3_ep_sockets_free_buffers(psm2_ep_t ep)
 		}
 	}
 
+	if (ep->sockets_ep.rbuf_udp_gro) {
+		psmi_free(ep->sockets_ep.rbuf_udp_gro);
+		ep->sockets_ep.rbuf_udp_gro = NULL;
+	}
+
 	if (ep->sockets_ep.sbuf) {
 		psmi_free(ep->sockets_ep.sbuf);
 		ep->sockets_ep.sbuf = NULL;
@@ -103,6 +103,8 @@
 
 #define TCP_MAX_PSM_HEADER 56			// sizeof(ips_lrh) == 56
 
+#define UDP_GRO_BUF_SIZE 65536			// largest coalesced UDP GRO receive
+
 #define NETDEV_PORT 1			// default port if not specified
 
 #define BUFFER_HEADROOM 0		// how much extra to allocate in buffers
@@ -188,7 +190,12 @@ struct psm3_sockets_ep {
 	int udp_gso;	// is GSO enabled for UDP
 	uint8_t *sbuf_udp_gso;	// buffer to compose UDP GSO packet sequence
 	int udp_gso_zerocopy;	// is UDP GSO Zero copy option enabled
-	int udp_gro; // will be used later
+	int udp_gro;	// is GRO enabled for UDP
+	uint8_t *rbuf_udp_gro;	// buffer to receive UDP GRO packet sequence
+	uint32_t gro_offset;	// next packet in rbuf_udp_gro
+	uint32_t gro_len;	// bytes left in rbuf_udp_gro
+	uint32_t gro_seg_size;	// size of each packet in rbuf_udp_gro
+	struct sockaddr_storage gro_addr;	// sender of rbuf_udp_gro
 	/* fields used for both UDP and TCP */
 	uint8_t *sbuf;
 	uint8_t *rbuf;
@@ -1225,6 +1225,65 @@ psm3_sockets_udp_process_packet(struct ips_recvhdrq_event *rcv_ev,
 	return ret;
 }
 
+// Receive the next UDP packet.  With GRO the kernel may return a sequence
+// of packets from one sender in a single recvmsg, each gro_seg_size long
+// except the last.  The sequence stays in rbuf_udp_gro and is handed out
+// one packet per call, in place, until it is consumed.
+static __inline__ int
+psm3_sockets_udp_recv(psm2_ep_t ep, uint8_t **buf,
+		struct sockaddr_storage *rem_addr, socklen_t *len_addr)
+{
+	char control[CMSG_SPACE(sizeof(int))];
+	struct cmsghdr *cm;
+	struct msghdr msg;
+	struct iovec iov;
+	int recvlen;
+
+	if (! ep->sockets_ep.udp_gro) {
+		*buf = ep->sockets_ep.rbuf;
+		// TBD - do we need rem_addr?  if not, can use recv
+		// MSG_DONTWAIT is redundant since we set O_NONBLOCK
+		return recvfrom(ep->sockets_ep.udp_rx_fd, *buf, ep->sockets_ep.buf_size,
+						MSG_DONTWAIT|MSG_TRUNC,
+						(struct sockaddr *)rem_addr, len_addr);
+	}
+
+	if (! ep->sockets_ep.gro_len) {
+		iov.iov_base = ep->sockets_ep.rbuf_udp_gro;
+		iov.iov_len = UDP_GRO_BUF_SIZE;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = &ep->sockets_ep.gro_addr;
+		msg.msg_namelen = sizeof(ep->sockets_ep.gro_addr);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		recvlen = recvmsg(ep->sockets_ep.udp_rx_fd, &msg, MSG_DONTWAIT);
+		if (recvlen <= 0)
+			return recvlen;
+
+		ep->sockets_ep.gro_offset = 0;
+		ep->sockets_ep.gro_len = recvlen;
+		ep->sockets_ep.gro_seg_size = recvlen;
+		for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+			if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+				ep->sockets_ep.gro_seg_size = *(int *)CMSG_DATA(cm);
+				break;
+			}
+		}
+		*len_addr = msg.msg_namelen;
+	} else {
+		*len_addr = sizeof(ep->sockets_ep.gro_addr);
+	}
+
+	memcpy(rem_addr, &ep->sockets_ep.gro_addr, sizeof(*rem_addr));
+	*buf = ep->sockets_ep.rbuf_udp_gro + ep->sockets_ep.gro_offset;
+	recvlen = min(ep->sockets_ep.gro_seg_size, ep->sockets_ep.gro_len);
+	ep->sockets_ep.gro_offset += recvlen;
+	ep->sockets_ep.gro_len -= recvlen;
+	return recvlen;
+}
+
 psm2_error_t psm3_sockets_udp_recvhdrq_progress(struct ips_recvhdrq *recvq, bool force)
 {
 	GENERIC_PERF_BEGIN(PSM_RX_SPEEDPATH_CTR); /* perf stats */
@@ -1250,12 +1309,7 @@ psm2_error_t psm3_sockets_udp_recvhdrq_progress(struct ips_recvhdrq *recvq, bool
 			rcv_ev.payload_size = ep->sockets_ep.revisit_payload_size;
 			ep->sockets_ep.revisit_payload_size = 0;
 		} else {
-			buf = ep->sockets_ep.rbuf;
-			// TBD - do we need rem_addr?  if not, can use recv
-			// MSG_DONTWAIT is redundant since we set O_NONBLOCK
-			recvlen = recvfrom(ep->sockets_ep.udp_rx_fd, buf, ep->sockets_ep.buf_size,
-								MSG_DONTWAIT|MSG_TRUNC,
-								(struct sockaddr *)&rem_addr, &len_addr);
+			recvlen = psm3_sockets_udp_recv(ep, &buf, &rem_addr, &len_addr);
 			if (recvlen < 0) {
 				if (errno == EAGAIN || errno == EWOULDBLOCK) {
 					break;
@@ -79,14 +79,17 @@ void mq_qq_append_which_hash(psm2_mq_t mq,
 
 // find the table with matching table_sel. 
 // If none found and have room for a new table, add a new empty table.
-// if none found and didn't add a table, return NUM_HASH_CONFIGS and caller
-// will need to use the simple linear list
+// if none found and didn't add a table, or the table_sel is not worth
+// hashing, return NUM_HASH_CONFIGS and caller will need to use the simple
+// linear list
 PSMI_ALWAYS_INLINE(
 int mq_qq_find_table(psm2_mq_t mq, psm2_epaddr_t src, psm2_mq_tag_t *tagsel))
 {
 	int t;
 	uint8_t srcsel = src != PSM2_MQ_ANY_ADDR;
 
+	if_pf (! table_sel_hashable(srcsel, tagsel))
+		goto linear;
 	// chose to have a loop instead of unrolling loop due to
 	// possible better CPU instruction cache hit rate
 	// search in the order the tables got created, 1st created may be used more
@@ -105,6 +108,7 @@ int mq_qq_find_table(psm2_mq_t mq, psm2_epaddr_t src, psm2_mq_tag_t *tagsel))
 		return t;
 	}
 	// out of tables, must use simple linear list
+linear:
 	if (! mq->search_linear_expected) {
 		mq->search_linear_expected = 1;
 		UPDATE_SUBQUEUE_COUNT(mq);
@@ -136,17 +136,16 @@ enum psm2_mq_tag_pattern {
  * min_table to NUM_HASH_CONFIGS-1).  We use the upper entries 1st as
  * this may provide a CPU cache hit rate advantage.
  *
- * Unfortunately, since PSM3 doesn't know how the middleware is using
- * src_addr and tagsel for tag matching, PSM3 cannot identify which table_sel
- * corresponds to MPI_recv(..., MPI_ANY_SOURCE, MPI_ANY_TAG, ...) so one
- * of the hash tables may be used for this pattern.  If this occurs, it's
- * likely all the entries on that hash table will hash to the exact same
- * hash bucket and essentially be a linear list.  Fortunately use of pure
- * wildcards are uncommon in real apps, so it's likely this table_sel will
- * never be discovered and created.
+ * A table_sel which wildcards src_addr and the whole 64 bit tag, such as
+ * MPI_recv(..., MPI_ANY_SOURCE, MPI_ANY_TAG, ...), would hash all of its
+ * entries to the exact same hash bucket and essentially be a linear list.
+ * No table is created for such a pattern (see table_sel_hashable), its
+ * requests are kept on the linear expected queue, which is merged with
+ * the hash tables by timestamp when matching.
  *
- * Until such time as NUM_HASH_CONFIGS tables are actually needed, the
- * linear expected queue will remain empty.
+ * Until such time as NUM_HASH_CONFIGS tables are actually needed or a
+ * pure wildcard receive is posted, the linear expected queue will remain
+ * empty.
  */
 #endif
 struct psm2_mq {
@@ -353,6 +352,12 @@ struct psm2_mq_req {
 	 * on a device/host buffer.
 	 */
 	uint8_t is_buf_gpu_mem;
+	/*
+	 * gpu_eager_staged - a multi-packet eager receive into a device
+	 * buffer is landed in a host sysbuf (req_data.buf) and copied to
+	 * user_gpu_buffer with a single device copy once complete.
+	 */
+	uint8_t gpu_eager_staged;
 #endif
 
 	/* PTLs get to store their own per-request data.  MQ manages the allocation
@@ -401,6 +406,15 @@ int table_sel_cmp(psm2_mq_table_sel_t *sel, uint8_t srcsel,
 			&& sel->tagsel.rem32 == tagsel->rem32);
 }
 
+// A pattern with src and the 64 bit tag wildcarded (MPI_ANY_SOURCE with
+// MPI_ANY_TAG) would hash every entry into the same bucket, so such
+// requests are kept on the simple linear list instead of using up a table
+PSMI_ALWAYS_INLINE(
+int table_sel_hashable(uint8_t srcsel, psm2_mq_tag_t *tagsel))
+{
+	return srcsel || tagsel->tag64;
+}
+
 // hash all of src and tagsel portion of tag.  For simplicity
 // we do not attempt to take advantage of the fact PSMx3 only uses
 // 64 or 68 bits of tag and tagsel
@@ -257,6 +257,15 @@ psm3_mq_handle_data(psm2_mq_t mq, psm2_mq_req_t req,
 		if (req->type & MQE_TYPE_EAGER_QUEUE) {
 			STAILQ_REMOVE(&mq->eager_q, req, psm2_mq_req, nextq);
 		}
+#if defined(PSM_CUDA) || defined(PSM_ONEAPI)
+		if (req->gpu_eager_staged) {
+			psm3_mq_mtucpy(req->user_gpu_buffer, req->req_data.buf,
+				       req->req_data.recv_msglen);
+			psm3_mq_sysbuf_free(mq, req->req_data.buf);
+			req->req_data.buf = req->user_gpu_buffer;
+			req->gpu_eager_staged = 0;
+		}
+#endif
 
 		if (req->state == MQ_STATE_MATCHED) {
 #if   defined(PSM_HAVE_REG_MR)
@@ -644,6 +653,15 @@ psm3_mq_handle_envelope(psm2_mq_t mq, psm2_epaddr_t src, uint32_t *_tag,
 				stats->eager_gdrcopy_recv_bytes += paylen;
 			} else {
 				req->req_data.buf = req->user_gpu_buffer;
+				// rather than a device copy per packet, stage the
+				// rest of the message and copy it once complete
+				if (msglen > paylen) {
+					void *staging = psm3_mq_sysbuf_alloc(mq, msglen);
+					if (staging) {
+						req->req_data.buf = staging;
+						req->gpu_eager_staged = 1;
+					}
+				}
 				if (!offset) stats->eager_cuCopy_recv++;
 				stats->eager_cuCopy_recv_bytes += paylen;
 			}
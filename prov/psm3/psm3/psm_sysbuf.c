@@ -88,6 +88,7 @@ void psm3_mq_sysbuf_init(psm2_mq_t mq)
         mq->handler_index[i].block_size = block_sizes[i];
         mq->handler_index[i].current_available = 0;
         mq->handler_index[i].free_list = NULL;
+        mq->handler_index[i].slab_list = NULL;
         mq->handler_index[i].total_alloc = 0;
         mq->handler_index[i].replenishing_rate = replenishing_rate[i];
 
@@ -123,8 +124,9 @@ void psm3_mq_sysbuf_fini(psm2_mq_t mq)  // free all buffers that is currently no
         return;
 
     for (i=0; i < MM_NUM_OF_POOLS; i++) {
-        while ((block = mq->handler_index[i].free_list) != NULL) {
-            mq->handler_index[i].free_list = block->next;
+        mq->handler_index[i].free_list = NULL;
+        while ((block = mq->handler_index[i].slab_list) != NULL) {
+            mq->handler_index[i].slab_list = block->next;
 #if defined(PSM_ONEAPI) && !defined(PSM3_NO_ONEAPI_IMPORT)
             if (PSMI_IS_GPU_ENABLED)
                 PSMI_ONEAPI_ZE_CALL(zexDriverReleaseImportedPointer, ze_driver, block);
@@ -183,29 +185,38 @@ void *psm3_mq_sysbuf_alloc(psm2_mq_t mq, uint32_t alloc_size)
             return new_block;
         }
 
-        do {
-            uint32_t newsz = mm_handler->block_size + sizeof(struct psmi_mem_block_ctrl);
-
-            new_block = psmi_malloc(mq->ep, UNEXPECTED_BUFFERS, newsz);
+        // Carve the whole replenishment out of a single slab, so a refill
+        // costs one allocation instead of one per block.  The slab header
+        // links the slab for psm3_mq_sysbuf_fini.
+        uint32_t blocksz = mm_handler->block_size + sizeof(struct psmi_mem_block_ctrl);
+        uint64_t newsz = sizeof(struct psmi_mem_block_ctrl) +
+                         (uint64_t)blocksz * replenishing;
+        struct psmi_mem_block_ctrl *slab =
+            psmi_malloc(mq->ep, UNEXPECTED_BUFFERS, newsz);
 
-            if (new_block) {
+        if (slab) {
 #if defined(PSM_ONEAPI) && !defined(PSM3_NO_ONEAPI_IMPORT)
-                // By registering memory with Level Zero, we make
-                // zeCommandListAppendMemoryCopy run faster for copies between
-                // GPU and this sysbuf
-                if (PSMI_IS_GPU_ENABLED)
-                    PSMI_ONEAPI_ZE_CALL(zexDriverImportExternalPointer, ze_driver,
-                                    new_block, newsz);
+            // By registering memory with Level Zero, we make
+            // zeCommandListAppendMemoryCopy run faster for copies between
+            // GPU and this sysbuf
+            if (PSMI_IS_GPU_ENABLED)
+                PSMI_ONEAPI_ZE_CALL(zexDriverImportExternalPointer, ze_driver,
+                                slab, newsz);
 #endif
-                mm_handler->current_available++;
-                mm_handler->total_alloc++;
-                mq->mem_ctrl_total_bytes += newsz;
-
+            slab->next = mm_handler->slab_list;
+            mm_handler->slab_list = slab;
+            mq->mem_ctrl_total_bytes += newsz;
+
+            // link in reverse so blocks are handed out in address order
+            while (replenishing--) {
+                new_block = (struct psmi_mem_block_ctrl *)
+                    ((uintptr_t)(slab + 1) + (uintptr_t)blocksz * replenishing);
                 new_block->next = mm_handler->free_list;
                 mm_handler->free_list = new_block;
+                mm_handler->current_available++;
+                mm_handler->total_alloc++;
             }
-
-        } while (--replenishing && new_block);
+        }
     }
 
     if (mm_handler->current_available) {
@@ -62,6 +62,7 @@
 
 typedef struct psmi_mem_ctrl {
     struct psmi_mem_block_ctrl *free_list;
+    struct psmi_mem_block_ctrl *slab_list; /* allocations carved into blocks */
     uint32_t total_alloc;
     uint32_t current_available;
     uint32_t block_size;
@@ -2284,7 +2284,8 @@ psm3_ips_proto_mq_handle_eager(struct ips_recvhdrq_event *rcv_ev)
 					if (p_hdr->data[1].u32w0<4) rcv_ev->proto->strat_stats.eager_cpu_recv++;
 					rcv_ev->proto->strat_stats.eager_cpu_recv_bytes += paylen;
 				}
-			} else if (PSMI_USE_GDR_COPY_RECV(paylen)) {
+			} else if (!req->gpu_eager_staged &&
+				   PSMI_USE_GDR_COPY_RECV(paylen)) {
 				use_gdrcopy = 1;
 				if (p_hdr->data[1].u32w0<4) rcv_ev->proto->strat_stats.eager_gdrcopy_recv++;
 				rcv_ev->proto->strat_stats.eager_gdrcopy_recv_bytes += paylen;
@@ -791,6 +791,7 @@ struct psmx3_fid_ep {
 struct psmx3_sep_ctxt {
 	struct psmx3_trx_ctxt	*trx_ctxt;
 	struct psmx3_fid_ep	*ep;
+	int			usage_flags;
 };
 
 struct psmx3_fid_sep {
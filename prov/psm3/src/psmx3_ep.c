@@ -816,7 +816,8 @@ static int psmx3_sep_close(fid_t fid)
 			      &sep->service, &ep_name);
 
 	for (i = 0; i < sep->ctxt_cnt; i++) {
-		psmx3_trx_ctxt_free(sep->ctxts[i].trx_ctxt, PSMX3_TX_RX);
+		psmx3_trx_ctxt_free(sep->ctxts[i].trx_ctxt,
+				    sep->ctxts[i].usage_flags);
 
 		if (sep->ctxts[i].ep)
 			psmx3_ep_close_internal(sep->ctxts[i].ep);
@@ -944,9 +945,11 @@ int psmx3_sep_open(struct fid_domain *domain, struct fi_info *info,
 	struct psmx3_ep_name *src_addr;
 	struct psmx3_trx_ctxt *trx_ctxt;
 	size_t ctxt_cnt = 1;
+	size_t tx_ctx_cnt, rx_ctx_cnt;
 	size_t ctxt_size;
 	int err = -FI_EINVAL;
 	uint8_t *uuid = NULL;
+	int usage_flags;
 	int i;
 
 	domain_priv = container_of(domain, struct psmx3_fid_domain,
@@ -1003,6 +1006,15 @@ int psmx3_sep_open(struct fid_domain *domain, struct fi_info *info,
 		}
 	}
 
+	tx_ctx_cnt = ctxt_cnt;
+	rx_ctx_cnt = ctxt_cnt;
+	if (info && info->ep_attr) {
+		if (info->ep_attr->tx_ctx_cnt)
+			tx_ctx_cnt = info->ep_attr->tx_ctx_cnt;
+		if (info->ep_attr->rx_ctx_cnt)
+			rx_ctx_cnt = info->ep_attr->rx_ctx_cnt;
+	}
+
 	/* If override is true, the FI_PSM3_UUID was set to override other uuid */
 	if (psmx3_override_uuid()) {
 		uuid = domain_priv->fabric->uuid;
@@ -1033,18 +1045,31 @@ int psmx3_sep_open(struct fid_domain *domain, struct fi_info *info,
 	}
 
 	for (i = 0; i < ctxt_cnt; i++) {
+		/*
+		 * Contexts beyond the smaller of tx_ctx_cnt and rx_ctx_cnt are
+		 * only used in one direction. Open them Tx or Rx only so they
+		 * can share a PSM endpoint with a complementary context of the
+		 * domain instead of taking a hardware context of their own.
+		 */
+		usage_flags = 0;
+		if (i < tx_ctx_cnt)
+			usage_flags |= PSMX3_TX;
+		if (i < rx_ctx_cnt)
+			usage_flags |= PSMX3_RX;
+
 		trx_ctxt = psmx3_trx_ctxt_alloc(domain_priv, src_addr,
 						(ctxt_cnt > 1) ? i : -1,
-						PSMX3_TX_RX, uuid);
+						usage_flags, uuid);
 		if (!trx_ctxt) {
 			err = -FI_ENOMEM;
 			goto errout_free_ctxt;
 		}
 
 		sep_priv->ctxts[i].trx_ctxt = trx_ctxt;
+		sep_priv->ctxts[i].usage_flags = usage_flags;
 
 		err = psmx3_ep_open_internal(domain_priv, info, &ep_priv, context,
-					     trx_ctxt, PSMX3_TX_RX);
+					     trx_ctxt, usage_flags);
 		if (err)
 			goto errout_free_ctxt;
 
@@ -1093,7 +1118,7 @@ errout_free_ctxt:
 	while (i) {
 		if (sep_priv->ctxts[i].trx_ctxt)
 			psmx3_trx_ctxt_free(sep_priv->ctxts[i].trx_ctxt,
-					    PSMX3_TX_RX);
+					    sep_priv->ctxts[i].usage_flags);
 
 		if (sep_priv->ctxts[i].ep)
 			psmx3_ep_close_internal(sep_priv->ctxts[i].ep);
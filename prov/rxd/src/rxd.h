@@ -60,7 +60,7 @@
 #ifndef _RXD_H_
 #define _RXD_H_
 
-#define RXD_PROTOCOL_VERSION 	(2)
+#define RXD_PROTOCOL_VERSION 	(3)
 
 #define RXD_MAX_MTU_SIZE	4096
 
@@ -72,10 +72,15 @@
 #define RXD_RX_POOL_CHUNK_CNT	1024
 #define RXD_MAX_PENDING		128
 #define RXD_MAX_PKT_RETRY	50
+#define RXD_SACK_BITS		64
+#define RXD_FAST_RETRY_ACKS	3
+#define RXD_MIN_CWND		2
+#define RXD_INIT_CWND		16
 #define RXD_ADDR_INVALID	0
 
 #define RXD_PKT_IN_USE		(1 << 0)
 #define RXD_PKT_ACKED		(1 << 1)
+#define RXD_PKT_SACKED		(1 << 2)
 
 #define RXD_REMOTE_CQ_DATA	(1 << 0)
 #define RXD_NO_TX_COMP		(1 << 1)
@@ -84,6 +89,7 @@
 #define RXD_TAG_HDR		(1 << 4)
 #define RXD_INLINE		(1 << 5)
 #define RXD_MULTI_RECV		(1 << 6)
+#define RXD_ACK_REQ		(1 << 7)
 
 #define RXD_IDX_OFFSET(x)	(x + 1)	
 
@@ -131,6 +137,23 @@ struct rxd_peer {
 	uint16_t rx_window;
 	uint16_t tx_window;
 	int retry_cnt;
+	int dup_ack_cnt;
+
+	/* Congestion window, in packets, and its slow start threshold */
+	uint16_t cwnd;
+	uint16_t ssthresh;
+	uint16_t cwnd_acked;
+
+	/* RTT estimation from one timed packet per round trip, in usec */
+	uint8_t rtt_pending;
+	uint64_t rtt_seq;
+	uint64_t rtt_start;
+	uint64_t srtt;
+	uint64_t rttvar;
+
+	/* Out of order data packets copied in place, bit i is placed_seq + i */
+	uint64_t placed;
+	uint64_t placed_seq;
 
 	uint16_t unacked_cnt;
 	uint8_t active;
@@ -332,6 +355,16 @@ static inline struct rxd_base_hdr *rxd_get_base_hdr(struct rxd_pkt_entry *pkt_en
 	return &((struct rxd_ack_pkt *) (pkt_entry->pkt))->base_hdr;
 }
 
+/*
+ * Op packets are also dropped while the receiver is not ready for them,
+ * only losing data packets is a sign of congestion.
+ */
+static inline int rxd_is_data_pkt(struct rxd_pkt_entry *pkt_entry)
+{
+	return rxd_pkt_type(pkt_entry) == RXD_DATA ||
+	       rxd_pkt_type(pkt_entry) == RXD_DATA_READ;
+}
+
 static inline uint64_t rxd_set_pkt_seq(struct rxd_peer *peer,
 				       struct rxd_pkt_entry *pkt_entry)
 {
@@ -340,6 +373,24 @@ static inline uint64_t rxd_set_pkt_seq(struct rxd_peer *peer,
 	return rxd_get_base_hdr(pkt_entry)->seq_no;
 }
 
+static inline uint16_t rxd_peer_window(struct rxd_peer *peer)
+{
+	return MIN(peer->tx_window, peer->cwnd);
+}
+
+/* Returns the placed packets bitmap, rebased on the next expected seq_no */
+static inline uint64_t rxd_peer_placed(struct rxd_peer *peer)
+{
+	uint64_t shift;
+
+	if (ofi_before(peer->placed_seq, peer->rx_seq_no)) {
+		shift = peer->rx_seq_no - peer->placed_seq;
+		peer->placed = shift < RXD_SACK_BITS ? peer->placed >> shift : 0;
+		peer->placed_seq = peer->rx_seq_no;
+	}
+	return peer->placed;
+}
+
 static inline struct rxd_ext_hdr *rxd_get_ext_hdr(struct rxd_pkt_entry *pkt_entry)
 {
 	return &((struct rxd_ack_pkt *) (pkt_entry->pkt))->ext_hdr;
@@ -475,6 +526,8 @@ struct rxd_x_entry *rxd_rx_entry_init(struct rxd_ep *ep,
 void rxd_tx_entry_free(struct rxd_ep *ep, struct rxd_x_entry *tx_entry);
 void rxd_rx_entry_free(struct rxd_ep *ep, struct rxd_x_entry *rx_entry);
 int rxd_get_timeout(int retry_cnt);
+void rxd_cwnd_ack(struct rxd_peer *peer, uint64_t ack_seq, uint16_t acked);
+void rxd_cwnd_loss(struct rxd_peer *peer, int timeout);
 uint64_t rxd_get_retry_time(uint64_t start, int retry_cnt);
 
 /* Generic message functions */
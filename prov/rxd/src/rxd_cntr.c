@@ -50,7 +50,7 @@ static int rxd_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int time
 
 	do {
 		cntr->progress(cntr);
-		if (threshold <= (uint64_t) ofi_atomic_get64(&cntr->cnt))
+		if (threshold <= ofi_cntr_value(cntr))
 			return FI_SUCCESS;
 
 		if (errcnt != (uint64_t) ofi_atomic_get64(&cntr->err))
@@ -59,6 +59,13 @@ static int rxd_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int time
 		if (ofi_adjust_timeout(endtime, &timeout))
 			return -FI_ETIMEDOUT;
 
+		/* See ofi_cntr_wait */
+		if (cntr->deltas) {
+			ofi_cntr_arm(cntr, threshold);
+			if (threshold <= ofi_cntr_value(cntr))
+				return FI_SUCCESS;
+		}
+
 		ep_retry = -1;
 		ofi_genlock_lock(&cntr->ep_list_lock);
 		dlist_foreach_container(&cntr->ep_list, struct fid_list_entry,
@@ -162,11 +162,11 @@ static int rxd_comp_pkt_seq_no(struct dlist_entry *item, const void *arg)
 	new_hdr = rxd_get_base_hdr(container_of((struct dlist_entry *) arg,
 				  struct rxd_pkt_entry, d_entry));
 
-	return new_hdr->seq_no > list_hdr->seq_no;
+	return ofi_before(new_hdr->seq_no, list_hdr->seq_no);
 }
 
-void rxd_ep_recv_data(struct rxd_ep *ep, struct rxd_x_entry *x_entry,
-		      struct rxd_data_pkt *pkt, size_t size)
+static void rxd_ep_copy_data(struct rxd_ep *ep, struct rxd_x_entry *x_entry,
+			     struct rxd_data_pkt *pkt, size_t size)
 {
 	struct rxd_domain *rxd_domain = rxd_ep_domain(ep);
 	uint64_t done;
@@ -188,10 +188,17 @@ void rxd_ep_recv_data(struct rxd_ep *ep, struct rxd_x_entry *x_entry,
 
 	x_entry->bytes_done += done;
 	x_entry->next_seg_no++;
+}
+
+void rxd_ep_recv_data(struct rxd_ep *ep, struct rxd_x_entry *x_entry,
+		      struct rxd_data_pkt *pkt, size_t size)
+{
+	rxd_ep_copy_data(ep, x_entry, pkt, size);
 
 	if (x_entry->next_seg_no < x_entry->num_segs) {
 		if (!(rxd_peer(ep, pkt->base_hdr.peer)->rx_seq_no %
-		    rxd_peer(ep, pkt->base_hdr.peer)->rx_window))
+		    rxd_peer(ep, pkt->base_hdr.peer)->rx_window) ||
+		    pkt->base_hdr.flags & RXD_ACK_REQ)
 			rxd_ep_send_ack(ep, pkt->base_hdr.peer);
 		return;
 	}
@@ -242,7 +249,7 @@ int rxd_start_xfer(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 	struct rxd_base_hdr *hdr = rxd_get_base_hdr(tx_entry->pkt);
 
 	if (rxd_peer(ep, tx_entry->peer)->unacked_cnt >=
-	    rxd_peer(ep, tx_entry->peer)->tx_window)
+	    rxd_peer_window(rxd_peer(ep, tx_entry->peer)))
 		return 0;
 
 	tx_entry->start_seq = rxd_set_pkt_seq(rxd_peer(ep, tx_entry->peer),
@@ -264,7 +271,7 @@ int rxd_start_xfer(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 	}
 
 	return rxd_peer(ep, tx_entry->peer)->unacked_cnt <
-	       rxd_peer(ep,tx_entry->peer)->tx_window;
+	       rxd_peer_window(rxd_peer(ep, tx_entry->peer));
 }
 
 void rxd_progress_tx_list(struct rxd_ep *ep, struct rxd_peer *peer)
@@ -307,7 +314,7 @@ void rxd_progress_tx_list(struct rxd_ep *ep, struct rxd_peer *peer)
 
 		if (tx_entry->op == RXD_DATA_READ && !tx_entry->bytes_done) {
 			if (rxd_peer(ep, tx_entry->peer)->unacked_cnt >=
-		    	    rxd_peer(ep, tx_entry->peer)->tx_window) {
+		    	    rxd_peer_window(rxd_peer(ep, tx_entry->peer))) {
 				break;
 			}
 			tx_entry->start_seq = rxd_peer(ep,tx_entry->peer)->tx_seq_no;
@@ -897,6 +904,107 @@ static struct rxd_x_entry *rxd_get_data_x_entry(struct rxd_ep *ep,
 	return ofi_bufpool_get_ibuf(ep->tx_entry_pool.pool, data_pkt->ext_hdr.tx_id);
 }
 
+static void rxd_recv_unexp_data(struct rxd_ep *ep,
+				struct rxd_pkt_entry *pkt_entry)
+{
+	struct rxd_data_pkt *pkt = (struct rxd_data_pkt *) (pkt_entry->pkt);
+	struct rxd_unexp_msg *unexp_msg;
+
+	unexp_msg = rxd_peer(ep, pkt->base_hdr.peer)->curr_unexp;
+	dlist_insert_tail(&pkt_entry->d_entry, &unexp_msg->pkt_list);
+	if (pkt->ext_hdr.seg_no + 1 == unexp_msg->sar_hdr->num_segs - 1) {
+		rxd_peer(ep, pkt->base_hdr.peer)->curr_unexp = NULL;
+		rxd_ep_send_ack(ep, pkt->base_hdr.peer);
+	} else if (pkt->base_hdr.flags & RXD_ACK_REQ) {
+		rxd_ep_send_ack(ep, pkt->base_hdr.peer);
+	}
+}
+
+static int rxd_pkt_buffered(struct rxd_peer *peer, uint64_t seq)
+{
+	struct rxd_pkt_entry *buf_entry;
+
+	dlist_foreach_container(&peer->buf_pkts, struct rxd_pkt_entry,
+				buf_entry, d_entry) {
+		if (rxd_get_base_hdr(buf_entry)->seq_no == seq)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Hold an out of order data packet that fits in the selective ack window
+ * so that the sender only needs to retransmit the missing packets.
+ */
+static int rxd_buf_data_pkt(struct rxd_peer *peer,
+			    struct rxd_pkt_entry *pkt_entry)
+{
+	uint64_t seq = rxd_get_base_hdr(pkt_entry)->seq_no;
+
+	if (!ofi_before(peer->rx_seq_no, seq) ||
+	    seq - peer->rx_seq_no > RXD_SACK_BITS)
+		return 0;
+
+	dlist_insert_order(&peer->buf_pkts, &rxd_comp_pkt_seq_no,
+			   &pkt_entry->d_entry);
+	return 1;
+}
+
+/*
+ * Copy an out of order data packet of a message that is already being
+ * received straight into the user buffer, so that the packet buffer can be
+ * reposted right away.  Only the sequence number is kept, in the placed
+ * bitmap of the peer, until the missing packets arrive.
+ */
+static int rxd_place_data_pkt(struct rxd_ep *ep,
+			      struct rxd_pkt_entry *pkt_entry)
+{
+	struct rxd_data_pkt *pkt = (struct rxd_data_pkt *) (pkt_entry->pkt);
+	struct rxd_peer *peer = rxd_peer(ep, pkt->base_hdr.peer);
+	struct rxd_x_entry *rx_entry;
+	uint64_t seq = pkt->base_hdr.seq_no;
+	uint64_t dist;
+
+	if (pkt->base_hdr.type != RXD_DATA)
+		return 0;
+
+	dist = seq - peer->rx_seq_no;
+	if (!dist || dist >= RXD_SACK_BITS)
+		return 0;
+
+	if (rxd_peer_placed(peer) & (1ULL << dist))
+		return 1;
+
+	dlist_foreach_container(&peer->rx_list, struct rxd_x_entry,
+				rx_entry, entry) {
+		if (pkt->ext_hdr.seg_no + 1 >= rx_entry->num_segs ||
+		    rx_entry->start_seq + pkt->ext_hdr.seg_no + 1 != seq)
+			continue;
+
+		rxd_ep_copy_data(ep, rx_entry, pkt, pkt_entry->pkt_size);
+		assert(rx_entry->next_seg_no < rx_entry->num_segs);
+		peer->placed |= 1ULL << dist;
+		return 1;
+	}
+	return 0;
+}
+
+/* Move past the packets that were placed while waiting for seq_no */
+static void rxd_progress_placed(struct rxd_ep *ep, fi_addr_t addr)
+{
+	struct rxd_peer *peer = rxd_peer(ep, addr);
+
+	if (!(rxd_peer_placed(peer) & 1))
+		return;
+
+	while (peer->placed & 1) {
+		peer->placed >>= 1;
+		peer->placed_seq++;
+		peer->rx_seq_no++;
+	}
+	rxd_ep_send_ack(ep, addr);
+}
+
 static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
 {
 	struct fi_cq_err_entry err_entry;
@@ -916,11 +1024,22 @@ static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
 
 	bufpkts = &(rxd_peer(ep, peer)->buf_pkts);
 	while (!dlist_empty(bufpkts)) {
+		rxd_progress_placed(ep, peer);
 		pkt_entry = container_of(bufpkts->next, struct rxd_pkt_entry,
 					 d_entry);
 		base_hdr = rxd_get_base_hdr(pkt_entry);
+		if (ofi_before(base_hdr->seq_no, rxd_peer(ep, peer)->rx_seq_no)) {
+			rxd_remove_free_pkt_entry(pkt_entry);
+			continue;
+		}
 		if (base_hdr->seq_no != rxd_peer(ep, peer)->rx_seq_no)
 			return;
+		if (base_hdr->type == RXD_DATA && rxd_peer(ep, peer)->curr_unexp) {
+			rxd_peer(ep, peer)->rx_seq_no++;
+			dlist_remove(&pkt_entry->d_entry);
+			rxd_recv_unexp_data(ep, pkt_entry);
+			continue;
+		}
 		if (base_hdr->type == RXD_DATA || base_hdr->type == RXD_DATA_READ) {
 			data_pkt = (struct rxd_data_pkt *) pkt_entry->pkt;
 			rx_entry = rxd_get_data_x_entry(ep, data_pkt);
@@ -965,7 +1084,7 @@ static void rxd_handle_data(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 {
 	struct rxd_data_pkt *pkt = (struct rxd_data_pkt *) (pkt_entry->pkt);
 	struct rxd_x_entry *x_entry;
-	struct rxd_unexp_msg *unexp_msg;
+	int buffered;
 
 	if (pkt_entry->pkt_size < sizeof(*pkt) + ep->rx_prefix_size) {
 		FI_WARN(&rxd_prov, FI_LOG_CQ,
@@ -978,16 +1097,15 @@ static void rxd_handle_data(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 		rxd_peer(ep, pkt->base_hdr.peer)->rx_seq_no++;
 		if (pkt->base_hdr.type == RXD_DATA &&
 		    rxd_peer(ep, pkt->base_hdr.peer)->curr_unexp) {
-			unexp_msg = rxd_peer(ep, pkt->base_hdr.peer)->curr_unexp;
-			dlist_insert_tail(&pkt_entry->d_entry, &unexp_msg->pkt_list);
-			if (pkt->ext_hdr.seg_no + 1 == unexp_msg->sar_hdr->num_segs - 1) {
-				rxd_peer(ep, pkt->base_hdr.peer)->curr_unexp = NULL;
-				rxd_ep_send_ack(ep, pkt->base_hdr.peer);
-			}
+			rxd_recv_unexp_data(ep, pkt_entry);
+			if (!dlist_empty(&(rxd_peer(ep,
+					   pkt->base_hdr.peer)->buf_pkts)))
+				rxd_progress_buf_pkts(ep, pkt->base_hdr.peer);
 			return;
 		}
 		x_entry = rxd_get_data_x_entry(ep, pkt);
 		rxd_ep_recv_data(ep, x_entry, pkt, pkt_entry->pkt_size);
+		rxd_progress_placed(ep, pkt->base_hdr.peer);
 		if (!dlist_empty(&(rxd_peer(ep,
 				   pkt->base_hdr.peer)->buf_pkts)))
 			rxd_progress_buf_pkts(ep, pkt->base_hdr.peer);
@@ -998,7 +1116,16 @@ static void rxd_handle_data(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 		return;
 	} else if (rxd_peer(ep, pkt->base_hdr.peer)->peer_addr !=
 		   RXD_ADDR_INVALID) {
+		buffered = 0;
+		if (!rxd_pkt_buffered(rxd_peer(ep, pkt->base_hdr.peer),
+				      pkt->base_hdr.seq_no) &&
+		    !rxd_place_data_pkt(ep, pkt_entry))
+			buffered = rxd_buf_data_pkt(rxd_peer(ep,
+						    pkt->base_hdr.peer),
+						    pkt_entry);
 		rxd_ep_send_ack(ep, pkt->base_hdr.peer);
+		if (buffered)
+			return;
 	}
 free:
 	ofi_buf_free(pkt_entry);
@@ -1082,19 +1209,73 @@ static void rxd_handle_cts(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 	rxd_update_peer(ep, cts->rts_addr, cts->cts_addr);
 }
 
+static void rxd_sack_pkts(struct rxd_peer *peer, struct rxd_ack_pkt *ack)
+{
+	struct rxd_pkt_entry *pkt_entry;
+	uint64_t dist;
+
+	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		dist = rxd_get_base_hdr(pkt_entry)->seq_no -
+		       ack->base_hdr.seq_no;
+		if (dist && dist <= RXD_SACK_BITS &&
+		    (ack->sack & (1ULL << (dist - 1))))
+			pkt_entry->flags |= RXD_PKT_SACKED;
+		else
+			pkt_entry->flags &= ~RXD_PKT_SACKED;
+	}
+}
+
+/*
+ * Retransmit the packets the receiver is missing without waiting for the
+ * retry timeout: the head packet and every hole below the highest packet
+ * the receiver reported as buffered.
+ */
+static void rxd_fast_retry(struct rxd_ep *ep, struct rxd_peer *peer,
+			   struct rxd_ack_pkt *ack)
+{
+	struct rxd_pkt_entry *pkt_entry;
+	uint64_t dist;
+
+	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		if (ofi_before(rxd_get_base_hdr(pkt_entry)->seq_no,
+			       ack->base_hdr.seq_no))
+			continue;
+		dist = rxd_get_base_hdr(pkt_entry)->seq_no -
+		       ack->base_hdr.seq_no;
+		if (dist >= RXD_SACK_BITS || (dist && !(ack->sack >> dist)))
+			break;
+		if (pkt_entry->flags & (RXD_PKT_IN_USE | RXD_PKT_ACKED |
+					RXD_PKT_SACKED))
+			continue;
+		if (rxd_ep_send_pkt(ep, pkt_entry))
+			break;
+	}
+}
+
 static void rxd_handle_ack(struct rxd_ep *ep, struct rxd_pkt_entry *ack_entry)
 {
 	struct rxd_ack_pkt *ack = (struct rxd_ack_pkt *) (ack_entry->pkt);
 	struct rxd_pkt_entry *pkt_entry;
 	fi_addr_t peer = ack->base_hdr.peer;
 	struct rxd_base_hdr *hdr;
+	uint16_t acked = 0;
 
 	rxd_peer(ep, peer)->tx_window = (uint16_t) ack->ext_hdr.rx_id;
 
-	if (rxd_peer(ep, peer)->last_rx_ack == ack->base_hdr.seq_no)
+	if (rxd_peer(ep, peer)->last_rx_ack == ack->base_hdr.seq_no) {
+		rxd_sack_pkts(rxd_peer(ep, peer), ack);
+		if (++rxd_peer(ep, peer)->dup_ack_cnt == RXD_FAST_RETRY_ACKS) {
+			if (ack->sack)
+				rxd_cwnd_loss(rxd_peer(ep, peer), 0);
+			rxd_fast_retry(ep, rxd_peer(ep, peer), ack);
+		}
 		return;
+	}
 
 	rxd_peer(ep, peer)->last_rx_ack = ack->base_hdr.seq_no;
+	rxd_peer(ep, peer)->dup_ack_cnt = 0;
 
 	if (dlist_empty(&(rxd_peer(ep, peer)->unacked)))
 		return;
@@ -1110,6 +1291,8 @@ static void rxd_handle_ack(struct rxd_ep *ep, struct rxd_pkt_entry *ack_entry)
 			break;
 
 		if (pkt_entry->flags & RXD_PKT_IN_USE) {
+			if (!(pkt_entry->flags & RXD_PKT_ACKED))
+				acked++;
 			pkt_entry->flags |= RXD_PKT_ACKED;
 			pkt_entry = container_of((&pkt_entry->d_entry)->next,
 						 struct rxd_pkt_entry, d_entry);
@@ -1118,11 +1301,14 @@ static void rxd_handle_ack(struct rxd_ep *ep, struct rxd_pkt_entry *ack_entry)
 		rxd_remove_free_pkt_entry(pkt_entry);
 		rxd_peer(ep, peer)->unacked_cnt--;
 		rxd_peer(ep, peer)->retry_cnt = 0;
+		acked++;
 
 		pkt_entry = container_of((&(rxd_peer(ep, peer)->unacked))->next,
 					struct rxd_pkt_entry, d_entry);
 	}
 
+	rxd_cwnd_ack(rxd_peer(ep, peer), ack->base_hdr.seq_no, acked);
+	rxd_sack_pkts(rxd_peer(ep, peer), ack);
 	rxd_progress_tx_list(ep, rxd_peer(ep, ack->base_hdr.peer));
 }
 
@@ -285,6 +285,56 @@ uint64_t rxd_get_retry_time(uint64_t start, int retry_cnt)
 	return start + rxd_get_timeout(retry_cnt);
 }
 
+/*
+ * Update the RTT estimate (RFC 6298) and grow the congestion window:
+ * by one packet per acked packet in slow start, and by one packet per
+ * window of acked packets afterwards.
+ */
+void rxd_cwnd_ack(struct rxd_peer *peer, uint64_t ack_seq, uint16_t acked)
+{
+	uint64_t rtt, delta;
+
+	if (peer->rtt_pending && ofi_before(peer->rtt_seq, ack_seq)) {
+		rtt = ofi_gettime_us() - peer->rtt_start;
+		if (!peer->srtt) {
+			peer->srtt = rtt;
+			peer->rttvar = rtt / 2;
+		} else {
+			delta = peer->srtt > rtt ? peer->srtt - rtt :
+				rtt - peer->srtt;
+			peer->rttvar = (3 * peer->rttvar + delta) / 4;
+			peer->srtt = (7 * peer->srtt + rtt) / 8;
+		}
+		peer->srtt = MAX(peer->srtt, 1);
+		peer->rtt_pending = 0;
+	}
+
+	if (peer->cwnd < peer->ssthresh) {
+		peer->cwnd = (uint16_t) MIN(peer->cwnd + acked,
+					    rxd_env.max_unacked);
+		return;
+	}
+
+	peer->cwnd_acked += acked;
+	if (peer->cwnd_acked >= peer->cwnd) {
+		peer->cwnd_acked = 0;
+		if (peer->cwnd < rxd_env.max_unacked)
+			peer->cwnd++;
+	}
+}
+
+/*
+ * Halve the congestion window on a fast retransmit and collapse it on a
+ * retry timeout.  The timed packet may be a retransmission, so drop it.
+ */
+void rxd_cwnd_loss(struct rxd_peer *peer, int timeout)
+{
+	peer->ssthresh = MAX(peer->cwnd / 2, RXD_MIN_CWND);
+	peer->cwnd = timeout ? RXD_MIN_CWND : peer->ssthresh;
+	peer->cwnd_acked = 0;
+	peer->rtt_pending = 0;
+}
+
 void rxd_init_data_pkt(struct rxd_ep *ep, struct rxd_x_entry *tx_entry,
 		       struct rxd_pkt_entry *pkt_entry)
 {
@@ -374,19 +424,26 @@ void rxd_tx_entry_free(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 void rxd_insert_unacked(struct rxd_ep *ep, fi_addr_t peer,
 			struct rxd_pkt_entry *pkt_entry)
 {
-	dlist_insert_tail(&pkt_entry->d_entry,
-			  &(rxd_peer(ep, peer)->unacked));
-	rxd_peer(ep, peer)->unacked_cnt++;
+	struct rxd_peer *peer_entry = rxd_peer(ep, peer);
+
+	dlist_insert_tail(&pkt_entry->d_entry, &peer_entry->unacked);
+	peer_entry->unacked_cnt++;
+
+	if (!peer_entry->rtt_pending && rxd_is_data_pkt(pkt_entry)) {
+		peer_entry->rtt_seq = rxd_get_base_hdr(pkt_entry)->seq_no;
+		peer_entry->rtt_start = ofi_gettime_us();
+		peer_entry->rtt_pending = 1;
+	}
 }
 
 ssize_t rxd_ep_post_data_pkts(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 {
+	struct rxd_peer *peer = rxd_peer(ep, tx_entry->peer);
 	struct rxd_pkt_entry *pkt_entry;
 	struct rxd_data_pkt *data;
 
 	while (tx_entry->bytes_done != tx_entry->cq_entry.len) {
-		if (rxd_peer(ep, tx_entry->peer)->unacked_cnt >=
-		    rxd_peer(ep, tx_entry->peer)->tx_window)
+		if (peer->unacked_cnt >= rxd_peer_window(peer))
 			return 0;
 
 		pkt_entry = rxd_get_tx_pkt(ep);
@@ -401,12 +458,19 @@ ssize_t rxd_ep_post_data_pkts(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 		if (data->base_hdr.type != RXD_DATA_READ)
 			data->base_hdr.seq_no++;
 
+		/*
+		 * The receiver only acks every rx window on its own, ask for
+		 * an ack at half and at the end of the congestion window.
+		 */
+		if (peer->unacked_cnt + 1 == rxd_peer_window(peer) / 2 ||
+		    peer->unacked_cnt + 1 >= rxd_peer_window(peer))
+			data->base_hdr.flags |= RXD_ACK_REQ;
+
 		rxd_ep_send_pkt(ep, pkt_entry);
 		rxd_insert_unacked(ep, tx_entry->peer, pkt_entry);
 	}
 
-	return rxd_peer(ep, tx_entry->peer)->unacked_cnt >=
-	       rxd_peer(ep, tx_entry->peer)->tx_window;
+	return peer->unacked_cnt >= rxd_peer_window(peer);
 }
 
 ssize_t rxd_ep_send_pkt(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
@@ -557,6 +621,24 @@ size_t rxd_init_msg(void **ptr, const struct iovec *iov, size_t iov_count,
 	return done;
 }
 
+static uint64_t rxd_get_sack(struct rxd_peer *peer)
+{
+	struct rxd_pkt_entry *pkt_entry;
+	uint64_t seq, sack = 0;
+
+	dlist_foreach_container(&peer->buf_pkts, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		seq = rxd_get_base_hdr(pkt_entry)->seq_no;
+		if (!ofi_before(peer->rx_seq_no, seq))
+			continue;
+		if (seq - peer->rx_seq_no > RXD_SACK_BITS)
+			break;
+		sack |= 1ULL << (seq - peer->rx_seq_no - 1);
+	}
+
+	return sack | (rxd_peer_placed(peer) >> 1);
+}
+
 void rxd_ep_send_ack(struct rxd_ep *rxd_ep, fi_addr_t peer)
 {
 	struct rxd_pkt_entry *pkt_entry;
@@ -577,6 +659,7 @@ void rxd_ep_send_ack(struct rxd_ep *rxd_ep, fi_addr_t peer)
 	ack->base_hdr.peer = (uint32_t) rxd_peer(rxd_ep, peer)->peer_addr;
 	ack->base_hdr.seq_no = rxd_peer(rxd_ep, peer)->rx_seq_no;
 	ack->ext_hdr.rx_id = rxd_peer(rxd_ep, peer)->rx_window;
+	ack->sack = rxd_get_sack(rxd_peer(rxd_ep, peer));
 	rxd_peer(rxd_ep, peer)->last_tx_ack = ack->base_hdr.seq_no;
 
 	dlist_insert_tail(&pkt_entry->d_entry, &rxd_ep->ctrl_pkts);
@@ -611,6 +694,12 @@ static void rxd_close_peer(struct rxd_ep *ep, struct rxd_peer *peer)
 		peer->unacked_cnt--;
 	}
 
+	while (!dlist_empty(&peer->buf_pkts)) {
+		dlist_pop_front(&peer->buf_pkts, struct rxd_pkt_entry,
+				pkt_entry, d_entry);
+		ofi_buf_free(pkt_entry);
+	}
+
 	while (!dlist_empty(&peer->tx_list)) {
 		dlist_pop_front(&peer->tx_list, struct rxd_x_entry,
 				x_entry, entry);
@@ -917,9 +1006,9 @@ static void rxd_peer_timeout(struct rxd_ep *rxd_ep, struct rxd_peer *peer)
 static void rxd_progress_pkt_list(struct rxd_ep *ep, struct rxd_peer *peer)
 {
 	struct rxd_pkt_entry *pkt_entry;
-	uint64_t current;
+	uint64_t current, rto;
 	ssize_t ret;
-	int retry = 0;
+	int retry = 0, loss = 0;
 
 	current = ofi_gettime_ms();
 	if (peer->retry_cnt > RXD_MAX_PKT_RETRY) {
@@ -927,12 +1016,23 @@ static void rxd_progress_pkt_list(struct rxd_ep *ep, struct rxd_peer *peer)
 		return;
 	}
 
+	rto = (peer->srtt + 4 * peer->rttvar) / 1000;
+
 	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
 				pkt_entry, d_entry) {
+		if (pkt_entry->flags & RXD_PKT_SACKED)
+			continue;
 		if (pkt_entry->flags & (RXD_PKT_IN_USE | RXD_PKT_ACKED) ||
 		    current < rxd_get_retry_time(pkt_entry->timestamp,
-						 (uint8_t) peer->retry_cnt))
+						 (uint8_t) peer->retry_cnt) ||
+		    current < pkt_entry->timestamp + rto)
 			break;
+		/*
+		 * Data behind a dropped op packet is dropped with it, and with
+		 * millisecond timestamps the first timeout may be spurious.
+		 */
+		if (!retry)
+			loss = peer->retry_cnt && rxd_is_data_pkt(pkt_entry);
 		retry = 1;
 		ret = rxd_ep_send_pkt(ep, pkt_entry);
 		if (ret)
@@ -940,6 +1040,8 @@ static void rxd_progress_pkt_list(struct rxd_ep *ep, struct rxd_peer *peer)
 	}
 	if (retry)
 		peer->retry_cnt++;
+	if (loss)
+		rxd_cwnd_loss(peer, 1);
 
 	if (!dlist_empty(&peer->unacked))
 		ep->next_retry = ep->next_retry == -1 ? peer->retry_cnt :
@@ -987,7 +1089,9 @@ void rxd_ep_progress(struct util_ep *util_ep)
 	dlist_foreach_container_safe(&ep->active_peers, struct rxd_peer,
 				     peer, entry, tmp) {
 		rxd_progress_pkt_list(ep, peer);
-		if (dlist_empty(&peer->unacked))
+		if (dlist_empty(&peer->unacked) ||
+		    (!dlist_empty(&peer->tx_list) &&
+		     peer->unacked_cnt < rxd_peer_window(peer)))
 			rxd_progress_tx_list(ep, peer);
 	}
 
@@ -1164,6 +1268,15 @@ int rxd_create_peer(struct rxd_ep *ep, uint64_t rxd_addr)
 	peer->tx_window = (uint16_t) rxd_env.max_unacked;
 	peer->unacked_cnt = 0;
 	peer->retry_cnt = 0;
+	peer->dup_ack_cnt = 0;
+	peer->cwnd = (uint16_t) MIN(RXD_INIT_CWND, rxd_env.max_unacked);
+	peer->ssthresh = (uint16_t) rxd_env.max_unacked;
+	peer->cwnd_acked = 0;
+	peer->rtt_pending = 0;
+	peer->srtt = 0;
+	peer->rttvar = 0;
+	peer->placed = 0;
+	peer->placed_seq = 0;
 	peer->active = 0;
 	dlist_init(&(peer->unacked));
 	dlist_init(&(peer->tx_list));
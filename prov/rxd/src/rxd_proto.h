@@ -120,11 +120,12 @@ struct rxd_cts_pkt {
 
 /*
  * ACK: to signal received packets and send tx/rx id info
+ * Bit i of sack is set if packet seq_no + 1 + i is buffered by the receiver
  */
 struct rxd_ack_pkt {
 	struct rxd_base_hdr	base_hdr;
 	struct rxd_ext_hdr	ext_hdr;
-	//TODO fill in more fields? Selective ack?
+	uint64_t		sack;
 };
 
 /*
@@ -124,6 +124,8 @@ extern size_t rxm_packet_size;
 
 #define RXM_SAR_TX_ERROR	UINT64_MAX
 #define RXM_SAR_RX_INIT		UINT64_MAX
+/* Buckets per connection for reassembly lookups, must be a power of 2 */
+#define RXM_SAR_HASH_SIZE	16
 
 #define RXM_IOV_LIMIT 4
 
@@ -200,11 +202,23 @@ enum {
 
 extern size_t rxm_msg_tx_size;
 extern size_t rxm_msg_rx_size;
+extern size_t rxm_msg_rx_min;
 extern size_t rxm_cm_progress_interval;
 extern size_t rxm_cq_eq_fairness;
 extern int rxm_passthru;
 extern int force_auto_progress;
 extern int rxm_use_write_rndv;
+extern size_t rxm_sar_limit;
+extern size_t rxm_sar_window;
+extern size_t rxm_rndv_chunk_size;
+extern size_t rxm_rndv_window;
+extern size_t rxm_staging_size;
+extern int rxm_proto_tune;
+extern int rxm_msg_atomics;
+extern size_t rxm_conn_max;
+extern size_t rxm_conn_idle_timeout;
+extern int rxm_enable_direct_send;
+extern int rxm_comp_per_progress;
 extern enum fi_wait_obj def_wait_obj, def_tcp_wait_obj;
 
 struct rxm_ep;
@@ -220,6 +234,53 @@ enum rxm_cm_state {
 
 enum {
 	RXM_CONN_INDEXED = BIT(0),
+	/* FI_OFI_RXM_CONN_MAX close handshake, new transfers wait while
+	 * any is set: we asked the peer to close, we agreed to the peer's
+	 * request, or the peer agreed to ours and the conn can be freed.
+	 */
+	RXM_CONN_CLOSING = BIT(1),
+	RXM_CONN_CLOSE_ACKED = BIT(2),
+	RXM_CONN_CLOSE_READY = BIT(3),
+};
+
+#define RXM_CONN_CLOSE_FLAGS \
+	(RXM_CONN_CLOSING | RXM_CONN_CLOSE_ACKED | RXM_CONN_CLOSE_READY)
+
+/* Samples of each protocol needed before moving the switch point, and how
+ * often a send near the switch point is made with the other protocol.
+ */
+#define RXM_TUNE_SAMPLES	16
+#define RXM_TUNE_PROBE		16
+
+/* FI_OFI_RXM_MSG_RX_MIN: a connection whose peer consumes all of its posted
+ * receive buffers within RXM_RX_CREDIT_BUSY ns posts twice as many, and one
+ * taking longer than RXM_RX_CREDIT_IDLE ns drops back by half.
+ */
+#define RXM_RX_CREDIT_BUSY	1000000ULL
+#define RXM_RX_CREDIT_IDLE	100000000ULL
+
+/* FI_OFI_RXM_PROTO_TUNE: measured cost, in ns per KiB, of the SAR and
+ * rendezvous sends to one peer that are near the switch point between
+ * them.  sar_limit is moved toward the cheaper protocol.
+ */
+struct rxm_proto_tune {
+	size_t sar_limit;
+	uint64_t sar_cost;
+	uint64_t rndv_cost;
+	uint32_t sar_cnt;
+	uint32_t rndv_cnt;
+	uint32_t probe;
+};
+
+/* Receive buffers posted to a msg ep without srx, or to the srx.  With
+ * FI_OFI_RXM_MSG_RX_MIN set, target moves between that value and the msg
+ * rx size, and cnt/start time how quickly the buffers are used.
+ */
+struct rxm_rx_credit {
+	size_t posted;
+	size_t target;
+	size_t cnt;
+	uint64_t start;
 };
 
 /* Each local rxm ep will have at most 1 connection to a single
@@ -245,12 +306,38 @@ struct rxm_conn {
 
 	struct dlist_entry deferred_entry;
 	struct dlist_entry deferred_tx_queue;
-	struct dlist_entry deferred_sar_msgs;
+	/* receives being reassembled, hashed by msg_id */
+	struct dlist_entry deferred_sar_msgs[RXM_SAR_HASH_SIZE];
 	struct dlist_entry deferred_sar_segments;
 	struct dlist_entry loopback_entry;
+	struct rxm_proto_tune tune;
+
+	/* Receive buffers posted to msg_ep when it has no srx */
+	struct rxm_rx_credit rx_credit;
+
+	/* FI_OFI_RXM_CONN_MAX: position in the endpoint's LRU list of
+	 * connected peers and time of the last transfer (ms).  rndv_rx
+	 * counts rendezvous receives in progress.
+	 */
+	struct dlist_entry lru_entry;
+	uint64_t last_used;
+	size_t rndv_rx;
 };
 
 void rxm_freeall_conns(struct rxm_ep *ep);
+void rxm_touch_conn(struct rxm_conn *conn);
+
+static inline bool
+rxm_tune_near(const struct rxm_proto_tune *tune, size_t len)
+{
+	return len > tune->sar_limit / 2 && len <= tune->sar_limit * 2;
+}
+
+static inline struct dlist_entry *
+rxm_sar_bucket(struct rxm_conn *conn, uint64_t msg_id)
+{
+	return &conn->deferred_sar_msgs[msg_id & (RXM_SAR_HASH_SIZE - 1)];
+}
 
 struct rxm_fabric {
 	struct util_fabric util_fabric;
@@ -269,8 +356,9 @@ struct rxm_domain {
 	uint64_t mr_key;
 	bool passthru;
 	struct ofi_ops_flow_ctrl *flow_ctrl_ops;
+	/* shared by all endpoints, OFI_BUFPOOL_PERTHREAD needs no lock */
 	struct ofi_bufpool *amo_bufpool;
-	ofi_mutex_t amo_bufpool_lock;
+	struct ofi_hmem_staging *staging;
 	struct fid_domain *util_coll_domain;
 	struct fid_domain *offload_coll_domain;
 	uint64_t offload_coll_mask;
@@ -328,6 +416,21 @@ struct rxm_rndv_hdr {
 #define rxm_pkt_rndv_data(rxm_pkt) \
 	((rxm_pkt)->data + sizeof(struct rxm_rndv_hdr))
 
+/* Progress of a rendezvous transfer issued as a series of RMA chunks.
+ * rma_* tracks the position in the peer's rendezvous iov, and iov_* the
+ * position in the local buffer.  err holds the first chunk failure, which
+ * is reported in place of the success completion.
+ */
+struct rxm_rndv_xfer {
+	size_t rma_index;
+	size_t rma_offset;
+	size_t iov_index;
+	size_t iov_offset;
+	size_t remain;
+	size_t inflight;
+	int err;
+};
+
 struct rxm_atomic_hdr {
 	struct fi_rma_ioc rma_ioc[RXM_IOV_LIMIT];
 	char data[];
@@ -379,7 +482,8 @@ struct rxm_atomic_resp_hdr {
 	FUNC(RXM_RNDV_WRITE_DONE_RECVD),\
 	FUNC(RXM_RNDV_FINISH), /* not needed */	\
 	FUNC(RXM_ATOMIC_RESP_WAIT),	\
-	FUNC(RXM_ATOMIC_RESP_SENT)
+	FUNC(RXM_ATOMIC_RESP_SENT),	\
+	FUNC(RXM_ATOMIC_MSG)
 
 enum rxm_proto_state {
 	RXM_PROTO_STATES(OFI_ENUM_VAL)
@@ -396,7 +500,11 @@ enum {
 	rxm_ctrl_atomic_resp,
 	rxm_ctrl_credit,
 	rxm_ctrl_rndv_wr_data,
-	rxm_ctrl_rndv_wr_done
+	rxm_ctrl_rndv_wr_done,
+	rxm_ctrl_close_req,
+	rxm_ctrl_close_ack,
+	rxm_ctrl_close_nack,
+	rxm_ctrl_rndv_wr_abort,
 };
 
 struct rxm_pkt {
@@ -437,6 +545,8 @@ struct rxm_recv_match_attr {
 
 struct rxm_unexp_msg {
 	struct dlist_entry entry;
+	/* tag bucket of the tagged recv queue, or self linked */
+	struct dlist_entry bucket_entry;
 	fi_addr_t addr;
 	uint64_t tag;
 };
@@ -474,7 +584,7 @@ struct rxm_rx_buf {
 	/* Used for large messages */
 	struct dlist_entry rndv_wait_entry;
 	struct rxm_rndv_hdr *remote_rndv_hdr;
-	size_t rndv_rma_index;
+	struct rxm_rndv_xfer rndv_xfer;
 	struct fid_mr *mr[RXM_IOV_LIMIT];
 
 	/* Only differs from pkt.data for unexpected messages */
@@ -497,18 +607,27 @@ struct rxm_tx_buf {
 			uint8_t count;
 		} rma;
 		struct rxm_iov atomic_result;
+		/* first SAR segment: segments posted but not completed */
+		size_t sar_inflight;
 	};
 
 	struct {
 		struct iovec iov[RXM_IOV_LIMIT];
 		void *desc[RXM_IOV_LIMIT];
 		struct rxm_conn *conn;
-		size_t rndv_rma_index;
-		size_t rndv_rma_count;
+		struct rxm_rndv_xfer xfer;
 		struct rxm_tx_buf *done_buf;
 		struct rxm_rndv_hdr remote_hdr;
 	} write_rndv;
 
+	/* SAR (first segment) and rendezvous sends being timed for
+	 * FI_OFI_RXM_PROTO_TUNE.  start is 0 if the send is not timed.
+	 */
+	struct {
+		struct rxm_conn *conn;
+		uint64_t start;
+	} tune;
+
 	/* Must stay at bottom */
 	struct rxm_pkt pkt;
 };
@@ -603,6 +722,7 @@ struct rxm_recv_entry {
 	uint64_t tag;
 	uint64_t ignore;
 	uint64_t comp_flags;
+	uint64_t seq_no;
 	size_t total_len;
 	struct rxm_recv_queue *recv_queue;
 
@@ -610,6 +730,8 @@ struct rxm_recv_entry {
 	struct {
 		struct dlist_entry entry;
 		size_t total_recv_len;
+		/* segment bytes received, which may exceed the bytes copied */
+		size_t data_len;
 		struct rxm_conn *conn;
 		uint64_t msg_id;
 	} sar;
@@ -635,6 +757,17 @@ struct rxm_recv_queue {
 	struct dlist_entry	unexp_msg_list;
 	dlist_func_t		*match_recv;
 	dlist_func_t		*match_unexp;
+
+	/* Tagged queues only, when FI_SRX_TAG_BUCKETS is set.  Receives with
+	 * ignore == 0 are hashed by (addr, tag) into recv_buckets instead of
+	 * recv_list, and seq_no picks the oldest match across the two.
+	 * Unexpected messages stay on unexp_msg_list and are also hashed by
+	 * tag alone, since a receive need not name its source.
+	 */
+	uint64_t		seq_no;
+	struct dlist_entry	*recv_buckets;
+	struct dlist_entry	*unexp_buckets;
+	size_t			bucket_mask;
 };
 
 struct rxm_eager_ops {
@@ -651,7 +784,7 @@ struct rxm_rndv_ops {
 			size_t count, fi_addr_t remote_addr, uint64_t addr,
 			uint64_t key, void *context);
 	ssize_t (*defer_xfer)(struct rxm_deferred_tx_entry **def_tx_entry,
-			      size_t index, struct iovec *iov,
+			      uint64_t addr, uint64_t key, struct iovec *iov,
 			      void *desc[RXM_IOV_LIMIT], size_t count,
 			      void *buf);
 };
@@ -664,12 +797,17 @@ struct rxm_ep {
 	int			connecting_cnt;
 	struct index_map	conn_idx_map;
 	struct dlist_entry	loopback_list;
+	/* connected, indexed conns, least recently used first */
+	struct dlist_entry	conn_lru;
+	size_t			conn_cnt;
+	size_t			closing_cnt;
 	union ofi_sock_ip	addr;
 
 	pthread_t		cm_thread;
 	struct fid_pep 		*msg_pep;
 	struct fid_eq 		*msg_eq;
 	struct fid_ep 		*msg_srx;
+	struct rxm_rx_credit	srx_credit;
 	struct fid_ep		*util_coll_ep;
 	struct fid_ep		*offload_coll_ep;
 	struct fi_ops_transfer_peer *util_coll_peer_xfer_ops;
@@ -693,6 +831,7 @@ struct rxm_ep {
 	size_t			buffered_min;
 	size_t			buffered_limit;
 	size_t			inject_limit;
+	size_t			tag_buckets;
 
 	size_t			eager_limit;
 	size_t			sar_limit;
@@ -706,10 +845,22 @@ struct rxm_ep {
 	struct dlist_entry	deferred_queue;
 	struct dlist_entry	rndv_wait_list;
 
+	/* Receive buffers freed while a batch of msg completions is being
+	 * handled are posted together once the batch is done.
+	 */
+	bool			repost_batch;
+	struct dlist_entry	repost_list;
+
 	struct rxm_recv_queue	recv_queue;
 	struct rxm_recv_queue	trecv_queue;
 	struct ofi_bufpool	*multi_recv_pool;
 
+	/* FI_OFI_RXM_MSG_ATOMICS: bit (1 << op) is set for each datatype
+	 * the msg provider handles natively, indexed by ofi_op_atomic,
+	 * ofi_op_atomic_fetch and ofi_op_atomic_compare.
+	 */
+	uint32_t		msg_atomic_ops[3][FI_DATATYPE_LAST];
+
 	struct rxm_eager_ops	*eager_ops;
 	struct rxm_rndv_ops	*rndv_ops;
 };
@@ -742,6 +893,7 @@ int rxm_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 int rxm_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 			 struct fid_cq **cq_fid, void *context);
 ssize_t rxm_handle_rx_buf(struct rxm_rx_buf *rx_buf);
+ssize_t rxm_handle_close_ctrl(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf);
 
 int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 			  struct fid_ep **ep, void *context);
@@ -766,10 +918,17 @@ void rxm_finish_coll_eager_send(struct rxm_ep *rxm_ep,
 
 int rxm_prepost_recv(struct rxm_ep *rxm_ep, struct fid_ep *rx_ep);
 
+void rxm_ep_init_msg_atomics(struct rxm_ep *ep);
 int rxm_ep_query_atomic(struct fid_domain *domain, enum fi_datatype datatype,
 			enum fi_op op, struct fi_atomic_attr *attr,
 			uint64_t flags);
 ssize_t rxm_rndv_read(struct rxm_rx_buf *rx_buf);
+void rxm_rndv_read_chunk_err(struct rxm_rx_buf *rx_buf, int err);
+void rxm_rndv_write_chunk_err(struct rxm_ep *rxm_ep,
+			      struct rxm_tx_buf *tx_buf, int err);
+void rxm_rndv_rd_done_err(struct rxm_rx_buf *rx_buf, int err);
+void rxm_rndv_wr_done_err(struct rxm_ep *rxm_ep, struct rxm_tx_buf *tx_buf,
+			  int err);
 ssize_t rxm_rndv_send_wr_data(struct rxm_rx_buf *rx_buf);
 void rxm_rndv_hdr_init(struct rxm_ep *rxm_ep, void *buf,
 			      const struct iovec *iov, size_t count,
@@ -949,6 +1108,13 @@ rxm_recv_entry_get(struct rxm_ep *rxm_ep, const struct iovec *iov,
 		   void **desc, size_t count, fi_addr_t src_addr,
 		   uint64_t tag, uint64_t ignore, void *context,
 		   uint64_t flags, struct rxm_recv_queue *recv_queue);
+void rxm_insert_recv(struct rxm_recv_queue *recv_queue,
+		     struct rxm_recv_entry *recv_entry);
+struct rxm_recv_entry *
+rxm_remove_recv(struct rxm_recv_queue *recv_queue,
+		struct rxm_recv_match_attr *match_attr);
+void rxm_insert_unexp_msg(struct rxm_recv_queue *recv_queue,
+			  struct rxm_rx_buf *rx_buf);
 struct rxm_rx_buf *
 rxm_get_unexp_msg(struct rxm_recv_queue *recv_queue, fi_addr_t addr,
 		  uint64_t tag, uint64_t ignore);
@@ -956,9 +1122,18 @@ ssize_t rxm_handle_unexp_sar(struct rxm_recv_queue *recv_queue,
 			     struct rxm_recv_entry *recv_entry,
 			     struct rxm_rx_buf *rx_buf);
 int rxm_post_recv(struct rxm_rx_buf *rx_buf);
+int rxm_repost_recv(struct rxm_rx_buf *rx_buf);
+void rxm_flush_reposts(struct rxm_ep *ep);
 void rxm_av_remove_handler(struct util_ep *util_ep,
 			   struct util_peer_addr *peer);
 
+static inline struct rxm_rx_credit *
+rxm_rx_buf_credit(struct rxm_rx_buf *rx_buf)
+{
+	return rx_buf->ep->msg_srx ? &rx_buf->ep->srx_credit :
+				     &rx_buf->conn->rx_credit;
+}
+
 static inline void
 rxm_free_rx_buf(struct rxm_rx_buf *rx_buf)
 {
@@ -968,13 +1143,22 @@ rxm_free_rx_buf(struct rxm_rx_buf *rx_buf)
 	}
 
 	/* Discard rx buffer if its msg_ep was closed */
-	if (rx_buf->repost && (rx_buf->ep->msg_srx || rx_buf->conn->msg_ep)) {
-		rxm_post_recv(rx_buf);
+	if (rx_buf->repost &&
+	    (rx_buf->ep->msg_srx || rx_buf->conn->msg_ep) &&
+	    rxm_rx_buf_credit(rx_buf)->posted <
+	    rxm_rx_buf_credit(rx_buf)->target) {
+		rxm_repost_recv(rx_buf);
 	} else {
 		ofi_buf_free(rx_buf);
 	}
 }
 
+static inline void rxm_remove_unexp_msg(struct rxm_rx_buf *rx_buf)
+{
+	dlist_remove(&rx_buf->unexp_msg.entry);
+	dlist_remove(&rx_buf->unexp_msg.bucket_entry);
+}
+
 static inline void
 rxm_recv_entry_release(struct rxm_recv_entry *entry)
 {
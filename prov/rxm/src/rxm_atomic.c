@@ -87,6 +87,95 @@ rxm_ep_send_atomic_req(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	return ret;
 }
 
+static inline void *rxm_msg_atomic_desc(struct rxm_ep *rxm_ep, void **desc)
+{
+	return rxm_ep->msg_mr_local ?
+	       fi_mr_desc(((struct rxm_mr *) desc[0])->msg_mr) : NULL;
+}
+
+/* Single element atomics on registered memory that the msg provider
+ * supports natively bypass the software emulation at the target.
+ */
+static bool
+rxm_ep_msg_atomic_ok(struct rxm_ep *rxm_ep, const struct fi_msg_atomic *msg,
+		     void **compare_desc, size_t compare_iov_count,
+		     void **result_desc, size_t result_iov_count,
+		     uint8_t op, uint64_t flags)
+{
+	if (msg->datatype >= FI_DATATYPE_LAST || msg->op >= FI_ATOMIC_OP_LAST ||
+	    !(rxm_ep->msg_atomic_ops[op - ofi_op_atomic][msg->datatype] &
+	      (1U << msg->op)))
+		return false;
+
+	if ((flags & FI_INJECT) || msg->iov_count != 1 ||
+	    msg->msg_iov[0].count != 1 || msg->rma_iov_count != 1 ||
+	    (op == ofi_op_atomic_compare && compare_iov_count != 1) ||
+	    (op != ofi_op_atomic && result_iov_count != 1))
+		return false;
+
+	if (!rxm_ep->msg_mr_local)
+		return true;
+
+	/* The msg provider needs local descriptors.  Buffers that are not
+	 * registered through rxm are left to the software path.
+	 */
+	return rxm_ep->rdm_mr_local &&
+	       (msg->op == FI_ATOMIC_READ || (msg->desc && msg->desc[0])) &&
+	       (op != ofi_op_atomic_compare ||
+		(compare_desc && compare_desc[0])) &&
+	       (op == ofi_op_atomic || (result_desc && result_desc[0]));
+}
+
+static ssize_t
+rxm_ep_msg_atomic(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
+		  const struct fi_msg_atomic *msg, const struct fi_ioc *comparev,
+		  void **compare_desc, struct fi_ioc *resultv,
+		  void **result_desc, uint8_t op, uint64_t flags)
+{
+	struct fi_msg_atomic msg_atomic = *msg;
+	struct rxm_tx_buf *tx_buf;
+	void *desc = NULL, *cmp_desc = NULL, *res_desc = NULL;
+	ssize_t ret;
+
+	tx_buf = rxm_get_tx_buf(rxm_ep);
+	if (!tx_buf)
+		return -FI_EAGAIN;
+
+	tx_buf->hdr.state = RXM_ATOMIC_MSG;
+	tx_buf->pkt.hdr.op = op;
+	tx_buf->app_context = msg->context;
+	tx_buf->flags = flags;
+
+	if (msg->op != FI_ATOMIC_READ && msg->desc)
+		desc = rxm_msg_atomic_desc(rxm_ep, msg->desc);
+	if (op == ofi_op_atomic_compare)
+		cmp_desc = rxm_msg_atomic_desc(rxm_ep, compare_desc);
+	if (op != ofi_op_atomic)
+		res_desc = rxm_msg_atomic_desc(rxm_ep, result_desc);
+
+	msg_atomic.desc = &desc;
+	msg_atomic.context = tx_buf;
+
+	switch (op) {
+	case ofi_op_atomic:
+		ret = fi_atomicmsg(rxm_conn->msg_ep, &msg_atomic, flags);
+		break;
+	case ofi_op_atomic_fetch:
+		ret = fi_fetch_atomicmsg(rxm_conn->msg_ep, &msg_atomic,
+					 resultv, &res_desc, 1, flags);
+		break;
+	default:
+		ret = fi_compare_atomicmsg(rxm_conn->msg_ep, &msg_atomic,
+					   comparev, &cmp_desc, 1, resultv,
+					   &res_desc, 1, flags);
+		break;
+	}
+
+	if (ret)
+		rxm_free_tx_buf(rxm_ep, tx_buf);
+	return ret;
+}
+
 static ssize_t
 rxm_ep_atomic_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		const struct fi_msg_atomic *msg, const struct fi_ioc *comparev,
@@ -118,6 +207,12 @@ rxm_ep_atomic_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		return -FI_EINVAL;
 	}
 
+	if (rxm_ep_msg_atomic_ok(rxm_ep, msg, compare_desc, compare_iov_count,
+				 result_desc, result_iov_count, op, flags))
+		return rxm_ep_msg_atomic(rxm_ep, rxm_conn, msg, comparev,
+					 compare_desc, resultv, result_desc,
+					 op, flags);
+
 	if (msg->op != FI_ATOMIC_READ) {
 		assert(msg->msg_iov);
 		ofi_ioc_to_iov(msg->msg_iov, buf_iov, msg->iov_count,
@@ -493,6 +588,35 @@ rxm_ep_atomic_compwrite(struct fid_ep *ep_fid, const void *buf, size_t count,
 					datatype, op, context);
 }
 
+void rxm_ep_init_msg_atomics(struct rxm_ep *ep)
+{
+	static const uint64_t query_flags[] = {
+		0, FI_FETCH_ATOMIC, FI_COMPARE_ATOMIC
+	};
+	struct rxm_domain *domain;
+	struct fi_atomic_attr attr;
+	int i, datatype, op;
+
+	memset(ep->msg_atomic_ops, 0, sizeof(ep->msg_atomic_ops));
+	if (!rxm_msg_atomics || !(ep->rxm_info->caps & FI_ATOMIC))
+		return;
+
+	domain = container_of(ep->util_ep.domain, struct rxm_domain,
+			      util_domain);
+	for (i = 0; i < 3; i++) {
+		for (datatype = 0; datatype < FI_DATATYPE_LAST; datatype++) {
+			for (op = 0; op < FI_ATOMIC_OP_LAST; op++) {
+				if (!fi_query_atomic(domain->msg_domain,
+						     datatype, op, &attr,
+						     query_flags[i]) &&
+				    attr.count)
+					ep->msg_atomic_ops[i][datatype] |=
+						1U << op;
+			}
+		}
+	}
+}
+
 int rxm_ep_query_atomic(struct fid_domain *domain, enum fi_datatype datatype,
 			enum fi_op op, struct fi_atomic_attr *attr,
 			uint64_t flags)
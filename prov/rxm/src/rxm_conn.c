@@ -43,6 +43,7 @@
 static void *rxm_cm_progress(void *arg);
 static void *rxm_cm_atomic_progress(void *arg);
 static void rxm_flush_msg_cq(struct rxm_ep *rxm_ep);
+static void rxm_evict_conns(struct rxm_ep *ep, size_t pending);
 
 
 /* castable to fi_eq_cm_entry - we can't use fi_eq_cm_entry directly
@@ -60,10 +61,20 @@ static void rxm_close_conn(struct rxm_conn *conn)
 	struct rxm_deferred_tx_entry *tx_entry;
 	struct rxm_recv_entry *rx_entry;
 	struct rxm_rx_buf *buf;
+	int i;
 
 	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "closing conn %p\n", conn);
 
 	assert(ofi_genlock_held(&conn->ep->util_ep.lock));
+	if (!dlist_empty(&conn->lru_entry)) {
+		dlist_remove_init(&conn->lru_entry);
+		conn->ep->conn_cnt--;
+	}
+	if (conn->flags & RXM_CONN_CLOSE_FLAGS) {
+		conn->flags &= ~RXM_CONN_CLOSE_FLAGS;
+		conn->ep->closing_cnt--;
+	}
+
 	/* All deferred transfers are internally generated */
 	while (!dlist_empty(&conn->deferred_tx_queue)) {
 		tx_entry = container_of(conn->deferred_tx_queue.next,
@@ -79,11 +90,13 @@ static void rxm_close_conn(struct rxm_conn *conn)
 		rxm_free_rx_buf(buf);
 	}
 
-	while (!dlist_empty(&conn->deferred_sar_msgs)) {
-		rx_entry = container_of(conn->deferred_sar_msgs.next,
-					struct rxm_recv_entry, sar.entry);
-		dlist_remove(&rx_entry->entry);
-		rxm_recv_entry_release(rx_entry);
+	for (i = 0; i < RXM_SAR_HASH_SIZE; i++) {
+		while (!dlist_empty(&conn->deferred_sar_msgs[i])) {
+			rx_entry = container_of(conn->deferred_sar_msgs[i].next,
+						struct rxm_recv_entry, sar.entry);
+			dlist_remove(&rx_entry->sar.entry);
+			rxm_recv_entry_release(rx_entry);
+		}
 	}
 	fi_close(&conn->msg_ep->fid);
 	rxm_flush_msg_cq(conn->ep);
@@ -318,6 +331,7 @@ static int rxm_connect(struct rxm_conn *conn)
 
 	switch (conn->state) {
 	case RXM_CM_IDLE:
+		rxm_evict_conns(conn->ep, 1);
 		ret = rxm_send_connect(conn);
 		if (ret)
 			return ret;
@@ -392,6 +406,7 @@ rxm_alloc_conn(struct rxm_ep *ep, struct util_peer_addr *peer)
 {
 	struct rxm_conn *conn;
 	struct rxm_av *av;
+	int i;
 
 	assert(ofi_genlock_held(&ep->util_ep.lock));
 	av = container_of(ep->util_ep.av, struct rxm_av, util_av);
@@ -407,9 +422,14 @@ rxm_alloc_conn(struct rxm_ep *ep, struct util_peer_addr *peer)
 	conn->flags = 0;
 	dlist_init(&conn->deferred_entry);
 	dlist_init(&conn->deferred_tx_queue);
-	dlist_init(&conn->deferred_sar_msgs);
+	for (i = 0; i < RXM_SAR_HASH_SIZE; i++)
+		dlist_init(&conn->deferred_sar_msgs[i]);
 	dlist_init(&conn->deferred_sar_segments);
 	dlist_init(&conn->loopback_entry);
+	dlist_init(&conn->lru_entry);
+	conn->rndv_rx = 0;
+	memset(&conn->tune, 0, sizeof(conn->tune));
+	conn->tune.sar_limit = ep->sar_limit;
 
 	conn->peer = peer;
 	rxm_ref_peer(peer);
@@ -442,6 +462,221 @@ rxm_add_conn(struct rxm_ep *ep, struct util_peer_addr *peer)
 	return conn;
 }
 
+void rxm_touch_conn(struct rxm_conn *conn)
+{
+	conn->last_used = ofi_gettime_ms();
+	if (!dlist_empty(&conn->lru_entry) &&
+	    !(conn->flags & RXM_CONN_CLOSE_READY)) {
+		dlist_remove(&conn->lru_entry);
+		dlist_insert_tail(&conn->lru_entry, &conn->ep->conn_lru);
+	}
+}
+
+static void rxm_set_closing(struct rxm_conn *conn, int flag)
+{
+	if (!(conn->flags & RXM_CONN_CLOSE_FLAGS))
+		conn->ep->closing_cnt++;
+	conn->flags |= flag;
+}
+
+static void rxm_clear_closing(struct rxm_conn *conn)
+{
+	if (conn->flags & RXM_CONN_CLOSE_FLAGS) {
+		conn->flags &= ~RXM_CONN_CLOSE_FLAGS;
+		conn->ep->closing_cnt--;
+	}
+	rxm_touch_conn(conn);
+}
+
+static bool
+rxm_unexp_has_conn(struct rxm_recv_queue *queue, struct rxm_conn *conn)
+{
+	struct rxm_rx_buf *rx_buf;
+
+	dlist_foreach_container(&queue->unexp_msg_list, struct rxm_rx_buf,
+				rx_buf, unexp_msg.entry) {
+		if (rx_buf->conn == conn)
+			return true;
+	}
+	return false;
+}
+
+/* Nothing queued or in progress on the conn would reference it once it
+ * is closed.  RMA issued by the application is not tracked, the idle
+ * timeout is expected to cover it.
+ */
+static bool rxm_conn_quiesced(struct rxm_conn *conn)
+{
+	int i;
+
+	if (conn->state != RXM_CM_CONNECTED ||
+	    !(conn->flags & RXM_CONN_INDEXED) || conn->rndv_rx ||
+	    !dlist_empty(&conn->deferred_tx_queue) ||
+	    !dlist_empty(&conn->deferred_sar_segments))
+		return false;
+
+	for (i = 0; i < RXM_SAR_HASH_SIZE; i++) {
+		if (!dlist_empty(&conn->deferred_sar_msgs[i]))
+			return false;
+	}
+
+	return !rxm_unexp_has_conn(&conn->ep->recv_queue, conn) &&
+	       !rxm_unexp_has_conn(&conn->ep->trecv_queue, conn);
+}
+
+static bool rxm_conn_idle(struct rxm_conn *conn, uint64_t now)
+{
+	return now - conn->last_used >= rxm_conn_idle_timeout;
+}
+
+/* Close handshake messages are sent like credit updates, and queued
+ * behind other deferred transfers if the msg ep is busy, so a reply
+ * is never lost.
+ */
+static int rxm_send_close_ctrl(struct rxm_conn *conn, uint8_t type)
+{
+	struct rxm_deferred_tx_entry *def_tx_entry;
+	struct rxm_tx_buf *tx_buf;
+	struct iovec iov;
+	struct fi_msg msg;
+	ssize_t ret;
+
+	tx_buf = ofi_buf_alloc(conn->ep->tx_pool);
+	if (!tx_buf)
+		return -FI_ENOMEM;
+
+	tx_buf->hdr.state = RXM_CREDIT_TX;
+	rxm_ep_format_tx_buf_pkt(conn, 0, type, 0, 0, FI_SEND, &tx_buf->pkt);
+	tx_buf->pkt.ctrl_hdr.type = type;
+	tx_buf->pkt.ctrl_hdr.msg_id = ofi_buf_index(tx_buf);
+
+	iov.iov_base = &tx_buf->pkt;
+	iov.iov_len = sizeof(struct rxm_pkt);
+	msg.msg_iov = &iov;
+	msg.iov_count = 1;
+	msg.addr = 0;
+	msg.context = tx_buf;
+	msg.data = 0;
+	msg.desc = &tx_buf->hdr.desc;
+
+	ret = fi_sendmsg(conn->msg_ep, &msg, FI_PRIORITY);
+	if (!ret)
+		return FI_SUCCESS;
+
+	def_tx_entry = rxm_ep_alloc_deferred_tx_entry(
+		conn->ep, conn, RXM_DEFERRED_TX_CREDIT_SEND);
+	if (!def_tx_entry) {
+		ofi_buf_free(tx_buf);
+		return -FI_ENOMEM;
+	}
+
+	def_tx_entry->credit_msg.tx_buf = tx_buf;
+	rxm_queue_deferred_tx(def_tx_entry, OFI_LIST_TAIL);
+	return FI_SUCCESS;
+}
+
+/* Ask the peers of the least recently used idle conns to close, until
+ * the conns open or being opened, plus pending new ones, fit in
+ * FI_OFI_RXM_CONN_MAX once the handshakes finish.
+ */
+static void rxm_evict_conns(struct rxm_ep *ep, size_t pending)
+{
+	struct rxm_conn *conn;
+	uint64_t now;
+
+	assert(ofi_genlock_held(&ep->util_ep.lock));
+	if (!rxm_conn_max)
+		return;
+
+	now = ofi_gettime_ms();
+	dlist_foreach_container(&ep->conn_lru, struct rxm_conn, conn,
+				lru_entry) {
+		if (ep->conn_cnt + ep->connecting_cnt + pending <=
+		    rxm_conn_max + ep->closing_cnt)
+			break;
+
+		if (!rxm_conn_idle(conn, now))
+			break;
+
+		if ((conn->flags & RXM_CONN_CLOSE_FLAGS) ||
+		    !rxm_conn_quiesced(conn))
+			continue;
+
+		if (rxm_send_close_ctrl(conn, rxm_ctrl_close_req))
+			break;
+
+		FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "evicting conn %p\n", conn);
+		rxm_set_closing(conn, RXM_CONN_CLOSING);
+	}
+}
+
+/* Conns the peer agreed to close are moved to the head of the LRU */
+static void rxm_close_ready_conns(struct rxm_ep *ep)
+{
+	struct rxm_conn *conn;
+
+	assert(ofi_genlock_held(&ep->util_ep.lock));
+	while (!dlist_empty(&ep->conn_lru)) {
+		conn = container_of(ep->conn_lru.next, struct rxm_conn,
+				    lru_entry);
+		if (!(conn->flags & RXM_CONN_CLOSE_READY))
+			break;
+
+		FI_INFO(&rxm_prov, FI_LOG_EP_CTRL, "closing idle conn %p\n",
+			conn);
+		rxm_close_conn(conn);
+		rxm_free_conn(conn);
+	}
+}
+
+ssize_t rxm_handle_close_ctrl(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *conn;
+	uint8_t type;
+
+	conn = rx_buf->conn ? rx_buf->conn :
+	       ofi_idm_at(&ep->conn_idx_map,
+			  (int) rx_buf->pkt.ctrl_hdr.conn_id);
+	type = rx_buf->pkt.ctrl_hdr.type;
+	rxm_free_rx_buf(rx_buf);
+	if (!conn || conn->state != RXM_CM_CONNECTED)
+		return FI_SUCCESS;
+
+	switch (type) {
+	case rxm_ctrl_close_req:
+		if (rxm_conn_max && !(conn->flags & RXM_CONN_CLOSE_ACKED) &&
+		    rxm_conn_idle(conn, ofi_gettime_ms()) &&
+		    rxm_conn_quiesced(conn)) {
+			if (rxm_send_close_ctrl(conn, rxm_ctrl_close_ack))
+				break;
+			/* the peer closes the conn */
+			rxm_set_closing(conn, RXM_CONN_CLOSE_ACKED);
+		} else {
+			(void) rxm_send_close_ctrl(conn, rxm_ctrl_close_nack);
+		}
+		break;
+	case rxm_ctrl_close_ack:
+		if ((conn->flags & RXM_CONN_CLOSING) &&
+		    rxm_conn_quiesced(conn)) {
+			conn->flags |= RXM_CONN_CLOSE_READY;
+			dlist_remove(&conn->lru_entry);
+			dlist_insert_head(&conn->lru_entry, &ep->conn_lru);
+			break;
+		}
+		/* something arrived while waiting, tell the peer to carry on */
+		(void) rxm_send_close_ctrl(conn, rxm_ctrl_close_nack);
+		rxm_clear_closing(conn);
+		break;
+	case rxm_ctrl_close_nack:
+		rxm_clear_closing(conn);
+		break;
+	default:
+		assert(0);
+		break;
+	}
+	return FI_SUCCESS;
+}
+
 /* The returned conn is only valid if the function returns success. */
 ssize_t rxm_get_conn(struct rxm_ep *ep, fi_addr_t addr, struct rxm_conn **conn)
 {
@@ -455,6 +690,13 @@ ssize_t rxm_get_conn(struct rxm_ep *ep, fi_addr_t addr, struct rxm_conn **conn)
 		return -FI_ENOMEM;
 
 	if ((*conn)->state == RXM_CM_CONNECTED) {
+		if ((*conn)->flags & RXM_CONN_CLOSE_FLAGS) {
+			rxm_ep_do_progress(&ep->util_ep);
+			return -FI_EAGAIN;
+		}
+		if (rxm_conn_max)
+			rxm_touch_conn(*conn);
+
 		if (!dlist_empty(&(*conn)->deferred_tx_queue)) {
 			rxm_ep_do_progress(&ep->util_ep);
 			if (!dlist_empty(&(*conn)->deferred_tx_queue))
@@ -518,12 +760,18 @@ void rxm_process_connect(struct rxm_eq_cm_entry *cm_entry)
 		domain = container_of(conn->ep->util_ep.domain,
 				      struct rxm_domain, util_domain);
 		domain->flow_ctrl_ops->enable(conn->msg_ep,
-					      conn->ep->msg_info->rx_attr->size / 2);
+				MAX(conn->rx_credit.target / 2, 1));
 	}
 
 	conn->ep->connecting_cnt--;
 	assert(conn->ep->connecting_cnt >= 0);
 	conn->state = RXM_CM_CONNECTED;
+
+	if ((conn->flags & RXM_CONN_INDEXED) && dlist_empty(&conn->lru_entry)) {
+		dlist_insert_tail(&conn->lru_entry, &conn->ep->conn_lru);
+		conn->ep->conn_cnt++;
+		conn->last_used = ofi_gettime_ms();
+	}
 }
 
 /* For simultaneous connection requests, if the peer won the coin
@@ -736,6 +984,7 @@ rxm_process_connreq(struct rxm_ep *ep, struct rxm_eq_cm_entry *cm_entry)
 
 	conn->state = RXM_CM_ACCEPTING;
 	conn->ep->connecting_cnt++;
+	rxm_evict_conns(ep, 0);
 put:
 	util_put_peer(peer);
 	fi_freeinfo(cm_entry->info);
@@ -853,6 +1102,10 @@ void rxm_conn_progress(struct rxm_ep *ep)
 			ret = 1;
 		}
 	} while (ret > 0);
+
+	if (ep->closing_cnt)
+		rxm_close_ready_conns(ep);
+	rxm_evict_conns(ep, 0);
 }
 
 void rxm_stop_listen(struct rxm_ep *ep)
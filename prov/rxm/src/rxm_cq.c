@@ -96,7 +96,7 @@ static void rxm_replace_rx_buf(struct rxm_rx_buf *rx_buf)
 		return;
 
 	rx_buf->repost = false;
-	ret = rxm_post_recv(new_rx_buf);
+	ret = rxm_repost_recv(new_rx_buf);
 	if (ret)
 		ofi_buf_free(new_rx_buf);
 }
@@ -213,6 +213,20 @@ static void rxm_finish_rma(struct rxm_ep *rxm_ep, struct rxm_tx_buf *rma_buf,
 	rxm_free_tx_buf(rxm_ep, rma_buf);
 }
 
+static void rxm_finish_msg_atomic(struct rxm_ep *rxm_ep,
+				  struct rxm_tx_buf *tx_buf)
+{
+	rxm_cq_write_tx_comp(rxm_ep, ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
+			     tx_buf->app_context, tx_buf->flags);
+
+	if (tx_buf->pkt.hdr.op == ofi_op_atomic)
+		ofi_ep_cntr_inc(&rxm_ep->util_ep, CNTR_WR);
+	else
+		ofi_ep_cntr_inc(&rxm_ep->util_ep, CNTR_RD);
+
+	rxm_free_tx_buf(rxm_ep, tx_buf);
+}
+
 void rxm_finish_eager_send(struct rxm_ep *rxm_ep, struct rxm_tx_buf *tx_buf)
 {
 	assert(ofi_tx_cq_flags(tx_buf->pkt.hdr.op) & FI_SEND);
@@ -222,6 +236,58 @@ void rxm_finish_eager_send(struct rxm_ep *rxm_ep, struct rxm_tx_buf *tx_buf)
 	ofi_ep_cntr_inc(&rxm_ep->util_ep, CNTR_TX);
 }
 
+static uint64_t rxm_tune_avg(uint64_t avg, uint64_t cost, uint32_t cnt)
+{
+	return cnt ? avg - avg / 8 + cost / 8 : cost;
+}
+
+/* Record the cost of a timed SAR or rendezvous send.  Once both protocols
+ * have enough samples, double or halve the connection's switch point if
+ * one is clearly cheaper, and start measuring again.
+ */
+static void rxm_tune_done(struct rxm_ep *rxm_ep, struct rxm_tx_buf *tx_buf,
+			  bool sar)
+{
+	struct rxm_proto_tune *tune;
+	size_t limit, max_limit;
+	uint64_t cost;
+
+	if (!tx_buf->tune.start)
+		return;
+
+	tune = &tx_buf->tune.conn->tune;
+	cost = ((ofi_gettime_ns() - tx_buf->tune.start) << 10) /
+	       tx_buf->pkt.hdr.size;
+	if (sar) {
+		tune->sar_cost = rxm_tune_avg(tune->sar_cost, cost,
+					      tune->sar_cnt++);
+	} else {
+		tune->rndv_cost = rxm_tune_avg(tune->rndv_cost, cost,
+					       tune->rndv_cnt++);
+	}
+
+	if (tune->sar_cnt < RXM_TUNE_SAMPLES ||
+	    tune->rndv_cnt < RXM_TUNE_SAMPLES)
+		return;
+
+	limit = tune->sar_limit;
+	max_limit = rxm_ep->sar_limit * 8;
+	if (tune->sar_cost * 8 < tune->rndv_cost * 7)
+		limit = MIN(limit * 2, max_limit);
+	else if (tune->rndv_cost * 8 < tune->sar_cost * 7)
+		limit = MAX(limit / 2, rxm_ep->eager_limit);
+
+	if (limit != tune->sar_limit) {
+		FI_INFO(&rxm_prov, FI_LOG_EP_DATA, "conn %p sar limit %zu -> "
+			"%zu, sar %" PRIu64 " rndv %" PRIu64 " ns/KiB\n",
+			tx_buf->tune.conn, tune->sar_limit, limit,
+			tune->sar_cost, tune->rndv_cost);
+		tune->sar_limit = limit;
+	}
+	tune->sar_cnt = 0;
+	tune->rndv_cnt = 0;
+}
+
 static bool rxm_complete_sar(struct rxm_ep *rxm_ep,
 			     struct rxm_tx_buf *tx_buf)
 {
@@ -230,13 +296,18 @@ static bool rxm_complete_sar(struct rxm_ep *rxm_ep,
 	assert(ofi_tx_cq_flags(tx_buf->pkt.hdr.op) & FI_SEND);
 	switch (rxm_sar_get_seg_type(&tx_buf->pkt.ctrl_hdr)) {
 	case RXM_SAR_SEG_FIRST:
+		tx_buf->sar_inflight--;
 		break;
 	case RXM_SAR_SEG_MIDDLE:
+		first_tx_buf = ofi_bufpool_get_ibuf(rxm_ep->tx_pool,
+						tx_buf->pkt.ctrl_hdr.msg_id);
+		first_tx_buf->sar_inflight--;
 		rxm_free_tx_buf(rxm_ep, tx_buf);
 		break;
 	case RXM_SAR_SEG_LAST:
 		first_tx_buf = ofi_bufpool_get_ibuf(rxm_ep->tx_pool,
 						tx_buf->pkt.ctrl_hdr.msg_id);
+		rxm_tune_done(rxm_ep, first_tx_buf, true);
 		rxm_free_tx_buf(rxm_ep, first_tx_buf);
 		rxm_free_tx_buf(rxm_ep, tx_buf);
 		return true;
@@ -265,6 +336,8 @@ static void rxm_handle_sar_comp(struct rxm_ep *rxm_ep,
 static void rxm_rndv_rx_finish(struct rxm_rx_buf *rx_buf)
 {
 	RXM_UPDATE_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_FINISH);
+	assert(rx_buf->conn->rndv_rx);
+	rx_buf->conn->rndv_rx--;
 
 	if (rx_buf->recv_entry->rndv.tx_buf) {
 		ofi_buf_free(rx_buf->recv_entry->rndv.tx_buf);
@@ -275,6 +348,16 @@ static void rxm_rndv_rx_finish(struct rxm_rx_buf *rx_buf)
 		rxm_msg_mr_closev(rx_buf->mr,
 				  rx_buf->recv_entry->rxm_iov.count);
 
+	if (rx_buf->rndv_xfer.err) {
+		rxm_cq_write_error(rx_buf->ep->util_ep.rx_cq,
+				   rx_buf->ep->util_ep.cntrs[CNTR_RX],
+				   rx_buf->recv_entry->context,
+				   rx_buf->rndv_xfer.err);
+		rxm_recv_entry_release(rx_buf->recv_entry);
+		rxm_free_rx_buf(rx_buf);
+		return;
+	}
+
 	rxm_finish_recv(rx_buf, rx_buf->recv_entry->total_len);
 }
 
@@ -284,21 +367,49 @@ static void rxm_rndv_tx_finish(struct rxm_ep *rxm_ep,
 	assert(ofi_tx_cq_flags(tx_buf->pkt.hdr.op) & FI_SEND);
 
 	RXM_UPDATE_STATE(FI_LOG_CQ, tx_buf, RXM_RNDV_FINISH);
+	rxm_tune_done(rxm_ep, tx_buf, false);
 	if (!rxm_ep->rdm_mr_local)
 		rxm_msg_mr_closev(tx_buf->rma.mr, tx_buf->rma.count);
 
-	rxm_cq_write_tx_comp(rxm_ep, ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
-			     tx_buf->app_context, tx_buf->flags);
+	if (rxm_ep->rndv_ops == &rxm_rndv_ops_write &&
+	    tx_buf->write_rndv.xfer.err) {
+		rxm_cq_write_error(rxm_ep->util_ep.tx_cq,
+				   rxm_ep->util_ep.cntrs[CNTR_TX],
+				   tx_buf->app_context,
+				   tx_buf->write_rndv.xfer.err);
+	} else {
+		rxm_cq_write_tx_comp(rxm_ep,
+				     ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
+				     tx_buf->app_context, tx_buf->flags);
+		ofi_ep_cntr_inc(&rxm_ep->util_ep, CNTR_TX);
+	}
 
 	if (rxm_ep->rndv_ops == &rxm_rndv_ops_write &&
 	    tx_buf->write_rndv.done_buf) {
 		ofi_buf_free(tx_buf->write_rndv.done_buf);
 		tx_buf->write_rndv.done_buf = NULL;
 	}
-	ofi_ep_cntr_inc(&rxm_ep->util_ep, CNTR_TX);
 	rxm_free_tx_buf(rxm_ep, tx_buf);
 }
 
+/* The done message could not be sent.  The peer keeps its buffer until
+ * the connection is closed, but the local operation completes.
+ */
+void rxm_rndv_rd_done_err(struct rxm_rx_buf *rx_buf, int err)
+{
+	if (!rx_buf->rndv_xfer.err)
+		rx_buf->rndv_xfer.err = err;
+	rxm_rndv_rx_finish(rx_buf);
+}
+
+void rxm_rndv_wr_done_err(struct rxm_ep *rxm_ep, struct rxm_tx_buf *tx_buf,
+			  int err)
+{
+	if (!tx_buf->write_rndv.xfer.err)
+		tx_buf->write_rndv.xfer.err = err;
+	rxm_rndv_tx_finish(rxm_ep, tx_buf);
+}
+
 static void rxm_rndv_handle_rd_done(struct rxm_ep *rxm_ep,
 				    struct rxm_rx_buf *rx_buf)
 {
@@ -351,6 +462,8 @@ static int rxm_rndv_handle_wr_done(struct rxm_ep *rxm_ep, struct rxm_rx_buf *rx_
 	}
 	rndv_rx_buf = container_of(rx_buf_entry, struct rxm_rx_buf,
 				   rndv_wait_entry);
+	if (rx_buf->pkt.ctrl_hdr.type == rxm_ctrl_rndv_wr_abort)
+		rndv_rx_buf->rndv_xfer.err = -FI_EIO;
 
 	if (rndv_rx_buf->hdr.state == RXM_RNDV_WRITE_DONE_WAIT) {
 		rxm_rndv_rx_finish(rndv_rx_buf);
@@ -372,36 +485,49 @@ static int rxm_rx_buf_match_msg_id(struct dlist_entry *item, const void *arg)
 	return (msg_id == rx_buf->pkt.ctrl_hdr.msg_id);
 }
 
+/* Every segment but the last is full sized, which places each segment at
+ * a fixed offset in the posted buffer regardless of the order it arrives
+ * in.  Segments past the end of a short buffer are consumed and dropped,
+ * and the receive completes as truncated once every segment has arrived.
+ */
+static size_t rxm_sar_seg_offset(struct rxm_pkt *pkt)
+{
+	if (rxm_sar_get_seg_type(&pkt->ctrl_hdr) == RXM_SAR_SEG_LAST)
+		return pkt->hdr.size - pkt->ctrl_hdr.seg_size;
+	return (size_t) pkt->ctrl_hdr.seg_no * pkt->ctrl_hdr.seg_size;
+}
+
 static void rxm_process_seg_data(struct rxm_rx_buf *rx_buf, int *done)
 {
+	struct rxm_recv_entry *recv_entry = rx_buf->recv_entry;
 	enum fi_hmem_iface iface;
 	uint64_t device;
 	ssize_t done_len;
 
-	iface = rxm_mr_desc_to_hmem_iface_dev(rx_buf->recv_entry->rxm_iov.desc,
-					      rx_buf->recv_entry->rxm_iov.count,
+	iface = rxm_mr_desc_to_hmem_iface_dev(recv_entry->rxm_iov.desc,
+					      recv_entry->rxm_iov.count,
 					      &device);
 
 	done_len = ofi_copy_to_hmem_iov(iface, device,
-					rx_buf->recv_entry->rxm_iov.iov,
-					rx_buf->recv_entry->rxm_iov.count,
-					rx_buf->recv_entry->sar.total_recv_len,
+					recv_entry->rxm_iov.iov,
+					recv_entry->rxm_iov.count,
+					rxm_sar_seg_offset(&rx_buf->pkt),
 					rx_buf->pkt.data,
 					rx_buf->pkt.ctrl_hdr.seg_size);
-	assert(done_len == rx_buf->pkt.ctrl_hdr.seg_size);
 
-	rx_buf->recv_entry->sar.total_recv_len += done_len;
+	recv_entry->sar.total_recv_len += done_len;
+	recv_entry->sar.data_len += rx_buf->pkt.ctrl_hdr.seg_size;
 
-	if ((rxm_sar_get_seg_type(&rx_buf->pkt.ctrl_hdr) == RXM_SAR_SEG_LAST) ||
-	    (done_len != rx_buf->pkt.ctrl_hdr.seg_size)) {
-
-		dlist_remove(&rx_buf->recv_entry->sar.entry);
+	if (recv_entry->sar.data_len >= rx_buf->pkt.hdr.size) {
+		if (recv_entry->sar.msg_id != RXM_SAR_RX_INIT)
+			dlist_remove(&recv_entry->sar.entry);
 
 		/* Mark rxm_recv_entry::msg_id as unknown for futher re-use */
 		rx_buf->recv_entry->sar.msg_id = RXM_SAR_RX_INIT;
 
 		done_len = rx_buf->recv_entry->sar.total_recv_len;
 		rx_buf->recv_entry->sar.total_recv_len = 0;
+		rx_buf->recv_entry->sar.data_len = 0;
 
 		*done = 1;
 		rxm_finish_recv(rx_buf, done_len);
@@ -416,7 +542,8 @@ static void rxm_process_seg_data(struct rxm_rx_buf *rx_buf, int *done)
 			rx_buf->recv_entry->sar.msg_id = rx_buf->pkt.ctrl_hdr.msg_id;
 
 			dlist_insert_tail(&rx_buf->recv_entry->sar.entry,
-					  &rx_buf->conn->deferred_sar_msgs);
+					  rxm_sar_bucket(rx_buf->conn,
+						rx_buf->pkt.ctrl_hdr.msg_id));
 		}
 
 		/* The RX buffer can be reposted for further re-use */
@@ -457,96 +584,273 @@ static void rxm_handle_seg_data(struct rxm_rx_buf *rx_buf)
 	}
 }
 
+static void rxm_rndv_send_rd_done(struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_deferred_tx_entry *def_entry;
+	struct rxm_tx_buf *buf;
+	ssize_t ret;
+
+	assert(rx_buf->conn);
+	assert(rx_buf->hdr.state == RXM_RNDV_READ);
+	buf = ofi_buf_alloc(rx_buf->ep->tx_pool);
+	if (!buf) {
+		ret = -FI_ENOMEM;
+		goto err;
+	}
+
+	rx_buf->recv_entry->rndv.tx_buf = buf;
+
+	buf->pkt.ctrl_hdr.type = rxm_ctrl_rndv_rd_done;
+	buf->pkt.ctrl_hdr.conn_id = rx_buf->conn->remote_index;
+	buf->pkt.ctrl_hdr.msg_id = rx_buf->pkt.ctrl_hdr.msg_id;
+
+	ret = fi_send(rx_buf->conn->msg_ep, &buf->pkt, sizeof(buf->pkt),
+		      buf->hdr.desc, 0, rx_buf);
+	if (ret) {
+		if (ret == -FI_EAGAIN) {
+			def_entry = rxm_ep_alloc_deferred_tx_entry(rx_buf->ep,
+						rx_buf->conn,
+						RXM_DEFERRED_TX_RNDV_ACK);
+			if (def_entry) {
+				def_entry->rndv_ack.rx_buf = rx_buf;
+				def_entry->rndv_ack.pkt_size = sizeof(rx_buf->pkt);
+				rxm_queue_deferred_tx(def_entry, OFI_LIST_TAIL);
+				return;
+			}
+		}
+		goto free;
+	}
+
+	RXM_UPDATE_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_READ_DONE_SENT);
+	return;
+
+free:
+	ofi_buf_free(buf);
+	rx_buf->recv_entry->rndv.tx_buf = NULL;
+err:
+	FI_WARN(&rxm_prov, FI_LOG_CQ,
+		"unable to allocate/send rd rndv ack: %s\n",
+		fi_strerror((int) -ret));
+	rxm_rndv_rd_done_err(rx_buf, (int) ret);
+}
+
+static void
+rxm_rndv_send_wr_done(struct rxm_ep *rxm_ep, struct rxm_tx_buf *tx_buf)
+{
+	struct rxm_deferred_tx_entry *def_entry;
+	struct rxm_tx_buf *buf;
+	ssize_t ret;
+
+	assert(tx_buf->hdr.state == RXM_RNDV_WRITE);
+	buf = ofi_buf_alloc(rxm_ep->tx_pool);
+	if (!buf) {
+		ret = -FI_ENOMEM;
+		goto err;
+	}
+
+	tx_buf->write_rndv.done_buf = buf;
+
+	/* An abort tells the peer that its buffer was not fully written */
+	buf->pkt.ctrl_hdr.type = tx_buf->write_rndv.xfer.err ?
+				 rxm_ctrl_rndv_wr_abort : rxm_ctrl_rndv_wr_done;
+	buf->pkt.ctrl_hdr.conn_id = tx_buf->pkt.ctrl_hdr.conn_id;
+	buf->pkt.ctrl_hdr.msg_id = tx_buf->pkt.ctrl_hdr.msg_id;
+
+	ret = fi_send(tx_buf->write_rndv.conn->msg_ep, &buf->pkt,
+		      sizeof(buf->pkt), buf->hdr.desc, 0, tx_buf);
+	if (ret) {
+		if (ret == -FI_EAGAIN) {
+			def_entry = rxm_ep_alloc_deferred_tx_entry(rxm_ep,
+						tx_buf->write_rndv.conn,
+						RXM_DEFERRED_TX_RNDV_DONE);
+			if (def_entry) {
+				def_entry->rndv_done.tx_buf = tx_buf;
+				rxm_queue_deferred_tx(def_entry, OFI_LIST_TAIL);
+				return;
+			}
+		}
+		goto free;
+	}
+
+	RXM_UPDATE_STATE(FI_LOG_CQ, tx_buf, RXM_RNDV_WRITE_DONE_SENT);
+	return;
+
+free:
+	ofi_buf_free(buf);
+	tx_buf->write_rndv.done_buf = NULL;
+err:
+	FI_WARN(&rxm_prov, FI_LOG_CQ,
+		"unable to allocate/send wr rndv ack: %s\n",
+		fi_strerror((int) -ret));
+	rxm_rndv_wr_done_err(rxm_ep, tx_buf, (int) ret);
+}
+
+static void rxm_rndv_xfer_init(struct rxm_rndv_xfer *xfer, size_t total_len)
+{
+	memset(xfer, 0, sizeof(*xfer));
+	xfer->remain = total_len;
+}
+
+static bool rxm_rndv_xfer_done(struct rxm_rndv_xfer *xfer,
+			       struct rxm_rndv_hdr *remote_hdr)
+{
+	return !xfer->inflight &&
+	       (!xfer->remain || xfer->rma_index == remote_hdr->count);
+}
+
+/* Stop posting, but let outstanding chunks drain */
+static void rxm_rndv_xfer_fail(struct rxm_rndv_xfer *xfer, int err)
+{
+	if (!xfer->err)
+		xfer->err = err;
+	xfer->remain = 0;
+}
+
+/* Post the next chunks of a rendezvous transfer, keeping at most
+ * rxm_rndv_window of them outstanding.  Each completion posts more, so
+ * transfer overlaps completion handling and a large message leaves room
+ * in the msg endpoint send queue.  A chunk that hits -FI_EAGAIN moves to
+ * the deferred queue and stops the pass; its completion resumes it.
+ */
 static ssize_t rxm_rndv_xfer(struct rxm_ep *rxm_ep, struct fid_ep *msg_ep,
 			     struct rxm_rndv_hdr *remote_hdr, struct iovec *local_iov,
-			     void **local_desc, size_t local_count, size_t total_len,
-			     void *context)
+			     void **local_desc, size_t local_count,
+			     struct rxm_rndv_xfer *xfer, void *context)
 {
-	size_t i, index = 0, offset = 0, count, copy_len;
+	struct rxm_deferred_tx_entry *def_tx_entry;
 	struct iovec iov[RXM_IOV_LIMIT];
 	void *desc[RXM_IOV_LIMIT];
-	ssize_t ret = FI_SUCCESS;
+	struct ofi_rma_iov *rma_iov;
+	size_t count, len;
+	uint64_t addr;
+	ssize_t ret;
 
-	for (i = 0; i < remote_hdr->count && total_len > 0; i++) {
-		copy_len = MIN(remote_hdr->iov[i].len, total_len);
+	while (xfer->remain && xfer->rma_index < remote_hdr->count) {
+		if (rxm_rndv_window && xfer->inflight >= rxm_rndv_window)
+			break;
+
+		rma_iov = &remote_hdr->iov[xfer->rma_index];
+		len = MIN(rma_iov->len - xfer->rma_offset, xfer->remain);
+		if (rxm_rndv_chunk_size)
+			len = MIN(len, rxm_rndv_chunk_size);
 
 		ret = ofi_copy_iov_desc(&iov[0], &desc[0], &count,
-					&local_iov[0],
-					&local_desc[0],
-					local_count,
-					&index, &offset, copy_len);
+					&local_iov[0], &local_desc[0],
+					local_count, &xfer->iov_index,
+					&xfer->iov_offset, len);
 		if (ret)
 			return ret;
-		total_len -= copy_len;
-		ret = rxm_ep->rndv_ops->xfer(msg_ep, iov, desc, count, 0,
-			       remote_hdr->iov[i].addr, remote_hdr->iov[i].key,
-			       context);
 
-		if (ret) {
-			if (ret == -FI_EAGAIN) {
-				struct rxm_deferred_tx_entry *def_tx_entry;
-
-				ret = rxm_ep->rndv_ops->defer_xfer(
-					&def_tx_entry, i, iov, desc, count,
-					context);
+		addr = rma_iov->addr + xfer->rma_offset;
+		xfer->remain -= len;
+		xfer->rma_offset += len;
+		if (xfer->rma_offset == rma_iov->len) {
+			xfer->rma_index++;
+			xfer->rma_offset = 0;
+		}
 
-				if (ret)
-					break;
-				rxm_queue_deferred_tx(def_tx_entry, OFI_LIST_TAIL);
-				continue;
-			}
-			break;
+		ret = rxm_ep->rndv_ops->xfer(msg_ep, iov, desc, count, 0,
+					     addr, rma_iov->key, context);
+		if (!ret) {
+			xfer->inflight++;
+			continue;
 		}
+		if (ret != -FI_EAGAIN)
+			return ret;
+
+		ret = rxm_ep->rndv_ops->defer_xfer(&def_tx_entry, addr,
+						   rma_iov->key, iov, desc,
+						   count, context);
+		if (ret)
+			return ret;
+
+		xfer->inflight++;
+		rxm_queue_deferred_tx(def_tx_entry, OFI_LIST_TAIL);
+		break;
 	}
-	assert(!total_len);
-	return ret;
+	return 0;
 }
 
-ssize_t rxm_rndv_read(struct rxm_rx_buf *rx_buf)
+/* Posts the next chunks.  Once none are in flight, the done message is
+ * sent even if a chunk failed, so that the peer releases its buffer.  The
+ * error is reported by the receive completion.
+ */
+static void rxm_rndv_read_xfer(struct rxm_rx_buf *rx_buf)
 {
 	ssize_t ret;
-	size_t total_len;
-
-	total_len = MIN(rx_buf->recv_entry->total_len, rx_buf->pkt.hdr.size);
-	RXM_UPDATE_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_READ);
 
 	ret = rxm_rndv_xfer(rx_buf->ep, rx_buf->conn->msg_ep,
 			    rx_buf->remote_rndv_hdr,
 			    rx_buf->recv_entry->rxm_iov.iov,
 			    rx_buf->recv_entry->rxm_iov.desc,
-			    rx_buf->recv_entry->rxm_iov.count, total_len,
-			    rx_buf);
-	if (ret) {
-		rxm_cq_write_error(rx_buf->ep->util_ep.rx_cq,
-				   rx_buf->ep->util_ep.cntrs[CNTR_RX], rx_buf, (int) ret);
-	}
-	return ret;
+			    rx_buf->recv_entry->rxm_iov.count,
+			    &rx_buf->rndv_xfer, rx_buf);
+	if (ret)
+		rxm_rndv_xfer_fail(&rx_buf->rndv_xfer, (int) ret);
+
+	if (rxm_rndv_xfer_done(&rx_buf->rndv_xfer, rx_buf->remote_rndv_hdr))
+		rxm_rndv_send_rd_done(rx_buf);
 }
 
-static ssize_t rxm_rndv_handle_wr_data(struct rxm_rx_buf *rx_buf)
+void rxm_rndv_read_chunk_err(struct rxm_rx_buf *rx_buf, int err)
+{
+	assert(rx_buf->rndv_xfer.inflight);
+	rx_buf->rndv_xfer.inflight--;
+	rxm_rndv_xfer_fail(&rx_buf->rndv_xfer, err);
+	rxm_rndv_read_xfer(rx_buf);
+}
+
+ssize_t rxm_rndv_read(struct rxm_rx_buf *rx_buf)
+{
+	RXM_UPDATE_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_READ);
+	rxm_rndv_xfer_init(&rx_buf->rndv_xfer,
+			   MIN(rx_buf->recv_entry->total_len,
+			       rx_buf->pkt.hdr.size));
+	rxm_rndv_read_xfer(rx_buf);
+	return 0;
+}
+
+/* As for reads, but a failed transfer is reported to the peer with an
+ * abort in place of the done message, and fails the send.
+ */
+static void rxm_rndv_write_xfer(struct rxm_ep *rxm_ep,
+				struct rxm_tx_buf *tx_buf)
 {
-	int i;
 	ssize_t ret;
+
+	ret = rxm_rndv_xfer(rxm_ep, tx_buf->write_rndv.conn->msg_ep,
+			    &tx_buf->write_rndv.remote_hdr,
+			    tx_buf->write_rndv.iov, tx_buf->write_rndv.desc,
+			    tx_buf->rma.count, &tx_buf->write_rndv.xfer, tx_buf);
+	if (ret)
+		rxm_rndv_xfer_fail(&tx_buf->write_rndv.xfer, (int) ret);
+
+	if (rxm_rndv_xfer_done(&tx_buf->write_rndv.xfer,
+			       &tx_buf->write_rndv.remote_hdr))
+		rxm_rndv_send_wr_done(rxm_ep, tx_buf);
+}
+
+void rxm_rndv_write_chunk_err(struct rxm_ep *rxm_ep,
+			      struct rxm_tx_buf *tx_buf, int err)
+{
+	assert(tx_buf->write_rndv.xfer.inflight);
+	tx_buf->write_rndv.xfer.inflight--;
+	rxm_rndv_xfer_fail(&tx_buf->write_rndv.xfer, err);
+	rxm_rndv_write_xfer(rxm_ep, tx_buf);
+}
+
+static ssize_t rxm_rndv_handle_wr_data(struct rxm_rx_buf *rx_buf)
+{
 	struct rxm_tx_buf *tx_buf;
-	size_t total_len, rma_len = 0;
 	struct rxm_rndv_hdr *rx_hdr = (struct rxm_rndv_hdr *) rx_buf->pkt.data;
 
 	tx_buf = ofi_bufpool_get_ibuf(rx_buf->ep->tx_pool,
 				      rx_buf->pkt.ctrl_hdr.msg_id);
-	total_len = tx_buf->pkt.hdr.size;
 
 	tx_buf->write_rndv.remote_hdr.count = rx_hdr->count;
 	memcpy(tx_buf->write_rndv.remote_hdr.iov, rx_hdr->iov,
 	       rx_hdr->count * sizeof(rx_hdr->iov[0]));
-	// calculate number of RMA writes required to complete the transfer.
-	// there me be less than iov count RMA writes required,
-	// depending on differences between remote and local IOV sizes.
-	for (i = 0; i < tx_buf->write_rndv.remote_hdr.count; i++) {
-		if (total_len > rma_len) {
-			tx_buf->write_rndv.rndv_rma_count++;
-			rma_len += tx_buf->write_rndv.remote_hdr.iov[i].len;
-		}
-	}
+	rxm_rndv_xfer_init(&tx_buf->write_rndv.xfer, tx_buf->pkt.hdr.size);
 
 	/* BUG: This is forcing a state change without knowing what state
 	 * we're currently in.  This loses whether we processed the completion
@@ -555,16 +859,9 @@ static ssize_t rxm_rndv_handle_wr_data(struct rxm_rx_buf *rx_buf)
 	 */
 	RXM_UPDATE_STATE(FI_LOG_CQ, tx_buf, RXM_RNDV_WRITE);
 
-	ret = rxm_rndv_xfer(rx_buf->ep, tx_buf->write_rndv.conn->msg_ep, rx_hdr,
-			    tx_buf->write_rndv.iov, tx_buf->write_rndv.desc,
-			    tx_buf->rma.count, total_len, tx_buf);
-
-	if (ret)
-		rxm_cq_write_error(rx_buf->ep->util_ep.rx_cq,
-				   rx_buf->ep->util_ep.cntrs[CNTR_RX],
-				   tx_buf, (int) ret);
+	rxm_rndv_write_xfer(rx_buf->ep, tx_buf);
 	rxm_free_rx_buf(rx_buf);
-	return ret;
+	return 0;
 }
 
 static ssize_t rxm_handle_rndv(struct rxm_rx_buf *rx_buf)
@@ -588,7 +885,7 @@ static ssize_t rxm_handle_rndv(struct rxm_rx_buf *rx_buf)
 	       rx_buf->pkt.ctrl_hdr.msg_id);
 
 	rx_buf->remote_rndv_hdr = (struct rxm_rndv_hdr *) rx_buf->pkt.data;
-	rx_buf->rndv_rma_index = 0;
+	rx_buf->rndv_xfer.err = 0;
 
 	if (!rx_buf->ep->rdm_mr_local) {
 		total_recv_len = MIN(rx_buf->recv_entry->total_len,
@@ -620,7 +917,11 @@ static ssize_t rxm_handle_rndv(struct rxm_rx_buf *rx_buf)
 	assert(rx_buf->remote_rndv_hdr->count &&
 	       (rx_buf->remote_rndv_hdr->count <= RXM_IOV_LIMIT));
 
-	return rx_buf->ep->rndv_ops->handle_rx(rx_buf);
+	rx_buf->conn->rndv_rx++;
+	ret = rx_buf->ep->rndv_ops->handle_rx(rx_buf);
+	if (ret)
+		rx_buf->conn->rndv_rx--;
+	return ret;
 }
 
 void rxm_handle_eager(struct rxm_rx_buf *rx_buf)
@@ -720,13 +1021,8 @@ rxm_match_rx_buf(struct rxm_rx_buf *rx_buf,
 		 struct rxm_recv_queue *recv_queue,
 		 struct rxm_recv_match_attr *match_attr)
 {
-	struct dlist_entry *entry;
-
-	entry = dlist_remove_first_match(&recv_queue->recv_list,
-					 recv_queue->match_recv, match_attr);
-	if (entry) {
-		rx_buf->recv_entry = container_of(entry, struct rxm_recv_entry, entry);
-
+	rx_buf->recv_entry = rxm_remove_recv(recv_queue, match_attr);
+	if (rx_buf->recv_entry) {
 		if (rx_buf->recv_entry->flags & FI_MULTI_RECV)
 			rxm_adjust_multi_recv(rx_buf);
 
@@ -739,8 +1035,7 @@ rxm_match_rx_buf(struct rxm_rx_buf *rx_buf,
 	rx_buf->unexp_msg.addr = match_attr->addr;
 	rx_buf->unexp_msg.tag = match_attr->tag;
 
-	dlist_insert_tail(&rx_buf->unexp_msg.entry,
-			  &recv_queue->unexp_msg_list);
+	rxm_insert_unexp_msg(recv_queue, rx_buf);
 	rxm_replace_rx_buf(rx_buf);
 	return 0;
 }
@@ -803,7 +1098,8 @@ static ssize_t rxm_sar_handle_segment(struct rxm_rx_buf *rx_buf)
 	FI_DBG(&rxm_prov, FI_LOG_CQ,
 	       "Got incoming recv with msg_id: 0x%" PRIx64 " for conn - %p\n",
 	       rx_buf->pkt.ctrl_hdr.msg_id, rx_buf->conn);
-	sar_entry = dlist_find_first_match(&rx_buf->conn->deferred_sar_msgs,
+	sar_entry = dlist_find_first_match(rxm_sar_bucket(rx_buf->conn,
+						rx_buf->pkt.ctrl_hdr.msg_id),
 					   rxm_sar_match_msg_id,
 					   &rx_buf->pkt.ctrl_hdr.msg_id);
 	if (!sar_entry)
@@ -815,113 +1111,6 @@ static ssize_t rxm_sar_handle_segment(struct rxm_rx_buf *rx_buf)
 	return 0;
 }
 
-static void rxm_rndv_send_rd_done(struct rxm_rx_buf *rx_buf)
-{
-	struct rxm_deferred_tx_entry *def_entry;
-	struct rxm_tx_buf *buf;
-	ssize_t ret;
-
-	assert(rx_buf->conn);
-	assert(rx_buf->hdr.state == RXM_RNDV_READ);
-	buf = ofi_buf_alloc(rx_buf->ep->tx_pool);
-	if (!buf) {
-		ret = -FI_ENOMEM;
-		goto err;
-	}
-
-	rx_buf->recv_entry->rndv.tx_buf = buf;
-
-	buf->pkt.ctrl_hdr.type = rxm_ctrl_rndv_rd_done;
-	buf->pkt.ctrl_hdr.conn_id = rx_buf->conn->remote_index;
-	buf->pkt.ctrl_hdr.msg_id = rx_buf->pkt.ctrl_hdr.msg_id;
-
-	ret = fi_send(rx_buf->conn->msg_ep, &buf->pkt, sizeof(buf->pkt),
-		      buf->hdr.desc, 0, rx_buf);
-	if (ret) {
-		if (ret == -FI_EAGAIN) {
-			def_entry = rxm_ep_alloc_deferred_tx_entry(rx_buf->ep,
-						rx_buf->conn,
-						RXM_DEFERRED_TX_RNDV_ACK);
-			if (def_entry) {
-				def_entry->rndv_ack.rx_buf = rx_buf;
-				def_entry->rndv_ack.pkt_size = sizeof(rx_buf->pkt);
-				rxm_queue_deferred_tx(def_entry, OFI_LIST_TAIL);
-				return;
-			}
-		}
-		goto free;
-	}
-
-	RXM_UPDATE_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_READ_DONE_SENT);
-	return;
-
-free:
-	ofi_buf_free(buf);
-	rx_buf->recv_entry->rndv.tx_buf = NULL;
-err:
-	FI_WARN(&rxm_prov, FI_LOG_CQ,
-		"unable to allocate/send rd rndv ack: %s\n",
-		fi_strerror((int) ret));
-	assert(0);
-	/* TODO: Allocate all resources needed on receiving
-	 * original message receive request, to avoid allocation failures.
-	 * On other failures, we need to fail the receive.
-	 */
-}
-
-static void
-rxm_rndv_send_wr_done(struct rxm_ep *rxm_ep, struct rxm_tx_buf *tx_buf)
-{
-	struct rxm_deferred_tx_entry *def_entry;
-	struct rxm_tx_buf *buf;
-	ssize_t ret;
-
-	assert(tx_buf->hdr.state == RXM_RNDV_WRITE);
-	buf = ofi_buf_alloc(rxm_ep->tx_pool);
-	if (!buf) {
-		ret = -FI_ENOMEM;
-		goto err;
-	}
-
-	tx_buf->write_rndv.done_buf = buf;
-
-	buf->pkt.ctrl_hdr.type = rxm_ctrl_rndv_wr_done;
-	buf->pkt.ctrl_hdr.conn_id = tx_buf->pkt.ctrl_hdr.conn_id;
-	buf->pkt.ctrl_hdr.msg_id = tx_buf->pkt.ctrl_hdr.msg_id;
-
-	ret = fi_send(tx_buf->write_rndv.conn->msg_ep, &buf->pkt,
-		      sizeof(buf->pkt), buf->hdr.desc, 0, tx_buf);
-	if (ret) {
-		if (ret == -FI_EAGAIN) {
-			def_entry = rxm_ep_alloc_deferred_tx_entry(rxm_ep,
-						tx_buf->write_rndv.conn,
-						RXM_DEFERRED_TX_RNDV_DONE);
-			if (def_entry) {
-				def_entry->rndv_done.tx_buf = tx_buf;
-				rxm_queue_deferred_tx(def_entry, OFI_LIST_TAIL);
-				return;
-			}
-		}
-		goto free;
-	}
-
-	RXM_UPDATE_STATE(FI_LOG_CQ, tx_buf, RXM_RNDV_WRITE_DONE_SENT);
-	return;
-
-free:
-	ofi_buf_free(buf);
-	tx_buf->write_rndv.done_buf = NULL;
-err:
-	FI_WARN(&rxm_prov, FI_LOG_CQ,
-		"unable to allocate/send wr rndv ack: %s\n",
-		fi_strerror((int) ret));
-	assert(0);
-	/* TODO: Allocate all resources needed prior to initiating the
-	 * original message send request, to avoid allocation failures.
-	 * On other failures, we need to fail the original message.
-	 */
-}
-
 ssize_t rxm_rndv_send_wr_data(struct rxm_rx_buf *rx_buf)
 {
 	struct rxm_deferred_tx_entry *def_entry;
@@ -1102,9 +1291,7 @@ static int rxm_do_device_mem_atomic(struct rxm_mr *dev_mr, uint8_t op,
 		.iov_len = amo_op_size,
 	};
 
-	ofi_mutex_lock(&dom->amo_bufpool_lock);
 	tx_buf = ofi_buf_alloc(dom->amo_bufpool);
-	ofi_mutex_unlock(&dom->amo_bufpool_lock);
 
 	if (!tx_buf)
 		return -FI_ENOMEM;
@@ -1123,9 +1310,7 @@ static int rxm_do_device_mem_atomic(struct rxm_mr *dev_mr, uint8_t op,
 
 	ofi_mutex_unlock(&dev_mr->amo_lock);
 
-	ofi_mutex_lock(&dom->amo_bufpool_lock);
 	ofi_buf_free(tx_buf);
-	ofi_mutex_unlock(&dom->amo_bufpool_lock);
 
 	return FI_SUCCESS;
 }
@@ -1341,6 +1526,89 @@ void rxm_finish_coll_eager_send(struct rxm_ep *rxm_ep,
 	}
 }
 
+static void rxm_post_rx_bufs(struct rxm_ep *ep, struct fid_ep *rx_ep,
+			     size_t cnt)
+{
+	struct rxm_rx_buf *rx_buf;
+
+	while (cnt--) {
+		rx_buf = rxm_rx_buf_alloc(ep, rx_ep);
+		if (!rx_buf)
+			break;
+		if (rxm_repost_recv(rx_buf)) {
+			ofi_buf_free(rx_buf);
+			break;
+		}
+	}
+}
+
+/* Called for each completed receive buffer.  Every time target buffers
+ * have been used, the time it took decides whether the connection, or
+ * the srx, posts more buffers or lets some go back to the pool as they
+ * complete.  Buffers held by unexpected messages are not reposted, so an
+ * srx that falls below a quarter of its target is refilled right away
+ * rather than left to run dry under every peer at once.
+ */
+static void rxm_update_rx_credit(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_rx_credit *credit = rxm_rx_buf_credit(rx_buf);
+	uint64_t now, elapsed;
+	size_t max, grow;
+
+	credit->posted--;
+	if (!rxm_msg_rx_min)
+		return;
+
+	if (ep->msg_srx && credit->posted < credit->target / 4)
+		rxm_post_rx_bufs(ep, rx_buf->rx_ep,
+				 credit->target - credit->posted);
+
+	if (++credit->cnt < credit->target)
+		return;
+
+	now = ofi_gettime_ns();
+	elapsed = now - credit->start;
+	credit->cnt = 0;
+	credit->start = now;
+
+	max = ep->msg_info->rx_attr->size;
+	if (elapsed < RXM_RX_CREDIT_BUSY && credit->target < max) {
+		grow = MIN(credit->target, max - credit->target);
+		credit->target += grow;
+		rxm_post_rx_bufs(ep, rx_buf->rx_ep, grow);
+		FI_DBG(&rxm_prov, FI_LOG_EP_DATA,
+		       "rx ep %p posts %zu rx buffers\n", rx_buf->rx_ep,
+		       credit->target);
+	} else if (elapsed > RXM_RX_CREDIT_IDLE &&
+		   credit->target > rxm_msg_rx_min) {
+		credit->target = MAX(credit->target / 2, rxm_msg_rx_min);
+		FI_DBG(&rxm_prov, FI_LOG_EP_DATA,
+		       "rx ep %p posts %zu rx buffers\n", rx_buf->rx_ep,
+		       credit->target);
+	}
+}
+
+/* Traffic from a peer keeps its connection off the eviction path */
+static void rxm_touch_rx_conn(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *conn;
+
+	switch (rx_buf->pkt.ctrl_hdr.type) {
+	case rxm_ctrl_close_req:
+	case rxm_ctrl_close_ack:
+	case rxm_ctrl_close_nack:
+		return;
+	default:
+		break;
+	}
+
+	conn = rx_buf->conn ? rx_buf->conn :
+	       ofi_idm_at(&ep->conn_idx_map,
+			  (int) rx_buf->pkt.ctrl_hdr.conn_id);
+	if (conn)
+		rxm_touch_conn(conn);
+}
+
 ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 {
 	struct rxm_rx_buf *rx_buf;
@@ -1371,11 +1639,17 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 		       (comp->flags & (FI_READ | FI_RMA)));
 		rxm_finish_rma(rxm_ep, tx_buf, comp->flags);
 		return 0;
+	case RXM_ATOMIC_MSG:
+		rxm_finish_msg_atomic(rxm_ep, comp->op_context);
+		return 0;
 	case RXM_RX:
 		rx_buf = comp->op_context;
 		assert(!(comp->flags & FI_REMOTE_READ));
 		assert((rx_buf->pkt.hdr.version == OFI_OP_VERSION) &&
 		       (rx_buf->pkt.ctrl_hdr.version == RXM_CTRL_VERSION));
+		rxm_update_rx_credit(rxm_ep, rx_buf);
+		if (rxm_conn_max)
+			rxm_touch_rx_conn(rxm_ep, rx_buf);
 
 		switch (rx_buf->pkt.ctrl_hdr.type) {
 		case rxm_ctrl_eager:
@@ -1385,6 +1659,7 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 			rxm_rndv_handle_rd_done(rxm_ep, rx_buf);
 			return 0;
 		case rxm_ctrl_rndv_wr_done:
+		case rxm_ctrl_rndv_wr_abort:
 			return rxm_rndv_handle_wr_done(rxm_ep, rx_buf);
 		case rxm_ctrl_rndv_wr_data:
 			return rxm_rndv_handle_wr_data(rx_buf);
@@ -1396,6 +1671,10 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 			return rxm_handle_atomic_resp(rxm_ep, rx_buf);
 		case rxm_ctrl_credit:
 			return rxm_handle_credit(rxm_ep, rx_buf);
+		case rxm_ctrl_close_req:
+		case rxm_ctrl_close_ack:
+		case rxm_ctrl_close_nack:
+			return rxm_handle_close_ctrl(rxm_ep, rx_buf);
 		default:
 			FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown message type\n");
 			assert(0);
@@ -1423,19 +1702,14 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 	case RXM_RNDV_READ:
 		rx_buf = comp->op_context;
 		assert(comp->flags & FI_READ);
-		if (++rx_buf->rndv_rma_index < rx_buf->remote_rndv_hdr->count)
-			return 0;
-
-		rxm_rndv_send_rd_done(rx_buf);
+		rx_buf->rndv_xfer.inflight--;
+		rxm_rndv_read_xfer(rx_buf);
 		return 0;
 	case RXM_RNDV_WRITE:
 		tx_buf = comp->op_context;
 		assert(comp->flags & FI_WRITE);
-		if (++tx_buf->write_rndv.rndv_rma_index <
-		    tx_buf->write_rndv.rndv_rma_count)
-			return 0;
-
-		rxm_rndv_send_wr_done(rxm_ep, tx_buf);
+		tx_buf->write_rndv.xfer.inflight--;
+		rxm_rndv_write_xfer(rxm_ep, tx_buf);
 		return 0;
 	case RXM_RNDV_READ_DONE_SENT:
 		assert(comp->flags & FI_SEND);
@@ -1563,6 +1837,7 @@ void rxm_handle_comp_error(struct rxm_ep *rxm_ep)
 	case RXM_RNDV_TX:
 	case RXM_RNDV_WRITE_DONE_SENT:
 	case RXM_ATOMIC_RESP_WAIT:
+	case RXM_ATOMIC_MSG:
 		tx_buf = err_entry.op_context;
 		err_entry.op_context = tx_buf->app_context;
 		err_entry.flags = ofi_tx_cq_flags(tx_buf->pkt.hdr.op);
@@ -1604,10 +1879,12 @@ void rxm_handle_comp_error(struct rxm_ep *rxm_ep)
 			return;
 		break;
 	case RXM_RNDV_WRITE:
-		tx_buf = err_entry.op_context;
-		err_entry.op_context = tx_buf->app_context;
-		err_entry.flags = ofi_tx_cq_flags(tx_buf->pkt.hdr.op);
-		break;
+		rxm_rndv_write_chunk_err(rxm_ep, err_entry.op_context,
+					 -err_entry.err);
+		return;
+	case RXM_RNDV_READ:
+		rxm_rndv_read_chunk_err(err_entry.op_context, -err_entry.err);
+		return;
 
 	/* Incoming application data error */
 	case RXM_RX:
@@ -1618,6 +1895,7 @@ void rxm_handle_comp_error(struct rxm_ep *rxm_ep)
 		 * the event yet.
 		 */
 		rx_buf = (struct rxm_rx_buf *) err_entry.op_context;
+		rxm_rx_buf_credit(rx_buf)->posted--;
 		if (!rx_buf->recv_entry) {
 			ofi_buf_free((struct rxm_rx_buf *)err_entry.op_context);
 			return;
@@ -1625,7 +1903,6 @@ void rxm_handle_comp_error(struct rxm_ep *rxm_ep)
 		/* fall through */
 	case RXM_RNDV_READ_DONE_SENT:
 	case RXM_RNDV_WRITE_DATA_SENT: /* BUG: should fail initial send */
-	case RXM_RNDV_READ:
 		rx_buf = (struct rxm_rx_buf *) err_entry.op_context;
 		assert(rx_buf->recv_entry);
 		err_entry.op_context = rx_buf->recv_entry->context;
@@ -1750,23 +2027,29 @@ ssize_t rxm_cq_owner_writeerr(struct fid_peer_cq *peer_cq,
 	return ofi_cq_write_error(&rxm_cq->util_cq, &cqe_err);
 }
 
-int rxm_post_recv(struct rxm_rx_buf *rx_buf)
+static void rxm_reset_rx_buf(struct rxm_rx_buf *rx_buf)
 {
-	struct rxm_domain *domain;
-	int ret;
-
 	if (rx_buf->ep->msg_srx)
 		rx_buf->conn = NULL;
 	rx_buf->hdr.state = RXM_RX;
 	rx_buf->recv_entry = NULL;
+}
 
+int rxm_post_recv(struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_domain *domain;
+	int ret;
+
+	rxm_reset_rx_buf(rx_buf);
 	domain = container_of(rx_buf->ep->util_ep.domain,
 			      struct rxm_domain, util_domain);
 	ret = (int) fi_recv(rx_buf->rx_ep, &rx_buf->pkt,
 			    domain->rx_post_size, rx_buf->hdr.desc,
 			    FI_ADDR_UNSPEC, rx_buf);
-	if (!ret)
+	if (!ret) {
+		rxm_rx_buf_credit(rx_buf)->posted++;
 		return 0;
+	}
 
 	if (ret != -FI_EAGAIN) {
 		FI_DBG(&rxm_prov, FI_LOG_EP_CTRL,
@@ -1775,13 +2058,89 @@ int rxm_post_recv(struct rxm_rx_buf *rx_buf)
 	return ret;
 }
 
+/* Post now, or at the end of the current completion batch.  A queued
+ * buffer counts as posted for the conn's rx credit target.
+ */
+int rxm_repost_recv(struct rxm_rx_buf *rx_buf)
+{
+	if (!rx_buf->ep->repost_batch)
+		return rxm_post_recv(rx_buf);
+
+	rxm_reset_rx_buf(rx_buf);
+	rxm_rx_buf_credit(rx_buf)->posted++;
+	dlist_insert_tail(&rx_buf->repost_entry, &rx_buf->ep->repost_list);
+	return 0;
+}
+
+/* Buffers going to the same msg ep or srx are posted with FI_MORE on all
+ * but the last, so the MSG provider may post them as one request.
+ */
+void rxm_flush_reposts(struct rxm_ep *ep)
+{
+	struct rxm_domain *domain;
+	struct rxm_rx_buf *rx_buf, *next;
+	struct iovec iov;
+	struct fi_msg msg = {
+		.msg_iov = &iov,
+		.iov_count = 1,
+		.addr = FI_ADDR_UNSPEC,
+	};
+	uint64_t flags;
+	int ret;
+
+	domain = container_of(ep->util_ep.domain, struct rxm_domain,
+			      util_domain);
+	iov.iov_len = domain->rx_post_size;
+
+	while (!dlist_empty(&ep->repost_list)) {
+		dlist_pop_front(&ep->repost_list, struct rxm_rx_buf,
+				rx_buf, repost_entry);
+
+		flags = 0;
+		if (!dlist_empty(&ep->repost_list)) {
+			next = container_of(ep->repost_list.next,
+					    struct rxm_rx_buf, repost_entry);
+			if (next->rx_ep == rx_buf->rx_ep)
+				flags = FI_MORE;
+		}
+
+		iov.iov_base = &rx_buf->pkt;
+		msg.desc = &rx_buf->hdr.desc;
+		msg.context = rx_buf;
+		ret = (int) fi_recvmsg(rx_buf->rx_ep, &msg, flags);
+		if (ret) {
+			FI_DBG(&rxm_prov, FI_LOG_EP_CTRL,
+			       "unable to post recv buf: %d\n", ret);
+			rxm_rx_buf_credit(rx_buf)->posted--;
+			ofi_buf_free(rx_buf);
+		}
+	}
+}
+
 int rxm_prepost_recv(struct rxm_ep *ep, struct fid_ep *rx_ep)
 {
+	struct rxm_rx_credit *credit;
+	struct rxm_conn *conn;
 	struct rxm_rx_buf *rx_buf;
+	size_t i, cnt;
 	int ret;
-	size_t i;
 
-	for (i = 0; i < ep->msg_info->rx_attr->size; i++) {
+	/* The srx is shared, so its buffers are counted per ep */
+	if (ep->msg_srx) {
+		credit = &ep->srx_credit;
+	} else {
+		conn = rx_ep->fid.context;
+		credit = &conn->rx_credit;
+	}
+
+	cnt = ep->msg_info->rx_attr->size;
+	credit->posted = 0;
+	credit->target = rxm_msg_rx_min ? MIN(rxm_msg_rx_min, cnt) : cnt;
+	credit->cnt = 0;
+	credit->start = ofi_gettime_ns();
+	cnt = credit->target;
+
+	for (i = 0; i < cnt; i++) {
 		rx_buf = rxm_rx_buf_alloc(ep, rx_ep);
 		if (!rx_buf)
 			return -FI_ENOMEM;
@@ -1809,6 +2168,7 @@ void rxm_ep_do_progress(struct util_ep *util_ep)
 		ret = fi_cq_read(rxm_ep->msg_cq, &comp, 32);
 		if (ret > 0) {
 			comp_read += ret;
+			rxm_ep->repost_batch = true;
 			for (i = 0; i < ret; i++) {
 				err = rxm_ep->handle_comp(rxm_ep, &comp[i]);
 				if (err) {
@@ -1817,6 +2177,8 @@ void rxm_ep_do_progress(struct util_ep *util_ep)
 					rxm_cq_write_error_all(rxm_ep, (int) err);
 				}
 			}
+			rxm_ep->repost_batch = false;
+			rxm_flush_reposts(rxm_ep);
 		} else if (ret < 0 && (ret != -FI_EAGAIN)) {
 			if (ret == -FI_EAVAIL)
 				rxm_ep->handle_comp_error(rxm_ep);
@@ -394,6 +394,52 @@ struct rxm_mr *rxm_mr_get_map_entry(struct rxm_domain *domain, uint64_t key)
 	return mr;
 }
 
+static int rxm_domain_init_staging(struct rxm_domain *rxm_domain,
+				   struct fi_info *msg_info)
+{
+	struct ofi_hmem_staging *staging;
+	int ret;
+
+	staging = calloc(1, sizeof(*staging));
+	if (!staging)
+		return -FI_ENOMEM;
+
+	ret = ofi_hmem_staging_init(staging, rxm_staging_size);
+	if (ret)
+		goto free;
+
+	if (ofi_mr_local(msg_info)) {
+		ret = rxm_msg_mr_reg_internal(rxm_domain, staging->base,
+					      staging->size,
+					      FI_SEND | FI_RECV | FI_READ |
+					      FI_WRITE, OFI_MR_NOCACHE,
+					      (struct fid_mr **) &staging->context);
+		if (ret)
+			goto cleanup;
+	}
+
+	rxm_domain->staging = staging;
+	return 0;
+
+cleanup:
+	ofi_hmem_staging_cleanup(staging);
+free:
+	free(staging);
+	return ret;
+}
+
+static void rxm_domain_close_staging(struct rxm_domain *rxm_domain)
+{
+	if (!rxm_domain->staging)
+		return;
+
+	if (rxm_domain->staging->context)
+		fi_close(rxm_domain->staging->context);
+	ofi_hmem_staging_cleanup(rxm_domain->staging);
+	free(rxm_domain->staging);
+	rxm_domain->staging = NULL;
+}
+
 static int rxm_domain_close(fid_t fid)
 {
 	struct rxm_domain *rxm_domain;
@@ -401,8 +447,8 @@ static int rxm_domain_close(fid_t fid)
 
 	rxm_domain = container_of(fid, struct rxm_domain, util_domain.domain_fid.fid);
 
-	ofi_mutex_destroy(&rxm_domain->amo_bufpool_lock);
 	ofi_bufpool_destroy(rxm_domain->amo_bufpool);
+	rxm_domain_close_staging(rxm_domain);
 
 	ret = fi_close(&rxm_domain->msg_domain->fid);
 	if (ret)
@@ -932,12 +978,11 @@ int rxm_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 	(*domain)->ops = &rxm_domain_ops;
 
 	ret = ofi_bufpool_create(&rxm_domain->amo_bufpool,
-				 rxm_domain->max_atomic_size, 64, 0, 0, 0);
+				 rxm_domain->max_atomic_size, 64, 0, 0,
+				 OFI_BUFPOOL_PERTHREAD);
 	if (ret)
 		goto err5;
 
-	ofi_mutex_init(&rxm_domain->amo_bufpool_lock);
-
 	rxm_domain->passthru = rxm_passthru_info(info);
 	if (rxm_domain->passthru)
 		(*domain)->mr = &rxm_domain_mr_thru_ops;
@@ -948,11 +993,19 @@ int rxm_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 	if (ret)
 		goto err6;
 
+	if ((info->caps & FI_HMEM) && rxm_staging_size) {
+		ret = rxm_domain_init_staging(rxm_domain, msg_info);
+		if (ret) {
+			FI_WARN(&rxm_prov, FI_LOG_DOMAIN,
+				"Unable to create host staging area\n");
+			goto err6;
+		}
+	}
+
 	fi_freeinfo(msg_info);
 	return 0;
 
 err6:
-	ofi_mutex_destroy(&rxm_domain->amo_bufpool_lock);
 	ofi_bufpool_destroy(rxm_domain->amo_bufpool);
 err5:
 	if (rxm_domain->offload_coll_domain)
@@ -115,12 +115,18 @@ static int rxm_match_unexp_msg_tag_addr(struct dlist_entry *item, const void *ar
 		ofi_match_tag(attr->tag, attr->ignore, unexp_msg->tag);
 }
 
+/*
+ * Regions taken from the domain staging area are already registered with
+ * the HMEM ifaces, and with the msg provider if it needs local MRs.
+ */
 static int rxm_buf_reg(struct ofi_bufpool_region *region)
 {
 	struct rxm_ep *rxm_ep = region->pool->attr.context;
+	struct ofi_hmem_staging *staging = region->pool->attr.staging;
 	struct rxm_domain *rxm_domain;
 	int ret;
-	bool hmem_enabled = !!(rxm_ep->util_ep.caps & FI_HMEM);
+	bool hmem_enabled = !!(rxm_ep->util_ep.caps & FI_HMEM) &&
+			    !(region->flags & OFI_BUFPOOL_STAGING);
 
 	if (hmem_enabled) {
 		ret = ofi_hmem_host_register(region->mem_region,
@@ -132,6 +138,11 @@ static int rxm_buf_reg(struct ofi_bufpool_region *region)
 	if (!rxm_ep->msg_mr_local)
 		return 0;
 
+	if ((region->flags & OFI_BUFPOOL_STAGING) && staging->context) {
+		region->context = staging->context;
+		return 0;
+	}
+
 	rxm_domain = container_of(rxm_ep->util_ep.domain,
 				  struct rxm_domain, util_domain);
 
@@ -175,6 +186,13 @@ static void rxm_init_tx_buf(struct ofi_bufpool_region *region, void *buf)
 static void rxm_buf_close(struct ofi_bufpool_region *region)
 {
 	struct rxm_ep *ep = region->pool->attr.context;
+	struct ofi_hmem_staging *staging = region->pool->attr.staging;
+
+	if (region->flags & OFI_BUFPOOL_STAGING) {
+		if (ep->msg_mr_local && region->context != staging->context)
+			fi_close(region->context);
+		return;
+	}
 
 	if (ep->util_ep.caps & FI_HMEM)
 		ofi_hmem_host_unregister(region->mem_region);
@@ -195,6 +213,7 @@ static void rxm_recv_entry_init(struct rxm_recv_entry *entry, void *arg)
 	entry->recv_queue = recv_queue;
 	entry->sar.msg_id = RXM_SAR_RX_INIT;
 	entry->sar.total_recv_len = 0;
+	entry->sar.data_len = 0;
 	/* set it to NULL to differentiate between regular ACKs and those
 	 * sent with FI_INJECT */
 	entry->rndv.tx_buf = NULL;
@@ -206,9 +225,36 @@ static void rxm_recv_entry_init(struct rxm_recv_entry *entry, void *arg)
 		entry->comp_flags |= FI_TAGGED;
 }
 
+static int rxm_recv_queue_init_buckets(struct rxm_recv_queue *recv_queue)
+{
+	size_t i;
+
+	recv_queue->bucket_mask =
+		ofi_tag_bucket_mask(recv_queue->rxm_ep->tag_buckets);
+	recv_queue->recv_buckets = calloc(recv_queue->bucket_mask + 1,
+					  sizeof(*recv_queue->recv_buckets));
+	recv_queue->unexp_buckets = calloc(recv_queue->bucket_mask + 1,
+					   sizeof(*recv_queue->unexp_buckets));
+	if (!recv_queue->recv_buckets || !recv_queue->unexp_buckets) {
+		free(recv_queue->recv_buckets);
+		free(recv_queue->unexp_buckets);
+		recv_queue->recv_buckets = NULL;
+		recv_queue->unexp_buckets = NULL;
+		return -FI_ENOMEM;
+	}
+
+	for (i = 0; i <= recv_queue->bucket_mask; i++) {
+		dlist_init(&recv_queue->recv_buckets[i]);
+		dlist_init(&recv_queue->unexp_buckets[i]);
+	}
+	return 0;
+}
+
 static int rxm_recv_queue_init(struct rxm_ep *rxm_ep,  struct rxm_recv_queue *recv_queue,
 			       size_t size, enum rxm_recv_queue_type type)
 {
+	int ret;
+
 	recv_queue->rxm_ep = rxm_ep;
 	recv_queue->type = type;
 	recv_queue->fs = rxm_recv_fs_create(size, rxm_recv_entry_init,
@@ -216,6 +262,16 @@ static int rxm_recv_queue_init(struct rxm_ep *rxm_ep,  struct rxm_recv_queue *re
 	if (!recv_queue->fs)
 		return -FI_ENOMEM;
 
+	if (type == RXM_RECV_QUEUE_TAGGED && rxm_ep->tag_buckets) {
+		ret = rxm_recv_queue_init_buckets(recv_queue);
+		if (ret) {
+			rxm_recv_fs_free(recv_queue->fs);
+			recv_queue->fs = NULL;
+			return ret;
+		}
+	}
+
+	recv_queue->seq_no = 0;
 	dlist_init(&recv_queue->recv_list);
 	dlist_init(&recv_queue->unexp_msg_list);
 	if (type == RXM_RECV_QUEUE_MSG) {
@@ -246,13 +302,30 @@ static void rxm_recv_queue_close(struct rxm_recv_queue *recv_queue)
 		rxm_recv_fs_free(recv_queue->fs);
 		recv_queue->fs = NULL;
 	}
+	free(recv_queue->recv_buckets);
+	free(recv_queue->unexp_buckets);
+	recv_queue->recv_buckets = NULL;
+	recv_queue->unexp_buckets = NULL;
 	// TODO cleanup recv_list and unexp msg list
 }
 
+static int rxm_ep_nic_numa_node(struct rxm_ep *rxm_ep)
+{
+	struct fid_nic *nic = rxm_ep->msg_info->nic;
+
+	if (!nic || !nic->bus_attr || nic->bus_attr->bus_type != FI_BUS_PCI)
+		return -FI_ENODATA;
+
+	return ofi_pci_numa_node(&nic->bus_attr->attr.pci);
+}
+
 static int rxm_ep_create_pools(struct rxm_ep *rxm_ep)
 {
+	struct rxm_domain *rxm_domain = container_of(rxm_ep->util_ep.domain,
+						     struct rxm_domain,
+						     util_domain);
 	struct ofi_bufpool_attr attr = {0};
-	int ret;
+	int node, ret;
 
 	attr.size = rxm_buffer_size + sizeof(struct rxm_rx_buf);
 	attr.alignment = 16;
@@ -262,6 +335,15 @@ static int rxm_ep_create_pools(struct rxm_ep *rxm_ep)
 	attr.init_fn = rxm_init_rx_buf;
 	attr.context = rxm_ep;
 	attr.flags = OFI_BUFPOOL_NO_TRACK;
+	if (rxm_ep->util_ep.caps & FI_HMEM)
+		attr.staging = rxm_domain->staging;
+
+	/* Keep bounce buffers on the node of the NIC that reads them */
+	node = rxm_ep_nic_numa_node(rxm_ep);
+	if (node >= 0) {
+		attr.flags |= OFI_BUFPOOL_NUMA;
+		attr.numa_node = node;
+	}
 
 	ret = ofi_bufpool_create_attr(&attr, &rxm_ep->rx_pool);
 	if (ret) {
@@ -426,12 +508,19 @@ static bool rxm_ep_cancel_recv(struct rxm_ep *rxm_ep,
 	struct fi_cq_err_entry err_entry;
 	struct rxm_recv_entry *recv_entry;
 	struct dlist_entry *entry;
+	size_t i;
 	int ret;
 
 	ofi_genlock_lock(&rxm_ep->util_ep.lock);
 	entry = dlist_remove_first_match(&recv_queue->recv_list,
 					 rxm_match_recv_entry_context,
 					 context);
+	for (i = 0; !entry && recv_queue->recv_buckets &&
+	     i <= recv_queue->bucket_mask; i++) {
+		entry = dlist_remove_first_match(&recv_queue->recv_buckets[i],
+						 rxm_match_recv_entry_context,
+						 context);
+	}
 	if (!entry)
 		goto unlock;
 
@@ -494,6 +583,11 @@ static int rxm_ep_getopt(fid_t fid, int level, int optname, void *optval,
 		*(size_t *)optval = rxm_ep->buffered_limit;
 		*optlen = sizeof(size_t);
 		break;
+	case FI_OPT_TAG_BUCKETS:
+		*(size_t *)optval = rxm_ep->tag_buckets ?
+			ofi_tag_bucket_mask(rxm_ep->tag_buckets) + 1 : 0;
+		*optlen = sizeof(size_t);
+		break;
 	default:
 		return -FI_ENOPROTOOPT;
 	}
@@ -554,6 +648,18 @@ static int rxm_ep_setopt(fid_t fid, int level, int optname,
 				rxm_ep->buffered_limit);
 		}
 		break;
+	case FI_OPT_TAG_BUCKETS:
+		if (rxm_ep->rx_pool) {
+			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+				"Endpoint already enabled. Can't set opt now!\n");
+			ret = -FI_EOPBADSTATE;
+		} else {
+			rxm_ep->tag_buckets = *(size_t *)optval;
+			FI_INFO(&rxm_prov, FI_LOG_CORE,
+				"FI_OPT_TAG_BUCKETS set to %zu\n",
+				rxm_ep->tag_buckets);
+		}
+		break;
 	case FI_OPT_CUDA_API_PERMITTED:
 		if (!hmem_ops[FI_HMEM_CUDA].initialized) {
 			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
@@ -589,6 +695,145 @@ static struct fi_ops_ep rxm_ops_ep = {
 };
 
 
+/* Without directed receive, every receive matches any source */
+static inline fi_addr_t
+rxm_bucket_addr(struct rxm_recv_queue *recv_queue, fi_addr_t addr)
+{
+	return (recv_queue->rxm_ep->rxm_info->caps & FI_DIRECTED_RECV) ?
+	       addr : FI_ADDR_UNSPEC;
+}
+
+static inline struct dlist_entry *
+rxm_recv_bucket(struct rxm_recv_queue *recv_queue, fi_addr_t addr,
+		uint64_t tag)
+{
+	return &recv_queue->recv_buckets[ofi_tag_bucket(recv_queue->bucket_mask,
+							addr, tag)];
+}
+
+static inline struct dlist_entry *
+rxm_unexp_bucket(struct rxm_recv_queue *recv_queue, uint64_t tag)
+{
+	return &recv_queue->unexp_buckets[ofi_tag_bucket(recv_queue->bucket_mask,
+							 FI_ADDR_UNSPEC, tag)];
+}
+
+void rxm_insert_recv(struct rxm_recv_queue *recv_queue,
+		     struct rxm_recv_entry *recv_entry)
+{
+	struct dlist_entry *queue = &recv_queue->recv_list;
+
+	recv_entry->seq_no = recv_queue->seq_no++;
+	if (recv_queue->recv_buckets && !recv_entry->ignore) {
+		queue = rxm_recv_bucket(recv_queue,
+				rxm_bucket_addr(recv_queue, recv_entry->addr),
+				recv_entry->tag);
+	}
+	dlist_insert_tail(&recv_entry->entry, queue);
+}
+
+/* Each queue is kept in posting order, so only an entry posted before the
+ * current candidate may replace it.
+ */
+static void
+rxm_search_recv_bucket(struct rxm_recv_queue *recv_queue, fi_addr_t addr,
+		       uint64_t tag, struct rxm_recv_entry **match)
+{
+	struct dlist_entry *bucket = rxm_recv_bucket(recv_queue, addr, tag);
+	struct rxm_recv_entry *recv_entry;
+
+	dlist_foreach_container(bucket, struct rxm_recv_entry, recv_entry,
+				entry) {
+		if (*match && recv_entry->seq_no > (*match)->seq_no)
+			return;
+		if (recv_entry->tag == tag &&
+		    rxm_bucket_addr(recv_queue, recv_entry->addr) == addr) {
+			*match = recv_entry;
+			return;
+		}
+	}
+}
+
+static void
+rxm_search_recv_list(struct rxm_recv_queue *recv_queue,
+		     struct rxm_recv_match_attr *match_attr,
+		     struct rxm_recv_entry **match)
+{
+	struct rxm_recv_entry *recv_entry;
+
+	dlist_foreach_container(&recv_queue->recv_list, struct rxm_recv_entry,
+				recv_entry, entry) {
+		if (*match && recv_entry->seq_no > (*match)->seq_no)
+			return;
+		if (recv_queue->match_recv(&recv_entry->entry, match_attr)) {
+			*match = recv_entry;
+			return;
+		}
+	}
+}
+
+struct rxm_recv_entry *
+rxm_remove_recv(struct rxm_recv_queue *recv_queue,
+		struct rxm_recv_match_attr *match_attr)
+{
+	struct rxm_recv_entry *match = NULL;
+	struct dlist_entry *entry;
+	fi_addr_t addr;
+
+	if (!recv_queue->recv_buckets) {
+		entry = dlist_remove_first_match(&recv_queue->recv_list,
+						 recv_queue->match_recv,
+						 match_attr);
+		return entry ? container_of(entry, struct rxm_recv_entry,
+					    entry) : NULL;
+	}
+
+	addr = rxm_bucket_addr(recv_queue, match_attr->addr);
+	if (addr != FI_ADDR_UNSPEC)
+		rxm_search_recv_bucket(recv_queue, addr, match_attr->tag,
+				       &match);
+	rxm_search_recv_bucket(recv_queue, FI_ADDR_UNSPEC, match_attr->tag,
+			       &match);
+	rxm_search_recv_list(recv_queue, match_attr, &match);
+
+	if (match)
+		dlist_remove(&match->entry);
+	return match;
+}
+
+void rxm_insert_unexp_msg(struct rxm_recv_queue *recv_queue,
+			  struct rxm_rx_buf *rx_buf)
+{
+	dlist_insert_tail(&rx_buf->unexp_msg.entry,
+			  &recv_queue->unexp_msg_list);
+	if (recv_queue->unexp_buckets) {
+		dlist_insert_tail(&rx_buf->unexp_msg.bucket_entry,
+				  rxm_unexp_bucket(recv_queue,
+						   rx_buf->unexp_msg.tag));
+	} else {
+		dlist_init(&rx_buf->unexp_msg.bucket_entry);
+	}
+}
+
+/* A receive with no ignore bits only needs to look at its tag's bucket,
+ * which holds the unexpected messages for that tag in arrival order.
+ */
+static struct dlist_entry *
+rxm_find_unexp_bucket(struct rxm_recv_queue *recv_queue,
+		      struct rxm_recv_match_attr *match_attr)
+{
+	struct rxm_rx_buf *rx_buf;
+
+	dlist_foreach_container(rxm_unexp_bucket(recv_queue, match_attr->tag),
+				struct rxm_rx_buf, rx_buf,
+				unexp_msg.bucket_entry) {
+		if (recv_queue->match_unexp(&rx_buf->unexp_msg.entry,
+					    match_attr))
+			return &rx_buf->unexp_msg.entry;
+	}
+	return NULL;
+}
+
 /* Caller must hold recv_queue->lock -- TODO which lock? */
 struct rxm_rx_buf *
 rxm_get_unexp_msg(struct rxm_recv_queue *recv_queue, fi_addr_t addr,
@@ -604,8 +849,12 @@ rxm_get_unexp_msg(struct rxm_recv_queue *recv_queue, fi_addr_t addr,
 	match_attr.tag = tag;
 	match_attr.ignore = ignore;
 
-	entry = dlist_find_first_match(&recv_queue->unexp_msg_list,
-				       recv_queue->match_unexp, &match_attr);
+	if (recv_queue->unexp_buckets && !ignore)
+		entry = rxm_find_unexp_bucket(recv_queue, &match_attr);
+	else
+		entry = dlist_find_first_match(&recv_queue->unexp_msg_list,
+					       recv_queue->match_unexp,
+					       &match_attr);
 	if (!entry)
 		return NULL;
 
@@ -633,6 +882,7 @@ static void rxm_recv_entry_init_common(struct rxm_recv_entry *recv_entry,
 
 	recv_entry->sar.msg_id = RXM_SAR_RX_INIT;
 	recv_entry->sar.total_recv_len = 0;
+	recv_entry->sar.data_len = 0;
 	recv_entry->total_len = 0;
 
 	for (i = 0; i < count; i++) {
@@ -776,12 +1026,21 @@ rxm_ep_sar_handle_segment_failure(struct rxm_deferred_tx_entry *def_tx_entry,
 }
 
 /* Returns FI_SUCCESS if the SAR deferred TX queue is empty,
- * otherwise, it returns -FI_EAGAIN or error from MSG provider */
+ * otherwise, it returns -FI_EAGAIN or error from MSG provider.
+ * -FI_EAGAIN is also returned while the message has rxm_sar_window
+ * segments outstanding.
+ */
 static ssize_t
 rxm_ep_progress_sar_deferred_segments(struct rxm_deferred_tx_entry *def_tx_entry)
 {
 	ssize_t ret = 0;
 	struct rxm_tx_buf *tx_buf = def_tx_entry->sar_seg.cur_seg_tx_buf;
+	struct rxm_tx_buf *first_tx_buf;
+
+	first_tx_buf = ofi_bufpool_get_ibuf(def_tx_entry->rxm_ep->tx_pool,
+					    def_tx_entry->sar_seg.msg_id);
+	if (rxm_sar_window && first_tx_buf->sar_inflight >= rxm_sar_window)
+		return -FI_EAGAIN;
 
 	if (tx_buf) {
 		ret = fi_send(def_tx_entry->rxm_conn->msg_ep, &tx_buf->pkt,
@@ -795,6 +1054,8 @@ rxm_ep_progress_sar_deferred_segments(struct rxm_deferred_tx_entry *def_tx_entry
 			return ret;
 		}
 
+		first_tx_buf->sar_inflight++;
+		def_tx_entry->sar_seg.cur_seg_tx_buf = NULL;
 		def_tx_entry->sar_seg.next_seg_no++;
 		def_tx_entry->sar_seg.remain_len -= rxm_buffer_size;
 
@@ -808,6 +1069,10 @@ rxm_ep_progress_sar_deferred_segments(struct rxm_deferred_tx_entry *def_tx_entry
 
 	while (def_tx_entry->sar_seg.next_seg_no !=
 	       def_tx_entry->sar_seg.segs_cnt) {
+		if (rxm_sar_window &&
+		    first_tx_buf->sar_inflight >= rxm_sar_window)
+			return -FI_EAGAIN;
+
 		ret = rxm_send_segment(
 				def_tx_entry->rxm_ep, def_tx_entry->rxm_conn,
 				def_tx_entry->sar_seg.app_context,
@@ -834,6 +1099,8 @@ rxm_ep_progress_sar_deferred_segments(struct rxm_deferred_tx_entry *def_tx_entry
 
 			return ret;
 		}
+		first_tx_buf->sar_inflight++;
+		def_tx_entry->sar_seg.cur_seg_tx_buf = NULL;
 		def_tx_entry->sar_seg.next_seg_no++;
 		def_tx_entry->sar_seg.remain_len -= rxm_buffer_size;
 	}
@@ -867,6 +1134,14 @@ void rxm_ep_progress_deferred_queue(struct rxm_ep *rxm_ep,
 			if (ret) {
 				if (ret == -FI_EAGAIN)
 					return;
+				if (def_tx_entry->rndv_ack.rx_buf->recv_entry->
+				    rndv.tx_buf->pkt.ctrl_hdr.type ==
+				    rxm_ctrl_rndv_rd_done) {
+					rxm_rndv_rd_done_err(
+						def_tx_entry->rndv_ack.rx_buf,
+						(int) ret);
+					break;
+				}
 				rxm_cq_write_error(def_tx_entry->rxm_ep->util_ep.rx_cq,
 						   def_tx_entry->rxm_ep->util_ep.cntrs[CNTR_RX],
 						   def_tx_entry->rndv_ack.rx_buf->
@@ -892,9 +1167,10 @@ void rxm_ep_progress_deferred_queue(struct rxm_ep *rxm_ep,
 			if (ret) {
 				if (ret == -FI_EAGAIN)
 					return;
-				rxm_cq_write_error(def_tx_entry->rxm_ep->util_ep.tx_cq,
-						   def_tx_entry->rxm_ep->util_ep.cntrs[CNTR_TX],
-						   def_tx_entry->rndv_done.tx_buf, (int) ret);
+				rxm_rndv_wr_done_err(def_tx_entry->rxm_ep,
+						     def_tx_entry->rndv_done.tx_buf,
+						     (int) ret);
+				break;
 			}
 			RXM_UPDATE_STATE(FI_LOG_EP_DATA,
 					 def_tx_entry->rndv_done.tx_buf,
@@ -912,10 +1188,9 @@ void rxm_ep_progress_deferred_queue(struct rxm_ep *rxm_ep,
 			if (ret) {
 				if (ret == -FI_EAGAIN)
 					return;
-				rxm_cq_write_error(def_tx_entry->rxm_ep->util_ep.rx_cq,
-						   def_tx_entry->rxm_ep->util_ep.cntrs[CNTR_RX],
-						   def_tx_entry->rndv_read.rx_buf->
-							recv_entry->context, (int) ret);
+				rxm_rndv_read_chunk_err(
+					def_tx_entry->rndv_read.rx_buf,
+					(int) ret);
 			}
 			break;
 		case RXM_DEFERRED_TX_RNDV_WRITE:
@@ -930,9 +1205,9 @@ void rxm_ep_progress_deferred_queue(struct rxm_ep *rxm_ep,
 			if (ret) {
 				if (ret == -FI_EAGAIN)
 					return;
-				rxm_cq_write_error(def_tx_entry->rxm_ep->util_ep.rx_cq,
-						   def_tx_entry->rxm_ep->util_ep.cntrs[CNTR_RX],
-						   def_tx_entry->rndv_write.tx_buf, (int) ret);
+				rxm_rndv_write_chunk_err(def_tx_entry->rxm_ep,
+					def_tx_entry->rndv_write.tx_buf,
+					(int) ret);
 			}
 			break;
 		case RXM_DEFERRED_TX_SAR_SEG:
@@ -1408,8 +1683,6 @@ err:
 
 static void rxm_ep_init_proto(struct rxm_ep *ep)
 {
-	size_t param;
-
 	if (ep->eager_limit < rxm_buffer_size)
 		ep->eager_limit = rxm_buffer_size;
 
@@ -1419,11 +1692,11 @@ static void rxm_ep_init_proto(struct rxm_ep *ep)
 		return;
 	}
 
-	if (!fi_param_get_size_t(&rxm_prov, "sar_limit", &param)) {
-		if (param <= ep->eager_limit)
+	if (rxm_sar_limit) {
+		if (rxm_sar_limit <= ep->eager_limit)
 			ep->sar_limit = ep->eager_limit;
 		else
-			ep->sar_limit = param;
+			ep->sar_limit = rxm_sar_limit;
 	} else {
 		ep->sar_limit = ep->eager_limit * 8;
 	}
@@ -1436,13 +1709,10 @@ static void rxm_ep_init_proto(struct rxm_ep *ep)
  */
 static void rxm_config_direct_send(struct rxm_ep *ep)
 {
-	int ret = 1;
-
 	if (ep->msg_mr_local)
 		return;
 
-	fi_param_get_bool(&rxm_prov, "enable_direct_send", &ret);
-	ep->enable_direct_send = (ret != 0);
+	ep->enable_direct_send = (rxm_enable_direct_send != 0);
 }
 
 
@@ -1479,6 +1749,8 @@ static void rxm_ep_settings_init(struct rxm_ep *rxm_ep)
 	assert(!rxm_ep->buffered_limit);
 	rxm_ep->buffered_limit = rxm_buffer_size;
 
+	rxm_ep->tag_buckets = ofi_srx_tag_buckets;
+
 	rxm_config_direct_send(rxm_ep);
 	rxm_ep_init_proto(rxm_ep);
 
@@ -1586,6 +1858,8 @@ static int rxm_ep_ctrl(struct fid *fid, int command, void *arg)
 		if (ret)
 			return ret;
 
+		rxm_ep_init_msg_atomics(ep);
+
 		if (ep->msg_srx && !rxm_passthru_info(ep->rxm_info)) {
 			ret = rxm_prepost_recv(ep, ep->msg_srx);
 			if (ret)
@@ -1767,7 +2041,7 @@ err1:
 
 static ssize_t
 rxm_prepare_deferred_rndv_read(struct rxm_deferred_tx_entry **def_tx_entry,
-			       size_t index, struct iovec *iov,
+			       uint64_t addr, uint64_t key, struct iovec *iov,
 			       void *desc[RXM_IOV_LIMIT], size_t count,
 			       void *buf)
 {
@@ -1780,10 +2054,8 @@ rxm_prepare_deferred_rndv_read(struct rxm_deferred_tx_entry **def_tx_entry,
 		return -FI_ENOMEM;
 
 	(*def_tx_entry)->rndv_read.rx_buf = rx_buf;
-	(*def_tx_entry)->rndv_read.rma_iov.addr =
-			rx_buf->remote_rndv_hdr->iov[index].addr;
-	(*def_tx_entry)->rndv_read.rma_iov.key =
-			rx_buf->remote_rndv_hdr->iov[index].key;
+	(*def_tx_entry)->rndv_read.rma_iov.addr = addr;
+	(*def_tx_entry)->rndv_read.rma_iov.key = key;
 
 	for (i = 0; i < count; i++) {
 		(*def_tx_entry)->rndv_read.rxm_iov.iov[i] = iov[i];
@@ -1796,7 +2068,7 @@ rxm_prepare_deferred_rndv_read(struct rxm_deferred_tx_entry **def_tx_entry,
 
 static ssize_t
 rxm_prepare_deferred_rndv_write(struct rxm_deferred_tx_entry **def_tx_entry,
-			       size_t index, struct iovec *iov,
+			       uint64_t addr, uint64_t key, struct iovec *iov,
 			       void *desc[RXM_IOV_LIMIT], size_t count,
 			       void *buf)
 {
@@ -1810,10 +2082,8 @@ rxm_prepare_deferred_rndv_write(struct rxm_deferred_tx_entry **def_tx_entry,
 		return -FI_ENOMEM;
 
 	(*def_tx_entry)->rndv_write.tx_buf = tx_buf;
-	(*def_tx_entry)->rndv_write.rma_iov.addr =
-			tx_buf->write_rndv.remote_hdr.iov[index].addr;
-	(*def_tx_entry)->rndv_write.rma_iov.key =
-			tx_buf->write_rndv.remote_hdr.iov[index].key;
+	(*def_tx_entry)->rndv_write.rma_iov.addr = addr;
+	(*def_tx_entry)->rndv_write.rma_iov.key = key;
 
 	for (i = 0; i < count; i++) {
 		(*def_tx_entry)->rndv_write.rxm_iov.iov[i] = iov[i];
@@ -1861,9 +2131,7 @@ int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 		goto err1;
 	}
 
-	if (fi_param_get_int(&rxm_prov, "comp_per_progress",
-			     (int *)&rxm_ep->comp_per_progress))
-		rxm_ep->comp_per_progress = 1;
+	rxm_ep->comp_per_progress = rxm_comp_per_progress;
 
 	if (rxm_ep->rxm_info->caps & FI_COLLECTIVE) {
 		ret = ofi_endpoint_init(domain, &rxm_util_prov, info,
@@ -1963,6 +2231,8 @@ int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 		(*ep_fid)->atomic = &rxm_ops_atomic;
 
 	dlist_init(&rxm_ep->loopback_list);
+	dlist_init(&rxm_ep->conn_lru);
+	dlist_init(&rxm_ep->repost_list);
 
 	return 0;
 err2:
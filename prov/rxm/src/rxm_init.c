@@ -49,6 +49,7 @@
 
 size_t rxm_msg_tx_size;
 size_t rxm_msg_rx_size;
+size_t rxm_msg_rx_min;
 size_t rxm_def_rx_size = 2048;
 size_t rxm_def_tx_size = 2048;
 
@@ -58,6 +59,18 @@ size_t rxm_packet_size;
 int rxm_passthru = 0; /* disable by default, need to analyze performance */
 int force_auto_progress;
 int rxm_use_write_rndv;
+size_t rxm_sar_limit;
+size_t rxm_sar_window;
+size_t rxm_rndv_chunk_size;
+size_t rxm_rndv_window;
+size_t rxm_staging_size;
+int rxm_proto_tune;
+int rxm_msg_atomics;
+size_t rxm_conn_max;
+size_t rxm_conn_idle_timeout = 1000;
+int rxm_enable_direct_send = 1;
+int rxm_comp_per_progress = 1;
+static int rxm_use_srx_env = -1;
 enum fi_wait_obj def_wait_obj = FI_WAIT_FD, def_tcp_wait_obj = FI_WAIT_UNSPEC;
 
 char *rxm_proto_state_str[] = {
@@ -110,11 +123,9 @@ static bool rxm_use_srx(const struct fi_info *hints,
 			const struct fi_info *base_info)
 {
 	const struct fi_info *info;
-	int ret, use_srx = 0;
 
-	ret = fi_param_get_bool(&rxm_prov, "use_srx", &use_srx);
-	if (ret != -FI_ENODATA)
-		return use_srx;
+	if (rxm_use_srx_env >= 0)
+		return rxm_use_srx_env;
 
 	info = base_info ? base_info : hints;
 
@@ -617,6 +628,8 @@ static void rxm_get_def_wait(void)
 
 RXM_INI
 {
+	int use_srx;
+
 	fi_param_define(&rxm_prov, "buffer_size", FI_PARAM_SIZE_T,
 			"Defines the allocated buffer size used for bounce "
 			"buffers, including buffers posted at the receive side "
@@ -640,6 +653,60 @@ RXM_INI
 			"eager_limit to take effect.  (default %zu).",
 			rxm_buffer_size * 8);
 
+	fi_param_define(&rxm_prov, "sar_window", FI_PARAM_SIZE_T,
+			"Maximum number of segments of a single SAR message "
+			"posted to the msg endpoint at once.  Later segments "
+			"are sent as earlier ones complete, which keeps one "
+			"large message from taking every transmit buffer.  "
+			"0 posts segments until the msg endpoint is full. "
+			"(default: 0)");
+
+	fi_param_define(&rxm_prov, "rndv_chunk_size", FI_PARAM_SIZE_T,
+			"Splits the RMA reads or writes of a rendezvous "
+			"transfer into chunks of at most this many bytes.  "
+			"0 issues one RMA operation per buffer. (default: 0)");
+
+	fi_param_define(&rxm_prov, "rndv_window", FI_PARAM_SIZE_T,
+			"Maximum number of RMA operations of a single "
+			"rendezvous transfer outstanding at once.  Later "
+			"chunks are posted as earlier ones complete.  0 posts "
+			"every chunk at once. (default: 0)");
+
+	fi_param_define(&rxm_prov, "staging_size", FI_PARAM_SIZE_T,
+			"Size of the host staging area allocated and "
+			"registered once per domain opened with FI_HMEM.  "
+			"Bounce buffers are taken from it while it has room, "
+			"so copies to and from device memory run at pinned "
+			"memory bandwidth.  0 registers each buffer region "
+			"as it is allocated. (default: 0)");
+
+	fi_param_define(&rxm_prov, "proto_tune", FI_PARAM_BOOL,
+			"Time SAR and rendezvous sends near the switch point "
+			"between them, and move that point per connection "
+			"toward the cheaper protocol.  The eager limit is not "
+			"changed. (default: false)");
+
+	fi_param_define(&rxm_prov, "msg_atomics", FI_PARAM_BOOL,
+			"Issue single element atomics on registered memory "
+			"directly to the msg provider when it supports the "
+			"datatype and op natively.  Other atomics are still "
+			"emulated at the target, and must not target the same "
+			"memory as native ones. (default: false)");
+
+	fi_param_define(&rxm_prov, "conn_max", FI_PARAM_SIZE_T,
+			"Soft limit on the number of connections an endpoint "
+			"keeps open.  At the limit, the least recently used "
+			"idle connection is closed after a handshake with the "
+			"peer, and reopens on its next transfer.  Peers only "
+			"agree to close if they set it as well.  (default: 0, "
+			"no limit)");
+
+	fi_param_define(&rxm_prov, "conn_idle_timeout", FI_PARAM_SIZE_T,
+			"Time in milliseconds a connection must go without "
+			"traffic before it may be closed to stay under "
+			"conn_max.  Should be longer than the longest RMA "
+			"transfer the application issues. (default: 1000)");
+
 	fi_param_define(&rxm_prov, "use_srx", FI_PARAM_BOOL,
 			"Set this environment variable to control the RxM "
 			"receive path. If this variable set to 1 (default: 0), "
@@ -661,6 +728,15 @@ RXM_INI
 			"Defines FI_EP_MSG rx or srx size that would be requested. "
 			"(default: 128, 4096 with srx");
 
+	fi_param_define(&rxm_prov, "msg_rx_min", FI_PARAM_SIZE_T,
+			"Number of receive buffers first posted to each FI_EP_MSG "
+			"endpoint, or to the srx when it is used.  Connections "
+			"and srx that use their buffers quickly post more, up "
+			"to the msg rx size, and drop back as traffic slows.  "
+			"An srx running low is refilled at once.  With flow "
+			"control, this also bounds the credits granted to the "
+			"peer.  (default: 0, always post the msg rx size)");
+
 	fi_param_define(&rxm_prov, "cm_progress_interval", FI_PARAM_INT,
 			"Defines the number of microseconds to wait between "
 			"function calls to the connection management progression "
@@ -706,9 +782,14 @@ RXM_INI
 	 */
 	fi_param_get_bool(&rxm_prov, "enable_passthru", &rxm_passthru);
 
+	use_srx = 0;
+	if (fi_param_get_bool(&rxm_prov, "use_srx", &use_srx) != -FI_ENODATA)
+		rxm_use_srx_env = use_srx;
+
 	rxm_init_infos();
 	fi_param_get_size_t(&rxm_prov, "msg_tx_size", &rxm_msg_tx_size);
 	fi_param_get_size_t(&rxm_prov, "msg_rx_size", &rxm_msg_rx_size);
+	fi_param_get_size_t(&rxm_prov, "msg_rx_min", &rxm_msg_rx_min);
 	if (fi_param_get_int(&rxm_prov, "cm_progress_interval",
 				(int *) &rxm_cm_progress_interval))
 		rxm_cm_progress_interval = 10000;
@@ -717,6 +798,27 @@ RXM_INI
 		rxm_cq_eq_fairness = 128;
 	fi_param_get_bool(&rxm_prov, "data_auto_progress", &force_auto_progress);
 	fi_param_get_bool(&rxm_prov, "use_rndv_write", &rxm_use_write_rndv);
+	fi_param_get_bool(&rxm_prov, "enable_direct_send",
+			  &rxm_enable_direct_send);
+	fi_param_get_int(&rxm_prov, "comp_per_progress", &rxm_comp_per_progress);
+
+	/* 0 selects the default of 8 times the eager limit, so map an
+	 * explicit 0 to a value that never exceeds the eager limit.
+	 */
+	if (!fi_param_get_size_t(&rxm_prov, "sar_limit", &rxm_sar_limit) &&
+	    !rxm_sar_limit)
+		rxm_sar_limit = 1;
+	fi_param_get_size_t(&rxm_prov, "sar_window", &rxm_sar_window);
+	fi_param_get_size_t(&rxm_prov, "rndv_chunk_size", &rxm_rndv_chunk_size);
+	fi_param_get_size_t(&rxm_prov, "rndv_window", &rxm_rndv_window);
+	fi_param_get_size_t(&rxm_prov, "staging_size", &rxm_staging_size);
+	fi_param_get_bool(&rxm_prov, "proto_tune", &rxm_proto_tune);
+	fi_param_get_bool(&rxm_prov, "msg_atomics", &rxm_msg_atomics);
+	fi_param_get_size_t(&rxm_prov, "conn_max", &rxm_conn_max);
+	fi_param_get_size_t(&rxm_prov, "conn_idle_timeout",
+			    &rxm_conn_idle_timeout);
+	if (!rxm_conn_idle_timeout)
+		rxm_conn_idle_timeout = 1;
 
 	rxm_get_def_wait();
 
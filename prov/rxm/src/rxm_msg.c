@@ -77,7 +77,7 @@ ssize_t rxm_handle_unexp_sar(struct rxm_recv_queue *recv_queue,
 		if (recv_entry->sar.conn != rx_buf->conn)
 			continue;
 		rx_buf->recv_entry = recv_entry;
-		dlist_remove(&rx_buf->unexp_msg.entry);
+		rxm_remove_unexp_msg(rx_buf);
 		last = rxm_sar_get_seg_type(&rx_buf->pkt.ctrl_hdr) ==
 		       RXM_SAR_SEG_LAST;
 		ret = rxm_handle_rx_buf(rx_buf);
@@ -121,7 +121,7 @@ rxm_post_mrecv(struct rxm_ep *ep, const struct iovec *iov,
 			return 0;
 		}
 
-		dlist_remove(&rx_buf->unexp_msg.entry);
+		rxm_remove_unexp_msg(rx_buf);
 		rx_buf->recv_entry = recv_entry;
 		recv_entry->flags &= ~FI_MULTI_RECV;
 		recv_entry->total_len = MIN(cur_iov.iov_len, rx_buf->pkt.hdr.size);
@@ -181,7 +181,7 @@ rxm_recv_common(struct rxm_ep *rxm_ep, const struct iovec *iov,
 		goto release;
 	}
 
-	dlist_remove(&rx_buf->unexp_msg.entry);
+	rxm_remove_unexp_msg(rx_buf);
 	rx_buf->recv_entry = recv_entry;
 
 	ret = (rx_buf->pkt.ctrl_hdr.type != rxm_ctrl_seg) ?
@@ -277,6 +277,15 @@ rxm_recvv(struct fid_ep *ep_fid, const struct iovec *iov,
 			       context, rxm_ep->util_ep.rx_op_flags);
 }
 
+static void rxm_tune_start(struct rxm_tx_buf *tx_buf,
+			   struct rxm_conn *rxm_conn, size_t data_len)
+{
+	tx_buf->tune.conn = rxm_conn;
+	tx_buf->tune.start = (rxm_proto_tune &&
+			      rxm_tune_near(&rxm_conn->tune, data_len)) ?
+			     ofi_gettime_ns() : 0;
+}
+
 static ssize_t
 rxm_alloc_rndv_buf(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		   void *context, uint8_t count, const struct iovec *iov,
@@ -301,6 +310,7 @@ rxm_alloc_rndv_buf(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	(*rndv_buf)->app_context = context;
 	(*rndv_buf)->flags = flags;
 	(*rndv_buf)->rma.count = count;
+	rxm_tune_start(*rndv_buf, rxm_conn, data_len);
 
 	if (!rxm_ep->rdm_mr_local) {
 		ret = rxm_msg_mr_regv(rxm_ep, iov, (*rndv_buf)->rma.count, data_len,
@@ -488,6 +498,8 @@ rxm_send_sar(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 
 	iov_offset += rxm_buffer_size;
 
+	first_tx_buf->sar_inflight = 1;
+	rxm_tune_start(first_tx_buf, rxm_conn, data_len);
 	ret = fi_send(rxm_conn->msg_ep, &first_tx_buf->pkt,
 		      sizeof(struct rxm_pkt) + first_tx_buf->pkt.ctrl_hdr.seg_size,
 		      first_tx_buf->hdr.desc, 0, first_tx_buf);
@@ -501,6 +513,12 @@ rxm_send_sar(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	remain_len -= rxm_buffer_size;
 
 	for (i = 1; i < segs_cnt; i++) {
+		if (rxm_sar_window &&
+		    first_tx_buf->sar_inflight >= rxm_sar_window) {
+			tx_buf = NULL;
+			goto defer;
+		}
+
 		ret = rxm_send_segment(rxm_ep, rxm_conn, context, data_len,
 				       remain_len, msg_id, rxm_buffer_size, i,
 				       segs_cnt, data, flags, tag, op, iov,
@@ -511,6 +529,7 @@ rxm_send_sar(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 				goto defer;
 			goto free;
 		}
+		first_tx_buf->sar_inflight++;
 		remain_len -= rxm_buffer_size;
 	}
 
@@ -686,6 +705,47 @@ rxm_send_eager(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	return ret;
 }
 
+/* Device buffers are otherwise staged through host bounce buffers on both
+ * sides.  When the msg provider handles FI_HMEM and the buffer's rxm MR
+ * carries a device registration, rendezvous moves the data directly.  Only
+ * staging copies that go through a gdrcopy style mapping are cheap enough
+ * to keep for eager sized messages.
+ */
+static bool
+rxm_hmem_use_rndv(struct rxm_ep *rxm_ep, void **desc, enum fi_hmem_iface iface,
+		  size_t data_len, uint64_t flags)
+{
+	if (iface == FI_HMEM_ZE || iface == FI_HMEM_SYNAPSEAI)
+		return true;
+
+	if (iface == FI_HMEM_SYSTEM || (flags & FI_INJECT) ||
+	    !rxm_ep->rdm_mr_local || !(rxm_ep->msg_info->caps & FI_HMEM))
+		return false;
+
+	return data_len > rxm_ep->eager_limit ||
+	       !(((struct rxm_mr *) desc[0])->hmem_flags &
+		 OFI_HMEM_DATA_DEV_REG_HANDLE);
+}
+
+/* With FI_OFI_RXM_PROTO_TUNE, the switch point between SAR and rendezvous
+ * is kept per connection.  Near it, every RXM_TUNE_PROBE'th send uses the
+ * other protocol, so that both stay measured.
+ */
+static bool
+rxm_use_sar(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn, size_t data_len)
+{
+	struct rxm_proto_tune *tune = &rxm_conn->tune;
+	bool sar;
+
+	if (!rxm_proto_tune || rxm_ep->sar_limit == rxm_ep->eager_limit)
+		return data_len <= rxm_ep->sar_limit;
+
+	sar = data_len <= tune->sar_limit;
+	if (rxm_tune_near(tune, data_len) && !(++tune->probe % RXM_TUNE_PROBE))
+		return !sar;
+	return sar;
+}
+
 ssize_t
 rxm_send_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		const struct iovec *iov, void **desc, size_t count,
@@ -710,14 +770,14 @@ rxm_send_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	       (data_len <= rxm_ep->rxm_info->tx_attr->inject_size));
 
 	iface = rxm_mr_desc_to_hmem_iface_dev(desc, count, &device);
-	if (iface == FI_HMEM_ZE || iface == FI_HMEM_SYNAPSEAI)
+	if (rxm_hmem_use_rndv(rxm_ep, desc, iface, data_len, flags))
 		goto rndv_send;
 
 	if (data_len <= rxm_ep->eager_limit) {
 		ret = rxm_send_eager(rxm_ep, rxm_conn, iov, desc, count,
 				     context, data, flags, tag, op,
 				     data_len, total_len);
-	} else if (data_len <= rxm_ep->sar_limit) {
+	} else if (rxm_use_sar(rxm_ep, rxm_conn, data_len)) {
 		ret = rxm_send_sar(rxm_ep, rxm_conn, iov, desc, (uint8_t) count,
 				   context, data, flags, tag, op, data_len,
 				   rxm_ep_sar_calc_segs_cnt(rxm_ep, data_len));
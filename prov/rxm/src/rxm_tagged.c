@@ -83,7 +83,7 @@ rxm_peek_recv(struct rxm_ep *rxm_ep, fi_addr_t addr, uint64_t tag,
 	FI_DBG(&rxm_prov, FI_LOG_EP_DATA, "Message found\n");
 
 	if (flags & FI_DISCARD) {
-		dlist_remove(&rx_buf->unexp_msg.entry);
+		rxm_remove_unexp_msg(rx_buf);
 		rxm_discard_recv(rxm_ep, rx_buf, context);
 		return;
 	}
@@ -91,7 +91,7 @@ rxm_peek_recv(struct rxm_ep *rxm_ep, fi_addr_t addr, uint64_t tag,
 	if (flags & FI_CLAIM) {
 		FI_DBG(&rxm_prov, FI_LOG_EP_DATA, "Marking message for Claim\n");
 		((struct fi_context *)context)->internal[0] = rx_buf;
-		dlist_remove(&rx_buf->unexp_msg.entry);
+		rxm_remove_unexp_msg(rx_buf);
 	}
 
 	rxm_cq_write(rxm_ep->util_ep.rx_cq, context, FI_TAGGED | FI_RECV,
@@ -118,12 +118,11 @@ rxm_post_trecv(struct rxm_ep *rxm_ep, const struct iovec *iov,
 	rx_buf = rxm_get_unexp_msg(&rxm_ep->trecv_queue, recv_entry->addr,
 				   recv_entry->tag, recv_entry->ignore);
 	if (!rx_buf) {
-		dlist_insert_tail(&recv_entry->entry,
-				  &rxm_ep->trecv_queue.recv_list);
+		rxm_insert_recv(&rxm_ep->trecv_queue, recv_entry);
 		return FI_SUCCESS;
 	}
 
-	dlist_remove(&rx_buf->unexp_msg.entry);
+	rxm_remove_unexp_msg(rx_buf);
 	rx_buf->recv_entry = recv_entry;
 
 	if (rx_buf->pkt.ctrl_hdr.type != rxm_ctrl_seg)
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _FI_EXT_SHM_H_
+#define _FI_EXT_SHM_H_
+
+#include <rdma/fi_domain.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FI_SHM_EXPORT_OPS "shm export ops"
+
+/*
+ * Exportable send buffers:
+ * alloc returns a buffer owned by the provider together with a memory
+ * region describing it, registered as fi_mr_reg would.  Peers map the buffer into their own address space
+ * the first time they receive from it, so later transfers that pass the
+ * region as the local descriptor are copied once by the peer, without a
+ * system call.  Closing the memory region frees the buffer.
+ */
+struct fi_shm_ops_export {
+	size_t	size;
+	int	(*alloc)(struct fid_domain *domain, size_t len, uint64_t access,
+			 uint64_t requested_key, uint64_t flags, void **buf,
+			 struct fid_mr **mr, void *context);
+};
+
+#define FI_SHM_STATS_OPS "shm stats ops"
+
+/* Protocols used to send a message or RMA payload to a peer */
+enum {
+	FI_SHM_PROTO_INLINE,
+	FI_SHM_PROTO_INJECT,
+	FI_SHM_PROTO_IOV,
+	FI_SHM_PROTO_MMAP,
+	FI_SHM_PROTO_SAR,
+	FI_SHM_PROTO_IPC,
+	FI_SHM_PROTO_EXPORT,
+	FI_SHM_PROTO_MAX,
+};
+
+/* Clear the counters after reading them */
+#define FI_SHM_STATS_RESET	(1ULL << 0)
+
+/*
+ * Endpoint counters:
+ * updated by the endpoint on every transfer and returned by read, opened
+ * with fi_open_ops on the endpoint fid.  Counts taken outside the endpoint
+ * lock may be approximate when several threads send on one endpoint.
+ */
+struct fi_shm_ep_stats {
+	uint64_t	tx_cnt[FI_SHM_PROTO_MAX];
+	uint64_t	tx_bytes[FI_SHM_PROTO_MAX];
+	uint64_t	queue_full;	/* sends refused for a full queue */
+	uint64_t	sar_stall;	/* sends held behind a peer SAR transfer */
+	uint64_t	cma_bytes;	/* bytes copied with CMA or xpmem */
+	uint64_t	resp_cnt;	/* transfers completed by a peer response */
+	uint64_t	resp_ns;	/* total time from post to response */
+	uint64_t	resp_max_ns;
+};
+
+struct fi_shm_ops_stats {
+	size_t	size;
+	int	(*read)(struct fid_ep *ep, struct fi_shm_ep_stats *stats,
+			uint64_t flags);
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FI_EXT_SHM_H_ */
@@ -43,6 +43,7 @@
 #include <rdma/fabric.h>
 #include <rdma/fi_atomic.h>
 #include <rdma/fi_cm.h>
+#include <rdma/fi_collective.h>
 #include <rdma/fi_domain.h>
 #include <rdma/fi_endpoint.h>
 #include <rdma/fi_eq.h>
@@ -67,6 +68,7 @@
 #include <ofi_lock.h>
 
 #include "smr_util.h"
+#include "fi_ext_shm.h"
 
 #ifndef _SMR_H_
 #define _SMR_H_
@@ -75,8 +77,14 @@ struct smr_env {
 	size_t sar_threshold;
 	int disable_cma;
 	int use_dsa_sar;
+	size_t dsa_threshold;
 	size_t max_gdrcopy_size;
 	int use_xpmem;
+	size_t max_peers;
+	size_t peer_queue_size;
+	int probe_vma;
+	int numa_bind;
+	int direct_atomic;
 };
 
 extern struct smr_env smr_env;
@@ -110,8 +118,16 @@ int smr_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
 
 int smr_query_atomic(struct fid_domain *domain, enum fi_datatype datatype,
 		enum fi_op op, struct fi_atomic_attr *attr, uint64_t flags);
+int smr_query_collective(struct fid_domain *domain, enum fi_collective_op coll,
+		struct fi_collective_attr *attr, uint64_t flags);
 
 #define SMR_IOV_LIMIT		4
+#define SMR_CMD_BATCH		16
+#define SMR_COMP_BATCH		16
+/* Async IPC copies of a single buffer at least this large are split into
+ * up to MAX_NUM_ASYNC_OP chunks so the device can run them concurrently.
+ */
+#define SMR_IPC_CHUNK_MIN	(1 << 20)
 
 struct smr_tx_entry {
 	struct smr_cmd	cmd;
@@ -125,6 +141,7 @@ struct smr_tx_entry {
 	struct smr_ep_name *map_name;
 	struct ofi_mr	*mr[SMR_IOV_LIMIT];
 	int			fd;
+	uint64_t	start_ns;
 };
 
 struct smr_pend_entry {
@@ -146,6 +163,7 @@ struct smr_cmd_ctx {
 	struct smr_cmd cmd;
 	struct smr_pend_entry *sar_entry;
 	struct slist buf_list;
+	struct smr_inject_buf *tx_buf;
 };
 
 OFI_DECLARE_FREESTACK(struct smr_tx_entry, smr_tx_fs);
@@ -207,7 +225,7 @@ struct smr_sock_info {
 	pthread_t		listener_thread;
 	int			*my_fds;
 	int			nfds;
-	struct smr_cmap_entry	peers[SMR_MAX_PEERS];
+	struct smr_cmap_entry	*peers;
 };
 
 struct smr_unexp_buf {
@@ -219,6 +237,7 @@ struct smr_ep {
 	struct util_ep		util_ep;
 	size_t			tx_size;
 	size_t			rx_size;
+	size_t			tag_buckets;
 	const char		*name;
 	uint64_t		msg_id;
 	struct smr_region	*volatile region;
@@ -228,6 +247,9 @@ struct smr_ep {
 	struct ofi_bufpool	*pend_buf_pool;
 
 	struct smr_tx_fs	*tx_fs;
+	/* tx completions not yet written to the CQ, oldest first */
+	struct fi_cq_tagged_entry tx_comps[SMR_COMP_BATCH];
+	size_t			tx_comp_cnt;
 	struct dlist_entry	sar_list;
 	struct dlist_entry	ipc_cpy_pend_list;
 
@@ -236,6 +258,23 @@ struct smr_ep {
 	struct smr_sock_info	*sock_info;
 	void			*dsa_context;
 	void 			(*smr_progress_ipc_list)(struct smr_ep *ep);
+
+	/* peers polled through their own command queue */
+	int64_t			*peer_queue_ids;
+	int			peer_queue_cnt;
+	int			peer_queue_next;
+
+	/* inject buffers held by unexpected messages, per peer */
+	uint32_t		*unexp_inject_cnt;
+
+	/* joined collective groups and their pending operations */
+	struct dlist_entry	coll_mc_list;
+	struct dlist_entry	coll_key_list;
+	struct ofi_bufpool	*coll_op_pool;
+	/* peer export buffers mapped into this process */
+	struct dlist_entry	export_map_list;
+
+	struct fi_shm_ep_stats	stats;
 };
 
 static inline struct fid_peer_srx *smr_get_peer_srx(struct smr_ep *ep)
@@ -243,6 +282,33 @@ static inline struct fid_peer_srx *smr_get_peer_srx(struct smr_ep *ep)
 	return container_of(ep->srx, struct fid_peer_srx, ep_fid);
 }
 
+/* Called with the ep lock held, before the peer learns the id */
+static inline void smr_add_peer_queue(struct smr_ep *ep, int64_t id)
+{
+	int i;
+
+	for (i = 0; i < ep->peer_queue_cnt; i++) {
+		if (ep->peer_queue_ids[i] == id)
+			return;
+	}
+	ep->peer_queue_ids[ep->peer_queue_cnt++] = id;
+}
+
+static inline void smr_stat_tx(struct smr_ep *ep, int proto, size_t len)
+{
+	ep->stats.tx_cnt[proto]++;
+	ep->stats.tx_bytes[proto] += len;
+}
+
+static inline void smr_stat_resp(struct smr_ep *ep, struct smr_tx_entry *pend)
+{
+	uint64_t ns = ofi_gettime_ns() - pend->start_ns;
+
+	ep->stats.resp_cnt++;
+	ep->stats.resp_ns += ns;
+	ep->stats.resp_max_ns = MAX(ep->stats.resp_max_ns, ns);
+}
+
 #define smr_ep_rx_flags(smr_ep) ((smr_ep)->util_ep.rx_op_flags)
 #define smr_ep_tx_flags(smr_ep) ((smr_ep)->util_ep.tx_op_flags)
 
@@ -253,6 +319,60 @@ static inline int smr_mmap_name(char *shm_name, const char *ep_name,
 			ep_name, msg_id);
 }
 
+/* Trailer page after an export buffer, read by initiators of direct
+ * atomics.  magic is cleared when the buffer is closed.
+ */
+#define SMR_EXPORT_MAGIC	0x736d7265ULL
+
+struct smr_export_info {
+	uint64_t		magic;
+	uint64_t		key;
+	uint64_t		addr_base;
+	uint64_t		len;
+	uint64_t		access;
+};
+
+/* Buffer returned by the export ops alloc call, described by mr */
+struct smr_export {
+	struct ofi_mr		mr;
+	uint64_t		id;
+	void			*base;
+	size_t			size;
+	struct smr_export_info	*info;
+	bool			rkey;
+};
+
+extern struct fi_ops smr_export_fi_ops;
+extern struct fi_shm_ops_export smr_export_ops;
+extern ofi_atomic64_t smr_export_id;
+
+static inline struct smr_export *smr_export_desc(void *desc)
+{
+	struct ofi_mr *mr = desc;
+
+	if (!mr || mr->mr_fid.fid.ops != &smr_export_fi_ops)
+		return NULL;
+	return container_of(mr, struct smr_export, mr);
+}
+
+static inline int smr_export_name(char *shm_name, pid_t pid, uint64_t id)
+{
+	return snprintf(shm_name, SMR_NAME_MAX - 1, "/fi_shm_export_%d_%" PRIu64,
+			(int) pid, id);
+}
+
+static inline int smr_export_rkey_name(char *shm_name, pid_t pid,
+				       uint64_t key)
+{
+	return snprintf(shm_name, SMR_NAME_MAX - 1, "/fi_shm_rkey_%d_%" PRIu64,
+			(int) pid, key);
+}
+
+void *smr_export_map(struct smr_ep *ep, pid_t pid, uint64_t id, size_t size);
+void *smr_export_rkey(struct smr_ep *ep, pid_t pid, uint64_t key,
+		      uint64_t addr, size_t len, uint64_t access);
+void smr_export_cleanup(struct smr_ep *ep);
+
 int smr_srx_context(struct fid_domain *domain, struct fi_rx_attr *attr,
 		struct fid_ep **rx_ep, void *context);
 
@@ -309,6 +429,12 @@ static inline uint64_t smr_rx_cq_flags(uint32_t op, uint64_t rx_flags,
 
 void smr_ep_progress(struct util_ep *util_ep);
 
+extern struct fi_ops_collective smr_coll_ops;
+int smr_join_collective(struct fid_ep *ep, const void *addr, uint64_t flags,
+			struct fid_mc **mc, void *context);
+void smr_coll_progress(struct smr_ep *ep);
+void smr_coll_cleanup(struct smr_ep *ep);
+
 static inline bool smr_vma_enabled(struct smr_ep *ep,
 				   struct smr_region *peer_smr)
 {
@@ -320,6 +446,24 @@ static inline bool smr_vma_enabled(struct smr_ep *ep,
 			peer_smr->xpmem_cap_self == SMR_VMA_CAP_ON);
 }
 
+/* SAR copies of host memory go to DSA once they are large enough for the
+ * offload to pay for building and polling the descriptors */
+static inline bool smr_dsa_preferred(size_t len, struct ofi_mr **mr,
+				     size_t count)
+{
+	return smr_env.use_dsa_sar && len >= smr_env.dsa_threshold &&
+	       ofi_mr_all_host(mr, count);
+}
+
+/* Whether a len byte transfer to peer id should use CMA/xpmem over SAR */
+static inline bool smr_vma_preferred(struct smr_ep *ep,
+				     struct smr_region *peer_smr, int64_t id,
+				     size_t len)
+{
+	return smr_vma_enabled(ep, peer_smr) &&
+	       len > smr_peer_data(ep->region)[id].vma_threshold;
+}
+
 static inline bool smr_ze_ipc_enabled(struct smr_region *smr,
 				      struct smr_region *peer_smr)
 {
@@ -350,6 +494,23 @@ smr_release_txbuf(struct smr_region *smr,
 	pthread_spin_unlock(&smr->lock);
 }
 
+/* Unexpected injects keep the sender's buffer until the receive is
+ * posted, up to a share of half of the inject pool per peer.  The other
+ * half stays free so that busy peers cannot starve the rest.
+ */
+static inline bool smr_hold_txbuf(struct smr_ep *ep, int64_t id)
+{
+	return ep->unexp_inject_cnt[id] <
+	       MAX(1, ep->rx_size / 2 / MAX(1, ep->region->map->num_peers));
+}
+
+static inline void smr_release_held_txbuf(struct smr_cmd_ctx *cmd_ctx)
+{
+	smr_release_txbuf(cmd_ctx->ep->region, cmd_ctx->tx_buf);
+	cmd_ctx->ep->unexp_inject_cnt[cmd_ctx->cmd.msg.hdr.id]--;
+	cmd_ctx->tx_buf = NULL;
+}
+
 int smr_unexp_start(struct fi_peer_rx_entry *rx_entry);
 
 void smr_progress_ipc_list(struct smr_ep *ep);
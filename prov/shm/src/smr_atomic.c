@@ -57,7 +57,7 @@ static void smr_format_inline_atomic(struct smr_cmd *cmd, struct ofi_mr **mr,
 {
 	cmd->msg.hdr.op_src = smr_src_inline;
 
-	cmd->msg.hdr.size = ofi_copy_from_mr_iov(cmd->msg.data.msg,
+	cmd->msg.hdr.size = ofi_copy_from_mr_iov(smr_inline_data(cmd),
 						 SMR_MSG_DATA_LEN, mr,
 						 iov, count, 0);
 }
@@ -167,6 +167,78 @@ static int smr_select_atomic_proto(uint32_t op, uint64_t total_len,
 	return smr_src_inline;
 }
 
+static bool smr_direct_ioc(const struct fi_ioc *ioc, void **desc,
+			   size_t count, size_t cnt)
+{
+	return count == 1 && ioc->count == cnt &&
+	       ofi_mr_all_host((struct ofi_mr **) desc, desc ? 1 : 0);
+}
+
+/* Run the atomic with CPU atomics on the target's export buffer instead
+ * of sending it, when FI_SHM_DIRECT_ATOMIC is set.  Both sides must use
+ * hardware atomics, so that direct atomics and atomics run by the target
+ * do not tear each other.  The target must not be counting remote
+ * events, which it does not see.  Returns -FI_ENOSYS if the command path
+ * has to be used.
+ */
+static ssize_t smr_direct_atomic(struct smr_ep *ep, struct smr_region *peer_smr,
+			const struct fi_ioc *ioc, void **desc, size_t count,
+			const struct fi_ioc *compare_ioc, void **compare_desc,
+			size_t compare_count, struct fi_ioc *result_ioc,
+			void **result_desc, size_t result_count,
+			const struct fi_rma_ioc *rma_ioc, size_t rma_count,
+			enum fi_datatype datatype, enum fi_op atomic_op,
+			uint32_t op, uint64_t op_flags)
+{
+	size_t cnt;
+	void *dst;
+
+	if (!smr_env.direct_atomic || rma_count != 1 ||
+	    op_flags & (FI_FENCE | FI_REMOTE_CQ_DATA) ||
+	    !(ep->region->flags & peer_smr->flags & SMR_FLAG_ATOMIC) ||
+	    peer_smr->flags & SMR_FLAG_RMA_EVENT)
+		return -FI_ENOSYS;
+
+	cnt = rma_ioc->count;
+	if (op == ofi_op_atomic && atomic_op == FI_ATOMIC_READ)
+		return -FI_ENOSYS;
+	if (atomic_op != FI_ATOMIC_READ &&
+	    !smr_direct_ioc(ioc, desc, count, cnt))
+		return -FI_ENOSYS;
+	if (op != ofi_op_atomic &&
+	    !smr_direct_ioc(result_ioc, result_desc, result_count, cnt))
+		return -FI_ENOSYS;
+	if (op == ofi_op_atomic_compare &&
+	    !smr_direct_ioc(compare_ioc, compare_desc, compare_count, cnt))
+		return -FI_ENOSYS;
+
+	dst = smr_export_rkey(ep, peer_smr->pid, rma_ioc->key, rma_ioc->addr,
+			      cnt * ofi_datatype_size(datatype),
+			      ofi_rx_mr_reg_flags(op, atomic_op));
+	if (!dst)
+		return -FI_ENOSYS;
+
+	switch (op) {
+	case ofi_op_atomic:
+		ofi_atomic_write_handler(atomic_op, datatype, dst,
+					 ioc->addr, cnt);
+		break;
+	case ofi_op_atomic_fetch:
+		ofi_atomic_readwrite_handler(atomic_op, datatype, dst,
+				atomic_op == FI_ATOMIC_READ ? NULL : ioc->addr,
+				result_ioc->addr, cnt);
+		break;
+	case ofi_op_atomic_compare:
+		ofi_atomic_swap_handler(atomic_op, datatype, dst, ioc->addr,
+					compare_ioc->addr, result_ioc->addr,
+					cnt);
+		break;
+	default:
+		return -FI_ENOSYS;
+	}
+	return FI_SUCCESS;
+}
+
 static ssize_t smr_generic_atomic(struct smr_ep *ep,
 			const struct fi_ioc *ioc, void **desc, size_t count,
 			const struct fi_ioc *compare_ioc, void **compare_desc,
@@ -201,12 +273,36 @@ static ssize_t smr_generic_atomic(struct smr_ep *ep,
 	peer_id = smr_peer_data(ep->region)[id].addr.id;
 	peer_smr = smr_peer_region(ep->region, id);
 
-	if (smr_peer_data(ep->region)[id].sar_status)
+	if (smr_peer_data(ep->region)[id].sar_status) {
+		ep->stats.sar_stall++;
 		return -FI_EAGAIN;
+	}
+
+	if (smr_env.direct_atomic) {
+		ofi_genlock_lock(&ep->util_ep.lock);
+		ret = smr_direct_atomic(ep, peer_smr, ioc, desc, count,
+					compare_ioc, compare_desc,
+					compare_count, result_ioc,
+					result_desc, result_count, rma_ioc,
+					rma_count, datatype, atomic_op, op,
+					op_flags);
+		if (!ret) {
+			ret = smr_complete_tx(ep, context, op, op_flags);
+			if (ret) {
+				FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+					"unable to process tx completion\n");
+			}
+		}
+		ofi_genlock_unlock(&ep->util_ep.lock);
+		if (ret != -FI_ENOSYS)
+			return ret;
+	}
 
-	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
-	if (ret == -FI_ENOENT)
+	ret = smr_cmd_queue_next(smr_peer_tx_queue(peer_smr, peer_id), &ce, &pos);
+	if (ret == -FI_ENOENT) {
+		ep->stats.queue_full++;
 		return -FI_EAGAIN;
+	}
 
 	ofi_genlock_lock(&ep->util_ep.lock);
 	total_len = ofi_datatype_size(datatype) * ofi_total_ioc_cnt(ioc, count);
@@ -268,6 +364,7 @@ static ssize_t smr_generic_atomic(struct smr_ep *ep,
 
 	smr_format_rma_ioc(&ce->rma_cmd, rma_ioc, rma_count);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 unlock:
 	ofi_genlock_unlock(&ep->util_ep.lock);
 	return ret;
@@ -337,6 +434,7 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 	struct smr_ep *ep;
 	struct smr_region *peer_smr;
 	struct iovec iov;
+	struct fi_ioc ioc;
 	struct fi_rma_ioc rma_ioc;
 	int64_t id, peer_id;
 	ssize_t ret = 0;
@@ -353,13 +451,34 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 	peer_smr = smr_peer_region(ep->region, id);
 
 	if (smr_peer_data(ep->region)[id].sar_status) {
+		ep->stats.sar_stall++;
 		ret = -FI_EAGAIN;
 		goto out;
 	}
 
-	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
-	if (ret == -FI_ENOENT)
+	rma_ioc.addr = addr;
+	rma_ioc.count = count;
+	rma_ioc.key = key;
+
+	if (smr_env.direct_atomic) {
+		ioc.addr = (void *) buf;
+		ioc.count = count;
+		ofi_genlock_lock(&ep->util_ep.lock);
+		ret = smr_direct_atomic(ep, peer_smr, &ioc, NULL, 1, NULL,
+					NULL, 0, NULL, NULL, 0, &rma_ioc, 1,
+					datatype, op, ofi_op_atomic, 0);
+		ofi_genlock_unlock(&ep->util_ep.lock);
+		if (!ret) {
+			ofi_ep_peer_tx_cntr_inc(&ep->util_ep, ofi_op_atomic);
+			return 0;
+		}
+	}
+
+	ret = smr_cmd_queue_next(smr_peer_tx_queue(peer_smr, peer_id), &ce, &pos);
+	if (ret == -FI_ENOENT) {
+		ep->stats.queue_full++;
 		return -FI_EAGAIN;
+	}
 
 	total_len = count * ofi_datatype_size(datatype);
 	assert(total_len <= SMR_INJECT_SIZE);
@@ -367,10 +486,6 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 	iov.iov_base = (void *) buf;
 	iov.iov_len = total_len;
 
-	rma_ioc.addr = addr;
-	rma_ioc.count = count;
-	rma_ioc.key = key;
-
 	if (total_len <= SMR_MSG_DATA_LEN) {
 		smr_do_atomic_inline(ep, peer_smr, id, peer_id, ofi_op_atomic,
 				     0, datatype, op, NULL, &iov, 1, total_len,
@@ -388,6 +503,7 @@ static ssize_t smr_atomic_inject(struct fid_ep *ep_fid, const void *buf,
 
 	smr_format_rma_ioc(&ce->rma_cmd, &rma_ioc, 1);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, ofi_op_atomic);
 out:
 	return ret;
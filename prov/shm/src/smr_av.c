@@ -84,7 +84,7 @@ static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 		FI_INFO(&smr_prov, FI_LOG_AV, "%s\n", (const char *) addr);
 
 		util_addr = FI_ADDR_NOTAVAIL;
-		if (smr_av->used < SMR_MAX_PEERS) {
+		if (smr_av->used < smr_av->smr_map->max_peers) {
 			ret = smr_map_add(&smr_prov, smr_av->smr_map,
 					  addr, &shm_id);
 			if (!ret) {
@@ -112,7 +112,7 @@ static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 			continue;
 		}
 
-		assert(shm_id >= 0 && shm_id < SMR_MAX_PEERS);
+		assert(shm_id >= 0 && shm_id < smr_av->smr_map->max_peers);
 		if (flags & FI_AV_USER_ID) {
 			assert(fi_addr);
 			smr_av->smr_map->peers[shm_id].fiaddr = fi_addr[i];
@@ -132,7 +132,7 @@ static int smr_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 			smr_ep = container_of(util_ep, struct smr_ep, util_ep);
 			smr_map_to_endpoint(smr_ep->region, shm_id);
 			smr_ep->region->max_sar_buf_per_peer =
-				SMR_MAX_PEERS / smr_av->smr_map->num_peers;
+				smr_sar_bufs_per_peer(smr_av->smr_map->num_peers);
 			srx = smr_get_peer_srx(smr_ep);
 			srx->owner_ops->foreach_unspec_addr(srx, &smr_get_addr);
 		}
@@ -176,13 +176,8 @@ static int smr_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr, size_t count
 			util_ep = container_of(av_entry, struct util_ep, av_entry);
 			smr_ep = container_of(util_ep, struct smr_ep, util_ep);
 			smr_unmap_from_endpoint(smr_ep->region, id);
-			if (smr_av->smr_map->num_peers > 0)
-				smr_ep->region->max_sar_buf_per_peer =
-					SMR_MAX_PEERS /
-					smr_av->smr_map->num_peers;
-			else
-				smr_ep->region->max_sar_buf_per_peer =
-					SMR_BUF_BATCH_MAX;
+			smr_ep->region->max_sar_buf_per_peer =
+				smr_sar_bufs_per_peer(smr_av->smr_map->num_peers);
 		}
 		smr_av->used--;
 	}
@@ -223,6 +218,96 @@ static const char *smr_av_straddr(struct fid_av *av, const void *addr,
 	return buf;
 }
 
+static int smr_av_set_close(struct fid *fid)
+{
+	struct util_av_set *av_set;
+
+	av_set = container_of(fid, struct util_av_set, av_set_fid.fid);
+	if (ofi_atomic_get32(&av_set->ref) > 0)
+		return -FI_EBUSY;
+
+	ofi_atomic_dec32(&av_set->av->ref);
+	ofi_mutex_destroy(&av_set->lock);
+	free(av_set->fi_addr_array);
+	free(av_set);
+	return FI_SUCCESS;
+}
+
+static struct fi_ops smr_av_set_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = smr_av_set_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+static struct fi_ops_av_set smr_av_set_ops = {
+	.set_union	= ofi_av_set_union,
+	.intersect	= ofi_av_set_intersect,
+	.diff		= ofi_av_set_diff,
+	.insert		= ofi_av_set_insert,
+	.remove		= ofi_av_set_remove,
+	.addr		= ofi_av_set_addr,
+};
+
+static int smr_av_set(struct fid_av *av_fid, struct fi_av_set_attr *attr,
+		      struct fid_av_set **av_set_fid, void *context)
+{
+	struct util_av *util_av;
+	struct util_av_set *av_set;
+	struct smr_av *smr_av;
+	uint64_t i;
+	int ret;
+
+	util_av = container_of(av_fid, struct util_av, av_fid);
+	smr_av = container_of(util_av, struct smr_av, util_av);
+
+	av_set = calloc(1, sizeof(*av_set));
+	if (!av_set)
+		return -FI_ENOMEM;
+
+	ret = ofi_mutex_init(&av_set->lock);
+	if (ret)
+		goto err1;
+
+	av_set->max_array_size = attr->count ? attr->count :
+				 smr_av->smr_map->max_peers;
+	av_set->fi_addr_array = calloc(av_set->max_array_size,
+				       sizeof(*av_set->fi_addr_array));
+	if (!av_set->fi_addr_array) {
+		ret = -FI_ENOMEM;
+		goto err2;
+	}
+
+	for (i = attr->start_addr; i <= attr->end_addr; i += attr->stride) {
+		if (av_set->fi_addr_count >= av_set->max_array_size) {
+			ret = -FI_EINVAL;
+			goto err3;
+		}
+		av_set->fi_addr_array[av_set->fi_addr_count++] = i;
+	}
+
+	ofi_atomic_initialize32(&av_set->ref, 0);
+	av_set->coll_mc.av_set = av_set;
+	av_set->av_set_fid.ops = &smr_av_set_ops;
+	av_set->av_set_fid.fid.fclass = FI_CLASS_AV_SET;
+	av_set->av_set_fid.fid.context = context;
+	av_set->av_set_fid.fid.ops = &smr_av_set_fi_ops;
+	av_set->av = util_av;
+	ofi_atomic_inc32(&util_av->ref);
+
+	*av_set_fid = &av_set->av_set_fid;
+	return FI_SUCCESS;
+
+err3:
+	free(av_set->fi_addr_array);
+err2:
+	ofi_mutex_destroy(&av_set->lock);
+err1:
+	free(av_set);
+	return ret;
+}
+
 static struct fi_ops smr_av_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = smr_av_close,
@@ -239,6 +324,7 @@ static struct fi_ops_av smr_av_ops = {
 	.remove = smr_av_remove,
 	.lookup = smr_av_lookup,
 	.straddr = smr_av_straddr,
+	.av_set = smr_av_set,
 };
 
 int smr_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
@@ -287,7 +373,8 @@ int smr_av_open(struct fid_domain *domain, struct fi_av_attr *attr,
 	(*av)->fid.ops = &smr_av_fi_ops;
 	(*av)->ops = &smr_av_ops;
 
-	ret = smr_map_create(&smr_prov, SMR_MAX_PEERS,
+	ret = smr_map_create(&smr_prov,
+			     MAX(attr->count, smr_env.max_peers),
 			     util_domain->info_domain_caps & FI_HMEM ?
 			     SMR_FLAG_HMEM_ENABLED : 0, &smr_av->smr_map);
 	if (ret)
@@ -0,0 +1,643 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ofi_atomic.h"
+#include "smr.h"
+
+/*
+ * Each joined group maps one segment shared by all of its members:
+ *
+ *   header | flags[size] | bufs[size]
+ *
+ * Operations run one chunk at a time.  A member copies its part of the
+ * chunk into its own buffer and raises its seq flag to the chunk's
+ * sequence number.  Once every seq flag has reached that number, each
+ * member reads (and reduces) what it needs straight out of the other
+ * buffers and raises its ack flag.  A buffer is only overwritten after
+ * every ack flag has caught up with the previous chunk.
+ */
+#define SMR_COLL_BUF_SIZE	(16 * 1024)
+
+struct smr_coll_flag {
+	ofi_atomic64_t		seq;
+	ofi_atomic64_t		ack;
+} __attribute__((__aligned__(64)));
+
+struct smr_coll_seg {
+	ofi_atomic64_t		joined;
+	ofi_atomic64_t		ready;
+	struct smr_coll_flag	flag[];
+};
+
+/* Number of times this ep has joined a group with the given members, so
+ * all members of a group derive the same segment name */
+struct smr_coll_key {
+	struct dlist_entry	entry;
+	uint64_t		hash;
+	uint64_t		cnt;
+};
+
+struct smr_coll_mc {
+	struct util_coll_mc	util_mc;
+	struct smr_ep		*ep;
+	struct dlist_entry	entry;
+	struct dlist_entry	op_list;
+	struct smr_coll_seg	*seg;
+	size_t			seg_size;
+	char			name[SMR_NAME_MAX];
+	int			size;
+	int			rank;
+	/* first member not yet seen at the flag being waited on */
+	int			wait_idx;
+	uint64_t		seq;
+	bool			ready;
+};
+
+struct smr_coll_op {
+	struct dlist_entry	entry;
+	enum fi_collective_op	type;
+	enum fi_datatype	datatype;
+	enum fi_op		op;
+	const char		*buf;
+	char			*result;
+	size_t			count;
+	size_t			done;
+	int			root;
+	bool			posted;
+	void			*context;
+};
+
+static inline char *smr_coll_buf(struct smr_coll_mc *mc, int rank)
+{
+	return (char *) &mc->seg->flag[mc->size] +
+	       (size_t) rank * SMR_COLL_BUF_SIZE;
+}
+
+static bool smr_coll_reached(struct smr_coll_mc *mc, bool ack, uint64_t seq)
+{
+	struct smr_coll_flag *flag;
+
+	for (; mc->wait_idx < mc->size; mc->wait_idx++) {
+		flag = &mc->seg->flag[mc->wait_idx];
+		if ((uint64_t) ofi_atomic_load_explicit64(ack ? &flag->ack :
+							  &flag->seq,
+							  memory_order_acquire) < seq)
+			return false;
+	}
+	mc->wait_idx = 0;
+	return true;
+}
+
+static bool smr_coll_writes(struct smr_coll_mc *mc, struct smr_coll_op *op)
+{
+	return op->type == FI_ALLREDUCE || op->type == FI_REDUCE_SCATTER ||
+	       (op->type == FI_BROADCAST && op->root == mc->rank);
+}
+
+static void smr_coll_reduce(struct smr_coll_mc *mc, struct smr_coll_op *op,
+			    char *dst, size_t off, size_t cnt, size_t dt_size)
+{
+	int i;
+
+	/* always reduce in rank order so every member gets the same result */
+	memcpy(dst, smr_coll_buf(mc, 0) + off, cnt * dt_size);
+	for (i = 1; i < mc->size; i++)
+		ofi_atomic_write_handler(op->op, op->datatype, dst,
+					 smr_coll_buf(mc, i) + off, cnt);
+}
+
+static void smr_coll_read(struct smr_coll_mc *mc, struct smr_coll_op *op,
+			  size_t cnt, size_t dt_size)
+{
+	size_t slice, lo, hi;
+
+	switch (op->type) {
+	case FI_BROADCAST:
+		if (op->root != mc->rank)
+			memcpy(op->result + op->done * dt_size,
+			       smr_coll_buf(mc, op->root), cnt * dt_size);
+		break;
+	case FI_ALLREDUCE:
+		smr_coll_reduce(mc, op, op->result + op->done * dt_size, 0,
+				cnt, dt_size);
+		break;
+	case FI_REDUCE_SCATTER:
+		/* only the part of the chunk that falls in our slice */
+		slice = op->count / mc->size;
+		lo = MAX(op->done, mc->rank * slice);
+		hi = MIN(op->done + cnt, (mc->rank + 1) * slice);
+		if (lo < hi)
+			smr_coll_reduce(mc, op,
+					op->result + (lo - mc->rank * slice) *
+					dt_size, (lo - op->done) * dt_size,
+					hi - lo, dt_size);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Returns true once every chunk of the operation has been exchanged */
+static bool smr_coll_progress_op(struct smr_coll_mc *mc,
+				 struct smr_coll_op *op)
+{
+	struct smr_coll_flag *flag = &mc->seg->flag[mc->rank];
+	size_t dt_size, cnt;
+
+	dt_size = ofi_datatype_size(op->datatype);
+	do {
+		cnt = MIN(op->count - op->done, SMR_COLL_BUF_SIZE / dt_size);
+		if (!op->posted) {
+			if (smr_coll_writes(mc, op)) {
+				if (!smr_coll_reached(mc, true, mc->seq))
+					return false;
+				memcpy(smr_coll_buf(mc, mc->rank),
+				       op->buf + op->done * dt_size,
+				       cnt * dt_size);
+			}
+			ofi_atomic_store_explicit64(&flag->seq, ++mc->seq,
+						    memory_order_release);
+			op->posted = true;
+		}
+
+		if (!smr_coll_reached(mc, false, mc->seq))
+			return false;
+
+		smr_coll_read(mc, op, cnt, dt_size);
+		ofi_atomic_store_explicit64(&flag->ack, mc->seq,
+					    memory_order_release);
+		op->posted = false;
+		op->done += cnt;
+	} while (op->done < op->count);
+
+	return true;
+}
+
+static void smr_coll_progress_join(struct smr_coll_mc *mc)
+{
+	struct fi_eq_entry entry;
+
+	if (!ofi_atomic_load_explicit64(&mc->seg->ready, memory_order_acquire))
+		return;
+
+	mc->ready = true;
+	memset(&entry, 0, sizeof(entry));
+	entry.fid = &mc->util_mc.mc_fid.fid;
+	entry.context = mc->util_mc.mc_fid.fid.context;
+
+	if (fi_eq_write(&mc->ep->util_ep.eq->eq_fid, FI_JOIN_COMPLETE, &entry,
+			sizeof(entry), FI_COLLECTIVE) < 0)
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"join collective - eq write failed\n");
+}
+
+/* Called with the ep lock held */
+static void smr_coll_progress_mc(struct smr_coll_mc *mc)
+{
+	struct smr_coll_op *op;
+
+	if (!mc->ready) {
+		smr_coll_progress_join(mc);
+		if (!mc->ready)
+			return;
+	}
+
+	while (!dlist_empty(&mc->op_list)) {
+		op = container_of(mc->op_list.next, struct smr_coll_op, entry);
+		if (!smr_coll_progress_op(mc, op))
+			return;
+
+		dlist_remove(&op->entry);
+		if (ofi_peer_cq_write(mc->ep->util_ep.tx_cq, op->context,
+				      FI_COLLECTIVE, 0, NULL, 0, 0,
+				      FI_ADDR_NOTAVAIL))
+			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+				"collective - cq write failed\n");
+		ofi_buf_free(op);
+	}
+}
+
+void smr_coll_progress(struct smr_ep *ep)
+{
+	struct smr_coll_mc *mc;
+
+	if (dlist_empty(&ep->coll_mc_list))
+		return;
+
+	ofi_genlock_lock(&ep->util_ep.lock);
+	dlist_foreach_container(&ep->coll_mc_list, struct smr_coll_mc,
+				mc, entry)
+		smr_coll_progress_mc(mc);
+	ofi_genlock_unlock(&ep->util_ep.lock);
+}
+
+static ssize_t smr_coll_submit(struct fid_ep *ep_fid, fi_addr_t coll_addr,
+			       enum fi_collective_op type, const void *buf,
+			       void *result, size_t count,
+			       enum fi_datatype datatype, enum fi_op op,
+			       fi_addr_t root_addr, void *context)
+{
+	struct smr_ep *ep;
+	struct smr_coll_mc *mc;
+	struct smr_coll_op *coll_op;
+	struct util_av_set *av_set;
+	int root = 0;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid);
+	mc = (struct smr_coll_mc *) (uintptr_t) coll_addr;
+	av_set = mc->util_mc.av_set;
+
+	if (!ofi_datatype_size(datatype))
+		return -FI_EINVAL;
+
+	if (type == FI_ALLREDUCE || type == FI_REDUCE_SCATTER) {
+		if (op < FI_MIN || op > FI_BXOR ||
+		    ofi_atomic_valid(&smr_prov, datatype, op, 0))
+			return -FI_EINVAL;
+		if (type == FI_REDUCE_SCATTER && count % mc->size)
+			return -FI_EINVAL;
+	}
+
+	if (type == FI_BROADCAST) {
+		for (root = 0; root < mc->size; root++) {
+			if (av_set->fi_addr_array[root] == root_addr)
+				break;
+		}
+		if (root == mc->size)
+			return -FI_EINVAL;
+	}
+
+	ofi_genlock_lock(&ep->util_ep.lock);
+	coll_op = ofi_buf_alloc(ep->coll_op_pool);
+	if (!coll_op) {
+		ofi_genlock_unlock(&ep->util_ep.lock);
+		return -FI_EAGAIN;
+	}
+
+	coll_op->type = type;
+	coll_op->datatype = datatype;
+	coll_op->op = op;
+	coll_op->buf = buf;
+	coll_op->result = result;
+	coll_op->count = count;
+	coll_op->done = 0;
+	coll_op->root = root;
+	coll_op->posted = false;
+	coll_op->context = context;
+	dlist_insert_tail(&coll_op->entry, &mc->op_list);
+
+	/* the other members may already be waiting on this one */
+	smr_coll_progress_mc(mc);
+	ofi_genlock_unlock(&ep->util_ep.lock);
+
+	return FI_SUCCESS;
+}
+
+static ssize_t smr_coll_barrier2(struct fid_ep *ep, fi_addr_t coll_addr,
+				 uint64_t flags, void *context)
+{
+	return smr_coll_submit(ep, coll_addr, FI_BARRIER, NULL, NULL, 0,
+			       FI_UINT8, FI_NOOP, FI_ADDR_NOTAVAIL, context);
+}
+
+static ssize_t smr_coll_barrier(struct fid_ep *ep, fi_addr_t coll_addr,
+				void *context)
+{
+	return smr_coll_barrier2(ep, coll_addr, 0, context);
+}
+
+static ssize_t smr_coll_broadcast(struct fid_ep *ep, void *buf, size_t count,
+				  void *desc, fi_addr_t coll_addr,
+				  fi_addr_t root_addr,
+				  enum fi_datatype datatype, uint64_t flags,
+				  void *context)
+{
+	return smr_coll_submit(ep, coll_addr, FI_BROADCAST, buf, buf, count,
+			       datatype, FI_NOOP, root_addr, context);
+}
+
+static ssize_t smr_coll_allreduce(struct fid_ep *ep, const void *buf,
+				  size_t count, void *desc, void *result,
+				  void *result_desc, fi_addr_t coll_addr,
+				  enum fi_datatype datatype, enum fi_op op,
+				  uint64_t flags, void *context)
+{
+	return smr_coll_submit(ep, coll_addr, FI_ALLREDUCE, buf, result, count,
+			       datatype, op, FI_ADDR_NOTAVAIL, context);
+}
+
+static ssize_t smr_coll_reduce_scatter(struct fid_ep *ep, const void *buf,
+				       size_t count, void *desc, void *result,
+				       void *result_desc, fi_addr_t coll_addr,
+				       enum fi_datatype datatype, enum fi_op op,
+				       uint64_t flags, void *context)
+{
+	return smr_coll_submit(ep, coll_addr, FI_REDUCE_SCATTER, buf, result,
+			       count, datatype, op, FI_ADDR_NOTAVAIL, context);
+}
+
+struct fi_ops_collective smr_coll_ops = {
+	.size = sizeof(struct fi_ops_collective),
+	.barrier = smr_coll_barrier,
+	.barrier2 = smr_coll_barrier2,
+	.broadcast = smr_coll_broadcast,
+	.alltoall = fi_coll_no_alltoall,
+	.allreduce = smr_coll_allreduce,
+	.allgather = fi_coll_no_allgather,
+	.reduce_scatter = smr_coll_reduce_scatter,
+	.reduce = fi_coll_no_reduce,
+	.scatter = fi_coll_no_scatter,
+	.gather = fi_coll_no_gather,
+	.msg = fi_coll_no_msg,
+};
+
+static void smr_coll_unmap(struct smr_coll_mc *mc)
+{
+	/* the last member to join unlinks the name */
+	if (!ofi_atomic_load_explicit64(&mc->seg->ready, memory_order_acquire))
+		shm_unlink(mc->name);
+	munmap(mc->seg, mc->seg_size);
+}
+
+static int smr_coll_mc_close(struct fid *fid)
+{
+	struct smr_coll_mc *mc;
+
+	mc = container_of(fid, struct smr_coll_mc, util_mc.mc_fid.fid);
+
+	ofi_genlock_lock(&mc->ep->util_ep.lock);
+	if (!dlist_empty(&mc->op_list)) {
+		ofi_genlock_unlock(&mc->ep->util_ep.lock);
+		return -FI_EBUSY;
+	}
+	dlist_remove(&mc->entry);
+	ofi_genlock_unlock(&mc->ep->util_ep.lock);
+
+	smr_coll_unmap(mc);
+	ofi_atomic_dec32(&mc->util_mc.av_set->ref);
+	free(mc);
+	return FI_SUCCESS;
+}
+
+static struct fi_ops smr_coll_mc_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = smr_coll_mc_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+static uint64_t smr_coll_hash(uint64_t hash, const char *name)
+{
+	/* FNV-1a, including the terminator to separate names */
+	do {
+		hash ^= (uint8_t) *name;
+		hash *= 0x100000001b3ULL;
+	} while (*name++);
+
+	return hash;
+}
+
+static struct smr_coll_key *smr_coll_get_key(struct smr_ep *ep,
+					     uint64_t hash)
+{
+	struct smr_coll_key *key;
+
+	dlist_foreach_container(&ep->coll_key_list, struct smr_coll_key,
+				key, entry) {
+		if (key->hash == hash)
+			return key;
+	}
+
+	key = calloc(1, sizeof(*key));
+	if (!key)
+		return NULL;
+
+	key->hash = hash;
+	dlist_insert_tail(&key->entry, &ep->coll_key_list);
+	return key;
+}
+
+/* Called with the ep lock held */
+static int smr_coll_map(struct smr_coll_mc *mc)
+{
+	struct util_av_set *av_set = mc->util_mc.av_set;
+	struct smr_av *av;
+	struct smr_coll_key *key;
+	const char *name;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	int64_t id, joined;
+	int i, fd, ret;
+
+	av = container_of(av_set->av, struct smr_av, util_av);
+
+	mc->rank = -1;
+	for (i = 0; i < mc->size; i++) {
+		id = smr_addr_lookup(av_set->av, av_set->fi_addr_array[i]);
+		name = av->smr_map->peers[id].peer.name;
+		if (!strcmp(name, mc->ep->name))
+			mc->rank = i;
+		hash = smr_coll_hash(hash, name);
+	}
+
+	if (mc->rank < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"endpoint is not a member of the collective group\n");
+		return -FI_EINVAL;
+	}
+
+	key = smr_coll_get_key(mc->ep, hash);
+	if (!key)
+		return -FI_ENOMEM;
+
+	snprintf(mc->name, SMR_NAME_MAX, "/fi_shm_coll_%d_%" PRIx64 "_%" PRIu64,
+		 getuid(), hash, key->cnt++);
+	mc->seg_size = sizeof(*mc->seg) + mc->size *
+		       (sizeof(struct smr_coll_flag) + SMR_COLL_BUF_SIZE);
+
+	fd = shm_open(mc->name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "shm_open error (%s): %s\n",
+			mc->name, strerror(errno));
+		return -errno;
+	}
+
+	ret = ftruncate(fd, mc->seg_size);
+	if (ret < 0) {
+		ret = -errno;
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "ftruncate error: %s\n",
+			strerror(errno));
+		close(fd);
+		shm_unlink(mc->name);
+		return ret;
+	}
+
+	mc->seg = mmap(NULL, mc->seg_size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED, fd, 0);
+	close(fd);
+	if (mc->seg == MAP_FAILED) {
+		ret = -errno;
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL, "mmap error: %s\n",
+			strerror(errno));
+		shm_unlink(mc->name);
+		return ret;
+	}
+
+	/* every member opens the segment before the name is removed */
+	joined = ofi_atomic_load_explicit64(&mc->seg->joined,
+					    memory_order_relaxed);
+	while (!ofi_atomic_compare_exchange_weak64(&mc->seg->joined, &joined,
+						   joined + 1))
+		;
+
+	if (joined + 1 == mc->size) {
+		shm_unlink(mc->name);
+		ofi_atomic_store_explicit64(&mc->seg->ready, 1,
+					    memory_order_release);
+	}
+	return FI_SUCCESS;
+}
+
+int smr_join_collective(struct fid_ep *ep_fid, const void *addr,
+			uint64_t flags, struct fid_mc **mc_fid, void *context)
+{
+	const struct fi_collective_addr *c_addr = addr;
+	struct util_av_set *av_set;
+	struct smr_coll_mc *mc;
+	struct smr_ep *ep;
+	int ret;
+
+	if (!(flags & FI_COLLECTIVE))
+		return -FI_ENOSYS;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid);
+	if (!ep->util_ep.eq)
+		return -FI_ENOEQ;
+
+	av_set = container_of(c_addr->set, struct util_av_set, av_set_fid);
+	if (!av_set->fi_addr_count)
+		return -FI_EINVAL;
+
+	mc = calloc(1, sizeof(*mc));
+	if (!mc)
+		return -FI_ENOMEM;
+
+	mc->util_mc.mc_fid.fid.fclass = FI_CLASS_MC;
+	mc->util_mc.mc_fid.fid.context = context;
+	mc->util_mc.mc_fid.fid.ops = &smr_coll_mc_fi_ops;
+	mc->util_mc.mc_fid.fi_addr = (uintptr_t) mc;
+	mc->util_mc.av_set = av_set;
+	mc->ep = ep;
+	mc->size = av_set->fi_addr_count;
+	dlist_init(&mc->op_list);
+
+	ofi_genlock_lock(&ep->util_ep.lock);
+	if (!ep->coll_op_pool) {
+		ret = ofi_bufpool_create(&ep->coll_op_pool,
+					 sizeof(struct smr_coll_op), 16, 0, 16,
+					 OFI_BUFPOOL_NO_TRACK);
+		if (ret)
+			goto err;
+	}
+
+	ret = smr_coll_map(mc);
+	if (ret)
+		goto err;
+
+	mc->util_mc.local_rank = mc->rank;
+	ofi_atomic_inc32(&av_set->ref);
+	dlist_insert_tail(&mc->entry, &ep->coll_mc_list);
+	ofi_genlock_unlock(&ep->util_ep.lock);
+
+	*mc_fid = &mc->util_mc.mc_fid;
+	return FI_SUCCESS;
+err:
+	ofi_genlock_unlock(&ep->util_ep.lock);
+	free(mc);
+	return ret;
+}
+
+void smr_coll_cleanup(struct smr_ep *ep)
+{
+	struct smr_coll_key *key;
+
+	while (!dlist_empty(&ep->coll_key_list)) {
+		dlist_pop_front(&ep->coll_key_list, struct smr_coll_key,
+				key, entry);
+		free(key);
+	}
+
+	if (ep->coll_op_pool)
+		ofi_bufpool_destroy(ep->coll_op_pool);
+}
+
+int smr_query_collective(struct fid_domain *domain,
+			 enum fi_collective_op coll,
+			 struct fi_collective_attr *attr, uint64_t flags)
+{
+	int ret;
+
+	if (!attr || attr->mode != 0)
+		return -FI_EINVAL;
+
+	switch (coll) {
+	case FI_BARRIER:
+	case FI_BROADCAST:
+		ret = FI_SUCCESS;
+		break;
+	case FI_ALLREDUCE:
+	case FI_REDUCE_SCATTER:
+		if (attr->op < FI_MIN || attr->op > FI_BXOR)
+			return -FI_ENOSYS;
+		ret = smr_query_atomic(domain, attr->datatype, attr->op,
+				       &attr->datatype_attr, flags);
+		/* operations are split into chunks, so any count works */
+		if (!ret)
+			attr->datatype_attr.count = SIZE_MAX /
+						    attr->datatype_attr.size;
+		break;
+	default:
+		return -FI_ENOSYS;
+	}
+
+	if (ret)
+		return ret;
+
+	attr->max_members = SMR_MAX_PEERS;
+	return FI_SUCCESS;
+}
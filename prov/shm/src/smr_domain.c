@@ -46,7 +46,7 @@ static struct fi_ops_domain smr_domain_ops = {
 	.stx_ctx = fi_no_stx_context,
 	.srx_ctx = smr_srx_context,
 	.query_atomic = smr_query_atomic,
-	.query_collective = fi_no_query_collective,
+	.query_collective = smr_query_collective,
 };
 
 static int smr_domain_close(fid_t fid)
@@ -67,12 +67,23 @@ static int smr_domain_close(fid_t fid)
 	return 0;
 }
 
+static int smr_domain_ops_open(struct fid *fid, const char *name,
+			       uint64_t flags, void **ops, void *context)
+{
+	if (!strcasecmp(name, FI_SHM_EXPORT_OPS)) {
+		*ops = &smr_export_ops;
+		return 0;
+	}
+
+	return -FI_ENOSYS;
+}
+
 static struct fi_ops smr_domain_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = smr_domain_close,
 	.bind = fi_no_bind,
 	.control = fi_no_control,
-	.ops_open = fi_no_ops_open,
+	.ops_open = smr_domain_ops_open,
 };
 
 static struct fi_ops_mr smr_mr_ops = {
@@ -582,6 +582,7 @@ static void dsa_update_tx_entry(struct smr_region *smr,
 	assert(resp->status == SMR_STATUS_BUSY);
 	resp->status = (dsa_cmd_context->dir == OFI_COPY_IOV_TO_BUF ?
 			SMR_STATUS_SAR_FULL : SMR_STATUS_SAR_EMPTY);
+	smr_ring_doorbell(smr_peer_region(smr, tx_entry->peer_id));
 }
 
 static void dsa_update_sar_entry(struct smr_region *smr,
@@ -600,6 +601,7 @@ static void dsa_update_sar_entry(struct smr_region *smr,
 	assert(resp->status == SMR_STATUS_BUSY);
 	resp->status = (dsa_cmd_context->dir == OFI_COPY_IOV_TO_BUF ?
 			SMR_STATUS_SAR_FULL : SMR_STATUS_SAR_EMPTY);
+	smr_ring_doorbell(peer_smr);
 }
 
 static void dsa_process_complete_work(struct smr_region *smr,
@@ -682,8 +684,9 @@ void smr_dsa_init(void)
 {
 	libdsa_handle = dlopen("libaccel-config.so", RTLD_NOW);
 	if (!libdsa_handle) {
-		FI_WARN(&core_prov, FI_LOG_CORE,
+		FI_INFO(&core_prov, FI_LOG_CORE,
 			"Failed to dlopen libaccel-config.so\n");
+		smr_env.use_dsa_sar = 0;
 		return;
 	}
 
@@ -820,6 +823,7 @@ void smr_dsa_init(void)
 err_dlclose:
 	dlclose(libdsa_handle);
 	libdsa_handle = NULL;
+	smr_env.use_dsa_sar = 0;
 }
 
 void smr_dsa_cleanup(void)
@@ -986,7 +990,11 @@ size_t smr_dsa_copy_from_sar(struct smr_ep *ep, struct smr_freestack *sar_pool,
 
 #else
 
-void smr_dsa_init(void) {}
+void smr_dsa_init(void)
+{
+	smr_env.use_dsa_sar = 0;
+}
+
 void smr_dsa_cleanup(void) {}
 
 size_t smr_dsa_copy_to_sar(struct smr_ep *ep, struct smr_freestack *sar_pool,
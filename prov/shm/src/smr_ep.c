@@ -111,6 +111,7 @@ static struct fi_ops_cm smr_cm_ops = {
 	.accept = fi_no_accept,
 	.reject = fi_no_reject,
 	.shutdown = fi_no_shutdown,
+	.join = smr_join_collective,
 };
 
 int smr_ep_getopt(fid_t fid, int level, int optname, void *optval,
@@ -119,6 +120,14 @@ int smr_ep_getopt(fid_t fid, int level, int optname, void *optval,
 	struct smr_ep *smr_ep =
 		container_of(fid, struct smr_ep, util_ep.ep_fid);
 
+	if (!smr_ep->srx && level == FI_OPT_ENDPOINT &&
+	    optname == FI_OPT_TAG_BUCKETS) {
+		*(size_t *)optval = smr_ep->tag_buckets ?
+			ofi_tag_bucket_mask(smr_ep->tag_buckets) + 1 : 0;
+		*optlen = sizeof(size_t);
+		return FI_SUCCESS;
+	}
+
 	return smr_ep->srx->ops->getopt(&smr_ep->srx->fid, level, optname,
 					optval, optlen);
 }
@@ -139,6 +148,17 @@ int smr_ep_setopt(fid_t fid, int level, int optname, const void *optval,
 		return FI_SUCCESS;
 	}
 
+	/* The receive context is created when the endpoint is enabled */
+	if (optname == FI_OPT_TAG_BUCKETS) {
+		if (optlen != sizeof(size_t))
+			return -FI_EINVAL;
+		if (smr_ep->srx)
+			return -FI_EOPBADSTATE;
+
+		smr_ep->tag_buckets = *(size_t *)optval;
+		return FI_SUCCESS;
+	}
+
 	if (optname == FI_OPT_CUDA_API_PERMITTED) {
 		if (!hmem_ops[FI_HMEM_CUDA].initialized) {
 			FI_WARN(&smr_prov, FI_LOG_CORE,
@@ -205,8 +225,16 @@ static void smr_send_name(struct smr_ep *ep, int64_t id)
 	ce->cmd.msg.hdr.size = strlen(ep->name) + 1;
 	memcpy(tx_buf->data, ep->name, ce->cmd.msg.hdr.size);
 
+	/* Once the peer handles the request it may post to our queue */
+	if (ep->region->peer_queue_size) {
+		ofi_genlock_lock(&ep->util_ep.lock);
+		smr_add_peer_queue(ep, id);
+		ofi_genlock_unlock(&ep->util_ep.lock);
+	}
+
 	smr_peer_data(ep->region)[id].name_sent = 1;
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 }
 
 int64_t smr_verify_peer(struct smr_ep *ep, fi_addr_t fi_addr)
@@ -215,15 +243,16 @@ int64_t smr_verify_peer(struct smr_ep *ep, fi_addr_t fi_addr)
 	int ret;
 
 	id = smr_addr_lookup(ep->util_ep.av, fi_addr);
-	assert(id < SMR_MAX_PEERS);
+	assert(id < ep->region->map->max_peers);
 
 	if (smr_peer_data(ep->region)[id].addr.id >= 0)
 		return id;
 
 	if (ep->region->map->peers[id].peer.id < 0) {
 		ret = smr_map_to_region(&smr_prov, ep->region->map, id);
-		if (ret == -ENOENT)
+		if (ret)
 			return -1;
+		smr_map_to_endpoint(ep->region, id);
 	}
 
 	smr_send_name(ep, id);
@@ -242,6 +271,7 @@ void smr_format_pend_resp(struct smr_tx_entry *pend, struct smr_cmd *cmd,
 	pend->iov_count = iov_count;
 	pend->peer_id = id;
 	pend->op_flags = op_flags;
+	pend->start_ns = ofi_gettime_ns();
 	if (cmd->msg.hdr.op_src != smr_src_sar) {
 		pend->bytes_done = 0;
 		resp->status = FI_EBUSY;
@@ -274,7 +304,7 @@ static void smr_format_inline(struct smr_cmd *cmd, struct ofi_mr **mr,
 			      const struct iovec *iov, size_t count)
 {
 	cmd->msg.hdr.op_src = smr_src_inline;
-	cmd->msg.hdr.size = ofi_copy_from_mr_iov(cmd->msg.data.msg,
+	cmd->msg.hdr.size = ofi_copy_from_mr_iov(smr_inline_data(cmd),
 						 SMR_MSG_DATA_LEN, mr,
 						 iov, count, 0);
 }
@@ -300,6 +330,19 @@ static void smr_format_iov(struct smr_cmd *cmd, const struct iovec *iov,
 	memcpy(cmd->msg.data.iov, iov, sizeof(*iov) * count);
 }
 
+static void smr_format_export(struct smr_cmd *cmd, struct smr_export *export,
+		const struct iovec *iov, size_t total_len, struct smr_region *smr,
+		struct smr_resp *resp)
+{
+	cmd->msg.hdr.op_src = smr_src_export;
+	cmd->msg.hdr.src_data = smr_get_offset(smr, resp);
+	cmd->msg.hdr.size = total_len;
+	cmd->msg.data.export_id = export->id;
+	cmd->msg.data.export_size = export->size;
+	cmd->msg.data.export_offset = (uintptr_t) iov[0].iov_base -
+				      (uintptr_t) export->base;
+}
+
 static int smr_format_ze_ipc(struct smr_ep *ep, int64_t id, struct smr_cmd *cmd,
 		const struct iovec *iov, uint64_t device, size_t total_len,
 		struct smr_region *smr, struct smr_resp *resp,
@@ -451,26 +494,32 @@ size_t smr_copy_to_sar(struct smr_freestack *sar_pool, struct smr_resp *resp,
 {
 	struct smr_sar_buf *sar_buf;
 	size_t start = *bytes_done;
-	int next_sar_buf = 0;
+	uint64_t *status;
+	int segs, seg_bufs, seg, i;
 
-	if (resp->status != SMR_STATUS_SAR_EMPTY)
-		return 0;
+	segs = smr_sar_segs(cmd);
+	seg_bufs = cmd->msg.data.buf_batch_size / segs;
 
-	while ((*bytes_done < cmd->msg.hdr.size) &&
-			(next_sar_buf < cmd->msg.data.buf_batch_size)) {
-		sar_buf = smr_freestack_get_entry_from_index(
-				sar_pool, cmd->msg.data.sar[next_sar_buf]);
+	while (*bytes_done < cmd->msg.hdr.size) {
+		seg = (*bytes_done / (seg_bufs * SMR_SAR_SIZE)) % segs;
+		status = smr_sar_seg_status(resp, seg);
+		if (*status != SMR_STATUS_SAR_EMPTY)
+			break;
 
-		*bytes_done += ofi_copy_from_mr_iov(
-				sar_buf->buf, SMR_SAR_SIZE, mr, iov, count,
-				*bytes_done);
+		for (i = 0; i < seg_bufs && *bytes_done < cmd->msg.hdr.size;
+		     i++) {
+			sar_buf = smr_freestack_get_entry_from_index(sar_pool,
+					cmd->msg.data.sar[seg * seg_bufs + i]);
 
-		next_sar_buf++;
-	}
+			*bytes_done += ofi_copy_from_mr_iov(
+					sar_buf->buf, SMR_SAR_SIZE, mr, iov,
+					count, *bytes_done);
+		}
 
-	ofi_wmb();
+		ofi_wmb();
 
-	resp->status = SMR_STATUS_SAR_FULL;
+		*status = SMR_STATUS_SAR_FULL;
+	}
 
 	return *bytes_done - start;
 }
@@ -482,25 +531,33 @@ size_t smr_copy_from_sar(struct smr_freestack *sar_pool, struct smr_resp *resp,
 {
 	struct smr_sar_buf *sar_buf;
 	size_t start = *bytes_done;
-	int next_sar_buf = 0;
+	uint64_t *status;
+	int segs, seg_bufs, seg, i;
 
-	if (resp->status != SMR_STATUS_SAR_FULL)
-		return 0;
+	segs = smr_sar_segs(cmd);
+	seg_bufs = cmd->msg.data.buf_batch_size / segs;
+
+	while (*bytes_done < cmd->msg.hdr.size) {
+		seg = (*bytes_done / (seg_bufs * SMR_SAR_SIZE)) % segs;
+		status = smr_sar_seg_status(resp, seg);
+		if (*status != SMR_STATUS_SAR_FULL)
+			break;
 
-	while ((*bytes_done < cmd->msg.hdr.size) &&
-			(next_sar_buf < cmd->msg.data.buf_batch_size)) {
-		sar_buf = smr_freestack_get_entry_from_index(
-				sar_pool, cmd->msg.data.sar[next_sar_buf]);
+		for (i = 0; i < seg_bufs && *bytes_done < cmd->msg.hdr.size;
+		     i++) {
+			sar_buf = smr_freestack_get_entry_from_index(sar_pool,
+					cmd->msg.data.sar[seg * seg_bufs + i]);
 
-		*bytes_done += ofi_copy_to_mr_iov(mr, iov, count, *bytes_done,
-				sar_buf->buf, SMR_SAR_SIZE);
+			*bytes_done += ofi_copy_to_mr_iov(mr, iov, count,
+					*bytes_done, sar_buf->buf,
+					SMR_SAR_SIZE);
+		}
 
-		next_sar_buf++;
-	}
+		ofi_wmb();
 
-	ofi_wmb();
+		*status = SMR_STATUS_SAR_EMPTY;
+	}
 
-	resp->status = SMR_STATUS_SAR_EMPTY;
 	return *bytes_done - start;
 }
 
@@ -512,6 +569,7 @@ static int smr_format_sar(struct smr_ep *ep, struct smr_cmd *cmd,
 {
 	int i, ret;
 	uint32_t sar_needed;
+	bool use_dsa;
 
 	if (peer_smr->max_sar_buf_per_peer == 0)
 		return -FI_EAGAIN;
@@ -538,9 +596,22 @@ static int smr_format_sar(struct smr_ep *ep, struct smr_cmd *cmd,
 		cmd->msg.data.sar[i] =
 			smr_freestack_pop_by_index(smr_sar_pool(peer_smr));
 	}
+
+	/* Pipeline a copy that takes more than one round trip through the
+	 * batch.  The DSA copy path hands off whole batches only.
+	 */
+	use_dsa = smr_dsa_preferred(total_len, mr, count);
+	if (!use_dsa && cmd->msg.data.buf_batch_size > 1 &&
+	    sar_needed > cmd->msg.data.buf_batch_size) {
+		if (cmd->msg.data.buf_batch_size & 1)
+			smr_freestack_push_by_index(smr_sar_pool(peer_smr),
+				cmd->msg.data.sar[--cmd->msg.data.buf_batch_size]);
+		cmd->msg.hdr.op_flags |= SMR_SAR_PIPELINE;
+	}
 	pthread_spin_unlock(&peer_smr->lock);
 
 	resp->status = SMR_STATUS_SAR_EMPTY;
+	resp->pipe_status = SMR_STATUS_SAR_EMPTY;
 	cmd->msg.hdr.op_src = smr_src_sar;
 	cmd->msg.hdr.src_data = smr_get_offset(smr, resp);
 	cmd->msg.hdr.size = total_len;
@@ -551,7 +622,7 @@ static int smr_format_sar(struct smr_ep *ep, struct smr_cmd *cmd,
 		goto out;
 
 	if (cmd->msg.hdr.op != ofi_op_read_req) {
-		if (smr_env.use_dsa_sar && ofi_mr_all_host(mr, count)) {
+		if (use_dsa) {
 			ret = smr_dsa_copy_to_sar(ep, smr_sar_pool(peer_smr),
 					resp, cmd, iov,	count,
 					&pending->bytes_done, pending);
@@ -580,7 +651,7 @@ int smr_select_proto(void **desc, size_t iov_count,
 {
 	struct ofi_mr *smr_desc;
 	enum fi_hmem_iface iface = FI_HMEM_SYSTEM;
-	bool fastcopy_avail = false, use_ipc = false;
+	bool fastcopy_avail = false, use_ipc = false, use_export = false;
 
 	/* Do not inline/inject if IPC is available so device to device
 	 * transfer may occur if possible. */
@@ -595,8 +666,17 @@ int smr_select_proto(void **desc, size_t iov_count,
 			assert(smr_desc->hmem_data);
 			fastcopy_avail = true;
 		}
+
+		/* The peer copies straight out of (or into) an exported
+		 * buffer, so the data may not be staged by the sender. */
+		use_export = smr_export_desc(smr_desc) &&
+			     !(op_flags & FI_INJECT);
 	}
 
+	if (use_export &&
+	    (op == ofi_op_read_req || total_len > SMR_MSG_DATA_LEN))
+		return smr_src_export;
+
 	if (op == ofi_op_read_req) {
 		if (use_ipc)
 			return smr_src_ipc;
@@ -796,6 +876,37 @@ static ssize_t smr_do_mmap(struct smr_ep *ep, struct smr_region *peer_smr, int64
 	return FI_SUCCESS;
 }
 
+static ssize_t smr_do_export(struct smr_ep *ep, struct smr_region *peer_smr,
+			     int64_t id, int64_t peer_id, uint32_t op,
+			     uint64_t tag, uint64_t data, uint64_t op_flags,
+			     struct ofi_mr **desc, const struct iovec *iov,
+			     size_t iov_count, size_t total_len, void *context,
+			     struct smr_cmd *cmd)
+{
+	struct smr_export *export = smr_export_desc(desc[0]);
+	struct smr_resp *resp;
+	struct smr_tx_entry *pend;
+
+	if ((char *) iov[0].iov_base < (char *) export->base ||
+	    (char *) iov[0].iov_base + total_len >
+	    (char *) export->base + export->size)
+		return -FI_EINVAL;
+
+	if (ofi_cirque_isfull(smr_resp_queue(ep->region)))
+		return -FI_EAGAIN;
+
+	resp = ofi_cirque_next(smr_resp_queue(ep->region));
+	pend = ofi_freestack_pop(ep->tx_fs);
+
+	smr_generic_format(cmd, peer_id, op, tag, data, op_flags);
+	smr_format_export(cmd, export, iov, total_len, ep->region, resp);
+	smr_format_pend_resp(pend, cmd, context, desc, iov,
+			     iov_count, op_flags, id, resp);
+	ofi_cirque_commit(smr_resp_queue(ep->region));
+
+	return FI_SUCCESS;
+}
+
 smr_proto_func smr_proto_ops[smr_src_max] = {
 	[smr_src_inline] = &smr_do_inline,
 	[smr_src_inject] = &smr_do_inject,
@@ -803,6 +914,7 @@ smr_proto_func smr_proto_ops[smr_src_max] = {
 	[smr_src_mmap] = &smr_do_mmap,
 	[smr_src_sar] = &smr_do_sar,
 	[smr_src_ipc] = &smr_do_ipc,
+	[smr_src_export] = &smr_do_export,
 };
 
 static void smr_cleanup_epoll(struct smr_sock_info *sock_info)
@@ -826,6 +938,7 @@ static int smr_ep_close(struct fid *fid)
 		close(ep->sock_info->listen_sock);
 		unlink(ep->sock_info->name);
 		smr_cleanup_epoll(ep->sock_info);
+		free(ep->sock_info->peers);
 		free(ep->sock_info);
 	}
 
@@ -836,6 +949,10 @@ static int smr_ep_close(struct fid *fid)
 
 	if (ep->region)
 		smr_free(ep->region);
+	free(ep->peer_queue_ids);
+	free(ep->unexp_inject_cnt);
+	smr_coll_cleanup(ep);
+	smr_export_cleanup(ep);
 
 	if (ep->cmd_ctx_pool)
 		ofi_bufpool_destroy(ep->cmd_ctx_pool);
@@ -989,7 +1106,7 @@ static void *smr_start_listener(void *args)
 {
 	struct smr_ep *ep = (struct smr_ep *) args;
 	struct sockaddr_un sockaddr;
-	struct ofi_epollfds_event events[SMR_MAX_PEERS + 1];
+	struct ofi_epollfds_event events[SMR_DEF_PEERS + 1];
 	int i, ret, poll_fds, sock = -1;
 	int *peer_fds = NULL;
 	socklen_t len = sizeof(sockaddr);
@@ -1002,7 +1119,7 @@ static void *smr_start_listener(void *args)
 	ep->region->flags |= SMR_FLAG_IPC_SOCK;
 	while (1) {
 		poll_fds = ofi_epoll_wait(ep->sock_info->epollfd, events,
-					  SMR_MAX_PEERS + 1, -1);
+					  SMR_DEF_PEERS + 1, -1);
 
 		if (poll_fds < 0) {
 			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
@@ -1173,11 +1290,12 @@ static void smr_free_sock_info(struct smr_ep *ep)
 {
 	int i, j;
 
-	for (i = 0; i < SMR_MAX_PEERS; i++) {
+	for (i = 0; ep->sock_info->peers && i < ep->region->max_peers; i++) {
 		for (j = 0; j < ep->sock_info->nfds; j++)
 			close(ep->sock_info->peers[i].device_fds[j]);
 		free(ep->sock_info->peers[i].device_fds);
 	}
+	free(ep->sock_info->peers);
 	free(ep->sock_info);
 	ep->sock_info = NULL;
 }
@@ -1192,6 +1310,11 @@ static void smr_init_ipc_socket(struct smr_ep *ep)
 	if (!ep->sock_info)
 		goto err_out;
 
+	ep->sock_info->peers = calloc(ep->region->max_peers,
+				      sizeof(*ep->sock_info->peers));
+	if (!ep->sock_info->peers)
+		goto free;
+
 	ep->sock_info->listen_sock = socket(AF_UNIX, SOCK_STREAM, 0);
 	if (ep->sock_info->listen_sock < 0)
 		goto free;
@@ -1260,6 +1383,8 @@ static int smr_discard(struct fi_peer_rx_entry *rx_entry)
 {
 	struct smr_cmd_ctx *cmd_ctx = rx_entry->peer_context;
 
+	if (cmd_ctx->tx_buf)
+		smr_release_held_txbuf(cmd_ctx);
 	ofi_buf_free(cmd_ctx);
 
 	return FI_SUCCESS;
@@ -1320,6 +1445,8 @@ static int smr_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 						      cq_fid.fid), flags);
 		break;
 	case FI_CLASS_EQ:
+		ret = ofi_ep_bind_eq(&ep->util_ep, container_of(bfid,
+				struct util_eq, eq_fid.fid));
 		break;
 	case FI_CLASS_CNTR:
 		ret = smr_ep_bind_cntr(ep, container_of(bfid,
@@ -1365,13 +1492,30 @@ static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 		attr.name = smr_no_prefix(ep->name);
 		attr.rx_count = ep->rx_size;
 		attr.tx_count = ep->tx_size;
+		attr.peer_queue_count = smr_env.peer_queue_size;
 		attr.flags = ep->util_ep.caps & FI_HMEM ?
 				SMR_FLAG_HMEM_ENABLED : 0;
+		if (ep->util_ep.caps & FI_RMA_EVENT &&
+		    (ep->util_ep.cntrs[CNTR_REM_RD] ||
+		     ep->util_ep.cntrs[CNTR_REM_WR]))
+			attr.flags |= SMR_FLAG_RMA_EVENT;
 
 		ret = smr_create(&smr_prov, av->smr_map, &attr, &ep->region);
 		if (ret)
 			return ret;
 
+		ep->unexp_inject_cnt = calloc(ep->region->max_peers,
+					sizeof(*ep->unexp_inject_cnt));
+		if (!ep->unexp_inject_cnt)
+			return -FI_ENOMEM;
+
+		if (ep->region->peer_queue_size) {
+			ep->peer_queue_ids = calloc(ep->region->max_peers,
+						sizeof(*ep->peer_queue_ids));
+			if (!ep->peer_queue_ids)
+				return -FI_ENOMEM;
+		}
+
 		if (ep->util_ep.caps & FI_HMEM || smr_env.disable_cma) {
 			ep->region->cma_cap_peer = SMR_VMA_CAP_OFF;
 			ep->region->cma_cap_self = SMR_VMA_CAP_OFF;
@@ -1392,7 +1536,8 @@ static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 					      util_domain.domain_fid);
 			ret = util_ep_srx_context(&domain->util_domain,
 					ep->rx_size, SMR_IOV_LIMIT,
-					SMR_INJECT_SIZE, &smr_update,
+					SMR_INJECT_SIZE, ep->tag_buckets,
+					&smr_update,
 					&ep->util_ep.lock, &ep->srx);
 			if (ret)
 				return ret;
@@ -1433,12 +1578,44 @@ static int smr_ep_ctrl(struct fid *fid, int command, void *arg)
 	return ret;
 }
 
+static int smr_ep_stats_read(struct fid_ep *ep_fid,
+			     struct fi_shm_ep_stats *stats, uint64_t flags)
+{
+	struct smr_ep *ep;
+
+	ep = container_of(ep_fid, struct smr_ep, util_ep.ep_fid);
+
+	ofi_genlock_lock(&ep->util_ep.lock);
+	*stats = ep->stats;
+	if (flags & FI_SHM_STATS_RESET)
+		memset(&ep->stats, 0, sizeof(ep->stats));
+	ofi_genlock_unlock(&ep->util_ep.lock);
+
+	return FI_SUCCESS;
+}
+
+static struct fi_shm_ops_stats smr_stats_ops = {
+	.size = sizeof(struct fi_shm_ops_stats),
+	.read = smr_ep_stats_read,
+};
+
+static int smr_ep_ops_open(struct fid *fid, const char *name,
+			   uint64_t flags, void **ops, void *context)
+{
+	if (!strcasecmp(name, FI_SHM_STATS_OPS)) {
+		*ops = &smr_stats_ops;
+		return 0;
+	}
+
+	return -FI_ENOSYS;
+}
+
 static struct fi_ops smr_ep_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = smr_ep_close,
 	.bind = smr_ep_bind,
 	.control = smr_ep_ctrl,
-	.ops_open = fi_no_ops_open,
+	.ops_open = smr_ep_ops_open,
 };
 
 static int smr_endpoint_name(struct smr_ep *ep, char *name, char *addr,
@@ -1541,6 +1718,7 @@ int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
 
 	ep->rx_size = info->rx_attr->size;
 	ep->tx_size = info->tx_attr->size;
+	ep->tag_buckets = ofi_srx_tag_buckets;
 	ret = ofi_endpoint_init(domain, &smr_util_prov, info, &ep->util_ep, context,
 				smr_ep_progress);
 	if (ret)
@@ -1557,12 +1735,16 @@ int smr_endpoint(struct fid_domain *domain, struct fi_info *info,
 
 	dlist_init(&ep->sar_list);
 	dlist_init(&ep->ipc_cpy_pend_list);
+	dlist_init(&ep->coll_mc_list);
+	dlist_init(&ep->coll_key_list);
+	dlist_init(&ep->export_map_list);
 
 	ep->util_ep.ep_fid.fid.ops = &smr_ep_fi_ops;
 	ep->util_ep.ep_fid.ops = &smr_ep_ops;
 	ep->util_ep.ep_fid.cm = &smr_cm_ops;
 	ep->util_ep.ep_fid.rma = &smr_rma_ops;
 	ep->util_ep.ep_fid.atomic = &smr_atomic_ops;
+	ep->util_ep.ep_fid.collective = &smr_coll_ops;
 
 	*ep_fid = &ep->util_ep.ep_fid;
 
@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "smr.h"
+
+/*
+ * An export buffer is a named shm file mapped by its owner and described
+ * by an ofi_mr.  Receivers map the file the first time a command refers to
+ * it and keep it mapped until their endpoint closes.  Ids are never reused
+ * and start from a timestamp, so a mapping cannot be confused with a
+ * buffer of a later process that reuses the owner's pid.
+ *
+ * Buffers open to remote access are also linked under a name made of the
+ * owner's pid and the MR key.  Initiators of direct atomics map them by
+ * that name and find the key, access and address translation in the
+ * trailer page after the buffer.  rkey entries record the id as the key,
+ * and a NULL base when no such buffer exists.
+ */
+struct smr_export_map_entry {
+	struct dlist_entry	entry;
+	pid_t			pid;
+	uint64_t		id;
+	void			*base;
+	size_t			size;
+	bool			rkey;
+};
+
+static void smr_export_path(char *path, const char *name)
+{
+	snprintf(path, SMR_PATH_MAX, "%s%s", SMR_DIR, name + 1);
+}
+
+ofi_atomic64_t smr_export_id;
+
+static int smr_export_close(struct fid *fid)
+{
+	struct smr_export *export;
+	struct util_domain *domain;
+	char name[SMR_NAME_MAX];
+	int ret;
+
+	export = container_of(fid, struct smr_export, mr.mr_fid.fid);
+	domain = export->mr.domain;
+
+	ofi_genlock_lock(&domain->lock);
+	ret = ofi_mr_map_remove(&domain->mr_map, export->mr.key);
+	ofi_genlock_unlock(&domain->lock);
+	if (ret)
+		return ret;
+
+	ofi_atomic_dec32(&domain->ref);
+
+	export->info->magic = 0;
+	if (export->rkey) {
+		smr_export_rkey_name(name, getpid(), export->mr.key);
+		shm_unlink(name);
+	}
+	munmap(export->base, export->size + ofi_get_page_size());
+	smr_export_name(name, getpid(), export->id);
+	shm_unlink(name);
+	free(export);
+	return 0;
+}
+
+struct fi_ops smr_export_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = smr_export_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+static int smr_export_create(struct smr_export *export)
+{
+	char name[SMR_NAME_MAX];
+	int fd, ret = 0;
+
+	smr_export_name(name, getpid(), export->id);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		FI_WARN(&smr_prov, FI_LOG_MR, "shm_open error (%s): %s\n",
+			name, strerror(errno));
+		return -errno;
+	}
+
+	if (ftruncate(fd, export->size + ofi_get_page_size())) {
+		FI_WARN(&smr_prov, FI_LOG_MR, "ftruncate error: %s\n",
+			strerror(errno));
+		ret = -errno;
+		goto unlink;
+	}
+
+	export->base = mmap(NULL, export->size + ofi_get_page_size(),
+			    PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (export->base == MAP_FAILED) {
+		FI_WARN(&smr_prov, FI_LOG_MR, "mmap error: %s\n",
+			strerror(errno));
+		ret = -errno;
+		goto unlink;
+	}
+
+	export->info = (struct smr_export_info *)
+		       ((char *) export->base + export->size);
+	close(fd);
+	return 0;
+
+unlink:
+	shm_unlink(name);
+	close(fd);
+	return ret;
+}
+
+/* Not linking only disables direct atomics on the buffer.  The name can
+ * be taken by a buffer with the same key in another domain.
+ */
+static void smr_export_link(struct smr_export *export)
+{
+	char name[SMR_NAME_MAX], path[SMR_PATH_MAX];
+	char rkey_name[SMR_NAME_MAX], rkey_path[SMR_PATH_MAX];
+
+	smr_export_name(name, getpid(), export->id);
+	smr_export_rkey_name(rkey_name, getpid(), export->mr.key);
+	smr_export_path(path, name);
+	smr_export_path(rkey_path, rkey_name);
+
+	if (link(path, rkey_path)) {
+		FI_INFO(&smr_prov, FI_LOG_MR, "link error (%s): %s\n",
+			rkey_name, strerror(errno));
+		return;
+	}
+	export->rkey = true;
+}
+
+static int smr_export_alloc(struct fid_domain *domain_fid, size_t len,
+			    uint64_t access, uint64_t requested_key,
+			    uint64_t flags, void **buf, struct fid_mr **mr_fid,
+			    void *context)
+{
+	struct util_domain *domain;
+	struct smr_export *export;
+	struct fi_mr_attr attr;
+	struct iovec iov;
+	uint64_t key;
+	char name[SMR_NAME_MAX];
+	int ret;
+
+	if (!len || !buf || !mr_fid)
+		return -FI_EINVAL;
+
+	domain = container_of(domain_fid, struct util_domain, domain_fid);
+
+	export = calloc(1, sizeof(*export));
+	if (!export)
+		return -FI_ENOMEM;
+
+	export->id = ofi_atomic_inc64(&smr_export_id);
+	export->size = ofi_get_aligned_size(len, ofi_get_page_size());
+	ret = smr_export_create(export);
+	if (ret) {
+		free(export);
+		return ret;
+	}
+
+	iov.iov_base = export->base;
+	iov.iov_len = len;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.mr_iov = &iov;
+	attr.iov_count = 1;
+	attr.access = access;
+	attr.requested_key = requested_key;
+	attr.context = context;
+	attr.iface = FI_HMEM_SYSTEM;
+
+	ofi_genlock_lock(&domain->lock);
+
+	export->mr.mr_fid.fid.fclass = FI_CLASS_MR;
+	export->mr.mr_fid.fid.context = context;
+	export->mr.mr_fid.fid.ops = &smr_export_fi_ops;
+	export->mr.domain = domain;
+	export->mr.flags = flags;
+	export->mr.iface = FI_HMEM_SYSTEM;
+
+	ret = ofi_mr_map_insert(&domain->mr_map, &attr, &key, &export->mr,
+				flags);
+	if (ret) {
+		ofi_genlock_unlock(&domain->lock);
+		munmap(export->base, export->size + ofi_get_page_size());
+		smr_export_name(name, getpid(), export->id);
+		shm_unlink(name);
+		free(export);
+		return ret;
+	}
+
+	export->mr.mr_fid.key = export->mr.key = key;
+	export->mr.mr_fid.mem_desc = &export->mr;
+	ofi_atomic_inc32(&domain->ref);
+
+	export->info->key = key;
+	export->info->addr_base = domain->mr_map.mode & FI_MR_VIRT_ADDR ?
+				  (uintptr_t) export->base : 0;
+	export->info->len = len;
+	export->info->access = access;
+	export->info->magic = SMR_EXPORT_MAGIC;
+	if (access & (FI_REMOTE_READ | FI_REMOTE_WRITE))
+		smr_export_link(export);
+
+	ofi_genlock_unlock(&domain->lock);
+
+	*buf = export->base;
+	*mr_fid = &export->mr.mr_fid;
+	return 0;
+}
+
+struct fi_shm_ops_export smr_export_ops = {
+	.size = sizeof(struct fi_shm_ops_export),
+	.alloc = smr_export_alloc,
+};
+
+void *smr_export_map(struct smr_ep *ep, pid_t pid, uint64_t id, size_t size)
+{
+	struct smr_export_map_entry *map;
+	struct dlist_entry *item;
+	char name[SMR_NAME_MAX];
+	struct stat st;
+	void *base;
+	int fd;
+
+	dlist_foreach(&ep->export_map_list, item) {
+		map = container_of(item, struct smr_export_map_entry, entry);
+		if (map->id != id || map->pid != pid || map->rkey)
+			continue;
+
+		if (item != ep->export_map_list.next) {
+			dlist_remove(item);
+			dlist_insert_head(item, &ep->export_map_list);
+		}
+		return map->size >= size ? map->base : NULL;
+	}
+
+	smr_export_name(name, pid, id);
+	fd = shm_open(name, O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_DATA, "shm_open error (%s): %s\n",
+			name, strerror(errno));
+		return NULL;
+	}
+
+	if (fstat(fd, &st) || (size_t) st.st_size < size) {
+		FI_WARN(&smr_prov, FI_LOG_EP_DATA,
+			"export buffer %s is smaller than expected\n", name);
+		close(fd);
+		return NULL;
+	}
+
+	base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		FI_WARN(&smr_prov, FI_LOG_EP_DATA, "mmap error: %s\n",
+			strerror(errno));
+		return NULL;
+	}
+
+	map = malloc(sizeof(*map));
+	if (!map) {
+		munmap(base, size);
+		return NULL;
+	}
+
+	map->pid = pid;
+	map->id = id;
+	map->base = base;
+	map->size = size;
+	map->rkey = false;
+	dlist_insert_head(&map->entry, &ep->export_map_list);
+	return base;
+}
+
+static struct smr_export_map_entry *
+smr_export_rkey_open(struct smr_ep *ep, pid_t pid, uint64_t key)
+{
+	struct smr_export_map_entry *map;
+	char name[SMR_NAME_MAX];
+	size_t page_size = ofi_get_page_size();
+	struct stat st;
+	int fd;
+
+	map = malloc(sizeof(*map));
+	if (!map)
+		return NULL;
+
+	map->pid = pid;
+	map->id = key;
+	map->base = NULL;
+	map->size = 0;
+	map->rkey = true;
+
+	smr_export_rkey_name(name, pid, key);
+	fd = shm_open(name, O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd >= 0) {
+		if (!fstat(fd, &st) && st.st_size > page_size &&
+		    !(st.st_size % page_size)) {
+			map->base = mmap(NULL, st.st_size,
+					 PROT_READ | PROT_WRITE, MAP_SHARED,
+					 fd, 0);
+			if (map->base == MAP_FAILED)
+				map->base = NULL;
+			else
+				map->size = st.st_size;
+		}
+		close(fd);
+	}
+
+	dlist_insert_head(&map->entry, &ep->export_map_list);
+	return map;
+}
+
+static struct smr_export_info *
+smr_export_rkey_info(struct smr_export_map_entry *map, uint64_t key)
+{
+	struct smr_export_info *info;
+
+	if (!map->base)
+		return NULL;
+
+	info = (struct smr_export_info *) ((char *) map->base + map->size -
+					   ofi_get_page_size());
+	return info->magic == SMR_EXPORT_MAGIC && info->key == key &&
+	       info->len <= map->size - ofi_get_page_size() ? info : NULL;
+}
+
+/* Translate a remote address and key of the peer to a local pointer, if
+ * the key belongs to one of its export buffers.  A closed buffer is
+ * remapped once in case its key was given to a new buffer.
+ */
+void *smr_export_rkey(struct smr_ep *ep, pid_t pid, uint64_t key,
+		      uint64_t addr, size_t len, uint64_t access)
+{
+	struct smr_export_map_entry *map = NULL;
+	struct smr_export_info *info;
+	struct dlist_entry *item;
+	uint64_t offset;
+
+	dlist_foreach(&ep->export_map_list, item) {
+		map = container_of(item, struct smr_export_map_entry, entry);
+		if (map->rkey && map->id == key && map->pid == pid)
+			break;
+		map = NULL;
+	}
+
+	if (!map)
+		map = smr_export_rkey_open(ep, pid, key);
+	if (!map)
+		return NULL;
+
+	info = smr_export_rkey_info(map, key);
+	if (!info && map->base) {
+		dlist_remove(&map->entry);
+		munmap(map->base, map->size);
+		free(map);
+		map = smr_export_rkey_open(ep, pid, key);
+		if (!map)
+			return NULL;
+		info = smr_export_rkey_info(map, key);
+	}
+	if (!info || (info->access & access) != access)
+		return NULL;
+
+	offset = addr - info->addr_base;
+	if (offset > info->len || len > info->len - offset)
+		return NULL;
+
+	return (char *) map->base + offset;
+}
+
+void smr_export_cleanup(struct smr_ep *ep)
+{
+	struct smr_export_map_entry *map;
+
+	while (!dlist_empty(&ep->export_map_list)) {
+		dlist_pop_front(&ep->export_map_list,
+				struct smr_export_map_entry, map, entry);
+		if (map->base)
+			munmap(map->base, map->size);
+		free(map);
+	}
+}
@@ -32,9 +32,187 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sched.h>
 
 #include "smr.h"
 
+/*
+ * FI_WAIT_YIELD wait set.  Like the util yield wait it runs progress on
+ * every endpoint attached to it, but when it serves a single endpoint it
+ * stops yielding after SMR_WAIT_SPIN idle passes and sleeps on the
+ * endpoint region's doorbell, which peers ring after posting work.  The
+ * sleep is bounded by SMR_WAIT_SLEEP_MAX ms so a missed doorbell can only
+ * delay progress.
+ */
+#define SMR_WAIT_SPIN		64
+#define SMR_WAIT_SLEEP_MAX	10
+
+struct smr_wait {
+	struct util_wait	util_wait;
+	ofi_atomic32_t		signal;
+	/* region being slept on, so local signals can ring it */
+	ofi_atomic64_t		sleeper;
+};
+
+static void smr_wait_signal(struct util_wait *util_wait)
+{
+	struct smr_wait *wait;
+	struct smr_region *region;
+
+	wait = container_of(util_wait, struct smr_wait, util_wait);
+	ofi_atomic_set32(&wait->signal, 1);
+	ofi_mb();
+
+	region = (struct smr_region *) (uintptr_t)
+		 ofi_atomic_get64(&wait->sleeper);
+	if (region)
+		smr_ring_doorbell(region);
+}
+
+/* Progress every attached endpoint.  region returns the endpoint's region
+ * if it is the only one. */
+static int smr_wait_try(struct smr_wait *wait, struct smr_region **region)
+{
+	struct ofi_wait_fid_entry *fid_entry;
+	struct smr_ep *ep = NULL;
+	int ret = 0, cnt = 0;
+
+	ofi_mutex_lock(&wait->util_wait.lock);
+	dlist_foreach_container(&wait->util_wait.fid_list,
+				struct ofi_wait_fid_entry, fid_entry, entry) {
+		ret = fid_entry->wait_try(fid_entry->fid);
+		if (ret)
+			break;
+		if (fid_entry->fid->fclass == FI_CLASS_EP)
+			ep = container_of(fid_entry->fid, struct smr_ep,
+					  util_ep.ep_fid.fid);
+		cnt++;
+	}
+	ofi_mutex_unlock(&wait->util_wait.lock);
+
+	if (region)
+		*region = (cnt == 1 && ep) ? ep->region : NULL;
+	return ret;
+}
+
+static int smr_wait_sleep(struct smr_wait *wait, struct smr_region *region,
+			  int timeout)
+{
+	int32_t doorbell;
+	int ret;
+
+	ofi_atomic_set64(&wait->sleeper, (uintptr_t) region);
+	ofi_atomic_inc32(&region->waiters);
+	ofi_mb();
+	doorbell = ofi_atomic_load_explicit32(&region->doorbell,
+					      memory_order_acquire);
+
+	/* Pick up anything posted before waiters was raised */
+	ret = smr_wait_try(wait, NULL);
+	if (!ret && !ofi_atomic_get32(&wait->signal)) {
+		if (timeout < 0 || timeout > SMR_WAIT_SLEEP_MAX)
+			timeout = SMR_WAIT_SLEEP_MAX;
+		smr_doorbell_wait(region, doorbell, timeout);
+	}
+
+	ofi_atomic_dec32(&region->waiters);
+	ofi_atomic_set64(&wait->sleeper, 0);
+	return ret;
+}
+
+static int smr_wait_run(struct fid_wait *wait_fid, int timeout)
+{
+	struct smr_wait *wait;
+	struct smr_region *region;
+	uint64_t endtime;
+	int ret, idle = 0;
+
+	wait = container_of(wait_fid, struct smr_wait, util_wait.wait_fid);
+	endtime = ofi_timeout_time(timeout);
+
+	while (!ofi_atomic_get32(&wait->signal)) {
+		if (ofi_adjust_timeout(endtime, &timeout))
+			return -FI_ETIMEDOUT;
+
+		ret = smr_wait_try(wait, &region);
+		if (ret)
+			return ret;
+
+		if (!region || ++idle < SMR_WAIT_SPIN) {
+			sched_yield();
+			continue;
+		}
+
+		ret = smr_wait_sleep(wait, region, timeout);
+		if (ret)
+			return ret;
+	}
+
+	ofi_atomic_set32(&wait->signal, 0);
+	return FI_SUCCESS;
+}
+
+static int smr_wait_close(struct fid *fid)
+{
+	struct smr_wait *wait;
+	int ret;
+
+	wait = container_of(fid, struct smr_wait, util_wait.wait_fid.fid);
+	ret = fi_wait_cleanup(&wait->util_wait);
+	if (ret)
+		return ret;
+
+	free(wait);
+	return 0;
+}
+
+static struct fi_ops_wait smr_wait_ops = {
+	.size = sizeof(struct fi_ops_wait),
+	.wait = smr_wait_run,
+};
+
+static struct fi_ops smr_wait_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = smr_wait_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+static int smr_wait_yield_open(struct fid_fabric *fabric_fid,
+			       struct fi_wait_attr *attr,
+			       struct fid_wait **waitset)
+{
+	struct util_fabric *fabric;
+	struct smr_wait *wait;
+	int ret;
+
+	fabric = container_of(fabric_fid, struct util_fabric, fabric_fid);
+	ret = ofi_check_wait_attr(fabric->prov, attr);
+	if (ret)
+		return ret;
+
+	attr->wait_obj = FI_WAIT_YIELD;
+	wait = calloc(1, sizeof(*wait));
+	if (!wait)
+		return -FI_ENOMEM;
+
+	ret = ofi_wait_init(fabric, attr, &wait->util_wait);
+	if (ret) {
+		free(wait);
+		return ret;
+	}
+
+	ofi_atomic_initialize32(&wait->signal, 0);
+	ofi_atomic_initialize64(&wait->sleeper, 0);
+	wait->util_wait.signal = smr_wait_signal;
+	wait->util_wait.wait_fid.fid.ops = &smr_wait_fi_ops;
+	wait->util_wait.wait_fid.ops = &smr_wait_ops;
+
+	*waitset = &wait->util_wait.wait_fid;
+	return 0;
+}
+
 static int smr_wait_open(struct fid_fabric *fabric_fid,
 			 struct fi_wait_attr *attr,
 			 struct fid_wait **waitset)
@@ -42,7 +220,7 @@ static int smr_wait_open(struct fid_fabric *fabric_fid,
 	switch (attr->wait_obj) {
 	case FI_WAIT_UNSPEC:
 	case FI_WAIT_YIELD:
-		return ofi_wait_yield_open(fabric_fid, attr, waitset);
+		return smr_wait_yield_open(fabric_fid, attr, waitset);
 	case FI_WAIT_FD:
 		return ofi_wait_fd_open(fabric_fid, attr, waitset);
 	default:
@@ -43,9 +43,15 @@ struct sigaction *old_action = NULL;
 struct smr_env smr_env = {
 	.sar_threshold = SIZE_MAX,
 	.disable_cma = false,
-	.use_dsa_sar = false,
+	.use_dsa_sar = true,
+	.dsa_threshold = 2 * SMR_SAR_SIZE,
 	.max_gdrcopy_size = 3072,
 	.use_xpmem = false,
+	.max_peers = SMR_DEF_PEERS,
+	.peer_queue_size = 0,
+	.probe_vma = true,
+	.numa_bind = false,
+	.direct_atomic = false,
 };
 
 static void smr_init_env(void)
@@ -55,7 +61,22 @@ static void smr_init_env(void)
 	fi_param_get_size_t(&smr_prov, "rx_size", &smr_info.rx_attr->size);
 	fi_param_get_bool(&smr_prov, "disable_cma", &smr_env.disable_cma);
 	fi_param_get_bool(&smr_prov, "use_dsa_sar", &smr_env.use_dsa_sar);
+	fi_param_get_size_t(&smr_prov, "dsa_threshold", &smr_env.dsa_threshold);
 	fi_param_get_bool(&smr_prov, "use_xpmem", &smr_env.use_xpmem);
+
+	smr_env.max_peers = MAX(SMR_DEF_PEERS,
+				ofi_sysconf(_SC_NPROCESSORS_ONLN));
+	fi_param_get_size_t(&smr_prov, "max_peers", &smr_env.max_peers);
+	smr_env.max_peers = MIN(MAX(smr_env.max_peers, 1), SMR_MAX_PEERS);
+	fi_param_get_size_t(&smr_prov, "peer_queue_size",
+			    &smr_env.peer_queue_size);
+	/* The atomic queue cannot tell a full slot from a free one with
+	 * a single entry */
+	if (smr_env.peer_queue_size == 1)
+		smr_env.peer_queue_size = 2;
+	fi_param_get_bool(&smr_prov, "probe_vma", &smr_env.probe_vma);
+	fi_param_get_bool(&smr_prov, "numa_bind", &smr_env.numa_bind);
+	fi_param_get_bool(&smr_prov, "direct_atomic", &smr_env.direct_atomic);
 }
 
 static void smr_resolve_addr(const char *node, const char *service,
@@ -89,7 +110,8 @@ static void smr_resolve_addr(const char *node, const char *service,
  * need under /dev/shm.
  * Here we use #core instead of SMR_MAX_PEERS, as it is the most likely
  * value and has less possibility of failing fi_getinfo calls that are
- * currently passing, and breaking currently working app
+ * currently passing, and breaking currently working app.  Each region
+ * is sized for the default peer table capacity.
  */
 static int smr_shm_space_check(size_t tx_count, size_t rx_count)
 {
@@ -107,9 +129,10 @@ static int smr_shm_space_check(size_t tx_count, size_t rx_count)
 	}
 	shm_size_needed = num_of_core *
 			  smr_calculate_size_offsets(tx_count, rx_count,
-						     NULL, NULL, NULL,
-						     NULL, NULL, NULL,
-						     NULL);
+						     smr_env.max_peers,
+						     smr_env.peer_queue_size,
+						     NULL, NULL, NULL, NULL,
+						     NULL, NULL, NULL, NULL);
 	err = statvfs(shm_fs, &stat);
 	if (err) {
 		FI_WARN(&smr_prov, FI_LOG_CORE,
@@ -218,7 +241,11 @@ SHM_INI
 	fi_param_define(&smr_prov, "disable_cma", FI_PARAM_BOOL,
 			"Manually disables CMA. Default: false");
 	fi_param_define(&smr_prov, "use_dsa_sar", FI_PARAM_BOOL,
-			"Enable use of DSA in SAR protocol. Default: false");
+			"Use DSA in SAR protocol when a DSA device is "
+			"available. Default: true");
+	fi_param_define(&smr_prov, "dsa_threshold", FI_PARAM_SIZE_T,
+			"Smallest SAR transfer copied by DSA instead of the "
+			"CPU. Default: 65536");
 	fi_param_define(&smr_prov, "enable_dsa_page_touch", FI_PARAM_BOOL,
 			"Enable CPU touching of memory pages in DSA command \
 			 descriptor when page fault is reported. \
@@ -226,8 +253,31 @@ SHM_INI
 	fi_param_define(&smr_prov, "use_xpmem", FI_PARAM_BOOL,
 			"Enable XPMEM over CMA when possible "
 			"(default: false)");
+	fi_param_define(&smr_prov, "max_peers", FI_PARAM_SIZE_T,
+			"Number of peers an address vector and the endpoints "
+			"bound to it size their peer tables for, unless the "
+			"AV count is larger (default: number of cores, at "
+			"least 256, at most 16384)");
+	fi_param_define(&smr_prov, "peer_queue_size", FI_PARAM_SIZE_T,
+			"Number of commands in the queue each endpoint "
+			"keeps for every connected peer, so senders do not "
+			"share one command queue.  0 uses the shared queue "
+			"only (default: 0)");
+	fi_param_define(&smr_prov, "probe_vma", FI_PARAM_BOOL,
+			"Time CMA/xpmem against SAR when connecting to a "
+			"peer and use SAR for messages up to the size where "
+			"it is faster (default: true)");
+	fi_param_define(&smr_prov, "numa_bind", FI_PARAM_BOOL,
+			"Place each endpoint's region on the owner's NUMA "
+			"node and interleave its SAR buffers across nodes "
+			"with mbind (default: false)");
+	fi_param_define(&smr_prov, "direct_atomic", FI_PARAM_BOOL,
+			"Run atomics targeting a peer's export buffer "
+			"directly on the mapped buffer with CPU atomics, "
+			"without involving the peer (default: false)");
 
 	smr_init_env();
+	ofi_atomic_initialize64(&smr_export_id, ofi_gettime_ns());
 
 	if (smr_env.use_dsa_sar)
 		smr_dsa_init();
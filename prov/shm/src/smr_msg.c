@@ -99,29 +99,38 @@ static ssize_t smr_generic_sendmsg(struct smr_ep *ep, const struct iovec *iov,
 	peer_id = smr_peer_data(ep->region)[id].addr.id;
 	peer_smr = smr_peer_region(ep->region, id);
 
-	if (smr_peer_data(ep->region)[id].sar_status)
+	if (smr_peer_data(ep->region)[id].sar_status) {
+		ep->stats.sar_stall++;
 		return -FI_EAGAIN;
+	}
 
-	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
-	if (ret == -FI_ENOENT)
+	ret = smr_cmd_queue_next(smr_peer_tx_queue(peer_smr, peer_id), &ce, &pos);
+	if (ret == -FI_ENOENT) {
+		ep->stats.queue_full++;
 		return -FI_EAGAIN;
+	}
 
 	ofi_genlock_lock(&ep->util_ep.lock);
 
 	total_len = ofi_total_iov_len(iov, iov_count);
 	assert(!(op_flags & FI_INJECT) || total_len <= SMR_INJECT_SIZE);
 
-	proto = smr_select_proto(desc, iov_count, smr_vma_enabled(ep, peer_smr),
-	                         op, total_len, op_flags);
+	proto = smr_select_proto(desc, iov_count,
+				 smr_vma_preferred(ep, peer_smr, id, total_len),
+				 op, total_len, op_flags);
 
 	ret = smr_proto_ops[proto](ep, peer_smr, id, peer_id, op, tag, data, op_flags,
 				   (struct ofi_mr **)desc, iov, iov_count, total_len,
 				   context, &ce->cmd);
 	if (ret) {
 		smr_cmd_queue_discard(ce, pos);
+		if (ret == -FI_EAGAIN)
+			ep->stats.queue_full++;
 		goto unlock;
 	}
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
+	smr_stat_tx(ep, proto, total_len);
 
 	if (proto != smr_src_inline && proto != smr_src_inject)
 		goto unlock;
@@ -203,21 +212,28 @@ static ssize_t smr_generic_inject(struct fid_ep *ep_fid, const void *buf,
 	peer_id = smr_peer_data(ep->region)[id].addr.id;
 	peer_smr = smr_peer_region(ep->region, id);
 
-	if (smr_peer_data(ep->region)[id].sar_status)
+	if (smr_peer_data(ep->region)[id].sar_status) {
+		ep->stats.sar_stall++;
 		return -FI_EAGAIN;
+	}
 
-	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
-	if (ret == -FI_ENOENT)
+	ret = smr_cmd_queue_next(smr_peer_tx_queue(peer_smr, peer_id), &ce, &pos);
+	if (ret == -FI_ENOENT) {
+		ep->stats.queue_full++;
 		return -FI_EAGAIN;
+	}
 
 	proto = len <= SMR_MSG_DATA_LEN ? smr_src_inline : smr_src_inject;
 	ret = smr_proto_ops[proto](ep, peer_smr, id, peer_id, op, tag, data,
 			op_flags, NULL, &msg_iov, 1, len, NULL, &ce->cmd);
 	if (ret) {
 		smr_cmd_queue_discard(ce, pos);
+		ep->stats.queue_full++;
 		return -FI_EAGAIN;
 	}
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
+	smr_stat_tx(ep, proto, len);
 	ofi_ep_peer_tx_cntr_inc(&ep->util_ep, op);
 
 	return FI_SUCCESS;
@@ -51,13 +51,14 @@ smr_try_progress_to_sar(struct smr_ep *ep, struct smr_region *smr,
                         size_t *bytes_done, void *entry_ptr)
 {
 	if (*bytes_done < cmd->msg.hdr.size) {
-		if (smr_env.use_dsa_sar && ofi_mr_all_host(mr, iov_count)) {
+		if (smr_sar_segs(cmd) == 1 &&
+		    smr_dsa_preferred(cmd->msg.hdr.size, mr, iov_count)) {
 			(void) smr_dsa_copy_to_sar(ep, sar_pool, resp, cmd, iov,
 					    iov_count, bytes_done, entry_ptr);
 			return;
-		} else {
-			smr_copy_to_sar(sar_pool, resp, cmd, mr, iov, iov_count,
-					bytes_done);
+		} else if (smr_copy_to_sar(sar_pool, resp, cmd, mr, iov,
+					   iov_count, bytes_done)) {
+			smr_ring_doorbell(smr);
 		}
 	}
 }
@@ -70,13 +71,14 @@ smr_try_progress_from_sar(struct smr_ep *ep, struct smr_region *smr,
                           size_t *bytes_done, void *entry_ptr)
 {
 	if (*bytes_done < cmd->msg.hdr.size) {
-		if (smr_env.use_dsa_sar && ofi_mr_all_host(mr, iov_count)) {
+		if (smr_sar_segs(cmd) == 1 &&
+		    smr_dsa_preferred(cmd->msg.hdr.size, mr, iov_count)) {
 			(void) smr_dsa_copy_from_sar(ep, sar_pool, resp, cmd,
 					iov, iov_count, bytes_done, entry_ptr);
 			return;
-		} else {
-			smr_copy_from_sar(sar_pool, resp, cmd, mr,
-					  iov, iov_count, bytes_done);
+		} else if (smr_copy_from_sar(sar_pool, resp, cmd, mr,
+					     iov, iov_count, bytes_done)) {
+			smr_ring_doorbell(smr);
 		}
 	}
 }
@@ -96,6 +98,7 @@ static int smr_progress_resp_entry(struct smr_ep *ep, struct smr_resp *resp,
 
 	switch (pending->cmd.msg.hdr.op_src) {
 	case smr_src_iov:
+	case smr_src_export:
 		break;
 	case smr_src_ipc:
 		assert(pending->mr[0]);
@@ -107,7 +110,8 @@ static int smr_progress_resp_entry(struct smr_ep *ep, struct smr_resp *resp,
 		    smr_sar_pool(peer_smr), pending->cmd.msg.data.sar[0]);
 		if (pending->bytes_done == pending->cmd.msg.hdr.size &&
 		    (resp->status == SMR_STATUS_SAR_EMPTY ||
-		     resp->status == SMR_STATUS_SUCCESS)) {
+		     resp->status == SMR_STATUS_SUCCESS) &&
+		    smr_sar_drained(&pending->cmd, resp)) {
 			resp->status = SMR_STATUS_SUCCESS;
 			break;
 		}
@@ -125,7 +129,8 @@ static int smr_progress_resp_entry(struct smr_ep *ep, struct smr_resp *resp,
 					pending->iov_count, &pending->bytes_done,
 					pending);
 		if (pending->bytes_done != pending->cmd.msg.hdr.size ||
-		    resp->status != SMR_STATUS_SAR_EMPTY) {
+		    resp->status != SMR_STATUS_SAR_EMPTY ||
+		    !smr_sar_drained(&pending->cmd, resp)) {
 			return -FI_EAGAIN;
 		}
 
@@ -208,38 +213,102 @@ static int smr_progress_resp_entry(struct smr_ep *ep, struct smr_resp *resp,
 	return FI_SUCCESS;
 }
 
+/*
+ * Hand the queued tx completions to the owner of the CQ in one call.
+ * Entries that could not be written are kept and retried on the next
+ * pass, before any further response is taken off the queue.
+ */
+static int smr_flush_tx_comps(struct smr_ep *ep)
+{
+	ssize_t ret;
+	size_t done = 0;
+
+	while (done < ep->tx_comp_cnt) {
+		ret = ofi_peer_cq_writev(ep->util_ep.tx_cq,
+					 &ep->tx_comps[done],
+					 ep->tx_comp_cnt - done, NULL);
+		if (ret <= 0)
+			break;
+		done += ret;
+	}
+
+	if (done < ep->tx_comp_cnt) {
+		memmove(ep->tx_comps, &ep->tx_comps[done],
+			(ep->tx_comp_cnt - done) * sizeof(*ep->tx_comps));
+		ep->tx_comp_cnt -= done;
+		return -FI_EAGAIN;
+	}
+
+	ep->tx_comp_cnt = 0;
+	return FI_SUCCESS;
+}
+
 static void smr_progress_resp(struct smr_ep *ep)
 {
-	struct smr_resp *resp;
+	struct smr_resp_queue *resp_queue = smr_resp_queue(ep->region);
+	struct fi_cq_tagged_entry *comp;
+	struct smr_resp *resp, *next;
 	struct smr_tx_entry *pending;
 	int ret;
 
 	ofi_genlock_lock(&ep->util_ep.lock);
-	while (!ofi_cirque_isempty(smr_resp_queue(ep->region))) {
-		resp = ofi_cirque_head(smr_resp_queue(ep->region));
+	while (!ofi_cirque_isempty(resp_queue)) {
+		resp = ofi_cirque_head(resp_queue);
 		if (resp->status == SMR_STATUS_BUSY)
 			break;
 
+		/* Leave the response queued until its completion has room */
+		if (ep->tx_comp_cnt == SMR_COMP_BATCH &&
+		    smr_flush_tx_comps(ep)) {
+			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+				"unable to write tx completions\n");
+			break;
+		}
+
 		pending = (struct smr_tx_entry *) resp->msg_id;
+
+		/* The sender fills in every queued response, so the next
+		 * one's tx entry can be fetched while this one completes */
+		if (ofi_cirque_usedcnt(resp_queue) > 1) {
+			next = &resp_queue->buf[(resp_queue->rcnt + 1) &
+						resp_queue->size_mask];
+			OFI_PREFETCH((void *) (uintptr_t) next->msg_id);
+		}
+
 		if (smr_progress_resp_entry(ep, resp, pending, &resp->status))
 			break;
 
 		if (-resp->status) {
+			(void) smr_flush_tx_comps(ep);
 			ret = smr_write_err_comp(ep->util_ep.tx_cq, pending->context,
 					 pending->op_flags, pending->cmd.msg.hdr.tag,
 					 -(resp->status));
+			if (ret) {
+				FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+					"unable to process tx completion\n");
+				break;
+			}
 		} else {
-			ret = smr_complete_tx(ep, pending->context,
-					  pending->cmd.msg.hdr.op, pending->op_flags);
-		}
-		if (ret) {
-			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
-				"unable to process tx completion\n");
-			break;
+			ofi_ep_peer_tx_cntr_inc(&ep->util_ep,
+						pending->cmd.msg.hdr.op);
+			if (pending->op_flags & FI_COMPLETION) {
+				comp = &ep->tx_comps[ep->tx_comp_cnt++];
+				comp->op_context = pending->context;
+				comp->flags =
+					ofi_tx_cq_flags(pending->cmd.msg.hdr.op);
+				comp->len = 0;
+				comp->buf = NULL;
+				comp->data = 0;
+				comp->tag = 0;
+			}
 		}
+		smr_stat_resp(ep, pending);
 		ofi_freestack_push(ep->tx_fs, pending);
-		ofi_cirque_discard(smr_resp_queue(ep->region));
+		ofi_cirque_discard(resp_queue);
 	}
+	if (ep->tx_comp_cnt && smr_flush_tx_comps(ep))
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"unable to write tx completions\n");
 	ofi_genlock_unlock(&ep->util_ep.lock);
 }
 
@@ -250,7 +319,7 @@ static int smr_progress_inline(struct smr_cmd *cmd, struct ofi_mr **mr,
 	ssize_t hmem_copy_ret;
 
 	hmem_copy_ret = ofi_copy_to_mr_iov(mr, iov, iov_count, 0,
-				cmd->msg.data.msg, cmd->msg.hdr.size);
+				smr_inline_data(cmd), cmd->msg.hdr.size);
 	if (hmem_copy_ret < 0) {
 		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
 			"inline recv failed with code %d\n",
@@ -328,8 +397,10 @@ static int smr_progress_iov(struct smr_cmd *cmd, struct iovec *iov,
 			       cmd->msg.data.iov_count, cmd->msg.hdr.size,
 			       peer_smr->pid, cmd->msg.hdr.op == ofi_op_read_req,
 			       xpmem);
-	if (!ret)
+	if (!ret) {
 		*total_len = cmd->msg.hdr.size;
+		ep->stats.cma_bytes += cmd->msg.hdr.size;
+	}
 
 out:
 	//Status must be set last (signals peer: op done, valid resp entry)
@@ -338,6 +409,60 @@ out:
 	return -ret;
 }
 
+static int smr_progress_export(struct smr_cmd *cmd, struct ofi_mr **mr,
+			       struct iovec *iov, size_t iov_count,
+			       size_t *total_len, struct smr_ep *ep)
+{
+	struct smr_region *peer_smr;
+	struct smr_resp *resp;
+	ssize_t hmem_copy_ret;
+	uint8_t *base;
+	int ret = 0;
+
+	peer_smr = smr_peer_region(ep->region, cmd->msg.hdr.id);
+	resp = smr_get_ptr(peer_smr, cmd->msg.hdr.src_data);
+
+	if (cmd->msg.data.export_offset > cmd->msg.data.export_size ||
+	    cmd->msg.hdr.size > cmd->msg.data.export_size -
+				cmd->msg.data.export_offset) {
+		ret = -FI_EINVAL;
+		goto out;
+	}
+
+	base = smr_export_map(ep, peer_smr->pid, cmd->msg.data.export_id,
+			      cmd->msg.data.export_size);
+	if (!base) {
+		ret = -FI_EIO;
+		goto out;
+	}
+	base += cmd->msg.data.export_offset;
+
+	if (cmd->msg.hdr.op == ofi_op_read_req)
+		hmem_copy_ret = ofi_copy_from_mr_iov(base, cmd->msg.hdr.size,
+						     mr, iov, iov_count, 0);
+	else
+		hmem_copy_ret = ofi_copy_to_mr_iov(mr, iov, iov_count, 0,
+						   base, cmd->msg.hdr.size);
+
+	if (hmem_copy_ret < 0) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"export copy iov failed with code %d\n",
+			(int)(-hmem_copy_ret));
+		ret = hmem_copy_ret;
+	} else if (hmem_copy_ret != cmd->msg.hdr.size) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"export copy iov truncated\n");
+		ret = -FI_ETRUNC;
+	}
+	*total_len = hmem_copy_ret;
+
+out:
+	//Status must be set last (signals peer: op done, valid resp entry)
+	resp->status = ret;
+
+	return ret;
+}
+
 static int smr_mmap_peer_copy(struct smr_ep *ep, struct smr_cmd *cmd,
 			      struct ofi_mr **mr, struct iovec *iov,
 			      size_t iov_count, size_t *total_len)
@@ -482,6 +607,7 @@ smr_ipc_async_copy(struct smr_ep *ep, void *ptr,
 	struct smr_pend_entry *ipc_entry;
 	enum fi_hmem_iface iface = cmd->msg.data.ipc_info.iface;
 	uint64_t device = cmd->msg.data.ipc_info.device;
+	size_t size, chunks, chunk_size, offset, len;
 	int ret;
 
 	ipc_entry = ofi_buf_alloc(ep->pend_buf_pool);
@@ -504,19 +630,29 @@ smr_ipc_async_copy(struct smr_ep *ep, void *ptr,
 	if (ret < 0)
 		goto fail;
 
-	if (cmd->msg.hdr.op == ofi_op_read_req) {
-		ret = ofi_async_copy_from_hmem_iov(ptr, cmd->msg.hdr.size,
-						iface, device, iov, iov_count, 0,
-						ipc_entry->async_event);
-	} else {
-		ret = ofi_async_copy_to_hmem_iov(iface, device, iov, iov_count, 0,
-						ptr, cmd->msg.hdr.size,
-						ipc_entry->async_event);
+	size = cmd->msg.hdr.size;
+	chunks = iov_count == 1 ?
+		 MIN(MAX_NUM_ASYNC_OP, size / SMR_IPC_CHUNK_MIN) : 0;
+	chunk_size = chunks > 1 ? ofi_get_aligned_size(
+				(size + chunks - 1) / chunks, 64) : size;
+
+	for (offset = 0; offset < size; offset += chunk_size) {
+		len = MIN(chunk_size, size - offset);
+		if (cmd->msg.hdr.op == ofi_op_read_req) {
+			ret = ofi_async_copy_from_hmem_iov(
+					(char *) ptr + offset, len, iface,
+					device, iov, iov_count, offset,
+					ipc_entry->async_event);
+		} else {
+			ret = ofi_async_copy_to_hmem_iov(iface, device, iov,
+					iov_count, offset,
+					(char *) ptr + offset, len,
+					ipc_entry->async_event);
+		}
+		if (ret < 0)
+			goto fail;
 	}
 
-	if (ret < 0)
-		goto fail;
-
 	dlist_insert_tail(&ipc_entry->entry, &ep->ipc_cpy_pend_list);
 	*pend = ipc_entry;
 
@@ -670,7 +806,7 @@ static int smr_progress_inline_atomic(struct smr_cmd *cmd, struct ofi_mr **mr,
 			struct fi_ioc *ioc, size_t ioc_count, size_t *len)
 {
 	int i;
-	uint8_t *src = cmd->msg.data.msg;
+	uint8_t *src = smr_inline_data(cmd);
 
 	assert(cmd->msg.hdr.op == ofi_op_atomic);
 
@@ -766,6 +902,12 @@ static int smr_start_common(struct smr_ep *ep, struct smr_cmd *cmd,
 					rx_entry->iov, rx_entry->count,
 					&total_len, ep);
 		break;
+	case smr_src_export:
+		err = smr_progress_export(cmd,
+				(struct ofi_mr **) rx_entry->desc,
+				rx_entry->iov, rx_entry->count, &total_len,
+				ep);
+		break;
 	case smr_src_sar:
 		pend = smr_progress_sar(cmd, rx_entry,
 				       (struct ofi_mr **) rx_entry->desc,
@@ -819,6 +961,14 @@ static int smr_copy_saved(struct smr_cmd_ctx *cmd_ctx,
 	uint64_t comp_flags;
 	int ret;
 
+	if (cmd_ctx->tx_buf) {
+		bytes = ofi_copy_to_mr_iov((struct ofi_mr **) rx_entry->desc,
+				rx_entry->iov, rx_entry->count, 0,
+				cmd_ctx->tx_buf->buf,
+				cmd_ctx->cmd.msg.hdr.size);
+		smr_release_held_txbuf(cmd_ctx);
+	}
+
 	while (!slist_empty(&cmd_ctx->buf_list)) {
 		slist_remove_head_container(&cmd_ctx->buf_list,
 				struct smr_unexp_buf, sar_buf, entry);
@@ -876,6 +1026,8 @@ int smr_unexp_start(struct fi_peer_rx_entry *rx_entry)
 	else
 		ret = smr_start_common(cmd_ctx->ep, &cmd_ctx->cmd, rx_entry);
 
+	smr_ring_doorbell(smr_peer_region(cmd_ctx->ep->region,
+					  cmd_ctx->cmd.msg.hdr.id));
 	ofi_buf_free(cmd_ctx);
 
 	return ret;
@@ -894,9 +1046,13 @@ static void smr_progress_connreq(struct smr_ep *ep, struct smr_cmd *cmd)
 
 	ret = smr_map_add(&smr_prov, ep->region->map,
 			  (char *) tx_buf->data, &idx);
-	if (ret)
+	if (!ret && ep->region->map->peers[idx].peer.id < 0)
+		ret = smr_map_to_region(&smr_prov, ep->region->map, idx);
+	if (ret) {
 		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
 			"Error processing mapping request\n");
+		goto out;
+	}
 
 	peer_smr = smr_peer_region(ep->region, idx);
 
@@ -904,16 +1060,34 @@ static void smr_progress_connreq(struct smr_ep *ep, struct smr_cmd *cmd)
 		//TODO track and update/complete in error any transfers
 		//to or from old mapping
 		munmap(peer_smr, peer_smr->total_size);
-		smr_map_to_region(&smr_prov, ep->region->map, idx);
+		ep->region->map->peers[idx].region = NULL;
+		ret = smr_map_to_region(&smr_prov, ep->region->map, idx);
+		if (ret) {
+			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+				"Error remapping peer region\n");
+			goto out;
+		}
 		peer_smr = smr_peer_region(ep->region, idx);
 	}
+
+	if (cmd->msg.hdr.id < 0 ||
+	    cmd->msg.hdr.id >= peer_smr->max_peers) {
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"Peer id %d out of range\n", cmd->msg.hdr.id);
+		goto out;
+	}
+
+	if (ep->region->peer_queue_size)
+		smr_add_peer_queue(ep, idx);
+
 	smr_peer_data(peer_smr)[cmd->msg.hdr.id].addr.id = idx;
 	smr_peer_data(ep->region)[idx].addr.id = cmd->msg.hdr.id;
 
-	smr_release_txbuf(ep->region, tx_buf);
 	assert(ep->region->map->num_peers > 0);
-	ep->region->max_sar_buf_per_peer = SMR_MAX_PEERS /
-		ep->region->map->num_peers;
+	ep->region->max_sar_buf_per_peer =
+		smr_sar_bufs_per_peer(ep->region->map->num_peers);
+out:
+	smr_release_txbuf(ep->region, tx_buf);
 }
 
 static int smr_alloc_cmd_ctx(struct smr_ep *ep,
@@ -931,6 +1105,7 @@ static int smr_alloc_cmd_ctx(struct smr_ep *ep,
 		return -FI_ENOMEM;
 	}
 	cmd_ctx->ep = ep;
+	cmd_ctx->tx_buf = NULL;
 
 	rx_entry->size = cmd->msg.hdr.size;
 	if (cmd->msg.hdr.op_flags & SMR_REMOTE_CQ_DATA) {
@@ -939,22 +1114,28 @@ static int smr_alloc_cmd_ctx(struct smr_ep *ep,
 	}
 
 	if (cmd->msg.hdr.op_src == smr_src_inline) {
-		memcpy(&cmd_ctx->cmd, cmd, sizeof(cmd->msg.hdr) + cmd->msg.hdr.size);
+		memcpy(&cmd_ctx->cmd, cmd,
+		       SMR_INLINE_OFFSET + cmd->msg.hdr.size);
 	} else if (cmd->msg.hdr.op_src == smr_src_inject) {
 		memcpy(&cmd_ctx->cmd, cmd, sizeof(cmd->msg.hdr));
-		buf = ofi_buf_alloc(ep->unexp_buf_pool);
-		if (!buf) {
-			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
-				"Error allocating buffer\n");
-			ofi_buf_free(cmd_ctx);
-			return -FI_ENOMEM;
-		}
 		cmd_ctx->sar_entry = NULL;
 		slist_init(&cmd_ctx->buf_list);
-		slist_insert_tail(&buf->entry, &cmd_ctx->buf_list);
 		tx_buf = smr_get_ptr(ep->region, (size_t) cmd->msg.hdr.src_data);
-		memcpy(buf->buf, tx_buf->buf, cmd->msg.hdr.size);
-		smr_release_txbuf(ep->region, tx_buf);
+		if (smr_hold_txbuf(ep, cmd->msg.hdr.id)) {
+			ep->unexp_inject_cnt[cmd->msg.hdr.id]++;
+			cmd_ctx->tx_buf = tx_buf;
+		} else {
+			buf = ofi_buf_alloc(ep->unexp_buf_pool);
+			if (!buf) {
+				FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+					"Error allocating buffer\n");
+				ofi_buf_free(cmd_ctx);
+				return -FI_ENOMEM;
+			}
+			slist_insert_tail(&buf->entry, &cmd_ctx->buf_list);
+			memcpy(buf->buf, tx_buf->buf, cmd->msg.hdr.size);
+			smr_release_txbuf(ep->region, tx_buf);
+		}
 	} else if (cmd->msg.hdr.op_src == smr_src_sar) {
 		memcpy(&cmd_ctx->cmd, cmd, sizeof(*cmd));
 		slist_init(&cmd_ctx->buf_list);
@@ -1092,6 +1273,10 @@ static int smr_progress_cmd_rma(struct smr_ep *ep, struct smr_cmd *cmd,
 		err = smr_progress_mmap(cmd, mr, iov, iov_count, &total_len,
 					ep);
 		break;
+	case smr_src_export:
+		err = smr_progress_export(cmd, mr, iov, iov_count, &total_len,
+					  ep);
+		break;
 	case smr_src_sar:
 		if (smr_progress_sar(cmd, NULL, mr, iov, iov_count, &total_len,
 				     ep))
@@ -1115,9 +1300,9 @@ static int smr_progress_cmd_rma(struct smr_ep *ep, struct smr_cmd *cmd,
 					 smr_rx_cq_flags(cmd->msg.hdr.op, 0,
 					 cmd->msg.hdr.op_flags), 0, err);
 	} else {
-		ret = smr_complete_rx(ep, (void *) cmd->msg.hdr.msg_id,
-			      cmd->msg.hdr.op, smr_rx_cq_flags(cmd->msg.hdr.op,
-			      0, cmd->msg.hdr.op_flags), total_len,
+		ret = smr_complete_rx(ep, NULL, cmd->msg.hdr.op,
+			      smr_rx_cq_flags(cmd->msg.hdr.op, 0,
+			      cmd->msg.hdr.op_flags), total_len,
 			      iov_count ? iov[0].iov_base : NULL,
 			      cmd->msg.hdr.id, 0, cmd->msg.hdr.data);
 	}
@@ -1216,12 +1401,78 @@ out:
 	return err;
 }
 
-static void smr_progress_cmd(struct smr_ep *ep)
+static int smr_progress_cmd_entry(struct smr_ep *ep,
+				  struct smr_cmd_entry *ce)
 {
-	struct smr_cmd_entry *ce;
-	int ret = 0;
+	switch (ce->cmd.msg.hdr.op) {
+	case ofi_op_msg:
+	case ofi_op_tagged:
+		return smr_progress_cmd_msg(ep, &ce->cmd);
+	case ofi_op_write:
+	case ofi_op_read_req:
+		return smr_progress_cmd_rma(ep, &ce->cmd, &ce->rma_cmd);
+	case ofi_op_write_async:
+	case ofi_op_read_async:
+		ofi_ep_peer_rx_cntr_inc(&ep->util_ep, ce->cmd.msg.hdr.op);
+		return 0;
+	case ofi_op_atomic:
+	case ofi_op_atomic_fetch:
+	case ofi_op_atomic_compare:
+		return smr_progress_cmd_atomic(ep, &ce->cmd, &ce->rma_cmd);
+	case SMR_OP_MAX + ofi_ctrl_connreq:
+		smr_progress_connreq(ep, &ce->cmd);
+		return 0;
+	default:
+		FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+			"unidentified operation type\n");
+		return -FI_EINVAL;
+	}
+}
+
+/* Commands are claimed in batches so that a burst costs one update of the
+ * queue's read position, and the next command is fetched while the
+ * current one is handled.  Claimed commands are always handled, so an
+ * error only stops the claiming of further batches.
+ */
+static void smr_progress_cmd_queue(struct smr_ep *ep,
+				   struct smr_cmd_queue *queue)
+{
+	struct smr_cmd_entry *ce[SMR_CMD_BATCH];
+	int i, cnt, ret, err = 0;
 	int64_t pos;
 
+	while (!err) {
+		cnt = smr_cmd_queue_head_batch(queue, ce, &pos, SMR_CMD_BATCH);
+		if (!cnt)
+			break;
+
+		for (i = 0; i < cnt; i++) {
+			if (!ce[i])
+				continue;
+			if (i + 1 < cnt && ce[i + 1])
+				OFI_PREFETCH(ce[i + 1]);
+
+			ret = smr_progress_cmd_entry(ep, ce[i]);
+			/* The sender may be waiting on the response */
+			if (ce[i]->cmd.msg.hdr.op < SMR_OP_MAX)
+				smr_ring_doorbell(smr_peer_region(ep->region,
+						ce[i]->cmd.msg.hdr.id));
+			smr_cmd_queue_release(queue, ce[i], pos + i);
+			if (ret) {
+				if (ret != -FI_EAGAIN) {
+					FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+						"error processing command\n");
+				}
+				err = ret;
+			}
+		}
+	}
+}
+
+static void smr_progress_cmd(struct smr_ep *ep)
+{
+	int i, cnt;
+
 	/* ep->util_ep.lock is used to serialize the message/tag matching.
 	 * We keep the lock until the matching is complete. This will
 	 * ensure that commands are matched in the order they are
@@ -1235,48 +1486,18 @@ static void smr_progress_cmd(struct smr_ep *ep)
 	 * for locking the queue.
 	 */
 	ofi_genlock_lock(&ep->util_ep.lock);
-	while (1) {
-		ret = smr_cmd_queue_head(smr_cmd_queue(ep->region), &ce, &pos);
-		if (ret == -FI_ENOENT)
-			break;
-		switch (ce->cmd.msg.hdr.op) {
-		case ofi_op_msg:
-		case ofi_op_tagged:
-			ret = smr_progress_cmd_msg(ep, &ce->cmd);
-			break;
-		case ofi_op_write:
-		case ofi_op_read_req:
-			ret = smr_progress_cmd_rma(ep, &ce->cmd,
-				&ce->rma_cmd);
-			break;
-		case ofi_op_write_async:
-		case ofi_op_read_async:
-			ofi_ep_peer_rx_cntr_inc(&ep->util_ep,
-						ce->cmd.msg.hdr.op);
-			break;
-		case ofi_op_atomic:
-		case ofi_op_atomic_fetch:
-		case ofi_op_atomic_compare:
-			ret = smr_progress_cmd_atomic(ep, &ce->cmd,
-				&ce->rma_cmd);
-			break;
-		case SMR_OP_MAX + ofi_ctrl_connreq:
-			smr_progress_connreq(ep, &ce->cmd);
-			break;
-		default:
-			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
-				"unidentified operation type\n");
-			ret = -FI_EINVAL;
-		}
-		smr_cmd_queue_release(smr_cmd_queue(ep->region), ce, pos);
-		if (ret) {
-			if (ret != -FI_EAGAIN) {
-				FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
-					"error processing command\n");
-			}
-			break;
-		}
+	smr_progress_cmd_queue(ep, smr_cmd_queue(ep->region));
+
+	/* Start from a different peer each pass so no single busy peer
+	 * is always served first.
+	 */
+	cnt = ep->peer_queue_cnt;
+	for (i = 0; i < cnt; i++) {
+		smr_progress_cmd_queue(ep, smr_peer_cmd_queue(ep->region,
+			ep->peer_queue_ids[(ep->peer_queue_next + i) % cnt]));
 	}
+	if (cnt && ++ep->peer_queue_next >= cnt)
+		ep->peer_queue_next = 0;
 	ofi_genlock_unlock(&ep->util_ep.lock);
 }
 
@@ -1336,6 +1557,7 @@ void smr_progress_ipc_list(struct smr_ep *ep)
 		 * buffer is now free to be reused
 		 */
 		resp->status = SMR_STATUS_SUCCESS;
+		smr_ring_doorbell(peer_smr);
 
 		ofi_mr_cache_delete(domain->ipc_cache, ipc_entry->ipc_entry);
 		ofi_free_async_copy_event(iface, device,
@@ -1352,34 +1574,46 @@ static void smr_buffer_sar(struct smr_ep *ep, struct smr_region *peer_smr,
 {
 	struct smr_sar_buf *sar_buf;
 	struct smr_unexp_buf *buf;
+	uint64_t *status;
 	size_t bytes;
-	int next_buf = 0;
+	int segs, seg_bufs, seg, i;
 
-	while (next_buf < sar_entry->cmd.msg.data.buf_batch_size &&
-	       sar_entry->bytes_done < sar_entry->cmd.msg.hdr.size) {
-		buf = ofi_buf_alloc(ep->unexp_buf_pool);
-		if (!buf) {
-			FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
-				"Error allocating buffer\n");
-			assert(0);
-		}
-		slist_insert_tail(&buf->entry,
-			&sar_entry->cmd_ctx->buf_list);
+	segs = smr_sar_segs(&sar_entry->cmd);
+	seg_bufs = sar_entry->cmd.msg.data.buf_batch_size / segs;
 
-		sar_buf = smr_freestack_get_entry_from_index(
+	while (sar_entry->bytes_done < sar_entry->cmd.msg.hdr.size) {
+		seg = (sar_entry->bytes_done / (seg_bufs * SMR_SAR_SIZE)) %
+		      segs;
+		status = smr_sar_seg_status(resp, seg);
+		if (*status != SMR_STATUS_SAR_FULL)
+			break;
+
+		for (i = 0; i < seg_bufs &&
+		     sar_entry->bytes_done < sar_entry->cmd.msg.hdr.size; i++) {
+			buf = ofi_buf_alloc(ep->unexp_buf_pool);
+			if (!buf) {
+				FI_WARN(&smr_prov, FI_LOG_EP_CTRL,
+					"Error allocating buffer\n");
+				assert(0);
+			}
+			slist_insert_tail(&buf->entry,
+				&sar_entry->cmd_ctx->buf_list);
+
+			sar_buf = smr_freestack_get_entry_from_index(
 				smr_sar_pool(ep->region),
-				sar_entry->cmd.msg.data.sar[next_buf]);
-		bytes = MIN(sar_entry->cmd.msg.hdr.size -
-				sar_entry->bytes_done,
-				SMR_SAR_SIZE);
+				sar_entry->cmd.msg.data.sar[seg * seg_bufs + i]);
+			bytes = MIN(sar_entry->cmd.msg.hdr.size -
+					sar_entry->bytes_done,
+					SMR_SAR_SIZE);
 
-		memcpy(buf->buf, sar_buf->buf, bytes);
+			memcpy(buf->buf, sar_buf->buf, bytes);
 
-		sar_entry->bytes_done += bytes;
-		next_buf++;
+			sar_entry->bytes_done += bytes;
+		}
+		ofi_wmb();
+		*status = SMR_STATUS_SAR_EMPTY;
+		smr_ring_doorbell(peer_smr);
 	}
-	ofi_wmb();
-	resp->status = SMR_STATUS_SAR_EMPTY;
 }
 
 static void smr_progress_sar_list(struct smr_ep *ep)
@@ -1404,8 +1638,6 @@ static void smr_progress_sar_list(struct smr_ep *ep)
 					&sar_entry->bytes_done, sar_entry);
 		} else {
 			if (sar_entry->cmd_ctx) {
-				if (resp->status != SMR_STATUS_SAR_FULL)
-					continue;
 				smr_buffer_sar(ep, peer_smr, resp, sar_entry);
 			} else {
 				smr_try_progress_from_sar(ep, peer_smr, smr_sar_pool(ep->region),
@@ -1467,6 +1699,7 @@ void smr_ep_progress(struct util_ep *util_ep)
 	smr_progress_resp(ep);
 	smr_progress_sar_list(ep);
 	smr_progress_cmd(ep);
+	smr_coll_progress(ep);
 
 	/* always drive forward the ipc list since the completion is
 	 * independent of any action by the provider */
@@ -68,9 +68,11 @@ static ssize_t smr_rma_fast(struct smr_ep *ep, struct smr_region *peer_smr,
 	int ret, i;
 	int64_t pos;
 
-	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
-	if (ret == -FI_ENOENT)
+	ret = smr_cmd_queue_next(smr_peer_tx_queue(peer_smr, peer_id), &ce, &pos);
+	if (ret == -FI_ENOENT) {
+		ep->stats.queue_full++;
 		return -FI_EAGAIN;
+	}
 
 	memcpy(vma_iovec, iov, sizeof(*iov) * iov_count);
 	for (i = 0; i < rma_count; i++) {
@@ -90,11 +92,13 @@ static ssize_t smr_rma_fast(struct smr_ep *ep, struct smr_region *peer_smr,
 		smr_cmd_queue_discard(ce, pos);
 		return -FI_EAGAIN;
 	}
+	ep->stats.cma_bytes += total_len;
 
 	smr_format_rma_resp(&ce->cmd, peer_id, rma_iov, rma_count, total_len,
 			    (op == ofi_op_write) ? ofi_op_write_async :
 			    ofi_op_read_async, op_flags);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
 	return FI_SUCCESS;
 }
 
@@ -130,8 +134,10 @@ static ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 		    (FI_REMOTE_CQ_DATA | FI_DELIVERY_COMPLETE)) &&
 		     rma_count == 1 && smr_vma_enabled(ep, peer_smr));
 
-	if (smr_peer_data(ep->region)[id].sar_status)
+	if (smr_peer_data(ep->region)[id].sar_status) {
+		ep->stats.sar_stall++;
 		return -FI_EAGAIN;
+	}
 
 	ofi_genlock_lock(&ep->util_ep.lock);
 
@@ -160,9 +166,10 @@ static ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 		goto unlock;
 	}
 
-	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
+	ret = smr_cmd_queue_next(smr_peer_tx_queue(peer_smr, peer_id), &ce, &pos);
 	if (ret == -FI_ENOENT) {
 		/* kick the peer to process any outstanding commands */
+		ep->stats.queue_full++;
 		ret = -FI_EAGAIN;
 		goto unlock;
 	}
@@ -170,19 +177,24 @@ static ssize_t smr_generic_rma(struct smr_ep *ep, const struct iovec *iov,
 	total_len = ofi_total_iov_len(iov, iov_count);
 	assert(!(op_flags & FI_INJECT) || total_len <= SMR_INJECT_SIZE);
 
-	proto = smr_select_proto(desc, iov_count, smr_vma_enabled(ep, peer_smr),
-	                         op, total_len, op_flags);
+	proto = smr_select_proto(desc, iov_count,
+				 smr_vma_preferred(ep, peer_smr, id, total_len),
+				 op, total_len, op_flags);
 
 	ret = smr_proto_ops[proto](ep, peer_smr, id, peer_id, op, 0, data,
 				   op_flags, (struct ofi_mr **)desc, iov,
 				   iov_count, total_len, context, &ce->cmd);
 	if (ret) {
 		smr_cmd_queue_discard(ce, pos);
+		if (ret == -FI_EAGAIN)
+			ep->stats.queue_full++;
 		goto unlock;
 	}
 
 	smr_add_rma_cmd(peer_smr, rma_iov, rma_count, ce);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
+	smr_stat_tx(ep, proto, total_len);
 
 	if (proto != smr_src_inline && proto != smr_src_inject)
 		goto unlock;
@@ -334,8 +346,10 @@ static ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 	cmds = 1 + !(domain->fast_rma && !(flags & FI_REMOTE_CQ_DATA) &&
 		     smr_vma_enabled(ep, peer_smr));
 
-	if (smr_peer_data(ep->region)[id].sar_status)
+	if (smr_peer_data(ep->region)[id].sar_status) {
+		ep->stats.sar_stall++;
 		return -FI_EAGAIN;
+	}
 
 	iov.iov_base = (void *) buf;
 	iov.iov_len = len;
@@ -349,19 +363,24 @@ static ssize_t smr_generic_rma_inject(struct fid_ep *ep_fid, const void *buf,
 		goto out;
 	}
 
-	ret = smr_cmd_queue_next(smr_cmd_queue(peer_smr), &ce, &pos);
-	if (ret == -FI_ENOENT)
+	ret = smr_cmd_queue_next(smr_peer_tx_queue(peer_smr, peer_id), &ce, &pos);
+	if (ret == -FI_ENOENT) {
+		ep->stats.queue_full++;
 		return -FI_EAGAIN;
+	}
 
 	proto = len <= SMR_MSG_DATA_LEN ? smr_src_inline : smr_src_inject;
 	ret = smr_proto_ops[proto](ep, peer_smr, id, peer_id, ofi_op_write, 0,
 			data, flags, NULL, &iov, 1, len, NULL, &ce->cmd);
 	if (ret) {
 		smr_cmd_queue_discard(ce, pos);
+		ep->stats.queue_full++;
 		return -FI_EAGAIN;
 	}
 	smr_add_rma_cmd(peer_smr, &rma_iov, 1, ce);
 	smr_cmd_queue_commit(ce, pos);
+	smr_ring_doorbell(peer_smr);
+	smr_stat_tx(ep, proto, len);
 
 out:
 	if (!ret)
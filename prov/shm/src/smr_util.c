@@ -40,6 +40,11 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
 #include <ofi_xpmem.h>
 
 #include "smr_util.h"
@@ -49,6 +54,44 @@ struct dlist_entry ep_name_list;
 DEFINE_LIST(ep_name_list);
 pthread_mutex_t ep_list_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Node-wide directory of shm regions.  Each region records its name, pid
+ * and size here once it is initialized, so that peers can map it with
+ * one shm_open and mmap instead of probing the file and mapping its
+ * header first.  A peer missing from the directory may belong to a
+ * process that could not open it, so a miss still falls back to
+ * shm_open.  The directory is named after SMR_VERSION and the user, and
+ * is left in place for later jobs.  Entries of processes that exit
+ * without closing their endpoints are reclaimed by later inserts.
+ */
+#define SMR_DIR_NAME	"fi_shm_dir_v%d_%u"
+#define SMR_DIR_MAGIC	0x736d7264
+#define SMR_DIR_ENTRIES	(SMR_MAX_PEERS * 2)
+#define SMR_DIR_RETRY	1000
+
+enum {
+	SMR_DIR_FREE,
+	SMR_DIR_USED,
+	SMR_DIR_DELETED,
+};
+
+struct smr_dir_entry {
+	uint32_t		state;
+	int			pid;
+	uint64_t		size;
+	char			name[SMR_NAME_MAX];
+};
+
+struct smr_dir {
+	volatile uint32_t	magic;
+	pthread_spinlock_t	lock;
+	struct smr_dir_entry	entry[SMR_DIR_ENTRIES];
+};
+
+/* Protected by the ep_list_lock */
+static struct smr_dir *smr_dir;
+static bool smr_dir_failed;
+
 void smr_cleanup(void)
 {
 	struct smr_ep_name *ep_name;
@@ -58,6 +101,11 @@ void smr_cleanup(void)
 	dlist_foreach_container_safe(&ep_name_list, struct smr_ep_name,
 				     ep_name, entry, tmp)
 		free(ep_name);
+
+	if (smr_dir) {
+		munmap(smr_dir, sizeof(*smr_dir));
+		smr_dir = NULL;
+	}
 	pthread_mutex_unlock(&ep_list_lock);
 }
 
@@ -95,18 +143,96 @@ void smr_cma_check(struct smr_region *smr, struct smr_region *peer_smr)
 	}
 }
 
+/* Bitmask of the online NUMA nodes, limited to the first 64 */
+static unsigned long smr_numa_online(void)
+{
+	unsigned long mask = 0, first, last;
+	char buf[256], *str, *end;
+	FILE *file;
+
+	file = fopen("/sys/devices/system/node/online", "r");
+	if (!file)
+		return 0;
+
+	str = fgets(buf, sizeof(buf), file);
+	fclose(file);
+	if (!str)
+		return 0;
+
+	while (*str >= '0' && *str <= '9') {
+		first = strtoul(str, &end, 10);
+		last = first;
+		if (*end == '-')
+			last = strtoul(end + 1, &end, 10);
+		for (; first <= last && first < 8 * sizeof(mask); first++)
+			mask |= 1UL << first;
+		if (*end != ',')
+			break;
+		str = end + 1;
+	}
+	return mask;
+}
+
+static void smr_mbind(const struct fi_provider *prov, char *start, char *end,
+		      int mode, unsigned long mask)
+{
+	size_t page_size = ofi_get_page_size();
+
+	start = (char *) ofi_get_aligned_size((uintptr_t) start, page_size);
+	end = (char *) ofi_get_page_start(end, page_size);
+	if (end <= start)
+		return;
+
+	if (syscall(SYS_mbind, start, end - start, mode, &mask,
+		    8 * sizeof(mask), 0)) {
+		FI_INFO(prov, FI_LOG_EP_CTRL, "mbind error: %s\n",
+			strerror(errno));
+	}
+}
+
+/* Set the NUMA policy of a new region before any page is touched.  Every
+ * queue in the region, including the response queue for commands that
+ * the owner sends, is consumed by the owner, so the region prefers the
+ * owner's node.  SAR buffers are filled and drained by both sides and are
+ * interleaved across the online nodes.
+ */
+static void smr_numa_bind(const struct fi_provider *prov, void *addr,
+			  size_t total_size, size_t sar_offset,
+			  size_t sar_end)
+{
+	unsigned long online;
+	unsigned int cpu, node;
+
+	online = smr_numa_online();
+	if (!online || !(online & (online - 1)))
+		return;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) ||
+	    node >= 8 * sizeof(online))
+		return;
+
+	smr_mbind(prov, addr, (char *) addr + total_size, MPOL_PREFERRED,
+		  1UL << node);
+	smr_mbind(prov, (char *) addr + sar_offset, (char *) addr + sar_end,
+		  MPOL_INTERLEAVE, online);
+}
+
 size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
+				  size_t peer_count, size_t peer_queue_count,
 				  size_t *cmd_offset, size_t *resp_offset,
 				  size_t *inject_offset, size_t *sar_offset,
-				  size_t *peer_offset, size_t *name_offset,
-				  size_t *sock_offset)
+				  size_t *peer_offset, size_t *peer_queue_offset,
+				  size_t *name_offset, size_t *sock_offset)
 {
 	size_t cmd_queue_offset, resp_queue_offset, inject_pool_offset;
 	size_t sar_pool_offset, peer_data_offset, ep_name_offset;
 	size_t tx_size, rx_size, total_size, sock_name_offset;
+	size_t peer_queue_size, peer_queues_offset;
 
 	tx_size = roundup_power_of_two(tx_count);
 	rx_size = roundup_power_of_two(rx_count);
+	peer_queue_size = peer_queue_count ?
+			  roundup_power_of_two(peer_queue_count) : 0;
 
 	/* Align cmd_queue offset to cache line */
 	cmd_queue_offset = ofi_get_aligned_size(sizeof(struct smr_region), 64);
@@ -117,9 +243,11 @@ size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
 	sar_pool_offset = inject_pool_offset +
 		freestack_size(sizeof(struct smr_inject_buf), rx_size);
 	peer_data_offset = sar_pool_offset +
-		freestack_size(sizeof(struct smr_sar_buf), SMR_MAX_PEERS);
-	ep_name_offset = peer_data_offset + sizeof(struct smr_peer_data) *
-		SMR_MAX_PEERS;
+		freestack_size(sizeof(struct smr_sar_buf), SMR_SAR_BUF_CNT);
+	peer_queues_offset = ofi_get_aligned_size(peer_data_offset +
+		sizeof(struct smr_peer_data) * peer_count, 64);
+	ep_name_offset = peer_queues_offset + (peer_queue_size ?
+		smr_peer_queue_stride(peer_queue_size) * peer_count : 0);
 
 	sock_name_offset = ep_name_offset + SMR_NAME_MAX;
 
@@ -133,6 +261,8 @@ size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
 		*sar_offset = sar_pool_offset;
 	if (peer_offset)
 		*peer_offset = peer_data_offset;
+	if (peer_queue_offset)
+		*peer_queue_offset = peer_queues_offset;
 	if (name_offset)
 		*name_offset = ep_name_offset;
 	if (sock_offset)
@@ -193,6 +323,167 @@ static void smr_lock_init(pthread_spinlock_t *lock)
 	pthread_spin_init(lock, PTHREAD_PROCESS_SHARED);
 }
 
+static int smr_dir_open(const struct fi_provider *prov)
+{
+	char name[SMR_NAME_MAX];
+	struct stat sts;
+	struct smr_dir *dir;
+	bool created = true;
+	int fd, i;
+
+	if (smr_dir)
+		return 0;
+	if (smr_dir_failed)
+		return -FI_ENOSYS;
+
+	snprintf(name, sizeof(name), SMR_DIR_NAME, SMR_VERSION, getuid());
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd < 0 && errno == EEXIST) {
+		created = false;
+		fd = shm_open(name, O_RDWR, S_IRUSR | S_IWUSR);
+	}
+	if (fd < 0)
+		goto err;
+
+	if (created) {
+		if (ftruncate(fd, sizeof(*dir)))
+			goto close;
+	} else {
+		for (i = 0; i < SMR_DIR_RETRY; i++) {
+			if (fstat(fd, &sts))
+				goto close;
+			if (sts.st_size >= sizeof(*dir))
+				break;
+			sched_yield();
+		}
+		if (i == SMR_DIR_RETRY)
+			goto close;
+	}
+
+	dir = mmap(NULL, sizeof(*dir), PROT_READ | PROT_WRITE, MAP_SHARED,
+		   fd, 0);
+	close(fd);
+	if (dir == MAP_FAILED)
+		goto err;
+
+	if (created) {
+		smr_lock_init(&dir->lock);
+		ofi_wmb();
+		dir->magic = SMR_DIR_MAGIC;
+	} else {
+		for (i = 0; i < SMR_DIR_RETRY && dir->magic != SMR_DIR_MAGIC;
+		     i++)
+			sched_yield();
+		if (dir->magic != SMR_DIR_MAGIC) {
+			munmap(dir, sizeof(*dir));
+			goto err;
+		}
+		ofi_mb();
+	}
+
+	smr_dir = dir;
+	return 0;
+
+close:
+	close(fd);
+err:
+	FI_INFO(prov, FI_LOG_EP_CTRL, "shm region directory unavailable\n");
+	smr_dir_failed = true;
+	return -FI_ENOSYS;
+}
+
+static size_t smr_dir_hash(const char *name)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	while (*name)
+		hash = (hash ^ (unsigned char) *name++) * 1099511628211ULL;
+	return hash % SMR_DIR_ENTRIES;
+}
+
+/* Called with the directory lock held */
+static struct smr_dir_entry *smr_dir_find(const char *name)
+{
+	struct smr_dir_entry *entry;
+	size_t i, idx;
+
+	idx = smr_dir_hash(name);
+	for (i = 0; i < SMR_DIR_ENTRIES; i++) {
+		entry = &smr_dir->entry[(idx + i) % SMR_DIR_ENTRIES];
+		if (entry->state == SMR_DIR_FREE)
+			break;
+		if (entry->state == SMR_DIR_USED &&
+		    !strncmp(entry->name, name, SMR_NAME_MAX))
+			return entry;
+	}
+	return NULL;
+}
+
+static void smr_dir_insert(const char *name, size_t size)
+{
+	struct smr_dir_entry *entry, *slot = NULL;
+	size_t i, idx;
+
+	pthread_spin_lock(&smr_dir->lock);
+	idx = smr_dir_hash(name);
+	for (i = 0; i < SMR_DIR_ENTRIES; i++) {
+		entry = &smr_dir->entry[(idx + i) % SMR_DIR_ENTRIES];
+		if (entry->state == SMR_DIR_USED &&
+		    (!strncmp(entry->name, name, SMR_NAME_MAX) ||
+		     (kill(entry->pid, 0) && errno == ESRCH)))
+			entry->state = SMR_DIR_DELETED;
+
+		if (entry->state != SMR_DIR_USED && !slot)
+			slot = entry;
+		if (entry->state == SMR_DIR_FREE)
+			break;
+	}
+
+	if (slot) {
+		slot->pid = getpid();
+		slot->size = size;
+		strncpy(slot->name, name, SMR_NAME_MAX - 1);
+		slot->name[SMR_NAME_MAX - 1] = '\0';
+		slot->state = SMR_DIR_USED;
+	}
+	pthread_spin_unlock(&smr_dir->lock);
+}
+
+static void smr_dir_remove(const char *name)
+{
+	struct smr_dir_entry *entry;
+	size_t idx;
+
+	pthread_spin_lock(&smr_dir->lock);
+	entry = smr_dir_find(name);
+	if (entry && entry->pid == getpid()) {
+		entry->state = SMR_DIR_DELETED;
+
+		/* Free the tail of the probe chain so it does not grow */
+		idx = entry - smr_dir->entry;
+		while (smr_dir->entry[idx].state == SMR_DIR_DELETED &&
+		       smr_dir->entry[(idx + 1) % SMR_DIR_ENTRIES].state ==
+		       SMR_DIR_FREE) {
+			smr_dir->entry[idx].state = SMR_DIR_FREE;
+			idx = (idx + SMR_DIR_ENTRIES - 1) % SMR_DIR_ENTRIES;
+		}
+	}
+	pthread_spin_unlock(&smr_dir->lock);
+}
+
+static int smr_dir_lookup(const char *name, size_t *size)
+{
+	struct smr_dir_entry *entry;
+
+	pthread_spin_lock(&smr_dir->lock);
+	entry = smr_dir_find(name);
+	if (entry)
+		*size = entry->size;
+	pthread_spin_unlock(&smr_dir->lock);
+
+	return entry ? 0 : -FI_ENOENT;
+}
+
 /* TODO: Determine if aligning SMR data helps performance */
 int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	       const struct smr_attr *attr, struct smr_region *volatile *smr)
@@ -200,16 +491,20 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	struct smr_ep_name *ep_name;
 	size_t total_size, cmd_queue_offset, peer_data_offset;
 	size_t resp_queue_offset, inject_pool_offset, name_offset;
-	size_t sar_pool_offset, sock_name_offset;
+	size_t sar_pool_offset, sock_name_offset, peer_queue_offset;
 	int fd, ret, i;
 	void *mapped_addr;
-	size_t tx_size, rx_size;
+	size_t tx_size, rx_size, peer_queue_size;
 
 	tx_size = roundup_power_of_two(attr->tx_count);
 	rx_size = roundup_power_of_two(attr->rx_count);
-	total_size = smr_calculate_size_offsets(tx_size, rx_size, &cmd_queue_offset,
-					&resp_queue_offset, &inject_pool_offset,
-					&sar_pool_offset, &peer_data_offset,
+	peer_queue_size = attr->peer_queue_count ?
+			  roundup_power_of_two(attr->peer_queue_count) : 0;
+	total_size = smr_calculate_size_offsets(tx_size, rx_size,
+					map->max_peers, peer_queue_size,
+					&cmd_queue_offset, &resp_queue_offset,
+					&inject_pool_offset, &sar_pool_offset,
+					&peer_data_offset, &peer_queue_offset,
 					&name_offset, &sock_name_offset);
 
 	fd = shm_open(attr->name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
@@ -260,6 +555,10 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 
 	close(fd);
 
+	if (smr_env.numa_bind)
+		smr_numa_bind(prov, mapped_addr, total_size, sar_pool_offset,
+			      peer_data_offset);
+
 	if (attr->flags & SMR_FLAG_HMEM_ENABLED) {
 		ret = ofi_hmem_host_register(mapped_addr, total_size);
 		if (ret)
@@ -286,6 +585,8 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 
 	(*smr)->cma_cap_peer = SMR_VMA_CAP_NA;
 	(*smr)->cma_cap_self = SMR_VMA_CAP_NA;
+	ofi_atomic_initialize32(&(*smr)->doorbell, 0);
+	ofi_atomic_initialize32(&(*smr)->waiters, 0);
 
 	(*smr)->xpmem_cap_self = SMR_VMA_CAP_OFF;
 	if (xpmem && smr_env.use_xpmem) {
@@ -301,27 +602,39 @@ int smr_create(const struct fi_provider *prov, struct smr_map *map,
 	(*smr)->inject_pool_offset = inject_pool_offset;
 	(*smr)->sar_pool_offset = sar_pool_offset;
 	(*smr)->peer_data_offset = peer_data_offset;
+	(*smr)->peer_queue_offset = peer_queue_offset;
+	(*smr)->peer_queue_size = peer_queue_size;
 	(*smr)->name_offset = name_offset;
 	(*smr)->sock_name_offset = sock_name_offset;
 	(*smr)->max_sar_buf_per_peer = SMR_BUF_BATCH_MAX;
+	(*smr)->max_peers = map->max_peers;
 
 	smr_cmd_queue_init(smr_cmd_queue(*smr), rx_size);
 	smr_resp_queue_init(smr_resp_queue(*smr), tx_size);
 	smr_freestack_init(smr_inject_pool(*smr), rx_size,
 			sizeof(struct smr_inject_buf));
-	smr_freestack_init(smr_sar_pool(*smr), SMR_MAX_PEERS,
+	smr_freestack_init(smr_sar_pool(*smr), SMR_SAR_BUF_CNT,
 			sizeof(struct smr_sar_buf));
-	for (i = 0; i < SMR_MAX_PEERS; i++) {
+	for (i = 0; i < map->max_peers; i++) {
 		smr_peer_addr_init(&smr_peer_data(*smr)[i].addr);
 		smr_peer_data(*smr)[i].sar_status = 0;
 		smr_peer_data(*smr)[i].name_sent = 0;
 		smr_peer_data(*smr)[i].xpmem.cap = SMR_VMA_CAP_OFF;
+		smr_peer_data(*smr)[i].vma_threshold = 0;
+		if (peer_queue_size)
+			smr_cmd_queue_init(smr_peer_cmd_queue(*smr, i),
+					   peer_queue_size);
 	}
 
 	strncpy((char *) smr_name(*smr), attr->name, total_size - name_offset);
 
 	/* Must be set last to signal full initialization to peers */
 	(*smr)->pid = getpid();
+
+	pthread_mutex_lock(&ep_list_lock);
+	if (!smr_dir_open(prov))
+		smr_dir_insert(attr->name, total_size);
+	pthread_mutex_unlock(&ep_list_lock);
 	return 0;
 
 remove:
@@ -338,6 +651,12 @@ void smr_free(struct smr_region *smr)
 {
 	if (smr->flags & SMR_FLAG_HMEM_ENABLED)
 		(void) ofi_hmem_host_unregister(smr);
+
+	pthread_mutex_lock(&ep_list_lock);
+	if (smr_dir)
+		smr_dir_remove(smr_name(smr));
+	pthread_mutex_unlock(&ep_list_lock);
+
 	shm_unlink(smr_name(smr));
 	munmap(smr, smr->total_size);
 }
@@ -363,10 +682,18 @@ int smr_map_create(const struct fi_provider *prov, int peer_count,
 		return -FI_ENOMEM;
 	}
 
+	(*map)->peers = calloc(peer_count, sizeof(*(*map)->peers));
+	if (!(*map)->peers) {
+		FI_WARN(prov, FI_LOG_DOMAIN, "failed to create SHM peer table\n");
+		free(*map);
+		return -FI_ENOMEM;
+	}
+
 	for (i = 0; i < peer_count; i++) {
 		smr_peer_addr_init(&(*map)->peers[i].peer);
 		(*map)->peers[i].fiaddr = FI_ADDR_NOTAVAIL;
 	}
+	(*map)->max_peers = peer_count;
 	(*map)->flags = flags;
 
 	ofi_rbmap_init(&(*map)->rbmap, smr_name_compare);
@@ -398,9 +725,12 @@ int smr_map_to_region(const struct fi_provider *prov, struct smr_map *map,
 	if (entry) {
 		peer_buf->region = container_of(entry, struct smr_ep_name,
 						entry)->region;
+		peer_buf->peer.id = id;
 		pthread_mutex_unlock(&ep_list_lock);
 		return FI_SUCCESS;
 	}
+	if (!smr_dir || smr_dir_lookup(name, &size))
+		size = 0;
 	pthread_mutex_unlock(&ep_list_lock);
 
 	ofi_spin_lock(&map->lock);
@@ -414,6 +744,21 @@ int smr_map_to_region(const struct fi_provider *prov, struct smr_map *map,
 		goto unlock;
 	}
 
+	if (size && !fstat(fd, &sts) && sts.st_size == size) {
+		peer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			    fd, 0);
+		if (peer == MAP_FAILED) {
+			FI_WARN(prov, FI_LOG_AV, "mmap error\n");
+			ret = -errno;
+			goto out;
+		}
+
+		/* The region may have been recreated since it was listed */
+		if (peer->pid && peer->total_size == size)
+			goto mapped;
+		munmap(peer, size);
+	}
+
 	memset(tmp, 0, sizeof(tmp));
 	snprintf(tmp, sizeof(tmp), "%s%s", SMR_DIR, name);
 	if (stat(tmp, &sts) == -1) {
@@ -445,7 +790,14 @@ int smr_map_to_region(const struct fi_provider *prov, struct smr_map *map,
 	munmap(peer, sizeof(*peer));
 
 	peer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (peer == MAP_FAILED) {
+		FI_WARN(prov, FI_LOG_AV, "mmap error\n");
+		ret = -errno;
+		goto out;
+	}
+mapped:
 	peer_buf->region = peer;
+	peer_buf->peer.id = id;
 
 	if (map->flags & SMR_FLAG_HMEM_ENABLED) {
 		ret = ofi_hmem_host_register(peer, peer->total_size);
@@ -461,6 +813,79 @@ unlock:
 	return ret;
 }
 
+/* Message sizes at which a single CMA/xpmem copy is timed against the
+ * two copies made by SAR.  The largest must fit in the peer's SAR pool.
+ */
+static const size_t smr_probe_sizes[] = {8192, 32768, 131072, 524288};
+#define SMR_PROBE_ITERS 3
+
+/* Find the size above which CMA/xpmem beats SAR for this peer by reading
+ * from the peer's SAR pool both ways.  The fastest of a few runs after a
+ * warm-up is kept to filter out scheduling noise.
+ */
+static void smr_probe_vma(struct smr_region *region, int64_t id,
+			  struct smr_region *peer_smr)
+{
+	struct smr_peer_data *local_peers = smr_peer_data(region);
+	enum ofi_shm_p2p_type p2p_type;
+	struct iovec local, remote;
+	uint64_t start, vma_ns, sar_ns;
+	size_t i, len;
+	void *buf;
+	int j, ret;
+
+	local_peers[id].vma_threshold = 0;
+	if (!smr_env.probe_vma || region == peer_smr)
+		return;
+
+	if (local_peers[id].xpmem.cap == SMR_VMA_CAP_ON)
+		p2p_type = FI_SHM_P2P_XPMEM;
+	else if (region->cma_cap_peer == SMR_VMA_CAP_ON)
+		p2p_type = FI_SHM_P2P_CMA;
+	else
+		return;
+
+	buf = malloc(smr_probe_sizes[ARRAY_SIZE(smr_probe_sizes) - 1]);
+	if (!buf)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(smr_probe_sizes); i++) {
+		len = smr_probe_sizes[i];
+		local.iov_base = buf;
+		local.iov_len = len;
+		remote.iov_base = (char *) peer_smr->base_addr +
+				  peer_smr->sar_pool_offset;
+		remote.iov_len = len;
+		vma_ns = sar_ns = UINT64_MAX;
+
+		for (j = 0; j <= SMR_PROBE_ITERS; j++) {
+			start = ofi_gettime_ns();
+			ret = ofi_shm_p2p_copy(p2p_type, &local, 1, &remote, 1,
+					       len, peer_smr->pid, false,
+					       &local_peers[id].xpmem);
+			if (ret)
+				goto out;
+			if (j)
+				vma_ns = MIN(vma_ns, ofi_gettime_ns() - start);
+
+			start = ofi_gettime_ns();
+			memcpy(buf, smr_sar_pool(peer_smr), len);
+			if (j)
+				sar_ns = MIN(sar_ns, ofi_gettime_ns() - start);
+		}
+
+		if (vma_ns <= 2 * sar_ns)
+			goto out;
+		local_peers[id].vma_threshold = len;
+	}
+	local_peers[id].vma_threshold = SIZE_MAX;
+out:
+	FI_DBG(&smr_prov, FI_LOG_EP_CTRL,
+	       "peer %" PRId64 " vma threshold %zu\n", id,
+	       local_peers[id].vma_threshold);
+	free(buf);
+}
+
 void smr_map_to_endpoint(struct smr_region *region, int64_t id)
 {
 	int ret;
@@ -490,15 +915,16 @@ void smr_map_to_endpoint(struct smr_region *region, int64_t id)
 		if (ret) {
 			local_peers[id].xpmem.cap = SMR_VMA_CAP_OFF;
 			region->xpmem_cap_self = SMR_VMA_CAP_OFF;
-			return;
+		} else {
+			local_peers[id].xpmem.cap = SMR_VMA_CAP_ON;
+			local_peers[id].xpmem.addr_max =
+				peer_smr->xpmem_self.address_max;
 		}
-		local_peers[id].xpmem.cap = SMR_VMA_CAP_ON;
-		local_peers[id].xpmem.addr_max = peer_smr->xpmem_self.address_max;
 	} else {
 		local_peers[id].xpmem.cap = SMR_VMA_CAP_OFF;
 	}
 
-	return;
+	smr_probe_vma(region, id, peer_smr);
 }
 
 void smr_unmap_from_endpoint(struct smr_region *region, int64_t id)
@@ -526,7 +952,7 @@ void smr_unmap_from_endpoint(struct smr_region *region, int64_t id)
 void smr_exchange_all_peers(struct smr_region *region)
 {
 	int64_t i;
-	for (i = 0; i < SMR_MAX_PEERS; i++)
+	for (i = 0; i < region->map->max_peers; i++)
 		smr_map_to_endpoint(region, i);
 }
 
@@ -546,33 +972,38 @@ int smr_map_add(const struct fi_provider *prov, struct smr_map *map,
 		return 0;
 	}
 
-	while (map->peers[map->cur_id].peer.id != -1 &&
-	       tries < SMR_MAX_PEERS) {
-		if (++map->cur_id == SMR_MAX_PEERS)
+	while (map->peers[map->cur_id].in_use && tries < map->max_peers) {
+		if (++map->cur_id == map->max_peers)
 			map->cur_id = 0;
 		tries++;
 	}
 
-	assert(map->cur_id < SMR_MAX_PEERS && tries < SMR_MAX_PEERS);
+	if (tries == map->max_peers) {
+		ofi_rbmap_delete(&map->rbmap, node);
+		ofi_spin_unlock(&map->lock);
+		FI_WARN(prov, FI_LOG_AV, "shm peer table full (%d peers)\n",
+			map->max_peers);
+		return -FI_ENOMEM;
+	}
+
 	*id = map->cur_id;
 	node->data = (void *) (intptr_t) *id;
 	strncpy(map->peers[*id].peer.name, name, SMR_NAME_MAX);
 	map->peers[*id].peer.name[SMR_NAME_MAX - 1] = '\0';
 	map->peers[*id].region = NULL;
+	map->peers[*id].in_use = true;
 	map->num_peers++;
 	ofi_spin_unlock(&map->lock);
 
-	ret = smr_map_to_region(prov, map, *id);
-	if (!ret)
-		map->peers[*id].peer.id = *id;
-	return ret == -ENOENT ? 0 : ret;
+	/* The peer region is mapped on first use, see smr_verify_peer() */
+	return 0;
 }
 
 void smr_map_del(struct smr_map *map, int64_t id)
 {
 	struct dlist_entry *entry;
 
-	assert(id >= 0 && id < SMR_MAX_PEERS);
+	assert(id >= 0 && id < map->max_peers);
 
 	pthread_mutex_lock(&ep_list_lock);
 	entry = dlist_find_first_match(&ep_name_list, smr_match_name,
@@ -580,10 +1011,10 @@ void smr_map_del(struct smr_map *map, int64_t id)
 	pthread_mutex_unlock(&ep_list_lock);
 
 	ofi_spin_lock(&map->lock);
-	if (map->peers[id].peer.id < 0)
+	if (!map->peers[id].in_use)
 		goto unlock;
 
-	if (!entry) {
+	if (map->peers[id].peer.id >= 0 && !entry) {
 		if (map->flags & SMR_FLAG_HMEM_ENABLED)
 			(void) ofi_hmem_host_unregister(map->peers[id].region);
 		munmap(map->peers[id].region, map->peers[id].region->total_size);
@@ -594,6 +1025,8 @@ void smr_map_del(struct smr_map *map, int64_t id)
 
 	map->peers[id].fiaddr = FI_ADDR_NOTAVAIL;
 	map->peers[id].peer.id = -1;
+	map->peers[id].region = NULL;
+	map->peers[id].in_use = false;
 	map->num_peers--;
 
 unlock:
@@ -604,16 +1037,17 @@ void smr_map_free(struct smr_map *map)
 {
 	int64_t i;
 
-	for (i = 0; i < SMR_MAX_PEERS; i++)
+	for (i = 0; i < map->max_peers; i++)
 		smr_map_del(map, i);
 
 	ofi_rbmap_cleanup(&map->rbmap);
+	free(map->peers);
 	free(map);
 }
 
 struct smr_region *smr_map_get(struct smr_map *map, int64_t id)
 {
-	if (id < 0 || id >= SMR_MAX_PEERS)
+	if (id < 0 || id >= map->max_peers)
 		return NULL;
 
 	return map->peers[id].region;
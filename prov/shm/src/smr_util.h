@@ -38,9 +38,15 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <sys/un.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <ofi_xpmem.h>
 #include <ofi_atom.h>
+#include <ofi_mb.h>
 #include <ofi_proto.h>
 #include <ofi_mem.h>
 #include <ofi_rbuf.h>
@@ -54,16 +60,17 @@
 extern "C" {
 #endif
 
-#define SMR_VERSION	6
+#define SMR_VERSION	11
 
 #define SMR_FLAG_ATOMIC	(1 << 0)
 #define SMR_FLAG_DEBUG	(1 << 1)
 #define SMR_FLAG_IPC_SOCK (1 << 2)
 #define SMR_FLAG_HMEM_ENABLED (1 << 3)
+#define SMR_FLAG_RMA_EVENT (1 << 4)
 
 #define SMR_CMD_SIZE		256	/* align with 64-byte cache line */
 
-/* SMR op_src: Specifies data source location */
+/* SMR op_src: Specifies data source location, in FI_SHM_PROTO_* order */
 enum {
 	smr_src_inline,	/* command data */
 	smr_src_inject,	/* inject buffers */
@@ -71,6 +78,7 @@ enum {
 	smr_src_mmap,	/* mmap-based fallback protocol */
 	smr_src_sar,	/* segmentation fallback protocol */
 	smr_src_ipc,	/* device IPC handle protocol */
+	smr_src_export,	/* exported send buffer */
 	smr_src_max,
 };
 
@@ -83,6 +91,7 @@ enum {
 #define SMR_TX_COMPLETION	(1 << 2)
 #define SMR_RX_COMPLETION	(1 << 3)
 #define SMR_MULTI_RECV		(1 << 4)
+#define SMR_SAR_PIPELINE	(1 << 5)
 
 /* CMA/XPMEM capability. Generic acronym used:
  * VMA: Virtual Memory Address */
@@ -94,23 +103,22 @@ enum {
 
 /*
  * Unique smr_op_hdr for smr message protocol:
- * 	addr - local shm_id of peer sending msg (for shm lookup)
  * 	op - type of op (ex. ofi_op_msg, defined in ofi_proto.h)
  * 	op_src - msg src (ex. smr_src_inline, defined above)
  * 	op_flags - operation flags (ex. SMR_REMOTE_CQ_DATA, defined above)
- * 	src_data - src of additional op data (inject offset / resp offset)
+ * 	id - local shm_id of peer sending msg (for shm lookup)
  * 	data - remote CQ data
+ * 	src_data - src of additional op data (inject offset / resp offset)
+ *
+ * The header is packed so that it leaves room in the first cache line of a
+ * command queue entry for the start of an inline payload, which begins at
+ * src_data: inline commands use neither src_data nor msg_id.
  */
 struct smr_msg_hdr {
-	uint64_t		msg_id;
-	int64_t			id;
-	uint32_t		op;
+	uint16_t		op;
 	uint16_t		op_src;
 	uint16_t		op_flags;
-
-	uint64_t		size;
-	uint64_t		src_data;
-	uint64_t		data;
+	int16_t			id;	/* less than SMR_MAX_PEERS */
 	union {
 		uint64_t	tag;
 		struct {
@@ -118,16 +126,23 @@ struct smr_msg_hdr {
 			uint8_t	atomic_op;
 		};
 	};
+	uint64_t		size;
+	uint64_t		data;
+
+	uint64_t		src_data;
+	uint64_t		msg_id;
 } __attribute__ ((aligned(16)));
 
 #define SMR_BUF_BATCH_MAX	64
-#define SMR_MSG_DATA_LEN	(SMR_CMD_SIZE - sizeof(struct smr_msg_hdr))
+#define SMR_CMD_DATA_LEN	(SMR_CMD_SIZE - sizeof(struct smr_msg_hdr))
+#define SMR_INLINE_OFFSET	offsetof(struct smr_msg_hdr, src_data)
+#define SMR_MSG_DATA_LEN	(SMR_CMD_SIZE - SMR_INLINE_OFFSET)
 
 union smr_cmd_data {
-	uint8_t			msg[SMR_MSG_DATA_LEN];
+	uint8_t			pad[SMR_CMD_DATA_LEN];
 	struct {
 		size_t		iov_count;
-		struct iovec	iov[(SMR_MSG_DATA_LEN - sizeof(size_t)) /
+		struct iovec	iov[(SMR_CMD_DATA_LEN - sizeof(size_t)) /
 				    sizeof(struct iovec)];
 	};
 	struct {
@@ -135,6 +150,11 @@ union smr_cmd_data {
 		int16_t		sar[SMR_BUF_BATCH_MAX];
 	};
 	struct ipc_info		ipc_info;
+	struct {
+		uint64_t	export_id;
+		uint64_t	export_size;
+		uint64_t	export_offset;
+	};
 };
 
 struct smr_cmd_msg {
@@ -160,6 +180,11 @@ struct smr_cmd {
 	};
 };
 
+static inline uint8_t *smr_inline_data(struct smr_cmd *cmd)
+{
+	return (uint8_t *) cmd + SMR_INLINE_OFFSET;
+}
+
 #define SMR_INJECT_SIZE		4096
 #define SMR_COMP_INJECT_SIZE	(SMR_INJECT_SIZE / 2)
 #define SMR_SAR_SIZE		32768
@@ -179,6 +204,7 @@ struct smr_peer_data {
 	uint32_t		sar_status;
 	uint32_t		name_sent;
 	struct xpmem_client 	xpmem;
+	size_t			vma_threshold;
 };
 
 extern struct dlist_entry ep_name_list;
@@ -205,17 +231,26 @@ struct smr_peer {
 	struct smr_addr		peer;
 	fi_addr_t		fiaddr;
 	struct smr_region	*region;
+	bool			in_use;
 };
 
-#define SMR_MAX_PEERS	256
+/* The peer table of a map, and the peer data of every region attached
+ * to it, is sized to the map's max_peers.  SMR_DEF_PEERS is the lowest
+ * capacity a map is created with and SMR_MAX_PEERS the highest.  The
+ * SAR pool stays at a fixed size and is shared between all peers.
+ */
+#define SMR_DEF_PEERS	256
+#define SMR_MAX_PEERS	16384
+#define SMR_SAR_BUF_CNT	256
 
 struct smr_map {
 	ofi_spin_t		lock;
 	int64_t			cur_id;
 	int 			num_peers;
+	int			max_peers;
 	uint16_t		flags;
 	struct ofi_rbmap	rbmap;
-	struct smr_peer		peers[SMR_MAX_PEERS];
+	struct smr_peer		*peers;
 };
 
 struct smr_region {
@@ -226,6 +261,8 @@ struct smr_region {
 	uint8_t		cma_cap_peer;
 	uint8_t		cma_cap_self;
 	uint32_t	max_sar_buf_per_peer;
+	uint32_t	max_peers;
+	uint32_t	peer_queue_size;
 	uint8_t		xpmem_cap_self;
 	struct xpmem_pinfo xpmem_self;
 	struct xpmem_pinfo xpmem_peer;
@@ -245,13 +282,20 @@ struct smr_region {
 	size_t		inject_pool_offset;
 	size_t		sar_pool_offset;
 	size_t		peer_data_offset;
+	size_t		peer_queue_offset;
 	size_t		name_offset;
 	size_t		sock_name_offset;
+
+	/* futex word rung by peers after posting work while waiters is
+	 * non-zero, see smr_ring_doorbell() */
+	ofi_atomic32_t	doorbell;
+	ofi_atomic32_t	waiters;
 };
 
 struct smr_resp {
 	uint64_t	msg_id;
 	uint64_t	status;
+	uint64_t	pipe_status;
 };
 
 struct smr_inject_buf {
@@ -277,6 +321,27 @@ struct smr_sar_buf {
 	uint8_t		buf[SMR_SAR_SIZE];
 };
 
+/* A pipelined SAR batch is split into two halves that are handed back
+ * and forth on their own status words, status and pipe_status, so the
+ * sender can fill one half while the receiver drains the other.
+ */
+static inline int smr_sar_segs(struct smr_cmd *cmd)
+{
+	return cmd->msg.hdr.op_flags & SMR_SAR_PIPELINE ? 2 : 1;
+}
+
+static inline uint64_t *smr_sar_seg_status(struct smr_resp *resp, int seg)
+{
+	return seg ? &resp->pipe_status : &resp->status;
+}
+
+/* Both halves have been drained once the last one is handed back */
+static inline bool smr_sar_drained(struct smr_cmd *cmd, struct smr_resp *resp)
+{
+	return smr_sar_segs(cmd) == 1 ||
+	       resp->pipe_status != SMR_STATUS_SAR_FULL;
+}
+
 /* TODO it is expected that a future patch will expand the smr_cmd
  * structure to also include the rma information, thereby removing the
  * need to have two commands in the cmd_entry. We can also remove the
@@ -297,10 +362,65 @@ static inline struct smr_region *smr_peer_region(struct smr_region *smr, int i)
 {
 	return smr->map->peers[i].region;
 }
+
+/* Wake the owner of smr if it is sleeping in a wait.  Called after work
+ * for the owner has been posted; costs no system call while the owner
+ * is awake.  The owner raises waiters and then rechecks for work, so at
+ * least one side sees the other.
+ */
+static inline void smr_ring_doorbell(struct smr_region *smr)
+{
+	ofi_mb();
+	if (!ofi_atomic_load_explicit32(&smr->waiters, memory_order_relaxed))
+		return;
+
+	ofi_atomic_inc32(&smr->doorbell);
+	(void) syscall(SYS_futex, &smr->doorbell.val, FUTEX_WAKE, INT_MAX,
+		       NULL, NULL, 0);
+}
+
+/* Sleep until the doorbell moves away from val or timeout ms pass */
+static inline void smr_doorbell_wait(struct smr_region *smr, int32_t val,
+				     int timeout)
+{
+	struct timespec ts;
+
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000000;
+	(void) syscall(SYS_futex, &smr->doorbell.val, FUTEX_WAIT, val,
+		       &ts, NULL, 0);
+}
 static inline struct smr_cmd_queue *smr_cmd_queue(struct smr_region *smr)
 {
 	return (struct smr_cmd_queue *) ((char *) smr + smr->cmd_queue_offset);
 }
+
+/* Besides the shared command queue, a region may carry one command
+ * queue per peer, indexed by the peer's id in the owner's map.  Each
+ * is written by a single sender, so senders do not contend with each
+ * other on the queue head.
+ */
+static inline size_t smr_peer_queue_stride(size_t size)
+{
+	return sizeof(struct smr_cmd_queue) +
+	       sizeof(struct smr_cmd_queue_entry) * size;
+}
+static inline struct smr_cmd_queue *
+smr_peer_cmd_queue(struct smr_region *smr, int64_t id)
+{
+	return (struct smr_cmd_queue *) ((char *) smr +
+		smr->peer_queue_offset +
+		id * smr_peer_queue_stride(smr->peer_queue_size));
+}
+
+/* Only peers that completed the connection handshake have a queue */
+static inline struct smr_cmd_queue *
+smr_peer_tx_queue(struct smr_region *peer_smr, int64_t peer_id)
+{
+	if (peer_smr->peer_queue_size && peer_id >= 0)
+		return smr_peer_cmd_queue(peer_smr, peer_id);
+	return smr_cmd_queue(peer_smr);
+}
 static inline struct smr_resp_queue *smr_resp_queue(struct smr_region *smr)
 {
 	return (struct smr_resp_queue *) ((char *) smr + smr->resp_queue_offset);
@@ -332,18 +452,27 @@ static inline void smr_set_map(struct smr_region *smr, struct smr_map *map)
 	smr->map = map;
 }
 
+/* Share of the SAR pool a sender may claim from a peer at once */
+static inline uint32_t smr_sar_bufs_per_peer(int num_peers)
+{
+	return num_peers ? MAX(1, SMR_SAR_BUF_CNT / num_peers) :
+			   SMR_BUF_BATCH_MAX;
+}
+
 struct smr_attr {
 	const char	*name;
 	size_t		rx_count;
 	size_t		tx_count;
+	size_t		peer_queue_count;
 	uint16_t	flags;
 };
 
 size_t smr_calculate_size_offsets(size_t tx_count, size_t rx_count,
+				  size_t peer_count, size_t peer_queue_count,
 				  size_t *cmd_offset, size_t *resp_offset,
 				  size_t *inject_offset, size_t *sar_offset,
-				  size_t *peer_offset, size_t *name_offset,
-				  size_t *sock_offset);
+				  size_t *peer_offset, size_t *peer_queue_offset,
+				  size_t *name_offset, size_t *sock_offset);
 void	smr_cma_check(struct smr_region *region, struct smr_region *peer_region);
 void	smr_cleanup(void);
 int	smr_map_create(const struct fi_provider *prov, int peer_count,
@@ -75,10 +75,16 @@
 #define SM2_IOV_LIMIT		4
 #define SM2_PREFIX		"fi_sm2://"
 #define SM2_PREFIX_NS		"fi_ns://"
-#define SM2_VERSION		1
+#define SM2_VERSION		3
 #define SM2_IOV_LIMIT		4
 #define SM2_INJECT_SIZE		(SM2_XFER_ENTRY_SIZE - sizeof(struct sm2_xfer_hdr))
 
+/* CMA messages larger than this are copied over several progress calls */
+#define SM2_CMA_CHUNK_SIZE	(1 << 20)
+
+/* Returned xfer_entries kept in private memory before the freestack */
+#define SM2_FREE_CACHE_SIZE	16
+
 #define SM2_ATOMIC_INJECT_SIZE	    (SM2_INJECT_SIZE - sizeof(struct sm2_atomic_hdr))
 #define SM2_ATOMIC_COMP_INJECT_SIZE (SM2_ATOMIC_INJECT_SIZE / 2)
 
@@ -207,9 +213,63 @@ static inline struct sm2_fifo *sm2_recv_queue(struct sm2_region *smr)
 	return (struct sm2_fifo *) ((char *) smr + smr->recv_queue_offset);
 }
 
-static inline struct smr_freestack *sm2_freestack(struct sm2_region *smr)
+static inline struct smr_freestack *sm2_freestack(struct sm2_region *smr,
+						 int cls)
+{
+	return (struct smr_freestack *) ((char *) smr +
+					 smr->freestack_offset[cls]);
+}
+
+/* Size class of an xfer_entry of this region, found from its address */
+static inline int sm2_xfer_class(struct sm2_region *smr,
+				 struct sm2_xfer_entry *xfer_entry)
 {
-	return (struct smr_freestack *) ((char *) smr + smr->freestack_offset);
+	struct smr_freestack *fs;
+	char *base;
+	int cls;
+
+	for (cls = 0; cls < SM2_XFER_CLASSES - 1; cls++) {
+		fs = sm2_freestack(smr, cls);
+		base = (char *) fs + fs->entry_base_offset;
+		if ((char *) xfer_entry >= base &&
+		    (char *) xfer_entry < base + fs->object_size * fs->size)
+			break;
+	}
+	return cls;
+}
+
+/* True when every xfer_entry of the region is back on its freestack */
+static inline bool sm2_freestacks_full(struct sm2_region *smr)
+{
+	int cls;
+
+	for (cls = 0; cls < SM2_XFER_CLASSES; cls++) {
+		if (!smr_freestack_isfull(sm2_freestack(smr, cls)))
+			return false;
+	}
+	return true;
+}
+
+/* Bytes of an xfer_entry that carry data, used to copy it */
+static inline size_t sm2_xfer_entry_len(struct sm2_xfer_entry *xfer_entry)
+{
+	size_t len;
+
+	switch (xfer_entry->hdr.proto) {
+	case sm2_proto_cma:
+		len = sizeof(struct sm2_cma_data);
+		break;
+	case sm2_proto_ipc:
+		len = sizeof(struct ipc_info);
+		break;
+	default:
+		len = xfer_entry->hdr.op == ofi_op_msg ||
+				      xfer_entry->hdr.op == ofi_op_tagged ?
+			      xfer_entry->hdr.size :
+			      SM2_INJECT_SIZE;
+		break;
+	}
+	return sizeof(struct sm2_xfer_hdr) + len;
 }
 
 int sm2_fabric(struct fi_fabric_attr *attr, struct fid_fabric **fabric,
@@ -251,15 +311,35 @@ struct sm2_xfer_ctx {
 	struct sm2_xfer_entry xfer_entry;
 };
 
+/*
+ * A receive that is still being copied: either a CMA transfer copied in
+ * slices (see SM2_CMA_CHUNK_SIZE) or an IPC transfer running on the
+ * device copy engine.
+ */
+struct sm2_pend_entry {
+	struct dlist_entry entry;
+	struct sm2_xfer_entry *xfer_entry;
+	struct fi_peer_rx_entry *rx_entry;
+	void *comp_buf;
+	size_t bytes_done;
+
+	/* IPC only */
+	struct ofi_mr_entry *mr_entry;
+	struct ofi_hmem_copy copy;
+};
+
 struct sm2_domain {
 	struct util_domain util_domain;
 	struct ofi_mr_cache *ipc_cache;
 	struct fid_peer_srx *srx;
 };
 
+struct sm2_fifo_batch;
+
 struct sm2_ep {
 	struct util_ep util_ep;
 	size_t rx_size;
+	size_t tag_buckets;
 	size_t tx_size;
 	const char *name;
 	struct sm2_mmap *mmap;
@@ -267,7 +347,18 @@ struct sm2_ep {
 	sm2_gid_t gid;
 	struct fid_ep *srx;
 	struct ofi_bufpool *xfer_ctx_pool;
+	struct ofi_bufpool *pend_pool;
+	struct dlist_entry cma_pend_list;
+	struct dlist_entry ipc_pend_list;
 	int ep_idx;
+	/* entries detached from the receive queue, not yet read */
+	int64_t recv_next;
+	int64_t recv_last;
+	/* set while progress defers returns to senders */
+	struct sm2_fifo_batch *return_batch;
+	/* free xfer_entries of our region, reused before the freestacks */
+	int free_cache_cnt[SM2_XFER_CLASSES];
+	struct sm2_xfer_entry *free_cache[SM2_XFER_CLASSES][SM2_FREE_CACHE_SIZE];
 };
 
 static inline struct fid_peer_srx *sm2_get_peer_srx(struct sm2_ep *ep)
@@ -317,6 +408,7 @@ static inline uint64_t sm2_rx_cq_flags(uint32_t op, uint64_t rx_flags,
 void sm2_ep_progress(struct util_ep *util_ep);
 
 void sm2_progress_recv(struct sm2_ep *ep);
+void sm2_progress_pend(struct sm2_ep *ep);
 
 int sm2_unexp_start(struct fi_peer_rx_entry *rx_entry);
 
@@ -326,14 +418,64 @@ static inline struct sm2_region *sm2_peer_region(struct sm2_ep *ep, int id)
 	return sm2_mmap_ep_region(ep->mmap, id);
 }
 
-static inline size_t sm2_pop_xfer_entry(struct sm2_ep *ep,
+/*
+ * Take a free xfer_entry of our region with at least len bytes of
+ * user_data, from the smallest class that has one.
+ */
+static inline size_t sm2_pop_xfer_entry(struct sm2_ep *ep, size_t len,
 					struct sm2_xfer_entry **xfer_entry)
 {
-	if (smr_freestack_isempty(sm2_freestack(ep->self_region)))
-		return -FI_EAGAIN;
+	struct smr_freestack *fs;
+	int cls;
+
+	for (cls = 0; cls < SM2_XFER_CLASSES; cls++) {
+		if (sm2_xfer_class_size[cls] - sizeof(struct sm2_xfer_hdr) <
+		    len)
+			continue;
+
+		if (ep->free_cache_cnt[cls]) {
+			*xfer_entry =
+				ep->free_cache[cls][--ep->free_cache_cnt[cls]];
+			return FI_SUCCESS;
+		}
+
+		fs = sm2_freestack(ep->self_region, cls);
+		if (!smr_freestack_isempty(fs)) {
+			*xfer_entry = smr_freestack_pop(fs);
+			return FI_SUCCESS;
+		}
+	}
+
+	return -FI_EAGAIN;
+}
+
+/* Free an xfer_entry of our own region, keeping it in the local cache if
+ * there is room */
+static inline void sm2_push_xfer_entry(struct sm2_ep *ep,
+				       struct sm2_xfer_entry *xfer_entry)
+{
+	int cls = sm2_xfer_class(ep->self_region, xfer_entry);
+
+	if (ep->free_cache_cnt[cls] < SM2_FREE_CACHE_SIZE) {
+		ep->free_cache[cls][ep->free_cache_cnt[cls]++] = xfer_entry;
+		return;
+	}
+
+	smr_freestack_push(sm2_freestack(ep->self_region, cls), xfer_entry);
+}
+
+/* Move the cached entries back to the freestacks, where peers can count
+ * them */
+static inline void sm2_flush_xfer_cache(struct sm2_ep *ep)
+{
+	int cls;
 
-	*xfer_entry = smr_freestack_pop(sm2_freestack(ep->self_region));
-	return FI_SUCCESS;
+	for (cls = 0; cls < SM2_XFER_CLASSES; cls++) {
+		while (ep->free_cache_cnt[cls])
+			smr_freestack_push(
+				sm2_freestack(ep->self_region, cls),
+				ep->free_cache[cls][--ep->free_cache_cnt[cls]]);
+	}
 }
 
 static inline bool sm2_proto_imm_send_comp(uint16_t proto)
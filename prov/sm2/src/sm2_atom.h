@@ -222,6 +222,11 @@ static inline void atomic_wmb(void)
 	atomic_exchange_explicit((_Atomic uintptr_t *) addr, value, \
 				 memory_order_relaxed)
 
+#define atomic_compare_exchange_int(addr, compare, value)      \
+	atomic_compare_exchange_strong_explicit(               \
+		(_Atomic int *) addr, compare, value,          \
+		memory_order_acq_rel, memory_order_acquire)
+
 #elif defined(HAVE_BUILTIN_MM_ATOMICS)
 
 static inline void atomic_mb(void)
@@ -244,6 +249,11 @@ static inline void atomic_wmb(void)
 				    (int64_t) (z), false, __ATOMIC_ACQUIRE, \
 				    __ATOMIC_RELAXED)
 
+#define atomic_compare_exchange_int(x, y, z)                          \
+	__atomic_compare_exchange_n((int *) (x), (int *) (y), (int) (z), \
+				    false, __ATOMIC_ACQ_REL,          \
+				    __ATOMIC_ACQUIRE)
+
 static inline long int atomic_swap_ptr(long int *addr, long int value)
 {
 	long int oldval;
@@ -104,7 +104,7 @@ sm2_do_atomic_inject(struct sm2_ep *ep, int64_t peer_gid, uint32_t op,
 	struct sm2_xfer_entry *xfer_entry;
 	size_t ret;
 
-	ret = sm2_pop_xfer_entry(ep, &xfer_entry);
+	ret = sm2_pop_xfer_entry(ep, SM2_INJECT_SIZE, &xfer_entry);
 	if (ret)
 		return ret;
 
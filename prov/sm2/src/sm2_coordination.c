@@ -34,6 +34,7 @@
 #include "sm2.h"
 #include "sm2_atom.h"
 #include <fcntl.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
@@ -48,7 +49,8 @@
 #define SM2_STARTUP_MAX_TRIES	 1000
 
 static void sm2_file_attempt_shrink(struct sm2_mmap *map);
-int sm2_entry_lookup(const char *name, struct sm2_mmap *map);
+static bool sm2_file_in_use(struct sm2_mmap *map);
+int sm2_entry_lookup(const char *name, struct sm2_mmap *map, int *empty);
 
 /*
  * Sends signal 0 to the pid, if the call succeeds, it means the pid exists.
@@ -196,7 +198,7 @@ ssize_t sm2_file_open_or_create(struct sm2_mmap *map_shared)
 	struct sm2_coord_file_header *header, *tmp_header;
 	struct sm2_ep_allocation_entry *entries;
 	int fd, common_fd, err, tries, item;
-	bool have_file_lock = false;
+	bool have_file = false, have_file_lock = false;
 	long int page_size;
 	long int max_file_size;
 
@@ -271,7 +273,7 @@ ssize_t sm2_file_open_or_create(struct sm2_mmap *map_shared)
 			/* We are using the memory we initialized.  Duplicate it
 			 * and leave the map open. */
 			memcpy(map_shared, &map_ours, sizeof(map_ours));
-			have_file_lock = true;
+			have_file = have_file_lock = true;
 			break;
 		}
 
@@ -286,11 +288,20 @@ ssize_t sm2_file_open_or_create(struct sm2_mmap *map_shared)
 			if (err)
 				break;
 			assert(map_shared->size >= sizeof(*tmp_header));
+
+			/* The lock only guards resetting a file that nobody
+			 * uses, which cannot happen while a peer lives */
+			if (sm2_file_in_use(map_shared)) {
+				sm2_mmap_cleanup(&map_ours);
+				have_file = true;
+				break;
+			}
+
 			err = pthread_mutex_trylock(&tmp_header->write_lock);
 			if (err == 0) {
 				sm2_file_attempt_shrink(map_shared);
 				sm2_mmap_cleanup(&map_ours);
-				have_file_lock = true;
+				have_file = have_file_lock = true;
 				break;
 			}
 
@@ -305,7 +316,7 @@ ssize_t sm2_file_open_or_create(struct sm2_mmap *map_shared)
 
 	unlink(template);
 
-	if (!have_file_lock) {
+	if (!have_file) {
 		FI_WARN(&sm2_prov, FI_LOG_AV,
 			"Failed to acquire the lock to the coordination "
 			"file.\n");
@@ -323,7 +334,8 @@ ssize_t sm2_file_open_or_create(struct sm2_mmap *map_shared)
 	err = sm2_mmap_remap(map_shared, max_file_size);
 
 	/* File we created either became the shared file, or got unlinked */
-	sm2_file_unlock(map_shared);
+	if (have_file_lock)
+		sm2_file_unlock(map_shared);
 	return 0;
 
 early_exit:
@@ -334,32 +346,103 @@ early_exit:
 	return -FI_ENOMEM;
 }
 
+static inline uint32_t sm2_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < FI_NAME_MAX && name[i]; i++)
+		hash = (hash ^ (uint8_t) name[i]) * 16777619u;
+	return hash;
+}
+
+static inline int sm2_entry_state(struct sm2_ep_allocation_entry *entry)
+{
+	int state = *(volatile int *) &entry->state;
+
+	atomic_rmb();
+	return state;
+}
+
+static inline int sm2_entry_pid(struct sm2_ep_allocation_entry *entry)
+{
+	return *(volatile int *) &entry->pid;
+}
+
+/* Write the name of an entry held in the NAMING state and publish it */
+static inline void sm2_entry_set_name(struct sm2_ep_allocation_entry *entry,
+				      const char *name)
+{
+	strncpy(entry->ep_name, name, FI_NAME_MAX - 1);
+	entry->ep_name[FI_NAME_MAX - 1] = '\0';
+	atomic_wmb();
+	entry->state = SM2_ENTRY_NAMED;
+}
+
+/* Rename a named entry.  Fails if another process is renaming it. */
+static inline bool sm2_entry_rename(struct sm2_ep_allocation_entry *entry,
+				    const char *name)
+{
+	int state = SM2_ENTRY_NAMED;
+
+	if (!atomic_compare_exchange_int(&entry->state, &state,
+					 SM2_ENTRY_NAMING))
+		return false;
+	sm2_entry_set_name(entry, name);
+	return true;
+}
+
+/*
+ * Move the pid of an entry from old to -getpid().  When claiming the entry
+ * for ourselves, startup_ready is cleared before our pid is published so
+ * that peers never act on a flag left by a previous owner.
+ */
+static inline bool sm2_entry_claim(struct sm2_ep_allocation_entry *entry,
+				   int old, bool self)
+{
+	int pid = getpid();
+
+	if (!atomic_compare_exchange_int(&entry->pid, &old, -pid))
+		return false;
+
+	if (self) {
+		entry->startup_ready = 0;
+		atomic_wmb();
+		entry->pid = pid;
+	}
+	return true;
+}
+
 /*
- * Insert the name into the ep_allocation array.  Requires the lock.
+ * Insert the name into the ep_allocation array.  Entries are claimed with
+ * compare-and-swap on their state and pid, so no lock is needed.
  *
  * Note: that because of speculative av_insert operations, we may need to
  * assign an index for an endpoint claimed by another peer.
  * When self == true, we will "own" the entry (entry.pid = getpid()).
  * When False, we set pid = -getpid(), allowing owner to claim later.
+ *
+ * Entries are only emptied when the file is reset, so once every entry is
+ * named, a lookup visits all of them and a name may be reused anywhere.
  */
 ssize_t sm2_entry_allocate(const char *name, struct sm2_mmap *map,
 			   sm2_gid_t *gid, bool self)
 {
 	struct sm2_ep_allocation_entry *entries;
 	struct sm2_region *peer_region = NULL;
-	int item, pid = getpid(), peer_pid;
+	int item, empty, state, peer_pid;
 
 	entries = sm2_mmap_entries(map);
 
 retry_lookup:
-	item = sm2_entry_lookup(name, map);
+	item = sm2_entry_lookup(name, map, &empty);
 	if (item >= 0) {
-		entries = sm2_mmap_entries(map);
+		peer_pid = sm2_entry_pid(&entries[item]);
 
 		/* Check if it is dirty */
-		if (entries[item].pid && !pid_lives(abs(entries[item].pid))) {
+		if (peer_pid && !pid_lives(abs(peer_pid))) {
 			peer_region = sm2_mmap_ep_region(map, item);
-			if (!smr_freestack_isfull(sm2_freestack(peer_region))) {
+			if (!sm2_freestacks_full(peer_region)) {
 				/* Region did not shut down properly, but other
 				 * processes might be using it, make it a zombie
 				 * region - never use this region for as long as
@@ -371,29 +454,32 @@ retry_lookup:
 					"(until all active processes die, and "
 					"file size is reset)!\n",
 					item);
-				strncpy(entries[item].ep_name,
-					ZOMBIE_ALLOCATION_NAME, FI_NAME_MAX);
+				(void) sm2_entry_rename(&entries[item],
+							ZOMBIE_ALLOCATION_NAME);
 				goto retry_lookup;
 			}
 		}
 
 		if (!self) {
-			if (!pid_lives(abs(entries[item].pid))) {
-				entries[item].pid = 0;
-			}
-			/* Someone else allocated the entry for us */
+			/* Someone else allocated the entry for us, otherwise
+			 * reserve it until the owner claims it */
+			if ((!peer_pid || !pid_lives(abs(peer_pid))) &&
+			    !sm2_entry_claim(&entries[item], peer_pid, false))
+				goto retry_lookup;
 			goto found;
 		}
 
-		if (entries[item].pid <= 0) {
-			if (!pid_lives(abs(entries[item].pid))) {
+		if (peer_pid <= 0) {
+			if (peer_pid && !pid_lives(-peer_pid)) {
 				FI_WARN(&sm2_prov, FI_LOG_AV,
 					"During sm2 allocation of space for "
 					"endpoint named %s pid %d "
 					"pre-allocated space at allocation "
 					"entry[%d] and then died!\n",
-					name, -entries[item].pid, item);
+					name, -peer_pid, item);
 			}
+			if (!sm2_entry_claim(&entries[item], peer_pid, true))
+				goto retry_lookup;
 			goto found;
 		}
 
@@ -403,7 +489,7 @@ retry_lookup:
 			"allocation entry[%d]\n",
 			name, item);
 
-		if (!pid_lives(entries[item].pid)) {
+		if (!pid_lives(peer_pid)) {
 			FI_WARN(&sm2_prov, FI_LOG_AV,
 				"The pid which allocated the conflicting "
 				"allocation entry is "
@@ -411,21 +497,36 @@ retry_lookup:
 			/* it is possible that EP's referencing this region are
 			 * still alive... don't know how to check (they likely
 			 * died if PID died) */
+			if (!sm2_entry_claim(&entries[item], peer_pid, true))
+				goto retry_lookup;
 			goto found;
 		}
 
 		FI_WARN(&sm2_prov, FI_LOG_AV,
 			"ERROR: The endpoint (pid: %d) with conflicting "
 			"address %s is still alive.\n",
-			entries[item].pid, name);
+			peer_pid, name);
 		return -FI_EADDRINUSE;
 	}
 
-	/* fine, we could not find the entry, so now look for an empty slot */
+	/* fine, we could not find the entry, so take the empty slot that
+	 * ended the lookup.  If another process takes it first, it may be
+	 * adding the same name, so look again. */
+	if (empty >= 0) {
+		state = SM2_ENTRY_EMPTY;
+		if (!atomic_compare_exchange_int(&entries[empty].state, &state,
+						 SM2_ENTRY_NAMING))
+			goto retry_lookup;
+
+		item = empty;
+		(void) sm2_entry_claim(&entries[item], 0, self);
+		sm2_entry_set_name(&entries[item], name);
+		goto found;
+	}
+
+	/* every entry is named, reuse one whose owner has gone */
 	for (item = 0; item < SM2_MAX_UNIVERSE_SIZE; item++) {
-		peer_pid = entries[item].pid;
-		if (peer_pid == 0)
-			goto found;
+		peer_pid = sm2_entry_pid(&entries[item]);
 		if (peer_pid < 0)
 			/* A third peer might have entered this address into
 			 * their AV, and there is no current way to check
@@ -433,19 +534,31 @@ retry_lookup:
 			 * clean up */
 			continue;
 
-		if (!pid_lives(peer_pid)) {
-			entries = sm2_mmap_entries(map);
-			struct sm2_region *peer_region =
-				sm2_mmap_ep_region(map, item);
-
-			if (entries[item].startup_ready &&
-			    smr_freestack_isfull(sm2_freestack(peer_region))) {
-				/* we found a slot with a dead PID and
-				 * the freestack is full */
-				entries[item].pid = 0;
-				goto found;
-			}
+		if (peer_pid) {
+			if (pid_lives(peer_pid))
+				continue;
+
+			/* the owner died, reuse the region only if it was
+			 * ready and all of its xfer entries came back */
+			peer_region = sm2_mmap_ep_region(map, item);
+			if (!entries[item].startup_ready ||
+			    !sm2_freestacks_full(peer_region))
+				continue;
+		}
+
+		if (!sm2_entry_claim(&entries[item], peer_pid, self))
+			continue;
+
+		while (!sm2_entry_rename(&entries[item], name))
+			sched_yield();
+
+		/* Another process may have reused an entry for the same name
+		 * meanwhile; the first one in probe order is kept */
+		if (sm2_entry_lookup(name, map, NULL) != item) {
+			entries[item].pid = 0;
+			goto retry_lookup;
 		}
+		goto found;
 	}
 
 	FI_WARN(&sm2_prov, FI_LOG_AV,
@@ -455,61 +568,57 @@ retry_lookup:
 	return -FI_EAVAIL;
 
 found:
-	if (self) {
-		entries[item].startup_ready = 0;
-		atomic_wmb();
-		entries[item].pid = pid;
-	}
-
-	if (!self && entries[item].pid == 0) {
-		entries[item].startup_ready = 0;
-		atomic_wmb();
-		entries[item].pid = -pid;
-	}
-
 	FI_INFO(&sm2_prov, FI_LOG_AV,
 		"Using sm2 region at allocation entry[%d] for %s\n", item,
 		name);
 
-	strncpy(entries[item].ep_name, name, FI_NAME_MAX - 1);
-	entries[item].ep_name[FI_NAME_MAX - 1] = '\0';
-
 	*gid = item;
 
 	return 0;
 }
 
-int sm2_entry_lookup(const char *name, struct sm2_mmap *map)
+/*
+ * Find the entry with this name, probing from the slot given by its hash.
+ * If it is not found, empty is set to the slot that ended the probe, or -1
+ * if every slot is named.
+ */
+int sm2_entry_lookup(const char *name, struct sm2_mmap *map, int *empty)
 {
 	struct sm2_ep_allocation_entry *entries;
-	int item;
+	int i, item, state, tries;
 
 	entries = sm2_mmap_entries(map);
-	/* TODO Optimize this lookup*/
-	for (item = 0; item < SM2_MAX_UNIVERSE_SIZE; item++) {
-		if (0 == strncmp(name, entries[item].ep_name, FI_NAME_MAX)) {
+	item = sm2_name_hash(name) % SM2_MAX_UNIVERSE_SIZE;
+	for (i = 0; i < SM2_MAX_UNIVERSE_SIZE;
+	     i++, item = (item + 1) % SM2_MAX_UNIVERSE_SIZE) {
+		/* wait for a name being written, unless its writer died */
+		tries = SM2_STARTUP_MAX_TRIES;
+		while ((state = sm2_entry_state(&entries[item])) ==
+			       SM2_ENTRY_NAMING &&
+		       tries-- > 0)
+			sched_yield();
+
+		if (state == SM2_ENTRY_EMPTY) {
+			if (empty)
+				*empty = item;
+			return -1;
+		}
+
+		if (state == SM2_ENTRY_NAMED &&
+		    0 == strncmp(name, entries[item].ep_name, FI_NAME_MAX)) {
 			FI_DBG(&sm2_prov, FI_LOG_AV,
 			       "Found existing %s in slot %d\n", name, item);
 			return item;
 		}
-		if (entries[item].ep_name[0] != '\0') {
-			FI_DBG(&sm2_prov, FI_LOG_AV,
-			       "Searching for %s. Not yet found in spot "
-			       "allocation[%d]=%s, PID=%d\n",
-			       name, item, entries[item].ep_name,
-			       entries[item].pid);
-		} else if (!strcmp(entries[item].ep_name,
-				   ZOMBIE_ALLOCATION_NAME)) {
-			FI_DBG(&sm2_prov, FI_LOG_AV,
-			       "Found zombie in spot allocation[%d], PID= %d\n",
-			       item, entries[item].pid);
-		}
 	}
+
+	if (empty)
+		*empty = -1;
 	return -1;
 }
 
 /*
- * Clear the pid for this entry.  must already hold lock.
+ * Clear the pid for this entry.
  */
 void sm2_entry_free(struct sm2_mmap *map, sm2_gid_t gid)
 {
@@ -586,21 +695,30 @@ out:
  *
  * NOTE: SHM file lock must be held before calling this function
  */
-static void sm2_file_attempt_shrink(struct sm2_mmap *map)
+static bool sm2_file_in_use(struct sm2_mmap *map)
 {
-	struct sm2_coord_file_header *header = (void *) map->base;
 	struct sm2_ep_allocation_entry *entries = sm2_mmap_entries(map);
-	int item;
+	int item, pid;
 
 	for (item = 0; item < SM2_MAX_UNIVERSE_SIZE; item++) {
-		if (entries[item].pid != 0 &&
-		    pid_lives(abs(entries[item].pid))) {
+		pid = sm2_entry_pid(&entries[item]);
+		if (pid != 0 && pid_lives(abs(pid))) {
 			FI_INFO(&sm2_prov, FI_LOG_AV,
 				"Cannot shrink file b/c PID %d still lives",
-				abs(entries[item].pid));
-			return;
+				abs(pid));
+			return true;
 		}
 	}
+	return false;
+}
+
+static void sm2_file_attempt_shrink(struct sm2_mmap *map)
+{
+	struct sm2_coord_file_header *header = (void *) map->base;
+	struct sm2_ep_allocation_entry *entries = sm2_mmap_entries(map);
+
+	if (sm2_file_in_use(map))
+		return;
 
 	memset(entries, 0, sizeof(*entries) * SM2_MAX_UNIVERSE_SIZE);
 	sm2_mmap_shrink_to_size(map, header->ep_regions_offset);
@@ -52,8 +52,23 @@
 #define SM2_MAX_UNIVERSE_SIZE 256
 /* TODO: Tune max GDRCopy size for SM2 */
 #define SM2_MAX_GDRCOPY_SIZE 3072
+
+/*
+ * xfer_entries come in size classes, each with its own freestack in the
+ * region, so small messages take short entries.  The largest class is
+ * SM2_XFER_ENTRY_SIZE.  Sizes and counts are in sm2_xfer_class_size and
+ * sm2_xfer_class_count.
+ */
+enum {
+	SM2_XFER_SMALL,
+	SM2_XFER_MEDIUM,
+	SM2_XFER_LARGE,
+	SM2_XFER_CLASSES,
+};
+
+extern const size_t sm2_xfer_class_size[SM2_XFER_CLASSES];
 /* TODO: Make the number of XFER ENTRY's configurable */
-#define SM2_NUM_XFER_ENTRY_PER_PEER 1024
+extern const size_t sm2_xfer_class_count[SM2_XFER_CLASSES];
 
 typedef unsigned int sm2_gid_t;
 
@@ -63,10 +78,19 @@ struct sm2_mmap {
 	int fd;
 };
 
+/* Allocation entry states.  Entries are placed by a hash of their name
+ * and probed linearly; an empty entry ends the probe sequence. */
+enum {
+	SM2_ENTRY_EMPTY,
+	SM2_ENTRY_NAMING, /* name being written by the claiming process */
+	SM2_ENTRY_NAMED,
+};
+
 struct sm2_ep_allocation_entry {
+	int state;
 	int pid; /* This is for allocation startup */
 	char ep_name[FI_NAME_MAX];
-	bool startup_ready; /* TODO Do I need to make atomic */
+	bool startup_ready; /* only valid while pid is positive */
 };
 
 struct sm2_coord_file_header {
@@ -91,7 +115,7 @@ struct sm2_region {
 
 	/* offsets from start of sm2_region */
 	ptrdiff_t recv_queue_offset;
-	ptrdiff_t freestack_offset;
+	ptrdiff_t freestack_offset[SM2_XFER_CLASSES];
 };
 
 size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset);
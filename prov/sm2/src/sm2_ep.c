@@ -109,6 +109,15 @@ static int sm2_ep_getopt(fid_t fid, int level, int optname, void *optval,
 			 size_t *optlen)
 {
 	struct sm2_ep *ep = container_of(fid, struct sm2_ep, util_ep.ep_fid);
+
+	if (!ep->srx && level == FI_OPT_ENDPOINT &&
+	    optname == FI_OPT_TAG_BUCKETS) {
+		*(size_t *) optval = ep->tag_buckets ?
+			ofi_tag_bucket_mask(ep->tag_buckets) + 1 : 0;
+		*optlen = sizeof(size_t);
+		return FI_SUCCESS;
+	}
+
 	return ep->srx->ops->getopt(&ep->srx->fid, level, optname, optval,
 				    optlen);
 }
@@ -128,6 +137,17 @@ static int sm2_ep_setopt(fid_t fid, int level, int optname, const void *optval,
 		return FI_SUCCESS;
 	}
 
+	/* The receive context is created when the endpoint is enabled */
+	if (optname == FI_OPT_TAG_BUCKETS) {
+		if (optlen != sizeof(size_t))
+			return -FI_EINVAL;
+		if (ep->srx)
+			return -FI_EOPBADSTATE;
+
+		ep->tag_buckets = *(size_t *) optval;
+		return FI_SUCCESS;
+	}
+
 	if (optname == FI_OPT_CUDA_API_PERMITTED) {
 		if (!hmem_ops[FI_HMEM_CUDA].initialized) {
 			FI_WARN(&sm2_prov, FI_LOG_CORE,
@@ -174,8 +194,9 @@ ssize_t sm2_verify_peer(struct sm2_ep *ep, fi_addr_t fi_addr, sm2_gid_t *gid)
 		return -FI_EINVAL;
 
 	entries = sm2_mmap_entries(ep->mmap);
-	/* TODO... should this be atomic? */
-	if (entries[*gid].startup_ready == false)
+	/* startup_ready is left over from an earlier owner unless the
+	 * entry is held by a live process */
+	if (entries[*gid].pid <= 0 || entries[*gid].startup_ready == false)
 		return -FI_EAGAIN;
 
 	/* TODO: Check for PID that changes */
@@ -202,7 +223,7 @@ static ssize_t sm2_do_inject(struct sm2_ep *ep, struct sm2_region *peer_smr,
 
 	assert(total_len <= SM2_INJECT_SIZE);
 
-	ret = sm2_pop_xfer_entry(ep, &xfer_entry);
+	ret = sm2_pop_xfer_entry(ep, total_len, &xfer_entry);
 	if (ret)
 		return ret;
 
@@ -235,7 +256,7 @@ static ssize_t sm2_do_cma(struct sm2_ep *ep, struct sm2_region *peer_smr,
 	ssize_t ret;
 	struct sm2_xfer_entry *xfer_entry;
 
-	ret = sm2_pop_xfer_entry(ep, &xfer_entry);
+	ret = sm2_pop_xfer_entry(ep, sizeof(struct sm2_cma_data), &xfer_entry);
 	if (ret)
 		return ret;
 
@@ -285,7 +306,7 @@ static ssize_t sm2_do_ipc(struct sm2_ep *ep, struct sm2_region *peer_smr,
 	struct sm2_xfer_entry *xfer_entry;
 	ssize_t ret;
 
-	ret = sm2_pop_xfer_entry(ep, &xfer_entry);
+	ret = sm2_pop_xfer_entry(ep, sizeof(struct ipc_info), &xfer_entry);
 	if (ret)
 		return ret;
 
@@ -297,7 +318,7 @@ static ssize_t sm2_do_ipc(struct sm2_ep *ep, struct sm2_region *peer_smr,
 	if (ret) {
 		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
 			"Error generating IPC header information\n");
-		smr_freestack_push(sm2_freestack(ep->self_region), xfer_entry);
+		sm2_push_xfer_entry(ep, xfer_entry);
 		return ret;
 	}
 
@@ -310,12 +331,17 @@ static void cleanup_shm_resources(struct sm2_ep *ep)
 	struct sm2_xfer_entry *xfer_entry;
 	bool retry = true;
 
+	/* Receives already being copied are finished first, since their
+	 * xfer_entries belong to the senders */
+	while (!dlist_empty(&ep->cma_pend_list) ||
+	       !dlist_empty(&ep->ipc_pend_list))
+		sm2_progress_pend(ep);
+
 	/* Return all free queue entries in queue without processing them */
 return_incoming:
 	while (NULL != (xfer_entry = sm2_fifo_read(ep))) {
 		if (xfer_entry->hdr.proto_flags & SM2_RETURN) {
-			smr_freestack_push(sm2_freestack(ep->self_region),
-					   xfer_entry);
+			sm2_push_xfer_entry(ep, xfer_entry);
 		} else {
 			/* TODO Tell other side that we haven't processed their
 			 * message, just returned xfer_entry */
@@ -324,7 +350,8 @@ return_incoming:
 		}
 	}
 
-	if (smr_freestack_isfull(sm2_freestack(ep->self_region))) {
+	sm2_flush_xfer_cache(ep);
+	if (sm2_freestacks_full(ep->self_region)) {
 		/* TODO Set head/tail of FIFO queue to show peers we aren't
 		   accepting new entires */
 		FI_INFO(&sm2_prov, FI_LOG_EP_CTRL,
@@ -363,14 +390,14 @@ static int sm2_ep_close(struct fid *fid)
 	 */
 	/* TODO Do we want to mark our entry as zombie now if we don't have all
 	   our xfer_entry? */
-	if (smr_freestack_isfull(sm2_freestack(ep->self_region))) {
-		sm2_file_lock(ep->mmap);
+	if (sm2_freestacks_full(ep->self_region)) {
 		sm2_entry_free(ep->mmap, ep->gid);
-		sm2_file_unlock(ep->mmap);
 	}
 
 	if (ep->xfer_ctx_pool)
 		ofi_bufpool_destroy(ep->xfer_ctx_pool);
+	if (ep->pend_pool)
+		ofi_bufpool_destroy(ep->pend_pool);
 
 	free((void *) ep->name);
 	free(ep);
@@ -385,7 +412,11 @@ static int sm2_ep_trywait(void *arg)
 
 	sm2_ep_progress(&ep->util_ep);
 
-	return FI_SUCCESS;
+	/* queued copies only advance when the endpoint is progressed */
+	return dlist_empty(&ep->cma_pend_list) &&
+			       dlist_empty(&ep->ipc_pend_list) ?
+		       FI_SUCCESS :
+		       -FI_EAGAIN;
 }
 
 static int sm2_ep_bind_cq(struct sm2_ep *ep, struct util_cq *cq, uint64_t flags)
@@ -546,7 +577,8 @@ static int sm2_ep_ctrl(struct fid *fid, int command, void *arg)
 					      util_domain.domain_fid);
 			ret = util_ep_srx_context(&domain->util_domain,
 						  ep->rx_size, SM2_IOV_LIMIT,
-						  SM2_INJECT_SIZE, &sm2_update,
+						  SM2_INJECT_SIZE,
+						  ep->tag_buckets, &sm2_update,
 						  &ep->util_ep.lock, &ep->srx);
 			if (ret)
 				return ret;
@@ -627,6 +659,9 @@ int sm2_endpoint(struct fid_domain *domain, struct fi_info *info,
 
 	ep->tx_size = info->tx_attr->size;
 	ep->rx_size = info->rx_attr->size;
+	ep->tag_buckets = ofi_srx_tag_buckets;
+	ep->recv_next = SM2_FIFO_FREE;
+	ep->recv_last = SM2_FIFO_FREE;
 	ret = ofi_endpoint_init(domain, &sm2_util_prov, info, &ep->util_ep,
 				context, sm2_ep_progress);
 	if (ret)
@@ -644,6 +679,17 @@ int sm2_endpoint(struct fid_domain *domain, struct fi_info *info,
 		return -FI_ENOMEM;
 	}
 
+	dlist_init(&ep->cma_pend_list);
+	dlist_init(&ep->ipc_pend_list);
+	ret = ofi_bufpool_create(&ep->pend_pool,
+				 sizeof(struct sm2_pend_entry), 16, 0, 0,
+				 OFI_BUFPOOL_NO_TRACK);
+	if (ret) {
+		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
+			"Unable to create pending copy pool\n");
+		return -FI_ENOMEM;
+	}
+
 	ep->util_ep.ep_fid.fid.ops = &sm2_ep_fi_ops;
 	ep->util_ep.ep_fid.ops = &sm2_ep_ops;
 	ep->util_ep.ep_fid.cm = &sm2_cm_ops;
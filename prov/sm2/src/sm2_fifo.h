@@ -161,13 +161,16 @@ static inline void sm2_fifo_init(struct sm2_fifo *fifo)
 	fifo->tail = SM2_FIFO_FREE;
 }
 
-/* Write, Enqueue */
-static inline void sm2_fifo_write(struct sm2_ep *ep, sm2_gid_t peer_gid,
-				  struct sm2_xfer_entry *xfer_entry)
+/* Write, Enqueue: append the chain first..last, already linked through
+ * hdr.next, with one exchange of the peer's tail */
+static inline void sm2_fifo_write_chain(struct sm2_ep *ep, sm2_gid_t peer_gid,
+					struct sm2_xfer_entry *first,
+					struct sm2_xfer_entry *last)
 {
 	struct sm2_region *peer_region = sm2_mmap_ep_region(ep->mmap, peer_gid);
 	struct sm2_fifo *peer_fifo = sm2_recv_queue(peer_region);
-	long int offset = sm2_absptr_to_relptr(xfer_entry, ep->mmap);
+	long int offset = sm2_absptr_to_relptr(first, ep->mmap);
+	long int last_offset = sm2_absptr_to_relptr(last, ep->mmap);
 	struct sm2_xfer_entry *prev_xfer_entry;
 	long int prev;
 
@@ -175,13 +178,13 @@ static inline void sm2_fifo_write(struct sm2_ep *ep, sm2_gid_t peer_gid,
 	assert(peer_fifo->tail != 0);
 	assert(offset != 0);
 
-	xfer_entry->hdr.next = SM2_FIFO_FREE;
+	last->hdr.next = SM2_FIFO_FREE;
 
 	atomic_wmb();
-	prev = atomic_swap_ptr(&peer_fifo->tail, offset);
+	prev = atomic_swap_ptr(&peer_fifo->tail, last_offset);
 	atomic_rmb();
 
-	assert(prev != offset);
+	assert(prev != last_offset);
 
 	if (SM2_FIFO_FREE != prev) {
 		prev_xfer_entry = sm2_relptr_to_absptr(prev, ep->mmap);
@@ -193,52 +196,121 @@ static inline void sm2_fifo_write(struct sm2_ep *ep, sm2_gid_t peer_gid,
 	atomic_wmb();
 }
 
-/* Read, Dequeue */
-static inline struct sm2_xfer_entry *sm2_fifo_read(struct sm2_ep *ep)
+static inline void sm2_fifo_write(struct sm2_ep *ep, sm2_gid_t peer_gid,
+				  struct sm2_xfer_entry *xfer_entry)
+{
+	sm2_fifo_write_chain(ep, peer_gid, xfer_entry, xfer_entry);
+}
+
+/* Detach every queued entry with one exchange of tail.  The chain is
+ * handed out one entry at a time by sm2_fifo_read.
+ */
+static inline bool sm2_fifo_detach(struct sm2_ep *ep)
 {
 	struct sm2_fifo *self_fifo = sm2_recv_queue(ep->self_region);
-	struct sm2_xfer_entry *xfer_entry;
-	uintptr_t prev_head;
 
 	assert(self_fifo->head != 0);
 	assert(self_fifo->tail != 0);
+	assert(ep->recv_next == SM2_FIFO_FREE);
 
 	if (SM2_FIFO_FREE == self_fifo->head)
-		return NULL;
+		return false;
 
 	atomic_rmb();
 
-	prev_head = self_fifo->head;
-	xfer_entry = (struct sm2_xfer_entry *) sm2_relptr_to_absptr(prev_head,
-								    ep->mmap);
+	/* A writer that finds tail free after the exchange sets head, so
+	 * head must be cleared first */
+	ep->recv_next = self_fifo->head;
 	self_fifo->head = SM2_FIFO_FREE;
+	ep->recv_last = atomic_swap_ptr(&self_fifo->tail, SM2_FIFO_FREE);
+
+	assert(ep->recv_last != SM2_FIFO_FREE);
+	return true;
+}
+
+/* Read, Dequeue */
+static inline struct sm2_xfer_entry *sm2_fifo_read(struct sm2_ep *ep)
+{
+	struct sm2_xfer_entry *xfer_entry;
+	long int cur;
+
+	if (SM2_FIFO_FREE == ep->recv_next && !sm2_fifo_detach(ep))
+		return NULL;
 
-	assert(xfer_entry->hdr.next != prev_head);
+	cur = ep->recv_next;
+	xfer_entry = (struct sm2_xfer_entry *) sm2_relptr_to_absptr(cur,
+								    ep->mmap);
 	assert(xfer_entry != 0);
-	assert(xfer_entry->hdr.next != 0);
-
-	if (SM2_FIFO_FREE == xfer_entry->hdr.next) {
-		atomic_rmb();
-		if (!atomic_compare_exchange(&self_fifo->tail, &prev_head,
-					     SM2_FIFO_FREE)) {
-			while (SM2_FIFO_FREE == xfer_entry->hdr.next)
-				atomic_rmb();
-			self_fifo->head = xfer_entry->hdr.next;
-		}
+
+	if (cur == ep->recv_last) {
+		ep->recv_next = SM2_FIFO_FREE;
 	} else {
-		self_fifo->head = xfer_entry->hdr.next;
+		/* The writer links an entry after publishing it in tail */
+		while (SM2_FIFO_FREE == xfer_entry->hdr.next)
+			atomic_rmb();
+		assert(xfer_entry->hdr.next != cur);
+		assert(xfer_entry->hdr.next != 0);
+		ep->recv_next = xfer_entry->hdr.next;
+		OFI_PREFETCH(sm2_relptr_to_absptr(ep->recv_next, ep->mmap));
 	}
 
-	atomic_wmb();
+	atomic_rmb();
 	return xfer_entry;
 }
 
+/* Returns made while a batch is open are chained per sender and written
+ * when the batch is flushed */
+struct sm2_fifo_batch {
+	int cnt;
+	struct {
+		sm2_gid_t gid;
+		struct sm2_xfer_entry *first;
+		struct sm2_xfer_entry *last;
+	} peer[MAX_SM2_MSGS_PROGRESSED];
+};
+
+static inline void sm2_fifo_batch_flush(struct sm2_ep *ep,
+					struct sm2_fifo_batch *batch)
+{
+	int i;
+
+	for (i = 0; i < batch->cnt; i++)
+		sm2_fifo_write_chain(ep, batch->peer[i].gid,
+				     batch->peer[i].first, batch->peer[i].last);
+	batch->cnt = 0;
+}
+
 static inline void sm2_fifo_write_back(struct sm2_ep *ep,
 				       struct sm2_xfer_entry *xfer_entry)
 {
+	struct sm2_fifo_batch *batch = ep->return_batch;
+	sm2_gid_t gid = xfer_entry->hdr.sender_gid;
+	int i;
+
 	xfer_entry->hdr.proto_flags |= SM2_RETURN;
-	assert(xfer_entry->hdr.sender_gid != ep->gid);
-	sm2_fifo_write(ep, xfer_entry->hdr.sender_gid, xfer_entry);
+	assert(gid != ep->gid);
+
+	if (!batch) {
+		sm2_fifo_write(ep, gid, xfer_entry);
+		return;
+	}
+
+	for (i = 0; i < batch->cnt; i++) {
+		if (batch->peer[i].gid == gid) {
+			batch->peer[i].last->hdr.next =
+				sm2_absptr_to_relptr(xfer_entry, ep->mmap);
+			batch->peer[i].last = xfer_entry;
+			return;
+		}
+	}
+
+	if (batch->cnt == MAX_SM2_MSGS_PROGRESSED)
+		sm2_fifo_batch_flush(ep, batch);
+
+	batch->peer[batch->cnt].gid = gid;
+	batch->peer[batch->cnt].first = xfer_entry;
+	batch->peer[batch->cnt].last = xfer_entry;
+	batch->cnt++;
 }
 
 static inline void
@@ -38,9 +38,23 @@
 #include <ofi_hmem.h>
 #include <ofi_prov.h>
 
+const size_t sm2_xfer_class_size[SM2_XFER_CLASSES] = {
+	[SM2_XFER_SMALL] = 256,
+	[SM2_XFER_MEDIUM] = 1024,
+	[SM2_XFER_LARGE] = SM2_XFER_ENTRY_SIZE,
+};
+
+const size_t sm2_xfer_class_count[SM2_XFER_CLASSES] = {
+	[SM2_XFER_SMALL] = 2048,
+	[SM2_XFER_MEDIUM] = 1024,
+	[SM2_XFER_LARGE] = 512,
+};
+
+/* fs_offset, if given, receives the offset of each class's freestack */
 size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset)
 {
 	size_t total_size;
+	int i;
 
 	total_size = sizeof(struct sm2_region);
 
@@ -48,10 +62,13 @@ size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset)
 		*rq_offset = total_size;
 	total_size += sizeof(struct sm2_fifo);
 
-	if (fs_offset)
-		*fs_offset = total_size;
-	total_size += freestack_size(sizeof(struct sm2_xfer_entry),
-				     SM2_NUM_XFER_ENTRY_PER_PEER);
+	for (i = 0; i < SM2_XFER_CLASSES; i++) {
+		total_size = ofi_get_aligned_size(total_size, 8);
+		if (fs_offset)
+			fs_offset[i] = total_size;
+		total_size += freestack_size(sm2_xfer_class_size[i],
+					     sm2_xfer_class_count[i]);
+	}
 
 	return total_size;
 }
@@ -60,23 +77,21 @@ int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 	       struct sm2_mmap *sm2_mmap, sm2_gid_t *gid)
 {
 	struct sm2_ep_name *ep_name;
-	ptrdiff_t recv_queue_offset, freestack_offset;
-	int ret;
+	ptrdiff_t recv_queue_offset, freestack_offset[SM2_XFER_CLASSES];
+	int ret, i;
 	void *mapped_addr;
 	struct sm2_region *smr;
 
-	sm2_calculate_size_offsets(&recv_queue_offset, &freestack_offset);
+	sm2_calculate_size_offsets(&recv_queue_offset, freestack_offset);
 
 	FI_INFO(prov, FI_LOG_EP_CTRL, "Claiming an entry for (%s)\n",
 		attr->name);
-	sm2_file_lock(sm2_mmap);
 	ret = sm2_entry_allocate(attr->name, sm2_mmap, gid, true);
 
 	if (ret) {
 		FI_WARN(prov, FI_LOG_EP_CTRL,
 			"Failed to allocate an entry in the SHM file for "
 			"ourselves\n");
-		sm2_file_unlock(sm2_mmap);
 		return ret;
 	}
 
@@ -107,30 +122,29 @@ int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 	smr->version = SM2_VERSION;
 	smr->flags = attr->flags;
 	smr->recv_queue_offset = recv_queue_offset;
-	smr->freestack_offset = freestack_offset;
 
 	sm2_fifo_init(sm2_recv_queue(smr));
-	smr_freestack_init(sm2_freestack(smr), SM2_NUM_XFER_ENTRY_PER_PEER,
-			   sizeof(struct sm2_xfer_entry));
+	for (i = 0; i < SM2_XFER_CLASSES; i++) {
+		smr->freestack_offset[i] = freestack_offset[i];
+		smr_freestack_init(sm2_freestack(smr, i),
+				   sm2_xfer_class_count[i],
+				   sm2_xfer_class_size[i]);
+	}
 
 	/*
 	 * Need to set PID in header here...
 	 * this will unblock other processes trying to send to us
 	 */
 	assert(sm2_mmap_entries(sm2_mmap)[*gid].pid == getpid());
+	atomic_wmb();
 	sm2_mmap_entries(sm2_mmap)[*gid].startup_ready = true;
 	atomic_wmb();
 
-	/* Need to unlock coordinator so that others can add themselves to
-	 * header */
-	sm2_file_unlock(sm2_mmap);
-
 	FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
 		"Created sm2 endpoint at allocation[%d]\n", *gid);
 	return 0;
 
 remove:
-	sm2_file_unlock(sm2_mmap);
 	free(ep_name);
 	return ret;
 }
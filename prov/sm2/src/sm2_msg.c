@@ -47,23 +47,21 @@ static inline int sm2_select_proto(void **desc, size_t iov_count,
 	if (desc && *desc) {
 		sm2_desc = (struct ofi_mr *) *desc;
 		iface = sm2_desc->iface;
-		if (iface == FI_HMEM_CUDA) {
-			if ((sm2_desc->flags & OFI_HMEM_DATA_DEV_REG_HANDLE) &&
-			    (total_len <= SM2_MAX_GDRCOPY_SIZE)) {
-				assert(sm2_desc->hmem_data);
-				return sm2_proto_inject;
-			}
-			/* Do not inject if IPC is available so device to device
-			 * transfer may occur if possible. */
-			/* TODO - multi IOV support */
-			if (iov_count == 1 && desc && desc[0]) {
-				if (ofi_hmem_is_ipc_enabled(iface) &&
-				    sm2_desc->flags & FI_HMEM_DEVICE_ONLY &&
-				    !(op_flags & FI_INJECT)) {
-					return sm2_proto_ipc;
-				}
-			}
+		if ((sm2_desc->flags & OFI_HMEM_DATA_DEV_REG_HANDLE) &&
+		    (total_len <= SM2_MAX_GDRCOPY_SIZE)) {
+			assert(sm2_desc->hmem_data);
+			return sm2_proto_inject;
 		}
+		/* Do not inject if IPC is available so device to device
+		 * transfer may occur if possible.  ZE handles can only be
+		 * opened through a file descriptor passed over a socket,
+		 * which sm2 does not set up. */
+		/* TODO - multi IOV support */
+		if (iov_count == 1 && iface != FI_HMEM_ZE &&
+		    ofi_hmem_is_ipc_enabled(iface) &&
+		    sm2_desc->flags & FI_HMEM_DEVICE_ONLY &&
+		    !(op_flags & FI_INJECT))
+			return sm2_proto_ipc;
 	}
 
 	if (total_len <= SM2_INJECT_SIZE)
@@ -102,12 +102,13 @@ static int sm2_cma_send_ipc_handle(struct sm2_ep *ep,
 		 * ofi_bufpool entry in the receiver memory which the sender
 		 * can't read. So we create a new xfer_entry and send it instead
 		 */
-		ret = sm2_pop_xfer_entry(ep, &new_xfer_entry);
+		ret = sm2_pop_xfer_entry(ep, sizeof(*cma_data),
+					 &new_xfer_entry);
 		if (ret)
 			return ret;
 
 		memcpy(new_xfer_entry, xfer_entry,
-		       sizeof(struct sm2_xfer_entry));
+		       sm2_xfer_entry_len(xfer_entry));
 		sm2_fifo_write(ep, sender_gid, new_xfer_entry);
 	} else {
 		sm2_fifo_write(ep, sender_gid, xfer_entry);
@@ -149,27 +150,38 @@ static int sm2_cma_hmem_memcpy(struct sm2_ep *ep,
 	return ret;
 }
 
+/*
+ * Copy the next len bytes of a CMA transfer.  The receive and sender iovs
+ * are consumed as they are copied, so the next call resumes after them.
+ */
 static inline int sm2_cma_loop(struct sm2_ep *ep,
 			       struct sm2_xfer_entry *xfer_entry,
-			       struct fi_peer_rx_entry *rx_entry, size_t total,
+			       struct fi_peer_rx_entry *rx_entry, size_t len,
 			       bool write)
 {
 	ssize_t ret;
 	struct sm2_ep_allocation_entry *entries = sm2_mmap_entries(ep->mmap);
 	struct sm2_cma_data *cma_data =
 		(struct sm2_cma_data *) xfer_entry->user_data;
+	struct iovec local[SM2_IOV_LIMIT], remote[SM2_IOV_LIMIT];
+	size_t local_cnt = rx_entry->count, remote_cnt = cma_data->iov_count;
+	size_t total = len;
 
 	pid_t pid = entries[xfer_entry->hdr.sender_gid].pid;
 
+	assert(local_cnt <= SM2_IOV_LIMIT && remote_cnt <= SM2_IOV_LIMIT);
+	memcpy(local, rx_entry->iov, sizeof(*local) * local_cnt);
+	memcpy(remote, cma_data->iov, sizeof(*remote) * remote_cnt);
+	(void) ofi_truncate_iov(local, &local_cnt, len);
+	(void) ofi_truncate_iov(remote, &remote_cnt, len);
+
 	while (1) {
 		if (write)
-			ret = ofi_process_vm_writev(
-				pid, rx_entry->iov, rx_entry->count,
-				cma_data->iov, cma_data->iov_count, 0);
+			ret = ofi_process_vm_writev(pid, local, local_cnt,
+						    remote, remote_cnt, 0);
 		else
-			ret = ofi_process_vm_readv(
-				pid, rx_entry->iov, rx_entry->count,
-				cma_data->iov, cma_data->iov_count, 0);
+			ret = ofi_process_vm_readv(pid, local, local_cnt,
+						   remote, remote_cnt, 0);
 		if (ret < 0) {
 			FI_WARN(&sm2_prov, FI_LOG_EP_CTRL, "CMA error %d\n",
 				errno);
@@ -178,22 +190,33 @@ static inline int sm2_cma_loop(struct sm2_ep *ep,
 
 		total -= ret;
 		if (!total)
-			return FI_SUCCESS;
+			break;
 
-		ofi_consume_iov(rx_entry->iov, &rx_entry->count, (size_t) ret);
-		ofi_consume_iov(cma_data->iov, &cma_data->iov_count,
-				(size_t) ret);
+		ofi_consume_iov(local, &local_cnt, (size_t) ret);
+		ofi_consume_iov(remote, &remote_cnt, (size_t) ret);
 	}
+
+	ofi_consume_iov(rx_entry->iov, &rx_entry->count, len);
+	ofi_consume_iov(cma_data->iov, &cma_data->iov_count, len);
+	return FI_SUCCESS;
 }
 
+/*
+ * Copy the first slice of a CMA transfer.  Anything larger than
+ * SM2_CMA_CHUNK_SIZE is queued on the endpoint and finished one slice per
+ * progress call, so one large message does not hold up the receive queue.
+ */
 static int sm2_progress_cma(struct sm2_ep *ep,
 			    struct sm2_xfer_entry *xfer_entry,
-			    struct fi_peer_rx_entry *rx_entry,
-			    size_t *total_len, int err, bool *ipc_host_to_dev)
+			    struct fi_peer_rx_entry *rx_entry, void *comp_buf,
+			    size_t *total_len, bool *ipc_host_to_dev,
+			    bool *pending)
 {
-	int ret;
+	int ret, err;
 	struct ofi_mr **mr = (struct ofi_mr **) rx_entry->desc;
 	enum fi_hmem_iface iface;
+	struct sm2_pend_entry *pend;
+	size_t len;
 
 	if (mr && mr[0])
 		iface = mr[0]->iface;
@@ -222,12 +245,32 @@ static int sm2_progress_cma(struct sm2_ep *ep,
 
 	/* TODO Need to update last argument for RMA support (as well as generic
 	 * format) */
-	ret = sm2_cma_loop(ep, xfer_entry, rx_entry, xfer_entry->hdr.size,
-			   false);
-	if (!ret)
-		*total_len = xfer_entry->hdr.size;
+	len = MIN(xfer_entry->hdr.size, SM2_CMA_CHUNK_SIZE);
+	ret = sm2_cma_loop(ep, xfer_entry, rx_entry, len, false);
+	if (ret)
+		return -ret;
+
+	if (len < xfer_entry->hdr.size) {
+		pend = ofi_buf_alloc(ep->pend_pool);
+		if (pend) {
+			pend->xfer_entry = xfer_entry;
+			pend->rx_entry = rx_entry;
+			pend->comp_buf = comp_buf;
+			pend->bytes_done = len;
+			dlist_insert_tail(&pend->entry, &ep->cma_pend_list);
+			*pending = true;
+			return FI_SUCCESS;
+		}
+
+		/* no room to queue it, finish the copy now */
+		ret = sm2_cma_loop(ep, xfer_entry, rx_entry,
+				   xfer_entry->hdr.size - len, false);
+		if (ret)
+			return -ret;
+	}
 
-	return -ret;
+	*total_len = xfer_entry->hdr.size;
+	return FI_SUCCESS;
 }
 
 static int sm2_progress_inject(struct sm2_xfer_entry *xfer_entry,
@@ -256,17 +299,23 @@ static int sm2_progress_inject(struct sm2_xfer_entry *xfer_entry,
 	return FI_SUCCESS;
 }
 
+/*
+ * Copy an IPC transfer out of the peer's device buffer, whose handle stays
+ * open in the domain's IPC cache.  On interfaces with async copy support
+ * the copy runs on the device engine and the receive is finished by
+ * sm2_progress_ipc_pend once it lands.
+ */
 static int sm2_progress_ipc(struct sm2_xfer_entry *xfer_entry,
-			    struct ofi_mr **mr, struct iovec *iov,
-			    size_t iov_count, size_t *total_len,
-			    struct sm2_ep *ep)
+			    struct fi_peer_rx_entry *rx_entry, void *comp_buf,
+			    size_t *total_len, struct sm2_ep *ep,
+			    bool *pending)
 {
 	void *ptr;
-	ssize_t hmem_copy_ret;
-	int ret, err;
+	int ret;
 	struct sm2_domain *domain;
 	struct ofi_mr_entry *mr_entry;
 	struct ipc_info *ipc_info = (struct ipc_info *) xfer_entry->user_data;
+	struct sm2_pend_entry *pend;
 
 	domain = container_of(ep->util_ep.domain, struct sm2_domain,
 			      util_domain);
@@ -280,62 +329,61 @@ static int sm2_progress_ipc(struct sm2_xfer_entry *xfer_entry,
 	ptr = (char *) (uintptr_t) mr_entry->info.mapped_addr +
 	      (uintptr_t) ipc_info->offset;
 
-	hmem_copy_ret =
-		ofi_copy_to_hmem_iov(ipc_info->iface, ipc_info->device, iov,
-				     iov_count, 0, ptr, xfer_entry->hdr.size);
-
-	ofi_mr_cache_delete(domain->ipc_cache, mr_entry);
-
-	if (hmem_copy_ret < 0) {
-		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
-			"IPC recv failed with code %d\n",
-			(int) (-hmem_copy_ret));
-		err = hmem_copy_ret;
-	} else if (hmem_copy_ret != xfer_entry->hdr.size) {
+	if (ofi_total_iov_len(rx_entry->iov, rx_entry->count) <
+	    xfer_entry->hdr.size) {
 		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL, "IPC recv truncated\n");
-		err = -FI_ETRUNC;
-	} else {
-		err = ret;
+		ret = -FI_ETRUNC;
+		goto out;
 	}
 
-	*total_len = hmem_copy_ret;
+	pend = ofi_buf_alloc(ep->pend_pool);
+	if (!pend) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
 
-	return err;
+	ret = ofi_hmem_copy_start(&pend->copy, ipc_info->iface,
+				  ipc_info->device, rx_entry->iov,
+				  rx_entry->count, 0, ptr, xfer_entry->hdr.size,
+				  OFI_COPY_BUF_TO_IOV);
+	if (!ret)
+		ret = ofi_hmem_copy_progress(&pend->copy);
+
+	if (ret == -FI_EAGAIN) {
+		pend->xfer_entry = xfer_entry;
+		pend->rx_entry = rx_entry;
+		pend->comp_buf = comp_buf;
+		pend->mr_entry = mr_entry;
+		dlist_insert_tail(&pend->entry, &ep->ipc_pend_list);
+		*pending = true;
+		return FI_SUCCESS;
+	}
+
+	if (ret) {
+		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
+			"IPC recv failed with code %d\n", -ret);
+		ofi_hmem_copy_cleanup(&pend->copy);
+	}
+	ofi_buf_free(pend);
+	*total_len = xfer_entry->hdr.size;
+out:
+	ofi_mr_cache_delete(domain->ipc_cache, mr_entry);
+	return ret;
 }
 
-static int sm2_start_common(struct sm2_ep *ep,
-			    struct sm2_xfer_entry *xfer_entry,
-			    struct fi_peer_rx_entry *rx_entry)
+/*
+ * Write the receive completion and hand the xfer_entry back to the sender.
+ * An unexpected message's copy of the xfer_entry is freed here.
+ */
+static int sm2_finish_common(struct sm2_ep *ep,
+			     struct sm2_xfer_entry *xfer_entry,
+			     struct fi_peer_rx_entry *rx_entry, void *comp_buf,
+			     size_t total_len, int err, bool ipc_host_to_dev)
 {
-	size_t total_len = 0;
 	uint64_t comp_flags;
-	void *comp_buf;
-	int err = 0, ret = 0;
+	int ret = 0;
 	struct sm2_xfer_entry *new_xfer_entry;
-	bool ipc_host_to_dev = false;
-
-	switch (xfer_entry->hdr.proto) {
-	case sm2_proto_inject:
-		err = sm2_progress_inject(
-			xfer_entry, (struct ofi_mr **) rx_entry->desc,
-			rx_entry->iov, rx_entry->count, &total_len, ep, 0);
-		break;
-	case sm2_proto_ipc:
-		err = sm2_progress_ipc(
-			xfer_entry, (struct ofi_mr **) rx_entry->desc,
-			rx_entry->iov, rx_entry->count, &total_len, ep);
-		break;
-	case sm2_proto_cma:
-		err = sm2_progress_cma(ep, xfer_entry, rx_entry, &total_len, 0,
-				       &ipc_host_to_dev);
-		break;
-	default:
-		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
-			"Unidentified operation type\n");
-		err = -FI_EINVAL;
-	}
 
-	comp_buf = rx_entry->iov[0].iov_base;
 	comp_flags = sm2_rx_cq_flags(xfer_entry->hdr.op, rx_entry->flags,
 				     xfer_entry->hdr.op_flags);
 
@@ -362,8 +410,9 @@ static int sm2_start_common(struct sm2_ep *ep,
 
 	sm2_get_peer_srx(ep)->owner_ops->free_entry(rx_entry);
 
+	ret = 0;
 	if (ipc_host_to_dev)
-		return 0;
+		goto out;
 
 	if (!sm2_proto_imm_send_comp(xfer_entry->hdr.proto))
 		xfer_entry->hdr.proto_flags |= SM2_GENERATE_COMPLETION;
@@ -382,7 +431,10 @@ static int sm2_start_common(struct sm2_ep *ep,
 		 * if the receiver is sending many messages and is out of
 		 * xfer_entries
 		 * */
-		ret = sm2_pop_xfer_entry(ep, &new_xfer_entry);
+		ret = sm2_pop_xfer_entry(ep,
+					 sm2_xfer_entry_len(xfer_entry) -
+						 sizeof(struct sm2_xfer_hdr),
+					 &new_xfer_entry);
 		if (ret) {
 			FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
 				"Unable to send xfer_entry back to "
@@ -390,28 +442,135 @@ static int sm2_start_common(struct sm2_ep *ep,
 				"FI_DELIVERY_COMPLETE but will not be "
 				"able to generate a send "
 				"completion!\n");
-			return ret;
+			goto out;
 		}
 
 		memcpy(new_xfer_entry, xfer_entry,
-		       sizeof(struct sm2_xfer_entry));
+		       sm2_xfer_entry_len(xfer_entry));
 		new_xfer_entry->hdr.proto_flags |= SM2_RETURN;
 		new_xfer_entry->hdr.sender_gid = ep->gid;
 		sm2_fifo_write(ep, xfer_entry->hdr.sender_gid, new_xfer_entry);
 	}
 
-	return 0;
+out:
+	if (xfer_entry->hdr.proto_flags & SM2_UNEXP)
+		ofi_buf_free(container_of(xfer_entry, struct sm2_xfer_ctx,
+					  xfer_entry));
+	return ret;
+}
+
+static int sm2_start_common(struct sm2_ep *ep,
+			    struct sm2_xfer_entry *xfer_entry,
+			    struct fi_peer_rx_entry *rx_entry)
+{
+	size_t total_len = 0;
+	void *comp_buf;
+	int err = 0;
+	bool ipc_host_to_dev = false, pending = false;
+
+	comp_buf = rx_entry->iov[0].iov_base;
+
+	switch (xfer_entry->hdr.proto) {
+	case sm2_proto_inject:
+		err = sm2_progress_inject(
+			xfer_entry, (struct ofi_mr **) rx_entry->desc,
+			rx_entry->iov, rx_entry->count, &total_len, ep, 0);
+		break;
+	case sm2_proto_ipc:
+		err = sm2_progress_ipc(xfer_entry, rx_entry, comp_buf,
+				       &total_len, ep, &pending);
+		if (pending)
+			return 0;
+		break;
+	case sm2_proto_cma:
+		err = sm2_progress_cma(ep, xfer_entry, rx_entry, comp_buf,
+				       &total_len, &ipc_host_to_dev, &pending);
+		if (pending)
+			return 0;
+		break;
+	default:
+		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
+			"Unidentified operation type\n");
+		err = -FI_EINVAL;
+	}
+
+	return sm2_finish_common(ep, xfer_entry, rx_entry, comp_buf, total_len,
+				 err, ipc_host_to_dev);
+}
+
+/* Copy one more slice of each queued CMA transfer */
+static void sm2_progress_cma_pend(struct sm2_ep *ep)
+{
+	struct sm2_pend_entry *pend;
+	struct dlist_entry *tmp;
+	size_t len;
+	int err;
+
+	dlist_foreach_container_safe (&ep->cma_pend_list, struct sm2_pend_entry,
+				      pend, entry, tmp) {
+		len = MIN(pend->xfer_entry->hdr.size - pend->bytes_done,
+			  SM2_CMA_CHUNK_SIZE);
+		err = -sm2_cma_loop(ep, pend->xfer_entry, pend->rx_entry, len,
+				    false);
+		pend->bytes_done += len;
+		if (!err && pend->bytes_done < pend->xfer_entry->hdr.size)
+			continue;
+
+		dlist_remove(&pend->entry);
+		(void) sm2_finish_common(ep, pend->xfer_entry, pend->rx_entry,
+					 pend->comp_buf,
+					 pend->xfer_entry->hdr.size, err,
+					 false);
+		ofi_buf_free(pend);
+	}
+}
+
+/* Finish the IPC receives whose device copies have landed */
+static void sm2_progress_ipc_pend(struct sm2_ep *ep)
+{
+	struct sm2_domain *domain;
+	struct sm2_pend_entry *pend;
+	struct dlist_entry *tmp;
+	int err;
+
+	domain = container_of(ep->util_ep.domain, struct sm2_domain,
+			      util_domain);
+
+	dlist_foreach_container_safe (&ep->ipc_pend_list, struct sm2_pend_entry,
+				      pend, entry, tmp) {
+		err = ofi_hmem_copy_progress(&pend->copy);
+		if (err == -FI_EAGAIN)
+			continue;
+
+		if (err) {
+			FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
+				"IPC recv failed with code %d\n", -err);
+			ofi_hmem_copy_cleanup(&pend->copy);
+		}
+
+		dlist_remove(&pend->entry);
+		ofi_mr_cache_delete(domain->ipc_cache, pend->mr_entry);
+		(void) sm2_finish_common(ep, pend->xfer_entry, pend->rx_entry,
+					 pend->comp_buf,
+					 pend->xfer_entry->hdr.size, err,
+					 false);
+		ofi_buf_free(pend);
+	}
+}
+
+void sm2_progress_pend(struct sm2_ep *ep)
+{
+	if (!dlist_empty(&ep->cma_pend_list))
+		sm2_progress_cma_pend(ep);
+	if (!dlist_empty(&ep->ipc_pend_list))
+		sm2_progress_ipc_pend(ep);
 }
 
 int sm2_unexp_start(struct fi_peer_rx_entry *rx_entry)
 {
 	struct sm2_xfer_ctx *xfer_ctx = rx_entry->peer_context;
-	int ret;
-
-	ret = sm2_start_common(xfer_ctx->ep, &xfer_ctx->xfer_entry, rx_entry);
-	ofi_buf_free(xfer_ctx);
 
-	return ret;
+	return sm2_start_common(xfer_ctx->ep, &xfer_ctx->xfer_entry, rx_entry);
 }
 
 static int sm2_alloc_xfer_entry_ctx(struct sm2_ep *ep,
@@ -427,7 +586,7 @@ static int sm2_alloc_xfer_entry_ctx(struct sm2_ep *ep,
 		return -FI_ENOMEM;
 	}
 
-	memcpy(&xfer_ctx->xfer_entry, xfer_entry, sizeof(*xfer_entry));
+	memcpy(&xfer_ctx->xfer_entry, xfer_entry, sm2_xfer_entry_len(xfer_entry));
 	xfer_ctx->ep = ep;
 
 	rx_entry->size = xfer_entry->hdr.size;
@@ -456,8 +615,7 @@ sm2_progress_cma_host_to_dev(struct sm2_ep *ep,
 			xfer_entry->hdr.proto_flags &= ~SM2_GENERATE_COMPLETION;
 			sm2_fifo_write_back(ep, xfer_entry);
 		} else {
-			smr_freestack_push(sm2_freestack(ep->self_region),
-					   xfer_entry);
+			sm2_push_xfer_entry(ep, xfer_entry);
 		}
 		return;
 	}
@@ -505,7 +663,7 @@ sm2_progress_cma_host_to_dev_ack(struct sm2_ep *ep,
 	if (xfer_entry->hdr.proto_flags & SM2_UNEXP) {
 		/* The xfer_entry was actually allocated on the
 		 * receiver side, so we just push it back */
-		smr_freestack_push(sm2_freestack(ep->self_region), xfer_entry);
+		sm2_push_xfer_entry(ep, xfer_entry);
 	} else {
 		/* Unset the delivery complete flag so that we
 		 * don't write another completion entry on the
@@ -757,14 +915,20 @@ static inline void sm2_progress_return(struct sm2_ep *ep,
 		}
 	}
 
-	smr_freestack_push(sm2_freestack(ep->self_region), xfer_entry);
+	sm2_push_xfer_entry(ep, xfer_entry);
 }
 
 void sm2_progress_recv(struct sm2_ep *ep)
 {
 	struct sm2_xfer_entry *xfer_entry;
+	struct sm2_fifo_batch batch;
 	int ret = 0, i;
 
+	batch.cnt = 0;
+	ep->return_batch = &batch;
+
+	sm2_progress_pend(ep);
+
 	for (i = 0; i < MAX_SM2_MSGS_PROGRESSED; i++) {
 		xfer_entry = sm2_fifo_read(ep);
 		if (!xfer_entry)
@@ -801,6 +965,9 @@ void sm2_progress_recv(struct sm2_ep *ep)
 			break;
 		}
 	}
+
+	ep->return_batch = NULL;
+	sm2_fifo_batch_flush(ep, &batch);
 }
 
 void sm2_ep_progress(struct util_ep *util_ep)
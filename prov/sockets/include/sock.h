@@ -854,6 +854,7 @@ struct sock_pe {
 	int wcnt, rcnt;
 	int signal_fds[2];
 	uint64_t waittime;
+	uint64_t spintime;
 
 	struct ofi_bufpool *pe_rx_pool;
 	struct ofi_bufpool *atomic_rx_pool;
@@ -1212,6 +1213,8 @@ ssize_t sock_queue_tmsg_op(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 ssize_t sock_queue_msg_op(struct fid_ep *ep, const struct fi_msg *msg,
 			  uint64_t flags, enum fi_op_type op_type);
 ssize_t sock_queue_cntr_op(struct fi_deferred_work *work, uint64_t flags);
+void sock_cntr_add_trigger(struct sock_cntr *cntr,
+			   struct sock_trigger *trigger);
 void sock_cntr_check_trigger_list(struct sock_cntr *cntr);
 
 static inline size_t sock_rx_avail_len(struct sock_rx_entry *rx_entry)
@@ -125,6 +125,29 @@ int sock_cntr_progress(struct sock_cntr *cntr)
 	return 0;
 }
 
+/*
+ * The trigger list is kept sorted by threshold, with triggers of equal
+ * threshold in the order they were queued.  Thresholds usually grow as
+ * operations are queued, so the insertion point is searched from the tail.
+ */
+void sock_cntr_add_trigger(struct sock_cntr *cntr,
+			   struct sock_trigger *trigger)
+{
+	struct sock_trigger *prev;
+	struct dlist_entry *entry;
+
+	ofi_mutex_lock(&cntr->trigger_lock);
+	for (entry = cntr->trigger_list.prev; entry != &cntr->trigger_list;
+	     entry = entry->prev) {
+		prev = container_of(entry, struct sock_trigger, entry);
+		if (prev->threshold <= trigger->threshold)
+			break;
+	}
+	dlist_insert_after(&trigger->entry, entry);
+	ofi_mutex_unlock(&cntr->trigger_lock);
+}
+
+/* Fire the triggers at the head of the list whose threshold was reached */
 void sock_cntr_check_trigger_list(struct sock_cntr *cntr)
 {
 	struct fi_deferred_work *work;
@@ -140,7 +163,7 @@ void sock_cntr_check_trigger_list(struct sock_cntr *cntr)
 		entry = entry->next;
 
 		if (ofi_atomic_get32(&cntr->value) < (int) trigger->threshold)
-			continue;
+			break;
 
 		switch (trigger->op_type) {
 		case FI_OP_SEND:
@@ -345,7 +345,8 @@ SOCKETS_INI
 #endif
 
 	fi_param_define(&sock_prov, "pe_waittime", FI_PARAM_INT,
-			"How many milliseconds to spin while waiting for progress");
+			"Maximum number of milliseconds to spin while waiting "
+			"for progress");
 
 	fi_param_define(&sock_prov, "conn_timeout", FI_PARAM_INT,
 			"How many milliseconds to wait for one connection establishment");
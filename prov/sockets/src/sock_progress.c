@@ -51,6 +51,7 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
 #include <inttypes.h>
 #include <complex.h>
 #include <arpa/inet.h>
@@ -2564,15 +2565,18 @@ out:
 	return ret;
 }
 
-static int sock_pe_wait_ok(struct sock_pe *pe)
+static int sock_pe_spinning(struct sock_pe *pe)
+{
+	return pe->waittime &&
+	       ((ofi_gettime_ms() - pe->waittime) < pe->spintime);
+}
+
+static int sock_pe_idle(struct sock_pe *pe)
 {
 	struct dlist_entry *entry;
 	struct sock_tx_ctx *tx_ctx;
 	struct sock_rx_ctx *rx_ctx;
 
-	if (pe->waittime && ((ofi_gettime_ms() - pe->waittime) < (uint64_t)sock_pe_waittime))
-		return 0;
-
 	if (dlist_empty(&pe->tx_list) && dlist_empty(&pe->rx_list))
 		return 1;
 
@@ -2603,12 +2607,33 @@ static int sock_pe_wait_ok(struct sock_pe *pe)
 	return 1;
 }
 
+/*
+ * Adapt how long the progress thread spins after a wakeup before it parks
+ * again.  A thread that is woken up again within its spin time would have
+ * seen the event without parking, so it spins longer, up to pe_waittime,
+ * to avoid the wakeup latency.  A thread that stays parked longer than it
+ * spins halves its spin time, so idle domains stop burning cpu.
+ */
+static void sock_pe_adapt_spin(struct sock_pe *pe, uint64_t parked)
+{
+	if (sock_pe_waittime <= 0)
+		return;
+
+	if (parked <= pe->spintime)
+		pe->spintime = MIN(MAX(pe->spintime * 2, 1),
+				   (uint64_t) sock_pe_waittime);
+	else
+		pe->spintime /= 2;
+}
+
 static void sock_pe_wait(struct sock_pe *pe)
 {
 	char tmp;
 	int ret;
+	uint64_t start;
 	struct ofi_epollfds_event event;
 
+	start = ofi_gettime_ms();
 	ret = ofi_epoll_wait(pe->epoll_set, &event, 1, -1);
 	if (ret < 0)
 		SOCK_LOG_ERROR("poll failed : %s\n", strerror(ofi_sockerr()));
@@ -2622,6 +2647,7 @@ static void sock_pe_wait(struct sock_pe *pe)
 	}
 	ofi_mutex_unlock(&pe->signal_lock);
 	pe->waittime = ofi_gettime_ms();
+	sock_pe_adapt_spin(pe, pe->waittime - start);
 }
 
 static void sock_pe_set_affinity(void)
@@ -2649,10 +2675,17 @@ static void *sock_pe_progress_thread(void *data)
 	sock_pe_set_affinity();
 	while (*((volatile int *)&pe->do_progress)) {
 		pthread_mutex_lock(&pe->list_lock);
+		/* An idle thread that is still spinning yields the cpu
+		 * between polls, so application threads sharing its core
+		 * are not delayed by it.
+		 */
 		if (pe->domain->progress_mode == FI_PROGRESS_AUTO &&
-		    sock_pe_wait_ok(pe)) {
+		    sock_pe_idle(pe)) {
 			pthread_mutex_unlock(&pe->list_lock);
-			sock_pe_wait(pe);
+			if (sock_pe_spinning(pe))
+				sched_yield();
+			else
+				sock_pe_wait(pe);
 			pthread_mutex_lock(&pe->list_lock);
 		}
 
@@ -2728,6 +2761,7 @@ struct sock_pe *sock_pe_init(struct sock_domain *domain)
 	ofi_mutex_init(&pe->signal_lock);
 	pthread_mutex_init(&pe->list_lock, NULL);
 	pe->domain = domain;
+	pe->spintime = sock_pe_waittime > 0 ? sock_pe_waittime : 0;
 
 
 	ret = ofi_bufpool_create(&pe->pe_rx_pool,
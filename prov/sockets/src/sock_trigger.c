@@ -82,9 +82,7 @@ ssize_t sock_queue_rma_op(struct fid_ep *ep, const struct fi_msg_rma *msg,
 	trigger->ep = ep;
 	trigger->flags = flags;
 
-	ofi_mutex_lock(&cntr->trigger_lock);
-	dlist_insert_tail(&trigger->entry, &cntr->trigger_list);
-	ofi_mutex_unlock(&cntr->trigger_lock);
+	sock_cntr_add_trigger(cntr, trigger);
 	sock_cntr_check_trigger_list(cntr);
 	return 0;
 }
@@ -124,9 +122,7 @@ ssize_t sock_queue_msg_op(struct fid_ep *ep, const struct fi_msg *msg,
 	trigger->ep = ep;
 	trigger->flags = flags;
 
-	ofi_mutex_lock(&cntr->trigger_lock);
-	dlist_insert_tail(&trigger->entry, &cntr->trigger_list);
-	ofi_mutex_unlock(&cntr->trigger_lock);
+	sock_cntr_add_trigger(cntr, trigger);
 	sock_cntr_check_trigger_list(cntr);
 	return 0;
 }
@@ -166,9 +162,7 @@ ssize_t sock_queue_tmsg_op(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 	trigger->ep = ep;
 	trigger->flags = flags;
 
-	ofi_mutex_lock(&cntr->trigger_lock);
-	dlist_insert_tail(&trigger->entry, &cntr->trigger_list);
-	ofi_mutex_unlock(&cntr->trigger_lock);
+	sock_cntr_add_trigger(cntr, trigger);
 	sock_cntr_check_trigger_list(cntr);
 	return 0;
 }
@@ -226,9 +220,7 @@ ssize_t sock_queue_atomic_op(struct fid_ep *ep, const struct fi_msg_atomic *msg,
 	trigger->ep = ep;
 	trigger->flags = flags;
 
-	ofi_mutex_lock(&cntr->trigger_lock);
-	dlist_insert_tail(&trigger->entry, &cntr->trigger_list);
-	ofi_mutex_unlock(&cntr->trigger_lock);
+	sock_cntr_add_trigger(cntr, trigger);
 	sock_cntr_check_trigger_list(cntr);
 	return 0;
 }
@@ -256,9 +248,7 @@ ssize_t sock_queue_cntr_op(struct fi_deferred_work *work, uint64_t flags)
 	trigger->threshold = work->threshold;
 	trigger->flags = flags;
 
-	ofi_mutex_lock(&cntr->trigger_lock);
-	dlist_insert_tail(&trigger->entry, &cntr->trigger_list);
-	ofi_mutex_unlock(&cntr->trigger_lock);
+	sock_cntr_add_trigger(cntr, trigger);
 	sock_cntr_check_trigger_list(cntr);
 	return 0;
 }
@@ -11,5 +11,16 @@ AC_DEFUN([FI_TCP_CONFIGURE],[
        # Determine if we can support the tcp provider
        xnet_h_happy=0
        AS_IF([test x"$enable_tcp" != x"no"], [xnet_h_happy=1])
+
+       # Kernel TLS offload is optional, keys are derived with libcrypto
+       xnet_ktls=0
+       AC_CHECK_HEADER([linux/tls.h],
+		       [AC_CHECK_HEADER([openssl/kdf.h],
+				[AC_CHECK_LIB([crypto], [EVP_PKEY_derive],
+					      [xnet_ktls=1])])])
+       AS_IF([test $xnet_ktls -eq 1], [tcp_LIBS="-lcrypto"], [tcp_LIBS=""])
+       AC_SUBST(tcp_LIBS)
+       AC_DEFINE_UNQUOTED([HAVE_XNET_KTLS], [$xnet_ktls],
+			  [Define to 1 if the tcp provider can use kernel TLS])
        AS_IF([test $xnet_h_happy -eq 1], [$1], [$2])
 ])
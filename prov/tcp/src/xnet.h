@@ -97,6 +97,8 @@ typedef void  xnet_profile_t;
 #define XNET_MAX_EVENTS		128
 #define XNET_MIN_MULTI_RECV	16384
 #define XNET_PORT_MAX_RANGE	(USHRT_MAX)
+#define XNET_KTLS_NONCE_SIZE	16
+#define XNET_MAX_STRIPES	8
 
 extern struct fi_provider	xnet_prov;
 extern struct util_prov		xnet_util_prov;
@@ -112,11 +114,19 @@ extern int xnet_prefetch_rbuf_size;
 extern size_t xnet_default_tx_size;
 extern size_t xnet_default_rx_size;
 extern size_t xnet_zerocopy_size;
+extern size_t xnet_stripe_cnt;
+extern size_t xnet_stripe_size;
+extern size_t xnet_connect_window;
+extern size_t xnet_progress_shards;
+extern int xnet_busy_poll;
+extern int xnet_cork_delay;
 extern int xnet_trace_msg;
 extern int xnet_disable_autoprog;
 extern int xnet_io_uring;
+extern int xnet_integrity;
 extern int xnet_max_saved;
 extern size_t xnet_max_saved_size;
+extern size_t xnet_rndv_size;
 extern size_t xnet_max_inject;
 extern size_t xnet_buf_size;
 struct xnet_xfer_entry;
@@ -154,6 +164,7 @@ struct xnet_conn_handle {
 	bool			endian_match;
 	struct ofi_sockapi	*sockapi;
 	struct ofi_sockctx	rx_sockctx;
+	uint8_t			ktls_nonce[XNET_KTLS_NONCE_SIZE];
 };
 
 struct xnet_pep {
@@ -170,6 +181,18 @@ void xnet_accept_sock(struct xnet_pep *pep);
 void xnet_connect_done(struct xnet_ep *ep);
 void xnet_req_done(struct xnet_ep *ep);
 int xnet_send_cm_msg(struct xnet_ep *ep);
+
+extern int xnet_ktls;
+int xnet_ktls_init(const char *key_file);
+void xnet_ktls_fini(void);
+int xnet_ktls_set_hdr(struct ofi_ctrl_hdr *hdr, uint8_t *nonce);
+int xnet_ktls_get_hdr(const struct ofi_ctrl_hdr *hdr, uint8_t *nonce);
+int xnet_ktls_sign(struct xnet_cm_msg *msg, const uint8_t *active_nonce,
+		   const uint8_t *passive_nonce);
+int xnet_ktls_verify(struct xnet_cm_msg *msg, const uint8_t *active_nonce,
+		     const uint8_t *passive_nonce);
+int xnet_ktls_enable(struct xnet_ep *ep, const uint8_t *active_nonce,
+		     const uint8_t *passive_nonce, bool active);
 void xnet_uring_req_done(struct xnet_ep *ep, int res);
 
 /* Inject buffer space is included */
@@ -180,6 +203,7 @@ union xnet_hdrs {
 	struct xnet_tag_hdr	tag_hdr;
 	struct xnet_tag_rts_hdr	tag_rts_hdr;
 	struct xnet_tag_rts_data_hdr tag_rts_data_hdr;
+	struct xnet_stripe_hdr	stripe_hdr;
 	uint8_t			max_hdr[XNET_MAX_HDR];
 };
 
@@ -191,6 +215,8 @@ struct xnet_active_rx {
 	struct xnet_xfer_entry	*entry;
 	int			(*handler)(struct xnet_ep *ep);
 	void			*claim_ctx;
+	uint64_t		hist_time;
+	uint32_t		crc;
 };
 
 struct xnet_active_tx {
@@ -212,6 +238,13 @@ struct xnet_srx {
 	struct ofi_dyn_arr	src_tag_queues;
 	struct ofi_dyn_arr	saved_msgs;
 
+	/* Optional hash of posted tagged receives with ignore == 0, keyed
+	 * by (src_addr, tag).  Wildcard receives stay on tag_queue and
+	 * src_tag_queues, and tag_seq_no picks the oldest match.
+	 */
+	struct slist		*tag_buckets;
+	size_t			tag_bucket_mask;
+
 	struct xnet_xfer_entry	*(*match_tag_rx)(struct xnet_srx *srx,
 						 struct xnet_ep *ep,
 						 uint64_t tag);
@@ -233,6 +266,7 @@ int xnet_srx_context(struct fid_domain *domain, struct fi_rx_attr *attr,
 
 /* xnet_ep::util_ep::flags */
 #define XNET_EP_RENDEZVOUS (1 << 0)
+#define XNET_EP_STRIPE (1 << 1)
 
 struct xnet_ep {
 	struct util_ep		util_ep;
@@ -243,6 +277,8 @@ struct xnet_ep {
 	OFI_DBG_VAR(uint8_t, rx_id)
 
 	struct dlist_entry	unexp_entry;
+	struct dlist_entry	cork_entry;
+	uint64_t		cork_time;
 	struct slist		rx_queue;
 	struct slist		tx_queue;
 	struct slist		priority_queue;
@@ -254,17 +290,20 @@ struct xnet_ep {
 	struct xnet_saved_msg	*saved_msg;
 	int			rx_avail;
 	struct xnet_srx		*srx;
+	struct xnet_progress	*progress;
 
 	enum xnet_state		state;
 	struct util_peer_addr	*peer;
 	struct xnet_conn_handle *conn;
 	struct xnet_cm_msg	*cm_msg;
+	uint8_t			ktls_nonce[XNET_KTLS_NONCE_SIZE];
 	struct sockaddr		*addr;
 
 	void (*hdr_bswap)(struct xnet_ep *ep, struct xnet_base_hdr *hdr);
 
 	short			pollflags;
 
+	struct ofi_hist_set	*hist;
 	xnet_profile_t *profile;
 };
 
@@ -272,6 +311,7 @@ struct xnet_event {
 	struct slist_entry list_entry;
 	struct xnet_rdm *rdm;
 	uint32_t event;
+	uint64_t flags;
 	struct fi_eq_cm_entry cm_entry;
 };
 
@@ -279,14 +319,23 @@ enum {
 	XNET_CONN_INDEXED = BIT(0),
 	XNET_CONN_TX_LOOPBACK = BIT(1),
 	XNET_CONN_RX_LOOPBACK = BIT(2),
+	XNET_CONN_PRECONNECT = BIT(3),
+	XNET_CONN_PEER_WAIT = BIT(4),
 };
 
+/* Lanes are extra connections that only carry striped rendezvous data.
+ * We send over the tx_lanes that we opened and receive over the rx_lanes
+ * that the peer opened.  Lane i is on index i - 1, lane 0 being ep.
+ */
 struct xnet_conn {
 	struct xnet_ep		*ep;
+	struct xnet_ep		*tx_lanes[XNET_MAX_STRIPES - 1];
+	struct xnet_ep		*rx_lanes[XNET_MAX_STRIPES - 1];
 	struct xnet_rdm		*rdm;
 	struct util_peer_addr	*peer;
 	uint32_t		remote_pid;
 	int			flags;
+	uint64_t		wait_time;
 };
 
 struct xnet_rdm {
@@ -299,6 +348,13 @@ struct xnet_rdm {
 	struct xnet_conn	*rx_loopback;
 	union ofi_sock_ip	addr;
 
+	/* addresses queued by FI_OPT_TCP_PRECONNECT */
+	fi_addr_t		*preconnect;
+	size_t			preconnect_cnt;
+	size_t			preconnect_pos;
+	size_t			preconnect_active;
+
+	struct ofi_hist_set	*hist;
 	xnet_profile_t *profile;
 };
 
@@ -307,7 +363,11 @@ int xnet_rdm_ep(struct fid_domain *domain, struct fi_info *info,
 ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t dest_addr,
 		      struct xnet_conn **conn);
 struct xnet_ep *xnet_get_rx_ep(struct xnet_rdm *rdm, fi_addr_t addr);
+size_t xnet_get_tx_lanes(struct xnet_conn *conn, struct xnet_ep **lanes);
 void xnet_freeall_conns(struct xnet_rdm *rdm);
+void xnet_set_conns_hist(struct xnet_rdm *rdm);
+int xnet_rdm_preconnect(struct xnet_rdm *rdm, const fi_addr_t *addrs,
+			size_t cnt);
 
 struct xnet_uring {
 	struct fid fid;
@@ -354,6 +414,7 @@ struct xnet_progress {
 	struct dlist_entry	unexp_msg_list;
 	struct dlist_entry	unexp_tag_list;
 	struct dlist_entry	saved_tag_list;
+	struct dlist_entry	cork_list;
 	struct fd_signal	signal;
 
 	struct slist		event_list;
@@ -362,6 +423,8 @@ struct xnet_progress {
 	struct xnet_uring	tx_uring;
 	struct xnet_uring	rx_uring;
 	ofi_io_uring_cqe_t	**cqes;
+	/* Set while a progress pass queues SQEs for a single submit */
+	bool			uring_batch;
 
 	struct ofi_sockapi	sockapi;
 
@@ -370,9 +433,20 @@ struct xnet_progress {
 
 	bool			auto_progress;
 	pthread_t		thread;
+	char			*cpus;
+
+	/* A domain's msg endpoints may be spread across shards */
+	struct xnet_progress	*shards;
+	size_t			shard_cnt;
+	ofi_atomic32_t		next_shard;
 };
 
 int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info);
+int xnet_init_shards(struct xnet_progress *progress, struct fi_info *info,
+		     size_t cnt);
+struct xnet_progress *xnet_get_shard(struct xnet_progress *progress);
+struct xnet_progress *xnet_get_sock_shard(struct xnet_progress *progress,
+					  SOCKET sock);
 void xnet_close_progress(struct xnet_progress *progress);
 int xnet_start_progress(struct xnet_progress *progress);
 void xnet_stop_progress(struct xnet_progress *progress);
@@ -428,6 +502,9 @@ static inline void xnet_signal_progress(struct xnet_progress *progress)
 #define XNET_COPY_RECV		BIT(9)
 #define XNET_CLAIM_RECV		BIT(10)
 #define XNET_NEED_CTS		BIT(11)
+#define XNET_STRIPE		BIT(12)
+#define XNET_TX_STARTED		BIT(13)
+#define XNET_BAD_CRC		BIT(14)
 #define XNET_MULTI_RECV		FI_MULTI_RECV /* BIT(16) */
 
 struct xnet_mrecv {
@@ -454,11 +531,17 @@ struct xnet_xfer_entry {
 	uint32_t		ctrl_flags;
 	OFI_DBG_VAR(bool,	inuse)
 	uint32_t		async_index;
+	/* Striped rendezvous: bytes outstanding for a receive, or the
+	 * size of a single stripe.
+	 */
+	size_t			stripe_left;
+	int			stripe_err;
 	void			*context;
 	/* For RMA read requests, we track the request response so that
 	 * we don't generate multiple completions for the same operation.
 	 */
 	struct xnet_xfer_entry  *resp_entry;
+	uint64_t		hist_time;
 
 	/* hdr must be second to last, followed by msg_data.  msg_data
 	 * is sized dynamically based on the max_inject size
@@ -475,10 +558,7 @@ struct xnet_domain {
 
 static inline struct xnet_progress *xnet_ep2_progress(struct xnet_ep *ep)
 {
-	struct xnet_domain *domain;
-	domain = container_of(ep->util_ep.domain, struct xnet_domain,
-			      util_domain);
-	return &domain->progress;
+	return ep->progress;
 }
 
 static inline struct xnet_progress *xnet_rdm2_progress(struct xnet_rdm *rdm)
@@ -745,6 +825,24 @@ static inline uint64_t xnet_msg_len(union xnet_hdrs *hdr)
 	}
 }
 
+/* Latency breakdown exported through fi_open_ops(ep, "perf_hist").
+ * Queue is the time a send waits behind earlier transfers, wire is the
+ * time from its first byte until the socket accepts its last, and match
+ * is the time a received header waits for a posted buffer.
+ */
+enum {
+	XNET_HIST_TX_QUEUE,
+	XNET_HIST_TX_WIRE,
+	XNET_HIST_RX_MATCH,
+	XNET_HIST_MAX
+};
+
+static inline void
+xnet_hist_add(struct ofi_hist_set *hist, int id, uint64_t start)
+{
+	ofi_hist_add(&hist->hist[id], ofi_gettime_ns() - start);
+}
+
 int xnet_ep_ops_open(struct fid *fid, const char *name,
 		     uint64_t flags, void **ops, void *context);
 int xnet_rdm_ops_open(struct fid *fid, const char *name,
@@ -92,7 +92,9 @@ xnet_handle_cm_msg(SOCKET sock, struct xnet_cm_msg *msg, uint8_t exp_msg)
 
 	len = ntohs(msg->hdr.seg_size);
 	if (len) {
-		if (len > XNET_MAX_CM_DATA_SIZE) {
+		if (len > XNET_MAX_CM_DATA_SIZE +
+		    ((ntohl(msg->hdr.seg_no) & XNET_CM_KTLS) ?
+		     XNET_KTLS_TAG_SIZE : 0)) {
 			FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
 				"cm data size is too large, seg_size: %zu\n",
 				len);
@@ -146,9 +148,19 @@ int xnet_send_cm_msg(struct xnet_ep *ep)
 static int xnet_req_done_internal(struct xnet_ep *ep)
 {
 	struct xnet_cm_entry cm_entry;
+	uint8_t nonce[XNET_KTLS_NONCE_SIZE];
 	uint16_t len;
 	int ret;
 
+	ret = xnet_ktls_get_hdr(&ep->cm_msg->hdr, nonce);
+	if (!ret && xnet_ktls) {
+		ret = xnet_ktls_verify(ep->cm_msg, ep->ktls_nonce, nonce);
+		if (!ret)
+			ret = xnet_ktls_enable(ep, ep->ktls_nonce, nonce, true);
+	}
+	if (ret)
+		return ret;
+
 	if (xnet_trace_msg) {
 		ep->hdr_bswap = (ep->cm_msg->hdr.conn_data == 1) ?
 				xnet_hdr_trace : xnet_hdr_bswap_trace;
@@ -279,6 +291,12 @@ void xnet_handle_conn(struct xnet_conn_handle *conn, bool error)
 		goto close;
 	}
 
+	ret = xnet_ktls_get_hdr(&msg.hdr, conn->ktls_nonce);
+	if (!ret)
+		ret = xnet_ktls_verify(&msg, conn->ktls_nonce, NULL);
+	if (ret)
+		goto close;
+
 	cm_entry.fid = &conn->pep->util_pep.pep_fid.fid;
 	cm_entry.info = fi_dupinfo(conn->pep->info);
 	if (!cm_entry.info)
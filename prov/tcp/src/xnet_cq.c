@@ -294,6 +294,15 @@ int xnet_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 	if (ret)
 		goto free_cq;
 
+	/* Endpoints on separate progress shards write the cq concurrently */
+	if (xnet_cq2_progress(cq)->shard_cnt &&
+	    cq->util_cq.cq_lock.lock_type != OFI_LOCK_MUTEX) {
+		ofi_genlock_destroy(&cq->util_cq.cq_lock);
+		ret = ofi_genlock_init(&cq->util_cq.cq_lock, OFI_LOCK_MUTEX);
+		if (ret)
+			goto cleanup;
+	}
+
 	if (cq->util_cq.wait && ofi_have_epoll) {
 		ret = ofi_wait_add_fd(cq->util_cq.wait,
 			       ofi_dynpoll_get_fd(&xnet_cq2_progress(cq)->epoll_fd),
@@ -36,6 +36,25 @@
 #include "ofi_atomic.h"
 #include "xnet.h"
 
+/* Endpoints verify keys while holding their progress shard's lock */
+static void xnet_mr_lock(struct xnet_domain *domain)
+{
+	size_t i;
+
+	ofi_genlock_lock(domain->progress.active_lock);
+	for (i = 0; i < domain->progress.shard_cnt; i++)
+		ofi_genlock_lock(domain->progress.shards[i].active_lock);
+}
+
+static void xnet_mr_unlock(struct xnet_domain *domain)
+{
+	size_t i;
+
+	for (i = domain->progress.shard_cnt; i > 0; i--)
+		ofi_genlock_unlock(domain->progress.shards[i - 1].active_lock);
+	ofi_genlock_unlock(domain->progress.active_lock);
+}
+
 static int xnet_mr_close(struct fid *fid)
 {
 	struct xnet_domain *domain;
@@ -46,9 +65,9 @@ static int xnet_mr_close(struct fid *fid)
 	domain = container_of(&mr->domain->domain_fid, struct xnet_domain,
 			      util_domain.domain_fid.fid);
 
-	ofi_genlock_lock(domain->progress.active_lock);
+	xnet_mr_lock(domain);
 	ret = ofi_mr_close(fid);
-	ofi_genlock_unlock(domain->progress.active_lock);
+	xnet_mr_unlock(domain);
 	return ret;
 }
 
@@ -71,10 +90,10 @@ xnet_mr_reg(struct fid *fid, const void *buf, size_t len,
 
 	domain = container_of(fid, struct xnet_domain,
 			      util_domain.domain_fid.fid);
-	ofi_genlock_lock(domain->progress.active_lock);
+	xnet_mr_lock(domain);
 	ret = ofi_mr_reg(fid, buf, len, access, offset, requested_key, flags,
 			 mr_fid, context);
-	ofi_genlock_unlock(domain->progress.active_lock);
+	xnet_mr_unlock(domain);
 
 	if (!ret) {
 		mr = container_of(*mr_fid, struct ofi_mr, mr_fid.fid);
@@ -95,10 +114,10 @@ xnet_mr_regv(struct fid *fid, const struct iovec *iov,
 
 	domain = container_of(fid, struct xnet_domain,
 			      util_domain.domain_fid.fid);
-	ofi_genlock_lock(domain->progress.active_lock);
+	xnet_mr_lock(domain);
 	ret = ofi_mr_regv(fid, iov, count, access, offset, requested_key, flags,
 			 mr_fid, context);
-	ofi_genlock_unlock(domain->progress.active_lock);
+	xnet_mr_unlock(domain);
 
 	if (!ret) {
 		mr = container_of(*mr_fid, struct ofi_mr, mr_fid.fid);
@@ -117,9 +136,9 @@ xnet_mr_regattr(struct fid *fid, const struct fi_mr_attr *attr,
 
 	domain = container_of(fid, struct xnet_domain,
 			      util_domain.domain_fid.fid);
-	ofi_genlock_lock(domain->progress.active_lock);
+	xnet_mr_lock(domain);
 	ret = ofi_mr_regattr(fid, attr, flags, mr_fid);
-	ofi_genlock_unlock(domain->progress.active_lock);
+	xnet_mr_unlock(domain);
 
 	if (!ret) {
 		mr = container_of(*mr_fid, struct ofi_mr, mr_fid.fid);
@@ -239,6 +258,15 @@ int xnet_domain_open(struct fid_fabric *fabric_fid, struct fi_info *info,
 	if (ret)
 		goto close;
 
+	if (info->ep_attr->type == FI_EP_MSG && xnet_progress_shards > 1) {
+		ret = xnet_init_shards(&domain->progress, info,
+				       xnet_progress_shards);
+		if (ret) {
+			xnet_close_progress(&domain->progress);
+			goto close;
+		}
+	}
+
 	domain->ep_type = info->ep_attr->type;
 	domain->util_domain.domain_fid.fid.ops = &xnet_domain_fi_ops;
 	domain->util_domain.domain_fid.ops = &xnet_domain_ops;
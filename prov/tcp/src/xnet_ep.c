@@ -156,6 +156,34 @@ static void xnet_set_no_port(SOCKET sock)
 #define xnet_set_no_port(sock)
 #endif
 
+#ifdef SO_BUSY_POLL
+/* Raising the busy poll time above the system default requires
+ * CAP_NET_ADMIN, so failures are not fatal.
+ */
+static void xnet_set_busy_poll(SOCKET sock)
+{
+	int val = xnet_busy_poll;
+
+	if (!val)
+		return;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val))) {
+		FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+			"unable to set busy poll: %s\n",
+			strerror(ofi_sockerr()));
+		return;
+	}
+
+#ifdef SO_PREFER_BUSY_POLL
+	val = 1;
+	(void) setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL,
+			  &val, sizeof(val));
+#endif
+}
+#else
+#define xnet_set_busy_poll(sock)
+#endif
+
 int xnet_setup_socket(SOCKET sock, struct fi_info *info)
 {
 	int ret, optval = 1;
@@ -190,6 +218,7 @@ int xnet_setup_socket(SOCKET sock, struct fi_info *info)
 		return ret;
 	}
 
+	xnet_set_busy_poll(sock);
 	return 0;
 }
 
@@ -222,10 +251,17 @@ static int xnet_ep_connect(struct fid_ep *ep_fid, const void *addr,
 	ep->cm_msg->hdr.version = XNET_CTRL_HDR_VERSION;
 	ep->cm_msg->hdr.type = ofi_ctrl_connreq;
 	ep->cm_msg->hdr.conn_data = 1; /* tests endianess mismatch at peer */
-	if (paramlen) {
+	ret = xnet_ktls_set_hdr(&ep->cm_msg->hdr, ep->ktls_nonce);
+	if (ret)
+		return ret;
+
+	if (paramlen)
 		memcpy(ep->cm_msg->data, param, paramlen);
-		ep->cm_msg->hdr.seg_size = htons((uint16_t) paramlen);
-	}
+	ep->cm_msg->hdr.seg_size = htons((uint16_t) paramlen);
+
+	ret = xnet_ktls_sign(ep->cm_msg, ep->ktls_nonce, NULL);
+	if (ret)
+		return ret;
 
 	ep->addr = mem_dup(addr, ofi_sizeofaddr(addr));
 	if (!ep->addr)
@@ -289,15 +325,29 @@ xnet_ep_accept(struct fid_ep *ep_fid, const void *param, size_t paramlen)
 	ep->cm_msg->hdr.version = XNET_CTRL_HDR_VERSION;
 	ep->cm_msg->hdr.type = ofi_ctrl_connresp;
 	ep->cm_msg->hdr.conn_data = 1; /* tests endianess mismatch at peer */
-	if (paramlen) {
+	ret = xnet_ktls_set_hdr(&ep->cm_msg->hdr, ep->ktls_nonce);
+	if (ret)
+		return ret;
+
+	if (paramlen)
 		memcpy(ep->cm_msg->data, param, paramlen);
-		ep->cm_msg->hdr.seg_size = htons((uint16_t) paramlen);
-	}
+	ep->cm_msg->hdr.seg_size = htons((uint16_t) paramlen);
+
+	ret = xnet_ktls_sign(ep->cm_msg, conn->ktls_nonce, ep->ktls_nonce);
+	if (ret)
+		return ret;
 
 	ret = xnet_send_cm_msg(ep);
 	if (ret)
 		return ret;
 
+	if (xnet_ktls) {
+		ret = xnet_ktls_enable(ep, conn->ktls_nonce, ep->ktls_nonce,
+				       false);
+		if (ret)
+			return ret;
+	}
+
 	free(ep->cm_msg);
 	ep->cm_msg = NULL;
 	ep->state = XNET_CONNECTED;
@@ -441,6 +491,7 @@ void xnet_ep_disable(struct xnet_ep *ep, int cm_err, void* err_data,
 
 	ep->state = XNET_DISCONNECTED;
 	dlist_remove_init(&ep->unexp_entry);
+	dlist_remove_init(&ep->cork_entry);
 	if (!xnet_io_uring)
 		xnet_halt_sock(xnet_ep2_progress(ep), ep->bsock.sock);
 
@@ -531,6 +582,7 @@ void xnet_reset_rx(struct xnet_ep *ep)
 	ep->cur_rx.hdr_done = 0;
 	ep->cur_rx.hdr_len = sizeof(ep->cur_rx.hdr.base_hdr);
 	ep->cur_rx.claim_ctx = NULL;
+	ep->cur_rx.crc = 0;
 	OFI_DBG_SET(ep->cur_rx.hdr.base_hdr.version, 0);
 }
 
@@ -593,6 +645,7 @@ static int xnet_ep_close(struct fid *fid)
 	ofi_genlock_lock(&progress->ep_lock);
 	ep->state = XNET_DISCONNECTED;
 	dlist_remove_init(&ep->unexp_entry);
+	dlist_remove_init(&ep->cork_entry);
 	if (!xnet_io_uring)
 		xnet_halt_sock(progress, ep->bsock.sock);
 	ofi_close_socket(ep->bsock.sock);
@@ -606,6 +659,7 @@ static int xnet_ep_close(struct fid *fid)
 
 	free(ep->cm_msg);
 	free(ep->addr);
+	ofi_hist_set_free(fid, ep->hist);
 
 	ofi_endpoint_close(&ep->util_ep);
 	free(ep);
@@ -647,6 +701,9 @@ static int xnet_ep_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
 	case FI_CLASS_SRX_CTX:
 		srx = container_of(bfid, struct xnet_srx, rx_fid.fid);
 		ep->srx = srx;
+		/* The srx is serialized by the domain progress */
+		ep->progress = xnet_srx2_progress(srx);
+		ep->bsock.sockapi = &ep->progress->sockapi;
 		if (!ep->profile)
 			ep->profile = srx->profile;
 		return FI_SUCCESS;
@@ -721,6 +778,7 @@ static struct fi_ops_ep xnet_ep_ops = {
 int xnet_endpoint(struct fid_domain *domain, struct fi_info *info,
 		  struct fid_ep **ep_fid, void *context)
 {
+	struct xnet_domain *xnet_domain;
 	struct xnet_ep *ep;
 	struct xnet_pep *pep;
 	struct xnet_conn_handle *conn;
@@ -736,6 +794,18 @@ int xnet_endpoint(struct fid_domain *domain, struct fi_info *info,
 		goto err1;
 
 	assert(info->ep_attr->type == FI_EP_MSG);
+	xnet_domain = container_of(domain, struct xnet_domain,
+				   util_domain.domain_fid);
+	if (info->ep_attr->rx_ctx_cnt == FI_SHARED_CONTEXT) {
+		ep->progress = &xnet_domain->progress;
+	} else if (info->handle &&
+		   ((fid_t) info->handle)->fclass != FI_CLASS_PEP) {
+		conn = container_of(info->handle, struct xnet_conn_handle, fid);
+		ep->progress = xnet_get_sock_shard(&xnet_domain->progress,
+						   conn->sock);
+	} else {
+		ep->progress = xnet_get_shard(&xnet_domain->progress);
+	}
 	ofi_bsock_init(&ep->bsock, &xnet_ep2_progress(ep)->sockapi,
 		       xnet_staging_sbuf_size, xnet_prefetch_rbuf_size,
 		       &ep->util_ep.ep_fid);
@@ -807,6 +877,7 @@ int xnet_endpoint(struct fid_domain *domain, struct fi_info *info,
 	}
 
 	dlist_init(&ep->unexp_entry);
+	dlist_init(&ep->cork_entry);
 	slist_init(&ep->rx_queue);
 	slist_init(&ep->tx_queue);
 	slist_init(&ep->priority_queue);
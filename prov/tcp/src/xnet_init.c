@@ -64,16 +64,24 @@ int xnet_prefetch_rbuf_size = 9000;
 size_t xnet_default_tx_size = 256;
 size_t xnet_default_rx_size = 256;
 size_t xnet_zerocopy_size = SIZE_MAX;
+size_t xnet_stripe_cnt = 1;
+size_t xnet_stripe_size = (1 << 20);
+size_t xnet_connect_window = 64;
+size_t xnet_progress_shards;
+int xnet_busy_poll;
+int xnet_cork_delay;
 int xnet_trace_msg;
 int xnet_disable_autoprog;
 int xnet_io_uring;
+int xnet_integrity;
 int xnet_max_saved = 64;
 size_t xnet_max_inject = XNET_DEF_INJECT;
 size_t xnet_buf_size = XNET_DEF_BUF_SIZE;
 size_t xnet_max_saved_size = SIZE_MAX;
+size_t xnet_rndv_size = SIZE_MAX;
 
 
-static void xnet_init_env(void)
+static int xnet_init_env(void)
 {
 	char *param = NULL;
 	size_t tx_size;
@@ -140,6 +148,14 @@ static void xnet_init_env(void)
 			"overhead to handle unexpected messages, but may be "
 			"required by some applications to prevents hangs.");
 	fi_param_get_size_t(&xnet_prov, "max_saved_size", &xnet_max_saved_size);
+	fi_param_define(&xnet_prov, "rdm_rendezvous_size", FI_PARAM_SIZE_T,
+			"lower threshold where rdm tagged messages are held "
+			"by the sender until the receiver has matched a "
+			"buffer, so that the data is received directly into "
+			"it.  Messages larger than FI_TCP_MAX_SAVED_SIZE "
+			"always use rendezvous (default: disabled)");
+	fi_param_get_size_t(&xnet_prov, "rdm_rendezvous_size",
+			    &xnet_rndv_size);
 
 	fi_param_define(&xnet_prov, "max_rx_size", FI_PARAM_SIZE_T,
 			"maximum size for message buffers. If set lower "
@@ -151,6 +167,9 @@ static void xnet_init_env(void)
 		xnet_buf_size = xnet_max_inject;
 	if (xnet_max_saved_size < xnet_buf_size)
 		xnet_max_saved_size = xnet_buf_size;
+	/* The receiver never needs to buffer a message sent using rendezvous */
+	if (xnet_rndv_size > xnet_max_saved_size)
+		xnet_rndv_size = xnet_max_saved_size;
 
 	fi_param_define(&xnet_prov, "nodelay", FI_PARAM_BOOL,
 			"overrides default TCP_NODELAY socket setting "
@@ -174,6 +193,57 @@ static void xnet_init_env(void)
 			 &xnet_prefetch_rbuf_size);
 	fi_param_get_size_t(&xnet_prov, "zerocopy_size", &xnet_zerocopy_size);
 
+	fi_param_define(&xnet_prov, "rdm_stripe_cnt", FI_PARAM_SIZE_T,
+			"number of connections opened to a peer over which "
+			"large rdm transfers are striped, set to 1 to disable "
+			"(default: %zu, max: %d)", xnet_stripe_cnt,
+			XNET_MAX_STRIPES);
+	fi_param_define(&xnet_prov, "rdm_stripe_size", FI_PARAM_SIZE_T,
+			"lower threshold where rdm transfers are striped "
+			"(default: %zu)", xnet_stripe_size);
+	fi_param_get_size_t(&xnet_prov, "rdm_stripe_cnt", &xnet_stripe_cnt);
+	fi_param_get_size_t(&xnet_prov, "rdm_stripe_size", &xnet_stripe_size);
+	if (!xnet_stripe_cnt)
+		xnet_stripe_cnt = 1;
+	else if (xnet_stripe_cnt > XNET_MAX_STRIPES)
+		xnet_stripe_cnt = XNET_MAX_STRIPES;
+
+	fi_param_define(&xnet_prov, "rdm_connect_window", FI_PARAM_SIZE_T,
+			"maximum number of connections started at once when "
+			"an rdm endpoint is asked to pre-connect to a set of "
+			"peers (default: %zu)", xnet_connect_window);
+	fi_param_get_size_t(&xnet_prov, "rdm_connect_window",
+			    &xnet_connect_window);
+	if (!xnet_connect_window)
+		xnet_connect_window = 1;
+
+	fi_param_define(&xnet_prov, "tx_cork_delay", FI_PARAM_INT,
+			"maximum time in microseconds that small sends are "
+			"held back to be combined with following sends to the "
+			"same peer, set to 0 to disable (default: %d)",
+			xnet_cork_delay);
+	fi_param_get_int(&xnet_prov, "tx_cork_delay", &xnet_cork_delay);
+	if (xnet_cork_delay < 0)
+		xnet_cork_delay = 0;
+
+	fi_param_define(&xnet_prov, "progress_shards", FI_PARAM_SIZE_T,
+			"number of progress instances the endpoints of a msg "
+			"domain are spread across, each with its own epoll set, "
+			"io_uring, lock, and auto progress thread, set to 0 or "
+			"1 to disable (default: %zu)", xnet_progress_shards);
+	fi_param_get_size_t(&xnet_prov, "progress_shards",
+			    &xnet_progress_shards);
+
+	fi_param_define(&xnet_prov, "busy_poll", FI_PARAM_INT,
+			"time in microseconds that socket reads busy poll the "
+			"device queue before returning, also steers accepted "
+			"connections to the progress shard on the cpu that "
+			"receives their traffic, set to 0 to disable "
+			"(default: %d)", xnet_busy_poll);
+	fi_param_get_int(&xnet_prov, "busy_poll", &xnet_busy_poll);
+	if (xnet_busy_poll < 0)
+		xnet_busy_poll = 0;
+
 	fi_param_define(&xnet_prov, "trace_msg", FI_PARAM_BOOL,
 			"Capture and display transport message information "
 			"when FI_LOG_LEVEL=TRACE is specified");
@@ -186,11 +256,24 @@ static void xnet_init_env(void)
 			"Enable io_uring support if available (default: %d)", xnet_io_uring);
 	fi_param_get_bool(&xnet_prov, "io_uring",
 			 &xnet_io_uring);
+	fi_param_define(&xnet_prov, "integrity", FI_PARAM_BOOL,
+			"Append a CRC32C of the payload to message and tagged "
+			"transfers, and verify it on receipt (default: %d)",
+			xnet_integrity);
+	fi_param_get_bool(&xnet_prov, "integrity", &xnet_integrity);
+
+	param = NULL;
+	fi_param_define(&xnet_prov, "ktls_key_file", FI_PARAM_STRING,
+			"path to a pre-shared key used to encrypt all "
+			"connections with kernel TLS, both peers must use "
+			"the same key (default: none)");
+	fi_param_get_str(&xnet_prov, "ktls_key_file", &param);
+	return xnet_ktls_init(param);
 }
 
 static void xnet_fini(void)
 {
-	/* empty as of now */
+	xnet_ktls_fini();
 }
 
 struct fi_provider xnet_prov = {
@@ -208,7 +291,10 @@ TCP_INI
 	ofi_pmem_init();
 	ofi_mem_init();
 #endif
-	xnet_init_env();
+	/* Do not fall back to plaintext if encryption was requested */
+	if (xnet_init_env())
+		return NULL;
+
 	xnet_init_infos();
 	return &xnet_prov;
 }
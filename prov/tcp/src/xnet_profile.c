@@ -36,6 +36,54 @@
 #include <ofi_prov.h>
 #include "xnet.h"
 
+static const char * const xnet_hist_names[XNET_HIST_MAX] = {
+	[XNET_HIST_TX_QUEUE] = "xnet_tx_queue",
+	[XNET_HIST_TX_WIRE] = "xnet_tx_wire",
+	[XNET_HIST_RX_MATCH] = "xnet_rx_match",
+};
+
+static int xnet_ep_open_hist(struct xnet_ep *ep, void **ops)
+{
+	struct xnet_progress *progress;
+	int ret = 0;
+
+	progress = xnet_ep2_progress(ep);
+	ofi_genlock_lock(progress->active_lock);
+	if (!ep->hist) {
+		ep->hist = ofi_hist_set_alloc(&ep->util_ep.ep_fid.fid,
+					      progress->active_lock,
+					      xnet_hist_names, XNET_HIST_MAX);
+		if (!ep->hist)
+			ret = -FI_ENOMEM;
+	}
+	if (!ret)
+		*ops = &ep->hist->hist_fid;
+	ofi_genlock_unlock(progress->active_lock);
+	return ret;
+}
+
+static int xnet_rdm_open_hist(struct xnet_rdm *rdm, void **ops)
+{
+	struct xnet_progress *progress;
+	int ret = 0;
+
+	progress = xnet_rdm2_progress(rdm);
+	ofi_genlock_lock(progress->active_lock);
+	if (!rdm->hist) {
+		rdm->hist = ofi_hist_set_alloc(&rdm->util_ep.ep_fid.fid,
+					       progress->active_lock,
+					       xnet_hist_names, XNET_HIST_MAX);
+		if (rdm->hist)
+			xnet_set_conns_hist(rdm);
+		else
+			ret = -FI_ENOMEM;
+	}
+	if (!ret)
+		*ops = &rdm->hist->hist_fid;
+	ofi_genlock_unlock(progress->active_lock);
+	return ret;
+}
+
 #ifdef HAVE_FABRIC_PROFILE
 #include <ofi_profile.h>
 
@@ -190,8 +238,8 @@ static struct fi_profile_ops xnet_prof_ep_ops =  {
 	.end_reads = xnet_prof_end_reads,
 };
 
-int xnet_ep_ops_open(struct fid *fid, const char *name,
-		     uint64_t flags, void **ops, void *context)
+static int xnet_ep_prof_open(struct fid *fid, const char *name,
+			     uint64_t flags, void **ops, void *context)
 {
 	int ret = 0;
 	struct xnet_profile *xnet_prof;
@@ -216,8 +264,8 @@ int xnet_ep_ops_open(struct fid *fid, const char *name,
 	return -FI_ENOSYS;
 }
 
-int xnet_rdm_ops_open(struct fid *fid, const char *name,
-		      uint64_t flags, void **ops, void *context)
+static int xnet_rdm_prof_open(struct fid *fid, const char *name,
+			      uint64_t flags, void **ops, void *context)
 {
 	int ret = 0;
 	struct xnet_profile *xnet_prof;
@@ -247,8 +295,8 @@ int xnet_rdm_ops_open(struct fid *fid, const char *name,
 
 #else
 
-int xnet_ep_ops_open(struct fid *fid, const char *name,
-		     uint64_t flags, void **ops, void *context)
+static int xnet_ep_prof_open(struct fid *fid, const char *name,
+			     uint64_t flags, void **ops, void *context)
 {
 	OFI_UNUSED(fid);
 	OFI_UNUSED(name);
@@ -258,8 +306,8 @@ int xnet_ep_ops_open(struct fid *fid, const char *name,
 	return -FI_ENOSYS;
 }
 
-int xnet_rdm_ops_open(struct fid *fid, const char *name,
-		      uint64_t flags, void **ops, void *context)
+static int xnet_rdm_prof_open(struct fid *fid, const char *name,
+			      uint64_t flags, void **ops, void *context)
 {
 	OFI_UNUSED(fid);
 	OFI_UNUSED(name);
@@ -271,3 +319,22 @@ int xnet_rdm_ops_open(struct fid *fid, const char *name,
 
 #endif
 
+int xnet_ep_ops_open(struct fid *fid, const char *name,
+		     uint64_t flags, void **ops, void *context)
+{
+	if (!strcmp(name, "perf_hist"))
+		return xnet_ep_open_hist(container_of(fid, struct xnet_ep,
+						      util_ep.ep_fid.fid), ops);
+
+	return xnet_ep_prof_open(fid, name, flags, ops, context);
+}
+
+int xnet_rdm_ops_open(struct fid *fid, const char *name,
+		      uint64_t flags, void **ops, void *context)
+{
+	if (!strcmp(name, "perf_hist"))
+		return xnet_rdm_open_hist(container_of(fid, struct xnet_rdm,
+						       util_ep.ep_fid.fid), ops);
+
+	return xnet_rdm_prof_open(fid, name, flags, ops, context);
+}
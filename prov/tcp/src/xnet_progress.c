@@ -82,6 +82,27 @@ static void xnet_submit_uring(struct xnet_uring *uring)
 	assert(ready == submitted);
 }
 
+/* SQEs queued on behalf of any endpoint while batching are submitted
+ * together by xnet_uring_batch_end(), one io_uring_enter() per ring.
+ */
+static bool xnet_uring_batch_begin(struct xnet_progress *progress)
+{
+	bool batch = progress->uring_batch;
+
+	progress->uring_batch = true;
+	return batch;
+}
+
+static void xnet_uring_batch_end(struct xnet_progress *progress, bool batch)
+{
+	progress->uring_batch = batch;
+	if (batch)
+		return;
+
+	xnet_submit_uring(&progress->tx_uring);
+	xnet_submit_uring(&progress->rx_uring);
+}
+
 static bool xnet_save_and_cont(struct xnet_ep *ep)
 {
 	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
@@ -125,6 +146,7 @@ xnet_get_save_rx(struct xnet_ep *ep, uint64_t tag)
 	rx_entry->tag = tag;
 	rx_entry->ignore = 0;
 	rx_entry->ctrl_flags = XNET_SAVED_XFER;
+	rx_entry->hist_time = ep->cur_rx.hist_time;
 
 	if (ep->cur_rx.data_left <= xnet_buf_size) {
 		rx_entry->user_buf = NULL;
@@ -226,6 +248,8 @@ xnet_rts_matched(struct xnet_rdm *rdm, struct xnet_ep *ep,
 		}
 	}
 
+	rx_entry->stripe_left = xnet_msg_len(&rx_entry->hdr);
+	rx_entry->stripe_err = 0;
 	cts_ctx = ofi_byte_idx_set(&ep->cts_queue,
 				   rx_entry->hdr.base_hdr.op_data, rx_entry);
 	assert(cts_ctx == rx_entry->hdr.base_hdr.op_data);
@@ -265,7 +289,10 @@ void xnet_complete_saved(struct xnet_xfer_entry *saved_entry, void *msg_data)
 		copied = 0;
 	}
 
-	if (copied == msg_len) {
+	if (saved_entry->ctrl_flags & XNET_BAD_CRC) {
+		xnet_cntr_incerr(saved_entry);
+		xnet_report_error(saved_entry, FI_EIO);
+	} else if (copied == msg_len) {
 		xnet_report_success(saved_entry);
 	} else {
 		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "saved recv truncated\n");
@@ -298,6 +325,10 @@ void xnet_recv_saved(struct xnet_rdm *rdm, struct xnet_xfer_entry *saved_entry,
 		msg_data = &saved_entry->msg_data;
 		saved_entry->ctrl_flags &= ~XNET_SAVED_XFER;
 	}
+	if (saved_entry->hist_time && rdm->hist)
+		xnet_hist_add(rdm->hist, XNET_HIST_RX_MATCH,
+			      saved_entry->hist_time);
+
 	saved_entry->context = rx_entry->context;
 	saved_entry->user_buf = rx_entry->user_buf;
 	saved_entry->cq_flags |= rx_entry->cq_flags;
@@ -427,6 +458,50 @@ static int xnet_update_pollflag(struct xnet_ep *ep, short pollflag, bool set)
 	return ret;
 }
 
+/* When corking, small sends are copied into the staging buffer and
+ * completed, so that consecutive messages go out in one write.  The
+ * buffer is flushed once it cannot hold the next message, when the
+ * oldest corked data exceeds the delay, or on the next progress pass.
+ */
+static bool xnet_can_cork(struct xnet_ep *ep)
+{
+	return xnet_cork_delay && !xnet_io_uring &&
+	       ep->cur_tx.data_left <= ofi_byteq_writeable(&ep->bsock.sq) &&
+	       ep->cur_tx.data_left <= ep->bsock.zerocopy_size;
+}
+
+static void xnet_cork(struct xnet_ep *ep)
+{
+	struct xnet_xfer_entry *tx_entry = ep->cur_tx.entry;
+
+	ofi_byteq_writev(&ep->bsock.sq, tx_entry->iov, tx_entry->iov_cnt);
+	if (dlist_empty(&ep->cork_entry)) {
+		ep->cork_time = ofi_gettime_us();
+		dlist_insert_tail(&ep->cork_entry,
+				  &xnet_ep2_progress(ep)->cork_list);
+	}
+}
+
+static bool xnet_cork_expired(struct xnet_ep *ep)
+{
+	return ofi_gettime_us() - ep->cork_time >= (uint64_t) xnet_cork_delay;
+}
+
+static void xnet_hist_tx(struct xnet_ep *ep, struct xnet_xfer_entry *tx_entry)
+{
+	uint64_t now = ofi_gettime_ns();
+
+	if (!(tx_entry->ctrl_flags & XNET_TX_STARTED)) {
+		ofi_hist_add(&ep->hist->hist[XNET_HIST_TX_QUEUE],
+			     now - tx_entry->hist_time);
+		tx_entry->hist_time = now;
+		tx_entry->ctrl_flags |= XNET_TX_STARTED;
+	}
+	if (!ep->cur_tx.data_left)
+		ofi_hist_add(&ep->hist->hist[XNET_HIST_TX_WIRE],
+			     now - tx_entry->hist_time);
+}
+
 static int xnet_send_msg(struct xnet_ep *ep)
 {
 	struct xnet_xfer_entry *tx_entry;
@@ -436,6 +511,12 @@ static int xnet_send_msg(struct xnet_ep *ep)
 	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
 	assert(ep->cur_tx.entry);
 	tx_entry = ep->cur_tx.entry;
+	if (xnet_can_cork(ep)) {
+		xnet_cork(ep);
+		ep->cur_tx.data_left = 0;
+		return FI_SUCCESS;
+	}
+
 	ret = ofi_bsock_sendv(&ep->bsock, tx_entry->iov, tx_entry->iov_cnt,
 			      &len);
 	if (ret < 0 && ret != -OFI_EINPROGRESS_ASYNC)
@@ -451,6 +532,9 @@ static int xnet_send_msg(struct xnet_ep *ep)
 	}
 
 	ep->cur_tx.data_left -= len;
+	if (tx_entry->hist_time && len)
+		xnet_hist_tx(ep, tx_entry);
+
 	if (ep->cur_tx.data_left) {
 		ofi_consume_iov(tx_entry->iov, &tx_entry->iov_cnt, len);
 		return -FI_EAGAIN;
@@ -480,6 +564,11 @@ start:
 		return ret;
 	}
 
+	if (ep->cur_rx.hdr.base_hdr.flags & XNET_INTEGRITY) {
+		ep->cur_rx.crc = ofi_crc32c_iov(ep->cur_rx.crc, rx_entry->iov,
+						rx_entry->iov_cnt, len);
+	}
+
 	ep->cur_rx.data_left -= len;
 	if (!ep->cur_rx.data_left)
 		return FI_SUCCESS;
@@ -587,6 +676,12 @@ static void xnet_progress_tx(struct xnet_ep *ep)
 		xnet_complete_tx(ep, ret);
 	}
 
+	if (!dlist_empty(&ep->cork_entry)) {
+		if (!(ep->pollflags & POLLOUT) && !xnet_cork_expired(ep))
+			return;
+		dlist_remove_init(&ep->cork_entry);
+	}
+
 	/* Buffered data is sent first by xnet_send_msg, but if we don't
 	 * have other data to send, we need to try flushing any buffered data.
 	 */
@@ -757,6 +852,8 @@ int xnet_start_recv(struct xnet_ep *ep, struct xnet_xfer_entry *rx_entry)
 
 	ep->cur_rx.entry = rx_entry;
 	ep->cur_rx.handler = xnet_recv_msg_data;
+	if (msg->hist_time && !(rx_entry->ctrl_flags & XNET_SAVED_XFER))
+		xnet_hist_add(ep->hist, XNET_HIST_RX_MATCH, msg->hist_time);
 
 	if ((msg->hdr.base_hdr.op == xnet_op_tag_rts) &&
 	    !(rx_entry->ctrl_flags & XNET_SAVED_XFER)) {
@@ -832,25 +929,177 @@ static int xnet_handle_tag(struct xnet_ep *ep)
 	return -FI_EAGAIN;
 }
 
+/* Split the rendezvous data across the primary connection and each
+ * connected lane.  The tx_entry stays on the rts_queue until the peer
+ * acks the transfer with a second cts, which also keeps the cts index
+ * in use at the peer until all stripes have arrived.
+ */
+static bool
+xnet_stripe_tx(struct xnet_ep *ep, struct xnet_xfer_entry *tx_entry)
+{
+	struct xnet_xfer_entry *stripes[XNET_MAX_STRIPES];
+	struct xnet_ep *lanes[XNET_MAX_STRIPES];
+	struct xnet_conn *conn;
+	uint64_t msg_len, offset, len;
+	size_t i, cnt, iov_cnt;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	if (!(ep->util_ep.flags & XNET_EP_STRIPE) || xnet_stripe_cnt < 2 ||
+	    (tx_entry->hdr.base_hdr.flags &
+	     (XNET_DELIVERY_COMPLETE | XNET_COMMIT_COMPLETE)))
+		return false;
+
+	msg_len = tx_entry->hdr.base_hdr.size - tx_entry->hdr.base_hdr.hdr_size;
+	if (msg_len < xnet_stripe_size || msg_len < XNET_MAX_STRIPES)
+		return false;
+
+	conn = ep->util_ep.ep_fid.fid.context;
+	if (conn->flags & (XNET_CONN_TX_LOOPBACK | XNET_CONN_RX_LOOPBACK))
+		return false;
+
+	assert(conn->ep == ep);
+	lanes[0] = ep;
+	cnt = xnet_get_tx_lanes(conn, &lanes[1]) + 1;
+	if (cnt == 1)
+		return false;
+
+	len = msg_len / cnt;
+	for (i = 0; i < cnt; i++) {
+		stripes[i] = xnet_alloc_tx(lanes[i]);
+		if (!stripes[i])
+			goto free;
+	}
+
+	for (i = 0, offset = 0; i < cnt; i++, offset += len) {
+		if (i == cnt - 1)
+			len = msg_len - offset;
+
+		stripes[i]->ctrl_flags = XNET_INTERNAL_XFER | XNET_STRIPE;
+		stripes[i]->hdr.base_hdr.op = xnet_op_data;
+		stripes[i]->hdr.base_hdr.op_data = tx_entry->hdr.base_hdr.op_data;
+		stripes[i]->hdr.base_hdr.flags = XNET_STRIPED;
+		stripes[i]->hdr.base_hdr.hdr_size =
+			sizeof(stripes[i]->hdr.stripe_hdr);
+		stripes[i]->hdr.base_hdr.size =
+			stripes[i]->hdr.base_hdr.hdr_size + len;
+		stripes[i]->hdr.stripe_hdr.offset = offset;
+
+		stripes[i]->iov[0].iov_base = (void *) &stripes[i]->hdr;
+		stripes[i]->iov[0].iov_len = stripes[i]->hdr.base_hdr.hdr_size;
+		iov_cnt = tx_entry->iov_cnt - 1;
+		memcpy(&stripes[i]->iov[1], &tx_entry->iov[1],
+		       sizeof(*tx_entry->iov) * iov_cnt);
+		ofi_consume_iov(&stripes[i]->iov[1], &iov_cnt, offset);
+		(void) ofi_truncate_iov(&stripes[i]->iov[1], &iov_cnt, len);
+		stripes[i]->iov_cnt = iov_cnt + 1;
+	}
+
+	tx_entry->ctrl_flags |= XNET_STRIPE;
+	for (i = 0; i < cnt; i++)
+		xnet_tx_queue_insert(lanes[i], stripes[i]);
+	return true;
+
+free:
+	while (i--)
+		xnet_free_xfer(xnet_ep2_progress(ep), stripes[i]);
+	return false;
+}
+
 static int xnet_handle_cts(struct xnet_ep *ep)
 {
 	struct xnet_xfer_entry *tx_entry;
+	uint8_t rts_ctx;
 
 	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
-	tx_entry = ofi_byte_idx_remove(&ep->rts_queue,
-				       ep->cur_rx.hdr.base_hdr.op_data);
+	rts_ctx = ep->cur_rx.hdr.base_hdr.op_data;
+	tx_entry = ofi_byte_idx_lookup(&ep->rts_queue, rts_ctx);
 	if (!tx_entry) {
 		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "Invalid cst index\n");
 		return -FI_EINVAL;
 	}
 
+	if (tx_entry->ctrl_flags & XNET_STRIPE) {
+		/* peer received all stripes */
+		ofi_byte_idx_remove(&ep->rts_queue, rts_ctx);
+		xnet_report_success(tx_entry);
+		xnet_free_xfer(xnet_ep2_progress(ep), tx_entry);
+		xnet_reset_rx(ep);
+		return 0;
+	}
+
 	assert(tx_entry->ctrl_flags & XNET_NEED_CTS);
 	tx_entry->ctrl_flags &= ~XNET_NEED_CTS;
-	xnet_tx_queue_insert(ep, tx_entry);
+	if (!xnet_stripe_tx(ep, tx_entry)) {
+		ofi_byte_idx_remove(&ep->rts_queue, rts_ctx);
+		xnet_tx_queue_insert(ep, tx_entry);
+	}
 	xnet_reset_rx(ep);
 	return 0;
 }
 
+/* Stripes may arrive over any connection to the peer, but the matching
+ * receive is always tracked by the primary connection.
+ */
+static int xnet_handle_stripe(struct xnet_ep *ep)
+{
+	struct xnet_xfer_entry *rx_entry, *stripe;
+	struct xnet_stripe_hdr *hdr;
+	struct xnet_conn *conn;
+	size_t len;
+	int ret;
+
+	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	hdr = &ep->cur_rx.hdr.stripe_hdr;
+	if (!ep->srx || !ep->srx->rdm ||
+	    hdr->base_hdr.hdr_size < sizeof(*hdr)) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "Invalid stripe\n");
+		return -FI_EIO;
+	}
+
+	conn = ep->util_ep.ep_fid.fid.context;
+	rx_entry = conn->ep ? ofi_byte_idx_lookup(&conn->ep->cts_queue,
+						  hdr->base_hdr.op_data) : NULL;
+	if (!rx_entry) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "Invalid cts index\n");
+		return -FI_EINVAL;
+	}
+
+	len = ep->cur_rx.data_left;
+	if (len > rx_entry->stripe_left ||
+	    hdr->offset + len > xnet_msg_len(&rx_entry->hdr)) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "rts - stripe size mismatch\n");
+		return -FI_EIO;
+	}
+
+	stripe = xnet_alloc_xfer(xnet_ep2_progress(ep));
+	if (!stripe)
+		return -FI_ENOMEM;
+
+	memcpy(&stripe->hdr, hdr, sizeof(*hdr));
+	stripe->ctrl_flags = XNET_INTERNAL_XFER | XNET_STRIPE;
+	stripe->stripe_left = len;
+
+	if (hdr->offset + len >
+	    ofi_total_iov_len(rx_entry->iov, rx_entry->iov_cnt)) {
+		/* stage the stripe and copy what fits when it completes */
+		ret = xnet_alloc_xfer_buf(stripe, len);
+		if (ret) {
+			xnet_free_xfer(xnet_ep2_progress(ep), stripe);
+			return ret;
+		}
+	} else {
+		stripe->iov_cnt = rx_entry->iov_cnt;
+		memcpy(stripe->iov, rx_entry->iov,
+		       sizeof(*rx_entry->iov) * rx_entry->iov_cnt);
+		ofi_consume_iov(stripe->iov, &stripe->iov_cnt, hdr->offset);
+		(void) ofi_truncate_iov(stripe->iov, &stripe->iov_cnt, len);
+	}
+
+	ep->cur_rx.entry = stripe;
+	ep->cur_rx.handler = xnet_recv_msg_data;
+	return xnet_recv_msg_data(ep);
+}
+
 static int xnet_handle_data(struct xnet_ep *ep)
 {
 	struct xnet_xfer_entry *rx_entry;
@@ -859,6 +1108,9 @@ static int xnet_handle_data(struct xnet_ep *ep)
 	uint8_t cts_ctx;
 
 	assert(xnet_progress_locked(xnet_ep2_progress(ep)));
+	if (msg->hdr.base_hdr.flags & XNET_STRIPED)
+		return xnet_handle_stripe(ep);
+
 	cts_ctx = ep->cur_rx.hdr.base_hdr.op_data;
 	rx_entry = ofi_byte_idx_clear(&ep->cts_queue, cts_ctx);
 	if (!rx_entry) {
@@ -1043,6 +1295,7 @@ static int xnet_progress_hdr(struct xnet_ep *ep)
 	ep->cur_rx.data_left = ep->cur_rx.hdr.base_hdr.size -
 			       ep->cur_rx.hdr.base_hdr.hdr_size;
 	ep->cur_rx.handler = xnet_start_op[ep->cur_rx.hdr.base_hdr.op];
+	ep->cur_rx.hist_time = ep->hist ? ofi_gettime_ns() : 0;
 	return FI_SUCCESS;
 }
 
@@ -1080,6 +1333,96 @@ next_hdr:
 	return ep->cur_rx.handler(ep);
 }
 
+/* The receive completes once its last stripe arrives, which is acked
+ * to the peer over the primary connection.  If a stripe fails, the
+ * receive is failed when the primary connection is torn down.
+ */
+static void xnet_complete_stripe(struct xnet_ep *ep,
+				 struct xnet_xfer_entry *stripe, ssize_t ret)
+{
+	struct xnet_xfer_entry *rx_entry;
+	struct xnet_conn *conn;
+	struct xnet_ep *owner;
+	uint8_t cts_ctx;
+
+	conn = ep->util_ep.ep_fid.fid.context;
+	owner = conn->ep;
+	assert(owner);
+	cts_ctx = stripe->hdr.base_hdr.op_data;
+
+	if (ret) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
+			"stripe recv failed ret = %zd (%s)\n", ret,
+			fi_strerror((int) -ret));
+		goto disable;
+	}
+
+	rx_entry = ofi_byte_idx_lookup(&owner->cts_queue, cts_ctx);
+	if (!rx_entry) {
+		/* primary connection was flushed */
+		xnet_free_xfer(xnet_ep2_progress(ep), stripe);
+		xnet_reset_rx(ep);
+		return;
+	}
+
+	if (stripe->ctrl_flags & XNET_FREE_BUF) {
+		(void) ofi_copy_to_iov(rx_entry->iov, rx_entry->iov_cnt,
+				       stripe->hdr.stripe_hdr.offset,
+				       stripe->user_buf, stripe->stripe_left);
+		rx_entry->stripe_err = FI_ETRUNC;
+	}
+
+	assert(rx_entry->stripe_left >= stripe->stripe_left);
+	rx_entry->stripe_left -= stripe->stripe_left;
+	xnet_free_xfer(xnet_ep2_progress(ep), stripe);
+	xnet_reset_rx(ep);
+	if (rx_entry->stripe_left)
+		return;
+
+	ofi_byte_idx_clear(&owner->cts_queue, cts_ctx);
+	if (rx_entry->stripe_err) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA, "msg recv truncated\n");
+		xnet_cntr_incerr(rx_entry);
+		xnet_report_error(rx_entry, rx_entry->stripe_err);
+	} else {
+		xnet_report_success(rx_entry);
+	}
+	xnet_free_xfer(xnet_ep2_progress(ep), rx_entry);
+
+	if (xnet_queue_ack(owner, xnet_op_cts, cts_ctx))
+		xnet_ep_disable(owner, 0, NULL, 0);
+	return;
+
+disable:
+	xnet_free_xfer(xnet_ep2_progress(ep), stripe);
+	xnet_reset_rx(ep);
+	xnet_ep_disable(ep, 0, NULL, 0);
+}
+
+static int xnet_check_integrity(struct xnet_ep *ep)
+{
+	uint32_t crc;
+
+	/* Data received through io_uring is not seen by the CRC */
+	if (!(ep->cur_rx.hdr.base_hdr.flags & XNET_INTEGRITY) || xnet_io_uring)
+		return 0;
+
+	if (ep->cur_rx.hdr.base_hdr.hdr_size <
+	    sizeof(ep->cur_rx.hdr.base_hdr) + XNET_CRC_TRAILER)
+		return -FI_EIO;
+
+	memcpy(&crc, (uint8_t *) &ep->cur_rx.hdr +
+	       ep->cur_rx.hdr.base_hdr.hdr_size - XNET_CRC_TRAILER,
+	       sizeof(crc));
+	if (ntohl(crc) != ep->cur_rx.crc) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_DATA,
+			"payload crc mismatch: expected 0x%x, computed 0x%x\n",
+			ntohl(crc), ep->cur_rx.crc);
+		return -FI_EIO;
+	}
+	return 0;
+}
+
 static void xnet_complete_rx(struct xnet_ep *ep, ssize_t ret)
 {
 	struct xnet_xfer_entry *rx_entry;
@@ -1087,9 +1430,27 @@ static void xnet_complete_rx(struct xnet_ep *ep, ssize_t ret)
 	rx_entry = ep->cur_rx.entry;
 	assert(rx_entry);
 
+	if (rx_entry->ctrl_flags & XNET_STRIPE) {
+		xnet_complete_stripe(ep, rx_entry, ret);
+		return;
+	}
+
 	if (ret)
 		goto cq_error;
 
+	ret = xnet_check_integrity(ep);
+	if (ret) {
+		/* Saved messages are reported when matched by a receive */
+		if (rx_entry->ctrl_flags & XNET_SAVED_XFER) {
+			rx_entry->ctrl_flags |= XNET_BAD_CRC;
+			rx_entry->saving_ep = NULL;
+			xnet_reset_rx(ep);
+			xnet_ep_disable(ep, 0, NULL, 0);
+			return;
+		}
+		goto cq_error;
+	}
+
 	if (rx_entry->hdr.base_hdr.flags & XNET_COMMIT_COMPLETE)
 		xnet_pmem_commit(ep, rx_entry);
 
@@ -1415,6 +1776,52 @@ int xnet_uring_cancel(struct xnet_progress *progress,
 	return 0;
 }
 
+/* Move any inline data past a trailer holding the CRC of the payload */
+static void xnet_add_integrity(struct xnet_xfer_entry *tx_entry)
+{
+	struct xnet_base_hdr *hdr = &tx_entry->hdr.base_hdr;
+	uint8_t *trailer;
+	size_t inline_len;
+	uint32_t crc;
+
+	assert(tx_entry->iov[0].iov_base == (void *) &tx_entry->hdr);
+	assert(hdr->hdr_size + XNET_CRC_TRAILER <= XNET_MAX_HDR);
+	trailer = (uint8_t *) &tx_entry->hdr + hdr->hdr_size;
+	inline_len = tx_entry->iov[0].iov_len - hdr->hdr_size;
+
+	crc = ofi_crc32c(0, trailer, inline_len);
+	crc = ofi_crc32c_iov(crc, &tx_entry->iov[1], tx_entry->iov_cnt - 1,
+			     SIZE_MAX);
+
+	memmove(trailer + XNET_CRC_TRAILER, trailer, inline_len);
+	memset(trailer, 0, XNET_CRC_TRAILER);
+	crc = htonl(crc);
+	memcpy(trailer, &crc, sizeof(crc));
+
+	hdr->flags |= XNET_INTEGRITY;
+	hdr->hdr_size += XNET_CRC_TRAILER;
+	hdr->size += XNET_CRC_TRAILER;
+	tx_entry->iov[0].iov_len += XNET_CRC_TRAILER;
+}
+
+static bool xnet_need_integrity(struct xnet_xfer_entry *tx_entry)
+{
+	struct xnet_base_hdr *hdr = &tx_entry->hdr.base_hdr;
+
+	if (!xnet_integrity || (hdr->flags & (XNET_INTEGRITY | XNET_STRIPED)))
+		return false;
+
+	switch (hdr->op) {
+	case xnet_op_msg:
+	case xnet_op_tag:
+		return !(tx_entry->ctrl_flags & XNET_INTERNAL_XFER);
+	case xnet_op_data:
+		return true;
+	default:
+		return false;
+	}
+}
+
 void xnet_tx_queue_insert(struct xnet_ep *ep,
 			  struct xnet_xfer_entry *tx_entry)
 {
@@ -1423,13 +1830,18 @@ void xnet_tx_queue_insert(struct xnet_ep *ep,
 	progress = xnet_ep2_progress(ep);
 	assert(xnet_progress_locked(progress));
 
+	if (xnet_need_integrity(tx_entry))
+		xnet_add_integrity(tx_entry);
+
+	tx_entry->ctrl_flags &= ~XNET_TX_STARTED;
+	tx_entry->hist_time = ep->hist ? ofi_gettime_ns() : 0;
 	if (!ep->cur_tx.entry) {
 		ep->cur_tx.entry = tx_entry;
 		ep->cur_tx.data_left = tx_entry->hdr.base_hdr.size;
 		OFI_DBG_SET(tx_entry->hdr.base_hdr.id, ep->tx_id++);
 		ep->hdr_bswap(ep, &tx_entry->hdr.base_hdr);
 		xnet_progress_tx(ep);
-		if (xnet_io_uring)
+		if (xnet_io_uring && !progress->uring_batch)
 			xnet_submit_uring(&progress->tx_uring);
 	} else if (tx_entry->ctrl_flags & XNET_INTERNAL_XFER) {
 		slist_insert_tail(&tx_entry->entry, &ep->priority_queue);
@@ -1488,10 +1900,13 @@ xnet_handle_events(struct xnet_progress *progress,
 		   bool clear_signal)
 {
 	struct fid *fid;
-	bool pin, pout, perr;
+	bool pin, pout, perr, batch = false;
 	int i;
 
 	assert(ofi_genlock_held(progress->active_lock));
+	if (xnet_io_uring)
+		batch = xnet_uring_batch_begin(progress);
+
 	for (i = 0; i < nfds; i++) {
 		fid = events[i].data.ptr;
 		assert(fid);
@@ -1514,18 +1929,19 @@ xnet_handle_events(struct xnet_progress *progress,
 			xnet_progress_uring(progress, events[i].data.ptr);
 			break;
 		default:
+			/* Either our signal or a nested shard's epoll fd.
+			 * Shards are driven from xnet_run_progress.
+			 */
 			assert(fid->fclass == XNET_CLASS_PROGRESS);
-			if (clear_signal)
+			if (clear_signal && fid == &progress->fid)
 				fd_signal_reset(&progress->signal);
 			break;
 		}
 	}
 
 	xnet_handle_event_list(progress);
-	if (xnet_io_uring) {
-		xnet_submit_uring(&progress->tx_uring);
-		xnet_submit_uring(&progress->rx_uring);
-	}
+	if (xnet_io_uring)
+		xnet_uring_batch_end(progress, batch);
 }
 
 void xnet_progress_unexp(struct xnet_progress *progress,
@@ -1533,34 +1949,75 @@ void xnet_progress_unexp(struct xnet_progress *progress,
 {
 	struct dlist_entry *item, *tmp;
 	struct xnet_ep *ep;
+	bool batch = false;
 
 	assert(ofi_genlock_held(progress->active_lock));
+	if (xnet_io_uring)
+		batch = xnet_uring_batch_begin(progress);
+
 	dlist_foreach_safe(unexp_list, item, tmp) {
 		ep = container_of(item, struct xnet_ep, unexp_entry);
 		assert(xnet_has_unexp(ep));
 		assert(ep->state == XNET_CONNECTED);
 		xnet_progress_rx(ep);
-		if (xnet_io_uring)
-			xnet_submit_uring(&progress->rx_uring);
+	}
+
+	if (xnet_io_uring)
+		xnet_uring_batch_end(progress, batch);
+}
+
+static void xnet_flush_corked(struct xnet_progress *progress)
+{
+	struct xnet_ep *ep;
+	int ret;
+
+	while (!dlist_empty(&progress->cork_list)) {
+		ep = container_of(progress->cork_list.next, struct xnet_ep,
+				  cork_entry);
+		dlist_remove_init(&ep->cork_entry);
+		if (ep->pollflags & POLLOUT)
+			continue;
+
+		ret = ofi_bsock_flush(&ep->bsock);
+		if (ret && ret != -FI_EAGAIN) {
+			xnet_ep_disable(ep, 0, NULL, 0);
+			continue;
+		}
+
+		if (xnet_update_pollflag(ep, POLLOUT,
+					 ofi_bsock_tosend(&ep->bsock)))
+			xnet_ep_disable(ep, 0, NULL, 0);
 	}
 }
 
 void xnet_run_progress(struct xnet_progress *progress, bool clear_signal)
 {
+	size_t i;
+	bool batch;
 	int nfds;
 
 	assert(ofi_genlock_held(progress->active_lock));
+	if (!dlist_empty(&progress->cork_list))
+		xnet_flush_corked(progress);
 	if (xnet_io_uring) {
+		batch = xnet_uring_batch_begin(progress);
 		xnet_progress_uring(progress, &progress->tx_uring);
 		xnet_progress_uring(progress, &progress->rx_uring);
 		xnet_handle_event_list(progress);
-		xnet_submit_uring(&progress->tx_uring);
-		xnet_submit_uring(&progress->rx_uring);
+		xnet_uring_batch_end(progress, batch);
 	} else {
 		nfds = ofi_dynpoll_wait(&progress->epoll_fd, &progress->events[0],
 					ARRAY_SIZE(progress->events), 0);
 		xnet_handle_events(progress, &progress->events[0], nfds, clear_signal);
 	}
+
+	/* Shards with their own thread are left to it.  Lock order is
+	 * always the domain progress, then the shard.
+	 */
+	for (i = 0; i < progress->shard_cnt; i++) {
+		if (!progress->shards[i].auto_progress)
+			xnet_progress(&progress->shards[i], clear_signal);
+	}
 }
 
 void xnet_progress(struct xnet_progress *progress, bool clear_signal)
@@ -1626,7 +2083,7 @@ int xnet_trywait(struct fid_fabric *fabric_fid, struct fid **fid, int count)
 			cq = container_of(fid[i], struct xnet_cq,
 					  util_cq.cq_fid.fid);
 			ofi_genlock_lock(xnet_cq2_progress(cq)->active_lock);
-			if (ofi_cirque_isempty(cq->util_cq.cirq))
+			if (ofi_cq_isempty(&cq->util_cq))
 				xnet_reset_wait(cq->util_cq.wait);
 			else
 				ret = -FI_EAGAIN;
@@ -1692,14 +2149,23 @@ int xnet_progress_wait(struct xnet_progress *progress, int timeout)
 static void *xnet_auto_progress(void *arg)
 {
 	struct xnet_progress *progress = arg;
-	int nfds;
+	int nfds, timeout;
+
+	/* Wake up periodically to flush corked sends */
+	timeout = xnet_cork_delay ? (xnet_cork_delay + 999) / 1000 : -1;
 
 	FI_INFO(&xnet_prov, FI_LOG_DOMAIN, "progress thread starting\n");
+	if (progress->cpus && ofi_set_thread_affinity(progress->cpus)) {
+		FI_WARN(&xnet_prov, FI_LOG_DOMAIN,
+			"unable to pin progress thread to cpus %s\n",
+			progress->cpus);
+	}
+
 	ofi_genlock_lock(progress->active_lock);
 	while (progress->auto_progress) {
 		ofi_genlock_unlock(progress->active_lock);
 
-		nfds = xnet_progress_wait(progress, -1);
+		nfds = xnet_progress_wait(progress, timeout);
 		ofi_genlock_lock(progress->active_lock);
 		if (nfds >= 0)
 			xnet_run_progress(progress, true);
@@ -1738,6 +2204,29 @@ void xnet_halt_sock(struct xnet_progress *progress, SOCKET sock)
 	}
 }
 
+/* A shard driven by its own thread no longer needs to wake the domain */
+static int xnet_start_shards(struct xnet_progress *progress)
+{
+	struct xnet_progress *shard;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < progress->shard_cnt; i++) {
+		shard = &progress->shards[i];
+		if (shard->auto_progress)
+			continue;
+
+		ret = xnet_start_progress(shard);
+		if (ret)
+			return ret;
+
+		if (shard->auto_progress)
+			(void) ofi_dynpoll_del(&progress->epoll_fd,
+					ofi_dynpoll_get_fd(&shard->epoll_fd));
+	}
+	return 0;
+}
+
 int xnet_start_progress(struct xnet_progress *progress)
 {
 	int ret;
@@ -1763,7 +2252,7 @@ int xnet_start_progress(struct xnet_progress *progress)
 
 unlock:
 	ofi_genlock_unlock(progress->active_lock);
-	return ret;
+	return ret ? ret : xnet_start_shards(progress);
 }
 
 void xnet_stop_progress(struct xnet_progress *progress)
@@ -1855,9 +2344,14 @@ int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 
 	progress->fid.fclass = XNET_CLASS_PROGRESS;
 	progress->auto_progress = false;
+	progress->uring_batch = false;
+	progress->cpus = NULL;
+	progress->shards = NULL;
+	progress->shard_cnt = 0;
 	dlist_init(&progress->unexp_msg_list);
 	dlist_init(&progress->unexp_tag_list);
 	dlist_init(&progress->saved_tag_list);
+	dlist_init(&progress->cork_list);
 	slist_init(&progress->event_list);
 
 	ret = fd_signal_init(&progress->signal);
@@ -1930,13 +2424,133 @@ err1:
 	return ret;
 }
 
+/* When steering by incoming cpu, shard i's thread runs on the cpus that
+ * map to it, so that it shares a core with the softirqs for its sockets.
+ */
+static void xnet_set_shard_cpus(struct xnet_progress *shard, size_t index,
+				size_t cnt)
+{
+	char buf[64];
+	long cpu_cnt;
+
+	cpu_cnt = ofi_sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpu_cnt <= 0 || index >= (size_t) cpu_cnt)
+		return;
+
+	snprintf(buf, sizeof(buf), "%zu-%ld:%zu", index, cpu_cnt - 1, cnt);
+	shard->cpus = strdup(buf);
+}
+
+/* Each shard's epoll fd is nested in the domain's, so that waiting on the
+ * domain, or on a wait set built over it, also wakes on shard activity.
+ */
+int xnet_init_shards(struct xnet_progress *progress, struct fi_info *info,
+		     size_t cnt)
+{
+	struct xnet_progress *shard;
+	size_t i;
+	int ret;
+
+	assert(!progress->shard_cnt);
+	progress->shards = calloc(cnt, sizeof(*progress->shards));
+	if (!progress->shards)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < cnt; i++) {
+		shard = &progress->shards[i];
+		ret = xnet_init_progress(shard, info);
+		if (ret)
+			goto err;
+
+		if (xnet_busy_poll)
+			xnet_set_shard_cpus(shard, i, cnt);
+
+		ret = ofi_dynpoll_add(&progress->epoll_fd,
+				      ofi_dynpoll_get_fd(&shard->epoll_fd),
+				      POLLIN, &shard->fid);
+		if (ret) {
+			xnet_close_progress(shard);
+			goto err;
+		}
+	}
+
+	ofi_atomic_initialize32(&progress->next_shard, 0);
+	progress->shard_cnt = cnt;
+	FI_INFO(&xnet_prov, FI_LOG_DOMAIN, "using %zu progress shards\n", cnt);
+	return 0;
+
+err:
+	while (i--) {
+		shard = &progress->shards[i];
+		(void) ofi_dynpoll_del(&progress->epoll_fd,
+				       ofi_dynpoll_get_fd(&shard->epoll_fd));
+		xnet_close_progress(shard);
+	}
+	free(progress->shards);
+	progress->shards = NULL;
+	return ret;
+}
+
+/* Endpoints are assigned to shards round robin */
+struct xnet_progress *xnet_get_shard(struct xnet_progress *progress)
+{
+	uint32_t i;
+
+	if (!progress->shard_cnt)
+		return progress;
+
+	i = (uint32_t) ofi_atomic_inc32(&progress->next_shard);
+	return &progress->shards[i % progress->shard_cnt];
+}
+
+/* With busy polling, an accepted socket goes to the shard that runs on
+ * the cpu where its packets are being received.
+ */
+struct xnet_progress *xnet_get_sock_shard(struct xnet_progress *progress,
+					  SOCKET sock)
+{
+#ifdef SO_INCOMING_CPU
+	socklen_t len = sizeof(int);
+	int cpu;
+
+	if (progress->shard_cnt && xnet_busy_poll &&
+	    !getsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) &&
+	    cpu >= 0) {
+		FI_DBG(&xnet_prov, FI_LOG_EP_CTRL,
+		       "steering socket on cpu %d to shard %zu\n",
+		       cpu, (size_t) cpu % progress->shard_cnt);
+		return &progress->shards[(size_t) cpu % progress->shard_cnt];
+	}
+#endif
+	return xnet_get_shard(progress);
+}
+
+static void xnet_close_shards(struct xnet_progress *progress)
+{
+	struct xnet_progress *shard;
+	size_t i;
+
+	for (i = 0; i < progress->shard_cnt; i++) {
+		shard = &progress->shards[i];
+		(void) ofi_dynpoll_del(&progress->epoll_fd,
+				       ofi_dynpoll_get_fd(&shard->epoll_fd));
+		xnet_close_progress(shard);
+	}
+	free(progress->shards);
+	progress->shards = NULL;
+	progress->shard_cnt = 0;
+}
+
 void xnet_close_progress(struct xnet_progress *progress)
 {
 	assert(dlist_empty(&progress->unexp_msg_list));
 	assert(dlist_empty(&progress->unexp_tag_list));
 	assert(dlist_empty(&progress->saved_tag_list));
+	assert(dlist_empty(&progress->cork_list));
 	assert(slist_empty(&progress->event_list));
 	xnet_stop_progress(progress);
+	if (progress->shard_cnt)
+		xnet_close_shards(progress);
 	if (xnet_io_uring) {
 		free(progress->cqes);
 		xnet_destroy_uring(&progress->rx_uring, &progress->epoll_fd);
@@ -1947,4 +2561,5 @@ void xnet_close_progress(struct xnet_progress *progress)
 	ofi_genlock_destroy(&progress->ep_lock);
 	ofi_genlock_destroy(&progress->rdm_lock);
 	fd_signal_free(&progress->signal);
+	free(progress->cpus);
 }
@@ -62,10 +62,13 @@ enum {
 
 /* Version 1 adds support for tagged rendezvous transfers.
  * ops: tag_rts, cts, data
+ * Version 2 adds striping rendezvous data across additional connections.
+ * A striped transfer is acked with a second cts once all data arrives.
+ * hdrs: stripe
  * VERSION_FLAG set in a response indicates the peer checks the version
  */
 #define XNET_RDM_VERSION_FLAG	(1 << 7)
-#define XNET_RDM_VERSION	1
+#define XNET_RDM_VERSION	2
 
 #define XNET_CTRL_HDR_VERSION	3
 
@@ -73,9 +76,16 @@ enum {
 	XNET_MAX_CM_DATA_SIZE = (1 << 8)
 };
 
+/* ofi_ctrl_hdr::seg_no flags for cm messages.  With KTLS set, conn_id
+ * and msg_id carry the sender's key exchange nonce, and the cm data is
+ * followed by a key confirmation tag.
+ */
+#define XNET_CM_KTLS		(1 << 0)
+#define XNET_KTLS_TAG_SIZE	16
+
 struct xnet_cm_msg {
 	struct ofi_ctrl_hdr hdr;
-	char data[XNET_MAX_CM_DATA_SIZE];
+	char data[XNET_MAX_CM_DATA_SIZE + XNET_KTLS_TAG_SIZE];
 };
 
 #define XNET_HDR_VERSION	3
@@ -95,6 +105,8 @@ enum {
 /* not used XNET_TRANSMIT_COMPLETE (1 << 1) */
 #define XNET_DELIVERY_COMPLETE	(1 << 2)
 #define XNET_COMMIT_COMPLETE	(1 << 3)
+#define XNET_STRIPED		(1 << 4)
+#define XNET_INTEGRITY		(1 << 5)
 /* no longer used (rxm optimization) XNET_TAGGED (1 << 7) */
 
 /* RDM protocol version 0 */
@@ -146,6 +158,18 @@ struct xnet_tag_rts_data_hdr {
 	uint64_t		size;
 };
 
+/* RDM protocol version 2 */
+struct xnet_stripe_hdr {
+	struct xnet_base_hdr	base_hdr;
+	uint64_t		offset;
+};
+
+/* Header trailer carrying the CRC32C of the payload, set by XNET_INTEGRITY.
+ * The CRC is stored in network byte order in the first 4 bytes.  Peers that
+ * do not check it skip the trailer as part of hdr_size.
+ */
+#define XNET_CRC_TRAILER	8
+
 /* Maximum header is scatter RMA with CQ data */
 #define XNET_MAX_HDR (sizeof(struct xnet_cq_data_hdr) + \
 		     sizeof(struct ofi_rma_iov) * XNET_IOV_LIMIT)
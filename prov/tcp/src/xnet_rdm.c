@@ -653,6 +653,9 @@ static int xnet_rdm_getopt(struct fid *fid, int level, int optname,
 		*((size_t *) optval) = rdm->srx->min_multi_recv_size;
 		*optlen = sizeof(size_t);
 		break;
+	case FI_OPT_TAG_BUCKETS:
+		return fi_getopt(&rdm->srx->rx_fid.fid, level, optname,
+				 optval, optlen);
 	default:
 		return -FI_ENOPROTOOPT;
 	}
@@ -662,7 +665,9 @@ static int xnet_rdm_getopt(struct fid *fid, int level, int optname,
 static int xnet_rdm_setopt(struct fid *fid, int level, int optname,
 			   const void *optval, size_t optlen)
 {
+	struct xnet_progress *progress;
 	struct xnet_rdm *rdm;
+	int ret;
 
 	rdm = container_of(fid, struct xnet_rdm, util_ep.ep_fid.fid);
 	if (level != FI_OPT_ENDPOINT)
@@ -678,6 +683,23 @@ static int xnet_rdm_setopt(struct fid *fid, int level, int optname,
 			"FI_OPT_MIN_MULTI_RECV set to %zu\n",
 			rdm->srx->min_multi_recv_size);
 		break;
+	case FI_OPT_TAG_BUCKETS:
+		return fi_setopt(&rdm->srx->rx_fid.fid, level, optname,
+				 optval, optlen);
+	case FI_OPT_TCP_PRECONNECT:
+		if (!optlen || optlen % sizeof(fi_addr_t))
+			return -FI_EINVAL;
+
+		/* The listening address is only known once enabled */
+		if (!ofi_addr_get_port(&rdm->addr.sa))
+			return -FI_EOPBADSTATE;
+
+		progress = xnet_rdm2_progress(rdm);
+		ofi_genlock_lock(&progress->rdm_lock);
+		ret = xnet_rdm_preconnect(rdm, optval,
+					  optlen / sizeof(fi_addr_t));
+		ofi_genlock_unlock(&progress->rdm_lock);
+		return ret;
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -793,6 +815,7 @@ static int xnet_rdm_close(struct fid *fid)
 		return ret;
 	}
 
+	ofi_hist_set_free(fid, rdm->hist);
 	ofi_endpoint_close(&rdm->util_ep);
 	free(rdm);
 	return 0;
@@ -46,11 +46,27 @@
  */
 struct xnet_rdm_cm {
 	uint8_t version;
-	uint8_t resv;
+	uint8_t lane; /* 0 before version 2 */
 	uint16_t port;
 	uint32_t pid;
 };
 
+/* How long to wait for a peer that refused our connection because its own
+ * request to us takes priority, before connecting again ourselves.
+ */
+#define XNET_PEER_WAIT_MS	2000
+
+static void xnet_free_event(struct xnet_event *event)
+{
+	struct fi_eq_err_entry *err_entry;
+
+	if (event->flags & UTIL_FLAG_ERROR) {
+		err_entry = (struct fi_eq_err_entry *) &event->cm_entry;
+		free(err_entry->err_data);
+	}
+	free(event);
+}
+
 static int xnet_match_event(struct slist_entry *item, const void *arg)
 {
 	struct xnet_event *event;
@@ -62,11 +78,36 @@ static int xnet_match_event(struct slist_entry *item, const void *arg)
 	return event->cm_entry.fid == &ep->util_ep.ep_fid.fid;
 }
 
-static void xnet_close_conn(struct xnet_conn *conn)
+static void xnet_close_ep(struct xnet_conn *conn, struct xnet_ep **ep)
 {
 	struct xnet_event *event;
 	struct slist_entry *item;
 
+	do {
+		item = slist_remove_first_match(
+			&xnet_rdm2_progress(conn->rdm)->event_list,
+			xnet_match_event, *ep);
+		if (!item)
+			break;
+
+		event = container_of(item, struct xnet_event, list_entry);
+		xnet_free_event(event);
+	} while (item);
+
+	if ((*ep)->peer)
+		util_put_peer((*ep)->peer);
+
+	fi_close(&(*ep)->util_ep.ep_fid.fid);
+	*ep = NULL;
+}
+
+/* Lanes are closed first, so that striped transfers are failed by
+ * flushing the primary connection.
+ */
+static void xnet_close_conn(struct xnet_conn *conn)
+{
+	int i;
+
 	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "closing conn %p\n", conn);
 	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
 
@@ -76,25 +117,20 @@ static void xnet_close_conn(struct xnet_conn *conn)
 		conn->flags &= ~XNET_CONN_RX_LOOPBACK;
 	}
 
-	if (!conn->ep)
-		return;
-
-	do {
-		item = slist_remove_first_match(
-			&xnet_rdm2_progress(conn->rdm)->event_list,
-			xnet_match_event, conn->ep);
-		if (!item)
-			break;
-
-		event = container_of(item, struct xnet_event, list_entry);
-		free(event);
-	} while (item);
+	if (conn->flags & XNET_CONN_PRECONNECT) {
+		conn->flags &= ~XNET_CONN_PRECONNECT;
+		conn->rdm->preconnect_active--;
+	}
 
-	if (conn->ep->peer)
-		util_put_peer(conn->ep->peer);
+	for (i = 0; i < XNET_MAX_STRIPES - 1; i++) {
+		if (conn->tx_lanes[i])
+			xnet_close_ep(conn, &conn->tx_lanes[i]);
+		if (conn->rx_lanes[i])
+			xnet_close_ep(conn, &conn->rx_lanes[i]);
+	}
 
-	fi_close(&conn->ep->util_ep.ep_fid.fid);
-	conn->ep = NULL;
+	if (conn->ep)
+		xnet_close_ep(conn, &conn->ep);
 }
 
 /* MSG EPs under an RDM EP do not write events to the EQ. */
@@ -165,12 +201,13 @@ static int xnet_bind_conn(struct xnet_rdm *rdm, struct xnet_ep *ep)
 	ep->util_ep.rx_msg_flags = rdm->util_ep.rx_msg_flags;
 	ep->util_ep.tx_op_flags = rdm->util_ep.tx_op_flags;
 	ep->util_ep.rx_op_flags = rdm->util_ep.rx_op_flags;
-
+	ep->hist = rdm->hist;
 
 	return 0;
 }
 
-static int xnet_open_conn(struct xnet_conn *conn, struct fi_info *info)
+static int xnet_open_conn(struct xnet_conn *conn, struct fi_info *info,
+			  struct xnet_ep **ep)
 {
 	struct fid_ep *ep_fid;
 	int ret;
@@ -183,14 +220,14 @@ static int xnet_open_conn(struct xnet_conn *conn, struct fi_info *info)
 		return ret;
 	}
 
-	conn->ep = container_of(ep_fid, struct xnet_ep, util_ep.ep_fid);
-	ret = xnet_bind_conn(conn->rdm, conn->ep);
+	*ep = container_of(ep_fid, struct xnet_ep, util_ep.ep_fid);
+	ret = xnet_bind_conn(conn->rdm, *ep);
 	if (ret)
 		goto err;
 
-	conn->ep->peer = conn->peer;
+	(*ep)->peer = conn->peer;
 	rxm_ref_peer(conn->peer);
-	ret = fi_enable(&conn->ep->util_ep.ep_fid);
+	ret = fi_enable(&(*ep)->util_ep.ep_fid);
 	if (ret) {
 		XNET_WARN_ERR(FI_LOG_EP_CTRL, "fi_enable", ret);
 		goto err;
@@ -199,18 +236,21 @@ static int xnet_open_conn(struct xnet_conn *conn, struct fi_info *info)
 	return 0;
 
 err:
-	fi_close(&conn->ep->util_ep.ep_fid.fid);
-	conn->ep = NULL;
+	fi_close(&(*ep)->util_ep.ep_fid.fid);
+	*ep = NULL;
 	return ret;
 }
 
-static int xnet_rdm_connect(struct xnet_conn *conn)
+/* Lane 0 is the primary connection, conn->ep */
+static int xnet_rdm_connect(struct xnet_conn *conn, uint8_t lane,
+			    struct xnet_ep **ep)
 {
 	struct xnet_rdm_cm msg;
 	struct fi_info *info;
 	int ret;
 
-	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "connecting %p\n", conn);
+	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "connecting %p lane %d\n",
+	       conn, lane);
 	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
 
 	info = conn->rdm->pep->info;
@@ -221,19 +261,19 @@ static int xnet_rdm_connect(struct xnet_conn *conn)
 	if (!info->dest_addr)
 		return -FI_ENOMEM;
 
-	ret = xnet_open_conn(conn, info);
+	ret = xnet_open_conn(conn, info, ep);
 	if (ret)
 		return ret;
 
 	msg.version = XNET_RDM_VERSION;
 	msg.pid = htonl((uint32_t) getpid());
-	msg.resv = 0;
+	msg.lane = lane;
 	msg.port = htons(ofi_addr_get_port(&conn->rdm->addr.sa));
 
 	ofi_straddr_dbg(&xnet_prov, FI_LOG_EP_CTRL, "rdm addr", &conn->rdm->addr);
 	ofi_straddr_dbg(&xnet_prov, FI_LOG_EP_CTRL, "src addr", info->src_addr);
 
-	ret = fi_connect(&conn->ep->util_ep.ep_fid, info->dest_addr,
+	ret = fi_connect(&(*ep)->util_ep.ep_fid, info->dest_addr,
 			 &msg, sizeof msg);
 	if (ret) {
 		XNET_WARN_ERR(FI_LOG_EP_CTRL, "fi_connect", ret);
@@ -242,7 +282,10 @@ static int xnet_rdm_connect(struct xnet_conn *conn)
 	return 0;
 
 err:
-	xnet_close_conn(conn);
+	if (lane)
+		xnet_close_ep(conn, ep);
+	else
+		xnet_close_conn(conn);
 	return ret;
 }
 
@@ -261,6 +304,43 @@ static void xnet_free_conn(struct xnet_conn *conn)
 	rxm_av_free_conn(av, conn);
 }
 
+static void xnet_set_conn_hist(struct xnet_conn *conn)
+{
+	int i;
+
+	if (conn->ep)
+		conn->ep->hist = conn->rdm->hist;
+	for (i = 0; i < XNET_MAX_STRIPES - 1; i++) {
+		if (conn->tx_lanes[i])
+			conn->tx_lanes[i]->hist = conn->rdm->hist;
+		if (conn->rx_lanes[i])
+			conn->rx_lanes[i]->hist = conn->rdm->hist;
+	}
+}
+
+/* Share the rdm histograms with connections opened before they were */
+void xnet_set_conns_hist(struct xnet_rdm *rdm)
+{
+	struct xnet_conn *conn;
+	struct rxm_av *av;
+	int i, cnt;
+
+	assert(xnet_progress_locked(xnet_rdm2_progress(rdm)));
+	if (rdm->rx_loopback)
+		xnet_set_conn_hist(rdm->rx_loopback);
+
+	if (!rdm->util_ep.av)
+		return;
+
+	av = container_of(rdm->util_ep.av, struct rxm_av, util_av);
+	cnt = (int) rxm_av_max_peers(av);
+	for (i = 0; i < cnt; i++) {
+		conn = ofi_idm_lookup(&rdm->conn_idx_map, i);
+		if (conn)
+			xnet_set_conn_hist(conn);
+	}
+}
+
 void xnet_freeall_conns(struct xnet_rdm *rdm)
 {
 	struct xnet_conn *conn;
@@ -292,6 +372,11 @@ void xnet_freeall_conns(struct xnet_rdm *rdm)
 		xnet_free_conn(conn);
 		assert(!rdm->rx_loopback);
 	}
+
+	free(rdm->preconnect);
+	rdm->preconnect = NULL;
+	rdm->preconnect_cnt = 0;
+	rdm->preconnect_pos = 0;
 }
 
 static struct xnet_conn *
@@ -311,6 +396,8 @@ xnet_alloc_conn(struct xnet_rdm *rdm, struct util_peer_addr *peer)
 	conn->rdm = rdm;
 	conn->flags = 0;
 	conn->peer = peer;
+	memset(conn->tx_lanes, 0, sizeof(conn->tx_lanes));
+	memset(conn->rx_lanes, 0, sizeof(conn->rx_lanes));
 	rxm_ref_peer(peer);
 
 	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "allocated conn %p\n", conn);
@@ -358,19 +445,95 @@ ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t addr,
 		return -FI_ENOMEM;
 
 	if (!(*conn)->ep) {
-		ret = xnet_rdm_connect(*conn);
+		if (((*conn)->flags & XNET_CONN_PEER_WAIT) &&
+		    ofi_gettime_ms() - (*conn)->wait_time < XNET_PEER_WAIT_MS)
+			goto progress;
+
+		(*conn)->flags &= ~XNET_CONN_PEER_WAIT;
+		ret = xnet_rdm_connect(*conn, 0, &(*conn)->ep);
 		if (ret)
 			return ret;
 	}
 
-	if ((*conn)->ep->state != XNET_CONNECTED) {
-		/* Force progress for apps that simply retry sending without
-		 * trying to drive progress in between.
-		 */
-		xnet_run_progress(xnet_rdm2_progress(rdm), false);
-		return -FI_EAGAIN;
+	if ((*conn)->ep->state != XNET_CONNECTED)
+		goto progress;
+
+	return 0;
+
+progress:
+	/* Force progress for apps that simply retry sending without
+	 * trying to drive progress in between.
+	 */
+	xnet_run_progress(xnet_rdm2_progress(rdm), false);
+	return -FI_EAGAIN;
+}
+
+/* Start queued pre-connects, keeping at most xnet_connect_window in
+ * flight so that bulk startup does not overrun the peers' listen backlogs.
+ * Peers we're already connected or connecting to are skipped.
+ */
+static void xnet_start_preconnects(struct xnet_rdm *rdm)
+{
+	struct util_peer_addr **peer;
+	struct xnet_conn *conn;
+	int ret;
+
+	assert(xnet_progress_locked(xnet_rdm2_progress(rdm)));
+	while (rdm->preconnect_pos < rdm->preconnect_cnt &&
+	       rdm->preconnect_active < xnet_connect_window) {
+		peer = ofi_av_addr_context(rdm->util_ep.av,
+				rdm->preconnect[rdm->preconnect_pos++]);
+		conn = xnet_add_conn(rdm, *peer);
+		if (!conn)
+			break;
+
+		if (conn->ep || (conn->flags & XNET_CONN_PEER_WAIT))
+			continue;
+
+		ret = xnet_rdm_connect(conn, 0, &conn->ep);
+		if (ret) {
+			XNET_WARN_ERR(FI_LOG_EP_CTRL, "preconnect", ret);
+			continue;
+		}
+
+		conn->flags |= XNET_CONN_PRECONNECT;
+		rdm->preconnect_active++;
+	}
+
+	if (rdm->preconnect_pos == rdm->preconnect_cnt) {
+		free(rdm->preconnect);
+		rdm->preconnect = NULL;
+		rdm->preconnect_cnt = 0;
+		rdm->preconnect_pos = 0;
+	}
+}
+
+int xnet_rdm_preconnect(struct xnet_rdm *rdm, const fi_addr_t *addrs,
+			size_t cnt)
+{
+	fi_addr_t *pending;
+	size_t left;
+
+	assert(xnet_progress_locked(xnet_rdm2_progress(rdm)));
+	left = rdm->preconnect_cnt - rdm->preconnect_pos;
+	pending = malloc((left + cnt) * sizeof(*pending));
+	if (!pending)
+		return -FI_ENOMEM;
+
+	if (left) {
+		memcpy(pending, &rdm->preconnect[rdm->preconnect_pos],
+		       left * sizeof(*pending));
 	}
+	memcpy(&pending[left], addrs, cnt * sizeof(*pending));
 
+	free(rdm->preconnect);
+	rdm->preconnect = pending;
+	rdm->preconnect_cnt = left + cnt;
+	rdm->preconnect_pos = 0;
+
+	FI_INFO(&xnet_prov, FI_LOG_EP_CTRL, "preconnecting to %zu peers\n",
+		rdm->preconnect_cnt);
+	xnet_start_preconnects(rdm);
 	return 0;
 }
 
@@ -394,12 +557,41 @@ struct xnet_ep *xnet_get_rx_ep(struct xnet_rdm *rdm, fi_addr_t addr)
 	return NULL;
 }
 
+/* Returns the number of connected tx lanes, starting connections for
+ * any that are missing.  Striping is only used with the connected lanes,
+ * so that large transfers are never delayed waiting on a connection.
+ */
+size_t xnet_get_tx_lanes(struct xnet_conn *conn, struct xnet_ep **lanes)
+{
+	size_t i, cnt = 0;
+	int ret;
+
+	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
+	assert(conn->ep && (conn->ep->util_ep.flags & XNET_EP_STRIPE));
+	for (i = 0; i < xnet_stripe_cnt - 1; i++) {
+		if (!conn->tx_lanes[i]) {
+			ret = xnet_rdm_connect(conn, (uint8_t) (i + 1),
+					       &conn->tx_lanes[i]);
+			if (ret)
+				break;
+			continue;
+		}
+
+		if (conn->tx_lanes[i]->state == XNET_CONNECTED)
+			lanes[cnt++] = conn->tx_lanes[i];
+	}
+	return cnt;
+}
+
 static void xnet_set_protocol(struct xnet_ep *ep, struct xnet_rdm_cm *msg)
 {
 	if (!(msg->version & XNET_RDM_VERSION_FLAG))
 		return;
 
 	switch (msg->version & ~XNET_RDM_VERSION_FLAG) {
+	case 2:
+		ep->util_ep.flags |= XNET_EP_STRIPE;
+		/* fall through */
 	case 1:
 		ep->util_ep.flags |= XNET_EP_RENDEZVOUS;
 		/* fall through */
@@ -418,6 +610,46 @@ static void xnet_set_rdm_version(struct xnet_rdm_cm *msg)
 	msg->version |= XNET_RDM_VERSION_FLAG;
 }
 
+/* A lane is only accepted alongside a connected primary connection.  A
+ * restarted peer replaces the primary connection, which closes its lanes,
+ * before opening new ones.  Any existing lane is being replaced by the peer.
+ */
+static int xnet_accept_lane(struct xnet_rdm *rdm, struct util_peer_addr *peer,
+			    struct fi_eq_cm_entry *cm_entry)
+{
+	struct xnet_rdm_cm *msg;
+	struct xnet_conn *conn;
+	struct xnet_ep **lane;
+	int ret;
+
+	msg = (struct xnet_rdm_cm *) cm_entry->data;
+	conn = ofi_idm_lookup(&rdm->conn_idx_map, peer->index);
+	if (!conn || !conn->ep || conn->ep->state != XNET_CONNECTED ||
+	    !(conn->ep->util_ep.flags & XNET_EP_STRIPE) ||
+	    msg->lane >= XNET_MAX_STRIPES) {
+		FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+			"reject lane %d for %p\n", msg->lane, conn);
+		return -FI_ECONNREFUSED;
+	}
+
+	FI_INFO(&xnet_prov, FI_LOG_EP_CTRL, "accept lane %d for %p\n",
+		msg->lane, conn);
+	lane = &conn->rx_lanes[msg->lane - 1];
+	if (*lane)
+		xnet_close_ep(conn, lane);
+
+	ret = xnet_open_conn(conn, cm_entry->info, lane);
+	if (ret)
+		return ret;
+
+	msg->pid = htonl((uint32_t) getpid());
+	xnet_set_rdm_version(msg);
+	ret = fi_accept(&(*lane)->util_ep.ep_fid, msg, sizeof(*msg));
+	if (ret)
+		xnet_close_ep(conn, lane);
+	return ret;
+}
+
 static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 {
 	struct xnet_rdm *rdm;
@@ -444,6 +676,16 @@ static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 		goto reject;
 	}
 
+	if (msg->lane) {
+		ret = xnet_accept_lane(rdm, peer, cm_entry);
+		if (ret)
+			goto put;
+
+		util_put_peer(peer);
+		fi_freeinfo(cm_entry->info);
+		return;
+	}
+
 	conn = xnet_add_conn(rdm, peer);
 	if (!conn)
 		goto put;
@@ -458,9 +700,13 @@ static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 		/* simultaneous connections */
 		cmp = ofi_addr_cmp(&xnet_prov, &peer_addr.sa, &rdm->addr.sa);
 		if (cmp < 0) {
-			/* let our request finish */
+			/* Let our request finish.  Versioning the reject tells
+			 * the peer to wait for our request instead of retrying.
+			 */
 			FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
 				"simultaneous, reject peer %p\n", conn);
+			msg->pid = htonl((uint32_t) getpid());
+			xnet_set_rdm_version(msg);
 			goto put;
 		} else if (cmp > 0) {
 			/* accept peer's request */
@@ -507,8 +753,9 @@ static void xnet_process_connreq(struct fi_eq_cm_entry *cm_entry)
 	}
 
 accept:
+	conn->flags &= ~XNET_CONN_PEER_WAIT;
 	conn->remote_pid = ntohl(msg->pid);
-	ret = xnet_open_conn(conn, cm_entry->info);
+	ret = xnet_open_conn(conn, cm_entry->info, &conn->ep);
 	if (ret)
 		goto free;
 
@@ -535,12 +782,79 @@ reject:
 	fi_freeinfo(cm_entry->info);
 }
 
+/* The peer refused our connection in favor of its own request to us */
+static bool xnet_peer_will_connect(struct xnet_event *event)
+{
+	struct fi_eq_err_entry *err_entry;
+	struct xnet_rdm_cm *msg;
+
+	if (!(event->flags & UTIL_FLAG_ERROR))
+		return false;
+
+	err_entry = (struct fi_eq_err_entry *) &event->cm_entry;
+	msg = err_entry->err_data;
+	return err_entry->err == FI_ECONNREFUSED &&
+	       err_entry->err_data_size >= sizeof(*msg) &&
+	       (msg->version & XNET_RDM_VERSION_FLAG) && !msg->lane;
+}
+
+/* Returns the lane slot holding the given endpoint, if it is a lane */
+static struct xnet_ep **xnet_get_lane(struct xnet_conn *conn, fid_t fid)
+{
+	int i;
+
+	for (i = 0; i < XNET_MAX_STRIPES - 1; i++) {
+		if (conn->tx_lanes[i] &&
+		    &conn->tx_lanes[i]->util_ep.ep_fid.fid == fid)
+			return &conn->tx_lanes[i];
+		if (conn->rx_lanes[i] &&
+		    &conn->rx_lanes[i]->util_ep.ep_fid.fid == fid)
+			return &conn->rx_lanes[i];
+	}
+	return NULL;
+}
+
+static bool xnet_is_tx_lane(struct xnet_conn *conn, struct xnet_ep **lane)
+{
+	return lane >= conn->tx_lanes &&
+	       lane < conn->tx_lanes + XNET_MAX_STRIPES - 1;
+}
+
+/* Striped sends stay on the primary connection's rts_queue until the
+ * peer has received every stripe.
+ */
+static bool xnet_conn_striping(struct xnet_conn *conn)
+{
+	struct xnet_xfer_entry *tx_entry;
+	int i;
+
+	if (!conn->ep)
+		return false;
+
+	for (i = 0; i <= UINT8_MAX; i++) {
+		tx_entry = ofi_byte_idx_lookup(&conn->ep->rts_queue,
+					       (uint8_t) i);
+		if (tx_entry && (tx_entry->ctrl_flags & XNET_STRIPE))
+			return true;
+	}
+	return false;
+}
+
+/* A lane that fails to connect, is rejected, or is lost while no
+ * striped data is outstanding on it is closed by itself.  It is
+ * reconnected by the next large transfer.  Sends that were striped over
+ * a lost lane cannot complete, so that fails the whole connection.  The
+ * peer's sends over its lanes are handled the same way at the peer,
+ * which then closes the primary connection.
+ */
 void xnet_handle_event_list(struct xnet_progress *progress)
 {
 	struct xnet_event *event;
 	struct slist_entry *item;
 	struct xnet_rdm_cm *msg;
 	struct xnet_conn *conn;
+	struct xnet_ep **lane;
+	struct xnet_rdm *rdm;
 
 	assert(ofi_genlock_held(&progress->rdm_lock));
 	while (!slist_empty(&progress->event_list)) {
@@ -550,18 +864,50 @@ void xnet_handle_event_list(struct xnet_progress *progress)
 		FI_INFO(&xnet_prov, FI_LOG_EP_CTRL, "event %s\n",
 			fi_tostr(&event->event, FI_TYPE_EQ_EVENT));
 
+		rdm = event->rdm;
 		switch (event->event) {
 		case FI_CONNREQ:
 			xnet_process_connreq(&event->cm_entry);
 			break;
 		case FI_CONNECTED:
 			conn = event->cm_entry.fid->context;
+			/* lanes only carry data for the primary connection */
+			if (!conn->ep || event->cm_entry.fid !=
+			    &conn->ep->util_ep.ep_fid.fid)
+				break;
+
 			msg = (struct xnet_rdm_cm *) event->cm_entry.data;
 			conn->remote_pid = ntohl(msg->pid);
 			xnet_set_protocol(conn->ep, msg);
+			if (conn->flags & XNET_CONN_PRECONNECT) {
+				conn->flags &= ~XNET_CONN_PRECONNECT;
+				rdm->preconnect_active--;
+			}
 			break;
 		case FI_SHUTDOWN:
 			conn = event->cm_entry.fid->context;
+			if (conn->ep && event->cm_entry.fid ==
+			    &conn->ep->util_ep.ep_fid.fid &&
+			    xnet_peer_will_connect(event)) {
+				FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+					"waiting for peer to connect %p\n",
+					conn);
+				conn->flags |= XNET_CONN_PEER_WAIT;
+				conn->wait_time = ofi_gettime_ms();
+				xnet_close_conn(conn);
+				break;
+			}
+
+			lane = xnet_get_lane(conn, event->cm_entry.fid);
+			if (lane && !(xnet_is_tx_lane(conn, lane) &&
+				      xnet_conn_striping(conn))) {
+				FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+					"closing lane of %p\n", conn);
+				xnet_close_ep(conn, lane);
+				break;
+			}
+
+			/* Losing a lane loses striped data, fail the conn */
 			xnet_close_conn(conn);
 			xnet_free_conn(conn);
 			break;
@@ -569,6 +915,7 @@ void xnet_handle_event_list(struct xnet_progress *progress)
 			assert(0);
 			break;
 		}
-		free(event);
+		xnet_free_event(event);
+		xnet_start_preconnects(rdm);
 	};
 }
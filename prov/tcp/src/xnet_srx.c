@@ -42,6 +42,36 @@
 static struct xnet_xfer_entry *
 xnet_match_tag(struct xnet_srx *srx, struct xnet_ep *ep, uint64_t tag);
 
+struct xnet_tag_match {
+	struct slist		*queue;
+	struct slist_entry	*item;
+	struct slist_entry	*prev;
+	struct xnet_xfer_entry	*rx_entry;
+};
+
+static inline struct slist *
+xnet_srx_tag_bucket(struct xnet_srx *srx, fi_addr_t addr, uint64_t tag)
+{
+	return &srx->tag_buckets[ofi_tag_bucket(srx->tag_bucket_mask,
+						addr, tag)];
+}
+
+/* Without directed receive, every receive matches any source */
+static inline fi_addr_t
+xnet_srx_tag_addr(struct xnet_srx *srx, struct xnet_xfer_entry *recv_entry)
+{
+	return (srx->match_tag_rx == xnet_match_tag) ?
+	       FI_ADDR_UNSPEC : recv_entry->src_addr;
+}
+
+static struct slist *
+xnet_srx_trecv_queue(struct xnet_srx *srx, fi_addr_t addr,
+		     struct xnet_xfer_entry *recv_entry, struct slist *queue)
+{
+	if (srx->tag_buckets && !recv_entry->ignore)
+		return xnet_srx_tag_bucket(srx, addr, recv_entry->tag);
+	return queue;
+}
 
 /* The rdm ep calls directly through to the srx calls, so we need to use the
  * progress active_lock for protection.
@@ -472,7 +502,10 @@ xnet_srx_tag(struct xnet_srx *srx, struct xnet_xfer_entry *recv_entry)
 			return 0;
 		}
 
-		slist_insert_tail(&recv_entry->entry, &srx->tag_queue);
+		slist_insert_tail(&recv_entry->entry,
+				  xnet_srx_trecv_queue(srx, FI_ADDR_UNSPEC,
+						       recv_entry,
+						       &srx->tag_queue));
 
 		/* The message could match any endpoint waiting. */
 		if (!dlist_empty(&progress->unexp_tag_list))
@@ -493,6 +526,9 @@ xnet_srx_tag(struct xnet_srx *srx, struct xnet_xfer_entry *recv_entry)
 		if (!queue)
 			return -FI_EAGAIN;
 
+		queue = xnet_srx_trecv_queue(srx, recv_entry->src_addr,
+					     recv_entry, queue);
+
 		ep = xnet_get_rx_ep(srx->rdm, recv_entry->src_addr);
 		if (!ep) {
 			slist_insert_tail(&recv_entry->entry, queue);
@@ -645,71 +681,98 @@ static struct fi_ops_tagged xnet_srx_tag_ops = {
 	.injectdata = fi_no_tagged_injectdata,
 };
 
-static struct xnet_xfer_entry *
-xnet_match_tag(struct xnet_srx *srx, struct xnet_ep *ep, uint64_t tag)
+/* Every queue is kept in posting order, so the first match in a queue is
+ * the oldest one in that queue.  Only an entry posted before the current
+ * candidate may replace it.  Buckets hold entries of other (addr, tag)
+ * keys that hash to the same slot, so those must compare the full key.
+ */
+static void
+xnet_search_tag_queue(struct xnet_srx *srx, struct slist *queue,
+		      fi_addr_t addr, uint64_t tag, bool exact,
+		      struct xnet_tag_match *match)
 {
 	struct xnet_xfer_entry *rx_entry;
 	struct slist_entry *item, *prev;
 
-	assert(xnet_progress_locked(xnet_srx2_progress(srx)));
-	slist_foreach(&srx->tag_queue, item, prev) {
+	slist_foreach(queue, item, prev) {
 		rx_entry = container_of(item, struct xnet_xfer_entry, entry);
-		if (ofi_match_tag(rx_entry->tag, rx_entry->ignore, tag)) {
-			slist_remove(&srx->tag_queue, item, prev);
-			return rx_entry;
+		if (match->rx_entry &&
+		    rx_entry->tag_seq_no > match->rx_entry->tag_seq_no)
+			return;
+
+		if (exact) {
+			if (rx_entry->tag != tag ||
+			    xnet_srx_tag_addr(srx, rx_entry) != addr)
+				continue;
+		} else if (!ofi_match_tag(rx_entry->tag, rx_entry->ignore, tag)) {
+			continue;
 		}
+
+		match->queue = queue;
+		match->item = item;
+		match->prev = prev;
+		match->rx_entry = rx_entry;
+		return;
 	}
-	return NULL;
+}
+
+static void
+xnet_search_any_src(struct xnet_srx *srx, uint64_t tag,
+		    struct xnet_tag_match *match)
+{
+	if (srx->tag_buckets)
+		xnet_search_tag_queue(srx, xnet_srx_tag_bucket(srx,
+						FI_ADDR_UNSPEC, tag),
+				      FI_ADDR_UNSPEC, tag, true, match);
+	xnet_search_tag_queue(srx, &srx->tag_queue, FI_ADDR_UNSPEC, tag,
+			      false, match);
+}
+
+static struct xnet_xfer_entry *
+xnet_match_tag(struct xnet_srx *srx, struct xnet_ep *ep, uint64_t tag)
+{
+	struct xnet_tag_match match = {0};
+
+	assert(xnet_progress_locked(xnet_srx2_progress(srx)));
+	xnet_search_any_src(srx, tag, &match);
+	if (!match.rx_entry)
+		return NULL;
+
+	slist_remove(match.queue, match.item, match.prev);
+	return match.rx_entry;
 }
 
 /* A matching receive could be found on either the any source queue or the
- * source matched queue.  However, most apps going through this path will
- * use source matching, with the any source queue being empty.  We optimize
- * for this case.
+ * source matched queue.  We select from the any source queue if it matches
+ * and was posted earlier than our source based match.
  */
 static struct xnet_xfer_entry *
 xnet_match_tag_addr(struct xnet_srx *srx, struct xnet_ep *ep, uint64_t tag)
 {
-	struct xnet_xfer_entry *rx_entry, *any_entry;
+	struct xnet_tag_match match = {0};
 	struct slist *queue;
-	struct slist_entry *any_item, *any_prev;
-	struct slist_entry *item, *prev;
+	fi_addr_t addr;
 
 	assert(xnet_progress_locked(xnet_srx2_progress(srx)));
 
-	queue = (ep->peer && ep->peer->fi_addr != FI_ADDR_NOTAVAIL) ?
-		ofi_array_at(&srx->src_tag_queues, ep->peer->fi_addr) : NULL;
-	if (!queue)
+	if (!ep->peer || ep->peer->fi_addr == FI_ADDR_NOTAVAIL)
 		return xnet_match_tag(srx, ep, tag);
 
-	slist_foreach(queue, item, prev) {
-		rx_entry = container_of(item, struct xnet_xfer_entry, entry);
-		if (ofi_match_tag(rx_entry->tag, rx_entry->ignore, tag))
-			goto found;
-	}
+	addr = ep->peer->fi_addr;
+	if (srx->tag_buckets)
+		xnet_search_tag_queue(srx, xnet_srx_tag_bucket(srx, addr, tag),
+				      addr, tag, true, &match);
 
-	return xnet_match_tag(srx, ep, tag);
-
-found:
-	/* We select from the any source queue if it matches and was posted
-	 * earlier than our source based match.
-	 */
-	slist_foreach(&srx->tag_queue, any_item, any_prev) {
-		any_entry = container_of(any_item, struct xnet_xfer_entry, entry);
-		if (any_entry->tag_seq_no > rx_entry->tag_seq_no)
-			break;
-
-		if (ofi_match_tag(any_entry->tag, any_entry->ignore, tag)) {
-			queue = &srx->tag_queue;
-			rx_entry = any_entry;
-			item = any_item;
-			prev = any_prev;
-			break;
-		}
-	}
+	queue = ofi_array_at(&srx->src_tag_queues, addr);
+	if (queue)
+		xnet_search_tag_queue(srx, queue, addr, tag, false, &match);
+
+	xnet_search_any_src(srx, tag, &match);
+	if (!match.rx_entry)
+		return NULL;
 
-	slist_remove(queue, item, prev);
-	return rx_entry;
+	slist_remove(match.queue, match.item, match.prev);
+	return match.rx_entry;
 }
 
 static bool
@@ -745,6 +808,7 @@ xnet_srx_cancel_src(struct ofi_dyn_arr *arr, void *list, void *context)
 static ssize_t xnet_srx_cancel(fid_t fid, void *context)
 {
 	struct xnet_srx *srx;
+	size_t i;
 
 	srx = container_of(fid, struct xnet_srx, rx_fid.fid);
 
@@ -752,6 +816,11 @@ static ssize_t xnet_srx_cancel(fid_t fid, void *context)
 	if (xnet_srx_cancel_rx(srx, &srx->tag_queue, context))
 		goto unlock;
 
+	for (i = 0; srx->tag_buckets && i <= srx->tag_bucket_mask; i++) {
+		if (xnet_srx_cancel_rx(srx, &srx->tag_buckets[i], context))
+			goto unlock;
+	}
+
 	if (xnet_srx_cancel_rx(srx, &srx->rx_queue, context))
 		goto unlock;
 
@@ -762,11 +831,68 @@ unlock:
 	return 0;
 }
 
+/* Buckets can only be resized before the first tagged receive is posted */
+static int xnet_srx_set_tag_buckets(struct xnet_srx *srx, size_t bucket_cnt)
+{
+	struct slist *buckets;
+	size_t mask;
+	int ret;
+
+	if (srx->tag_seq_no)
+		return -FI_EOPBADSTATE;
+
+	ret = ofi_tag_buckets_alloc(bucket_cnt, &buckets, &mask);
+	if (ret)
+		return ret;
+
+	free(srx->tag_buckets);
+	srx->tag_buckets = buckets;
+	srx->tag_bucket_mask = mask;
+	return FI_SUCCESS;
+}
+
+static int xnet_srx_getopt(fid_t fid, int level, int optname,
+			   void *optval, size_t *optlen)
+{
+	struct xnet_srx *srx;
+
+	srx = container_of(fid, struct xnet_srx, rx_fid.fid);
+	if (level != FI_OPT_ENDPOINT || optname != FI_OPT_TAG_BUCKETS)
+		return -FI_ENOPROTOOPT;
+
+	if (*optlen < sizeof(size_t)) {
+		*optlen = sizeof(size_t);
+		return -FI_ETOOSMALL;
+	}
+	*(size_t *) optval = srx->tag_buckets ? srx->tag_bucket_mask + 1 : 0;
+	*optlen = sizeof(size_t);
+	return FI_SUCCESS;
+}
+
+static int xnet_srx_setopt(fid_t fid, int level, int optname,
+			   const void *optval, size_t optlen)
+{
+	struct xnet_srx *srx;
+	int ret;
+
+	srx = container_of(fid, struct xnet_srx, rx_fid.fid);
+	if (level != FI_OPT_ENDPOINT || optname != FI_OPT_TAG_BUCKETS)
+		return -FI_ENOPROTOOPT;
+
+	if (optlen != sizeof(size_t))
+		return -FI_EINVAL;
+
+	ofi_genlock_lock(xnet_srx2_progress(srx)->active_lock);
+	ret = xnet_srx_set_tag_buckets(srx, *(size_t *) optval);
+	ofi_genlock_unlock(xnet_srx2_progress(srx)->active_lock);
+	return ret;
+}
+
 static struct fi_ops_ep xnet_srx_ops = {
 	.size = sizeof(struct fi_ops_ep),
 	.cancel = xnet_srx_cancel,
-	.getopt = fi_no_getopt,
-	.setopt = fi_no_setopt,
+	.getopt = xnet_srx_getopt,
+	.setopt = xnet_srx_setopt,
 	.tx_ctx = fi_no_tx_ctx,
 	.rx_ctx = fi_no_rx_ctx,
 	.rx_size_left = fi_no_rx_size_left,
@@ -857,18 +983,22 @@ xnet_init_saved_msg(struct ofi_dyn_arr *arr, void *item)
 static int xnet_srx_close(struct fid *fid)
 {
 	struct xnet_srx *srx;
+	size_t i;
 
 	srx = container_of(fid, struct xnet_srx, rx_fid.fid);
 
 	ofi_genlock_lock(xnet_srx2_progress(srx)->active_lock);
 	xnet_srx_cleanup(srx, &srx->rx_queue);
 	xnet_srx_cleanup(srx, &srx->tag_queue);
+	for (i = 0; srx->tag_buckets && i <= srx->tag_bucket_mask; i++)
+		xnet_srx_cleanup(srx, &srx->tag_buckets[i]);
 	ofi_array_iter(&srx->src_tag_queues, srx, xnet_srx_cleanup_queues);
 	ofi_array_iter(&srx->saved_msgs, srx, xnet_srx_cleanup_saved);
 	ofi_genlock_unlock(xnet_srx2_progress(srx)->active_lock);
 
 	ofi_array_destroy(&srx->src_tag_queues);
 	ofi_array_destroy(&srx->saved_msgs);
+	free(srx->tag_buckets);
 
 	if (srx->cntr)
 		ofi_atomic_dec32(&srx->cntr->ref);
@@ -891,11 +1021,18 @@ int xnet_srx_context(struct fid_domain *domain, struct fi_rx_attr *attr,
 		     struct fid_ep **rx_ep, void *context)
 {
 	struct xnet_srx *srx;
+	int ret;
 
 	srx = calloc(1, sizeof(*srx));
 	if (!srx)
 		return -FI_ENOMEM;
 
+	ret = xnet_srx_set_tag_buckets(srx, ofi_srx_tag_buckets);
+	if (ret) {
+		free(srx);
+		return ret;
+	}
+
 	srx->rx_fid.fid.fclass = FI_CLASS_SRX_CTX;
 	srx->rx_fid.fid.context = context;
 	srx->rx_fid.fid.ops = &xnet_srx_fid_ops;
@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *	   Redistribution and use in source and binary forms, with or
+ *	   without modification, are permitted provided that the following
+ *	   conditions are met:
+ *
+ *		- Redistributions of source code must retain the above
+ *		  copyright notice, this list of conditions and the following
+ *		  disclaimer.
+ *
+ *		- Redistributions in binary form must reproduce the above
+ *		  copyright notice, this list of conditions and the following
+ *		  disclaimer in the documentation and/or other materials
+ *		  provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <rdma/fi_errno.h>
+#include <ofi_prov.h>
+#include "xnet.h"
+
+/* Connections are encrypted by the kernel TLS record layer.  There is
+ * no TLS handshake.  Instead, each side sends a random nonce in its cm
+ * message, and keys for each direction are derived from a pre-shared
+ * key and both nonces with HKDF-SHA256 from libcrypto.  Each cm message
+ * also carries an HMAC tag, keyed from the pre-shared key, that lets the
+ * receiver confirm that the peer holds the same key before the
+ * connection is reported.  The passive side's tag covers both nonces.
+ * Only the data path is encrypted.  The cm messages, including the
+ * user's cm data, are not.
+ */
+#define XNET_KTLS_MAX_KEY	4096
+#define XNET_KTLS_MIN_KEY	16
+#define XNET_SHA256_SIZE	32
+
+static uint8_t *xnet_ktls_key;
+static size_t xnet_ktls_key_len;
+int xnet_ktls;
+
+/* Both sides must agree on whether the connection is encrypted */
+int xnet_ktls_get_hdr(const struct ofi_ctrl_hdr *hdr, uint8_t *nonce)
+{
+	bool peer_ktls;
+
+	peer_ktls = !!(ntohl(hdr->seg_no) & XNET_CM_KTLS);
+	if (peer_ktls != !!xnet_ktls) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
+			"ktls mismatch, local: %s, peer: %s\n",
+			xnet_ktls ? "on" : "off", peer_ktls ? "on" : "off");
+		return -FI_ECONNREFUSED;
+	}
+
+	if (peer_ktls) {
+		memcpy(nonce, &hdr->conn_id, sizeof(hdr->conn_id));
+		memcpy(nonce + sizeof(hdr->conn_id), &hdr->msg_id,
+		       sizeof(hdr->msg_id));
+	}
+	return 0;
+}
+
+#if HAVE_XNET_KTLS
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/kdf.h>
+#include <openssl/rand.h>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+/* Keys the cm message tags */
+static uint8_t xnet_ktls_confirm_key[XNET_SHA256_SIZE];
+
+void xnet_ktls_fini(void)
+{
+	if (xnet_ktls_key) {
+		OPENSSL_cleanse(xnet_ktls_key, XNET_KTLS_MAX_KEY);
+		free(xnet_ktls_key);
+	}
+	OPENSSL_cleanse(xnet_ktls_confirm_key, sizeof(xnet_ktls_confirm_key));
+	xnet_ktls_key = NULL;
+	xnet_ktls_key_len = 0;
+	xnet_ktls = 0;
+}
+
+static int xnet_hmac(const uint8_t *key, size_t key_len,
+		     const uint8_t *data, size_t data_len, uint8_t *digest)
+{
+	unsigned int len = XNET_SHA256_SIZE;
+
+	return HMAC(EVP_sha256(), key, (int) key_len, data, data_len,
+		    digest, &len) ? 0 : -FI_EIO;
+}
+
+static int xnet_hkdf(const uint8_t *salt, size_t salt_len,
+		     const uint8_t *ikm, size_t ikm_len,
+		     const uint8_t *info, size_t info_len,
+		     uint8_t *okm, size_t okm_len)
+{
+	EVP_PKEY_CTX *ctx;
+	int ret;
+
+	ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
+	if (!ctx)
+		return -FI_ENOMEM;
+
+	ret = EVP_PKEY_derive_init(ctx) <= 0 ||
+	      EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha256()) <= 0 ||
+	      (salt_len &&
+	       EVP_PKEY_CTX_set1_hkdf_salt(ctx, salt, (int) salt_len) <= 0) ||
+	      EVP_PKEY_CTX_set1_hkdf_key(ctx, ikm, (int) ikm_len) <= 0 ||
+	      EVP_PKEY_CTX_add1_hkdf_info(ctx, info, (int) info_len) <= 0 ||
+	      EVP_PKEY_derive(ctx, okm, &okm_len) <= 0;
+	EVP_PKEY_CTX_free(ctx);
+	return ret ? -FI_EIO : 0;
+}
+
+/* RFC 4231 test case 2 and RFC 5869 test case 1 */
+static int xnet_ktls_selftest(void)
+{
+	static const uint8_t hmac_exp[XNET_SHA256_SIZE] = {
+		0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e,
+		0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+		0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+		0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43,
+	};
+	static const uint8_t hkdf_salt[] = {
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		0x08, 0x09, 0x0a, 0x0b, 0x0c,
+	};
+	static const uint8_t hkdf_info[] = {
+		0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+		0xf8, 0xf9,
+	};
+	static const uint8_t hkdf_exp[42] = {
+		0x3c, 0xb2, 0x5f, 0x25, 0xfa, 0xac, 0xd5, 0x7a,
+		0x90, 0x43, 0x4f, 0x64, 0xd0, 0x36, 0x2f, 0x2a,
+		0x2d, 0x2d, 0x0a, 0x90, 0xcf, 0x1a, 0x5a, 0x4c,
+		0x5d, 0xb0, 0x2d, 0x56, 0xec, 0xc4, 0xc5, 0xbf,
+		0x34, 0x00, 0x72, 0x08, 0xd5, 0xb8, 0x87, 0x18,
+		0x58, 0x65,
+	};
+	static const char hmac_data[] = "what do ya want for nothing?";
+	uint8_t hkdf_ikm[22], out[sizeof(hkdf_exp)];
+
+	if (xnet_hmac((const uint8_t *) "Jefe", 4, (const uint8_t *) hmac_data,
+		      sizeof(hmac_data) - 1, out) ||
+	    memcmp(out, hmac_exp, sizeof(hmac_exp)))
+		return -FI_EIO;
+
+	memset(hkdf_ikm, 0x0b, sizeof(hkdf_ikm));
+	if (xnet_hkdf(hkdf_salt, sizeof(hkdf_salt), hkdf_ikm,
+		      sizeof(hkdf_ikm), hkdf_info, sizeof(hkdf_info),
+		      out, sizeof(hkdf_exp)) ||
+	    memcmp(out, hkdf_exp, sizeof(hkdf_exp)))
+		return -FI_EIO;
+
+	return 0;
+}
+
+/* Setting the ULP on an unconnected socket fails with ENOTCONN once the
+ * tls module is found, and with ENOENT if the kernel cannot provide it.
+ */
+static bool xnet_ktls_avail(void)
+{
+	bool avail;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+
+	avail = !setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) ||
+		errno != ENOENT;
+	close(fd);
+	return avail;
+}
+
+static int xnet_ktls_read_key(const char *key_file)
+{
+	struct stat st;
+	ssize_t ret;
+	int fd;
+
+	fd = open(key_file, O_RDONLY | O_NOFOLLOW);
+	if (fd < 0) {
+		FI_WARN(&xnet_prov, FI_LOG_CORE,
+			"unable to open ktls key file %s\n", key_file);
+		return -FI_ENOKEY;
+	}
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+	    (st.st_mode & (S_IRWXG | S_IRWXO))) {
+		FI_WARN(&xnet_prov, FI_LOG_CORE,
+			"ktls key file %s must be a regular file that is "
+			"not accessible by group or others\n", key_file);
+		close(fd);
+		return -FI_EPERM;
+	}
+
+	xnet_ktls_key = malloc(XNET_KTLS_MAX_KEY);
+	if (!xnet_ktls_key) {
+		close(fd);
+		return -FI_ENOMEM;
+	}
+
+	ret = read(fd, xnet_ktls_key, XNET_KTLS_MAX_KEY);
+	close(fd);
+	if (ret < XNET_KTLS_MIN_KEY) {
+		FI_WARN(&xnet_prov, FI_LOG_CORE,
+			"ktls key file must hold at least %d bytes\n",
+			XNET_KTLS_MIN_KEY);
+		return -FI_ENOKEY;
+	}
+
+	xnet_ktls_key_len = (size_t) ret;
+	return 0;
+}
+
+int xnet_ktls_init(const char *key_file)
+{
+	static const char label[] = "xnet ktls confirm";
+	int ret;
+
+	if (!key_file)
+		return 0;
+
+	if (!xnet_ktls_avail()) {
+		FI_WARN(&xnet_prov, FI_LOG_CORE,
+			"ktls key file given, but the kernel tls module "
+			"is not available\n");
+		return -FI_ENOSYS;
+	}
+
+	if (xnet_ktls_selftest()) {
+		FI_WARN(&xnet_prov, FI_LOG_CORE,
+			"ktls key derivation failed its self test\n");
+		return -FI_EIO;
+	}
+
+	ret = xnet_ktls_read_key(key_file);
+	if (!ret)
+		ret = xnet_hkdf(NULL, 0, xnet_ktls_key, xnet_ktls_key_len,
+				(const uint8_t *) label, sizeof(label) - 1,
+				xnet_ktls_confirm_key,
+				sizeof(xnet_ktls_confirm_key));
+	if (ret) {
+		xnet_ktls_fini();
+		return ret;
+	}
+
+	xnet_ktls = 1;
+	FI_INFO(&xnet_prov, FI_LOG_CORE, "ktls encryption enabled\n");
+	return 0;
+}
+
+/* The nonce is carried in the otherwise unused conn_id and msg_id */
+int xnet_ktls_set_hdr(struct ofi_ctrl_hdr *hdr, uint8_t *nonce)
+{
+	if (!xnet_ktls)
+		return 0;
+
+	if (RAND_bytes(nonce, XNET_KTLS_NONCE_SIZE) != 1)
+		return -FI_EIO;
+
+	hdr->seg_no = htonl(XNET_CM_KTLS);
+	memcpy(&hdr->conn_id, nonce, sizeof(hdr->conn_id));
+	memcpy(&hdr->msg_id, nonce + sizeof(hdr->conn_id),
+	       sizeof(hdr->msg_id));
+	return 0;
+}
+
+/* The active side's tag covers its nonce, the passive side's tag, sent
+ * once both nonces are known, covers both.
+ */
+static int xnet_ktls_tag(const uint8_t *active_nonce,
+			 const uint8_t *passive_nonce, uint8_t *tag)
+{
+	uint8_t data[sizeof("passive") + XNET_KTLS_NONCE_SIZE * 2];
+	uint8_t digest[XNET_SHA256_SIZE];
+	size_t len;
+	int ret;
+
+	len = passive_nonce ? sizeof("passive") : sizeof("active");
+	memcpy(data, passive_nonce ? "passive" : "active", len);
+	memcpy(data + len, active_nonce, XNET_KTLS_NONCE_SIZE);
+	len += XNET_KTLS_NONCE_SIZE;
+	if (passive_nonce) {
+		memcpy(data + len, passive_nonce, XNET_KTLS_NONCE_SIZE);
+		len += XNET_KTLS_NONCE_SIZE;
+	}
+
+	ret = xnet_hmac(xnet_ktls_confirm_key, sizeof(xnet_ktls_confirm_key),
+			data, len, digest);
+	memcpy(tag, digest, XNET_KTLS_TAG_SIZE);
+	return ret;
+}
+
+/* Appends the key confirmation tag to the cm data */
+int xnet_ktls_sign(struct xnet_cm_msg *msg, const uint8_t *active_nonce,
+		   const uint8_t *passive_nonce)
+{
+	size_t len;
+
+	if (!xnet_ktls)
+		return 0;
+
+	len = ntohs(msg->hdr.seg_size);
+	assert(len <= XNET_MAX_CM_DATA_SIZE);
+	msg->hdr.seg_size = htons((uint16_t) (len + XNET_KTLS_TAG_SIZE));
+	return xnet_ktls_tag(active_nonce, passive_nonce,
+			     (uint8_t *) &msg->data[len]);
+}
+
+/* Checks and removes the peer's key confirmation tag */
+int xnet_ktls_verify(struct xnet_cm_msg *msg, const uint8_t *active_nonce,
+		     const uint8_t *passive_nonce)
+{
+	uint8_t tag[XNET_KTLS_TAG_SIZE];
+	size_t len;
+
+	if (!xnet_ktls)
+		return 0;
+
+	len = ntohs(msg->hdr.seg_size);
+	if (len < XNET_KTLS_TAG_SIZE)
+		goto err;
+
+	len -= XNET_KTLS_TAG_SIZE;
+	if (xnet_ktls_tag(active_nonce, passive_nonce, tag) ||
+	    CRYPTO_memcmp(tag, &msg->data[len], XNET_KTLS_TAG_SIZE))
+		goto err;
+
+	msg->hdr.seg_size = htons((uint16_t) len);
+	return 0;
+
+err:
+	FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
+		"ktls key confirmation failed, keys differ\n");
+	msg->hdr.seg_size = 0;
+	return -FI_ECONNREFUSED;
+}
+
+static int
+xnet_ktls_derive(const uint8_t *salt, const char *label,
+		 struct tls12_crypto_info_aes_gcm_128 *info)
+{
+	uint8_t okm[TLS_CIPHER_AES_GCM_128_KEY_SIZE +
+		    TLS_CIPHER_AES_GCM_128_SALT_SIZE +
+		    TLS_CIPHER_AES_GCM_128_IV_SIZE];
+	int ret;
+
+	ret = xnet_hkdf(salt, XNET_KTLS_NONCE_SIZE * 2, xnet_ktls_key,
+			xnet_ktls_key_len, (const uint8_t *) label,
+			strlen(label), okm, sizeof(okm));
+	if (ret)
+		return ret;
+
+	memset(info, 0, sizeof(*info));
+	info->info.version = TLS_1_3_VERSION;
+	info->info.cipher_type = TLS_CIPHER_AES_GCM_128;
+	memcpy(info->key, okm, TLS_CIPHER_AES_GCM_128_KEY_SIZE);
+	memcpy(info->salt, okm + TLS_CIPHER_AES_GCM_128_KEY_SIZE,
+	       TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+	memcpy(info->iv, okm + TLS_CIPHER_AES_GCM_128_KEY_SIZE +
+	       TLS_CIPHER_AES_GCM_128_SALT_SIZE,
+	       TLS_CIPHER_AES_GCM_128_IV_SIZE);
+	OPENSSL_cleanse(okm, sizeof(okm));
+	return 0;
+}
+
+/* Called once the cm messages have been exchanged, before any data is
+ * transferred.  Peer data that is already queued on the socket will be
+ * decrypted once TLS_RX is set.
+ */
+int xnet_ktls_enable(struct xnet_ep *ep, const uint8_t *active_nonce,
+		     const uint8_t *passive_nonce, bool active)
+{
+	struct tls12_crypto_info_aes_gcm_128 tx, rx;
+	uint8_t salt[XNET_KTLS_NONCE_SIZE * 2];
+	int ret;
+
+	memcpy(salt, active_nonce, XNET_KTLS_NONCE_SIZE);
+	memcpy(salt + XNET_KTLS_NONCE_SIZE, passive_nonce,
+	       XNET_KTLS_NONCE_SIZE);
+	ret = xnet_ktls_derive(salt, active ? "xnet ktls active" :
+			       "xnet ktls passive", &tx);
+	if (!ret)
+		ret = xnet_ktls_derive(salt, active ? "xnet ktls passive" :
+				       "xnet ktls active", &rx);
+	if (ret)
+		goto out;
+
+	ret = setsockopt(ep->bsock.sock, SOL_TCP, TCP_ULP, "tls",
+			 sizeof("tls"));
+	if (!ret)
+		ret = setsockopt(ep->bsock.sock, SOL_TLS, TLS_TX, &tx,
+				 sizeof(tx));
+	if (!ret)
+		ret = setsockopt(ep->bsock.sock, SOL_TLS, TLS_RX, &rx,
+				 sizeof(rx));
+	if (ret)
+		ret = -ofi_sockerr();
+out:
+	OPENSSL_cleanse(&tx, sizeof(tx));
+	OPENSSL_cleanse(&rx, sizeof(rx));
+	if (ret) {
+		FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
+			"unable to enable ktls: %s\n", fi_strerror(-ret));
+		return ret;
+	}
+
+	/* The tls record layer does not support MSG_ZEROCOPY */
+	ep->bsock.zerocopy_size = SIZE_MAX;
+	return 0;
+}
+
+#else /* HAVE_XNET_KTLS */
+
+void xnet_ktls_fini(void)
+{
+}
+
+int xnet_ktls_init(const char *key_file)
+{
+	if (!key_file)
+		return 0;
+
+	FI_WARN(&xnet_prov, FI_LOG_CORE,
+		"ktls key file given, but ktls is not supported\n");
+	return -FI_ENOSYS;
+}
+
+int xnet_ktls_set_hdr(struct ofi_ctrl_hdr *hdr, uint8_t *nonce)
+{
+	return 0;
+}
+
+int xnet_ktls_sign(struct xnet_cm_msg *msg, const uint8_t *active_nonce,
+		   const uint8_t *passive_nonce)
+{
+	return 0;
+}
+
+int xnet_ktls_verify(struct xnet_cm_msg *msg, const uint8_t *active_nonce,
+		     const uint8_t *passive_nonce)
+{
+	return 0;
+}
+
+int xnet_ktls_enable(struct xnet_ep *ep, const uint8_t *active_nonce,
+		     const uint8_t *passive_nonce, bool active)
+{
+	return -FI_ENOSYS;
+}
+#endif /* HAVE_XNET_KTLS */
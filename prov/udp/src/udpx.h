@@ -67,6 +67,8 @@
 extern struct fi_provider udpx_prov;
 extern struct util_prov udpx_util_prov;
 extern struct fi_info udpx_info;
+extern int udpx_busy_poll;
+extern size_t udpx_sockbuf_size;
 
 
 int udpx_fabric(struct fi_fabric_attr *attr, struct fid_fabric **fabric,
@@ -79,6 +81,7 @@ int udpx_eq_open(struct fid_fabric *fabric, struct fi_eq_attr *attr,
 
 #define UDPX_FLAG_MULTI_RECV	1
 #define UDPX_IOV_LIMIT		4
+#define UDPX_MAX_BATCH		16
 
 struct udpx_ep_entry {
 	void			*context;
@@ -90,6 +93,13 @@ struct udpx_ep_entry {
 
 OFI_DECLARE_CIRQUE(struct udpx_ep_entry, udpx_rx_cirq);
 
+/* Send posted with FI_MORE, held until the batch is passed to sendmmsg */
+struct udpx_tx_entry {
+	void			*context;
+	struct iovec		iov[UDPX_IOV_LIMIT];
+	union ofi_sock_ip	addr;
+};
+
 struct udpx_ep;
 typedef void (*udpx_rx_comp_func)(struct udpx_ep *ep, void *context,
 		uint64_t flags, size_t len, void *buf, void *addr);
@@ -100,6 +110,13 @@ struct udpx_ep {
 	udpx_rx_comp_func	rx_comp;
 	udpx_tx_comp_func	tx_comp;
 	struct udpx_rx_cirq	*rxq;    /* protected by rx_cq lock */
+#if HAVE_SENDMMSG
+	/* protected by tx_cq lock */
+	struct udpx_tx_entry	txq[UDPX_MAX_BATCH];
+	struct mmsghdr		tx_msg[UDPX_MAX_BATCH];
+	int			tx_count;
+	int			tx_sent;
+#endif
 	SOCKET			sock;
 	int			is_bound;
 	ofi_atomic32_t		ref;
@@ -215,17 +215,30 @@ static struct fi_ops_ep udpx_ep_ops = {
 };
 
 
+/*
+ * The cq_lock is held.  With a lock-free staging ring, completions go
+ * through the ring, or the ring is drained first so that entries staged
+ * by other writers stay ahead of this one.
+ */
 static void udpx_tx_comp(struct udpx_ep *ep, void *context)
 {
 	struct fi_cq_tagged_entry *comp;
+	struct util_cq *cq = ep->util_ep.tx_cq;
 
-	comp = ofi_cirque_next(ep->util_ep.tx_cq->cirq);
+	if (cq->ring) {
+		if (!ofi_cq_write_ring(cq, context, FI_SEND, 0, NULL, 0, 0,
+				       FI_ADDR_NOTAVAIL))
+			return;
+		ofi_cq_drain_ring(cq);
+	}
+
+	comp = ofi_cirque_next(cq->cirq);
 	comp->op_context = context;
 	comp->flags = FI_SEND;
 	comp->len = 0;
 	comp->buf = NULL;
 	comp->data = 0;
-	ofi_cirque_commit(ep->util_ep.tx_cq->cirq);
+	ofi_cirque_commit(cq->cirq);
 }
 
 static void udpx_tx_comp_signal(struct udpx_ep *ep, void *context)
@@ -234,26 +247,50 @@ static void udpx_tx_comp_signal(struct udpx_ep *ep, void *context)
 	ep->util_ep.tx_cq->wait->signal(ep->util_ep.tx_cq->wait);
 }
 
-static void udpx_rx_comp(struct udpx_ep *ep, void *context, uint64_t flags,
-			 size_t len, void *buf, void *addr)
+static void udpx_rx_cirq_comp(struct util_cq *cq, void *context,
+			      uint64_t flags, size_t len, void *buf)
 {
 	struct fi_cq_tagged_entry *comp;
 
-	comp = ofi_cirque_next(ep->util_ep.rx_cq->cirq);
+	comp = ofi_cirque_next(cq->cirq);
 	comp->op_context = context;
 	comp->flags = FI_RECV | flags;
 	comp->len = len;
 	comp->buf = buf;
 	comp->data = 0;
-	ofi_cirque_commit(ep->util_ep.rx_cq->cirq);
+	ofi_cirque_commit(cq->cirq);
+}
+
+static void udpx_rx_comp(struct udpx_ep *ep, void *context, uint64_t flags,
+			 size_t len, void *buf, void *addr)
+{
+	struct util_cq *cq = ep->util_ep.rx_cq;
+
+	if (cq->ring) {
+		if (!ofi_cq_write_ring(cq, context, FI_RECV | flags, len, buf,
+				       0, 0, FI_ADDR_NOTAVAIL))
+			return;
+		ofi_cq_drain_ring(cq);
+	}
+	udpx_rx_cirq_comp(cq, context, flags, len, buf);
 }
 
 static void udpx_rx_src_comp(struct udpx_ep *ep, void *context, uint64_t flags,
 			     size_t len, void *buf, void *addr)
 {
-	ep->util_ep.rx_cq->src[ofi_cirque_windex(ep->util_ep.rx_cq->cirq)] =
-			ofi_ip_av_get_fi_addr(ep->util_ep.av, addr);
-	udpx_rx_comp(ep, context, flags, len, buf, addr);
+	struct util_cq *cq = ep->util_ep.rx_cq;
+	fi_addr_t src;
+
+	src = ofi_ip_av_get_fi_addr(ep->util_ep.av, addr);
+	if (cq->ring) {
+		if (!ofi_cq_write_ring(cq, context, FI_RECV | flags, len, buf,
+				       0, 0, src))
+			return;
+		ofi_cq_drain_ring(cq);
+	}
+
+	cq->src[ofi_cirque_windex(cq->cirq)] = src;
+	udpx_rx_cirq_comp(cq, context, flags, len, buf);
 }
 
 static void udpx_rx_comp_signal(struct udpx_ep *ep, void *context,
@@ -270,24 +307,119 @@ static void udpx_rx_src_comp_signal(struct udpx_ep *ep, void *context,
 	ep->util_ep.rx_cq->wait->signal(ep->util_ep.rx_cq->wait);
 }
 
-static void udpx_ep_progress(struct util_ep *util_ep)
+#if HAVE_SENDMMSG
+static void udpx_tx_err(struct udpx_ep *ep, void *context, int err)
+{
+	struct fi_cq_err_entry err_entry = {
+		.op_context = context,
+		.flags = FI_SEND,
+		.err = err,
+		.prov_errno = err,
+	};
+
+	/* ofi_cq_write_error() acquires the CQ lock itself */
+	ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+	ofi_cq_write_error(ep->util_ep.tx_cq, &err_entry);
+	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
+}
+
+/*
+ * Pass the queued sends to the socket with as few sendmmsg calls as
+ * possible.  Sends that the socket cannot take yet stay queued and are
+ * retried by the next flush.
+ */
+static void udpx_flush_tx(struct udpx_ep *ep)
+{
+	int ret, i;
+
+	while (ep->tx_sent < ep->tx_count) {
+		ret = sendmmsg(ep->sock, &ep->tx_msg[ep->tx_sent],
+			       ep->tx_count - ep->tx_sent, 0);
+		if (ret < 0) {
+			ret = ofi_sockerr();
+			if (OFI_SOCK_TRY_SND_RCV_AGAIN(ret))
+				return;
+			udpx_tx_err(ep, ep->txq[ep->tx_sent++].context, ret);
+			continue;
+		}
+
+		for (i = 0; i < ret; i++)
+			ep->tx_comp(ep, ep->txq[ep->tx_sent++].context);
+	}
+	ep->tx_count = 0;
+	ep->tx_sent = 0;
+}
+
+static void udpx_ep_progress_tx(struct udpx_ep *ep)
+{
+	if (!ep->util_ep.tx_cq)
+		return;
+
+	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
+	udpx_flush_tx(ep);
+	ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+}
+#else
+static void udpx_ep_progress_tx(struct udpx_ep *ep)
+{
+}
+#endif
+
+#if HAVE_RECVMMSG
+/*
+ * Receive into as many posted buffers as the socket has datagrams for, and
+ * the CQ has room for, with a single recvmmsg call.
+ */
+static void udpx_ep_progress_rx(struct udpx_ep *ep)
+{
+	struct mmsghdr msg[UDPX_MAX_BATCH];
+	struct sockaddr_in6 addr[UDPX_MAX_BATCH];
+	struct udpx_ep_entry *entry;
+	size_t cnt, i;
+	int ret;
+
+	cnt = MIN(ofi_cirque_usedcnt(ep->rxq),
+		  ofi_cirque_freecnt(ep->util_ep.rx_cq->cirq));
+	cnt = MIN(cnt, UDPX_MAX_BATCH);
+
+	for (i = 0; i < cnt; i++) {
+		entry = &ep->rxq->buf[(ep->rxq->rcnt + i) & ep->rxq->size_mask];
+		msg[i].msg_hdr.msg_name = &addr[i];
+		msg[i].msg_hdr.msg_namelen = sizeof(addr[i]);
+		msg[i].msg_hdr.msg_iov = entry->iov;
+		msg[i].msg_hdr.msg_iovlen = entry->iov_count;
+		msg[i].msg_hdr.msg_control = NULL;
+		msg[i].msg_hdr.msg_controllen = 0;
+		msg[i].msg_hdr.msg_flags = 0;
+	}
+
+	if (!cnt)
+		return;
+
+	ret = recvmmsg(ep->sock, msg, (unsigned int) cnt, 0, NULL);
+	for (i = 0; ret > 0 && i < (size_t) ret; i++) {
+		entry = ofi_cirque_head(ep->rxq);
+		ep->rx_comp(ep, entry->context, 0, msg[i].msg_len, NULL,
+			    &addr[i]);
+		ofi_cirque_discard(ep->rxq);
+	}
+}
+#else
+static void udpx_ep_progress_rx(struct udpx_ep *ep)
 {
-	struct udpx_ep *ep;
 	struct udpx_ep_entry *entry;
 	struct msghdr hdr;
 	struct sockaddr_in6 addr;
 	ssize_t ret;
 
-	ep = container_of(util_ep, struct udpx_ep, util_ep);
 	hdr.msg_name = &addr;
 	hdr.msg_namelen = sizeof(addr);
 	hdr.msg_control = NULL;
 	hdr.msg_controllen = 0;
 	hdr.msg_flags = 0;
 
-	ofi_genlock_lock(&ep->util_ep.rx_cq->cq_lock);
 	if (ofi_cirque_isempty(ep->rxq))
-		goto out;
+		return;
 
 	entry = ofi_cirque_head(ep->rxq);
 	hdr.msg_iov = entry->iov;
@@ -298,10 +430,50 @@ static void udpx_ep_progress(struct util_ep *util_ep)
 		ep->rx_comp(ep, entry->context, 0, ret, NULL, &addr);
 		ofi_cirque_discard(ep->rxq);
 	}
-out:
+}
+#endif
+
+static void udpx_ep_progress(struct util_ep *util_ep)
+{
+	struct udpx_ep *ep;
+
+	ep = container_of(util_ep, struct udpx_ep, util_ep);
+	udpx_ep_progress_tx(ep);
+
+	if (!ep->util_ep.rx_cq)
+		return;
+
+	ofi_genlock_lock(&ep->util_ep.rx_cq->cq_lock);
+	udpx_ep_progress_rx(ep);
 	ofi_genlock_unlock(&ep->util_ep.rx_cq->cq_lock);
 }
 
+/* Sends must not pass the ones that are queued with FI_MORE */
+static bool udpx_tx_blocked(struct udpx_ep *ep)
+{
+#if HAVE_SENDMMSG
+	if (ep->tx_count)
+		udpx_flush_tx(ep);
+	return ep->tx_count != 0;
+#else
+	return false;
+#endif
+}
+
+static bool udpx_inject_blocked(struct udpx_ep *ep)
+{
+	bool blocked = false;
+
+#if HAVE_SENDMMSG
+	if (ep->tx_count) {
+		ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
+		blocked = udpx_tx_blocked(ep);
+		ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+	}
+#endif
+	return blocked;
+}
+
 static ssize_t udpx_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 			    uint64_t flags)
 {
@@ -393,7 +565,8 @@ static ssize_t udpx_sendto(struct udpx_ep *ep, const void *buf, size_t len,
 	ssize_t ret;
 
 	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
-	if (ofi_cirque_isfull(ep->util_ep.tx_cq->cirq)) {
+	if (ofi_cirque_isfull(ep->util_ep.tx_cq->cirq) ||
+	    udpx_tx_blocked(ep)) {
 		ret = -FI_EAGAIN;
 		goto out;
 	}
@@ -432,6 +605,50 @@ static ssize_t udpx_send_mc(struct fid_ep *ep_fid, const void *buf, size_t len,
 			   context);
 }
 
+#if HAVE_SENDMMSG
+static bool udpx_tx_queue_full(struct udpx_ep *ep)
+{
+	return ep->tx_count == UDPX_MAX_BATCH ||
+	       ofi_cirque_freecnt(ep->util_ep.tx_cq->cirq) <=
+	       (size_t) (ep->tx_count - ep->tx_sent);
+}
+
+/*
+ * Queue a send posted with FI_MORE.  The queue is passed to sendmmsg once
+ * a send without FI_MORE is posted, the queue fills, or progress runs.
+ */
+static ssize_t udpx_queue_tx(struct udpx_ep *ep, const struct fi_msg *msg,
+			     const struct msghdr *hdr, uint64_t flags)
+{
+	struct udpx_tx_entry *entry;
+	struct mmsghdr *mmsg;
+
+	if (msg->iov_count > UDPX_IOV_LIMIT ||
+	    hdr->msg_namelen > sizeof(entry->addr))
+		return -FI_EINVAL;
+
+	if (udpx_tx_queue_full(ep)) {
+		udpx_flush_tx(ep);
+		if (udpx_tx_queue_full(ep))
+			return -FI_EAGAIN;
+	}
+
+	entry = &ep->txq[ep->tx_count];
+	entry->context = msg->context;
+	memcpy(entry->iov, msg->msg_iov, sizeof(*msg->msg_iov) * msg->iov_count);
+	memcpy(&entry->addr, hdr->msg_name, hdr->msg_namelen);
+
+	mmsg = &ep->tx_msg[ep->tx_count++];
+	mmsg->msg_hdr = *hdr;
+	mmsg->msg_hdr.msg_name = &entry->addr;
+	mmsg->msg_hdr.msg_iov = entry->iov;
+
+	if (!(flags & FI_MORE))
+		udpx_flush_tx(ep);
+	return 0;
+}
+#endif
+
 static ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 			    uint64_t flags)
 {
@@ -454,6 +671,17 @@ static ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 		goto out;
 	}
 
+#if HAVE_SENDMMSG
+	if (!(flags & FI_INJECT) && ((flags & FI_MORE) || ep->tx_count)) {
+		ret = udpx_queue_tx(ep, msg, &hdr, flags);
+		goto out;
+	}
+#endif
+	if (udpx_tx_blocked(ep)) {
+		ret = -FI_EAGAIN;
+		goto out;
+	}
+
 	ret = ofi_sendmsg_udp(ep->sock, &hdr, 0);
 	if (ret >= 0) {
 		ep->tx_comp(ep, msg->context);
@@ -501,6 +729,9 @@ static ssize_t udpx_inject(struct fid_ep *ep_fid, const void *buf, size_t len,
 	ssize_t ret;
 
 	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
+	if (udpx_inject_blocked(ep))
+		return -FI_EAGAIN;
+
 	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
 				ofi_ip_av_get_addr(ep->util_ep.av, (int)dest_addr),
 				(socklen_t)ep->util_ep.av->addrlen);
@@ -514,6 +745,9 @@ static ssize_t udpx_inject_mc(struct fid_ep *ep_fid, const void *buf,
 	ssize_t ret;
 
 	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
+	if (udpx_inject_blocked(ep))
+		return -FI_EAGAIN;
+
 	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
 				(const void *)(uintptr_t)dest_addr,
 				(socklen_t)ofi_sizeofaddr((const void *)(uintptr_t)dest_addr));
@@ -568,6 +802,12 @@ static int udpx_ep_close(struct fid *fid)
 				&ep->util_ep.ep_fid.fid);
 	}
 
+	if (ep->util_ep.tx_cq) {
+		fid_list_remove2(&ep->util_ep.tx_cq->ep_list,
+				&ep->util_ep.tx_cq->ep_list_lock,
+				&ep->util_ep.ep_fid.fid);
+	}
+
 	udpx_rx_cirq_free(ep->rxq);
 	ofi_close_socket(ep->sock);
 	ofi_endpoint_close(&ep->util_ep);
@@ -590,6 +830,13 @@ static int udpx_ep_bind_cq(struct udpx_ep *ep, struct util_cq *cq,
 		ofi_atomic_inc32(&cq->ref);
 		ep->tx_comp = cq->wait ? udpx_tx_comp_signal :
 					 udpx_tx_comp;
+
+		/* Reading the CQ flushes sends queued with FI_MORE */
+		ret = fid_list_insert2(&cq->ep_list,
+				      &cq->ep_list_lock,
+				      &ep->util_ep.ep_fid.fid);
+		if (ret)
+			return ret;
 	}
 
 	if (flags & FI_RECV) {
@@ -721,6 +968,52 @@ static struct fi_ops udpx_ep_fi_ops = {
 	.ops_open = fi_no_ops_open,
 };
 
+#ifdef SO_BUSY_POLL
+/* Raising the busy poll time above the system default requires
+ * CAP_NET_ADMIN, so failures are not fatal.
+ */
+static void udpx_set_busy_poll(SOCKET sock)
+{
+	int val = udpx_busy_poll;
+
+	if (!val)
+		return;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val))) {
+		FI_INFO(&udpx_prov, FI_LOG_EP_CTRL,
+			"unable to set busy poll: %s\n",
+			strerror(ofi_sockerr()));
+		return;
+	}
+
+#ifdef SO_PREFER_BUSY_POLL
+	val = 1;
+	(void) setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL,
+			  &val, sizeof(val));
+#endif
+}
+#else
+#define udpx_set_busy_poll(sock)
+#endif
+
+/* The kernel caps the sizes at net.core.rmem_max and wmem_max */
+static void udpx_set_sockbuf_size(SOCKET sock)
+{
+	int val = (int) MIN(udpx_sockbuf_size, INT_MAX);
+
+	if (!val)
+		return;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char *) &val,
+		       sizeof(val)) ||
+	    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (char *) &val,
+		       sizeof(val))) {
+		FI_INFO(&udpx_prov, FI_LOG_EP_CTRL,
+			"unable to set socket buffer size: %s\n",
+			strerror(ofi_sockerr()));
+	}
+}
+
 static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info)
 {
 	int family;
@@ -752,6 +1045,9 @@ static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info)
 	if (ret)
 		goto err2;
 
+	udpx_set_busy_poll(ep->sock);
+	udpx_set_sockbuf_size(ep->sock);
+
 	return 0;
 err2:
 	ofi_close_socket(ep->sock);
@@ -37,6 +37,8 @@
 
 #include <sys/types.h>
 
+int udpx_busy_poll;
+size_t udpx_sockbuf_size;
 
 static int udpx_getinfo(uint32_t version, const char *node, const char *service,
 			uint64_t flags, const struct fi_info *hints,
@@ -65,5 +67,19 @@ UDP_INI
 	fi_param_define(&udpx_prov, "iface", FI_PARAM_STRING,
 			"Specify interface name");
 
+	fi_param_define(&udpx_prov, "busy_poll", FI_PARAM_INT,
+			"time in microseconds that socket reads busy poll the "
+			"device queue before returning, set to 0 to disable "
+			"(default: %d)", udpx_busy_poll);
+	fi_param_get_int(&udpx_prov, "busy_poll", &udpx_busy_poll);
+	if (udpx_busy_poll < 0)
+		udpx_busy_poll = 0;
+
+	fi_param_define(&udpx_prov, "sockbuf_size", FI_PARAM_SIZE_T,
+			"size of the socket send and receive buffers, set to "
+			"0 to use the system default (default: %zu)",
+			udpx_sockbuf_size);
+	fi_param_get_size_t(&udpx_prov, "sockbuf_size", &udpx_sockbuf_size);
+
 	return &udpx_prov;
 }
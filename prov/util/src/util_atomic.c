@@ -1138,3 +1138,115 @@ int ofi_atomic_valid(const struct fi_provider *prov,
 
 	return 0;
 }
+
+/*
+ * Reductions of private buffers, e.g. the reduce steps of collectives, do
+ * not need the per element atomicity of the write handlers above.  The
+ * common ops and datatypes use plain loops that the compiler vectorizes,
+ * built for each SIMD level and selected at runtime.  Baseline builds use
+ * SSE2 on x86_64 and NEON on aarch64.
+ */
+#define OFI_REDUCE_MIN(a, b)	((b) < (a) ? (b) : (a))
+#define OFI_REDUCE_MAX(a, b)	((b) > (a) ? (b) : (a))
+#define OFI_REDUCE_SUM(a, b)	((a) + (b))
+#define OFI_REDUCE_PROD(a, b)	((a) * (b))
+
+#define OFI_REDUCE_OP_CNT	(FI_PROD + 1)
+#define OFI_REDUCE_TYPE_CNT	(FI_DOUBLE + 1)
+
+typedef void (*ofi_reduce_fn)(void *dst, const void *src, size_t cnt);
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define OFI_REDUCE_VECTORIZE	__attribute__((optimize("tree-vectorize")))
+#else
+#define OFI_REDUCE_VECTORIZE
+#endif
+
+#define OFI_REDUCE_ATTR_base	OFI_REDUCE_VECTORIZE
+#define OFI_REDUCE_ATTR_avx2	__attribute__((target("avx2"))) \
+				OFI_REDUCE_VECTORIZE
+#define OFI_REDUCE_ATTR_avx512	__attribute__((target("avx512f,avx512dq"))) \
+				OFI_REDUCE_VECTORIZE
+
+#define OFI_DEF_REDUCE_FUNC(isa, op, type)				\
+OFI_REDUCE_ATTR_##isa							\
+static void ofi_reduce_##isa##_##op##_##type(void *dst, const void *src,\
+					     size_t cnt)		\
+{									\
+	type *restrict d = dst;						\
+	const type *restrict s = src;					\
+	size_t i;							\
+									\
+	for (i = 0; i < cnt; i++)					\
+		d[i] = OFI_REDUCE_##op(d[i], s[i]);			\
+}
+
+#define OFI_DEF_REDUCE_OP(isa, op)					\
+	OFI_DEF_REDUCE_FUNC(isa, op, int32_t)				\
+	OFI_DEF_REDUCE_FUNC(isa, op, uint32_t)				\
+	OFI_DEF_REDUCE_FUNC(isa, op, int64_t)				\
+	OFI_DEF_REDUCE_FUNC(isa, op, uint64_t)				\
+	OFI_DEF_REDUCE_FUNC(isa, op, float)				\
+	OFI_DEF_REDUCE_FUNC(isa, op, double)
+
+#define OFI_REDUCE_OP_ROW(isa, op)					\
+	[FI_##op] = {							\
+		[FI_INT32] = ofi_reduce_##isa##_##op##_int32_t,		\
+		[FI_UINT32] = ofi_reduce_##isa##_##op##_uint32_t,	\
+		[FI_INT64] = ofi_reduce_##isa##_##op##_int64_t,		\
+		[FI_UINT64] = ofi_reduce_##isa##_##op##_uint64_t,	\
+		[FI_FLOAT] = ofi_reduce_##isa##_##op##_float,		\
+		[FI_DOUBLE] = ofi_reduce_##isa##_##op##_double,		\
+	}
+
+#define OFI_DEF_REDUCE_TABLE(isa)					\
+	OFI_DEF_REDUCE_OP(isa, MIN)					\
+	OFI_DEF_REDUCE_OP(isa, MAX)					\
+	OFI_DEF_REDUCE_OP(isa, SUM)					\
+	OFI_DEF_REDUCE_OP(isa, PROD)					\
+	static ofi_reduce_fn						\
+	ofi_reduce_##isa[OFI_REDUCE_OP_CNT][OFI_REDUCE_TYPE_CNT] = {	\
+		OFI_REDUCE_OP_ROW(isa, MIN),				\
+		OFI_REDUCE_OP_ROW(isa, MAX),				\
+		OFI_REDUCE_OP_ROW(isa, SUM),				\
+		OFI_REDUCE_OP_ROW(isa, PROD),				\
+	};
+
+OFI_DEF_REDUCE_TABLE(base)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__amd64__))
+#define OFI_REDUCE_X86 1
+OFI_DEF_REDUCE_TABLE(avx2)
+OFI_DEF_REDUCE_TABLE(avx512)
+#else
+#define OFI_REDUCE_X86 0
+#endif
+
+static ofi_reduce_fn (*ofi_reduce_handlers)[OFI_REDUCE_TYPE_CNT] =
+	ofi_reduce_base;
+
+void ofi_reduce_init(void)
+{
+#if OFI_REDUCE_X86
+	if (__builtin_cpu_supports("avx512f") &&
+	    __builtin_cpu_supports("avx512dq")) {
+		ofi_reduce_handlers = ofi_reduce_avx512;
+		FI_INFO(&core_prov, FI_LOG_CORE, "using avx512 reductions\n");
+	} else if (__builtin_cpu_supports("avx2")) {
+		ofi_reduce_handlers = ofi_reduce_avx2;
+		FI_INFO(&core_prov, FI_LOG_CORE, "using avx2 reductions\n");
+	}
+#endif
+}
+
+void ofi_reduce(enum fi_op op, enum fi_datatype datatype, void *dst,
+		const void *src, size_t cnt)
+{
+	if (op < OFI_REDUCE_OP_CNT && datatype < OFI_REDUCE_TYPE_CNT &&
+	    ofi_reduce_handlers[op][datatype]) {
+		ofi_reduce_handlers[op][datatype](dst, src, cnt);
+		return;
+	}
+
+	ofi_atomic_write_handler(op, datatype, dst, src, cnt);
+}
@@ -242,10 +242,10 @@ int ofi_get_addr(uint32_t *addr_format, uint64_t flags,
 
 void *ofi_av_get_addr(struct util_av *av, fi_addr_t fi_addr)
 {
-	struct util_av_entry *entry;
-
-	entry = ofi_bufpool_get_ibuf(av->av_entry_pool, fi_addr);
-	return entry->data;
+	assert(fi_addr < av->addr_table_cnt);
+	assert(ofi_buf_hdr(av->addr_table[fi_addr] -
+			   offsetof(struct util_av_entry, data))->allocated);
+	return av->addr_table[fi_addr];
 }
 
 void *ofi_av_addr_context(struct util_av *av, fi_addr_t fi_addr)
@@ -391,6 +391,9 @@ static void util_av_close(struct util_av *av)
 {
 	HASH_CLEAR(hh, av->hash);
 	ofi_bufpool_destroy(av->av_entry_pool);
+	free(av->addr_table);
+	av->addr_table = NULL;
+	av->addr_table_cnt = 0;
 }
 
 int ofi_av_close_lightweight(struct util_av *av)
@@ -434,6 +437,145 @@ int ofi_av_close(struct util_av *av)
 	return 0;
 }
 
+int ofi_av_set_union(struct fid_av_set *dst, const struct fid_av_set *src)
+{
+	struct util_av_set *src_av_set;
+	struct util_av_set *dst_av_set;
+	int i,j;
+
+	src_av_set = container_of(src, struct util_av_set, av_set_fid);
+	dst_av_set = container_of(dst, struct util_av_set, av_set_fid);
+
+	assert(src_av_set->av == dst_av_set->av);
+
+	for (i = 0; i < src_av_set->fi_addr_count; i++) {
+		for (j = 0; j < dst_av_set->fi_addr_count; j++) {
+			if (dst_av_set->fi_addr_array[j] ==
+			    src_av_set->fi_addr_array[i])
+				break;
+		}
+		if (j == dst_av_set->fi_addr_count) {
+			if (dst_av_set->fi_addr_count >=
+			    dst_av_set->max_array_size) {
+				FI_INFO(dst_av_set->av->prov, FI_LOG_AV,
+					"destination AV is full\n");
+				return -FI_ENOMEM;
+			}
+
+			dst_av_set->fi_addr_array[dst_av_set->fi_addr_count++] =
+						src_av_set->fi_addr_array[i];
+			FI_DBG(dst_av_set->av->prov, FI_LOG_AV,
+				"Adding fi_addr: %" PRIu64 "\n",
+				src_av_set->fi_addr_array[i]);
+		}
+	}
+	return FI_SUCCESS;
+}
+
+int ofi_av_set_intersect(struct fid_av_set *dst, const struct fid_av_set *src)
+{
+	struct util_av_set *src_av_set;
+	struct util_av_set *dst_av_set;
+	int i,j, temp;
+
+	src_av_set = container_of(src, struct util_av_set, av_set_fid);
+	dst_av_set = container_of(dst, struct util_av_set, av_set_fid);
+
+	assert(src_av_set->av == dst_av_set->av);
+
+	temp = 0;
+	for (i = 0; i < src_av_set->fi_addr_count; i++) {
+		for (j = temp; j < dst_av_set->fi_addr_count; j++) {
+			if (dst_av_set->fi_addr_array[j] ==
+			    src_av_set->fi_addr_array[i]) {
+				dst_av_set->fi_addr_array[temp++] =
+					dst_av_set->fi_addr_array[j];
+				break;
+			}
+		}
+	}
+	dst_av_set->fi_addr_count = temp;
+	return FI_SUCCESS;
+}
+
+int ofi_av_set_diff(struct fid_av_set *dst, const struct fid_av_set *src)
+{
+
+	struct util_av_set *src_av_set;
+	struct util_av_set *dst_av_set;
+	int i,j;
+	size_t temp;
+
+	src_av_set = container_of(src, struct util_av_set, av_set_fid);
+	dst_av_set = container_of(dst, struct util_av_set, av_set_fid);
+
+	assert(src_av_set->av == dst_av_set->av);
+
+	temp = dst_av_set->fi_addr_count;
+	for (i = 0; i < src_av_set->fi_addr_count; i++) {
+		for (j = 0; j < temp; j++) {
+			if (dst_av_set->fi_addr_array[j] ==
+			    src_av_set->fi_addr_array[i]) {
+				dst_av_set->fi_addr_array[--temp] =
+					dst_av_set->fi_addr_array[j];
+				break;
+			}
+		}
+	}
+	dst_av_set->fi_addr_count = temp;
+	return FI_SUCCESS;
+}
+
+int ofi_av_set_insert(struct fid_av_set *set, fi_addr_t addr)
+{
+	struct util_av_set *av_set;
+	int i;
+
+	av_set = container_of(set, struct util_av_set, av_set_fid);
+	if (av_set->fi_addr_count >= av_set->max_array_size)  {
+		FI_INFO(av_set->av->prov, FI_LOG_AV, "AV set full\n");
+		return -FI_ENOMEM;
+	}
+
+	for (i = 0; i < av_set->fi_addr_count; i++) {
+		if (av_set->fi_addr_array[i] == addr)
+			return -FI_EINVAL;
+	}
+
+	av_set->fi_addr_array[av_set->fi_addr_count++] = addr;
+	FI_DBG(av_set->av->prov, FI_LOG_AV,
+		"fi_addr: %" PRIu64 "\n", addr);
+	return FI_SUCCESS;
+}
+
+int ofi_av_set_remove(struct fid_av_set *set, fi_addr_t addr)
+{
+	struct util_av_set *av_set;
+	int i;
+
+	av_set = container_of(set, struct util_av_set, av_set_fid);
+
+	for (i = 0; i < av_set->fi_addr_count; i++) {
+		if (av_set->fi_addr_array[i] == addr) {
+			av_set->fi_addr_array[i] =
+				av_set->fi_addr_array[--av_set->fi_addr_count];
+			return FI_SUCCESS;
+		}
+	}
+	return -FI_EINVAL;
+}
+
+int ofi_av_set_addr(struct fid_av_set *set, fi_addr_t *coll_addr)
+{
+	struct util_av_set *av_set;
+
+	av_set = container_of(set, struct util_av_set, av_set_fid);
+
+	*coll_addr = (uintptr_t) &av_set->coll_mc;
+
+	return FI_SUCCESS;
+}
+
 size_t ofi_av_size(struct util_av *av)
 {
 	return av->av_entry_pool->entry_cnt ?
@@ -452,6 +594,34 @@ static int util_verify_av_util_attr(struct util_domain *domain,
 	return 0;
 }
 
+/* Record where each new entry's address lives, so that ofi_av_get_addr
+ * is a single table load instead of a region lookup and division.
+ */
+static int util_av_region_alloc(struct ofi_bufpool_region *region)
+{
+	struct ofi_bufpool *pool = region->pool;
+	struct util_av *av = pool->attr.context;
+	struct util_av_entry *entry;
+	char **table;
+	size_t i, cnt;
+
+	cnt = pool->entry_cnt + pool->attr.chunk_cnt;
+	if (cnt > av->addr_table_cnt) {
+		table = realloc(av->addr_table, cnt * sizeof(*table));
+		if (!table)
+			return -FI_ENOMEM;
+		av->addr_table = table;
+		av->addr_table_cnt = cnt;
+	}
+
+	for (i = 0; i < pool->attr.chunk_cnt; i++) {
+		entry = (struct util_av_entry *)
+			(region->mem_region + i * pool->entry_size);
+		av->addr_table[pool->entry_cnt + i] = entry->data;
+	}
+	return 0;
+}
+
 static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 			const struct util_av_attr *util_attr)
 {
@@ -469,6 +639,8 @@ static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 				  sizeof(struct util_av_entry),
 		.alignment	= 16,
 		.max_cnt	= 0,
+		.alloc_fn	= util_av_region_alloc,
+		.context	= av,
 		/* Don't use track of buffer, because user can close
 		 * the AV without prior deletion of addresses */
 		.flags		= OFI_BUFPOOL_NO_TRACK | OFI_BUFPOOL_INDEXED,
@@ -489,6 +661,8 @@ static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 	av->context_offset = offset + av->addrlen;
 	av->flags = util_attr->flags | attr->flags;
 	av->hash = NULL;
+	av->addr_table = NULL;
+	av->addr_table_cnt = 0;
 
 	pool_attr.chunk_cnt = orig_size;
 	return ofi_bufpool_create_attr(&pool_attr, &av->av_entry_pool);
@@ -620,15 +794,28 @@ fi_addr_t ofi_ip_av_get_fi_addr(struct util_av *av, const void *addr)
 	return ofi_av_lookup_fi_addr(av, addr);
 }
 
+/* Grow the entry pool up front so that a large insert does not
+ * allocate regions one chunk at a time while walking the vector.
+ */
+static void ip_av_reserve(struct util_av *av, size_t count)
+{
+	struct ofi_bufpool *pool = av->av_entry_pool;
+
+	assert(ofi_mutex_held(&av->lock));
+	while (pool->entry_cnt - pool->inuse_cnt < count) {
+		if (ofi_bufpool_grow(pool))
+			break;
+	}
+}
+
 static int ip_av_insert_addr(struct util_av *av, const void *addr,
 			     fi_addr_t *fi_addr, void *context)
 {
 	int ret;
 
+	assert(ofi_mutex_held(&av->lock));
 	if (ofi_valid_dest_ipaddr(addr)) {
-		ofi_mutex_lock(&av->lock);
 		ret = ofi_av_insert_addr(av, addr, fi_addr);
-		ofi_mutex_unlock(&av->lock);
 	} else {
 		ret = -FI_EADDRNOTAVAIL;
 		if (fi_addr)
@@ -672,6 +859,11 @@ int ofi_ip_av_insertv(struct util_av *av, const void *addr, size_t addrlen,
 		memset(sync_err, 0, sizeof(*sync_err) * count);
 	}
 
+	/* Duplicate addresses are resolved through the hash, so the whole
+	 * vector can be inserted under a single acquisition of the lock.
+	 */
+	ofi_mutex_lock(&av->lock);
+	ip_av_reserve(av, count);
 	for (i = 0; i < count; i++) {
 		ret = ip_av_insert_addr(av, (const char *) addr + i * addrlen,
 					fi_addr ? &fi_addr[i] : NULL, context);
@@ -682,6 +874,7 @@ int ofi_ip_av_insertv(struct util_av *av, const void *addr, size_t addrlen,
 		else if (sync_err)
 			sync_err[i] = -ret;
 	}
+	ofi_mutex_unlock(&av->lock);
 
 done:
 	FI_DBG(av->prov, FI_LOG_AV, "%d addresses successful\n", success_cnt);
@@ -36,6 +36,7 @@
 #include <unistd.h>
 #include <ofi_enosys.h>
 #include <ofi_mem.h>
+#include <ofi_hmem.h>
 #include <ofi.h>
 #include <ofi_osd.h>
 
@@ -45,6 +46,28 @@ enum {
 };
 
 
+static const size_t ofi_bufpool_huge_sizes[] = {
+	[OFI_BUFPOOL_PAGE_1G] = 1UL << 30,
+	[OFI_BUFPOOL_PAGE_2M] = 1UL << 21,
+};
+
+static void ofi_bufpool_region_bind(struct ofi_bufpool_region *buf_region)
+{
+	struct ofi_bufpool *pool = buf_region->pool;
+	int ret;
+
+	if (pool->numa_node < 0)
+		return;
+
+	ret = ofi_numa_bind(buf_region->alloc_region, pool->alloc_size,
+			    pool->numa_node);
+	if (ret) {
+		FI_DBG(&core_prov, FI_LOG_CORE,
+		       "unable to bind region to NUMA node %d: %s\n",
+		       pool->numa_node, fi_strerror(-ret));
+	}
+}
+
 static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 {
 	int ret;
@@ -52,16 +75,37 @@ static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 	size_t alloc_size;
 	struct ofi_bufpool *pool = buf_region->pool;
 
+	if (pool->attr.staging &&
+	    roundup_power_of_two(pool->attr.alignment) <=
+	    (size_t) ofi_get_page_size()) {
+		buf_region->alloc_region =
+			ofi_hmem_staging_alloc(pool->attr.staging,
+					       pool->alloc_size);
+		if (buf_region->alloc_region) {
+			buf_region->flags = OFI_BUFPOOL_STAGING;
+			pool->page_cnt[OFI_BUFPOOL_PAGE_BASE]++;
+			return 0;
+		}
+	}
+
 	if (pool->attr.flags & OFI_BUFPOOL_HUGEPAGES) {
-		page_size = ofi_get_hugepage_size();
-		if (page_size > 0 && pool->alloc_size >= (size_t) page_size) {
-			alloc_size = ofi_get_aligned_size(pool->alloc_size, (size_t) page_size);
-			ret = ofi_alloc_hugepage_buf((void **) &buf_region->alloc_region,
-					     alloc_size);
+		for (; pool->huge_index < OFI_BUFPOOL_PAGE_BASE;
+		     pool->huge_index++) {
+			page_size = ofi_bufpool_huge_sizes[pool->huge_index];
+			if (pool->alloc_size < (size_t) page_size)
+				continue;
+
+			alloc_size = ofi_get_aligned_size(pool->alloc_size,
+							  (size_t) page_size);
+			ret = ofi_alloc_sized_hugepage_buf(
+					(void **) &buf_region->alloc_region,
+					alloc_size, (size_t) page_size);
 			if (!ret) {
 				buf_region->flags = OFI_BUFPOOL_HUGEPAGES | OFI_BUFPOOL_NONSHARED;
 				pool->alloc_size = alloc_size;
 				pool->region_size = pool->alloc_size - pool->entry_size;
+				pool->page_cnt[pool->huge_index]++;
+				ofi_bufpool_region_bind(buf_region);
 				return 0;
 			}
 		}
@@ -83,6 +127,8 @@ static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 		if (!ret) {
 			buf_region->flags = OFI_BUFPOOL_NONSHARED;
 			pool->region_size = pool->alloc_size - pool->entry_size;
+			pool->page_cnt[OFI_BUFPOOL_PAGE_BASE]++;
+			ofi_bufpool_region_bind(buf_region);
 			return 0;
 		} else if (ret != -FI_ENOSYS) {
 			return ret;
@@ -94,9 +140,12 @@ static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 		pool->attr.alignment = ofi_get_aligned_size(pool->attr.alignment, page_size);
 	}
 
-	return ofi_memalign((void **) &buf_region->alloc_region,
-				roundup_power_of_two(pool->attr.alignment),
-				pool->alloc_size);
+	ret = ofi_memalign((void **) &buf_region->alloc_region,
+			   roundup_power_of_two(pool->attr.alignment),
+			   pool->alloc_size);
+	if (!ret)
+		pool->page_cnt[OFI_BUFPOOL_PAGE_BASE]++;
+	return ret;
 }
 
 static void ofi_bufpool_region_free(struct ofi_bufpool_region *buf_region)
@@ -104,7 +153,11 @@ static void ofi_bufpool_region_free(struct ofi_bufpool_region *buf_region)
 	int ret;
 	struct ofi_bufpool *pool = buf_region->pool;
 
-	if (buf_region->flags & (OFI_BUFPOOL_HUGEPAGES | OFI_BUFPOOL_NONSHARED)) {
+	if (buf_region->flags & OFI_BUFPOOL_STAGING) {
+		ofi_hmem_staging_free(pool->attr.staging,
+				      buf_region->alloc_region);
+	} else if (buf_region->flags & (OFI_BUFPOOL_HUGEPAGES |
+					OFI_BUFPOOL_NONSHARED)) {
 		ret = ofi_unmap_anon_pages(buf_region->alloc_region, pool->alloc_size);
 		if (ret) {
 			FI_DBG(&core_prov, FI_LOG_CORE,
@@ -210,12 +263,123 @@ err1:
 	return ret;
 }
 
+static struct ofi_bufpool_mag *ofi_bufpool_mag(struct ofi_bufpool *pool)
+{
+	return &pool->mags[ofi_thread_slot(OFI_BUFPOOL_MAG_CNT)];
+}
+
+/* Move a batch of buffers from the pool free list into the magazine.
+ * Called with the magazine lock held.
+ */
+static int ofi_bufpool_mag_refill(struct ofi_bufpool *pool,
+				  struct ofi_bufpool_mag *mag)
+{
+	struct slist_entry *entry;
+	size_t cnt;
+
+	ofi_spin_lock(&pool->lock);
+	for (cnt = 0; cnt < OFI_BUFPOOL_MAG_BATCH; cnt++) {
+		if (ofi_bufpool_empty(pool) && ofi_bufpool_grow(pool))
+			break;
+
+		entry = slist_remove_head(&pool->free_list.entries);
+		slist_insert_head(entry, &mag->entries);
+	}
+	ofi_bufpool_track_alloc(pool, cnt);
+	ofi_spin_unlock(&pool->lock);
+
+	mag->cnt += cnt;
+	return cnt ? 0 : -FI_ENOMEM;
+}
+
+struct ofi_bufpool_hdr *ofi_bufpool_mag_alloc(struct ofi_bufpool *pool)
+{
+	struct ofi_bufpool_mag *mag = ofi_bufpool_mag(pool);
+	struct ofi_bufpool_hdr *buf_hdr;
+
+	ofi_spin_lock(&mag->lock);
+	if (slist_empty(&mag->entries) && ofi_bufpool_mag_refill(pool, mag)) {
+		ofi_spin_unlock(&mag->lock);
+		return NULL;
+	}
+
+	slist_remove_head_container(&mag->entries, struct ofi_bufpool_hdr,
+				    buf_hdr, entry.slist);
+	mag->cnt--;
+	ofi_spin_unlock(&mag->lock);
+	return buf_hdr;
+}
+
+void ofi_bufpool_mag_free(struct ofi_bufpool *pool,
+			  struct ofi_bufpool_hdr *buf_hdr)
+{
+	struct ofi_bufpool_mag *mag = ofi_bufpool_mag(pool);
+	struct slist_entry *entry;
+	struct slist batch;
+	size_t i;
+
+	ofi_spin_lock(&mag->lock);
+	slist_insert_head(&buf_hdr->entry.slist, &mag->entries);
+	if (++mag->cnt <= OFI_BUFPOOL_MAG_SIZE) {
+		ofi_spin_unlock(&mag->lock);
+		return;
+	}
+
+	slist_init(&batch);
+	for (i = 0; i < OFI_BUFPOOL_MAG_BATCH; i++) {
+		entry = slist_remove_head(&mag->entries);
+		slist_insert_head(entry, &batch);
+	}
+	mag->cnt -= OFI_BUFPOOL_MAG_BATCH;
+	ofi_spin_unlock(&mag->lock);
+
+	ofi_spin_lock(&pool->lock);
+	while (!slist_empty(&batch)) {
+		entry = slist_remove_head(&batch);
+		slist_insert_head(entry, &pool->free_list.entries);
+	}
+	pool->inuse_cnt -= OFI_BUFPOOL_MAG_BATCH;
+	ofi_spin_unlock(&pool->lock);
+}
+
+static int ofi_bufpool_init_mags(struct ofi_bufpool *pool)
+{
+	void *mags;
+	int i;
+
+	if (ofi_memalign(&mags, 64, sizeof(*pool->mags) * OFI_BUFPOOL_MAG_CNT))
+		return -FI_ENOMEM;
+
+	pool->mags = mags;
+	for (i = 0; i < OFI_BUFPOOL_MAG_CNT; i++) {
+		ofi_spin_init(&pool->mags[i].lock);
+		slist_init(&pool->mags[i].entries);
+		pool->mags[i].cnt = 0;
+	}
+	ofi_spin_init(&pool->lock);
+	return 0;
+}
+
+static void ofi_bufpool_cleanup_mags(struct ofi_bufpool *pool)
+{
+	int i;
+
+	for (i = 0; i < OFI_BUFPOOL_MAG_CNT; i++)
+		ofi_spin_destroy(&pool->mags[i].lock);
+	ofi_spin_destroy(&pool->lock);
+	ofi_freealign(pool->mags);
+}
+
 int ofi_bufpool_create_attr(struct ofi_bufpool_attr *attr,
 			      struct ofi_bufpool **buf_pool)
 {
 	struct ofi_bufpool *pool;
 	size_t entry_sz;
 
+	if ((attr->flags & OFI_BUFPOOL_PERTHREAD) &&
+	    (attr->flags & OFI_BUFPOOL_INDEXED))
+		return -FI_EINVAL;
+
 	pool = calloc(1, sizeof(**buf_pool));
 	if (!pool)
 		return -FI_ENOMEM;
@@ -241,6 +405,21 @@ int ofi_bufpool_create_attr(struct ofi_bufpool_attr *attr,
 	pool->alloc_size = (pool->attr.chunk_cnt + 1) * pool->entry_size;
 	pool->region_size = pool->alloc_size - pool->entry_size;
 
+	pool->numa_node = -1;
+	if (pool->attr.flags & OFI_BUFPOOL_NUMA) {
+		pool->numa_node = attr->numa_node == OFI_BUFPOOL_NUMA_LOCAL ?
+				  ofi_numa_node_self() : attr->numa_node;
+		/* Placement requires page aligned, mmap'ed regions */
+		if (pool->numa_node >= 0)
+			pool->attr.flags |= OFI_BUFPOOL_NONSHARED;
+	}
+
+	if ((pool->attr.flags & OFI_BUFPOOL_PERTHREAD) &&
+	    ofi_bufpool_init_mags(pool)) {
+		free(pool);
+		return -FI_ENOMEM;
+	}
+
 	*buf_pool = pool;
 	return FI_SUCCESS;
 }
@@ -250,6 +429,17 @@ void ofi_bufpool_destroy(struct ofi_bufpool *pool)
 	struct ofi_bufpool_region *buf_region;
 	size_t i;
 
+	if (pool->entry_cnt) {
+		FI_DBG(&core_prov, FI_LOG_CORE, "bufpool %p stats: "
+			"entry size %zu, entries %zu, in use hwm %zu, "
+			"regions 1G pages %zu, 2M pages %zu, base pages %zu, "
+			"NUMA node %d\n",
+			(void *) pool, pool->entry_size, pool->entry_cnt,
+			pool->inuse_hwm, pool->page_cnt[OFI_BUFPOOL_PAGE_1G],
+			pool->page_cnt[OFI_BUFPOOL_PAGE_2M],
+			pool->page_cnt[OFI_BUFPOOL_PAGE_BASE], pool->numa_node);
+	}
+
 	for (i = 0; i < pool->region_cnt; i++) {
 		buf_region = pool->region_table[i];
 
@@ -262,6 +452,8 @@ void ofi_bufpool_destroy(struct ofi_bufpool *pool)
 		free(buf_region);
 	}
 	free(pool->region_table);
+	if (pool->mags)
+		ofi_bufpool_cleanup_mags(pool);
 	free(pool);
 }
 
@@ -69,6 +69,46 @@ static int ofi_check_cntr_attr(const struct fi_provider *prov,
 	return 0;
 }
 
+uint64_t ofi_cntr_value(struct util_cntr *cntr)
+{
+	uint64_t val = ofi_atomic_get64(&cntr->cnt);
+	size_t i;
+
+	for (i = 0; cntr->deltas && i < OFI_CNTR_DELTA_CNT; i++)
+		val += ofi_atomic_get64(&cntr->deltas[i].cnt);
+	return val;
+}
+
+/* Lower the armed wake up threshold to the given value */
+void ofi_cntr_arm(struct util_cntr *cntr, uint64_t threshold)
+{
+	int64_t cur;
+
+	do {
+		cur = ofi_atomic_get64(&cntr->threshold);
+		if ((uint64_t) cur <= threshold)
+			return;
+	} while (!ofi_atomic_cas_bool64(&cntr->threshold, cur,
+					(int64_t) threshold));
+}
+
+static void util_cntr_batch_add(struct util_cntr *cntr, uint64_t value)
+{
+	int64_t threshold;
+
+	ofi_atomic_add64(&cntr->deltas[ofi_thread_slot(OFI_CNTR_DELTA_CNT)].cnt,
+			 value);
+	if (!cntr->wait)
+		return;
+
+	threshold = ofi_atomic_get64(&cntr->threshold);
+	if (threshold == -1 || (uint64_t) threshold > ofi_cntr_value(cntr))
+		return;
+
+	if (ofi_atomic_cas_bool64(&cntr->threshold, threshold, -1))
+		cntr->wait->signal(cntr->wait);
+}
+
 uint64_t ofi_cntr_read(struct fid_cntr *cntr_fid)
 {
 	struct util_cntr *cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
@@ -76,7 +116,7 @@ uint64_t ofi_cntr_read(struct fid_cntr *cntr_fid)
 	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
 	cntr->progress(cntr);
 
-	return ofi_atomic_get64(&cntr->cnt);
+	return ofi_cntr_value(cntr);
 }
 
 uint64_t ofi_cntr_readerr(struct fid_cntr *cntr_fid)
@@ -95,6 +135,11 @@ int ofi_cntr_add(struct fid_cntr *cntr_fid, uint64_t value)
 
 	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
 
+	if (cntr->deltas) {
+		util_cntr_batch_add(cntr, value);
+		return FI_SUCCESS;
+	}
+
 	ofi_atomic_add64(&cntr->cnt, value);
 	if (cntr->wait)
 		cntr->wait->signal(cntr->wait);
@@ -119,9 +164,13 @@ int ofi_cntr_set(struct fid_cntr *cntr_fid, uint64_t value)
 {
 	struct util_cntr *cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
 
+	size_t i;
+
 	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
 
 	ofi_atomic_set64(&cntr->cnt, value);
+	for (i = 0; cntr->deltas && i < OFI_CNTR_DELTA_CNT; i++)
+		ofi_atomic_set64(&cntr->deltas[i].cnt, 0);
 	if (cntr->wait)
 		cntr->wait->signal(cntr->wait);
 
@@ -153,7 +202,7 @@ int ofi_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int timeout)
 
 	do {
 		cntr->progress(cntr);
-		if (threshold <= (uint64_t)ofi_atomic_get64(&cntr->cnt))
+		if (threshold <= ofi_cntr_value(cntr))
 			return FI_SUCCESS;
 
 		if (errcnt != (uint64_t)ofi_atomic_get64(&cntr->err))
@@ -162,6 +211,16 @@ int ofi_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int timeout)
 		if (ofi_adjust_timeout(endtime, &timeout))
 			return -FI_ETIMEDOUT;
 
+		/* Batched counters only signal once a waiter's threshold
+		 * is reached.  Check again after arming, in case the last
+		 * update raced with it.
+		 */
+		if (cntr->deltas) {
+			ofi_cntr_arm(cntr, threshold);
+			if (threshold <= ofi_cntr_value(cntr))
+				return FI_SUCCESS;
+		}
+
 		/*
 		 * Temporary work-around to avoid a thread hanging in underlying
 		 * epoll_wait called from fi_wait. This can happen if one thread
@@ -262,6 +321,7 @@ int ofi_cntr_cleanup(struct util_cntr *cntr)
 
 	ofi_atomic_dec32(&cntr->domain->ref);
 	ofi_genlock_destroy(&cntr->ep_list_lock);
+	ofi_freealign(cntr->deltas);
 	return 0;
 }
 
@@ -283,6 +343,7 @@ void ofi_cntr_progress(struct util_cntr *cntr)
 	struct util_ep *ep;
 	struct fid_list_entry *fid_entry;
 	struct dlist_entry *item;
+	uint64_t start = ofi_hist_start();
 
 	ofi_genlock_lock(&cntr->ep_list_lock);
 	dlist_foreach(&cntr->ep_list, item) {
@@ -291,6 +352,7 @@ void ofi_cntr_progress(struct util_cntr *cntr)
 		ep->progress(ep);
 	}
 	ofi_genlock_unlock(&cntr->ep_list_lock);
+	ofi_hist_end(OFI_HIST_PROGRESS, start);
 }
 
 static struct fi_ops util_cntr_fi_ops = {
@@ -315,6 +377,21 @@ static struct fi_ops util_peer_cntr_fi_ops = {
 	.ops_open = fi_no_ops_open,
 };
 
+static int util_init_cntr_deltas(struct util_cntr *cntr)
+{
+	size_t i;
+	int ret;
+
+	ret = ofi_memalign((void **) &cntr->deltas, sizeof(*cntr->deltas),
+			   sizeof(*cntr->deltas) * OFI_CNTR_DELTA_CNT);
+	if (ret)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < OFI_CNTR_DELTA_CNT; i++)
+		ofi_atomic_initialize64(&cntr->deltas[i].cnt, 0);
+	return FI_SUCCESS;
+}
+
 static int util_init_peer_cntr(struct util_cntr *cntr)
 {
 	cntr->peer_cntr = calloc(1, sizeof(*cntr->peer_cntr));
@@ -348,6 +425,8 @@ int ofi_cntr_init(const struct fi_provider *prov, struct fid_domain *domain,
 	ofi_atomic_initialize32(&cntr->ref, 0);
 	ofi_atomic_initialize64(&cntr->cnt, 0);
 	ofi_atomic_initialize64(&cntr->err, 0);
+	ofi_atomic_initialize64(&cntr->threshold, -1);
+	cntr->deltas = NULL;
 	dlist_init(&cntr->ep_list);
 
 	cntr->flags = attr->flags;
@@ -389,6 +468,14 @@ int ofi_cntr_init(const struct fi_provider *prov, struct fid_domain *domain,
 		ret = util_init_peer_cntr(cntr);
 		if (ret)
 			goto errout_close_wait;
+
+		if (ofi_cntr_batch) {
+			ret = util_init_cntr_deltas(cntr);
+			if (ret) {
+				fi_close(&cntr->peer_cntr->fid);
+				goto errout_close_wait;
+			}
+		}
 	}
 
 	ep_list_lock_type = ofi_progress_lock_type(cntr->domain->threading,
@@ -32,6 +32,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sched.h>
 
 #include <ofi_enosys.h>
 #include <ofi_util.h>
@@ -81,6 +82,47 @@ int ofi_cq_write_overflow(struct util_cq *cq, void *context, uint64_t flags,
 	return 0;
 }
 
+/* Move completions staged in the lock-free ring into the cirq.  A writer
+ * may have reserved a slot without committing it yet.  Wait for it, so
+ * that completions written after falling back to the locked path cannot
+ * pass ones that are still in flight.  The writer may have been preempted
+ * between reserving and committing, so yield the CPU while waiting rather
+ * than spinning with cq_lock held.  Only slots reserved before the drain
+ * started are consumed, so busy writers cannot starve the caller.
+ */
+void ofi_cq_drain_ring(struct util_cq *cq)
+{
+	struct util_cq_ring_comp *entry;
+	int64_t pos, end;
+
+	assert(ofi_genlock_held(&cq->cq_lock));
+	end = ofi_atomic_load_explicit64(&cq->ring->write_pos,
+					 memory_order_acquire);
+	while (ofi_atomic_load_explicit64(&cq->ring->read_pos,
+					  memory_order_acquire) < end) {
+		if (util_cq_ring_head(cq->ring, &entry, &pos)) {
+			sched_yield();
+			continue;
+		}
+
+		if (ofi_cirque_freecnt(cq->cirq) > 1) {
+			if (cq->src)
+				cq->src[ofi_cirque_windex(cq->cirq)] =
+					entry->src;
+			*ofi_cirque_next(cq->cirq) = entry->comp;
+			ofi_cirque_commit(cq->cirq);
+		} else if (ofi_cq_write_overflow(cq, entry->comp.op_context,
+				entry->comp.flags, entry->comp.len,
+				entry->comp.buf, entry->comp.data,
+				entry->comp.tag, entry->src)) {
+			FI_WARN(cq->domain->prov, FI_LOG_CQ,
+				"unable to move completion from ring, "
+				"entry lost\n");
+		}
+		util_cq_ring_release(cq->ring, entry, pos);
+	}
+}
+
 static int util_cq_insert_error(struct util_cq *cq,
 				const struct fi_cq_err_entry *err_entry)
 {
@@ -116,6 +158,8 @@ int ofi_cq_write_error(struct util_cq *cq,
 	int ret;
 
 	ofi_genlock_lock(&cq->cq_lock);
+	if (cq->ring)
+		ofi_cq_drain_ring(cq);
 	ret = util_cq_insert_error(cq, err_entry);
 	ofi_genlock_unlock(&cq->cq_lock);
 
@@ -260,6 +304,34 @@ static void util_cq_read_tagged(void **dst, void *src)
 	*(char **)dst += sizeof(struct fi_cq_tagged_entry);
 }
 
+/* Each cq format is a prefix of fi_cq_tagged_entry */
+#define UTIL_CQ_READ_BATCH(name, entry_type)				\
+static void util_cq_read_batch_##name(struct util_cq *cq, void *buf,	\
+				      size_t count, fi_addr_t *src_addr)\
+{									\
+	struct util_comp_cirq *cirq = cq->cirq;				\
+	entry_type *dst = buf;						\
+	size_t i, idx;							\
+									\
+	for (i = 0; i < count; i++) {					\
+		idx = (cirq->rcnt + i) & cirq->size_mask;		\
+		memcpy(&dst[i], &cirq->buf[idx], sizeof(*dst));	\
+	}								\
+									\
+	if (src_addr && cq->src) {					\
+		for (i = 0; i < count; i++) {				\
+			idx = (cirq->rcnt + i) & cirq->size_mask;	\
+			src_addr[i] = cq->src[idx];			\
+		}							\
+	}								\
+	cirq->rcnt += count;						\
+}
+
+UTIL_CQ_READ_BATCH(ctx, struct fi_cq_entry)
+UTIL_CQ_READ_BATCH(msg, struct fi_cq_msg_entry)
+UTIL_CQ_READ_BATCH(data, struct fi_cq_data_entry)
+UTIL_CQ_READ_BATCH(tagged, struct fi_cq_tagged_entry)
+
 ssize_t ofi_cq_readfrom(struct fid_cq *cq_fid, void *buf, size_t count,
 			fi_addr_t *src_addr)
 {
@@ -290,6 +362,8 @@ ssize_t ofi_cq_readerr(struct fid_cq *cq_fid, struct fi_cq_err_entry *buf,
 	api_version = cq->domain->fabric->fabric_fid.api_version;
 
 	ofi_genlock_lock(&cq->cq_lock);
+	if (cq->ring)
+		ofi_cq_drain_ring(cq);
 
 	if (cq->err_data) {
 		free(cq->err_data);
@@ -424,6 +498,7 @@ static void util_peer_cq_cleanup(struct util_cq *cq)
 	}
 
 	util_comp_cirq_free(cq->cirq);
+	ofi_freealign(cq->ring);
 	free(cq->src);
 	fi_close(&cq->peer_cq->fid);
 }
@@ -518,6 +593,7 @@ void ofi_cq_progress(struct util_cq *cq)
 	struct util_ep *ep;
 	struct fid_list_entry *fid_entry;
 	struct dlist_entry *item;
+	uint64_t start = ofi_hist_start();
 
 	ofi_genlock_lock(&cq->ep_list_lock);
 	dlist_foreach(&cq->ep_list, item) {
@@ -527,6 +603,7 @@ void ofi_cq_progress(struct util_cq *cq)
 
 	}
 	ofi_genlock_unlock(&cq->ep_list_lock);
+	ofi_hist_end(OFI_HIST_PROGRESS, start);
 }
 
 static ssize_t util_peer_cq_write(struct fid_peer_cq *cq, void *context,
@@ -538,16 +615,7 @@ static ssize_t util_peer_cq_write(struct fid_peer_cq *cq, void *context,
 
 	util_cq = cq->fid.context;
 
-	ofi_genlock_lock(&util_cq->cq_lock);
-	if (ofi_cirque_freecnt(util_cq->cirq) > 1) {
-		ofi_cq_write_entry(util_cq, context, flags, len, buf, data,
-				     tag);
-		ret = 0;
-	} else {
-		ret = ofi_cq_write_overflow(util_cq, context, flags, len, buf,
-					      data, tag, FI_ADDR_NOTAVAIL);
-	}
-	ofi_genlock_unlock(&util_cq->cq_lock);
+	ret = ofi_cq_write(util_cq, context, flags, len, buf, data, tag);
 
 	if (util_cq->wait)
 		util_cq->wait->signal(util_cq->wait);
@@ -562,16 +630,8 @@ static ssize_t util_peer_cq_write_src(struct fid_peer_cq *cq, void *context,
 	struct util_cq *util_cq = cq->fid.context;
 	int ret;
 
-	ofi_genlock_lock(&util_cq->cq_lock);
-	if (ofi_cirque_freecnt(util_cq->cirq) > 1) {
-		ofi_cq_write_src_entry(util_cq, context, flags, len, buf, data,
-				       tag, src);
-		ret = 0;
-	} else {
-		ret = ofi_cq_write_overflow(util_cq, context, flags, len, buf,
-					      data, tag, src);
-	}
-	ofi_genlock_unlock(&util_cq->cq_lock);
+	ret = ofi_cq_write_src(util_cq, context, flags, len, buf, data, tag,
+			       src);
 
 	if (util_cq->wait)
 		util_cq->wait->signal(util_cq->wait);
@@ -586,6 +646,8 @@ static ssize_t util_peer_cq_writeerr(struct fid_peer_cq *cq,
 	int ret;
 
 	ofi_genlock_lock(&util_cq->cq_lock);
+	if (util_cq->ring)
+		ofi_cq_drain_ring(util_cq);
 	ret = util_cq_insert_error(util_cq, err_entry);
 	ofi_genlock_unlock(&util_cq->cq_lock);
 
@@ -595,16 +657,64 @@ static ssize_t util_peer_cq_writeerr(struct fid_peer_cq *cq,
 	return ret;
 }
 
+/*
+ * Write a burst of completions under a single acquisition of the CQ lock and
+ * with a single wakeup.  Returns the number of completions written, or an
+ * error if none could be written.
+ */
+static ssize_t util_peer_cq_writev(struct fid_peer_cq *cq,
+				   const struct fi_cq_tagged_entry *buf,
+				   size_t count, const fi_addr_t *src)
+{
+	struct util_cq *util_cq = cq->fid.context;
+	uint64_t start = ofi_hist_start();
+	fi_addr_t addr;
+	ssize_t ret = 0;
+	size_t i;
+
+	ofi_genlock_lock(&util_cq->cq_lock);
+	if (util_cq->ring)
+		ofi_cq_drain_ring(util_cq);
+
+	for (i = 0; i < count; i++) {
+		addr = src ? src[i] : FI_ADDR_NOTAVAIL;
+		if (ofi_cirque_freecnt(util_cq->cirq) <= 1) {
+			ret = ofi_cq_write_overflow(util_cq, buf[i].op_context,
+					buf[i].flags, buf[i].len, buf[i].buf,
+					buf[i].data, buf[i].tag, addr);
+			if (ret)
+				break;
+		} else if (util_cq->src) {
+			ofi_cq_write_src_entry(util_cq, buf[i].op_context,
+					buf[i].flags, buf[i].len, buf[i].buf,
+					buf[i].data, buf[i].tag, addr);
+		} else {
+			ofi_cq_write_entry(util_cq, buf[i].op_context,
+					buf[i].flags, buf[i].len, buf[i].buf,
+					buf[i].data, buf[i].tag);
+		}
+	}
+	ofi_genlock_unlock(&util_cq->cq_lock);
+
+	if (i && util_cq->wait)
+		util_cq->wait->signal(util_cq->wait);
+
+	ofi_hist_end(OFI_HIST_CQ_WRITE, start);
+	return i ? (ssize_t) i : ret;
+}
+
 static struct fi_ops_cq_owner util_peer_cq_owner_ops = {
 	.size = sizeof(struct fi_ops_cq_owner),
 	.write = &util_peer_cq_write,
 	.writeerr = &util_peer_cq_writeerr,
+	.writev = &util_peer_cq_writev,
 };
 
 static struct fi_ops_cq_owner util_peer_cq_src_owner_ops = {
 	.size = sizeof(struct fi_ops_cq_owner),
 	.write = &util_peer_cq_write_src,
 	.writeerr = &util_peer_cq_writeerr,
+	.writev = &util_peer_cq_writev,
 };
 
 /* For peer cq, just do progress */
@@ -644,6 +754,21 @@ static struct fi_ops util_peer_cq_fi_ops = {
 	.ops_open = fi_no_ops_open,
 };
 
+static int util_cq_init_ring(struct util_cq *cq)
+{
+	void *ring;
+	int ret;
+
+	ret = ofi_memalign(&ring, OFI_CACHE_LINE_SIZE, sizeof(*cq->ring) +
+			   sizeof(struct util_cq_ring_entry) * cq->cirq->size);
+	if (ret)
+		return -FI_ENOMEM;
+
+	cq->ring = ring;
+	util_cq_ring_init(cq->ring, cq->cirq->size);
+	return FI_SUCCESS;
+}
+
 static int util_init_peer_cq(struct util_cq *cq, struct fi_cq_attr *attr)
 {
 	int ret;
@@ -658,15 +783,19 @@ static int util_init_peer_cq(struct util_cq *cq, struct fi_cq_attr *attr)
 	case FI_CQ_FORMAT_UNSPEC:
 	case FI_CQ_FORMAT_CONTEXT:
 		cq->read_entry = util_cq_read_ctx;
+		cq->read_batch = util_cq_read_batch_ctx;
 		break;
 	case FI_CQ_FORMAT_MSG:
 		cq->read_entry = util_cq_read_msg;
+		cq->read_batch = util_cq_read_batch_msg;
 		break;
 	case FI_CQ_FORMAT_DATA:
 		cq->read_entry = util_cq_read_data;
+		cq->read_batch = util_cq_read_batch_data;
 		break;
 	case FI_CQ_FORMAT_TAGGED:
 		cq->read_entry = util_cq_read_tagged;
+		cq->read_batch = util_cq_read_batch_tagged;
 		break;
 	default:
 		assert(0);
@@ -680,9 +809,19 @@ static int util_init_peer_cq(struct util_cq *cq, struct fi_cq_attr *attr)
 		goto free;
 	}
 
+	if (ofi_cq_lockfree_write && cq->domain->threading == FI_THREAD_SAFE &&
+	    cq->cq_lock.lock_type != OFI_LOCK_NOOP) {
+		ret = util_cq_init_ring(cq);
+		if (ret) {
+			util_comp_cirq_free(cq->cirq);
+			goto free;
+		}
+	}
+
 	if (cq->domain->info_domain_caps & FI_SOURCE) {
 		cq->src = calloc(cq->cirq->size, sizeof(*cq->src));
 		if (!cq->src) {
+			ofi_freealign(cq->ring);
 			util_comp_cirq_free(cq->cirq);
 			ret = -FI_ENOMEM;
 			goto free;
@@ -721,6 +860,7 @@ int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
 	cq->cq_fid.ops = &util_cq_ops;
 	cq->progress = progress;
 	cq->err_data = NULL;
+	cq->ring = NULL;
 
 	cq->domain = container_of(domain, struct util_domain, domain_fid);
 	ofi_atomic_initialize32(&cq->ref, 0);
@@ -171,6 +171,13 @@ void ofi_monitor_cleanup(struct ofi_mem_monitor *monitor)
 {
 	assert(dlist_empty(&monitor->list));
 	assert(monitor->state == FI_MM_STATE_IDLE);
+
+	if (monitor->queued_cnt) {
+		FI_INFO(&core_prov, FI_LOG_MR, "%s monitor stats: "
+			"queued %zu, coalesced %zu, flushed %zu\n",
+			monitor->name, monitor->queued_cnt,
+			monitor->coalesced_cnt, monitor->flushed_cnt);
+	}
 }
 
 static void initialize_monitor_list()
@@ -256,7 +263,29 @@ void ofi_monitors_init(void)
 			"Enable or disable the oneAPI Level Zero cache memory "
 			"monitor.  Enabled by default.");
 
+	fi_param_define(NULL, "mr_cache_shards", FI_PARAM_SIZE_T,
+			"Split each MR cache into the given number of shards,"
+			" partitioned by address range.  Cache hits only lock"
+			" the shard holding the region, while insertion and"
+			" eviction still take the global cache lock.  Lookups"
+			" are directed by the region base address, so a region"
+			" that is found through an address in a different"
+			" 2 MiB chunk may be registered again.  The value is"
+			" rounded up to a power of two.  (default: 0 - not"
+			" sharded)");
+
+	fi_param_define(NULL, "mr_cache_merge_max_size", FI_PARAM_SIZE_T,
+			"When registering a new region, grow it to page"
+			" boundaries and merge it with adjacent or overlapping"
+			" cached regions, as long as the result does not"
+			" exceed the given number of bytes.  Only applies to"
+			" system memory.  (default: 0 - regions are not"
+			" merged)");
+
 	fi_param_get_size_t(NULL, "mr_cache_max_size", &cache_params.max_size);
+	fi_param_get_size_t(NULL, "mr_cache_merge_max_size",
+			    &cache_params.merge_max_size);
+	fi_param_get_size_t(NULL, "mr_cache_shards", &cache_params.shard_cnt);
 	fi_param_get_size_t(NULL, "mr_cache_max_count", &cache_params.max_cnt);
 	fi_param_get_str(NULL, "mr_cache_monitor", &cache_params.monitor);
 	fi_param_get_bool(NULL, "mr_cuda_cache_monitor_enabled",
@@ -495,6 +524,58 @@ void ofi_monitor_flush(struct ofi_mem_monitor *monitor)
 	}
 }
 
+/* Returns false if the range could not be merged and the batch is full.
+ * The caller must then notify the batch before adding more ranges.
+ */
+bool ofi_monitor_batch_add(struct ofi_monitor_batch *batch,
+			   const void *addr, size_t len)
+{
+	uintptr_t start = (uintptr_t) addr, end = start + len;
+	uintptr_t cur_start, cur_end;
+	size_t i;
+
+	for (i = 0; i < batch->cnt; i++) {
+		cur_start = (uintptr_t) batch->iov[i].iov_base;
+		cur_end = cur_start + batch->iov[i].iov_len;
+		if (start > cur_end || end < cur_start)
+			continue;
+
+		cur_start = MIN(start, cur_start);
+		cur_end = MAX(end, cur_end);
+		batch->iov[i].iov_base = (void *) cur_start;
+		batch->iov[i].iov_len = cur_end - cur_start;
+		batch->queued_cnt++;
+		batch->coalesced_cnt++;
+		return true;
+	}
+
+	if (batch->cnt == OFI_MONITOR_BATCH_SIZE)
+		return false;
+
+	batch->iov[batch->cnt].iov_base = (void *) addr;
+	batch->iov[batch->cnt++].iov_len = len;
+	batch->queued_cnt++;
+	return true;
+}
+
+/* Must be called with locks in place as for ofi_monitor_notify().
+ * The batch is empty on return.
+ */
+void ofi_monitor_batch_notify(struct ofi_mem_monitor *monitor,
+			      struct ofi_monitor_batch *batch)
+{
+	size_t i;
+
+	for (i = 0; i < batch->cnt; i++)
+		ofi_monitor_notify(monitor, batch->iov[i].iov_base,
+				   batch->iov[i].iov_len);
+
+	monitor->queued_cnt += batch->queued_cnt;
+	monitor->coalesced_cnt += batch->coalesced_cnt;
+	monitor->flushed_cnt += batch->cnt;
+	ofi_monitor_batch_init(batch);
+}
+
 int ofi_monitor_subscribe(struct ofi_mem_monitor *monitor,
 			  const void *addr, size_t len,
 			  union ofi_mr_hmem_info *hmem_info)
@@ -551,6 +632,16 @@ void ofi_monitor_unsubscribe_no_op(struct ofi_mem_monitor *notifier,
 #include <sys/ioctl.h>
 #include <linux/userfaultfd.h>
 
+/* Add a range to a batch, notifying the caches first if it is full. */
+static void ofi_uffd_batch_add(struct ofi_monitor_batch *batch,
+			       const void *addr, size_t len)
+{
+	if (!ofi_monitor_batch_add(batch, addr, len)) {
+		ofi_monitor_batch_notify(&uffd.monitor, batch);
+		ofi_monitor_batch_add(batch, addr, len);
+	}
+}
+
 /* The userfault fd monitor requires for events that could
  * trigger it to be handled outside of the monitor functions
  * itself. When a fault occurs on a monitored region, the
@@ -559,15 +650,24 @@ void ofi_monitor_unsubscribe_no_op(struct ofi_mem_monitor *notifier,
  * within the userfault handling thread, no threads will
  * read this event and our threads cannot progress, resulting
  * in a hang.
+ *
+ * Events are read in bursts under mm_lock.  Reading an event releases the
+ * thread that unmapped the memory, so the lock must be held until the caches
+ * have been notified, otherwise that thread could hit a stale registration.
  */
 static void *ofi_uffd_handler(void *arg)
 {
-	struct uffd_msg msg;
+	struct uffd_msg msg[OFI_MONITOR_BATCH_SIZE];
+	struct ofi_monitor_batch batch;
 	struct pollfd fds;
-	int ret;
+	void *addr;
+	size_t len;
+	ssize_t ret;
+	int i, cnt;
 
 	fds.fd = uffd.fd;
 	fds.events = POLLIN;
+	ofi_monitor_batch_init(&batch);
 	for (;;) {
 		ret = poll(&fds, 1, -1);
 		if (ret != 1)
@@ -575,8 +675,8 @@ static void *ofi_uffd_handler(void *arg)
 
 		pthread_rwlock_rdlock(&mm_list_rwlock);
 		pthread_mutex_lock(&mm_lock);
-		ret = read(uffd.fd, &msg, sizeof(msg));
-		if (ret != sizeof(msg)) {
+		ret = read(uffd.fd, msg, sizeof(msg));
+		if (ret < (ssize_t) sizeof(*msg)) {
 			pthread_mutex_unlock(&mm_lock);
 			pthread_rwlock_unlock(&mm_list_rwlock);
 			if (errno != EAGAIN)
@@ -584,29 +684,37 @@ static void *ofi_uffd_handler(void *arg)
 			continue;
 		}
 
-		switch (msg.event) {
-		case UFFD_EVENT_REMOVE:
-			ofi_monitor_unsubscribe(&uffd.monitor,
-				(void *) (uintptr_t) msg.arg.remove.start,
-				(size_t) (msg.arg.remove.end -
-					  msg.arg.remove.start), NULL);
-			/* fall through */
-		case UFFD_EVENT_UNMAP:
-			ofi_monitor_notify(&uffd.monitor,
-				(void *) (uintptr_t) msg.arg.remove.start,
-				(size_t) (msg.arg.remove.end -
-					  msg.arg.remove.start));
-			break;
-		case UFFD_EVENT_REMAP:
-			ofi_monitor_notify(&uffd.monitor,
-				(void *) (uintptr_t) msg.arg.remap.from,
-				(size_t) msg.arg.remap.len);
-			break;
-		default:
-			FI_WARN(&core_prov, FI_LOG_MR,
-				"Unhandled uffd event %d\n", msg.event);
-			break;
+		cnt = ret / sizeof(*msg);
+		for (i = 0; i < cnt; i++) {
+			switch (msg[i].event) {
+			case UFFD_EVENT_REMOVE:
+				addr = (void *) (uintptr_t)
+				       msg[i].arg.remove.start;
+				len = (size_t) (msg[i].arg.remove.end -
+						msg[i].arg.remove.start);
+				ofi_monitor_unsubscribe(&uffd.monitor, addr,
+							len, NULL);
+				ofi_uffd_batch_add(&batch, addr, len);
+				break;
+			case UFFD_EVENT_UNMAP:
+				ofi_uffd_batch_add(&batch, (void *) (uintptr_t)
+					msg[i].arg.remove.start,
+					(size_t) (msg[i].arg.remove.end -
+						  msg[i].arg.remove.start));
+				break;
+			case UFFD_EVENT_REMAP:
+				ofi_uffd_batch_add(&batch, (void *) (uintptr_t)
+					msg[i].arg.remap.from,
+					(size_t) msg[i].arg.remap.len);
+				break;
+			default:
+				FI_WARN(&core_prov, FI_LOG_MR,
+					"Unhandled uffd event %d\n",
+					msg[i].event);
+				break;
+			}
 		}
+		ofi_monitor_batch_notify(&uffd.monitor, &batch);
 		pthread_mutex_unlock(&mm_lock);
 		pthread_rwlock_unlock(&mm_list_rwlock);
 	}
@@ -87,6 +87,48 @@ static int util_mr_find_overlap(struct ofi_rbmap *map, void *key, void *data)
 	return 0;
 }
 
+static uint64_t util_mr_entry_end(void *data)
+{
+	struct ofi_mr_entry *entry = data;
+
+	return (uintptr_t) entry->info.iov.iov_base + entry->info.iov.iov_len;
+}
+
+static inline struct ofi_mr_cache_shard *
+util_mr_cache_span_shard(struct ofi_mr_cache *cache)
+{
+	return &cache->shards[cache->shard_cnt];
+}
+
+static inline uintptr_t util_mr_cache_chunk(const void *addr)
+{
+	return (uintptr_t) addr >> OFI_MR_CACHE_SHARD_SHIFT;
+}
+
+static inline uintptr_t util_mr_cache_last_chunk(const struct iovec *iov)
+{
+	return iov->iov_len ? util_mr_cache_chunk(ofi_iov_end(iov)) :
+			      util_mr_cache_chunk(iov->iov_base);
+}
+
+/* The shard that holds, or would hold, a region covering iov */
+static inline struct ofi_mr_cache_shard *
+util_mr_cache_shard(struct ofi_mr_cache *cache, const struct iovec *iov)
+{
+	uintptr_t chunk = util_mr_cache_chunk(iov->iov_base);
+
+	if (chunk != util_mr_cache_last_chunk(iov))
+		return util_mr_cache_span_shard(cache);
+
+	return &cache->shards[chunk & (cache->shard_cnt - 1)];
+}
+
+static inline struct ofi_mr_cache_shard *
+util_mr_entry_shard(struct ofi_mr_cache *cache, struct ofi_mr_entry *entry)
+{
+	return util_mr_cache_shard(cache, &entry->info.iov);
+}
+
 static struct ofi_mr_entry *util_mr_entry_alloc(struct ofi_mr_cache *cache)
 {
 	struct ofi_mr_entry *entry;
@@ -131,7 +173,11 @@ static void util_mr_uncache_entry_storage(struct ofi_mr_cache *cache,
 	 * notification events, but is harmless to correct operation.
 	 */
 
-	ofi_rbmap_delete(&cache->tree, entry->node);
+	if (cache->shards)
+		ofi_rbmap_delete(&util_mr_entry_shard(cache, entry)->tree,
+				 entry->node);
+	else
+		ofi_rbmap_delete(&cache->tree, entry->node);
 	entry->node = NULL;
 
 	cache->cached_cnt--;
@@ -146,6 +192,8 @@ static void util_mr_uncache_entry(struct ofi_mr_cache *cache,
 	if (entry->use_cnt == 0) {
 		dlist_remove(&entry->list_entry);
 		dlist_insert_tail(&entry->list_entry, &cache->dead_region_list);
+		if (cache->shards)
+			ofi_atomic_set32(&cache->dead_pending, 1);
 	} else {
 		cache->uncached_cnt++;
 		cache->uncached_size += entry->info.iov.iov_len;
@@ -164,35 +212,129 @@ static struct ofi_mr_entry *ofi_mr_rbt_find(struct ofi_rbmap *tree,
 	return node->data;
 }
 
-static struct ofi_mr_entry *ofi_mr_rbt_overlap(struct ofi_rbmap *tree,
-					       const struct iovec *key)
+/* Return a cached region matching info under compare.  In sharded mode,
+ * this checks the spanning shard and the shards of every chunk that info
+ * covers, and returns with the shard of the region locked.  Called with
+ * mm_lock held.
+ */
+static struct ofi_mr_entry *
+util_mr_cache_lookup(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
+		     int (*compare)(struct ofi_rbmap *map, void *key,
+				    void *data),
+		     struct ofi_mr_cache_shard **shard)
 {
 	struct ofi_rbnode *node;
-	struct ofi_mr_info info = {0};
+	uintptr_t chunk, last;
 
-	info.iov = *key;
+	*shard = NULL;
+	if (!cache->shards) {
+		node = ofi_rbmap_search(&cache->tree, (void *) info, compare);
+		return node ? node->data : NULL;
+	}
 
-	node = ofi_rbmap_search(tree, (void *) &info,
-				util_mr_find_overlap);
-	if (!node)
-		return NULL;
+	chunk = util_mr_cache_chunk(info->iov.iov_base);
+	last = util_mr_cache_last_chunk(&info->iov);
+	if (last - chunk >= cache->shard_cnt)
+		last = chunk + cache->shard_cnt - 1;
+
+	*shard = util_mr_cache_span_shard(cache);
+	for (;;) {
+		pthread_mutex_lock(&(*shard)->lock);
+		node = ofi_rbmap_search(&(*shard)->tree, (void *) info,
+					compare);
+		if (node)
+			return node->data;
+		pthread_mutex_unlock(&(*shard)->lock);
+
+		if (chunk > last)
+			break;
+		*shard = &cache->shards[chunk++ & (cache->shard_cnt - 1)];
+	}
+	*shard = NULL;
+	return NULL;
+}
 
-	return node->data;
+static inline void util_mr_cache_unlock_shard(struct ofi_mr_cache_shard *shard)
+{
+	if (shard)
+		pthread_mutex_unlock(&shard->lock);
+}
+
+/* Uncache every entry overlapping the region in a single pass */
+static void util_mr_uncache_overlap(struct ofi_mr_cache *cache,
+				    struct ofi_rbmap *tree,
+				    const struct iovec *iov)
+{
+	struct ofi_rbnode *node, *next;
+	struct ofi_mr_info info = {0};
+	uint64_t start = (uintptr_t) iov->iov_base;
+
+	info.iov = *iov;
+	node = ofi_rbmap_overlap_first(tree, start, &info,
+				       util_mr_find_overlap);
+	while (node) {
+		next = ofi_rbmap_overlap_next(tree, node, start, &info,
+					      util_mr_find_overlap);
+		util_mr_uncache_entry(cache, node->data);
+		node = next;
+	}
 }
 
 /* Caller must hold ofi_mem_monitor lock as well as unsubscribe from the region */
 void ofi_mr_cache_notify(struct ofi_mr_cache *cache, const void *addr, size_t len)
 {
-	struct ofi_mr_entry *entry;
+	struct ofi_mr_cache_shard *shard;
 	struct iovec iov;
+	size_t i;
 
 	cache->notify_cnt++;
 	iov.iov_base = (void *) addr;
 	iov.iov_len = len;
 
-	for (entry = ofi_mr_rbt_overlap(&cache->tree, &iov); entry;
-	     entry = ofi_mr_rbt_overlap(&cache->tree, &iov))
-		util_mr_uncache_entry(cache, entry);
+	if (!cache->shards) {
+		util_mr_uncache_overlap(cache, &cache->tree, &iov);
+		return;
+	}
+
+	for (i = 0; i <= cache->shard_cnt; i++) {
+		shard = &cache->shards[i];
+		pthread_mutex_lock(&shard->lock);
+		util_mr_uncache_overlap(cache, &shard->tree, &iov);
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
+
+/* Pick the shard holding the least recently used entry.  Called with
+ * mm_lock held.  Returns the shard locked, or NULL if all LRU lists are
+ * empty.
+ */
+static struct ofi_mr_cache_shard *
+util_mr_cache_lru_shard(struct ofi_mr_cache *cache)
+{
+	struct ofi_mr_cache_shard *shard, *oldest = NULL;
+	struct ofi_mr_entry *entry;
+	uint64_t tick = UINT64_MAX;
+	size_t i;
+
+	for (i = 0; i <= cache->shard_cnt; i++) {
+		shard = &cache->shards[i];
+		pthread_mutex_lock(&shard->lock);
+		if (!dlist_empty(&shard->lru_list)) {
+			entry = container_of(shard->lru_list.next,
+					     struct ofi_mr_entry, list_entry);
+			if (entry->lru_tick < tick) {
+				tick = entry->lru_tick;
+				oldest = shard;
+			}
+		}
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	if (!oldest)
+		return NULL;
+
+	pthread_mutex_lock(&oldest->lock);
+	return oldest;
 }
 
 /* Function to remove dead regions and prune MR cache size.
@@ -201,6 +343,7 @@ void ofi_mr_cache_notify(struct ofi_mr_cache *cache, const void *addr, size_t le
 bool ofi_mr_cache_flush(struct ofi_mr_cache *cache, bool flush_lru)
 {
 	struct dlist_entry free_list;
+	struct ofi_mr_cache_shard *shard;
 	struct ofi_mr_entry *entry;
 	bool entries_freed;
 
@@ -210,6 +353,25 @@ bool ofi_mr_cache_flush(struct ofi_mr_cache *cache, bool flush_lru)
 
 	dlist_splice_tail(&free_list, &cache->dead_region_list);
 
+	if (cache->shards) {
+		ofi_atomic_set32(&cache->dead_pending, 0);
+		while (flush_lru && (shard = util_mr_cache_lru_shard(cache))) {
+			/* The entry may have been hit after the LRU scan */
+			if (!dlist_empty(&shard->lru_list)) {
+				dlist_pop_front(&shard->lru_list,
+						struct ofi_mr_entry, entry,
+						list_entry);
+				dlist_init(&entry->list_entry);
+				util_mr_uncache_entry_storage(cache, entry);
+				dlist_insert_tail(&entry->list_entry,
+						  &free_list);
+			}
+			pthread_mutex_unlock(&shard->lock);
+
+			flush_lru = ofi_mr_cache_full(cache);
+		}
+	}
+
 	while (flush_lru && !dlist_empty(&cache->lru_list)) {
 		dlist_pop_front(&cache->lru_list, struct ofi_mr_entry,
 				entry, list_entry);
@@ -235,11 +397,45 @@ bool ofi_mr_cache_flush(struct ofi_mr_cache *cache, bool flush_lru)
 	return entries_freed;
 }
 
+static void util_mr_cache_shard_delete(struct ofi_mr_cache *cache,
+				       struct ofi_mr_entry *entry)
+{
+	struct ofi_mr_cache_shard *shard;
+
+	shard = util_mr_entry_shard(cache, entry);
+	pthread_mutex_lock(&shard->lock);
+	shard->delete_cnt++;
+
+	if (--entry->use_cnt) {
+		pthread_mutex_unlock(&shard->lock);
+		return;
+	}
+
+	if (entry->node) {
+		entry->lru_tick = ofi_atomic_inc64(&cache->lru_tick);
+		dlist_insert_tail(&entry->list_entry, &shard->lru_list);
+		pthread_mutex_unlock(&shard->lock);
+		return;
+	}
+	pthread_mutex_unlock(&shard->lock);
+
+	pthread_mutex_lock(&mm_lock);
+	cache->uncached_cnt--;
+	cache->uncached_size -= entry->info.iov.iov_len;
+	pthread_mutex_unlock(&mm_lock);
+	util_mr_free_entry(cache, entry);
+}
+
 void ofi_mr_cache_delete(struct ofi_mr_cache *cache, struct ofi_mr_entry *entry)
 {
 	FI_DBG(cache->prov, FI_LOG_MR, "delete %p (len: %zu)\n",
 	       entry->info.iov.iov_base, entry->info.iov.iov_len);
 
+	if (cache->shards) {
+		util_mr_cache_shard_delete(cache, entry);
+		return;
+	}
+
 	pthread_mutex_lock(&mm_lock);
 	cache->delete_cnt++;
 
@@ -270,7 +466,9 @@ static int
 util_mr_cache_create(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
 		     struct ofi_mr_entry **entry)
 {
+	struct ofi_mr_cache_shard *shard = NULL;
 	struct ofi_mr_entry *cur;
+	struct ofi_rbmap *tree;
 	int ret;
 	struct ofi_mem_monitor *monitor = cache->monitors[info->iface];
 
@@ -292,17 +490,25 @@ util_mr_cache_create(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
 		goto free;
 
 	pthread_mutex_lock(&mm_lock);
-	cur = ofi_mr_rbt_find(&cache->tree, info);
+	cur = util_mr_cache_lookup(cache, info, util_mr_find_within, &shard);
 	if (cur) {
 		ret = -FI_EAGAIN;
 		goto unlock;
 	}
 
+	if (cache->shards) {
+		shard = util_mr_cache_shard(cache, &info->iov);
+		pthread_mutex_lock(&shard->lock);
+		tree = &shard->tree;
+	} else {
+		tree = &cache->tree;
+	}
+
 	if (ofi_mr_cache_full(cache)) {
 		cache->uncached_cnt++;
 		cache->uncached_size += info->iov.iov_len;
 	} else {
-		if (ofi_rbmap_insert(&cache->tree, (void *) &(*entry)->info,
+		if (ofi_rbmap_insert(tree, (void *) &(*entry)->info,
 				     (void *) *entry, &(*entry)->node)) {
 			ret = -FI_ENOMEM;
 			goto unlock;
@@ -319,20 +525,185 @@ util_mr_cache_create(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
 			cache->uncached_size += (*entry)->info.iov.iov_len;
 		}
 	}
+	if (shard)
+		pthread_mutex_unlock(&shard->lock);
 	pthread_mutex_unlock(&mm_lock);
 	return 0;
 
 unlock:
+	if (shard)
+		pthread_mutex_unlock(&shard->lock);
 	pthread_mutex_unlock(&mm_lock);
 free:
 	util_mr_free_entry(cache, *entry);
 	return ret;
 }
 
-int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
-			struct ofi_mr_entry **entry)
+static bool util_mr_cache_can_merge(const struct ofi_mr_info *info,
+				    const struct ofi_mr_entry *entry)
+{
+	return entry->info.iface == info->iface &&
+	       entry->info.device == info->device &&
+	       entry->info.flags == info->flags;
+}
+
+/* Grow a new region to a page-aligned extent that absorbs adjacent and
+ * overlapping cached regions, up to cache_params.merge_max_size, so that
+ * streaming over a large buffer converges on a few registrations.  The
+ * absorbed regions are uncached.  Called with mm_lock held.
+ */
+static void util_mr_cache_merge(struct ofi_mr_cache *cache,
+				struct ofi_mr_info *info)
+{
+	struct ofi_mr_cache_shard *shard;
+	struct ofi_mr_entry *entry;
+	struct ofi_mr_info probe;
+	uintptr_t start, end, entry_start, entry_end;
+	size_t page_size = page_sizes[OFI_PAGE_SIZE];
+
+	if (!cache_params.merge_max_size || info->iface != FI_HMEM_SYSTEM)
+		return;
+
+	start = (uintptr_t) ofi_get_page_start(info->iov.iov_base, page_size);
+	end = start + ofi_get_page_bytes(info->iov.iov_base, info->iov.iov_len,
+					 page_size);
+	if (!start || end - start > cache_params.merge_max_size)
+		return;
+
+	probe = *info;
+	for (;;) {
+		/* Widen the probe by a byte to also find adjacent regions */
+		probe.iov.iov_base = (void *) (start - 1);
+		probe.iov.iov_len = end - start + 2;
+		entry = util_mr_cache_lookup(cache, &probe,
+					     util_mr_find_overlap, &shard);
+		if (!entry)
+			break;
+
+		entry_start = (uintptr_t) entry->info.iov.iov_base;
+		entry_end = entry_start + entry->info.iov.iov_len;
+		entry_start = MIN(start, entry_start);
+		entry_end = MAX(end, entry_end);
+		if (!util_mr_cache_can_merge(info, entry) ||
+		    entry_end - entry_start > cache_params.merge_max_size) {
+			util_mr_cache_unlock_shard(shard);
+			break;
+		}
+
+		start = entry_start;
+		end = entry_end;
+		util_mr_uncache_entry(cache, entry);
+		util_mr_cache_unlock_shard(shard);
+	}
+
+	info->iov.iov_base = (void *) start;
+	info->iov.iov_len = end - start;
+}
+
+/* Find a valid cached region containing info.  A region that fits in one
+ * chunk is held by the shard of that chunk, and a larger one by the
+ * spanning shard, so both are checked.  Returns with the shard of the
+ * region locked.
+ */
+static struct ofi_mr_entry *
+util_mr_cache_shard_find(struct ofi_mr_cache *cache,
+			 struct ofi_mem_monitor *monitor,
+			 const struct ofi_mr_info *info,
+			 struct ofi_mr_cache_shard **shard, bool count)
+{
+	struct ofi_mr_entry *entry;
+
+	*shard = util_mr_cache_shard(cache, &info->iov);
+	pthread_mutex_lock(&(*shard)->lock);
+	if (count)
+		(*shard)->search_cnt++;
+	for (;;) {
+		entry = ofi_mr_rbt_find(&(*shard)->tree, info);
+		if (entry &&
+		    ofi_iov_within(&info->iov, &entry->info.iov) &&
+		    monitor->valid(monitor, info, entry))
+			return entry;
+		pthread_mutex_unlock(&(*shard)->lock);
+
+		if (*shard == util_mr_cache_span_shard(cache))
+			return NULL;
+		*shard = util_mr_cache_span_shard(cache);
+		pthread_mutex_lock(&(*shard)->lock);
+	}
+}
+
+/* Hits only take shard locks.  Misses fall back to mm_lock to evict
+ * and purge overlapping regions before creating the new entry.
+ */
+static int util_mr_cache_shard_search(struct ofi_mr_cache *cache,
+				      struct ofi_mem_monitor *monitor,
+				      const struct ofi_mr_info *info,
+				      struct ofi_mr_entry **entry)
+{
+	struct ofi_mr_cache_shard *shard;
+	struct ofi_mr_info merged;
+	bool flush_lru;
+	int ret;
+
+	do {
+		if (ofi_atomic_get32(&cache->dead_pending))
+			ofi_mr_cache_flush(cache, false);
+
+		*entry = util_mr_cache_shard_find(cache, monitor, info,
+						  &shard, true);
+		if (*entry)
+			goto hit;
+
+		pthread_mutex_lock(&mm_lock);
+		flush_lru = ofi_mr_cache_full(cache);
+		if (flush_lru) {
+			pthread_mutex_unlock(&mm_lock);
+			ofi_mr_cache_flush(cache, flush_lru);
+			pthread_mutex_lock(&mm_lock);
+		}
+
+		*entry = util_mr_cache_shard_find(cache, monitor, info,
+						  &shard, false);
+		if (*entry) {
+			pthread_mutex_unlock(&mm_lock);
+			goto hit;
+		}
+
+		merged = *info;
+		util_mr_cache_merge(cache, &merged);
+
+		/* Purge regions that overlap with new region */
+		while ((*entry = util_mr_cache_lookup(cache, &merged,
+						      util_mr_find_within,
+						      &shard))) {
+			util_mr_uncache_entry(cache, *entry);
+			util_mr_cache_unlock_shard(shard);
+		}
+		pthread_mutex_unlock(&mm_lock);
+
+		ret = util_mr_cache_create(cache, &merged, entry);
+		if (ret && ret != -FI_EAGAIN) {
+			if (ofi_mr_cache_flush(cache, true))
+				ret = -FI_EAGAIN;
+		}
+	} while (ret == -FI_EAGAIN);
+
+	return ret;
+
+hit:
+	shard->hit_cnt++;
+	if ((*entry)->use_cnt++ == 0)
+		dlist_remove_init(&(*entry)->list_entry);
+	pthread_mutex_unlock(&shard->lock);
+	return 0;
+}
+
+static int util_mr_cache_search(struct ofi_mr_cache *cache,
+				const struct ofi_mr_info *info,
+				struct ofi_mr_entry **entry)
 {
 	struct ofi_mem_monitor *monitor;
+	struct ofi_mr_info merged;
 	bool flush_lru;
 	int ret;
 
@@ -347,6 +718,9 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct ofi_mr_info *in
 	FI_DBG(cache->prov, FI_LOG_MR, "search %p (len: %zu)\n",
 	       info->iov.iov_base, info->iov.iov_len);
 
+	if (cache->shards)
+		return util_mr_cache_shard_search(cache, monitor, info, entry);
+
 	do {
 		pthread_mutex_lock(&mm_lock);
 		flush_lru = ofi_mr_cache_full(cache);
@@ -364,14 +738,18 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct ofi_mr_info *in
 		    monitor->valid(monitor, info, *entry))
 			goto hit;
 
+		merged = *info;
+		util_mr_cache_merge(cache, &merged);
+
 		/* Purge regions that overlap with new region */
+		*entry = ofi_mr_rbt_find(&cache->tree, &merged);
 		while (*entry) {
 			util_mr_uncache_entry(cache, *entry);
-			*entry = ofi_mr_rbt_find(&cache->tree, info);
+			*entry = ofi_mr_rbt_find(&cache->tree, &merged);
 		}
 		pthread_mutex_unlock(&mm_lock);
 
-		ret = util_mr_cache_create(cache, info, entry);
+		ret = util_mr_cache_create(cache, &merged, entry);
 		if (ret && ret != -FI_EAGAIN) {
 			if (ofi_mr_cache_flush(cache, true))
 				ret = -FI_EAGAIN;
@@ -388,10 +766,22 @@ hit:
 	return 0;
 }
 
+int ofi_mr_cache_search(struct ofi_mr_cache *cache, const struct ofi_mr_info *info,
+			struct ofi_mr_entry **entry)
+{
+	uint64_t start = ofi_hist_start();
+	int ret;
+
+	ret = util_mr_cache_search(cache, info, entry);
+	ofi_hist_end(OFI_HIST_MR_CACHE_SEARCH, start);
+	return ret;
+}
+
 struct ofi_mr_entry *ofi_mr_cache_find(struct ofi_mr_cache *cache,
 				       const struct fi_mr_attr *attr,
 				       uint64_t flags)
 {
+	struct ofi_mr_cache_shard *shard;
 	struct ofi_mr_info info;
 	struct ofi_mr_entry *entry;
 	struct ofi_mem_monitor *monitor;
@@ -412,7 +802,7 @@ struct ofi_mr_entry *ofi_mr_cache_find(struct ofi_mr_cache *cache,
 
 	info.peer_id = 0;
 	ofi_mr_info_get_iov_from_mr_attr(&info, attr, flags);
-	entry = ofi_mr_rbt_find(&cache->tree, &info);
+	entry = util_mr_cache_lookup(cache, &info, util_mr_find_within, &shard);
 	if (!entry) {
 		goto unlock;
 	}
@@ -427,11 +817,15 @@ struct ofi_mr_entry *ofi_mr_cache_find(struct ofi_mr_cache *cache,
 	} else {
 		while (entry) {
 			util_mr_uncache_entry(cache, entry);
-			entry = ofi_mr_rbt_find(&cache->tree, &entry->info);
+			util_mr_cache_unlock_shard(shard);
+			entry = util_mr_cache_lookup(cache, &entry->info,
+						     util_mr_find_within,
+						     &shard);
 		}
 	}
 
 unlock:
+	util_mr_cache_unlock_shard(shard);
 	pthread_mutex_unlock(&mm_lock);
 	return entry;
 }
@@ -473,12 +867,60 @@ buf_free:
 	return ret;
 }
 
+static void util_mr_cache_free_shards(struct ofi_mr_cache *cache)
+{
+	size_t i;
+
+	for (i = 0; i <= cache->shard_cnt; i++) {
+		ofi_rbmap_cleanup(&cache->shards[i].tree);
+		pthread_mutex_destroy(&cache->shards[i].lock);
+	}
+	ofi_freealign(cache->shards);
+	cache->shards = NULL;
+	cache->shard_cnt = 0;
+}
+
+static int util_mr_cache_init_shards(struct ofi_mr_cache *cache)
+{
+	void *shards;
+	size_t i;
+
+	/* One more shard holds the regions that cross a chunk boundary */
+	cache->shard_cnt = roundup_power_of_two(cache_params.shard_cnt);
+	if (ofi_memalign(&shards, 64, sizeof(*cache->shards) *
+			 (cache->shard_cnt + 1))) {
+		cache->shard_cnt = 0;
+		return -FI_ENOMEM;
+	}
+
+	cache->shards = shards;
+	for (i = 0; i <= cache->shard_cnt; i++) {
+		memset(&cache->shards[i], 0, sizeof(cache->shards[i]));
+		pthread_mutex_init(&cache->shards[i].lock, NULL);
+		ofi_rbmap_init_interval(&cache->shards[i].tree,
+					util_mr_find_within,
+					util_mr_entry_end);
+		dlist_init(&cache->shards[i].lru_list);
+	}
+	ofi_atomic_initialize32(&cache->dead_pending, 0);
+	ofi_atomic_initialize64(&cache->lru_tick, 0);
+	return 0;
+}
+
 void ofi_mr_cache_cleanup(struct ofi_mr_cache *cache)
 {
+	size_t i;
+
 	/* If we don't have a prov, initialization failed */
 	if (!cache->prov)
 		return;
 
+	for (i = 0; cache->shards && i <= cache->shard_cnt; i++) {
+		cache->search_cnt += cache->shards[i].search_cnt;
+		cache->delete_cnt += cache->shards[i].delete_cnt;
+		cache->hit_cnt += cache->shards[i].hit_cnt;
+	}
+
 	FI_INFO(cache->prov, FI_LOG_MR, "MR cache stats: "
 		"searches %zu, deletes %zu, hits %zu notify %zu\n",
 		cache->search_cnt, cache->delete_cnt, cache->hit_cnt,
@@ -489,6 +931,8 @@ void ofi_mr_cache_cleanup(struct ofi_mr_cache *cache)
 
 	pthread_mutex_destroy(&cache->lock);
 	ofi_monitors_del_cache(cache);
+	if (cache->shards)
+		util_mr_cache_free_shards(cache);
 	ofi_rbmap_cleanup(&cache->tree);
 	if (cache->domain)
 		ofi_atomic_dec32(&cache->domain->ref);
@@ -531,7 +975,16 @@ int ofi_mr_cache_init(struct util_domain *domain,
 		cache->prov = (const struct fi_provider *) &core_prov;
 	}
 
-	ofi_rbmap_init(&cache->tree, util_mr_find_within);
+	ofi_rbmap_init_interval(&cache->tree, util_mr_find_within,
+				util_mr_entry_end);
+	cache->shards = NULL;
+	cache->shard_cnt = 0;
+	if (cache_params.shard_cnt > 1) {
+		ret = util_mr_cache_init_shards(cache);
+		if (ret)
+			goto destroy;
+	}
+
 	ret = ofi_monitors_add_cache(monitors, cache);
 	if (ret)
 		goto destroy;
@@ -547,6 +1000,8 @@ int ofi_mr_cache_init(struct util_domain *domain,
 del:
 	ofi_monitors_del_cache(cache);
 destroy:
+	if (cache->shards)
+		util_mr_cache_free_shards(cache);
 	ofi_rbmap_cleanup(&cache->tree);
 	if (domain) {
 		ofi_atomic_dec32(&cache->domain->ref);
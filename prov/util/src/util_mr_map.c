@@ -66,6 +66,57 @@ dup_mr_attr(const struct fi_mr_attr *attr, uint64_t flags)
 	return dup_attr;
 }
 
+/* Provider keys whose index field is OFI_MR_MAP_IDX_NONE are kept in
+ * the rbtree, once the indexer is full.
+ */
+static bool util_mr_map_indexed(struct ofi_mr_map *map, uint64_t key)
+{
+	return (map->mode & FI_MR_PROV_KEY) &&
+	       (key & OFI_MR_MAP_IDX_MASK) != OFI_MR_MAP_IDX_NONE;
+}
+
+static struct fi_mr_attr *
+util_mr_map_find(struct ofi_mr_map *map, uint64_t key)
+{
+	struct fi_mr_attr *attr;
+	struct ofi_rbnode *node;
+
+	if (util_mr_map_indexed(map, key)) {
+		attr = ofi_idx_lookup(&map->key_idx,
+				      (int) (key & OFI_MR_MAP_IDX_MASK));
+		return (attr && attr->requested_key == key) ? attr : NULL;
+	}
+
+	node = ofi_rbmap_find(map->rbtree, &key);
+	return node ? node->data : NULL;
+}
+
+static int util_mr_map_insert_idx(struct ofi_mr_map *map,
+				  struct fi_mr_attr *item)
+{
+	uint64_t gen;
+	int index, ret;
+
+	index = ofi_idx_insert(&map->key_idx, item);
+	if (index > 0) {
+		item->requested_key = ((map->key++ & OFI_MR_MAP_IDX_MASK) <<
+				       OFI_MR_MAP_IDX_BITS) | (uint64_t) index;
+		return 0;
+	}
+
+	/* The indexer is full, skip generations still held by old keys */
+	for (gen = 0; gen <= OFI_MR_MAP_IDX_MASK; gen++) {
+		item->requested_key = ((map->key++ & OFI_MR_MAP_IDX_MASK) <<
+				       OFI_MR_MAP_IDX_BITS) |
+				      OFI_MR_MAP_IDX_NONE;
+		ret = ofi_rbmap_insert(map->rbtree, &item->requested_key,
+				       item, NULL);
+		if (ret != -FI_EALREADY)
+			return ret;
+	}
+	return -FI_ENOKEY;
+}
+
 int ofi_mr_map_insert(struct ofi_mr_map *map, const struct fi_mr_attr *attr,
 		      uint64_t *key, void *context, uint64_t flags)
 {
@@ -79,14 +130,18 @@ int ofi_mr_map_insert(struct ofi_mr_map *map, const struct fi_mr_attr *attr,
 	if (!(map->mode & FI_MR_VIRT_ADDR))
 		item->offset = (uintptr_t) attr->mr_iov[0].iov_base;
 
-	if (map->mode & FI_MR_PROV_KEY)
-		item->requested_key = map->key++;
-
-	ret = ofi_rbmap_insert(map->rbtree, &item->requested_key, item, NULL);
-	if (ret) {
-		if (ret == -FI_EALREADY)
-			ret = -FI_ENOKEY;
-		goto err;
+	if (map->mode & FI_MR_PROV_KEY) {
+		ret = util_mr_map_insert_idx(map, item);
+		if (ret)
+			goto err;
+	} else {
+		ret = ofi_rbmap_insert(map->rbtree, &item->requested_key,
+				       item, NULL);
+		if (ret) {
+			if (ret == -FI_EALREADY)
+				ret = -FI_ENOKEY;
+			goto err;
+		}
 	}
 	*key = item->requested_key;
 	item->context = context;
@@ -100,14 +155,9 @@ err:
 void *ofi_mr_map_get(struct ofi_mr_map *map, uint64_t key)
 {
 	struct fi_mr_attr *attr;
-	struct ofi_rbnode *node;
-
-	node = ofi_rbmap_find(map->rbtree, &key);
-	if (!node)
-		return NULL;
 
-	attr = node->data;
-	return attr->context;
+	attr = util_mr_map_find(map, key);
+	return attr ? attr->context : NULL;
 }
 
 int ofi_mr_map_verify(struct ofi_mr_map *map, uintptr_t *io_addr,
@@ -115,19 +165,15 @@ int ofi_mr_map_verify(struct ofi_mr_map *map, uintptr_t *io_addr,
 		      void **context)
 {
 	struct fi_mr_attr *attr;
-	struct ofi_rbnode *node;
 	void *addr;
 
-	node = ofi_rbmap_find(map->rbtree, &key);
-	if (!node) {
+	attr = util_mr_map_find(map, key);
+	if (!attr) {
                 FI_WARN(map->prov, FI_LOG_MR,
                         "unknown key: %" PRIu64 "\n", key);
 	        return -FI_EINVAL;
         }
 
-	attr = node->data;
-	assert(attr);
-
 	if ((access & attr->access) != access) {
                 FI_WARN(map->prov, FI_LOG_MR,
                         "invalid access: permitted %s\n",
@@ -164,6 +210,16 @@ int ofi_mr_map_remove(struct ofi_mr_map *map, uint64_t key)
 	struct ofi_rbnode *node;
 	struct fi_mr_attr *attr;
 
+	if (util_mr_map_indexed(map, key)) {
+		attr = util_mr_map_find(map, key);
+		if (!attr)
+			return -FI_ENOKEY;
+
+		ofi_idx_remove(&map->key_idx, (int) (key & OFI_MR_MAP_IDX_MASK));
+		free(attr);
+		return 0;
+	}
+
 	node = ofi_rbmap_find(map->rbtree, &key);
 	if (!node)
 		return -FI_ENOKEY;
@@ -210,6 +266,7 @@ int ofi_mr_map_init(const struct fi_provider *prov, int mode,
 	}
 	map->prov = prov;
 	map->key = 1;
+	memset(&map->key_idx, 0, sizeof(map->key_idx));
 
 	return 0;
 }
@@ -217,6 +274,7 @@ int ofi_mr_map_init(const struct fi_provider *prov, int mode,
 void ofi_mr_map_close(struct ofi_mr_map *map)
 {
 	ofi_rbmap_destroy(map->rbtree);
+	ofi_idx_reset(&map->key_idx);
 }
 
 int ofi_mr_close(struct fid *fid)
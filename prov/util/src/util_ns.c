@@ -306,9 +306,12 @@ static void *util_ns_accept_handler(void *args)
 		if (conn_sock == INVALID_SOCKET)
 			break;
 
-		ret = ofi_recvall_socket(conn_sock, &cmd, cmd_len);
-		if (!ret)
-			util_ns_process_cmd(ns, &cmd, conn_sock);
+		/* Clients may issue several commands over one connection */
+		do {
+			ret = ofi_recvall_socket(conn_sock, &cmd, cmd_len);
+			if (!ret)
+				ret = util_ns_process_cmd(ns, &cmd, conn_sock);
+		} while (!ret && ns->run);
 
 		ofi_close_socket(conn_sock);
 	}
@@ -449,66 +452,82 @@ err1:
 	return ret;
 }
 
-void *ofi_ns_resolve_name(struct util_ns *ns, const char *server, void *service)
+/*
+ * Query a single service over a connection to the name server.  Returns
+ * -FI_ENOENT if the server has no mapping for the service, or -FI_ENODATA
+ * if the connection failed.
+ */
+static int util_ns_query(struct util_ns *ns, SOCKET sockfd, void *service,
+			 void *name)
 {
-	void *dest_addr = NULL, *io_buf;
-	size_t io_len = 0;
-	SOCKET sockfd;
-	ssize_t ret = 0;
+	void *io_buf;
+	size_t io_len;
+	int ret;
 	struct util_ns_cmd cmd = {
 		.version = OFI_NS_VERSION,
 		.op = OFI_UTIL_NS_QUERY
 	};
 
-	if (!ns->is_initialized)
-		return NULL;
-
-	sockfd = util_ns_connect_server(ns, server);
-	if (sockfd == INVALID_SOCKET)
-		goto err1;
-
-	io_buf = calloc(cmd_len + ns->service_len, 1);
+	io_len = cmd_len + ns->service_len + ns->name_len;
+	io_buf = calloc(io_len, 1);
 	if (!io_buf)
-		goto err2;
+		return -FI_ENOMEM;
 
 	memcpy(io_buf, &cmd, cmd_len);
-	io_len += cmd_len;
-	memcpy((void *)((char *)io_buf + io_len), service,
-	       ns->service_len);
-	io_len += ns->service_len;
+	memcpy((char *) io_buf + cmd_len, service, ns->service_len);
 
-	ret = ofi_sendall_socket(sockfd, io_buf, io_len);
-	if (ret)
-		goto err3;
+	if (ofi_sendall_socket(sockfd, io_buf, cmd_len + ns->service_len) ||
+	    ofi_recvall_socket(sockfd, &cmd, cmd_len)) {
+		ret = -FI_ENODATA;
+		goto out;
+	}
 
-	free(io_buf);
+	if (cmd.status) {
+		ret = -FI_ENOENT;
+		goto out;
+	}
 
 	io_len = ns->service_len + ns->name_len;
-	io_buf = calloc(io_len, 1);
-	if (!io_buf)
-		goto err2;
-
-	ret = ofi_recvall_socket(sockfd, &cmd, cmd_len);
-	if (ret || cmd.status)
-		goto err3;
-
-	ret = ofi_recvall_socket(sockfd, io_buf, io_len);
-	if (!ret) {
-		dest_addr = calloc(ns->name_len, 1);
-		if (!dest_addr)
-			goto err3;
-		io_len = 0;
-		memcpy(service, (char *) io_buf + io_len, ns->service_len);
-		io_len += ns->service_len;
-		memcpy(dest_addr, (char *) io_buf + io_len, ns->name_len);
+	if (ofi_recvall_socket(sockfd, io_buf, io_len)) {
+		ret = -FI_ENODATA;
+		goto out;
 	}
 
-err3:
+	memcpy(service, io_buf, ns->service_len);
+	memcpy(name, (char *) io_buf + ns->service_len, ns->name_len);
+	ret = FI_SUCCESS;
+out:
 	free(io_buf);
-err2:
+	return ret;
+}
+
+void *ofi_ns_resolve_name(struct util_ns *ns, const char *server, void *service)
+{
+	void *dest_addr;
+	SOCKET sockfd;
+
+	if (!ns->is_initialized)
+		return NULL;
+
+	dest_addr = calloc(ns->name_len, 1);
+	if (!dest_addr)
+		return NULL;
+
+	sockfd = util_ns_connect_server(ns, server);
+	if (sockfd == INVALID_SOCKET)
+		goto err;
+
+	if (util_ns_query(ns, sockfd, service, dest_addr))
+		goto err_close;
+
 	ofi_close_socket(sockfd);
-err1:
 	return dest_addr;
+
+err_close:
+	ofi_close_socket(sockfd);
+err:
+	free(dest_addr);
+	return NULL;
 }
 
 /*
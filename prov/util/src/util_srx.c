@@ -36,9 +36,22 @@
 #include "ofi_iov.h"
 #include "ofi_util.h"
 
+static void util_srx_put_pool(struct util_srx_ctx *srx);
+
 static struct util_rx_entry *util_alloc_rx_entry(struct util_srx_ctx *srx)
 {
-	return (struct util_rx_entry *) ofi_buf_alloc(srx->rx_pool);
+	struct util_rx_entry *entry;
+
+	entry = (struct util_rx_entry *) ofi_buf_alloc(srx->rx_pool);
+	if (entry)
+		entry->slab = NULL;
+	return entry;
+}
+
+static void util_free_rx_entry(struct util_rx_entry *entry)
+{
+	free(entry->slab);
+	ofi_buf_free(entry);
 }
 
 static inline struct iovec *util_srx_iov(struct util_rx_entry *rx_entry)
@@ -46,11 +59,11 @@ static inline struct iovec *util_srx_iov(struct util_rx_entry *rx_entry)
 	return (struct iovec *) ((char *) rx_entry + sizeof(*rx_entry));
 }
 
-static inline void **util_srx_desc(struct util_srx_ctx *srx,
+static inline void **util_srx_desc(size_t iov_limit,
 				   struct util_rx_entry *rx_entry)
 {
 	return (void **) ((char *) util_srx_iov(rx_entry) +
-			(sizeof(struct iovec) * srx->iov_limit));
+			(sizeof(struct iovec) * iov_limit));
 }
 
 static void util_init_rx_entry(struct util_rx_entry *entry,
@@ -112,9 +125,19 @@ static struct util_rx_entry *util_init_unexp(struct util_srx_ctx *srx,
 	return util_entry;
 }
 
+static bool util_multi_recv_done(struct util_srx_ctx *srx,
+				 struct util_rx_entry *mrecv_entry)
+{
+	return !mrecv_entry->peer_entry.size ||
+	       mrecv_entry->peer_entry.size < srx->min_multi_recv_size ||
+	       (mrecv_entry->slab &&
+		mrecv_entry->peer_entry.size < mrecv_entry->slab->slot_size);
+}
+
 static bool util_adjust_multi_recv(struct util_srx_ctx *srx,
-		struct fi_peer_rx_entry *rx_entry, size_t len)
+		struct util_rx_entry *mrecv_entry, size_t len)
 {
+	struct fi_peer_rx_entry *rx_entry = &mrecv_entry->peer_entry;
 	size_t left;
 	void *new_base;
 
@@ -125,7 +148,100 @@ static bool util_adjust_multi_recv(struct util_srx_ctx *srx,
 	rx_entry->iov[0].iov_base = new_base;
 	rx_entry->size = left;
 
-	return left < srx->min_multi_recv_size;
+	return util_multi_recv_done(srx, mrecv_entry);
+}
+
+static void util_init_mrecv_slab(struct util_srx_ctx *srx,
+				 struct util_rx_entry *mrecv_entry)
+{
+	struct util_mrecv_slab *slab;
+	struct util_rx_entry *entry;
+	size_t i, cnt, stride;
+	char *base;
+
+	if (!ofi_srx_mrecv_slot ||
+	    mrecv_entry->peer_entry.iov[0].iov_len < ofi_srx_mrecv_slot)
+		return;
+
+	cnt = mrecv_entry->peer_entry.iov[0].iov_len / ofi_srx_mrecv_slot;
+	stride = ofi_get_aligned_size(sizeof(*entry) + sizeof(struct iovec) +
+				      sizeof(void *), sizeof(void *));
+	slab = calloc(1, sizeof(*slab) + cnt * stride);
+	if (!slab) {
+		FI_INFO(&core_prov, FI_LOG_EP_CTRL,
+			"cannot allocate multi receive slab, carving buffer\n");
+		return;
+	}
+
+	base = mrecv_entry->peer_entry.iov[0].iov_base;
+	slab->base = base;
+	slab->slot_size = ofi_srx_mrecv_slot;
+	slab->slot_cnt = cnt;
+	slab->stride = stride;
+
+	for (i = 0; i < cnt; i++) {
+		entry = (struct util_rx_entry *) &slab->entries[i * stride];
+		entry->peer_entry.iov = util_srx_iov(entry);
+		entry->peer_entry.desc = util_srx_desc(1, entry);
+		entry->peer_entry.iov[0].iov_base = base + i * slab->slot_size;
+		entry->peer_entry.iov[0].iov_len = slab->slot_size;
+		entry->peer_entry.desc[0] = mrecv_entry->peer_entry.desc[0];
+		entry->peer_entry.count = 1;
+		entry->peer_entry.context = mrecv_entry->peer_entry.context;
+		entry->peer_entry.flags = mrecv_entry->peer_entry.flags &
+					  ~FI_MULTI_RECV;
+		entry->peer_entry.owner_context = mrecv_entry;
+	}
+	mrecv_entry->slab = slab;
+}
+
+/* Space used by a message of the given size, in whole slots */
+static size_t util_mrecv_slot_len(struct util_rx_entry *mrecv_entry,
+				  size_t size)
+{
+	size_t slot = mrecv_entry->slab->slot_size;
+	size_t len;
+
+	len = size ? ((size + slot - 1) / slot) * slot : slot;
+	return MIN(len, mrecv_entry->peer_entry.iov[0].iov_len);
+}
+
+static struct util_rx_entry *
+util_mrecv_slot_entry(struct util_rx_entry *mrecv_entry)
+{
+	struct util_mrecv_slab *slab = mrecv_entry->slab;
+	size_t i;
+
+	i = ((char *) mrecv_entry->peer_entry.iov[0].iov_base - slab->base) /
+	    slab->slot_size;
+	assert(i < slab->slot_cnt);
+	return (struct util_rx_entry *) &slab->entries[i * slab->stride];
+}
+
+static bool util_is_slab_entry(struct util_mrecv_slab *slab,
+			       struct util_rx_entry *entry)
+{
+	return (char *) entry >= slab->entries &&
+	       (char *) entry < slab->entries + slab->slot_cnt * slab->stride;
+}
+
+static struct util_rx_entry *util_process_mrecv_slab(struct util_srx_ctx *srx,
+		struct slist *queue, fi_addr_t addr, size_t size,
+		struct util_rx_entry *owner_entry)
+{
+	struct util_rx_entry *util_entry;
+	size_t len;
+
+	util_entry = util_mrecv_slot_entry(owner_entry);
+	len = util_mrecv_slot_len(owner_entry, size);
+	util_entry->peer_entry.iov[0].iov_len = len;
+	util_entry->peer_entry.addr = addr;
+
+	if (util_adjust_multi_recv(srx, owner_entry, len))
+		slist_remove_head(queue);
+
+	owner_entry->multi_recv_ref++;
+	return util_entry;
 }
 
 static struct util_rx_entry *util_process_multi_recv(struct util_srx_ctx *srx,
@@ -134,6 +250,10 @@ static struct util_rx_entry *util_process_multi_recv(struct util_srx_ctx *srx,
 {
 	struct util_rx_entry *util_entry;
 
+	if (owner_entry->slab)
+		return util_process_mrecv_slab(srx, queue, addr, size,
+					       owner_entry);
+
 	util_entry = util_get_recv_entry(srx,
 					 owner_entry->peer_entry.iov,
 					 owner_entry->peer_entry.desc,
@@ -146,7 +266,7 @@ static struct util_rx_entry *util_process_multi_recv(struct util_srx_ctx *srx,
 	if (!util_entry)
 		return NULL;
 
-	if (util_adjust_multi_recv(srx, &owner_entry->peer_entry, size))
+	if (util_adjust_multi_recv(srx, owner_entry, size))
 		slist_remove_head(queue);
 
 	util_entry->peer_entry.owner_context = owner_entry;
@@ -238,86 +358,110 @@ static int util_get_msg(struct fid_peer_srx *srx, fi_addr_t addr,
 	return FI_SUCCESS;
 }
 
-static int util_match_tag(struct fid_peer_srx *srx, fi_addr_t addr,
-			   uint64_t tag, struct fi_peer_rx_entry **rx_entry)
+struct util_tag_match {
+	struct slist		*queue;
+	struct slist_entry	*item;
+	struct slist_entry	*prev;
+	struct util_rx_entry	*rx_entry;
+};
+
+static inline struct slist *util_srx_tag_bucket(struct util_srx_ctx *srx,
+						fi_addr_t addr, uint64_t tag)
+{
+	return &srx->tag_buckets[ofi_tag_bucket(srx->tag_bucket_mask,
+						addr, tag)];
+}
+
+static struct slist *util_srx_trecv_queue(struct util_srx_ctx *srx,
+					  fi_addr_t addr, uint64_t tag,
+					  uint64_t ignore)
+{
+	if (srx->tag_buckets && !ignore)
+		return util_srx_tag_bucket(srx, addr, tag);
+
+	return addr == FI_ADDR_UNSPEC ? &srx->tag_queue :
+	       ofi_array_at(&srx->src_trecv_queues, addr);
+}
+
+/* Every queue is kept in posting order, so the first match in a queue is the
+ * oldest one in that queue.  Only an entry posted before the current
+ * candidate may replace it.
+ */
+static void util_search_tag_queue(struct slist *queue, fi_addr_t addr,
+				  uint64_t tag, bool exact,
+				  struct util_tag_match *match)
 {
-	struct util_srx_ctx *srx_ctx;
 	struct util_rx_entry *util_entry;
 	struct slist_entry *item, *prev;
-	int ret = FI_SUCCESS;
 
-	srx_ctx = srx->ep_fid.fid.context;
-	slist_foreach(&srx_ctx->tag_queue, item, prev) {
+	slist_foreach(queue, item, prev) {
 		util_entry = container_of(item, struct util_rx_entry,
 					  peer_entry);
-		if (ofi_match_tag(util_entry->peer_entry.tag,
-				  util_entry->ignore, tag)) {
-			util_entry->peer_entry.srx = srx;
-			srx_ctx->update_func(srx_ctx, util_entry);
-			slist_remove(&srx_ctx->tag_queue, item, prev);
-			goto out;
+		if (match->rx_entry &&
+		    util_entry->seq_no > match->rx_entry->seq_no)
+			return;
+
+		if (exact) {
+			if (util_entry->peer_entry.tag != tag ||
+			    util_entry->peer_entry.addr != addr)
+				continue;
+		} else if (!ofi_match_tag(util_entry->peer_entry.tag,
+					  util_entry->ignore, tag)) {
+			continue;
 		}
-	}
 
-	util_entry = util_init_unexp(srx_ctx, addr, 0, tag, FI_TAGGED | FI_RECV);
-	if (!util_entry)
-		return -FI_ENOMEM;
-	ret = -FI_ENOENT;
-	util_entry->peer_entry.srx = srx;
-out:
-	*rx_entry = &util_entry->peer_entry;
-	return ret;
+		match->queue = queue;
+		match->item = item;
+		match->prev = prev;
+		match->rx_entry = util_entry;
+		return;
+	}
 }
 
 static int util_get_tag(struct fid_peer_srx *srx, fi_addr_t addr,
 			uint64_t tag, struct fi_peer_rx_entry **rx_entry)
 {
 	struct util_srx_ctx *srx_ctx;
+	struct util_tag_match match = {0};
+	struct util_rx_entry *util_entry;
 	struct slist *queue;
-	struct slist_entry *any_item, *any_prev;
-	struct slist_entry *item, *prev;
-	struct util_rx_entry *util_entry, *any_entry;
-	int ret = FI_SUCCESS;
 
 	srx_ctx = srx->ep_fid.fid.context;
 	assert(ofi_genlock_held(srx_ctx->lock));
 
-	queue = addr == FI_ADDR_UNSPEC ? NULL:
-		ofi_array_at(&srx_ctx->src_trecv_queues, addr);
-
-	if (!queue || slist_empty(queue))
-		return util_match_tag(srx, addr, tag, rx_entry);
+	if (srx_ctx->dir_recv && addr != FI_ADDR_UNSPEC) {
+		if (srx_ctx->tag_buckets)
+			util_search_tag_queue(util_srx_tag_bucket(srx_ctx,
+							addr, tag),
+					      addr, tag, true, &match);
 
-	slist_foreach(queue, item, prev) {
-		util_entry = container_of(item, struct util_rx_entry,
-					  peer_entry);
-		if (ofi_match_tag(util_entry->peer_entry.tag,
-				  util_entry->ignore, tag))
-			goto check_any;
+		queue = ofi_array_at(&srx_ctx->src_trecv_queues, addr);
+		if (queue)
+			util_search_tag_queue(queue, addr, tag, false, &match);
 	}
-	return util_match_tag(srx, addr, tag, rx_entry);
-
-check_any:
-	slist_foreach(&srx_ctx->tag_queue, any_item, any_prev) {
-		any_entry = container_of(any_item, struct util_rx_entry,
-					 peer_entry);
-		if (any_entry->seq_no > util_entry->seq_no)
-			break;
-
-		if (ofi_match_tag(any_entry->peer_entry.tag, any_entry->ignore,
-				  tag)) {
-			queue = &srx_ctx->tag_queue;
-			util_entry = any_entry;
-			item = any_item;
-			prev = any_prev;
-			break;
-		}
+
+	if (srx_ctx->tag_buckets)
+		util_search_tag_queue(util_srx_tag_bucket(srx_ctx,
+						FI_ADDR_UNSPEC, tag),
+				      FI_ADDR_UNSPEC, tag, true, &match);
+	util_search_tag_queue(&srx_ctx->tag_queue, addr, tag, false, &match);
+
+	if (!match.rx_entry) {
+		util_entry = util_init_unexp(srx_ctx, addr, 0, tag,
+					     FI_TAGGED | FI_RECV);
+		if (!util_entry)
+			return -FI_ENOMEM;
+		util_entry->peer_entry.srx = srx;
+		*rx_entry = &util_entry->peer_entry;
+		return -FI_ENOENT;
 	}
+
+	util_entry = match.rx_entry;
+	slist_remove(match.queue, match.item, match.prev);
 	util_entry->peer_entry.srx = srx;
 	srx_ctx->update_func(srx_ctx, util_entry);
 	*rx_entry = &util_entry->peer_entry;
-	slist_remove(queue, item, prev);
-	return ret;
+	return FI_SUCCESS;
 }
 
 static int util_queue_msg(struct fi_peer_rx_entry *rx_entry)
@@ -371,6 +515,7 @@ static void util_free_entry(struct fi_peer_rx_entry *entry)
 {
 	struct util_srx_ctx *srx;
 	struct util_rx_entry *util_entry, *owner_entry;
+	bool slab_entry = false;
 
 	srx = (struct util_srx_ctx *) entry->srx->ep_fid.fid.context;
 	assert(ofi_genlock_held(srx->lock));
@@ -378,8 +523,10 @@ static void util_free_entry(struct fi_peer_rx_entry *entry)
 	util_entry = container_of(entry, struct util_rx_entry, peer_entry);
 	if (entry->owner_context) {
 		owner_entry = (struct util_rx_entry *) entry->owner_context;
+		slab_entry = owner_entry->slab &&
+			     util_is_slab_entry(owner_entry->slab, util_entry);
 		if (!--owner_entry->multi_recv_ref &&
-		    owner_entry->peer_entry.size < srx->min_multi_recv_size) {
+		    util_multi_recv_done(srx, owner_entry)) {
 			if (ofi_peer_cq_write(srx->cq,
 					      owner_entry->peer_entry.context,
 					      FI_MULTI_RECV, 0, NULL, 0, 0,
@@ -387,10 +534,11 @@ static void util_free_entry(struct fi_peer_rx_entry *entry)
 				FI_WARN(&core_prov, FI_LOG_EP_CTRL,
 					"cannot write MULTI_RECV completion\n");
 			}
-			ofi_buf_free(owner_entry);
+			util_free_rx_entry(owner_entry);
 		}
 	}
-	ofi_buf_free(util_entry);
+	if (!slab_entry)
+		ofi_buf_free(util_entry);
 }
 
 static void util_foreach_unspec(struct fid_peer_srx *srx,
@@ -500,6 +648,7 @@ static ssize_t util_generic_mrecv(struct util_srx_ctx *srx,
 	struct slist *queue;
 	bool buf_done = false;
 	ssize_t ret = FI_SUCCESS;
+	size_t len;
 
 	assert(flags & FI_MULTI_RECV && iov_count == 1);
 	addr = srx->dir_recv ? addr : FI_ADDR_UNSPEC;
@@ -513,6 +662,7 @@ static ssize_t util_generic_mrecv(struct util_srx_ctx *srx,
 	}
 
 	mrecv_entry->peer_entry.size = ofi_total_iov_len(iov, iov_count);
+	util_init_mrecv_slab(srx, mrecv_entry);
 
 	rx_entry = util_search_unexp_msg(srx, addr);
 	while (rx_entry) {
@@ -522,8 +672,10 @@ static ssize_t util_generic_mrecv(struct util_srx_ctx *srx,
 		mrecv_entry->multi_recv_ref++;
 		rx_entry->peer_entry.owner_context = mrecv_entry;
 
-		if (util_adjust_multi_recv(srx, &mrecv_entry->peer_entry,
-					   rx_entry->peer_entry.size))
+		len = mrecv_entry->slab ?
+		      util_mrecv_slot_len(mrecv_entry, rx_entry->peer_entry.size) :
+		      rx_entry->peer_entry.size;
+		if (util_adjust_multi_recv(srx, mrecv_entry, len))
 			buf_done = true;
 
 		srx->update_func(srx, rx_entry);
@@ -686,8 +838,7 @@ ssize_t util_srx_generic_trecv(struct fid_ep *ep_fid, const struct iovec *iov,
 	} else {
 		rx_entry = util_search_unexp_tag(srx, addr, tag, ignore, true);
 		if (!rx_entry) {
-			queue = addr == FI_ADDR_UNSPEC ? &srx->tag_queue:
-				ofi_array_at(&srx->src_trecv_queues, addr);
+			queue = util_srx_trecv_queue(srx, addr, tag, ignore);
 			assert(queue);
 			rx_entry = util_get_recv_entry(srx, iov, desc,
 						iov_count, addr, context, tag,
@@ -882,6 +1033,15 @@ static int util_cancel_entry(struct util_srx_ctx *srx, uint64_t flags,
 	struct fi_cq_err_entry err_entry = {0};
 	int ret;
 
+	/* A multi-recv buffer with messages still landing in it is
+	 * released by the last of them, which reports the FI_MULTI_RECV
+	 * completion.  That is the only completion for the buffer.
+	 */
+	if (rx_entry->multi_recv_ref) {
+		rx_entry->peer_entry.size = 0;
+		return 1;
+	}
+
 	err_entry.op_context = rx_entry->peer_entry.context;
 	err_entry.flags = flags;
 	err_entry.tag = rx_entry->peer_entry.tag;
@@ -889,7 +1049,7 @@ static int util_cancel_entry(struct util_srx_ctx *srx, uint64_t flags,
 	err_entry.prov_errno = -FI_ECANCELED;
 
 	ret = ofi_peer_cq_write_error(srx->cq, &err_entry);
-	ofi_buf_free(rx_entry);
+	util_free_rx_entry(rx_entry);
 	return ret ? ret : 1;
 }
 
@@ -919,6 +1079,7 @@ int util_srx_close(struct fid *fid)
 	struct util_unexp_peer *unexp_peer;
 	struct util_rx_entry *rx_entry;
 	struct slist_entry *entry;
+	size_t i;
 
 	srx = container_of(fid, struct util_srx_ctx, peer_srx.ep_fid.fid);
 	if (!srx)
@@ -944,6 +1105,16 @@ int util_srx_close(struct fid *fid)
 					     peer_entry));
 	}
 
+	for (i = 0; srx->tag_buckets && i <= srx->tag_bucket_mask; i++) {
+		while (!slist_empty(&srx->tag_buckets[i])) {
+			entry = slist_remove_head(&srx->tag_buckets[i]);
+			(void) util_cancel_entry(srx, FI_TAGGED | FI_RECV,
+					container_of(entry, struct util_rx_entry,
+						     peer_entry));
+		}
+	}
+	free(srx->tag_buckets);
+
 	while (!dlist_empty(&srx->unspec_unexp_msg_queue)) {
 		dlist_pop_front(&srx->unspec_unexp_msg_queue,
 				struct util_rx_entry, rx_entry, peer_entry);
@@ -987,9 +1158,9 @@ int util_srx_close(struct fid *fid)
 	ofi_array_destroy(&srx->src_unexp_peers);
 
 	ofi_atomic_dec32(&srx->cq->ref);
-	ofi_bufpool_destroy(srx->rx_pool);
 
 	ofi_genlock_unlock(srx->lock);
+	util_srx_put_pool(srx);
 	free(srx);
 
 	return FI_SUCCESS;
@@ -1038,6 +1209,7 @@ static int util_cancel_src(struct ofi_dyn_arr *arr, void *list, void *context)
 static ssize_t util_srx_cancel(fid_t ep_fid, void *context)
 {
 	struct util_srx_ctx *srx;
+	size_t i;
 
 	srx = container_of(ep_fid, struct util_srx_ctx, peer_srx.ep_fid);
 
@@ -1046,6 +1218,12 @@ static ssize_t util_srx_cancel(fid_t ep_fid, void *context)
 			     context))
 		goto out;
 
+	for (i = 0; srx->tag_buckets && i <= srx->tag_bucket_mask; i++) {
+		if (util_cancel_recv(srx, &srx->tag_buckets[i],
+				     FI_TAGGED | FI_RECV, context))
+			goto out;
+	}
+
 	if (util_cancel_recv(srx, &srx->msg_queue, FI_MSG | FI_RECV, context))
 		goto out;
 
@@ -1065,25 +1243,71 @@ static int util_srx_getopt(fid_t fid, int level, int optname,
 	struct util_srx_ctx *srx =
 		container_of(fid, struct util_srx_ctx, peer_srx.ep_fid.fid);
 
-	if ((level != FI_OPT_ENDPOINT) || (optname != FI_OPT_MIN_MULTI_RECV))
+	if (level != FI_OPT_ENDPOINT)
 		return -FI_ENOPROTOOPT;
 
-	*(size_t *)optval = srx->min_multi_recv_size;
+	switch (optname) {
+	case FI_OPT_MIN_MULTI_RECV:
+		*(size_t *)optval = srx->min_multi_recv_size;
+		break;
+	case FI_OPT_TAG_BUCKETS:
+		*(size_t *)optval = srx->tag_buckets ?
+				    srx->tag_bucket_mask + 1 : 0;
+		break;
+	default:
+		return -FI_ENOPROTOOPT;
+	}
 	*optlen = sizeof(size_t);
 
 	return FI_SUCCESS;
 }
 
+/* Buckets can only be resized while none of them hold a receive */
+static int util_srx_set_tag_buckets(struct util_srx_ctx *srx,
+				    size_t bucket_cnt)
+{
+	struct slist *buckets;
+	size_t mask;
+	int ret;
+
+	if (srx->rx_seq_no)
+		return -FI_EOPBADSTATE;
+
+	ret = ofi_tag_buckets_alloc(bucket_cnt, &buckets, &mask);
+	if (ret)
+		return ret;
+
+	free(srx->tag_buckets);
+	srx->tag_buckets = buckets;
+	srx->tag_bucket_mask = mask;
+	return FI_SUCCESS;
+}
+
 static int util_srx_setopt(fid_t fid, int level, int optname,
 		           const void *optval, size_t optlen)
 {
 	struct util_srx_ctx *srx =
 		container_of(fid, struct util_srx_ctx, peer_srx.ep_fid.fid);
+	int ret;
 
-	if ((level != FI_OPT_ENDPOINT) || (optname != FI_OPT_MIN_MULTI_RECV))
+	if (level != FI_OPT_ENDPOINT)
 		return -FI_ENOPROTOOPT;
 
-	srx->min_multi_recv_size = *(size_t *)optval;
+	switch (optname) {
+	case FI_OPT_MIN_MULTI_RECV:
+		srx->min_multi_recv_size = *(size_t *)optval;
+		break;
+	case FI_OPT_TAG_BUCKETS:
+		if (optlen != sizeof(size_t))
+			return -FI_EINVAL;
+
+		ofi_genlock_lock(srx->lock);
+		ret = util_srx_set_tag_buckets(srx, *(size_t *)optval);
+		ofi_genlock_unlock(srx->lock);
+		return ret;
+	default:
+		return -FI_ENOPROTOOPT;
+	}
 
 	return FI_SUCCESS;
 }
@@ -1106,7 +1330,109 @@ static void util_rx_entry_init(struct ofi_bufpool_region *region, void *buf)
 					region->pool->attr.context;
 
 	rx_entry->peer_entry.iov = util_srx_iov(rx_entry);
-	rx_entry->peer_entry.desc = util_srx_desc(srx, rx_entry);
+	rx_entry->peer_entry.desc = util_srx_desc(srx->iov_limit, rx_entry);
+}
+
+static void util_shared_rx_entry_init(struct ofi_bufpool_region *region,
+				      void *buf)
+{
+	struct util_rx_entry *rx_entry = (struct util_rx_entry *) buf;
+	struct util_srx_pool *pool = (struct util_srx_pool *)
+					region->pool->attr.context;
+
+	rx_entry->peer_entry.iov = util_srx_iov(rx_entry);
+	rx_entry->peer_entry.desc = util_srx_desc(pool->iov_limit, rx_entry);
+}
+
+static int util_srx_create_pool(size_t rx_size, size_t iov_limit,
+				void (*init_fn)(struct ofi_bufpool_region *region,
+						void *buf),
+				void *context, int flags,
+				struct ofi_bufpool **rx_pool)
+{
+	struct ofi_bufpool_attr pool_attr = {0};
+
+	//each entry has the iovs and descriptors stored at the end of the entry
+	//calculate how much space each entry needs based on provider iov limits
+	pool_attr.size = sizeof(struct util_rx_entry) +
+		(sizeof(struct iovec) + sizeof(void *)) * iov_limit;
+	pool_attr.alignment = 16;
+	pool_attr.chunk_cnt = rx_size,
+	pool_attr.alloc_fn = NULL;
+	pool_attr.free_fn = NULL;
+	pool_attr.init_fn = init_fn;
+	pool_attr.context = context;
+	pool_attr.flags = flags;
+	return ofi_bufpool_create_attr(&pool_attr, rx_pool);
+}
+
+/* Attach to the domain's shared receive entry pool, creating it on first
+ * use.  Contexts with a different iov limit than the pool use a private
+ * pool instead.
+ */
+static int util_srx_get_shared_pool(struct util_srx_ctx *srx,
+				    struct util_domain *domain,
+				    size_t rx_size, size_t iov_limit)
+{
+	struct util_srx_pool *pool;
+	int ret = 0;
+
+	ofi_genlock_lock(&domain->lock);
+	pool = domain->srx_pool;
+	if (pool) {
+		if (pool->iov_limit != iov_limit) {
+			ret = -FI_ENODATA;
+			goto unlock;
+		}
+		goto out;
+	}
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool) {
+		ret = -FI_ENOMEM;
+		goto unlock;
+	}
+
+	pool->iov_limit = iov_limit;
+	ret = util_srx_create_pool(rx_size, iov_limit,
+				   util_shared_rx_entry_init, pool,
+				   OFI_BUFPOOL_PERTHREAD, &pool->rx_pool);
+	if (ret) {
+		free(pool);
+		goto unlock;
+	}
+	domain->srx_pool = pool;
+out:
+	pool->ref++;
+	srx->shared_pool = pool;
+	srx->rx_pool = pool->rx_pool;
+unlock:
+	ofi_genlock_unlock(&domain->lock);
+	return ret;
+}
+
+static void util_srx_put_pool(struct util_srx_ctx *srx)
+{
+	struct util_srx_pool *pool = srx->shared_pool;
+
+	if (!pool) {
+		ofi_bufpool_destroy(srx->rx_pool);
+		return;
+	}
+
+	ofi_genlock_lock(&srx->domain->lock);
+	if (--pool->ref) {
+		pool = NULL;
+	} else {
+		assert(srx->domain->srx_pool == pool);
+		srx->domain->srx_pool = NULL;
+	}
+	ofi_genlock_unlock(&srx->domain->lock);
+
+	if (pool) {
+		ofi_bufpool_destroy(pool->rx_pool);
+		free(pool);
+	}
 }
 
 static void util_srx_init_slist(struct ofi_dyn_arr *arr, void *item)
@@ -1125,11 +1451,10 @@ static void util_srx_init_unexp_peer(struct ofi_dyn_arr *arr, void *item)
 
 int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 			size_t iov_limit, size_t default_min_multi_recv,
-			ofi_update_func_t update_func,
+			size_t tag_buckets, ofi_update_func_t update_func,
 			struct ofi_genlock *lock, struct fid_ep **rx_ep)
 {
 	struct util_srx_ctx *srx;
-	struct ofi_bufpool_attr pool_attr = {0};
 	int ret = FI_SUCCESS;
 
 	srx = calloc(1, sizeof(*srx));
@@ -1150,24 +1475,28 @@ int util_ep_srx_context(struct util_domain *domain, size_t rx_size,
 	slist_init(&srx->msg_queue);
 	slist_init(&srx->tag_queue);
 
-	//each entry has the iovs and descriptors stored at the end of the entry
-	//calculate how much space each entry needs based on provider iov limits
-	pool_attr.size = sizeof(struct util_rx_entry) +
-		(sizeof(struct iovec) + sizeof(void *)) * iov_limit;
-	pool_attr.alignment = 16;
-	pool_attr.chunk_cnt = rx_size,
-	pool_attr.alloc_fn = NULL;
-	pool_attr.free_fn = NULL;
-	pool_attr.init_fn = util_rx_entry_init;
-	pool_attr.context = srx;
-	ret = ofi_bufpool_create_attr(&pool_attr, &srx->rx_pool);
+	ret = util_srx_set_tag_buckets(srx, tag_buckets);
+	if (ret) {
+		free(srx);
+		return ret;
+	}
+
+	ret = -FI_ENODATA;
+	if (ofi_srx_shared_pool)
+		ret = util_srx_get_shared_pool(srx, domain, rx_size, iov_limit);
+	if (ret == -FI_ENODATA)
+		ret = util_srx_create_pool(rx_size, iov_limit,
+					   util_rx_entry_init, srx, 0,
+					   &srx->rx_pool);
 	if (ret) {
+		free(srx->tag_buckets);
 		free(srx);
 		return ret;
 	}
 
 	srx->min_multi_recv_size = default_min_multi_recv;
 	srx->iov_limit = iov_limit;
+	srx->domain = domain;
 	srx->dir_recv = domain->info_domain_caps & FI_DIRECTED_RECV;
 	srx->update_func = update_func;
 	srx->lock = lock;
@@ -371,6 +371,62 @@ release:
 	return ret;
 }
 
+/* About 1us on current processors, short enough to react to a burst */
+#define UTIL_WAIT_TPAUSE_CYCLES	2048
+#define UTIL_WAIT_PAUSE_CNT	64
+
+/* Track a moving average of the time between events.  Gaps are capped
+ * at twice the spin window, so that a burst following an idle period
+ * brings the average back into the window after a few events.
+ */
+static void util_wait_fd_event(struct util_wait_fd *wait)
+{
+	uint64_t now, gap;
+
+	if (!ofi_wait_spin)
+		return;
+
+	now = ofi_gettime_ns();
+	gap = MIN(now - wait->last_event, (uint64_t) ofi_wait_spin * 2000);
+	wait->event_gap = wait->event_gap - (wait->event_gap >> 2) + (gap >> 2);
+	wait->last_event = now;
+}
+
+/* Poll for events for as long as the next one is expected to arrive
+ * within the spin window.  Returns the wait_try result, with 0 meaning
+ * that nothing arrived and the caller should sleep.
+ */
+static int util_wait_fd_spin(struct util_wait_fd *wait, uint64_t endtime)
+{
+	uint64_t window, end;
+	int i, ret;
+
+	window = (uint64_t) ofi_wait_spin * 1000;
+	if (wait->event_gap > window)
+		return 0;
+
+	end = ofi_gettime_ns() + MIN(2 * wait->event_gap, window);
+	if (endtime)
+		end = MIN(end, endtime * 1000000);
+
+	while (ofi_gettime_ns() < end) {
+		if (wait->tpause) {
+			ofi_tpause(UTIL_WAIT_TPAUSE_CYCLES);
+		} else {
+			for (i = 0; i < UTIL_WAIT_PAUSE_CNT; i++)
+				ofi_pause();
+		}
+
+		ret = wait->util_wait.wait_try(&wait->util_wait);
+		if (ret)
+			return ret;
+	}
+
+	/* Nothing arrived in time, stop spinning until events speed up */
+	wait->event_gap = window * 2;
+	return 0;
+}
+
 static int util_wait_fd_run(struct fid_wait *wait_fid, int timeout)
 {
 	struct ofi_epollfds_event event;
@@ -383,17 +439,32 @@ static int util_wait_fd_run(struct fid_wait *wait_fid, int timeout)
 
 	while (1) {
 		ret = wait->util_wait.wait_try(&wait->util_wait);
-		if (ret)
+		if (ret) {
+			util_wait_fd_event(wait);
 			return ret == -FI_EAGAIN ? 0 : ret;
+		}
 
 		if (ofi_adjust_timeout(endtime, &timeout))
 			return -FI_ETIMEDOUT;
 
+		if (ofi_wait_spin && timeout) {
+			ret = util_wait_fd_spin(wait, endtime);
+			if (ret) {
+				util_wait_fd_event(wait);
+				return ret == -FI_EAGAIN ? 0 : ret;
+			}
+
+			if (ofi_adjust_timeout(endtime, &timeout))
+				return -FI_ETIMEDOUT;
+		}
+
 		ret = (wait->util_wait.wait_obj == FI_WAIT_FD) ?
 		      ofi_epoll_wait(wait->epoll_fd, &event, 1, timeout) :
 		      ofi_pollfds_wait(wait->pollfds, &event, 1, timeout);
-		if (ret > 0)
+		if (ret > 0) {
+			util_wait_fd_event(wait);
 			return FI_SUCCESS;
+		}
 
 		if (ret < 0) {
 #if ENABLE_DEBUG
@@ -560,6 +631,8 @@ int ofi_wait_fd_open(struct fid_fabric *fabric_fid, struct fi_wait_attr *attr,
 	wait->util_wait.wait_fid.ops = &util_wait_fd_ops;
 
 	dlist_init(&wait->fd_list);
+	wait->last_event = ofi_gettime_ns();
+	wait->tpause = ofi_cpu_supports(0x7, OFI_WAITPKG_REG, OFI_WAITPKG_BIT);
 
 	*waitset = &wait->util_wait.wait_fid;
 	return 0;
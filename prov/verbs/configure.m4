@@ -61,6 +61,47 @@ AC_DEFUN([FI_VERBS_CONFIGURE],[
 	AC_DEFINE_UNQUOTED([VERBS_HAVE_QUERY_EX],[$VERBS_HAVE_QUERY_EX],
 		[Whether infiniband/verbs.h has ibv_query_device_ex() support or not])
 
+	#See if we have extended completion queues
+	VERBS_HAVE_CQ_EX=0
+	AS_IF([test $verbs_ibverbs_happy -eq 1],[
+		AC_CHECK_DECL([ibv_create_cq_ex],
+			[VERBS_HAVE_CQ_EX=1],[],
+			[#include <infiniband/verbs.h>])
+		])
+	AC_DEFINE_UNQUOTED([VERBS_HAVE_CQ_EX],[$VERBS_HAVE_CQ_EX],
+		[Whether infiniband/verbs.h has ibv_create_cq_ex() support or not])
+
+	#See if we have CQ moderation
+	VERBS_HAVE_MODIFY_CQ=0
+	AS_IF([test $verbs_ibverbs_happy -eq 1],[
+		AC_CHECK_DECL([ibv_modify_cq],
+			[VERBS_HAVE_MODIFY_CQ=1],[],
+			[#include <infiniband/verbs.h>])
+		])
+	AC_DEFINE_UNQUOTED([VERBS_HAVE_MODIFY_CQ],[$VERBS_HAVE_MODIFY_CQ],
+		[Whether infiniband/verbs.h has ibv_modify_cq() support or not])
+
+	#See if we have device memory
+	VERBS_HAVE_DM=0
+	AS_IF([test $verbs_ibverbs_happy -eq 1],[
+		AC_CHECK_DECL([ibv_alloc_dm],
+			[VERBS_HAVE_DM=1],[],
+			[#include <infiniband/verbs.h>])
+		])
+	AC_DEFINE_UNQUOTED([VERBS_HAVE_DM],[$VERBS_HAVE_DM],
+		[Whether infiniband/verbs.h has ibv_alloc_dm() support or not])
+
+	#See if we have the extended QP work request API
+	VERBS_HAVE_WR_API=0
+	AS_IF([test $verbs_ibverbs_happy -eq 1 && \
+	       test $verbs_rdmacm_ex_happy -eq 1],[
+		AC_CHECK_DECL([ibv_wr_start],
+			[VERBS_HAVE_WR_API=1],[],
+			[#include <infiniband/verbs.h>])
+		])
+	AC_DEFINE_UNQUOTED([VERBS_HAVE_WR_API],[$VERBS_HAVE_WR_API],
+		[Whether infiniband/verbs.h has ibv_wr_start() support or not])
+
 	#See if we have XRC support
 	VERBS_HAVE_XRC=0
 	AS_IF([test $verbs_ibverbs_happy -eq 1 && \
@@ -34,6 +34,7 @@
 
 #include <stdint.h>
 #include <ofi_mem.h>
+#include <rdma/fi_ext.h>
 
 #include "verbs_ofi.h"
 
@@ -134,11 +135,33 @@ vrb_cq_readerr(struct fid_cq *cq_fid, struct fi_cq_err_entry *entry,
 	return ret;
 }
 
+/*
+ * Read one event from the CQ's completion channel.  A shared channel may
+ * return the event of another CQ of the domain, whose waiter is then woken
+ * through its signal.
+ */
+static int vrb_get_cq_event(struct vrb_cq *cq)
+{
+	struct ibv_cq *ev_cq;
+	struct vrb_cq *ev;
+	void *context;
+	int ret;
+
+	ret = ibv_get_cq_event(cq->channel, &ev_cq, &context);
+	if (ret)
+		return ret;
+
+	ev = context;
+	ofi_atomic_inc32(&ev->nevents);
+	if (ev != cq)
+		fd_signal_set(&ev->signal);
+	return 0;
+}
+
 static inline int
 vrb_poll_events(struct vrb_cq *_cq, int timeout)
 {
 	int ret, rc;
-	void *context;
 	struct pollfd fds[2];
 
 	fds[0].fd = _cq->channel->fd;
@@ -153,11 +176,10 @@ vrb_poll_events(struct vrb_cq *_cq, int timeout)
 		return -errno;
 
 	if (fds[0].revents & POLLIN) {
-		ret = ibv_get_cq_event(_cq->channel, &_cq->cq, &context);
+		ret = vrb_get_cq_event(_cq);
 		if (ret)
 			return ret;
 
-		ofi_atomic_inc32(&_cq->nevents);
 		rc--;
 	}
 	if (fds[1].revents & POLLIN) {
@@ -212,10 +234,45 @@ vrb_cq_sread(struct fid_cq *cq, void *buf, size_t count, const void *cond,
 	return cur ? cur : ret;
 }
 
-int vrb_poll_cq(struct vrb_cq *cq, struct ibv_wc *wc)
+/* Release the context of a polled completion and restore its wr_id */
+static void vrb_process_wc(struct vrb_cq *cq, struct ibv_wc *wc)
 {
 	struct vrb_context *ctx;
 	struct vrb_ep *ep;
+
+	ctx = (struct vrb_context *) (uintptr_t) wc->wr_id;
+	wc->wr_id = (uintptr_t) ctx->user_ctx;
+	if (wc->status != IBV_WC_SUCCESS && wc->status != IBV_WC_WR_FLUSH_ERR)
+		vrb_shutdown_ep(ctx->ep);
+	if (ctx->op_queue == VRB_OP_SQ) {
+		ep = ctx->ep;
+		assert(ep);
+		assert(!slist_empty(&ep->sq_list));
+		assert(ep->sq_list.head == &ctx->entry);
+		(void) slist_remove_head(&ep->sq_list);
+		ep->sq_credits++;
+
+		/* workaround incorrect opcode reported by verbs */
+		wc->opcode = vrb_wr2wc_opcode(ctx->sq_opcode);
+
+	} else if (ctx->op_queue == VRB_OP_RQ) {
+		ep = ctx->ep;
+		assert(ep);
+		assert(!slist_empty(&ep->rq_list));
+		assert(ep->rq_list.head == &ctx->entry);
+		(void) slist_remove_head(&ep->rq_list);
+		if (wc->status)
+			wc->opcode = IBV_WC_RECV;
+	} else {
+		assert(ctx->op_queue == VRB_OP_SRQ);
+		wc->opcode = IBV_WC_RECV;
+	}
+
+	vrb_free_ctx(vrb_cq2_progress(cq), ctx);
+}
+
+int vrb_poll_cq(struct vrb_cq *cq, struct ibv_wc *wc)
+{
 	int ret;
 
 	assert(ofi_genlock_held(vrb_cq2_progress(cq)->active_lock));
@@ -224,40 +281,58 @@ int vrb_poll_cq(struct vrb_cq *cq, struct ibv_wc *wc)
 		if (ret <= 0)
 			break;
 
-		ctx = (struct vrb_context *) (uintptr_t) wc->wr_id;
-		wc->wr_id = (uintptr_t) ctx->user_ctx;
-		if (wc->status != IBV_WC_SUCCESS && wc->status != IBV_WC_WR_FLUSH_ERR)
-			vrb_shutdown_ep(ctx->ep);
-		if (ctx->op_queue == VRB_OP_SQ) {
-			ep = ctx->ep;
-			assert(ep);
-			assert(!slist_empty(&ep->sq_list));
-			assert(ep->sq_list.head == &ctx->entry);
-			(void) slist_remove_head(&ep->sq_list);
-			ep->sq_credits++;
-
-			/* workaround incorrect opcode reported by verbs */
-			wc->opcode = vrb_wr2wc_opcode(ctx->sq_opcode);
-
-		} else if (ctx->op_queue == VRB_OP_RQ) {
-			ep = ctx->ep;
-			assert(ep);
-			assert(!slist_empty(&ep->rq_list));
-			assert(ep->rq_list.head == &ctx->entry);
-			(void) slist_remove_head(&ep->rq_list);
-			if (wc->status)
-				wc->opcode = IBV_WC_RECV;
-		} else {
-			assert(ctx->op_queue == VRB_OP_SRQ);
-			wc->opcode = IBV_WC_RECV;
-		}
-
-		vrb_free_ctx(vrb_cq2_progress(cq), ctx);
+		vrb_process_wc(cq, wc);
 	} while (wc->wr_id == VERBS_NO_COMP_FLAG);
 
 	return ret;
 }
 
+#if VERBS_HAVE_CQ_EX
+/*
+ * Read the fields of the current completion that vrb_process_wc() and
+ * vrb_report_wc() use.  Send opcodes come from the context, so only
+ * successful receives read the opcode, length and immediate data.
+ */
+static void vrb_read_wc_ex(struct ibv_cq_ex *cq_ex, struct ibv_wc *wc)
+{
+	struct vrb_context *ctx;
+
+	wc->wr_id = cq_ex->wr_id;
+	wc->status = cq_ex->status;
+	ctx = (struct vrb_context *) (uintptr_t) wc->wr_id;
+	if (wc->status || ctx->op_queue == VRB_OP_SQ) {
+		wc->byte_len = 0;
+		wc->wc_flags = 0;
+		return;
+	}
+
+	wc->opcode = ibv_wc_read_opcode(cq_ex);
+	wc->byte_len = ibv_wc_read_byte_len(cq_ex);
+	wc->wc_flags = ibv_wc_read_wc_flags(cq_ex);
+	if (wc->wc_flags & IBV_WC_WITH_IMM)
+		wc->imm_data = ibv_wc_read_imm_data(cq_ex);
+}
+
+/* Drain the CQ in one polling session, without building a full ibv_wc */
+static void vrb_flush_cq_ex(struct vrb_cq *cq)
+{
+	struct ibv_poll_cq_attr attr = { 0 };
+	struct ibv_wc wc;
+
+	if (ibv_start_poll(cq->cq_ex, &attr))
+		return;
+
+	do {
+		vrb_read_wc_ex(cq->cq_ex, &wc);
+		vrb_process_wc(cq, &wc);
+		if (wc.wr_id != VERBS_NO_COMP_FLAG)
+			vrb_report_wc(cq, &wc);
+	} while (!ibv_next_poll(cq->cq_ex));
+
+	ibv_end_poll(cq->cq_ex);
+}
+#endif
+
 void vrb_report_wc(struct vrb_cq *cq, struct ibv_wc *wc)
 {
 	struct fi_cq_err_entry err_entry;
@@ -295,6 +370,14 @@ void vrb_flush_cq(struct vrb_cq *cq)
 	ssize_t ret;
 
 	assert(ofi_genlock_held(vrb_cq2_progress(cq)->active_lock));
+	if (!dlist_empty(&vrb_cq2_progress(cq)->more_list))
+		vrb_progress_more(vrb_cq2_progress(cq));
+#if VERBS_HAVE_CQ_EX
+	if (cq->cq_ex) {
+		vrb_flush_cq_ex(cq);
+		return;
+	}
+#endif
 	while (1) {
 		ret = vrb_poll_cq(cq, &wc);
 		if (ret <= 0)
@@ -341,7 +424,6 @@ int vrb_cq_signal(struct fid_cq *cq)
 
 int vrb_cq_trywait(struct vrb_cq *cq)
 {
-	void *context;
 	int ret;
 
 	if (!cq->channel) {
@@ -350,13 +432,13 @@ int vrb_cq_trywait(struct vrb_cq *cq)
 	}
 
 	ofi_genlock_lock(vrb_cq2_progress(cq)->active_lock);
-	if (!ofi_cirque_isempty(cq->util_cq.cirq)) {
+	if (!ofi_cq_isempty(&cq->util_cq)) {
 		ret = -FI_EAGAIN;
 		goto out;
 	}
 
-	while (!ibv_get_cq_event(cq->channel, &cq->cq, &context))
-		ofi_atomic_inc32(&cq->nevents);
+	while (!vrb_get_cq_event(cq))
+		;
 
 	ret = ibv_req_notify_cq(cq->cq, 0);
 	if (ret) {
@@ -367,7 +449,7 @@ int vrb_cq_trywait(struct vrb_cq *cq)
 
 	/* Fetch any completions that we might have missed while rearming */
 	vrb_flush_cq(cq);
-	ret = ofi_cirque_isempty(cq->util_cq.cirq) ? FI_SUCCESS : -FI_EAGAIN;
+	ret = ofi_cq_isempty(&cq->util_cq) ? FI_SUCCESS : -FI_EAGAIN;
 
 out:
 	ofi_genlock_unlock(vrb_cq2_progress(cq)->active_lock);
@@ -385,6 +467,30 @@ static struct fi_ops_cq vrb_cq_ops = {
 	.strerror = vrb_cq_strerror
 };
 
+static int vrb_cq_moderate(struct vrb_cq *cq,
+			   struct fi_verbs_cq_moderate *moderate)
+{
+#if VERBS_HAVE_MODIFY_CQ
+	struct ibv_modify_cq_attr attr = {
+		.attr_mask = IBV_CQ_ATTR_MODERATE,
+		.moderate = {
+			.cq_count = moderate->count,
+			.cq_period = moderate->period,
+		},
+	};
+	int ret;
+
+	ret = ibv_modify_cq(cq->cq, &attr);
+	if (ret) {
+		VRB_WARN_ERR(FI_LOG_CQ, "ibv_modify_cq", ret);
+		return (ret == EOPNOTSUPP) ? -FI_ENOSYS : -ret;
+	}
+	return 0;
+#else
+	return -FI_ENOSYS;
+#endif
+}
+
 static int vrb_cq_control(fid_t fid, int command, void *arg)
 {
 	struct fi_wait_pollfd *pollfd;
@@ -418,6 +524,9 @@ static int vrb_cq_control(fid_t fid, int command, void *arg)
 		*(enum fi_wait_obj *) arg = cq->wait_obj;
 		ret = 0;
 		break;
+	case FI_VERBS_CQ_MODERATE:
+		ret = vrb_cq_moderate(cq, arg);
+		break;
 	default:
 		ret = -FI_ENOSYS;
 		break;
@@ -429,6 +538,7 @@ static int vrb_cq_control(fid_t fid, int command, void *arg)
 static int vrb_cq_close(fid_t fid)
 {
 	struct vrb_cq *cq = container_of(fid, struct vrb_cq, util_cq.cq_fid);
+	struct vrb_domain *domain;
 	struct vrb_srx *srx;
 	struct dlist_entry *srx_temp;
 	int ret;
@@ -461,7 +571,9 @@ static int vrb_cq_close(fid_t fid)
 
 	ofi_cq_cleanup(&cq->util_cq);
 
-	if (cq->channel)
+	domain = container_of(cq->util_cq.domain, struct vrb_domain,
+			      util_domain);
+	if (cq->channel && cq->channel != domain->comp_channel)
 		ibv_destroy_comp_channel(cq->channel);
 
 	free(cq);
@@ -484,6 +596,65 @@ static void vrb_cq_progress(struct util_cq *util_cq)
 	vrb_flush_cq(cq);
 }
 
+static struct ibv_cq *
+vrb_create_ibv_cq(struct vrb_domain *domain, struct vrb_cq *cq, size_t size,
+		  int comp_vector)
+{
+#if VERBS_HAVE_CQ_EX
+	struct ibv_cq_init_attr_ex attr = {
+		.cqe = size,
+		.cq_context = cq,
+		.channel = cq->channel,
+		.comp_vector = comp_vector,
+		.wc_flags = IBV_WC_EX_WITH_BYTE_LEN | IBV_WC_EX_WITH_IMM,
+	};
+
+	/* Devices without extended CQs fall back to ibv_poll_cq() */
+	cq->cq_ex = ibv_create_cq_ex(domain->verbs, &attr);
+	if (cq->cq_ex)
+		return ibv_cq_ex_to_cq(cq->cq_ex);
+#endif
+	return ibv_create_cq(domain->verbs, size, cq, cq->channel,
+			     comp_vector);
+}
+
+static struct ibv_comp_channel *vrb_create_channel(struct vrb_domain *domain)
+{
+	struct ibv_comp_channel *channel;
+	int ret;
+
+	channel = ibv_create_comp_channel(domain->verbs);
+	if (!channel)
+		return NULL;
+
+	ret = fi_fd_nonblock(channel->fd);
+	if (ret) {
+		ibv_destroy_comp_channel(channel);
+		errno = -ret;
+		return NULL;
+	}
+	return channel;
+}
+
+/* With FI_VERBS_SHARED_COMP_CHANNEL, the first CQ opened with a wait
+ * object creates the domain's channel, which lives until the domain is
+ * closed.
+ */
+static struct ibv_comp_channel *vrb_cq_get_channel(struct vrb_domain *domain)
+{
+	struct ibv_comp_channel *channel;
+
+	if (!vrb_gl_data.shared_comp_channel)
+		return vrb_create_channel(domain);
+
+	ofi_genlock_lock(&domain->util_domain.lock);
+	if (!domain->comp_channel)
+		domain->comp_channel = vrb_create_channel(domain);
+	channel = domain->comp_channel;
+	ofi_genlock_unlock(&domain->util_domain.lock);
+	return channel;
+}
+
 int vrb_cq_open(struct fid_domain *domain_fid, struct fi_cq_attr *attr,
 		   struct fid_cq **cq_fid, void *context)
 {
@@ -535,7 +706,7 @@ int vrb_cq_open(struct fid_domain *domain_fid, struct fi_cq_attr *attr,
 	}
 
 	if (cq->wait_obj != FI_WAIT_NONE) {
-		cq->channel = ibv_create_comp_channel(domain->verbs);
+		cq->channel = vrb_cq_get_channel(domain);
 		if (!cq->channel) {
 			ret = -errno;
 			VRB_WARN(FI_LOG_CQ,
@@ -543,10 +714,6 @@ int vrb_cq_open(struct fid_domain *domain_fid, struct fi_cq_attr *attr,
 			goto err2;
 		}
 
-		ret = fi_fd_nonblock(cq->channel->fd);
-		if (ret)
-			goto err3;
-
 		if (fd_signal_init(&cq->signal)) {
 			ret = -errno;
 			goto err3;
@@ -564,8 +731,7 @@ int vrb_cq_open(struct fid_domain *domain_fid, struct fi_cq_attr *attr,
 	 * Something like:
 	 * num_qp_per_cq = ibv_device_attr->max_cqe / (qp_send_wr + qp_recv_wr)
 	 */
-	cq->cq = ibv_create_cq(domain->verbs, size, cq, cq->channel,
-			       comp_vector);
+	cq->cq = vrb_create_ibv_cq(domain, cq, size, comp_vector);
 	if (!cq->cq) {
 		ret = -errno;
 		VRB_WARN(FI_LOG_CQ, "Unable to create verbs CQ\n");
@@ -598,7 +764,7 @@ int vrb_cq_open(struct fid_domain *domain_fid, struct fi_cq_attr *attr,
 err4:
 	ibv_destroy_cq(cq->cq);
 err3:
-	if (cq->channel)
+	if (cq->channel && cq->channel != domain->comp_channel)
 		ibv_destroy_comp_channel(cq->channel);
 err2:
 	ofi_cq_cleanup(&cq->util_cq);
@@ -618,6 +784,7 @@ int vrb_init_progress(struct vrb_progress *progress, struct ibv_context *verbs)
 
 	/* Active lock will be needed when adding rdm ep support */
 	progress->active_lock = &progress->ep_lock;
+	dlist_init(&progress->more_list);
 
 	ret = ofi_bufpool_create(&progress->ctx_pool, sizeof(struct fi_context),
 				 16, 0, 1024, OFI_BUFPOOL_NO_TRACK);
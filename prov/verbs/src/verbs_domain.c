@@ -34,6 +34,7 @@
 #include "config.h"
 
 #include "ofi_iov.h"
+#include <rdma/fi_ext.h>
 
 #include "verbs_ofi.h"
 #include <malloc.h>
@@ -117,6 +118,11 @@ vrb_domain_ops_open(struct fid *fid, const char *name, uint64_t flags,
 		return 0;
 	}
 
+	if (!strcasecmp(name, FI_VERBS_DOMAIN_OPS)) {
+		*ops = &vrb_ops_domain_ext;
+		return 0;
+	}
+
 	return -FI_ENOSYS;
 }
 
@@ -135,14 +141,46 @@ static int vrb_odp_flag(struct ibv_context *verbs)
 	if (ret)
 		return 0;
 
-	return attr.odp_caps.general_caps & IBV_ODP_SUPPORT ?
-	       VRB_USE_ODP : 0;
+	if (!(attr.odp_caps.general_caps & IBV_ODP_SUPPORT))
+		return 0;
+
+	return vrb_gl_data.use_implicit_odp &&
+	       (attr.odp_caps.general_caps & IBV_ODP_SUPPORT_IMPLICIT) ?
+	       VRB_USE_ODP | VRB_USE_IMPLICIT_ODP : VRB_USE_ODP;
+}
+
+/*
+ * An implicit ODP MR covers the whole address space of the process.  Pages
+ * are faulted in by the NIC on first access, which lets local host memory
+ * bypass registration and the MR cache altogether.  If the MR cannot be
+ * created, registrations fall back to explicit ODP MRs.
+ */
+static void vrb_domain_implicit_odp_init(struct vrb_domain *domain)
+{
+	if (!(domain->ext_flags & VRB_USE_IMPLICIT_ODP))
+		return;
+
+	domain->implicit_mr = ibv_reg_mr(domain->pd, NULL, SIZE_MAX,
+					 IBV_ACCESS_LOCAL_WRITE |
+					 IBV_ACCESS_ON_DEMAND);
+	if (!domain->implicit_mr) {
+		VRB_INFO(FI_LOG_DOMAIN, "Implicit ODP MR registration failed: "
+			 "%s (%d)\n", strerror(errno), errno);
+		domain->ext_flags &= ~VRB_USE_IMPLICIT_ODP;
+		return;
+	}
+
+	VRB_INFO(FI_LOG_DOMAIN, "Implicit ODP MR enabled for host memory\n");
 }
 #else
 static int vrb_odp_flag(struct ibv_context *verbs)
 {
 	return 0;
 }
+
+static void vrb_domain_implicit_odp_init(struct vrb_domain *domain)
+{
+}
 #endif /* VERBS_HAVE_QUERY_EX */
 
 
@@ -214,6 +252,20 @@ static int vrb_domain_close(fid_t fid)
 
 	ofi_mr_cache_cleanup(&domain->cache);
 
+	if (domain->comp_channel) {
+		ret = ibv_destroy_comp_channel(domain->comp_channel);
+		if (ret)
+			return -ret;
+		domain->comp_channel = NULL;
+	}
+
+	if (domain->implicit_mr) {
+		ret = ibv_dereg_mr(domain->implicit_mr);
+		if (ret)
+			return -ret;
+		domain->implicit_mr = NULL;
+	}
+
 	if (domain->pd) {
 		ret = ibv_dealloc_pd(domain->pd);
 		if (ret)
@@ -359,6 +411,7 @@ vrb_domain(struct fid_fabric *fabric, struct fi_info *info,
 	}
 
 	_domain->ext_flags |= vrb_odp_flag(_domain->verbs);
+	vrb_domain_implicit_odp_init(_domain);
 	_domain->util_domain.domain_fid.fid.fclass = FI_CLASS_DOMAIN;
 	_domain->util_domain.domain_fid.fid.context = context;
 	_domain->util_domain.domain_fid.fid.ops = &vrb_fid_ops;
@@ -424,6 +477,8 @@ vrb_domain(struct fid_fabric *fabric, struct fi_info *info,
 	return FI_SUCCESS;
 err4:
 	ofi_mr_cache_cleanup(&_domain->cache);
+	if (_domain->implicit_mr && ibv_dereg_mr(_domain->implicit_mr))
+		VRB_WARN_ERRNO(FI_LOG_DOMAIN, "ibv_dereg_mr");
 	if (ibv_dealloc_pd(_domain->pd))
 		VRB_WARN_ERRNO(FI_LOG_DOMAIN, "ibv_dealloc_pd");
 err3:
@@ -542,6 +542,9 @@ int vrb_domain_xrc_init(struct vrb_domain *domain)
 		domain->xrc.lock_release = ofi_mutex_unlock_op;
 	}
 	domain->ext_flags |= VRB_USE_XRC;
+	VRB_INFO(FI_LOG_DOMAIN, "XRC domain %s\n",
+		 domain->xrc.xrcd_fd >= 0 ? vrb_gl_data.msg.xrcd_filename :
+		 "is private to the process");
 	return FI_SUCCESS;
 
 rbmap_err:
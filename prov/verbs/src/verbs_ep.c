@@ -131,10 +131,324 @@ void vrb_shutdown_ep(struct vrb_ep *ep)
 	(void) vrb_eq_write_event(ep->eq, FI_SHUTDOWN, &entry, sizeof(entry));
 }
 
+#if VERBS_HAVE_WR_API
+static void vrb_wr_set_inline(struct ibv_qp_ex *qp_ex, struct ibv_send_wr *wr)
+{
+	struct ibv_data_buf *buf;
+	int i;
+
+	if (wr->num_sge == 1) {
+		ibv_wr_set_inline_data(qp_ex,
+				       (void *) (uintptr_t) wr->sg_list[0].addr,
+				       wr->sg_list[0].length);
+		return;
+	}
+
+	buf = alloca(sizeof(*buf) * wr->num_sge);
+	for (i = 0; i < wr->num_sge; i++) {
+		buf[i].addr = (void *) (uintptr_t) wr->sg_list[i].addr;
+		buf[i].length = wr->sg_list[i].length;
+	}
+	ibv_wr_set_inline_data_list(qp_ex, wr->num_sge, buf);
+}
+
+/* Write the WQE of a work request into an open ibv_wr_start session */
+static int vrb_wr_write(struct ibv_qp_ex *qp_ex, struct ibv_send_wr *wr)
+{
+	qp_ex->wr_id = wr->wr_id;
+	qp_ex->wr_flags = wr->send_flags;
+
+	switch (wr->opcode) {
+	case IBV_WR_SEND:
+		ibv_wr_send(qp_ex);
+		break;
+	case IBV_WR_SEND_WITH_IMM:
+		ibv_wr_send_imm(qp_ex, wr->imm_data);
+		break;
+	case IBV_WR_RDMA_WRITE:
+		ibv_wr_rdma_write(qp_ex, wr->wr.rdma.rkey,
+				  wr->wr.rdma.remote_addr);
+		break;
+	case IBV_WR_RDMA_WRITE_WITH_IMM:
+		ibv_wr_rdma_write_imm(qp_ex, wr->wr.rdma.rkey,
+				      wr->wr.rdma.remote_addr,
+				      wr->imm_data);
+		break;
+	case IBV_WR_RDMA_READ:
+		ibv_wr_rdma_read(qp_ex, wr->wr.rdma.rkey,
+				 wr->wr.rdma.remote_addr);
+		break;
+	case IBV_WR_ATOMIC_CMP_AND_SWP:
+		ibv_wr_atomic_cmp_swp(qp_ex, wr->wr.atomic.rkey,
+				      wr->wr.atomic.remote_addr,
+				      wr->wr.atomic.compare_add,
+				      wr->wr.atomic.swap);
+		break;
+	case IBV_WR_ATOMIC_FETCH_AND_ADD:
+		ibv_wr_atomic_fetch_add(qp_ex, wr->wr.atomic.rkey,
+					wr->wr.atomic.remote_addr,
+					wr->wr.atomic.compare_add);
+		break;
+	default:
+		return EINVAL;
+	}
+
+	if (wr->send_flags & IBV_SEND_INLINE)
+		vrb_wr_set_inline(qp_ex, wr);
+	else
+		ibv_wr_set_sge_list(qp_ex, wr->num_sge, wr->sg_list);
+	return 0;
+}
+
+/*
+ * Post a chain of work requests through the work request API.  The WQEs
+ * are written directly, without the driver decoding each ibv_send_wr,
+ * and the doorbell is rung once by ibv_wr_complete().
+ */
+static int vrb_post_send_ex(struct ibv_qp_ex *qp_ex, struct ibv_send_wr *wr)
+{
+	int ret;
+
+	ibv_wr_start(qp_ex);
+	for (; wr; wr = wr->next) {
+		ret = vrb_wr_write(qp_ex, wr);
+		if (ret) {
+			ibv_wr_abort(qp_ex);
+			return ret;
+		}
+	}
+
+	return ibv_wr_complete(qp_ex);
+}
+#endif
+
+static int vrb_post_wr(struct vrb_ep *ep, struct ibv_send_wr *wr)
+{
+	struct ibv_send_wr *bad_wr;
+
+#if VERBS_HAVE_WR_API
+	if (ep->ibv_qp_ex)
+		return vrb_post_send_ex(ep->ibv_qp_ex, wr);
+#endif
+	return ibv_post_send(ep->ibv_qp, wr, &bad_wr);
+}
+
+static inline struct vrb_more_wr *vrb_more_wr(struct vrb_ep *ep, size_t i)
+{
+	return (struct vrb_more_wr *) ((char *) ep->more.wrs +
+				       i * ep->more.wr_size);
+}
+
+/*
+ * Copy a work request into the batch posted with ibv_post_send().  The
+ * SGEs live on the caller's stack and inline data is only read when the
+ * request is posted, so both are copied along with the request.
+ */
+static int vrb_more_copy_wr(struct vrb_ep *ep, struct ibv_send_wr *wr)
+{
+	struct vrb_more_wr *more_wr;
+	uint8_t *data;
+	size_t len;
+	int i;
+
+	if (!ep->more.wrs) {
+		ep->more.wr_size = ofi_get_aligned_size(sizeof(*more_wr) +
+			sizeof(struct ibv_sge) * ep->info_attr.tx_iov_limit +
+			ep->info_attr.inject_size, sizeof(uint64_t));
+		ep->more.wrs = malloc(ep->more.wr_size * VRB_MAX_MORE_WRS);
+		if (!ep->more.wrs)
+			return ENOMEM;
+	}
+
+	more_wr = vrb_more_wr(ep, ep->more.count);
+	more_wr->wr = *wr;
+	more_wr->wr.sg_list = more_wr->sge;
+
+	if (wr->send_flags & IBV_SEND_INLINE) {
+		data = (uint8_t *) &more_wr->sge[ep->info_attr.tx_iov_limit];
+		for (i = 0, len = 0; i < wr->num_sge; i++) {
+			if (len + wr->sg_list[i].length >
+			    ep->info_attr.inject_size)
+				return EINVAL;
+			memcpy(data + len,
+			       (void *) (uintptr_t) wr->sg_list[i].addr,
+			       wr->sg_list[i].length);
+			len += wr->sg_list[i].length;
+		}
+		more_wr->sge[0] = vrb_init_sge(data, len, NULL);
+		more_wr->wr.num_sge = 1;
+	} else {
+		if (wr->num_sge > ep->info_attr.tx_iov_limit)
+			return EINVAL;
+		memcpy(more_wr->sge, wr->sg_list,
+		       sizeof(*wr->sg_list) * wr->num_sge);
+	}
+
+	if (ep->more.count)
+		vrb_more_wr(ep, ep->more.count - 1)->wr.next = &more_wr->wr;
+	return 0;
+}
+
+/* Add a work request and its context to the batch of the endpoint */
+static int vrb_more_add(struct vrb_ep *ep, struct ibv_send_wr *wr,
+			struct vrb_context *ctx)
+{
+	int ret;
+
+	assert(!wr->next);
+#if VERBS_HAVE_WR_API
+	if (ep->ibv_qp_ex) {
+		/* The session stays open until the batch is posted */
+		if (!ep->more.count)
+			ibv_wr_start(ep->ibv_qp_ex);
+		ret = vrb_wr_write(ep->ibv_qp_ex, wr);
+		if (ret && !ep->more.count)
+			ibv_wr_abort(ep->ibv_qp_ex);
+	} else
+#endif
+		ret = vrb_more_copy_wr(ep, wr);
+	if (ret)
+		return ret;
+
+	if (!ep->more.count++)
+		dlist_insert_tail(&ep->more.entry,
+				  &vrb_ep2_progress(ep)->more_list);
+	slist_insert_tail(&ctx->entry, &ep->more.ctx_list);
+	return 0;
+}
+
+/* Complete a batched request that could not be posted in error */
+static void vrb_more_fail(struct vrb_ep *ep, struct vrb_context *ctx)
+{
+	struct ibv_wc wc = {0};
+
+	if (ctx->sq_opcode == IBV_WR_SEND ||
+	    ctx->sq_opcode == IBV_WR_SEND_WITH_IMM ||
+	    ctx->sq_opcode == IBV_WR_RDMA_WRITE_WITH_IMM)
+		ep->peer_rq_credits++;
+	ep->sq_credits++;
+
+	wc.wr_id = (uintptr_t) ctx->user_ctx;
+	wc.status = IBV_WC_GENERAL_ERR;
+	wc.opcode = vrb_wr2wc_opcode(ctx->sq_opcode);
+	vrb_free_ctx(vrb_ep2_progress(ep), ctx);
+
+	if (wc.wr_id != VERBS_NO_COMP_FLAG && ep->util_ep.tx_cq) {
+		vrb_report_wc(container_of(ep->util_ep.tx_cq, struct vrb_cq,
+					   util_cq), &wc);
+	}
+}
+
+/*
+ * Post the batch of the endpoint with a single doorbell.  Requests that
+ * were not posted are completed in error, except for cur, whose error is
+ * returned to the caller instead.
+ */
+static int vrb_more_post(struct vrb_ep *ep, struct vrb_context *cur)
+{
+	struct ibv_send_wr *wr, *bad_wr;
+	struct slist_entry *entry;
+	struct vrb_context *ctx;
+	size_t posted;
+	int ret;
+
+	assert(ep->more.count);
+#if VERBS_HAVE_WR_API
+	if (ep->ibv_qp_ex) {
+		ret = ibv_wr_complete(ep->ibv_qp_ex);
+		posted = ret ? 0 : ep->more.count;
+	} else
+#endif
+	{
+		wr = &vrb_more_wr(ep, 0)->wr;
+		vrb_more_wr(ep, ep->more.count - 1)->wr.next = NULL;
+		bad_wr = wr;
+		ret = ibv_post_send(ep->ibv_qp, wr, &bad_wr);
+		if (ret) {
+			for (posted = 0; wr && wr != bad_wr; wr = wr->next)
+				posted++;
+			if (!wr)
+				posted = 0;
+		} else {
+			posted = ep->more.count;
+		}
+	}
+
+	while (!slist_empty(&ep->more.ctx_list)) {
+		entry = slist_remove_head(&ep->more.ctx_list);
+		ctx = container_of(entry, struct vrb_context, entry);
+		if (posted) {
+			slist_insert_tail(&ctx->entry, &ep->sq_list);
+			posted--;
+		} else if (ctx != cur) {
+			vrb_more_fail(ep, ctx);
+		}
+	}
+
+	ep->more.count = 0;
+	dlist_remove(&ep->more.entry);
+	return ret;
+}
+
+void vrb_flush_more(struct vrb_ep *ep)
+{
+	int ret;
+
+	assert(ofi_genlock_held(vrb_ep2_progress(ep)->active_lock));
+	if (!ep->more.count)
+		return;
+
+	ret = vrb_more_post(ep, NULL);
+	if (ret) {
+		VRB_WARN(FI_LOG_EP_DATA, "Post of batched sends failed - %zd\n",
+			 vrb_convert_ret(ret));
+	}
+}
+
+void vrb_progress_more(struct vrb_progress *progress)
+{
+	struct dlist_entry *tmp;
+	struct vrb_ep *ep;
+
+	assert(ofi_genlock_held(progress->active_lock));
+	dlist_foreach_container_safe(&progress->more_list, struct vrb_ep,
+				     ep, more.entry, tmp)
+		vrb_flush_more(ep);
+}
+
+/*
+ * Requests posted with FI_MORE are batched until a request without
+ * FI_MORE arrives, the batch is full, or progress runs, and the batch is
+ * then posted with a single doorbell.
+ */
+static int vrb_post_send_more(struct vrb_ep *ep, struct ibv_send_wr *wr,
+			      struct vrb_context *ctx, uint64_t flags)
+{
+	int ret;
+
+	if (ep->more.count == VRB_MAX_MORE_WRS)
+		vrb_flush_more(ep);
+
+	ret = vrb_more_add(ep, wr, ctx);
+	if (!ret)
+		return (flags & FI_MORE) ? 0 : vrb_more_post(ep, ctx);
+
+	/* Without a batch to join, post the request on its own */
+	if (!ep->more.count) {
+		ret = vrb_post_wr(ep, wr);
+		if (!ret)
+			slist_insert_tail(&ctx->entry, &ep->sq_list);
+		return ret;
+	}
+
+	if (!(flags & FI_MORE))
+		vrb_flush_more(ep);
+	return ret;
+}
+
 ssize_t vrb_post_send(struct vrb_ep *ep, struct ibv_send_wr *wr, uint64_t flags)
 {
 	struct vrb_context *ctx;
-	struct ibv_send_wr *bad_wr;
 	struct vrb_cq *cq;
 	size_t credits_to_give = 0;
 	int ret, err;
@@ -169,14 +483,19 @@ ssize_t vrb_post_send(struct vrb_ep *ep, struct ibv_send_wr *wr, uint64_t flags)
 	ctx->sq_opcode = wr->opcode;
 	wr->wr_id = (uintptr_t) ctx;
 
-	ret = ibv_post_send(ep->ibv_qp, wr, &bad_wr);
+	if ((flags & FI_MORE) || ep->more.count) {
+		ret = vrb_post_send_more(ep, wr, ctx, flags);
+	} else {
+		ret = vrb_post_wr(ep, wr);
+		if (!ret)
+			slist_insert_tail(&ctx->entry, &ep->sq_list);
+	}
 	wr->wr_id = (uintptr_t) ctx->user_ctx;
 	if (ret) {
 		VRB_WARN(FI_LOG_EP_DATA, "Post send failed - %zd\n",
 			 vrb_convert_ret(ret));
 		goto credits;
 	}
-	slist_insert_tail(&ctx->entry, &ep->sq_list);
 
 unlock:
 	ofi_genlock_unlock(&vrb_ep2_progress(ep)->ep_lock);
@@ -249,7 +568,9 @@ ssize_t vrb_send_iov(struct vrb_ep *ep, struct ibv_send_wr *wr,
 		wr->send_flags = IBV_SEND_INLINE;
 	}
 
-	if (wr->send_flags & IBV_SEND_INLINE) {
+	/* The device copies inline data from host memory as the WQE is
+	 * built, so only device buffers go through a bounce buffer. */
+	if ((wr->send_flags & IBV_SEND_INLINE) && iface != FI_HMEM_SYSTEM) {
 		bounce_buf = alloca(len);
 		ret = ofi_copy_from_hmem_iov(bounce_buf, len, iface, device,
 					     iov, count, 0);
@@ -437,6 +758,8 @@ vrb_alloc_init_ep(struct fi_info *info, struct vrb_domain *domain,
 
 	slist_init(&ep->sq_list);
 	slist_init(&ep->rq_list);
+	dlist_init(&ep->more.entry);
+	slist_init(&ep->more.ctx_list);
 	ep->util_ep.ep_fid.msg = calloc(1, sizeof(*ep->util_ep.ep_fid.msg));
 	if (!ep->util_ep.ep_fid.msg)
 		goto err3;
@@ -524,6 +847,7 @@ static int vrb_close_free_ep(struct vrb_ep *ep)
 		return ret;
 
 	vrb_free_wrs(ep);
+	free(ep->more.wrs);
 	free(ep->info_attr.src_addr);
 	free(ep->info_attr.dest_addr);
 	free(ep);
@@ -553,6 +877,11 @@ static int vrb_ep_close(fid_t fid)
 	struct vrb_ep *ep =
 		container_of(fid, struct vrb_ep, util_ep.ep_fid.fid);
 
+	/* Post any batched requests so that they are flushed with the QP */
+	ofi_genlock_lock(&vrb_ep2_progress(ep)->ep_lock);
+	vrb_flush_more(ep);
+	ofi_genlock_unlock(&vrb_ep2_progress(ep)->ep_lock);
+
 	switch (ep->util_ep.type) {
 	case FI_EP_MSG:
 		if (ep->eq) {
@@ -912,6 +1241,38 @@ void vrb_msg_ep_get_qp_attr(struct vrb_ep *ep,
 }
 
 
+/* Create the RC QP of a connected endpoint, with the work request API
+ * where the device supports it */
+static int vrb_create_rc_qp(struct vrb_ep *ep, struct ibv_qp_init_attr *attr)
+{
+	struct vrb_domain *domain = vrb_ep2_domain(ep);
+#if VERBS_HAVE_WR_API
+	struct ibv_qp_init_attr_ex attr_ex = { 0 };
+
+	memcpy(&attr_ex, attr, sizeof(*attr));
+	attr_ex.comp_mask = IBV_QP_INIT_ATTR_PD |
+			    IBV_QP_INIT_ATTR_SEND_OPS_FLAGS;
+	attr_ex.pd = domain->pd;
+	attr_ex.send_ops_flags = IBV_QP_EX_WITH_SEND |
+				 IBV_QP_EX_WITH_SEND_WITH_IMM |
+				 IBV_QP_EX_WITH_RDMA_WRITE |
+				 IBV_QP_EX_WITH_RDMA_WRITE_WITH_IMM |
+				 IBV_QP_EX_WITH_RDMA_READ;
+	if (ep->util_ep.caps & FI_ATOMIC)
+		attr_ex.send_ops_flags |= IBV_QP_EX_WITH_ATOMIC_CMP_AND_SWP |
+					  IBV_QP_EX_WITH_ATOMIC_FETCH_AND_ADD;
+
+	if (!rdma_create_qp_ex(ep->id, &attr_ex)) {
+		ep->ibv_qp_ex = ibv_qp_to_qp_ex(ep->id->qp);
+		return 0;
+	}
+
+	VRB_INFO(FI_LOG_EP_CTRL, "Unable to create QP with the work request "
+		 "API, falling back to ibv_post_send: %s\n", strerror(errno));
+#endif
+	return rdma_create_qp(ep->id, domain->pd, attr);
+}
+
 static int vrb_ep_enable(struct fid_ep *ep_fid)
 {
 	struct ibv_qp_init_attr attr = { 0 };
@@ -966,7 +1327,7 @@ static int vrb_ep_enable(struct fid_ep *ep_fid)
 			return -FI_EINVAL;
 		}
 
-		ret = rdma_create_qp(ep->id, domain->pd, &attr);
+		ret = vrb_create_rc_qp(ep, &attr);
 		if (ret) {
 			VRB_WARN_ERRNO(FI_LOG_EP_CTRL, "rdma_create_qp");
 			return -errno;
@@ -1179,6 +1540,8 @@ int vrb_open_ep(struct fid_domain *domain, struct fi_info *info,
 	ret = vrb_ep_save_info_attr(ep, info);
 	if (ret)
 		goto close_ep;
+	ep->info_attr.inline_thresh =
+		vrb_find_inline_thresh(dom->verbs, ep->info_attr.inject_size);
 
 	switch (info->ep_attr->type) {
 	case FI_EP_MSG:
@@ -50,8 +50,11 @@ struct vrb_gl_data vrb_gl_data = {
 	.def_tx_iov_limit	= 4,
 	.def_rx_iov_limit	= 4,
 	.def_inline_size	= 256,
+	.inline_thresh		= -1,
 	.min_rnr_timer		= VERBS_DEFAULT_MIN_RNR_TIMER,
 	.use_odp		= 0,
+	.use_implicit_odp	= 1,
+	.shared_comp_channel	= 0,
 	.cqread_bunch_size	= 8,
 	.iface			= NULL,
 	.gid_idx		= 0,
@@ -78,6 +81,26 @@ struct vrb_dev_preset {
 	},
 };
 
+/*
+ * Inline sends are only a win while the WQE, with its payload, still
+ * fits in the write that rings the doorbell.  Mellanox devices copy WQEs
+ * of up to 256 bytes through BlueFlame, which leaves room for 220 bytes
+ * of inline data behind the control, remote address and inline headers.
+ */
+struct vrb_inline_preset {
+	int		inline_thresh;
+	const char	*dev_name_prefix;
+} verbs_inline_presets[] = {
+	{
+		.inline_thresh = 220,
+		.dev_name_prefix = "mlx4",
+	},
+	{
+		.inline_thresh = 220,
+		.dev_name_prefix = "mlx5",
+	},
+};
+
 struct fi_provider vrb_prov = {
 	.name = VERBS_PROV_NAME,
 	.version = OFI_VERSION_DEF_PROV,
@@ -315,18 +338,39 @@ err1:
 	return ret;
 }
 
+static bool vrb_is_ip_addr(const void *addr)
+{
+	return addr && (((const struct sockaddr *) addr)->sa_family == AF_INET ||
+			((const struct sockaddr *) addr)->sa_family == AF_INET6);
+}
+
 int vrb_create_ep(struct vrb_ep *ep, enum rdma_port_space ps,
 		     struct rdma_cm_id **id)
 {
 	struct rdma_addrinfo *rai = NULL;
+	struct sockaddr *src_addr, *dst_addr;
 	int ret;
 
-	ret = vrb_get_rdma_rai(NULL, NULL, ep->info_attr.addr_format,
-				ep->info_attr.src_addr, ep->info_attr.src_addrlen,
-				ep->info_attr.dest_addr, ep->info_attr.dest_addrlen,
-				0, &rai);
-	if (ret) {
-		return ret;
+	/* IP addresses are handed to rdma_resolve_addr as they are, which
+	 * saves an rdma_getaddrinfo call, and possibly an IBACM query, for
+	 * every connection. */
+	if (ep->info_attr.addr_format != FI_SOCKADDR_IB &&
+	    vrb_is_ip_addr(ep->info_attr.dest_addr) &&
+	    (!ep->info_attr.src_addr ||
+	     vrb_is_ip_addr(ep->info_attr.src_addr))) {
+		src_addr = ep->info_attr.src_addr;
+		dst_addr = ep->info_attr.dest_addr;
+	} else {
+		ret = vrb_get_rdma_rai(NULL, NULL, ep->info_attr.addr_format,
+				       ep->info_attr.src_addr,
+				       ep->info_attr.src_addrlen,
+				       ep->info_attr.dest_addr,
+				       ep->info_attr.dest_addrlen, 0, &rai);
+		if (ret)
+			return ret;
+
+		src_addr = rai->ai_src_addr;
+		dst_addr = rai->ai_dst_addr;
 	}
 
 	if (rdma_create_id(NULL, id, NULL, ps)) {
@@ -343,23 +387,24 @@ int vrb_create_ep(struct vrb_ep *ep, enum rdma_port_space ps,
 	 * creating the QP using rdma_create_qp. It would also require a SW
 	 * receive queue to store recvs posted by app after enabling the EP.
 	 */
-	if (rdma_resolve_addr(*id, rai->ai_src_addr, rai->ai_dst_addr,
-			      VERBS_RESOLVE_TIMEOUT)) {
+	if (rdma_resolve_addr(*id, src_addr, dst_addr, VERBS_RESOLVE_TIMEOUT)) {
 		ret = -errno;
 		VRB_WARN_ERRNO(FI_LOG_EP_CTRL, "rdma_resolve_addr");
 		ofi_straddr_log(&vrb_prov, FI_LOG_WARN, FI_LOG_EP_CTRL,
-				"src addr", rai->ai_src_addr);
+				"src addr", src_addr);
 		ofi_straddr_log(&vrb_prov, FI_LOG_WARN, FI_LOG_EP_CTRL,
-				"dst addr", rai->ai_dst_addr);
+				"dst addr", dst_addr);
 		goto err2;
 	}
-	rdma_freeaddrinfo(rai);
+	if (rai)
+		rdma_freeaddrinfo(rai);
 	return 0;
 
 err2:
 	rdma_destroy_id(*id);
 err1:
-	rdma_freeaddrinfo(rai);
+	if (rai)
+		rdma_freeaddrinfo(rai);
 	return ret;
 }
 
@@ -564,6 +609,29 @@ int vrb_find_max_inline(struct ibv_pd *pd, struct ibv_context *context,
 	return rst;
 }
 
+/*
+ * Select the largest registered send that is posted inline on a device.
+ * Sends with FI_INJECT or without a descriptor are inlined up to
+ * inject_size regardless.
+ */
+size_t vrb_find_inline_thresh(struct ibv_context *context, size_t inject_size)
+{
+	const char *dev_name = ibv_get_device_name(context->device);
+	uint8_t i;
+
+	if (vrb_gl_data.inline_thresh >= 0)
+		return MIN((size_t) vrb_gl_data.inline_thresh, inject_size);
+
+	for (i = 0; i < count_of(verbs_inline_presets); i++) {
+		if (!strncmp(dev_name, verbs_inline_presets[i].dev_name_prefix,
+			     strlen(verbs_inline_presets[i].dev_name_prefix)))
+			return MIN((size_t) verbs_inline_presets[i].inline_thresh,
+				   inject_size);
+	}
+
+	return inject_size;
+}
+
 static int vrb_get_param_int(const char *param_name,
 				const char *param_str,
 				int *param_default)
@@ -656,6 +724,14 @@ int vrb_read_params(void)
 		VRB_WARN(FI_LOG_CORE, "Invalid value of inline_size\n");
 		return -FI_EINVAL;
 	}
+	if (vrb_get_param_int("inline_threshold", "Maximum size of sends "
+			      "from registered memory that are posted inline. "
+			      "Default selects a threshold for the device "
+			      "(-1)", &vrb_gl_data.inline_thresh) ||
+	    (vrb_gl_data.inline_thresh < -1)) {
+		VRB_WARN(FI_LOG_CORE, "Invalid value of inline_threshold\n");
+		return -FI_EINVAL;
+	}
 	if (vrb_get_param_int("min_rnr_timer", "Set min_rnr_timer QP "
 			      "attribute (0 - 31)",
 			      &vrb_gl_data.min_rnr_timer) ||
@@ -673,6 +749,24 @@ int vrb_read_params(void)
 		return -FI_EINVAL;
 	}
 
+	if (vrb_get_param_bool("use_implicit_odp", "Register one implicit "
+			       "on-demand paging MR covering the address "
+			       "space of the process and use it for locally "
+			       "accessed host memory, if supported.  Only "
+			       "applies when use_odp is enabled.",
+			       &vrb_gl_data.use_implicit_odp)) {
+		VRB_WARN(FI_LOG_CORE, "Invalid value of use_implicit_odp\n");
+		return -FI_EINVAL;
+	}
+
+	if (vrb_get_param_bool("shared_comp_channel", "Use one completion "
+			       "channel for all the CQs of a domain.  Blocking "
+			       "reads on many CQs then wait on a single file "
+			       "descriptor.", &vrb_gl_data.shared_comp_channel)) {
+		VRB_WARN(FI_LOG_CORE, "Invalid value of shared_comp_channel\n");
+		return -FI_EINVAL;
+	}
+
 	if (vrb_get_param_bool("prefer_xrc", "Order XRC transport fi_infos "
 			       "ahead of RC.  Default orders RC first.  This "
 			       "setting must usually be combined with setting "
@@ -683,7 +777,9 @@ int vrb_read_params(void)
 	}
 
 	if (vrb_get_param_str("xrcd_filename", "A file to "
-			      "associate with the XRC domain.",
+			      "associate with the XRC domain.  Processes "
+			      "opening the same file share the XRC domain and "
+			      "its TGT QPs.",
 			      &vrb_gl_data.msg.xrcd_filename)) {
 		VRB_WARN(FI_LOG_CORE, "Invalid value of xrcd_filename\n");
 		return -FI_EINVAL;
@@ -32,6 +32,7 @@
  */
 
 #include <ofi_util.h>
+#include <rdma/fi_ext.h>
 #include "verbs_ofi.h"
 
 static int vrb_mr_close(fid_t fid)
@@ -116,6 +117,23 @@ failover:
 }
 #endif
 
+static void vrb_mr_reg_event(struct vrb_mem_desc *md, void *context)
+{
+	if (md->domain->eq_flags & FI_REG_MR) {
+		struct fi_eq_entry entry = {
+			.fid = &md->mr_fid.fid,
+			.context = context,
+		};
+		if (md->domain->eq)
+			vrb_eq_write_event(md->domain->eq, FI_MR_COMPLETE,
+					   &entry, sizeof(entry));
+		else if (md->domain->util_domain.eq)
+			 /* This branch is taken for the verbs/DGRAM */
+			fi_eq_write(&md->domain->util_domain.eq->eq_fid,
+				    FI_MR_COMPLETE, &entry, sizeof(entry), 0);
+	}
+}
+
 static int
 vrb_mr_reg_common(struct vrb_mem_desc *md, int vrb_access, const void *base_addr,
 		  const void *buf, size_t len, void *context, enum fi_hmem_iface iface,
@@ -164,19 +182,7 @@ vrb_mr_reg_common(struct vrb_mem_desc *md, int vrb_access, const void *base_addr
 		md->lkey = md->mr->lkey;
 	}
 
-	if (md->domain->eq_flags & FI_REG_MR) {
-		struct fi_eq_entry entry = {
-			.fid = &md->mr_fid.fid,
-			.context = context,
-		};
-		if (md->domain->eq)
-			vrb_eq_write_event(md->domain->eq, FI_MR_COMPLETE,
-					   &entry, sizeof(entry));
-		else if (md->domain->util_domain.eq)
-			 /* This branch is taken for the verbs/DGRAM */
-			fi_eq_write(&md->domain->util_domain.eq->eq_fid,
-				    FI_MR_COMPLETE, &entry, sizeof(entry), 0);
-	}
+	vrb_mr_reg_event(md, context);
 	return FI_SUCCESS;
 }
 
@@ -350,6 +356,60 @@ vrb_mr_cache_reg(struct vrb_domain *domain, const void *buf, size_t len,
 	return FI_SUCCESS;
 }
 
+static int vrb_mr_implicit_close(fid_t fid)
+{
+	free(container_of(fid, struct vrb_mem_desc, mr_fid.fid));
+	return FI_SUCCESS;
+}
+
+static struct fi_ops vrb_mr_implicit_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = vrb_mr_implicit_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+/*
+ * Host memory that is only accessed locally is covered by the implicit
+ * ODP MR of the domain, so the registration only hands out its lkey.
+ * Remotely accessible memory keeps an explicit MR, so that the rkey of
+ * the whole address space is never exposed to peers.
+ */
+static inline bool
+vrb_mr_use_implicit(struct vrb_domain *domain, uint64_t access,
+		    enum fi_hmem_iface iface)
+{
+	return domain->implicit_mr && iface == FI_HMEM_SYSTEM &&
+	       !(access & (FI_REMOTE_READ | FI_REMOTE_WRITE));
+}
+
+static int
+vrb_mr_implicit_reg(struct vrb_domain *domain, const void *buf, size_t len,
+		    struct fid_mr **mr, void *context)
+{
+	struct vrb_mem_desc *md;
+
+	md = calloc(1, sizeof(*md));
+	if (OFI_UNLIKELY(!md))
+		return -FI_ENOMEM;
+
+	md->domain = domain;
+	md->mr_fid.fid.fclass = FI_CLASS_MR;
+	md->mr_fid.fid.context = context;
+	md->mr_fid.fid.ops = &vrb_mr_implicit_fi_ops;
+	md->mr_fid.mem_desc = md;
+	md->mr_fid.key = domain->implicit_mr->rkey;
+	md->lkey = domain->implicit_mr->lkey;
+	md->info.iface = FI_HMEM_SYSTEM;
+	md->info.iov.iov_base = (void *) buf;
+	md->info.iov.iov_len = len;
+
+	vrb_mr_reg_event(md, context);
+	*mr = &md->mr_fid;
+	return FI_SUCCESS;
+}
+
 static int
 vrb_mr_reg_iface(struct fid *fid, const void *buf, size_t len, uint64_t access,
 		 uint64_t offset, uint64_t requested_key, uint64_t flags,
@@ -364,6 +424,9 @@ vrb_mr_reg_iface(struct fid *fid, const void *buf, size_t len, uint64_t access,
 	domain = container_of(fid, struct vrb_domain,
 			      util_domain.domain_fid.fid);
 
+	if (vrb_mr_use_implicit(domain, access, iface))
+		return vrb_mr_implicit_reg(domain, buf, len, mr, context);
+
 	if (domain->cache.monitors[iface])
 		return vrb_mr_cache_reg(domain, buf, len, access, NULL, offset,
 					requested_key, flags, mr, context,
@@ -441,3 +504,157 @@ struct fi_ops_mr vrb_mr_ops = {
 	.regv = vrb_mr_regv,
 	.regattr = vrb_mr_regattr,
 };
+
+#if VERBS_HAVE_DM
+struct vrb_dm_desc {
+	struct vrb_mem_desc	md;
+	struct ibv_dm		*dm;
+};
+
+static int vrb_dm_close(fid_t fid)
+{
+	struct vrb_dm_desc *dm_desc =
+		container_of(fid, struct vrb_dm_desc, md.mr_fid.fid);
+	int ret;
+
+	ret = ibv_dereg_mr(dm_desc->md.mr);
+	if (ret)
+		return -ret;
+
+	ret = ibv_free_dm(dm_desc->dm);
+	if (ret)
+		VRB_WARN(FI_LOG_MR, "ibv_free_dm failed %d\n", ret);
+	free(dm_desc);
+	return -ret;
+}
+
+static struct fi_ops vrb_dm_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = vrb_dm_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+};
+
+/*
+ * Device memory is registered zero based: peers address it with offsets
+ * from 0.  It is only a target of remote RMA and atomic operations, as
+ * the host cannot dereference it for local transfers or inline sends.
+ */
+static int vrb_alloc_dm(struct fid_domain *domain_fid, size_t len,
+			uint64_t access, struct fid_mr **mr, void *context)
+{
+	struct ibv_alloc_dm_attr attr = { .length = len };
+	struct vrb_domain *domain;
+	struct vrb_dm_desc *dm_desc;
+	int ret;
+
+	if (!len || (access & ~(FI_REMOTE_READ | FI_REMOTE_WRITE)))
+		return -FI_EINVAL;
+
+	domain = container_of(domain_fid, struct vrb_domain,
+			      util_domain.domain_fid);
+
+	dm_desc = calloc(1, sizeof(*dm_desc));
+	if (!dm_desc)
+		return -FI_ENOMEM;
+
+	dm_desc->dm = ibv_alloc_dm(domain->verbs, &attr);
+	if (!dm_desc->dm) {
+		ret = -errno;
+		VRB_WARN_ERRNO(FI_LOG_MR, "ibv_alloc_dm");
+		goto err1;
+	}
+
+	dm_desc->md.mr = ibv_reg_dm_mr(domain->pd, dm_desc->dm, 0, len,
+				       vrb_mr_ofi2ibv_access(access, domain) |
+				       IBV_ACCESS_ZERO_BASED);
+	if (!dm_desc->md.mr) {
+		ret = -errno;
+		VRB_WARN_ERRNO(FI_LOG_MR, "ibv_reg_dm_mr");
+		goto err2;
+	}
+
+	dm_desc->md.domain = domain;
+	dm_desc->md.mr_fid.fid.fclass = FI_CLASS_MR;
+	dm_desc->md.mr_fid.fid.context = context;
+	dm_desc->md.mr_fid.fid.ops = &vrb_dm_fi_ops;
+	dm_desc->md.mr_fid.mem_desc = &dm_desc->md;
+	dm_desc->md.mr_fid.key = dm_desc->md.mr->rkey;
+	dm_desc->md.lkey = dm_desc->md.mr->lkey;
+	dm_desc->md.info.iface = FI_HMEM_SYSTEM;
+	dm_desc->md.info.iov.iov_len = len;
+
+	vrb_mr_reg_event(&dm_desc->md, context);
+	*mr = &dm_desc->md.mr_fid;
+	return FI_SUCCESS;
+err2:
+	(void) ibv_free_dm(dm_desc->dm);
+err1:
+	free(dm_desc);
+	return ret;
+}
+
+static struct vrb_dm_desc *vrb_mr2dm(struct fid_mr *mr, uint64_t offset,
+				     size_t len)
+{
+	struct vrb_dm_desc *dm_desc;
+
+	if (mr->fid.ops != &vrb_dm_fi_ops)
+		return NULL;
+
+	dm_desc = container_of(mr, struct vrb_dm_desc, md.mr_fid);
+	if (offset > dm_desc->md.info.iov.iov_len ||
+	    len > dm_desc->md.info.iov.iov_len - offset)
+		return NULL;
+
+	return dm_desc;
+}
+
+static int vrb_copy_to_dm(struct fid_mr *mr, uint64_t offset,
+			  const void *buf, size_t len)
+{
+	struct vrb_dm_desc *dm_desc = vrb_mr2dm(mr, offset, len);
+
+	if (!dm_desc)
+		return -FI_EINVAL;
+
+	return -ibv_memcpy_to_dm(dm_desc->dm, offset, buf, len);
+}
+
+static int vrb_copy_from_dm(struct fid_mr *mr, void *buf,
+			    uint64_t offset, size_t len)
+{
+	struct vrb_dm_desc *dm_desc = vrb_mr2dm(mr, offset, len);
+
+	if (!dm_desc)
+		return -FI_EINVAL;
+
+	return -ibv_memcpy_from_dm(buf, dm_desc->dm, offset, len);
+}
+#else /* VERBS_HAVE_DM */
+static int vrb_alloc_dm(struct fid_domain *domain_fid, size_t len,
+			uint64_t access, struct fid_mr **mr, void *context)
+{
+	return -FI_ENOSYS;
+}
+
+static int vrb_copy_to_dm(struct fid_mr *mr, uint64_t offset,
+			  const void *buf, size_t len)
+{
+	return -FI_ENOSYS;
+}
+
+static int vrb_copy_from_dm(struct fid_mr *mr, void *buf,
+			    uint64_t offset, size_t len)
+{
+	return -FI_ENOSYS;
+}
+#endif /* VERBS_HAVE_DM */
+
+struct fi_verbs_ops_domain vrb_ops_domain_ext = {
+	.size = sizeof(struct fi_verbs_ops_domain),
+	.alloc_dm = vrb_alloc_dm,
+	.copy_to_dm = vrb_copy_to_dm,
+	.copy_from_dm = vrb_copy_from_dm,
+};
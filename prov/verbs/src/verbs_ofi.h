@@ -106,7 +106,7 @@
 #define VERBS_INJECT_FLAGS(ep, len, flags, desc) \
 	(((flags) & FI_INJECT) || !(desc) || \
 	 ((((struct vrb_mem_desc *) (desc))->info.iface == FI_HMEM_SYSTEM) && \
-	  ((len) <= (ep)->info_attr.inject_size))) ? IBV_SEND_INLINE : 0
+	  ((len) <= (ep)->info_attr.inline_thresh))) ? IBV_SEND_INLINE : 0
 #define VERBS_INJECT(ep, len, desc) \
 	VERBS_INJECT_FLAGS(ep, len, (ep)->util_ep.tx_op_flags, desc)
 
@@ -157,9 +157,12 @@ extern struct vrb_gl_data {
 	int	def_tx_iov_limit;
 	int	def_rx_iov_limit;
 	int	def_inline_size;
+	int	inline_thresh;
 	int	min_rnr_timer;
 	int	cqread_bunch_size;
 	int	use_odp;
+	int	use_implicit_odp;
+	int	shared_comp_channel;
 	char	*iface;
 	int	gid_idx;
 	char	*device_name;
@@ -262,6 +265,9 @@ struct vrb_progress {
 	struct ofi_genlock	*active_lock;
 
 	struct ofi_bufpool	*ctx_pool;
+
+	/* Endpoints with send requests batched by FI_MORE */
+	struct dlist_entry	more_list;
 };
 
 int vrb_init_progress(struct vrb_progress *progress, struct ibv_context *verbs);
@@ -366,6 +372,7 @@ struct fi_ops_cm *vrb_pep_ops_cm(struct vrb_pep *pep);
 enum {
 	VRB_USE_XRC = BIT(0),
 	VRB_USE_ODP = BIT(1),
+	VRB_USE_IMPLICIT_ODP = BIT(2),
 };
 
 struct vrb_domain {
@@ -374,6 +381,8 @@ struct vrb_domain {
 	struct ibv_pd			*pd;
 
 	struct vrb_progress		progress;
+	/* Completion channel of all the domain's CQs, when shared */
+	struct ibv_comp_channel		*comp_channel;
 
 	enum fi_ep_type			ep_type;
 	struct fi_info			*info;
@@ -404,6 +413,8 @@ struct vrb_domain {
 
 	/* MR stuff */
 	struct ofi_mr_cache		cache;
+	/* ODP MR of the whole address space, for local host registrations */
+	struct ibv_mr			*implicit_mr;
 };
 
 struct vrb_cq;
@@ -419,6 +430,8 @@ struct vrb_cq {
 	struct util_cq		util_cq;
 	struct ibv_comp_channel	*channel;
 	struct ibv_cq		*cq;
+	/* Set when the device supports extended CQs; cq then refers to it */
+	struct ibv_cq_ex	*cq_ex;
 	size_t			entry_size;
 	uint64_t		flags;
 	enum fi_wait_obj	wait_obj;
@@ -448,6 +461,7 @@ struct vrb_mem_desc {
 };
 
 extern struct fi_ops_mr vrb_mr_ops;
+extern struct fi_verbs_ops_domain vrb_ops_domain_ext;
 
 int vrb_mr_cache_add_region(struct ofi_mr_cache *cache,
 			       struct ofi_mr_entry *entry);
@@ -585,6 +599,8 @@ enum vrb_ep_state {
 struct vrb_ep {
 	struct util_ep			util_ep;
 	struct ibv_qp			*ibv_qp;
+	/* Set for RC QPs created with the work request API */
+	struct ibv_qp_ex		*ibv_qp_ex;
 
 	/* Protected by send CQ lock */
 	uint64_t			sq_credits;
@@ -607,6 +623,7 @@ struct vrb_ep {
 
 	struct {
 		size_t			inject_size;
+		size_t			inline_thresh;
 		size_t                  tx_size;
 		size_t                  tx_iov_limit;
 		size_t                  rx_size;
@@ -631,6 +648,24 @@ struct vrb_ep {
 	struct vrb_cm_data_hdr		*cm_hdr;
 	void				*cm_priv_data;
 	bool				hmem_enabled;
+
+	/* Send requests batched by FI_MORE, protected by the ep lock */
+	struct {
+		struct dlist_entry	entry;
+		struct slist		ctx_list;
+		size_t			count;
+		/* Copies of the requests, unless posting with ibv_wr_* */
+		void			*wrs;
+		size_t			wr_size;
+	} more;
+};
+
+#define VRB_MAX_MORE_WRS	16
+
+struct vrb_more_wr {
+	struct ibv_send_wr		wr;
+	/* Followed by the inline data buffer */
+	struct ibv_sge			sge[];
 };
 
 
@@ -874,6 +909,7 @@ void vrb_set_rnr_timer(struct ibv_qp *qp);
 void vrb_cleanup_cq(struct vrb_ep *cur_ep);
 int vrb_find_max_inline(struct ibv_pd *pd, struct ibv_context *context,
 			   enum ibv_qp_type qp_type);
+size_t vrb_find_inline_thresh(struct ibv_context *context, size_t inject_size);
 
 struct vrb_dgram_av {
 	struct util_av util_av;
@@ -936,6 +972,8 @@ do {								\
 void vrb_shutdown_ep(struct vrb_ep *ep);
 ssize_t vrb_post_send(struct vrb_ep *ep, struct ibv_send_wr *wr, uint64_t flags);
 ssize_t vrb_post_recv(struct vrb_ep *ep, struct ibv_recv_wr *wr);
+void vrb_flush_more(struct vrb_ep *ep);
+void vrb_progress_more(struct vrb_progress *progress);
 
 static inline ssize_t
 vrb_send_buf(struct vrb_ep *ep, struct ibv_send_wr *wr,
@@ -86,6 +86,12 @@ struct ofi_common_locks common_locks = {
 
 size_t ofi_universe_size = 1024;
 int ofi_av_remove_cleanup;
+size_t ofi_srx_tag_buckets;
+int ofi_srx_shared_pool;
+int ofi_cntr_batch;
+size_t ofi_srx_mrecv_slot;
+int ofi_wait_spin;
+int ofi_cq_lockfree_write;
 char *ofi_offload_coll_prov_name = NULL;
 
 
@@ -98,29 +104,15 @@ int ofi_genlock_init(struct ofi_genlock *lock,
 	switch (lock->lock_type) {
 	case OFI_LOCK_SPINLOCK:
 		ret = ofi_spin_init(&lock->base.spinlock);
-		lock->lock = (ofi_genlock_lockop_t) ofi_spin_lock_op;
-		lock->unlock = (ofi_genlock_lockop_t) ofi_spin_unlock_op;
-		lock->held = (ofi_genlock_lockheld_t) ofi_spin_held_op;
 		break;
 	case OFI_LOCK_MUTEX:
-		ret = ofi_mutex_init(&lock->base.mutex);
-		lock->lock = (ofi_genlock_lockop_t) ofi_mutex_lock_op;
-		lock->unlock = (ofi_genlock_lockop_t) ofi_mutex_unlock_op;
-		lock->held = (ofi_genlock_lockheld_t) ofi_mutex_held_op;
-		break;
 	case OFI_LOCK_NOOP:
 		/* Use mutex for debug no-op support */
 		ret = ofi_mutex_init(&lock->base.mutex);
-		lock->lock = (ofi_genlock_lockop_t) ofi_mutex_lock_noop;
-		lock->unlock = (ofi_genlock_lockop_t) ofi_mutex_unlock_noop;
-		lock->held = (ofi_genlock_lockheld_t) ofi_mutex_held_op;
 		break;
 	case OFI_LOCK_NONE:
 		ret = 0;
 		lock->base.nolock = NULL;
-		lock->lock = (ofi_genlock_lockop_t) ofi_nolock_lock_op;
-		lock->unlock = (ofi_genlock_lockop_t) ofi_nolock_unlock_op;
-		lock->held = (ofi_genlock_lockheld_t) ofi_nolock_held_op;
 		break;
 	default:
 		ret = -FI_EINVAL;
@@ -1260,8 +1252,44 @@ int ofi_bsock_sendv(struct ofi_bsock *bsock, const struct iovec *iov,
 	return 0;
 }
 
+#define OFI_BSOCK_TAIL_IOV 8
+
+/* Large payloads are read directly into the caller's buffer.  The empty
+ * receive queue is appended to that read, so that data following the
+ * payload in the stream, typically the next message headers, is staged by
+ * the same syscall.  Prefetching through io_uring completes separately,
+ * so is left alone.
+ */
+static bool ofi_bsock_stage_tail(struct ofi_bsock *bsock, size_t cnt)
+{
+	return !bsock->sockapi->rx_uring.io_uring && bsock->rq.size &&
+	       cnt <= OFI_BSOCK_TAIL_IOV;
+}
+
+static ssize_t ofi_bsock_recv_tail(struct ofi_bsock *bsock,
+				   const struct iovec *iov, size_t cnt,
+				   size_t len)
+{
+	struct iovec tail_iov[OFI_BSOCK_TAIL_IOV + 1];
+	ssize_t ret;
+
+	assert(!ofi_bsock_readable(bsock));
+	memcpy(tail_iov, iov, sizeof(*iov) * cnt);
+	tail_iov[cnt].iov_base = &bsock->rq.data[bsock->rq.tail];
+	tail_iov[cnt].iov_len = ofi_byteq_writeable(&bsock->rq);
+
+	ret = bsock->sockapi->recvv(bsock->sockapi, bsock->sock, tail_iov,
+				    cnt + 1, MSG_NOSIGNAL, &bsock->rx_sockctx);
+	if (ret > (ssize_t) len) {
+		ofi_byteq_add(&bsock->rq, (size_t) ret - len);
+		ret = (ssize_t) len;
+	}
+	return ret;
+}
+
 int ofi_bsock_recv(struct ofi_bsock *bsock, void *buf, size_t *len)
 {
+	struct iovec iov;
 	size_t bytes, avail = 0;
 	ssize_t ret;
 
@@ -1292,8 +1320,15 @@ int ofi_bsock_recv(struct ofi_bsock *bsock, void *buf, size_t *len)
 		return 0;
 	}
 
-	ret = bsock->sockapi->recv(bsock->sockapi, bsock->sock, buf, *len,
-				   MSG_NOSIGNAL, &bsock->rx_sockctx);
+	if (ofi_bsock_stage_tail(bsock, 1)) {
+		iov.iov_base = buf;
+		iov.iov_len = *len;
+		ret = ofi_bsock_recv_tail(bsock, &iov, 1, *len);
+	} else {
+		ret = bsock->sockapi->recv(bsock->sockapi, bsock->sock, buf,
+					   *len, MSG_NOSIGNAL,
+					   &bsock->rx_sockctx);
+	}
 	if (ret > 0) {
 		*len = bytes + ret;
 		return 0;
@@ -1359,8 +1394,13 @@ int ofi_bsock_recvv(struct ofi_bsock *bsock, struct iovec *iov, size_t cnt,
 		return 0;
 	}
 
-	ret = bsock->sockapi->recvv(bsock->sockapi, bsock->sock, iov, cnt,
-				    MSG_NOSIGNAL, &bsock->rx_sockctx);
+	if (ofi_bsock_stage_tail(bsock, cnt)) {
+		ret = ofi_bsock_recv_tail(bsock, iov, cnt, *len);
+	} else {
+		ret = bsock->sockapi->recvv(bsock->sockapi, bsock->sock, iov,
+					    cnt, MSG_NOSIGNAL,
+					    &bsock->rx_sockctx);
+	}
 	if (ret > 0) {
 		*len = ret;
 		return 0;
@@ -1389,8 +1429,8 @@ void ofi_bsock_prefetch_done(struct ofi_bsock *bsock, size_t len)
 }
 
 #ifdef MSG_ZEROCOPY
-int ofi_bsock_async_done(const struct fi_provider *prov,
-			 struct ofi_bsock *bsock)
+static int ofi_bsock_read_errqueue(const struct fi_provider *prov,
+				   struct ofi_bsock *bsock)
 {
 	struct msghdr msg = {};
 	struct sock_extended_err *serr;
@@ -1401,12 +1441,9 @@ int ofi_bsock_async_done(const struct fi_provider *prov,
 
 	msg.msg_control = &ctrl;
 	msg.msg_controllen = sizeof(ctrl);
-	ret = recvmsg(bsock->sock, &msg, MSG_ERRQUEUE);
-	if (ret < 0) {
-		FI_WARN(prov, FI_LOG_EP_DATA,
-			"Error reading MSG_ERRQUEUE (%s)\n", strerror(errno));
-		return -errno;
-	}
+	ret = recvmsg(bsock->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+	if (ret < 0)
+		return -ofi_sockerr();
 
 	assert(!(msg.msg_flags & MSG_CTRUNC));
 	cmsg = CMSG_FIRSTHDR(&msg);
@@ -1424,7 +1461,11 @@ int ofi_bsock_async_done(const struct fi_provider *prov,
 		return -FI_EINVAL;
 	}
 
-	bsock->done_index = serr->ee_data;
+	/* Each notification covers sends ee_info through ee_data.  The
+	 * kernel coalesces ranges, so only the upper bound is tracked.
+	 */
+	if (ofi_val32_gt(serr->ee_data, bsock->done_index))
+		bsock->done_index = serr->ee_data;
 	if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
 		FI_WARN(prov, FI_LOG_EP_DATA,
 			"Zerocopy data was copied\n");
@@ -1435,6 +1476,27 @@ int ofi_bsock_async_done(const struct fi_provider *prov,
 	}
 	return 0;
 }
+
+/* Reap all queued zero copy completions.  POLLERR with an empty error
+ * queue indicates a socket error, which is returned to the caller.
+ */
+int ofi_bsock_async_done(const struct fi_provider *prov,
+			 struct ofi_bsock *bsock)
+{
+	int ret, cnt = 0;
+
+	while (!(ret = ofi_bsock_read_errqueue(prov, bsock)))
+		cnt++;
+
+	if (cnt && OFI_SOCK_TRY_SND_RCV_AGAIN(-ret))
+		return 0;
+
+	if (ret != -FI_EINVAL) {
+		FI_WARN(prov, FI_LOG_EP_DATA,
+			"Error reading MSG_ERRQUEUE (%s)\n", strerror(-ret));
+	}
+	return ret;
+}
 #else
 int ofi_bsock_async_done(const struct fi_provider *prov,
 			 struct ofi_bsock *bsock)
@@ -51,6 +51,7 @@
 #include "ofi_perf.h"
 #include "ofi_hmem.h"
 #include "ofi_mr.h"
+#include "ofi_atomic.h"
 #include <ofi_shm_p2p.h>
 #include <rdma/fi_ext.h>
 
@@ -83,6 +84,32 @@ int ofi_init = 0;
 extern struct ofi_common_locks common_locks;
 
 static struct ofi_filter prov_filter;
+static int nic_affinity;
+
+#define OFI_GETINFO_CACHE_MAX		32
+#define OFI_GETINFO_CACHE_KEY_LEN	8192
+
+struct ofi_getinfo_entry {
+	struct dlist_entry	entry;
+	uint32_t		version;
+	uint64_t		flags;
+	char			*node;
+	char			*service;
+	char			*hints;
+	struct fi_info		*info;
+};
+
+static struct {
+	int			enabled;
+	ofi_mutex_t		lock;
+	struct dlist_entry	list;
+	size_t			cnt;
+	size_t			hits;
+	size_t			misses;
+} getinfo_cache;
+
+static void ofi_getinfo_cache_init(void);
+static void ofi_getinfo_cache_cleanup(void);
 
 
 static struct ofi_prov *
@@ -860,17 +887,29 @@ void fi_ini(void)
 	ofi_osd_init();
 	ofi_mem_init();
 	ofi_pmem_init();
+	ofi_copy_init();
+	ofi_crc32c_init();
+	ofi_reduce_init();
 	ofi_perf_init();
 	ofi_hook_init();
 	ofi_hmem_init();
 	ofi_monitors_init();
 	ofi_shm_p2p_init();
+	ofi_getinfo_cache_init();
 
 	fi_param_define(NULL, "provider", FI_PARAM_STRING,
 			"Only use specified provider (default: all available)");
 	fi_param_get_str(NULL, "provider", &param_val);
 	ofi_create_filter(&prov_filter, param_val);
 
+	fi_param_define(NULL, "nic_affinity", FI_PARAM_BOOL,
+			"Order the fi_getinfo results of each provider by "
+			"the NUMA distance between the calling thread and "
+			"the PCI device of each NIC, closest first.  "
+			"Processes bound to different sockets then select "
+			"their local NIC by default.  (default: false)");
+	fi_param_get_bool(NULL, "nic_affinity", &nic_affinity);
+
 	fi_param_define(NULL, "fork_unsafe", FI_PARAM_BOOL,
 			"Whether use of fork() may be unsafe for some providers "
 			"(default: no). Setting this to yes could improve "
@@ -894,6 +933,58 @@ void fi_ini(void)
 			"(default: false)");
 	fi_param_get_bool(NULL, "av_remove_cleanup", &ofi_av_remove_cleanup);
 
+	fi_param_define(NULL, "srx_tag_buckets", FI_PARAM_SIZE_T,
+			"Number of hash buckets used to match fully specified "
+			"tagged receives posted to a shared receive context.  "
+			"Receives using ignore bits remain on ordered wildcard "
+			"lists.  The value is rounded up to a power of two.  "
+			"(default: 0 - linear matching)");
+	fi_param_get_size_t(NULL, "srx_tag_buckets", &ofi_srx_tag_buckets);
+
+	fi_param_define(NULL, "srx_shared_pool", FI_PARAM_BOOL,
+			"Allocate receive entries for all shared receive "
+			"contexts of a domain from a single pool.  Each "
+			"context keeps its own posted and unexpected message "
+			"queues.  This reduces the memory used when many "
+			"endpoints are opened per domain, such as one per "
+			"thread.  (default: false)");
+	fi_param_get_bool(NULL, "srx_shared_pool", &ofi_srx_shared_pool);
+
+	fi_param_define(NULL, "srx_mrecv_slot", FI_PARAM_SIZE_T,
+			"Split multi-receive buffers posted to a shared "
+			"receive context into slots of this many bytes.  "
+			"Matching a message then uses a pre-initialized "
+			"receive entry instead of allocating one.  Each "
+			"message starts on a slot boundary, so buffer space "
+			"is used in multiples of this size.  "
+			"(default: 0 - carve buffers per message)");
+	fi_param_get_size_t(NULL, "srx_mrecv_slot", &ofi_srx_mrecv_slot);
+
+	fi_param_define(NULL, "cntr_batch", FI_PARAM_BOOL,
+			"Accumulate completion counter updates in per-thread "
+			"deltas and only signal a counter's wait object when "
+			"a threshold passed to fi_cntr_wait is reached.  "
+			"Applications that wait on a counter's native wait "
+			"object or through a wait set should not enable this.  "
+			"(default: false)");
+	fi_param_get_bool(NULL, "cntr_batch", &ofi_cntr_batch);
+
+	fi_param_define(NULL, "wait_spin", FI_PARAM_INT,
+			"Maximum time in microseconds that fd based wait "
+			"objects poll for events before sleeping.  Polling "
+			"is only done while recent events arrived within "
+			"this window, so idle waiters still sleep.  Uses "
+			"tpause on processors that support it.  "
+			"(default: 0 - disabled)");
+	fi_param_get_int(NULL, "wait_spin", &ofi_wait_spin);
+
+	fi_param_define(NULL, "cq_lockfree_write", FI_PARAM_BOOL,
+			"When the domain is opened with FI_THREAD_SAFE, stage "
+			"completions written to utility CQs in a lock-free "
+			"ring instead of serializing writers on the CQ lock.  "
+			"(default: false)");
+	fi_param_get_bool(NULL, "cq_lockfree_write", &ofi_cq_lockfree_write);
+
 	fi_param_define(NULL, "offload_coll_provider", FI_PARAM_STRING,
 			"The name of a colective offload provider (default: \
 			empty - no provider)");
@@ -952,6 +1043,8 @@ FI_DESTRUCTOR(fi_fini(void))
 		ofi_free_prov(prov);
 	}
 
+	ofi_getinfo_cache_cleanup();
+	ofi_hist_fini();
 	ofi_free_filter(&prov_filter);
 	ofi_monitors_cleanup();
 	ofi_hmem_cleanup();
@@ -1085,6 +1178,90 @@ ofi_reorder_info(struct fi_info **info)
 	ofi_info_insert(info, head, tail, &match);
 }
 
+struct ofi_info_rank {
+	struct fi_info	*info;
+	size_t		run;
+	size_t		pos;
+	int		dist;
+};
+
+/* NUMA distance from the given node to the NIC, INT_MAX if unknown */
+static int ofi_info_nic_distance(const struct fi_info *info, int node)
+{
+	int nic_node, dist;
+
+	if (!info->nic || !info->nic->bus_attr ||
+	    info->nic->bus_attr->bus_type != FI_BUS_PCI)
+		return INT_MAX;
+
+	nic_node = ofi_pci_numa_node(&info->nic->bus_attr->attr.pci);
+	if (nic_node < 0)
+		return INT_MAX;
+
+	dist = ofi_numa_distance(node, nic_node);
+	if (dist < 0)
+		return nic_node == node ? 0 : INT_MAX - 1;
+	return dist;
+}
+
+static int ofi_info_rank_cmp(const void *a, const void *b)
+{
+	const struct ofi_info_rank *ra = a, *rb = b;
+
+	if (ra->run != rb->run)
+		return ra->run < rb->run ? -1 : 1;
+	if (ra->dist != rb->dist)
+		return ra->dist < rb->dist ? -1 : 1;
+	return ra->pos < rb->pos ? -1 : ra->pos > rb->pos;
+}
+
+/*
+ * Within each run of entries from the same provider, move the NICs
+ * closest to the NUMA node of the calling thread to the front.  The
+ * relative order of providers, and of equally distant NICs, is kept.
+ */
+static void ofi_sort_info_affinity(struct fi_info **info)
+{
+	struct ofi_info_rank *rank;
+	struct fi_info *cur;
+	size_t i, cnt = 0;
+	int node;
+
+	node = ofi_numa_node_self();
+	if (node < 0)
+		return;
+
+	for (cur = *info; cur; cur = cur->next)
+		cnt++;
+	if (cnt < 2)
+		return;
+
+	rank = calloc(cnt, sizeof(*rank));
+	if (!rank)
+		return;
+
+	for (i = 0, cur = *info; cur; cur = cur->next, i++) {
+		rank[i].info = cur;
+		rank[i].pos = i;
+		rank[i].dist = ofi_info_nic_distance(cur, node);
+		if (!i)
+			continue;
+
+		rank[i].run = rank[i - 1].run;
+		if (strcmp(cur->fabric_attr->prov_name,
+			   rank[i - 1].info->fabric_attr->prov_name))
+			rank[i].run++;
+	}
+
+	qsort(rank, cnt, sizeof(*rank), ofi_info_rank_cmp);
+
+	*info = rank[0].info;
+	for (i = 1; i < cnt; i++)
+		rank[i - 1].info->next = rank[i].info;
+	rank[cnt - 1].info->next = NULL;
+	free(rank);
+}
+
 /*
  * Make a dummy info object for each provider, and copy in the
  * provider name and version.  We report utility providers directly
@@ -1234,10 +1411,9 @@ static int ofi_layering_ok(const struct fi_provider *provider,
 	return !strcasecmp(provider->name, prov_name);
 }
 
-__attribute__((visibility ("default"),EXTERNALLY_VISIBLE))
-int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
-		const char *service, uint64_t flags,
-		const struct fi_info *hints, struct fi_info **info)
+static int ofi_getinfo_provs(uint32_t version, const char *node,
+			     const char *service, uint64_t flags,
+			     const struct fi_info *hints, struct fi_info **info)
 {
 	struct ofi_prov *prov;
 	struct fi_info *tail, *cur;
@@ -1246,18 +1422,6 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 	enum fi_log_level level;
 	int ret;
 
-	fi_ini();
-
-	if (FI_VERSION_LT(fi_version(), version)) {
-		FI_WARN(&core_prov, FI_LOG_CORE,
-			"Requested version is newer than library\n");
-		return -FI_ENOSYS;
-	}
-
-	if (flags == FI_PROV_ATTR_ONLY) {
-		return ofi_getprovinfo(info);
-	}
-
 	if (hints && hints->fabric_attr && hints->fabric_attr->prov_name) {
 		prov_vec = ofi_split_and_alloc(hints->fabric_attr->prov_name,
 					       ";", &count);
@@ -1339,6 +1503,248 @@ int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
 
 	return *info ? 0 : -FI_ENODATA;
 }
+
+static struct fi_info *ofi_dupinfo_list(const struct fi_info *info)
+{
+	struct fi_info *head = NULL, *tail = NULL, *dup;
+
+	for (; info; info = info->next) {
+		dup = fi_dupinfo(info);
+		if (!dup) {
+			fi_freeinfo(head);
+			return NULL;
+		}
+
+		if (!head)
+			head = dup;
+		else
+			tail->next = dup;
+		tail = dup;
+	}
+	return head;
+}
+
+/*
+ * Returns an allocated string describing the hints, or NULL if the request
+ * should not be cached.  Hints that reference objects owned by the caller
+ * (an opened fid, a NIC, or an authorization key) are never cached.
+ */
+static char *ofi_getinfo_cache_key(uint64_t flags, const struct fi_info *hints)
+{
+	char *key;
+
+	if (flags & (OFI_CORE_PROV_ONLY | OFI_GETINFO_INTERNAL |
+		     OFI_GETINFO_HIDDEN | OFI_OFFLOAD_PROV_ONLY))
+		return NULL;
+
+	if (!hints)
+		return strdup("");
+
+	if (hints->handle || hints->nic ||
+	    (hints->ep_attr && hints->ep_attr->auth_key) ||
+	    (hints->domain_attr && hints->domain_attr->auth_key))
+		return NULL;
+
+	key = malloc(OFI_GETINFO_CACHE_KEY_LEN);
+	if (!key)
+		return NULL;
+
+	fi_tostr_r(key, OFI_GETINFO_CACHE_KEY_LEN, hints, FI_TYPE_INFO);
+	if (strlen(key) >= OFI_GETINFO_CACHE_KEY_LEN - 1) {
+		/* The description may have been truncated */
+		free(key);
+		return NULL;
+	}
+	return key;
+}
+
+static void ofi_getinfo_cache_free_entry(struct ofi_getinfo_entry *entry)
+{
+	fi_freeinfo(entry->info);
+	free(entry->node);
+	free(entry->service);
+	free(entry->hints);
+	free(entry);
+}
+
+static bool ofi_getinfo_str_eq(const char *s1, const char *s2)
+{
+	return (!s1 || !s2) ? s1 == s2 : !strcmp(s1, s2);
+}
+
+static bool ofi_getinfo_cache_match(struct ofi_getinfo_entry *entry,
+				    uint32_t version, const char *node,
+				    const char *service, uint64_t flags,
+				    const char *key)
+{
+	return entry->version == version && entry->flags == flags &&
+	       ofi_getinfo_str_eq(entry->node, node) &&
+	       ofi_getinfo_str_eq(entry->service, service) &&
+	       !strcmp(entry->hints, key);
+}
+
+static int ofi_getinfo_cache_find(uint32_t version, const char *node,
+				  const char *service, uint64_t flags,
+				  const char *key, struct fi_info **info)
+{
+	struct ofi_getinfo_entry *entry;
+	int ret = -FI_ENODATA;
+
+	ofi_mutex_lock(&getinfo_cache.lock);
+	dlist_foreach_container(&getinfo_cache.list, struct ofi_getinfo_entry,
+				entry, entry) {
+		if (!ofi_getinfo_cache_match(entry, version, node, service,
+					     flags, key))
+			continue;
+
+		*info = ofi_dupinfo_list(entry->info);
+		ret = *info ? 0 : -FI_ENOMEM;
+		if (!ret) {
+			dlist_remove(&entry->entry);
+			dlist_insert_head(&entry->entry, &getinfo_cache.list);
+			getinfo_cache.hits++;
+		}
+		break;
+	}
+	ofi_mutex_unlock(&getinfo_cache.lock);
+	return ret;
+}
+
+static void ofi_getinfo_cache_insert(uint32_t version, const char *node,
+				     const char *service, uint64_t flags,
+				     char *key, const struct fi_info *info)
+{
+	struct ofi_getinfo_entry *entry, *old;
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		goto err;
+
+	entry->version = version;
+	entry->flags = flags;
+	entry->hints = key;
+	entry->node = node ? strdup(node) : NULL;
+	entry->service = service ? strdup(service) : NULL;
+	entry->info = ofi_dupinfo_list(info);
+	if ((node && !entry->node) || (service && !entry->service) ||
+	    !entry->info) {
+		ofi_getinfo_cache_free_entry(entry);
+		return;
+	}
+
+	ofi_mutex_lock(&getinfo_cache.lock);
+	/* A racing caller may have inserted the same request */
+	dlist_foreach_container(&getinfo_cache.list, struct ofi_getinfo_entry,
+				old, entry) {
+		if (ofi_getinfo_cache_match(old, version, node, service,
+					    flags, key)) {
+			ofi_mutex_unlock(&getinfo_cache.lock);
+			ofi_getinfo_cache_free_entry(entry);
+			return;
+		}
+	}
+
+	dlist_insert_head(&entry->entry, &getinfo_cache.list);
+	if (++getinfo_cache.cnt > OFI_GETINFO_CACHE_MAX) {
+		old = container_of(getinfo_cache.list.prev,
+				   struct ofi_getinfo_entry, entry);
+		dlist_remove(&old->entry);
+		getinfo_cache.cnt--;
+	} else {
+		old = NULL;
+	}
+	getinfo_cache.misses++;
+	ofi_mutex_unlock(&getinfo_cache.lock);
+
+	if (old)
+		ofi_getinfo_cache_free_entry(old);
+	return;
+err:
+	free(key);
+}
+
+static void ofi_getinfo_cache_init(void)
+{
+	fi_param_define(NULL, "getinfo_cache", FI_PARAM_BOOL,
+			"Cache the results of fi_getinfo calls in the process "
+			"and return copies of them to later calls that pass "
+			"identical arguments.  Hints that reference a fid, "
+			"NIC, or authorization key are not cached.  Changes "
+			"to the system made after the first call will not be "
+			"reported.  (default: false)");
+	fi_param_get_bool(NULL, "getinfo_cache", &getinfo_cache.enabled);
+
+	dlist_init(&getinfo_cache.list);
+	ofi_mutex_init(&getinfo_cache.lock);
+}
+
+static void ofi_getinfo_cache_cleanup(void)
+{
+	struct ofi_getinfo_entry *entry;
+
+	if (getinfo_cache.enabled)
+		FI_INFO(&core_prov, FI_LOG_CORE,
+			"fi_getinfo cache hits %zu misses %zu\n",
+			getinfo_cache.hits, getinfo_cache.misses);
+
+	while (!dlist_empty(&getinfo_cache.list)) {
+		dlist_pop_front(&getinfo_cache.list, struct ofi_getinfo_entry,
+				entry, entry);
+		ofi_getinfo_cache_free_entry(entry);
+	}
+	getinfo_cache.cnt = 0;
+	ofi_mutex_destroy(&getinfo_cache.lock);
+}
+
+__attribute__((visibility ("default"),EXTERNALLY_VISIBLE))
+int DEFAULT_SYMVER_PRE(fi_getinfo)(uint32_t version, const char *node,
+		const char *service, uint64_t flags,
+		const struct fi_info *hints, struct fi_info **info)
+{
+	char *key = NULL;
+	int ret;
+
+	fi_ini();
+
+	if (FI_VERSION_LT(fi_version(), version)) {
+		FI_WARN(&core_prov, FI_LOG_CORE,
+			"Requested version is newer than library\n");
+		return -FI_ENOSYS;
+	}
+
+	if (flags == FI_PROV_ATTR_ONLY) {
+		return ofi_getprovinfo(info);
+	}
+
+	if (getinfo_cache.enabled) {
+		key = ofi_getinfo_cache_key(flags, hints);
+		if (key && !ofi_getinfo_cache_find(version, node, service,
+						   flags, key, info)) {
+			free(key);
+			goto out;
+		}
+	}
+
+	/* The cache lock is not held here, providers may call fi_getinfo */
+	ret = ofi_getinfo_provs(version, node, service, flags, hints, info);
+	if (key) {
+		if (!ret)
+			ofi_getinfo_cache_insert(version, node, service, flags,
+						 key, *info);
+		else
+			free(key);
+	}
+	if (ret)
+		return ret;
+
+out:
+	/* Sorted per call, since the closest NIC depends on the caller */
+	if (nic_affinity && !(flags & (OFI_CORE_PROV_ONLY |
+				       OFI_GETINFO_INTERNAL |
+				       OFI_GETINFO_HIDDEN)))
+		ofi_sort_info_affinity(info);
+	return 0;
+}
 CURRENT_SYMVER(fi_getinfo_, fi_getinfo);
 
 struct fi_info *ofi_allocinfo_internal(void)
@@ -1543,6 +1949,9 @@ int DEFAULT_SYMVER_PRE(fi_open)(uint32_t version, const char *name,
 	if (!strcasecmp("logging", name))
 		return ofi_open_log(version, attr, attr_len,
 				    flags, fid, context);
+	if (!strcasecmp("perf_hist", name))
+		return ofi_open_perf_hist(version, attr, attr_len,
+					  flags, fid, context);
 
 	return -FI_ENOSYS;
 }
@@ -37,6 +37,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <stdarg.h>
 #include <inttypes.h>
@@ -1082,6 +1083,267 @@ char *DEFAULT_SYMVER_PRE(fi_tostr_r)(char *buf, size_t len,
 }
 DEFAULT_SYMVER(fi_tostr_r_, fi_tostr_r, FABRIC_1.4);
 
+/* Compact JSON output is produced by rewriting the YAML above within the
+ * caller's buffer.  The YAML is moved to the tail of the buffer and
+ * consumed line by line while the JSON is written from the front.  Output
+ * is truncated if it would overwrite text that has not been read yet.
+ */
+#define OFI_JSON_MAX_DEPTH 16
+
+struct ofi_json_writer {
+	char *pos;
+	char *limit;
+	bool truncated;
+};
+
+static void ofi_json_putc(struct ofi_json_writer *w, char c)
+{
+	if (w->truncated || w->pos >= w->limit) {
+		w->truncated = true;
+		return;
+	}
+	*w->pos++ = c;
+}
+
+static void
+ofi_json_puts(struct ofi_json_writer *w, const char *str, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		ofi_json_putc(w, str[i]);
+}
+
+static void
+ofi_json_putstr(struct ofi_json_writer *w, const char *str, size_t len)
+{
+	size_t i;
+
+	ofi_json_putc(w, '"');
+	for (i = 0; i < len; i++) {
+		if (str[i] == '"' || str[i] == '\\')
+			ofi_json_putc(w, '\\');
+		if ((unsigned char) str[i] >= ' ')
+			ofi_json_putc(w, str[i]);
+	}
+	ofi_json_putc(w, '"');
+}
+
+static bool ofi_json_is_number(const char *str, size_t len)
+{
+	size_t i = 0;
+
+	if (len && str[0] == '-')
+		i++;
+	if (i == len)
+		return false;
+	for (; i < len; i++) {
+		if (!isdigit((unsigned char) str[i]))
+			return false;
+	}
+	return true;
+}
+
+static size_t ofi_json_trim(const char **str, size_t len)
+{
+	while (len && isspace((unsigned char) **str)) {
+		(*str)++;
+		len--;
+	}
+	while (len && isspace((unsigned char) (*str)[len - 1]))
+		len--;
+	return len;
+}
+
+/* Convert a comma separated list of flags, with or without brackets */
+static void
+ofi_json_put_list(struct ofi_json_writer *w, const char *str, size_t len)
+{
+	const char *item;
+	size_t item_len;
+	bool first = true;
+
+	len = ofi_json_trim(&str, len);
+	if (len >= 2 && str[0] == '[' && str[len - 1] == ']') {
+		str++;
+		len -= 2;
+	}
+
+	ofi_json_putc(w, '[');
+	while (len) {
+		item = str;
+		while (len && *str != ',') {
+			str++;
+			len--;
+		}
+		item_len = ofi_json_trim(&item, str - item);
+		if (item_len) {
+			if (!first)
+				ofi_json_putc(w, ',');
+			ofi_json_putstr(w, item, item_len);
+			first = false;
+		}
+		if (len) {
+			str++;
+			len--;
+		}
+	}
+	ofi_json_putc(w, ']');
+}
+
+static void
+ofi_json_put_value(struct ofi_json_writer *w, const char *str, size_t len)
+{
+	len = ofi_json_trim(&str, len);
+	if (len && str[0] == '[')
+		ofi_json_put_list(w, str, len);
+	else if ((len == 6 && !strncmp(str, "(null)", len)) ||
+		 (len == 5 && !strncmp(str, "(nil)", len)))
+		ofi_json_puts(w, "null", 4);
+	else if (ofi_json_is_number(str, len))
+		ofi_json_puts(w, str, len);
+	else
+		ofi_json_putstr(w, str, len);
+}
+
+/* Each YAML line is "key: value", or "key:" introducing a dictionary
+ * whose members are indented further.
+ */
+static void
+ofi_json_put_struct(struct ofi_json_writer *w, const char *yaml, char *end)
+{
+	size_t indent[OFI_JSON_MAX_DEPTH];
+	const char *line, *key, *sep;
+	size_t depth = 0, line_len, key_len, spaces;
+	bool first = true;
+
+	ofi_json_putc(w, '{');
+	while (*yaml) {
+		line = yaml;
+		while (*yaml && *yaml != '\n')
+			yaml++;
+		line_len = yaml - line;
+		if (*yaml)
+			yaml++;
+
+		/* bytes before the current line have been consumed */
+		w->limit = (char *) line;
+
+		for (spaces = 0; spaces < line_len && line[spaces] == ' ';
+		     spaces++)
+			;
+		if (spaces == line_len)
+			continue;
+
+		while (depth && spaces <= indent[depth - 1]) {
+			ofi_json_putc(w, '}');
+			depth--;
+			first = false;
+		}
+		if (!first)
+			ofi_json_putc(w, ',');
+		first = false;
+
+		key = line + spaces;
+		line_len -= spaces;
+		sep = memchr(key, ':', line_len);
+		while (sep && sep + 1 < key + line_len && sep[1] != ' ')
+			sep = memchr(sep + 1, ':', key + line_len - sep - 1);
+		if (!sep) {
+			ofi_json_putstr(w, key, line_len);
+			ofi_json_puts(w, ":null", 5);
+			continue;
+		}
+
+		key_len = sep - key;
+		ofi_json_putstr(w, key, key_len);
+		ofi_json_putc(w, ':');
+		if (ofi_json_trim(&sep, line_len - key_len) == 1 &&
+		    depth < OFI_JSON_MAX_DEPTH) {
+			ofi_json_putc(w, '{');
+			indent[depth++] = spaces;
+			first = true;
+		} else {
+			ofi_json_put_value(w, sep + 1, line_len - key_len - 1);
+		}
+	}
+
+	w->limit = end;
+	while (depth--)
+		ofi_json_putc(w, '}');
+	ofi_json_putc(w, '}');
+}
+
+static bool ofi_tostr_is_flags(enum fi_type datatype)
+{
+	switch (datatype) {
+	case FI_TYPE_CAPS:
+	case FI_TYPE_OP_FLAGS:
+	case FI_TYPE_MSG_ORDER:
+	case FI_TYPE_MODE:
+	case FI_TYPE_CQ_EVENT_FLAGS:
+	case FI_TYPE_MR_MODE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool ofi_tostr_is_struct(enum fi_type datatype)
+{
+	switch (datatype) {
+	case FI_TYPE_INFO:
+	case FI_TYPE_TX_ATTR:
+	case FI_TYPE_RX_ATTR:
+	case FI_TYPE_EP_ATTR:
+	case FI_TYPE_DOMAIN_ATTR:
+	case FI_TYPE_FABRIC_ATTR:
+	case FI_TYPE_FID:
+	case FI_TYPE_AV_ATTR:
+	case FI_TYPE_CQ_ATTR:
+	case FI_TYPE_MR_ATTR:
+	case FI_TYPE_CNTR_ATTR:
+	case FI_TYPE_CQ_ERR_ENTRY:
+		return true;
+	default:
+		return false;
+	}
+}
+
+__attribute__((visibility ("default"),EXTERNALLY_VISIBLE))
+char *DEFAULT_SYMVER_PRE(fi_tostr_json_r)(char *buf, size_t len,
+					  const void *data,
+					  enum fi_type datatype)
+{
+	struct ofi_json_writer w;
+	char *yaml;
+	size_t yaml_len;
+
+	if (!fi_tostr_r(buf, len, data, datatype))
+		return NULL;
+
+	yaml_len = strlen(buf);
+	yaml = buf + len - 1 - yaml_len;
+	memmove(yaml, buf, yaml_len + 1);
+
+	w.pos = buf;
+	w.limit = yaml;
+	w.truncated = false;
+
+	if (ofi_tostr_is_struct(datatype)) {
+		ofi_json_put_struct(&w, yaml, buf + len - 1);
+	} else {
+		w.limit = buf + len - 1;
+		if (ofi_tostr_is_flags(datatype))
+			ofi_json_put_list(&w, yaml, yaml_len);
+		else
+			ofi_json_put_value(&w, yaml, yaml_len);
+	}
+	*w.pos = '\0';
+	return buf;
+}
+DEFAULT_SYMVER(fi_tostr_json_r_, fi_tostr_json_r, FABRIC_1.8);
+
 __attribute__((visibility ("default"),EXTERNALLY_VISIBLE))
 char *DEFAULT_SYMVER_PRE(fi_tostr)(const void *data, enum fi_type datatype)
 {
@@ -39,6 +39,7 @@
 #include "ofi_hmem.h"
 #include "ofi.h"
 #include "ofi_iov.h"
+#include "ofi_mem.h"
 
 bool ofi_hmem_disable_p2p = false;
 
@@ -626,6 +627,140 @@ void ofi_hmem_set_iface_filter(const char* iface_filter_str, bool* filter)
 	free(iface_filter_str_copy);
 }
 
+static size_t hmem_copy_chunk_size = 1024 * 1024;
+
+static void ofi_hmem_copy_free_events(struct ofi_hmem_copy *copy)
+{
+	size_t i;
+
+	for (i = 0; i < copy->event_cnt; i++)
+		ofi_free_async_copy_event(copy->iface, copy->device,
+					  copy->events[i]);
+	copy->event_cnt = 0;
+}
+
+/* Issue chunks on idle events.  Slots in events[] are reused in ring order,
+ * so the oldest outstanding chunk is always at tail.
+ */
+static int ofi_hmem_copy_issue(struct ofi_hmem_copy *copy)
+{
+	ofi_hmem_async_event_t event;
+	size_t len;
+	ssize_t ret;
+
+	while (copy->issued < copy->size &&
+	       copy->head - copy->tail < copy->event_cnt) {
+		len = MIN(hmem_copy_chunk_size, copy->size - copy->issued);
+		event = copy->events[copy->head % copy->event_cnt];
+		ret = ofi_async_copy_hmem_iov_buf(copy->iface, copy->device,
+					copy->iov, copy->iov_count,
+					copy->iov_offset + copy->issued,
+					copy->buf + copy->issued, len,
+					copy->dir, event);
+		if (ret < 0)
+			return (int) ret;
+
+		copy->lens[copy->head % copy->event_cnt] = len;
+		copy->issued += len;
+		copy->head++;
+	}
+	return 0;
+}
+
+int ofi_hmem_copy_start(struct ofi_hmem_copy *copy,
+			enum fi_hmem_iface iface, uint64_t device,
+			const struct iovec *iov, size_t iov_count,
+			uint64_t iov_offset, void *buf, size_t size, int dir)
+{
+	size_t i, cnt, total;
+	ssize_t ret;
+	int err;
+
+	memset(copy, 0, sizeof(*copy));
+	copy->iface = iface;
+	copy->device = device;
+	copy->iov = iov;
+	copy->iov_count = iov_count;
+	copy->iov_offset = iov_offset;
+	copy->buf = buf;
+	total = ofi_total_iov_len(iov, iov_count);
+	copy->size = iov_offset < total ? MIN(size, total - iov_offset) : 0;
+	copy->dir = dir;
+
+	cnt = MIN(ofi_div_ceil(copy->size, hmem_copy_chunk_size),
+		  OFI_HMEM_COPY_MAX_EVENTS);
+	if (iov_count > MAX_NUM_ASYNC_OP)
+		cnt = 0;
+
+	for (i = 0; i < cnt; i++) {
+		if (ofi_create_async_copy_event(iface, device,
+						&copy->events[i]))
+			break;
+		copy->event_cnt++;
+	}
+
+	if (!copy->event_cnt) {
+		ret = ofi_copy_hmem_iov_buf(iface, device, iov, iov_count,
+					    iov_offset, buf, copy->size, dir);
+		if (ret < 0)
+			return (int) ret;
+
+		copy->issued = copy->completed = copy->size;
+		return 0;
+	}
+
+	err = ofi_hmem_copy_issue(copy);
+	if (err) {
+		ofi_hmem_copy_cleanup(copy);
+		return err;
+	}
+	return 0;
+}
+
+/* Returns 0 once all chunks have completed, -FI_EAGAIN while the copy is in
+ * progress, or a negative error code.
+ */
+int ofi_hmem_copy_progress(struct ofi_hmem_copy *copy)
+{
+	size_t slot;
+	int ret;
+
+	while (copy->tail < copy->head) {
+		slot = copy->tail % copy->event_cnt;
+		ret = ofi_async_copy_query(copy->iface, copy->events[slot]);
+		if (ret == -FI_EBUSY)
+			break;
+		if (ret)
+			return ret;
+
+		copy->completed += copy->lens[slot];
+		copy->tail++;
+	}
+
+	ret = ofi_hmem_copy_issue(copy);
+	if (ret)
+		return ret;
+
+	if (copy->completed < copy->size)
+		return -FI_EAGAIN;
+
+	ofi_hmem_copy_free_events(copy);
+	return 0;
+}
+
+/* Waits for any chunks still in flight before releasing the events. */
+void ofi_hmem_copy_cleanup(struct ofi_hmem_copy *copy)
+{
+	while (copy->tail < copy->head) {
+		if (ofi_async_copy_query(copy->iface,
+				copy->events[copy->tail % copy->event_cnt]) ==
+		    -FI_EBUSY)
+			continue;
+		copy->tail++;
+	}
+	ofi_hmem_copy_free_events(copy);
+}
+
 void ofi_hmem_init(void)
 {
 	int iface, ret;
@@ -668,6 +803,15 @@ void ofi_hmem_init(void)
 		}
 	}
 
+	fi_param_define(NULL, "hmem_copy_chunk_size", FI_PARAM_SIZE_T,
+			"Size of the chunks that pipelined device copies are"
+			" split into.  Only used by sm2 for ROCr IPC receives."
+			"  (default: 1 MiB)");
+	fi_param_get_size_t(NULL, "hmem_copy_chunk_size",
+			    &hmem_copy_chunk_size);
+	if (!hmem_copy_chunk_size)
+		hmem_copy_chunk_size = 1024 * 1024;
+
 	fi_param_define(NULL, "hmem_disable_p2p", FI_PARAM_BOOL,
 			"Disable peer to peer support between device memory and"
 			" network devices. (default: no).");
@@ -762,6 +906,151 @@ err:
 	return ret;
 }
 
+struct ofi_hmem_staging_block {
+	struct dlist_entry	entry;
+	char			*addr;
+	size_t			size;
+};
+
+int ofi_hmem_staging_init(struct ofi_hmem_staging *staging, size_t size)
+{
+	struct ofi_hmem_staging_block *block;
+	long page_size;
+	int ret;
+
+	page_size = ofi_get_page_size();
+	if (page_size < 0)
+		return -ofi_syserr();
+
+	block = malloc(sizeof(*block));
+	if (!block)
+		return -FI_ENOMEM;
+
+	staging->size = ofi_get_aligned_size(size, (size_t) page_size);
+	if (ofi_memalign((void **) &staging->base, (size_t) page_size,
+			 staging->size)) {
+		ret = -FI_ENOMEM;
+		goto free_block;
+	}
+
+	ret = ofi_hmem_host_register(staging->base, staging->size);
+	if (ret)
+		goto free_base;
+
+	block->addr = staging->base;
+	block->size = staging->size;
+	dlist_init(&staging->free_list);
+	dlist_init(&staging->used_list);
+	dlist_insert_tail(&block->entry, &staging->free_list);
+	ofi_mutex_init(&staging->lock);
+	staging->context = NULL;
+	return FI_SUCCESS;
+
+free_base:
+	ofi_freealign(staging->base);
+free_block:
+	free(block);
+	return ret;
+}
+
+void ofi_hmem_staging_cleanup(struct ofi_hmem_staging *staging)
+{
+	struct ofi_hmem_staging_block *block;
+	struct dlist_entry *tmp;
+
+	assert(dlist_empty(&staging->used_list));
+	dlist_foreach_container_safe(&staging->free_list,
+				     struct ofi_hmem_staging_block,
+				     block, entry, tmp)
+		free(block);
+
+	(void) ofi_hmem_host_unregister(staging->base);
+	ofi_freealign(staging->base);
+	ofi_mutex_destroy(&staging->lock);
+}
+
+/* First fit, so that long-lived regions pack at the start of the area */
+void *ofi_hmem_staging_alloc(struct ofi_hmem_staging *staging, size_t size)
+{
+	struct ofi_hmem_staging_block *block, *used = NULL;
+	void *buf = NULL;
+
+	size = ofi_get_aligned_size(size, (size_t) ofi_get_page_size());
+
+	ofi_mutex_lock(&staging->lock);
+	dlist_foreach_container(&staging->free_list,
+				struct ofi_hmem_staging_block, block, entry) {
+		if (block->size < size)
+			continue;
+
+		if (block->size == size) {
+			dlist_remove(&block->entry);
+			used = block;
+		} else {
+			used = malloc(sizeof(*used));
+			if (!used)
+				break;
+			used->addr = block->addr;
+			used->size = size;
+			block->addr += size;
+			block->size -= size;
+		}
+		dlist_insert_tail(&used->entry, &staging->used_list);
+		buf = used->addr;
+		break;
+	}
+	ofi_mutex_unlock(&staging->lock);
+	return buf;
+}
+
+void ofi_hmem_staging_free(struct ofi_hmem_staging *staging, void *buf)
+{
+	struct ofi_hmem_staging_block *block, *next, *prev;
+	struct dlist_entry *entry;
+
+	ofi_mutex_lock(&staging->lock);
+	dlist_foreach_container(&staging->used_list,
+				struct ofi_hmem_staging_block, block, entry) {
+		if (block->addr == buf)
+			goto found;
+	}
+	ofi_mutex_unlock(&staging->lock);
+	assert(0);
+	return;
+
+found:
+	dlist_remove(&block->entry);
+
+	/* Keep the free list sorted by address and merge neighbors */
+	dlist_foreach(&staging->free_list, entry) {
+		next = container_of(entry, struct ofi_hmem_staging_block, entry);
+		if (next->addr > block->addr)
+			break;
+	}
+	dlist_insert_before(&block->entry, entry);
+
+	if (block->entry.next != &staging->free_list) {
+		next = container_of(block->entry.next,
+				    struct ofi_hmem_staging_block, entry);
+		if (block->addr + block->size == next->addr) {
+			block->size += next->size;
+			dlist_remove(&next->entry);
+			free(next);
+		}
+	}
+
+	if (block->entry.prev != &staging->free_list) {
+		prev = container_of(block->entry.prev,
+				    struct ofi_hmem_staging_block, entry);
+		if (prev->addr + prev->size == block->addr) {
+			prev->size += block->size;
+			dlist_remove(&block->entry);
+			free(block);
+		}
+	}
+	ofi_mutex_unlock(&staging->lock);
+}
+
 bool ofi_hmem_is_ipc_enabled(enum fi_hmem_iface iface)
 {
 	return hmem_ops[iface].is_ipc_enabled();
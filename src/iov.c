@@ -37,6 +37,405 @@
 #include <ofi.h>
 #include <ofi_iov.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__amd64__))
+#define OFI_COPY_X86 1
+#include <immintrin.h>
+#else
+#define OFI_COPY_X86 0
+#endif
+
+size_t ofi_copy_nt_threshold = SIZE_MAX;
+void (*ofi_copy_nt)(void *dst, const void *src, size_t len);
+
+#if OFI_COPY_X86
+
+/* The streaming loops copy the unaligned head and the tail with memcpy
+ * and issue an sfence, so that the copy is ordered with respect to any
+ * flag store that the caller uses to publish the data.  Copies too short
+ * to reach one aligned block are done with memcpy.
+ */
+static void ofi_copy_nt_sse2(void *dst, const void *src, size_t len)
+{
+	char *d = dst;
+	const char *s = src;
+	size_t head;
+
+	head = (16 - ((uintptr_t) d & 15)) & 15;
+	if (len < head + 64) {
+		memcpy(d, s, len);
+		return;
+	}
+
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	len -= head;
+
+	for (; len >= 64; len -= 64, d += 64, s += 64) {
+		__m128i a = _mm_loadu_si128((const __m128i *) s);
+		__m128i b = _mm_loadu_si128((const __m128i *) (s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *) (s + 32));
+		__m128i e = _mm_loadu_si128((const __m128i *) (s + 48));
+
+		_mm_stream_si128((__m128i *) d, a);
+		_mm_stream_si128((__m128i *) (d + 16), b);
+		_mm_stream_si128((__m128i *) (d + 32), c);
+		_mm_stream_si128((__m128i *) (d + 48), e);
+	}
+	_mm_sfence();
+	memcpy(d, s, len);
+}
+
+__attribute__((target("avx2")))
+static void ofi_copy_nt_avx2(void *dst, const void *src, size_t len)
+{
+	char *d = dst;
+	const char *s = src;
+	size_t head;
+
+	head = (32 - ((uintptr_t) d & 31)) & 31;
+	if (len < head + 128) {
+		memcpy(d, s, len);
+		return;
+	}
+
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	len -= head;
+
+	for (; len >= 128; len -= 128, d += 128, s += 128) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) s);
+		__m256i b = _mm256_loadu_si256((const __m256i *) (s + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i *) (s + 64));
+		__m256i e = _mm256_loadu_si256((const __m256i *) (s + 96));
+
+		_mm256_stream_si256((__m256i *) d, a);
+		_mm256_stream_si256((__m256i *) (d + 32), b);
+		_mm256_stream_si256((__m256i *) (d + 64), c);
+		_mm256_stream_si256((__m256i *) (d + 96), e);
+	}
+	_mm_sfence();
+	memcpy(d, s, len);
+}
+
+__attribute__((target("avx512f")))
+static void ofi_copy_nt_avx512(void *dst, const void *src, size_t len)
+{
+	char *d = dst;
+	const char *s = src;
+	size_t head;
+
+	head = (64 - ((uintptr_t) d & 63)) & 63;
+	if (len < head + 256) {
+		memcpy(d, s, len);
+		return;
+	}
+
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	len -= head;
+
+	for (; len >= 256; len -= 256, d += 256, s += 256) {
+		__m512i a = _mm512_loadu_si512((const void *) s);
+		__m512i b = _mm512_loadu_si512((const void *) (s + 64));
+		__m512i c = _mm512_loadu_si512((const void *) (s + 128));
+		__m512i e = _mm512_loadu_si512((const void *) (s + 192));
+
+		_mm512_stream_si512((void *) d, a);
+		_mm512_stream_si512((void *) (d + 64), b);
+		_mm512_stream_si512((void *) (d + 128), c);
+		_mm512_stream_si512((void *) (d + 192), e);
+	}
+	_mm_sfence();
+	memcpy(d, s, len);
+}
+
+#endif /* OFI_COPY_X86 */
+
+static void ofi_copy_nt_memcpy(void *dst, const void *src, size_t len)
+{
+	memcpy(dst, src, len);
+}
+
+void ofi_copy_init(void)
+{
+	char *engine = NULL;
+	size_t threshold = 1024 * 1024;
+
+	fi_param_define(NULL, "copy_engine", FI_PARAM_STRING,
+			"Copy routine used for large bounce buffer copies.  "
+			"Options are: memcpy, auto, sse2, avx2 and avx512.  "
+			"The sse2, avx2 and avx512 engines use non-temporal "
+			"stores for copies of at least FI_COPY_NT_THRESHOLD "
+			"bytes.  auto selects the widest engine supported by "
+			"the CPU.  (default: memcpy)");
+	fi_param_define(NULL, "copy_nt_threshold", FI_PARAM_SIZE_T,
+			"Size in bytes at or above which copies use "
+			"non-temporal stores, if a streaming copy engine "
+			"is selected.  (default: 1 MiB)");
+	fi_param_get_str(NULL, "copy_engine", &engine);
+	fi_param_get_size_t(NULL, "copy_nt_threshold", &threshold);
+
+	ofi_copy_nt = ofi_copy_nt_memcpy;
+	if (!engine || !strcasecmp(engine, "memcpy"))
+		return;
+
+#if OFI_COPY_X86
+	if (!strcasecmp(engine, "auto")) {
+		if (__builtin_cpu_supports("avx512f"))
+			ofi_copy_nt = ofi_copy_nt_avx512;
+		else if (__builtin_cpu_supports("avx2"))
+			ofi_copy_nt = ofi_copy_nt_avx2;
+		else
+			ofi_copy_nt = ofi_copy_nt_sse2;
+	} else if (!strcasecmp(engine, "avx512") &&
+		   __builtin_cpu_supports("avx512f")) {
+		ofi_copy_nt = ofi_copy_nt_avx512;
+	} else if (!strcasecmp(engine, "avx2") &&
+		   __builtin_cpu_supports("avx2")) {
+		ofi_copy_nt = ofi_copy_nt_avx2;
+	} else if (!strcasecmp(engine, "sse2")) {
+		ofi_copy_nt = ofi_copy_nt_sse2;
+	}
+#endif
+
+	if (ofi_copy_nt == ofi_copy_nt_memcpy) {
+		FI_WARN(&core_prov, FI_LOG_CORE,
+			"copy engine %s not supported, using memcpy\n",
+			engine);
+		return;
+	}
+
+	FI_INFO(&core_prov, FI_LOG_CORE,
+		"using %s copy engine above %zu bytes\n", engine, threshold);
+	ofi_copy_nt_threshold = threshold;
+}
+
+#define OFI_CRC32C_POLY		0x82f63b78
+#define OFI_CRC32C_LONG		8192
+#define OFI_CRC32C_SHORT	256
+
+uint32_t (*ofi_crc32c_fn)(uint32_t crc, const void *buf, size_t len);
+
+static uint32_t ofi_crc32c_table[256];
+
+uint32_t ofi_crc32c_sw(uint32_t crc, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+
+	crc = ~crc;
+	while (len--)
+		crc = ofi_crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+#if OFI_COPY_X86
+/*
+ * The crc32 instruction has a latency of 3 cycles but a throughput of 1,
+ * so three independent streams are run over adjacent blocks and their
+ * CRCs are combined.  Combining shifts a CRC over the length of a block
+ * of zeros, using the operators tabulated below at init.
+ */
+static uint32_t ofi_crc32c_long[4][256];
+static uint32_t ofi_crc32c_short[4][256];
+
+static uint32_t ofi_gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+	uint32_t sum = 0;
+
+	for (; vec; vec >>= 1, mat++) {
+		if (vec & 1)
+			sum ^= *mat;
+	}
+	return sum;
+}
+
+static void ofi_gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+	int i;
+
+	for (i = 0; i < 32; i++)
+		square[i] = ofi_gf2_matrix_times(mat, mat[i]);
+}
+
+/* Build the tables that apply len bytes of zeros (a power of 2) to a CRC */
+static void ofi_crc32c_zeros(uint32_t zeros[4][256], size_t len)
+{
+	uint32_t even[32], odd[32];
+	uint32_t *op;
+	int i;
+
+	/* Operator for a single zero bit */
+	odd[0] = OFI_CRC32C_POLY;
+	for (i = 1; i < 32; i++)
+		odd[i] = 1U << (i - 1);
+
+	/* Square to 2 and 4 zero bits, then on to 1 byte, 2 bytes, ... */
+	ofi_gf2_matrix_square(even, odd);
+	ofi_gf2_matrix_square(odd, even);
+	op = odd;
+	for (; len; len >>= 1) {
+		if (op == odd) {
+			ofi_gf2_matrix_square(even, odd);
+			op = even;
+		} else {
+			ofi_gf2_matrix_square(odd, even);
+			op = odd;
+		}
+	}
+
+	for (i = 0; i < 256; i++) {
+		zeros[0][i] = ofi_gf2_matrix_times(op, i);
+		zeros[1][i] = ofi_gf2_matrix_times(op, i << 8);
+		zeros[2][i] = ofi_gf2_matrix_times(op, i << 16);
+		zeros[3][i] = ofi_gf2_matrix_times(op, (uint32_t) i << 24);
+	}
+}
+
+static uint32_t ofi_crc32c_shift(uint32_t zeros[4][256], uint32_t crc)
+{
+	return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^
+	       zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+}
+
+__attribute__((target("sse4.2")))
+static inline uint64_t ofi_crc32c_u64(uint64_t crc, const uint8_t *p)
+{
+	uint64_t val;
+
+	memcpy(&val, p, sizeof(val));
+	return _mm_crc32_u64(crc, val);
+}
+
+__attribute__((target("sse4.2")))
+static size_t ofi_crc32c_sse42_3way(uint64_t *crc, const uint8_t *p,
+				    size_t len, size_t block,
+				    uint32_t zeros[4][256])
+{
+	const uint8_t *end;
+	uint64_t crc0 = *crc, crc1, crc2;
+	size_t done = 0;
+
+	for (; len - done >= block * 3; done += block * 3) {
+		crc1 = crc2 = 0;
+		for (end = p + block; p < end; p += 8) {
+			crc0 = ofi_crc32c_u64(crc0, p);
+			crc1 = ofi_crc32c_u64(crc1, p + block);
+			crc2 = ofi_crc32c_u64(crc2, p + block * 2);
+		}
+		crc0 = ofi_crc32c_shift(zeros, (uint32_t) crc0) ^ crc1;
+		crc0 = ofi_crc32c_shift(zeros, (uint32_t) crc0) ^ crc2;
+		p += block * 2;
+	}
+
+	*crc = crc0;
+	return done;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t ofi_crc32c_sse42(uint32_t crc, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+	uint64_t crc64;
+	size_t done;
+
+	crc = ~crc;
+	for (; len && ((uintptr_t) p & 7); len--)
+		crc = _mm_crc32_u8(crc, *p++);
+
+	crc64 = crc;
+	done = ofi_crc32c_sse42_3way(&crc64, p, len, OFI_CRC32C_LONG,
+				     ofi_crc32c_long);
+	p += done;
+	len -= done;
+	done = ofi_crc32c_sse42_3way(&crc64, p, len, OFI_CRC32C_SHORT,
+				     ofi_crc32c_short);
+	p += done;
+	len -= done;
+
+	for (; len >= 8; len -= 8, p += 8)
+		crc64 = ofi_crc32c_u64(crc64, p);
+
+	crc = (uint32_t) crc64;
+	for (; len; len--)
+		crc = _mm_crc32_u8(crc, *p++);
+	return ~crc;
+}
+#endif /* OFI_COPY_X86 */
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define OFI_CRC32C_ARM 1
+#include <arm_acle.h>
+#include <sys/auxv.h>
+
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+
+__attribute__((target("+crc")))
+static uint32_t ofi_crc32c_arm(uint32_t crc, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+	uint64_t val;
+
+	crc = ~crc;
+	for (; len && ((uintptr_t) p & 7); len--)
+		crc = __crc32cb(crc, *p++);
+	for (; len >= 8; len -= 8, p += 8) {
+		memcpy(&val, p, sizeof(val));
+		crc = __crc32cd(crc, val);
+	}
+	for (; len; len--)
+		crc = __crc32cb(crc, *p++);
+	return ~crc;
+}
+#else
+#define OFI_CRC32C_ARM 0
+#endif
+
+void ofi_crc32c_init(void)
+{
+	uint32_t crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc & 1) ? (crc >> 1) ^ OFI_CRC32C_POLY : crc >> 1;
+		ofi_crc32c_table[i] = crc;
+	}
+	ofi_crc32c_fn = ofi_crc32c_sw;
+
+#if OFI_COPY_X86
+	if (__builtin_cpu_supports("sse4.2")) {
+		ofi_crc32c_zeros(ofi_crc32c_long, OFI_CRC32C_LONG);
+		ofi_crc32c_zeros(ofi_crc32c_short, OFI_CRC32C_SHORT);
+		ofi_crc32c_fn = ofi_crc32c_sse42;
+		FI_INFO(&core_prov, FI_LOG_CORE, "using sse4.2 crc32c\n");
+	}
+#elif OFI_CRC32C_ARM
+	if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+		ofi_crc32c_fn = ofi_crc32c_arm;
+		FI_INFO(&core_prov, FI_LOG_CORE, "using armv8 crc32c\n");
+	}
+#endif
+}
+
+uint32_t ofi_crc32c_iov(uint32_t crc, const struct iovec *iov,
+			size_t iov_count, size_t len)
+{
+	size_t i, cur;
+
+	for (i = 0; i < iov_count && len; i++) {
+		cur = MIN(iov[i].iov_len, len);
+		crc = ofi_crc32c(crc, iov[i].iov_base, cur);
+		len -= cur;
+	}
+	return crc;
+}
+
 uint64_t ofi_copy_iov_buf(const struct iovec *iov, size_t iov_count, uint64_t iov_offset,
 			  void *buf, uint64_t bufsize, int dir)
 {
@@ -51,9 +450,9 @@ uint64_t ofi_copy_iov_buf(const struct iovec *iov, size_t iov_count, uint64_t io
 			continue;
 
 		if (dir == OFI_COPY_BUF_TO_IOV)
-			memcpy(iov_buf, (char *) buf + done, len);
+			ofi_copy(iov_buf, (char *) buf + done, len);
 		else if (dir == OFI_COPY_IOV_TO_BUF)
-			memcpy((char *) buf + done, iov_buf, len);
+			ofi_copy((char *) buf + done, iov_buf, len);
 
 		done += len;
 	}
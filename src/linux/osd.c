@@ -146,6 +146,99 @@ ssize_t ofi_get_hugepage_size(void)
 	return val * 1024;
 }
 
+int ofi_alloc_sized_hugepage_buf(void **memptr, size_t size, size_t page_size)
+{
+#ifdef MAP_HUGE_SHIFT
+	return ofi_mmap_anon_pages(memptr, size, MAP_HUGETLB |
+			((ofi_lsb(page_size) - 1) << MAP_HUGE_SHIFT));
+#else
+	if ((ssize_t) page_size != ofi_get_hugepage_size())
+		return -FI_ENOSYS;
+
+	return ofi_alloc_hugepage_buf(memptr, size);
+#endif
+}
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+/* Prefer, rather than require, pages on the given node, so that
+ * allocations still succeed when the node runs out of memory.
+ */
+int ofi_numa_bind(void *addr, size_t size, int node)
+{
+	unsigned long mask[4] = {0};
+	const unsigned long bits = sizeof(mask[0]) * 8;
+
+	if (node < 0 || (size_t) node >= sizeof(mask) * 8)
+		return -FI_EINVAL;
+
+	mask[node / bits] = 1UL << (node % bits);
+	if (syscall(SYS_mbind, addr, size, MPOL_PREFERRED, mask,
+		    sizeof(mask) * 8, 0))
+		return -errno;
+
+	return 0;
+}
+
+int ofi_numa_node_self(void)
+{
+	unsigned int cpu, node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL))
+		return -errno;
+
+	return (int) node;
+}
+
+int ofi_pci_numa_node(const struct fi_pci_attr *pci)
+{
+	char path[PATH_MAX];
+	FILE *fd;
+	int node;
+
+	snprintf(path, sizeof(path),
+		 "/sys/bus/pci/devices/%04x:%02x:%02x.%x/numa_node",
+		 pci->domain_id, pci->bus_id, pci->device_id,
+		 pci->function_id);
+
+	fd = fopen(path, "r");
+	if (!fd)
+		return -errno;
+
+	if (fscanf(fd, "%d", &node) != 1)
+		node = -FI_ENODATA;
+	fclose(fd);
+
+	/* The kernel reports -1 when the device has no affinity */
+	return node < 0 ? -FI_ENODATA : node;
+}
+
+/* Returns the SLIT distance between two NUMA nodes */
+int ofi_numa_distance(int from, int to)
+{
+	char path[PATH_MAX];
+	FILE *fd;
+	int i, dist = -FI_ENODATA;
+
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/node/node%d/distance", from);
+
+	fd = fopen(path, "r");
+	if (!fd)
+		return -errno;
+
+	for (i = 0; i <= to; i++) {
+		if (fscanf(fd, "%d", &dist) != 1) {
+			dist = -FI_ENODATA;
+			break;
+		}
+	}
+	fclose(fd);
+	return dist;
+}
+
 #ifdef HAVE_ETHTOOL
 
 #if HAVE_DECL_ETHTOOL_CMD_SPEED
@@ -160,6 +160,10 @@ static uint64_t rdpmc_hw_id(uint32_t cntr_id)
 		return PERF_COUNT_HW_CPU_CYCLES;
 	case OFI_PMC_CPU_INSTR:
 		return PERF_COUNT_HW_INSTRUCTIONS;
+	case OFI_PMC_CPU_CACHE_MISSES:
+		return PERF_COUNT_HW_CACHE_MISSES;
+	case OFI_PMC_CPU_BRANCH_MISSES:
+		return PERF_COUNT_HW_BRANCH_MISSES;
 	default:
 		return ~0;
 	}
@@ -167,8 +171,33 @@ static uint64_t rdpmc_hw_id(uint32_t cntr_id)
 
 static uint64_t rdpmc_cache_id(uint32_t cntr_id, uint32_t flags)
 {
-	/* TODO */
-	return ~0;
+	uint64_t cache, op, result;
+
+	switch (cntr_id) {
+	case OFI_PMC_CACHE_L1_DATA:
+		cache = PERF_COUNT_HW_CACHE_L1D;
+		break;
+	case OFI_PMC_CACHE_L1_INSTR:
+		cache = PERF_COUNT_HW_CACHE_L1I;
+		break;
+	case OFI_PMC_CACHE_TLB_DATA:
+		cache = PERF_COUNT_HW_CACHE_DTLB;
+		break;
+	case OFI_PMC_CACHE_TLB_INSTR:
+		cache = PERF_COUNT_HW_CACHE_ITLB;
+		break;
+	case OFI_PMC_CACHE_LL:
+		cache = PERF_COUNT_HW_CACHE_LL;
+		break;
+	default:
+		return ~0;
+	}
+
+	op = (flags & OFI_PMC_FLAG_WRITE) ? PERF_COUNT_HW_CACHE_OP_WRITE :
+					    PERF_COUNT_HW_CACHE_OP_READ;
+	result = (flags & OFI_PMC_FLAG_MISS) ? PERF_COUNT_HW_CACHE_RESULT_MISS :
+					       PERF_COUNT_HW_CACHE_RESULT_ACCESS;
+	return cache | (op << 8) | (result << 16);
 }
 
 static uint64_t rdpmc_sw_id(uint32_t cntr_id)
@@ -209,14 +238,26 @@ int ofi_pmu_open(struct ofi_perf_ctx **ctx, enum ofi_perf_domain domain,
 		attr.config = rdpmc_sw_id(cntr_id);
 		break;
 	default:
-		return -FI_ENOSYS;
+		ret = -FI_ENOSYS;
+		goto err;
 	}
 
-	if (attr.config == ~0)
-		return -FI_ENOSYS;
+	if (attr.config == ~0) {
+		ret = -FI_ENOSYS;
+		goto err;
+	}
+
+	errno = 0;
+	if (rdpmc_open_attr(&attr, &(*ctx)->ctx, NULL)) {
+		ret = errno ? -errno : -FI_ENOSYS;
+		goto err;
+	}
+	return 0;
 
-	ret = rdpmc_open_attr(&attr, &(*ctx)->ctx, NULL);
-	return ret ? -errno : 0;
+err:
+	free(*ctx);
+	*ctx = NULL;
+	return ret;
 }
 
 inline uint64_t ofi_pmu_read(struct ofi_perf_ctx *ctx)
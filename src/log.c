@@ -44,6 +44,7 @@
 #include "ofi_str.h"
 #include "ofi_enosys.h"
 #include "ofi_util.h"
+#include "ofi_atomic_queue.h"
 
 
 static const char * const log_subsys[] = {
@@ -90,6 +91,37 @@ extern struct ofi_common_locks common_locks;
 
 static pid_t pid;
 
+/*
+ * Asynchronous logging: callers copy the message and its metadata into
+ * one of a few lock-free rings, chosen by thread, and a background
+ * thread formats the prefix and writes to stderr.  Messages are dropped
+ * rather than blocking the caller when a ring is full.
+ */
+#define OFI_LOG_RING_CNT	4
+#define OFI_LOG_NAME_LEN	32
+#define OFI_LOG_MSG_LEN		1024
+
+struct ofi_log_rec {
+	time_t			time;
+	int			line;
+	enum fi_log_level	level;
+	enum fi_log_subsys	subsys;
+	char			prov[OFI_LOG_NAME_LEN];
+	char			func[OFI_LOG_NAME_LEN];
+	char			msg[OFI_LOG_MSG_LEN];
+};
+
+OFI_DECLARE_ATOMIC_Q(struct ofi_log_rec, ofi_log_ring);
+
+static size_t log_async;
+static struct ofi_log_ring *log_rings[OFI_LOG_RING_CNT];
+static ofi_atomic64_t log_dropped;
+static ofi_atomic32_t log_running;
+static int log_async_running;
+static pthread_t log_thread;
+
+static void ofi_log_async_init(void);
+
 static int fi_convert_log_str(const char *value)
 {
 	int i;
@@ -137,6 +169,17 @@ void fi_log_init(void)
 	}
 	ofi_free_filter(&subsys_filter);
 	pid = getpid();
+
+	fi_param_define(NULL, "log_async", FI_PARAM_SIZE_T,
+			"Number of messages each asynchronous log ring holds. "
+			"When set, messages are queued and written to stderr by "
+			"a background thread, and are dropped if the ring is "
+			"full (default: 0, log synchronously)");
+	fi_param_get_size_t(NULL, "log_async", &log_async);
+	if (log_async) {
+		log_async = roundup_power_of_two(log_async);
+		ofi_log_async_init();
+	}
 }
 
 static int ofi_log_enabled(const struct fi_provider *prov,
@@ -149,10 +192,136 @@ static int ofi_log_enabled(const struct fi_provider *prov,
 		FI_LOG_TAG(prov_filtered, level, subsys));
 }
 
+/* Copies only the string, unlike strncpy, which pads the whole slot */
+static void ofi_log_copy(char *dst, const char *src, size_t size)
+{
+	size_t len;
+
+	len = strnlen(src, size - 1);
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+}
+
+static void ofi_log_async(const struct fi_provider *prov,
+			  enum fi_log_level level, enum fi_log_subsys subsys,
+			  const char *func, int line, const char *msg)
+{
+	struct ofi_log_ring *ring;
+	struct ofi_log_rec *rec;
+	int64_t pos;
+
+	ring = log_rings[ofi_thread_slot(OFI_LOG_RING_CNT)];
+	if (ofi_log_ring_next(ring, &rec, &pos)) {
+		ofi_atomic_inc64(&log_dropped);
+		return;
+	}
+
+	rec->time = time(NULL);
+	rec->line = line;
+	rec->level = level;
+	rec->subsys = subsys;
+	ofi_log_copy(rec->prov, prov->name, sizeof(rec->prov));
+	ofi_log_copy(rec->func, func, sizeof(rec->func));
+	ofi_log_copy(rec->msg, msg, sizeof(rec->msg));
+	ofi_log_ring_commit(rec, pos);
+}
+
+static size_t ofi_log_drain(void)
+{
+	struct ofi_log_rec *rec;
+	int64_t pos, dropped;
+	size_t i, cnt = 0;
+
+	for (i = 0; i < OFI_LOG_RING_CNT; i++) {
+		while (!ofi_log_ring_head(log_rings[i], &rec, &pos)) {
+			fprintf(stderr, "%s:%d:%ld:%s:%s:%s:%s():%d<%s> %s",
+				PACKAGE, pid, (unsigned long) rec->time,
+				log_prefix, rec->prov, log_subsys[rec->subsys],
+				rec->func, rec->line, log_levels[rec->level],
+				rec->msg);
+			ofi_log_ring_release(log_rings[i], rec, pos);
+			cnt++;
+		}
+	}
+
+	dropped = ofi_atomic_get64(&log_dropped);
+	if (dropped) {
+		ofi_atomic_add64(&log_dropped, -dropped);
+		fprintf(stderr, "%s:%d:%ld:%s: dropped %" PRId64
+			" log messages\n", PACKAGE, pid,
+			(unsigned long) time(NULL), log_prefix, dropped);
+	}
+	return cnt;
+}
+
+static void *ofi_log_thread(void *arg)
+{
+	while (ofi_atomic_get32(&log_running)) {
+		if (!ofi_log_drain())
+			usleep(1000);
+	}
+	return NULL;
+}
+
+static void ofi_log_async_init(void)
+{
+	size_t i;
+	int ret;
+
+	for (i = 0; i < OFI_LOG_RING_CNT; i++) {
+		ret = ofi_memalign((void **) &log_rings[i], OFI_CACHE_LINE_SIZE,
+				   sizeof(*log_rings[i]) + log_async *
+				   sizeof(log_rings[i]->entry[0]));
+		if (ret)
+			goto err;
+		ofi_log_ring_init(log_rings[i], log_async);
+	}
+
+	ofi_atomic_initialize64(&log_dropped, 0);
+	ofi_atomic_initialize32(&log_running, 1);
+	ret = pthread_create(&log_thread, NULL, ofi_log_thread, NULL);
+	if (!ret) {
+		log_async_running = 1;
+		return;
+	}
+
+err:
+	while (i--) {
+		ofi_freealign(log_rings[i]);
+		log_rings[i] = NULL;
+	}
+	log_async = 0;
+	fprintf(stderr, "%s: unable to start asynchronous logging\n", PACKAGE);
+}
+
+static void ofi_log_async_fini(void)
+{
+	size_t i;
+
+	if (!log_async_running)
+		return;
+
+	ofi_atomic_set32(&log_running, 0);
+	(void) pthread_join(log_thread, NULL);
+	log_async_running = 0;
+	log_async = 0;
+	(void) ofi_log_drain();
+
+	for (i = 0; i < OFI_LOG_RING_CNT; i++) {
+		ofi_freealign(log_rings[i]);
+		log_rings[i] = NULL;
+	}
+}
+
 static void ofi_log(const struct fi_provider *prov, enum fi_log_level level,
 		    enum fi_log_subsys subsys, const char *func, int line,
 		    const char *msg)
 {
+	if (log_async_running) {
+		ofi_log_async(prov, level, subsys, func, line, msg);
+		return;
+	}
+
 	fprintf(stderr, "%s:%d:%ld:%s:%s:%s:%s():%d<%s> %s",
 		PACKAGE, pid, (unsigned long) time(NULL), log_prefix,
 		prov->name, log_subsys[subsys], func, line,
@@ -314,6 +483,7 @@ void ofi_tostr_log_subsys(char *buf, size_t len, enum fi_log_subsys subsys)
 
 void fi_log_fini(void)
 {
+	ofi_log_async_fini();
 	ofi_free_filter(&prov_log_filter);
 }
 
@@ -324,6 +494,11 @@ int DEFAULT_SYMVER_PRE(fi_log_enabled)(const struct fi_provider *prov,
 {
 	uint64_t flags = 0;
 
+	/* Filtering by provider can only disable more messages */
+	if (log_fid.ops->enabled == ofi_log_enabled &&
+	    !ofi_log_enabled(prov, level, subsys, 0))
+		return 0;
+
 	if (ofi_prov_ctx(prov)->disable_logging)
 		flags |= FI_LOG_PROV_FILTERED;
 
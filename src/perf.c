@@ -39,7 +39,12 @@
 #include <inttypes.h>
 
 #include <rdma/fi_errno.h>
+#include <rdma/fi_ext.h>
 #include <ofi_perf.h>
+#include <ofi_mem.h>
+#include <ofi_enosys.h>
+#include <ofi_lock.h>
+#include <ofi.h>
 #include <rdma/providers/fi_log.h>
 
 
@@ -47,22 +52,88 @@ enum ofi_perf_domain	perf_domain = OFI_PMU_CPU;
 uint32_t		perf_cntr = OFI_PMC_CPU_INSTR;
 uint32_t		perf_flags;
 
+struct ofi_perf_event	perf_events[OFI_PERF_MAX_EVENTS];
+size_t			perf_event_cnt;
+
+static const struct ofi_perf_event perf_event_table[] = {
+	{ "cpu_instr", OFI_PMU_CPU, OFI_PMC_CPU_INSTR, 0 },
+	{ "cpu_cycles", OFI_PMU_CPU, OFI_PMC_CPU_CYCLES, 0 },
+	{ "cache_misses", OFI_PMU_CPU, OFI_PMC_CPU_CACHE_MISSES,
+	  OFI_PMC_FLAG_MISS },
+	{ "branch_misses", OFI_PMU_CPU, OFI_PMC_CPU_BRANCH_MISSES, 0 },
+	{ "l1d_misses", OFI_PMU_CACHE, OFI_PMC_CACHE_L1_DATA,
+	  OFI_PMC_FLAG_READ | OFI_PMC_FLAG_MISS },
+	{ "llc_misses", OFI_PMU_CACHE, OFI_PMC_CACHE_LL,
+	  OFI_PMC_FLAG_READ | OFI_PMC_FLAG_MISS },
+	{ "dtlb_misses", OFI_PMU_CACHE, OFI_PMC_CACHE_TLB_DATA,
+	  OFI_PMC_FLAG_READ | OFI_PMC_FLAG_MISS },
+	{ "page_faults", OFI_PMU_OS, OFI_PMC_OS_PAGE_FAULT, 0 },
+};
+
+int ofi_hist_enabled;
+
+struct ofi_hist_slot {
+	ofi_atomic64_t	sum[OFI_HIST_MAX];
+	ofi_atomic64_t	bucket[OFI_HIST_MAX][OFI_HIST_BUCKETS];
+} __attribute__((__aligned__(64)));
+
+static struct ofi_hist_slot *hist_slots;
+
+static const char *const hist_names[OFI_HIST_MAX] = {
+	[OFI_HIST_CQ_WRITE] = "cq_write",
+	[OFI_HIST_MR_CACHE_SEARCH] = "mr_cache_search",
+	[OFI_HIST_PROGRESS] = "progress",
+};
+
+
+static void ofi_perf_add_event(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(perf_event_table); i++) {
+		if (strcasecmp(name, perf_event_table[i].name))
+			continue;
+
+		if (perf_event_cnt == OFI_PERF_MAX_EVENTS) {
+			FI_WARN(&core_prov, FI_LOG_CORE,
+				"Too many performance counters, ignoring %s\n",
+				name);
+			return;
+		}
+		perf_events[perf_event_cnt++] = perf_event_table[i];
+		return;
+	}
+
+	FI_WARN(&core_prov, FI_LOG_CORE,
+		"Unknown performance counter %s\n", name);
+}
 
 void ofi_perf_init(void)
 {
-	char *param_val = NULL;
+	char *param_val = NULL, *list, *name, *saveptr;
 
 	fi_param_define(NULL, "perf_cntr", FI_PARAM_STRING,
-			"Performance counter to analyze (default: cpu_instr). "
-			"Options: cpu_instr, cpu_cycles.");
+			"Comma separated list of up to 4 performance counters "
+			"to analyze (default: cpu_instr). Options: cpu_instr, "
+			"cpu_cycles, cache_misses, branch_misses, l1d_misses, "
+			"llc_misses, dtlb_misses, page_faults.");
 	fi_param_get_str(NULL, "perf_cntr", &param_val);
-	if (!param_val)
-		return;
-
-	if (!strcasecmp(param_val, "cpu_cycles")) {
-		perf_domain = OFI_PMU_CPU;
-		perf_cntr = OFI_PMC_CPU_CYCLES;
+	if (param_val) {
+		list = strdup(param_val);
+		for (name = list ? strtok_r(list, ",", &saveptr) : NULL; name;
+		     name = strtok_r(NULL, ",", &saveptr))
+			ofi_perf_add_event(name);
+		free(list);
 	}
+
+	if (!perf_event_cnt)
+		perf_events[perf_event_cnt++] = perf_event_table[0];
+
+	perf_domain = perf_events[0].domain;
+	perf_cntr = perf_events[0].cntr;
+	perf_flags = perf_events[0].flags;
+
+	ofi_hist_init();
 }
 
 int ofi_perfset_create(const struct fi_provider *prov,
@@ -105,6 +176,10 @@ static const char *ofi_perf_name(void)
 			return "CPU cycles";
 		case OFI_PMC_CPU_INSTR:
 			return "CPU instr";
+		case OFI_PMC_CPU_CACHE_MISSES:
+			return "cache misses";
+		case OFI_PMC_CPU_BRANCH_MISSES:
+			return "branch misses";
 		}
 		break;
 	case OFI_PMU_CACHE:
@@ -117,6 +192,8 @@ static const char *ofi_perf_name(void)
 			return "TLB data cache";
 		case OFI_PMC_CACHE_TLB_INSTR:
 			return "TLB instr cache";
+		case OFI_PMC_CACHE_LL:
+			return "last level cache";
 		}
 		break;
 	case OFI_PMU_OS:
@@ -149,3 +226,338 @@ void ofi_perfset_log(struct ofi_perfset *set, const char *names[])
 			set->data[i].events);
 	}
 }
+
+static size_t ofi_hist_index(uint64_t val)
+{
+	int shift;
+
+	if (val < OFI_HIST_SUB_BUCKETS)
+		return val;
+
+	shift = 63 - __builtin_clzll(val);
+	if (shift > OFI_HIST_MAX_SHIFT)
+		return OFI_HIST_BUCKETS - 1;
+
+	return ((shift - OFI_HIST_SUB_SHIFT + 1) << OFI_HIST_SUB_SHIFT) |
+	       ((val >> (shift - OFI_HIST_SUB_SHIFT)) &
+		(OFI_HIST_SUB_BUCKETS - 1));
+}
+
+/* Largest value that maps to the given bucket */
+static uint64_t ofi_hist_bucket_max(size_t index)
+{
+	int shift;
+
+	if (index < OFI_HIST_SUB_BUCKETS)
+		return index;
+
+	if (index == OFI_HIST_BUCKETS - 1)
+		return UINT64_MAX;
+
+	shift = (index >> OFI_HIST_SUB_SHIFT) + OFI_HIST_SUB_SHIFT - 1;
+	return (((uint64_t) (OFI_HIST_SUB_BUCKETS |
+			     (index & (OFI_HIST_SUB_BUCKETS - 1))) + 1) <<
+		(shift - OFI_HIST_SUB_SHIFT)) - 1;
+}
+
+static struct ofi_hist_slot *ofi_hist_slot(void)
+{
+	return &hist_slots[ofi_thread_slot(OFI_HIST_SLOTS)];
+}
+
+uint64_t ofi_hist_time(void)
+{
+	return ofi_gettime_ns();
+}
+
+void ofi_hist_record(enum ofi_hist_id id, uint64_t start)
+{
+	struct ofi_hist_slot *slot;
+	uint64_t val;
+
+	assert(id < OFI_HIST_MAX);
+	if (!hist_slots)
+		return;
+
+	val = ofi_gettime_ns() - start;
+	slot = ofi_hist_slot();
+	ofi_atomic_inc64(&slot->bucket[id][ofi_hist_index(val)]);
+	ofi_atomic_add64(&slot->sum[id], (int64_t) val);
+}
+
+static void ofi_hist_reset(void)
+{
+	size_t i, j, k;
+
+	for (i = 0; i < OFI_HIST_SLOTS; i++) {
+		for (j = 0; j < OFI_HIST_MAX; j++) {
+			ofi_atomic_initialize64(&hist_slots[i].sum[j], 0);
+			for (k = 0; k < OFI_HIST_BUCKETS; k++)
+				ofi_atomic_initialize64(
+					&hist_slots[i].bucket[j][k], 0);
+		}
+	}
+}
+
+void ofi_hist_add(struct ofi_hist *hist, uint64_t val)
+{
+	hist->bucket[ofi_hist_index(val)]++;
+	hist->sum += val;
+}
+
+void ofi_hist_read(const struct ofi_hist *hist, const char *name,
+		   struct fi_perf_hist_stat *stat)
+{
+	uint64_t cnt, target;
+	size_t i, pct;
+	static const struct {
+		uint64_t permille;
+		size_t offset;
+	} pcts[] = {
+		{ 500, offsetof(struct fi_perf_hist_stat, p50) },
+		{ 900, offsetof(struct fi_perf_hist_stat, p90) },
+		{ 990, offsetof(struct fi_perf_hist_stat, p99) },
+		{ 999, offsetof(struct fi_perf_hist_stat, p999) },
+	};
+
+	memset(stat, 0, sizeof(*stat));
+	stat->name = name;
+	stat->sum = hist->sum;
+	for (i = 0; i < OFI_HIST_BUCKETS; i++)
+		stat->count += hist->bucket[i];
+
+	if (!stat->count)
+		return;
+
+	for (i = 0, pct = 0, cnt = 0; i < OFI_HIST_BUCKETS; i++) {
+		if (!hist->bucket[i])
+			continue;
+
+		cnt += hist->bucket[i];
+		for (; pct < ARRAY_SIZE(pcts); pct++) {
+			target = (stat->count * pcts[pct].permille + 999) / 1000;
+			if (cnt < target)
+				break;
+			*(uint64_t *) ((char *) stat + pcts[pct].offset) =
+				ofi_hist_bucket_max(i);
+		}
+		stat->max = ofi_hist_bucket_max(i);
+	}
+}
+
+static size_t ofi_hist_set_count(struct fid_perf_hist *hist_fid)
+{
+	return container_of(hist_fid, struct ofi_hist_set, hist_fid)->count;
+}
+
+static int ofi_hist_set_read(struct fid_perf_hist *hist_fid, size_t index,
+			     struct fi_perf_hist_stat *stat)
+{
+	struct ofi_hist_set *set;
+
+	set = container_of(hist_fid, struct ofi_hist_set, hist_fid);
+	if (index >= set->count)
+		return -FI_EINVAL;
+
+	ofi_genlock_lock(set->lock);
+	ofi_hist_read(&set->hist[index], set->names[index], stat);
+	ofi_genlock_unlock(set->lock);
+	return 0;
+}
+
+static void ofi_hist_set_reset(struct fid_perf_hist *hist_fid)
+{
+	struct ofi_hist_set *set;
+
+	set = container_of(hist_fid, struct ofi_hist_set, hist_fid);
+	ofi_genlock_lock(set->lock);
+	memset(set->hist, 0, sizeof(*set->hist) * set->count);
+	ofi_genlock_unlock(set->lock);
+}
+
+static int ofi_hist_set_close(struct fid *fid)
+{
+	return 0;
+}
+
+static struct fi_ops_perf_hist hist_set_ops = {
+	.size = sizeof(struct fi_ops_perf_hist),
+	.count = ofi_hist_set_count,
+	.read = ofi_hist_set_read,
+	.reset = ofi_hist_set_reset,
+};
+
+static struct fi_ops hist_set_fid_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = ofi_hist_set_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+	.tostr = fi_no_tostr,
+	.ops_set = fi_no_ops_set,
+};
+
+struct ofi_hist_set *ofi_hist_set_alloc(struct fid *owner,
+					struct ofi_genlock *lock,
+					const char * const *names,
+					size_t count)
+{
+	struct ofi_hist_set *set;
+
+	set = calloc(1, sizeof(*set) + sizeof(*set->hist) * count);
+	if (!set)
+		return NULL;
+
+	set->hist_fid.fid.fclass = FI_CLASS_UNSPEC;
+	set->hist_fid.fid.context = owner;
+	set->hist_fid.fid.ops = &hist_set_fid_ops;
+	set->hist_fid.ops = &hist_set_ops;
+	set->lock = lock;
+	set->names = names;
+	set->count = count;
+	return set;
+}
+
+/* Objects may share the set of another, only its owner releases it */
+void ofi_hist_set_free(struct fid *owner, struct ofi_hist_set *set)
+{
+	if (set && set->hist_fid.fid.context == owner)
+		free(set);
+}
+
+static void ofi_hist_stat(enum ofi_hist_id id, struct fi_perf_hist_stat *stat)
+{
+	struct ofi_hist hist;
+	size_t i, j;
+
+	memset(&hist, 0, sizeof(hist));
+	for (i = 0; i < OFI_HIST_SLOTS; i++) {
+		hist.sum += ofi_atomic_get64(&hist_slots[i].sum[id]);
+		for (j = 0; j < OFI_HIST_BUCKETS; j++)
+			hist.bucket[j] += ofi_atomic_get64(
+						&hist_slots[i].bucket[id][j]);
+	}
+	ofi_hist_read(&hist, hist_names[id], stat);
+}
+
+void ofi_hist_init(void)
+{
+	fi_param_define(NULL, "perf_hist", FI_PARAM_BOOL,
+			"Record latency histograms for the CQ write, MR cache "
+			"search, and progress paths of the utility code.  "
+			"Results are logged at FI_LOG_INFO on exit and may be "
+			"read with fi_open(\"perf_hist\") (default: false)");
+	fi_param_get_bool(NULL, "perf_hist", &ofi_hist_enabled);
+	if (!ofi_hist_enabled)
+		return;
+
+	if (ofi_memalign((void **) &hist_slots, 64,
+			 sizeof(*hist_slots) * OFI_HIST_SLOTS)) {
+		FI_WARN(&core_prov, FI_LOG_CORE,
+			"Unable to allocate latency histograms\n");
+		ofi_hist_enabled = 0;
+		return;
+	}
+	ofi_hist_reset();
+}
+
+void ofi_hist_fini(void)
+{
+	struct fi_perf_hist_stat stat;
+	enum ofi_hist_id id;
+
+	if (!hist_slots)
+		return;
+
+	/* Called after the providers are torn down, so no probe that
+	 * started before this point is still running */
+	ofi_hist_enabled = 0;
+
+	for (id = 0; id < OFI_HIST_MAX; id++) {
+		ofi_hist_stat(id, &stat);
+		if (!stat.count)
+			continue;
+
+		FI_INFO(&core_prov, FI_LOG_CORE,
+			"%s latency (ns): count %" PRIu64 " avg %" PRIu64
+			" p50 %" PRIu64 " p90 %" PRIu64 " p99 %" PRIu64
+			" p999 %" PRIu64 " max %" PRIu64 "\n", stat.name,
+			stat.count, stat.sum / stat.count, stat.p50, stat.p90,
+			stat.p99, stat.p999, stat.max);
+	}
+
+	ofi_freealign(hist_slots);
+	hist_slots = NULL;
+}
+
+static size_t ofi_perf_hist_count(struct fid_perf_hist *hist)
+{
+	return OFI_HIST_MAX;
+}
+
+static int ofi_perf_hist_read(struct fid_perf_hist *hist, size_t index,
+			      struct fi_perf_hist_stat *stat)
+{
+	if (index >= OFI_HIST_MAX)
+		return -FI_EINVAL;
+
+	/* The slots are gone once fi_fini() has run */
+	if (!hist_slots)
+		return -FI_ENODATA;
+
+	ofi_hist_stat(index, stat);
+	return 0;
+}
+
+static void ofi_perf_hist_reset(struct fid_perf_hist *hist)
+{
+	if (hist_slots)
+		ofi_hist_reset();
+}
+
+static int ofi_perf_hist_close(struct fid *fid)
+{
+	return 0;
+}
+
+static struct fi_ops_perf_hist perf_hist_ops = {
+	.size = sizeof(struct fi_ops_perf_hist),
+	.count = ofi_perf_hist_count,
+	.read = ofi_perf_hist_read,
+	.reset = ofi_perf_hist_reset,
+};
+
+static struct fi_ops perf_hist_fid_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = ofi_perf_hist_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
+	.tostr = fi_no_tostr,
+	.ops_set = fi_no_ops_set,
+};
+
+static struct fid_perf_hist perf_hist_fid = {
+	.fid = {
+		.fclass = FI_CLASS_UNSPEC,
+		.ops = &perf_hist_fid_ops,
+	},
+	.ops = &perf_hist_ops,
+};
+
+int ofi_open_perf_hist(uint32_t version, void *attr, size_t attr_len,
+		       uint64_t flags, struct fid **fid, void *context)
+{
+	if (FI_VERSION_LT(version, FI_VERSION(1, 13)) || attr_len)
+		return -FI_EINVAL;
+
+	if (flags)
+		return -FI_EBADFLAGS;
+
+	if (!hist_slots)
+		return -FI_ENODATA;
+
+	perf_hist_fid.fid.context = context;
+	*fid = &perf_hist_fid.fid;
+	return 0;
+}
@@ -73,6 +73,7 @@ void ofi_rbmap_init(struct ofi_rbmap *map,
 		int (*compare)(struct ofi_rbmap *map, void *key, void *data))
 {
 	map->compare = compare;
+	map->end = NULL;
 
 	map->root = &map->sentinel;
 	map->sentinel.left = &map->sentinel;
@@ -80,6 +81,15 @@ void ofi_rbmap_init(struct ofi_rbmap *map,
 	map->sentinel.parent = NULL;
 	map->sentinel.color = BLACK;
 	map->sentinel.data = NULL;
+	map->sentinel.max_end = 0;
+}
+
+void ofi_rbmap_init_interval(struct ofi_rbmap *map,
+		int (*compare)(struct ofi_rbmap *map, void *key, void *data),
+		uint64_t (*end)(void *data))
+{
+	ofi_rbmap_init(map, compare);
+	map->end = end;
 }
 
 struct ofi_rbmap *
@@ -126,6 +136,30 @@ int ofi_rbmap_empty(struct ofi_rbmap *map)
 	return map->root == &map->sentinel;
 }
 
+static void ofi_rbnode_update(struct ofi_rbmap *map, struct ofi_rbnode *node)
+{
+	uint64_t max_end;
+
+	if (!map->end || node == &map->sentinel)
+		return;
+
+	max_end = map->end(node->data);
+	if (node->left->max_end > max_end)
+		max_end = node->left->max_end;
+	if (node->right->max_end > max_end)
+		max_end = node->right->max_end;
+	node->max_end = max_end;
+}
+
+static void ofi_rbnode_propagate(struct ofi_rbmap *map, struct ofi_rbnode *node)
+{
+	if (!map->end)
+		return;
+
+	for (; node; node = node->parent)
+		ofi_rbnode_update(map, node);
+}
+
 static void ofi_rotate_left(struct ofi_rbmap *map, struct ofi_rbnode *node)
 {
 	struct ofi_rbnode *y = node->right;
@@ -148,6 +182,9 @@ static void ofi_rotate_left(struct ofi_rbmap *map, struct ofi_rbnode *node)
 	y->left = node;
 	if (node != &map->sentinel)
 		node->parent = y;
+
+	ofi_rbnode_update(map, node);
+	ofi_rbnode_update(map, y);
 }
 
 static void ofi_rotate_right(struct ofi_rbmap *map, struct ofi_rbnode *node)
@@ -172,6 +209,9 @@ static void ofi_rotate_right(struct ofi_rbmap *map, struct ofi_rbnode *node)
 	y->right = node;
 	if (node != &map->sentinel)
 		node->parent = y;
+
+	ofi_rbnode_update(map, node);
+	ofi_rbnode_update(map, y);
 }
 
 static void
@@ -258,6 +298,7 @@ int ofi_rbmap_insert(struct ofi_rbmap *map, void *key, void *data,
 		map->root = node;
 	}
 
+	ofi_rbnode_propagate(map, node);
 	ofi_insert_rebalance(map, node);
 	if (ret_node)
 		*ret_node = node;
@@ -373,6 +414,9 @@ void ofi_rbmap_delete(struct ofi_rbmap *map, struct ofi_rbnode *node)
 	if (y != node)
 		node->data = y->data;
 
+	/* x->parent is the lowest node whose subtree changed */
+	ofi_rbnode_propagate(map, x->parent);
+
 	if (y->color == BLACK)
 		ofi_delete_rebalance(map, x);
 
@@ -432,3 +476,68 @@ struct ofi_rbnode *ofi_rbmap_search(struct ofi_rbmap *map, void *key,
 	}
 	return NULL;
 }
+
+/* Leftmost node in the subtree that overlaps key, or NULL */
+static struct ofi_rbnode *
+ofi_rbmap_overlap_subtree(struct ofi_rbmap *map, struct ofi_rbnode *node,
+		uint64_t start, void *key,
+		int (*overlap)(struct ofi_rbmap *map, void *key, void *data))
+{
+	struct ofi_rbnode *found;
+	int ret;
+
+	while (node != &map->sentinel && node->max_end > start) {
+		if (node->left->max_end > start) {
+			found = ofi_rbmap_overlap_subtree(map, node->left,
+							  start, key, overlap);
+			if (found)
+				return found;
+		}
+
+		ret = overlap(map, key, node->data);
+		if (ret == 0)
+			return node;
+		if (ret < 0)
+			return NULL;
+
+		node = node->right;
+	}
+	return NULL;
+}
+
+struct ofi_rbnode *ofi_rbmap_overlap_first(struct ofi_rbmap *map,
+		uint64_t start, void *key,
+		int (*overlap)(struct ofi_rbmap *map, void *key, void *data))
+{
+	assert(map->end);
+	return ofi_rbmap_overlap_subtree(map, map->root, start, key, overlap);
+}
+
+struct ofi_rbnode *ofi_rbmap_overlap_next(struct ofi_rbmap *map,
+		struct ofi_rbnode *node, uint64_t start, void *key,
+		int (*overlap)(struct ofi_rbmap *map, void *key, void *data))
+{
+	struct ofi_rbnode *found;
+	int ret;
+
+	assert(map->end);
+	for (;;) {
+		found = ofi_rbmap_overlap_subtree(map, node->right, start,
+						  key, overlap);
+		if (found)
+			return found;
+
+		while (node->parent && node == node->parent->right)
+			node = node->parent;
+
+		node = node->parent;
+		if (!node)
+			return NULL;
+
+		ret = overlap(map, key, node->data);
+		if (ret == 0)
+			return node;
+		if (ret < 0)
+			return NULL;
+	}
+}
@@ -0,0 +1,87 @@
+#!/bin/sh
+#
+# Copyright (c) 2026 Intel Corporation.  All rights reserved.
+#
+# This software is available to you under a choice of one of two
+# licenses.  You may choose to be licensed under the terms of the GNU
+# General Public License (GPL) Version 2, available from the file
+# COPYING in the main directory of this source tree, or the
+# BSD license below:
+#
+#     Redistribution and use in source and binary forms, with or
+#     without modification, are permitted provided that the following
+#     conditions are met:
+#
+#      - Redistributions of source code must retain the above
+#        copyright notice, this list of conditions and the following
+#        disclaimer.
+#
+#      - Redistributions in binary form must reproduce the above
+#        copyright notice, this list of conditions and the following
+#        disclaimer in the documentation and/or other materials
+#        provided with the distribution.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+# NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+# BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+# ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+
+# Checks that libfabric.so exports every symbol of every version node in
+# libfabric.map, and no versioned symbol that the map does not list.
+# Compiler options such as -flto can silently drop .symver directives.
+
+lib=src/.libs/libfabric.so
+map=libfabric.map
+
+if test ! -f $lib || test ! -f $map; then
+	echo "$lib or $map not found, skipping"
+	exit 77
+fi
+
+if ! grep -q "define HAVE_SYMVER_SUPPORT 1" config.h; then
+	echo "symbol versioning disabled, skipping"
+	exit 77
+fi
+
+if ! command -v readelf > /dev/null 2>&1; then
+	echo "readelf not found, skipping"
+	exit 77
+fi
+
+tmp=${TMPDIR:-/tmp}/check_abi.$$
+trap 'rm -f $tmp.*' EXIT
+
+awk '
+	/^[A-Za-z0-9_.]+ *\{/ { node = $1; next }
+	/^\}/ { node = ""; next }
+	node != "" && /^[ \t]*[A-Za-z_][A-Za-z0-9_]*;/ {
+		sym = $1
+		sub(/;.*/, "", sym)
+		print sym "@" node
+	}' $map | sort -u > $tmp.map
+
+readelf --dyn-syms -W $lib | awk '
+	$7 != "UND" && $8 ~ /@FABRIC_/ {
+		sym = $8
+		sub(/@@/, "@", sym)
+		sub(/ .*/, "", sym)
+		print sym
+	}' | sort -u > $tmp.lib
+
+ret=0
+for sym in $(comm -23 $tmp.map $tmp.lib); do
+	echo "missing from $lib: $sym"
+	ret=1
+done
+for sym in $(comm -13 $tmp.map $tmp.lib); do
+	echo "not listed in $map: $sym"
+	ret=1
+done
+
+test $ret -eq 0 && echo "$(wc -l < $tmp.map) versioned symbols exported"
+exit $ret
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *	   Redistribution and use in source and binary forms, with or
+ *	   without modification, are permitted provided that the following
+ *	   conditions are met:
+ *
+ *		- Redistributions of source code must retain the above
+ *		  copyright notice, this list of conditions and the following
+ *		  disclaimer.
+ *
+ *		- Redistributions in binary form must reproduce the above
+ *		  copyright notice, this list of conditions and the following
+ *		  disclaimer in the documentation and/or other materials
+ *		  provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks the CRC32C implementation selected at init against the table
+ * driven one.  The interleaved SSE4.2 path switches between its long and
+ * short block sizes at 3 * 8192 and 3 * 256 bytes, so lengths around
+ * those are covered at every alignment.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ofi.h>
+#include <ofi_iov.h>
+
+#define CRC32C_CHECK		0xe3069283
+#define CRC32C_MAX_ALIGN	8
+#define CRC32C_MAX_LEN		(3 * 8192 * 2 + 64)
+
+static int errors;
+
+static void check(const char *name, size_t align, size_t len,
+		  uint32_t crc, uint32_t exp)
+{
+	if (crc == exp)
+		return;
+
+	printf("%s: align %zu len %zu: crc 0x%08x, expected 0x%08x\n",
+	       name, align, len, crc, exp);
+	errors++;
+}
+
+static void test_check_value(void)
+{
+	static const char data[] = "123456789";
+	char buf[sizeof(data) + CRC32C_MAX_ALIGN];
+	size_t align;
+
+	for (align = 0; align < CRC32C_MAX_ALIGN; align++) {
+		memcpy(buf + align, data, sizeof(data) - 1);
+		check("sw check value", align, sizeof(data) - 1,
+		      ofi_crc32c_sw(0, buf + align, sizeof(data) - 1),
+		      CRC32C_CHECK);
+		check("check value", align, sizeof(data) - 1,
+		      ofi_crc32c(0, buf + align, sizeof(data) - 1),
+		      CRC32C_CHECK);
+	}
+}
+
+static void test_len(const uint8_t *buf, size_t len)
+{
+	size_t align, split;
+	uint32_t exp, crc;
+
+	for (align = 0; align < CRC32C_MAX_ALIGN; align++) {
+		exp = ofi_crc32c_sw(0, buf + align, len);
+		check("buffer", align, len, ofi_crc32c(0, buf + align, len),
+		      exp);
+
+		/* Continuing from a partial CRC must give the same result */
+		split = len / 3 + align;
+		if (split > len)
+			continue;
+		crc = ofi_crc32c(0, buf + align, split);
+		crc = ofi_crc32c(crc, buf + align + split, len - split);
+		check("split", align, len, crc, exp);
+	}
+}
+
+static void test_lens(const uint8_t *buf)
+{
+	static const size_t base[] = {
+		0, 8, 3 * 256, 3 * 256 * 2, 3 * 8192, 3 * 8192 * 2,
+	};
+	size_t i, len;
+
+	for (i = 0; i < ARRAY_SIZE(base); i++) {
+		for (len = base[i] > 16 ? base[i] - 16 : 0;
+		     len <= base[i] + 16; len++)
+			test_len(buf, len);
+	}
+}
+
+static void test_iov(const uint8_t *buf)
+{
+	struct iovec iov[3];
+	size_t len = 3 * 8192 + 5;
+
+	iov[0].iov_base = (void *) (buf + 1);
+	iov[0].iov_len = 777;
+	iov[1].iov_base = (void *) (buf + 1 + 777);
+	iov[1].iov_len = 3 * 8192;
+	iov[2].iov_base = (void *) (buf + 1 + 777 + 3 * 8192);
+	iov[2].iov_len = 1000;
+
+	check("iov", 1, len, ofi_crc32c_iov(0, iov, 3, len),
+	      ofi_crc32c_sw(0, buf + 1, len));
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t *buf;
+	size_t i;
+
+	ofi_crc32c_init();
+
+	buf = malloc(CRC32C_MAX_LEN + CRC32C_MAX_ALIGN);
+	if (!buf)
+		return EXIT_FAILURE;
+
+	srand(1);
+	for (i = 0; i < CRC32C_MAX_LEN + CRC32C_MAX_ALIGN; i++)
+		buf[i] = (uint8_t) rand();
+
+	test_check_value();
+	test_lens(buf);
+	test_iov(buf);
+	free(buf);
+
+	printf("crc32c: %s (%s)\n", errors ? "FAIL" : "PASS",
+	       ofi_crc32c_fn == ofi_crc32c_sw ? "table" : "hardware");
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *	   Redistribution and use in source and binary forms, with or
+ *	   without modification, are permitted provided that the following
+ *	   conditions are met:
+ *
+ *		- Redistributions of source code must retain the above
+ *		  copyright notice, this list of conditions and the following
+ *		  disclaimer.
+ *
+ *		- Redistributions in binary form must reproduce the above
+ *		  copyright notice, this list of conditions and the following
+ *		  disclaimer in the documentation and/or other materials
+ *		  provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Checks that the MR cache finds a registration from any address inside
+ * it.  In sharded mode, regions are spread over shards by 2 MiB chunk,
+ * so a region crossing chunks must still be found from any of them.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ofi.h>
+#include <ofi_hmem.h>
+#include <ofi_mr.h>
+
+#define MR_CACHE_CHUNK	(1UL << OFI_MR_CACHE_SHARD_SHIFT)
+#define MR_CACHE_BUF	(4 * MR_CACHE_CHUNK)
+
+extern void fi_ini(void);
+
+static int errors;
+static size_t reg_cnt;
+
+static int test_start(struct ofi_mem_monitor *monitor)
+{
+	return 0;
+}
+
+static void test_stop(struct ofi_mem_monitor *monitor)
+{
+}
+
+static int test_subscribe(struct ofi_mem_monitor *monitor,
+			  const void *addr, size_t len,
+			  union ofi_mr_hmem_info *hmem_info)
+{
+	return 0;
+}
+
+static void test_unsubscribe(struct ofi_mem_monitor *monitor,
+			     const void *addr, size_t len,
+			     union ofi_mr_hmem_info *hmem_info)
+{
+}
+
+static bool test_valid(struct ofi_mem_monitor *monitor,
+		       const struct ofi_mr_info *info,
+		       struct ofi_mr_entry *entry)
+{
+	return true;
+}
+
+static struct ofi_mem_monitor test_monitor = {
+	.iface = FI_HMEM_SYSTEM,
+	.start = test_start,
+	.stop = test_stop,
+	.subscribe = test_subscribe,
+	.unsubscribe = test_unsubscribe,
+	.valid = test_valid,
+	.name = "test",
+};
+
+static int test_add_region(struct ofi_mr_cache *cache,
+			   struct ofi_mr_entry *entry)
+{
+	reg_cnt++;
+	return 0;
+}
+
+static void test_delete_region(struct ofi_mr_cache *cache,
+			       struct ofi_mr_entry *entry)
+{
+}
+
+static void check(const char *mode, const char *name, bool ok)
+{
+	if (ok)
+		return;
+
+	printf("%s: %s failed\n", mode, name);
+	errors++;
+}
+
+static struct ofi_mr_entry *search(struct ofi_mr_cache *cache,
+				   char *addr, size_t len)
+{
+	struct ofi_mr_info info = {0};
+	struct ofi_mr_entry *entry;
+
+	info.iov.iov_base = addr;
+	info.iov.iov_len = len;
+	info.iface = FI_HMEM_SYSTEM;
+	return ofi_mr_cache_search(cache, &info, &entry) ? NULL : entry;
+}
+
+static void test_cache(const char *mode, size_t shard_cnt, char *buf)
+{
+	struct ofi_mem_monitor *monitors[OFI_HMEM_MAX] = {
+		[FI_HMEM_SYSTEM] = &test_monitor,
+	};
+	struct ofi_mr_cache cache = {
+		.add_region = test_add_region,
+		.delete_region = test_delete_region,
+	};
+	struct ofi_mr_entry *small, *large, *entry;
+	char *region = buf + MR_CACHE_CHUNK / 2;
+	size_t cnt;
+
+	cache_params.shard_cnt = shard_cnt;
+	if (ofi_mr_cache_init(NULL, monitors, &cache)) {
+		check(mode, "init", false);
+		return;
+	}
+
+	/* A small region, later superseded by one spanning chunks */
+	small = search(&cache, region + 2 * MR_CACHE_CHUNK, 4096);
+	check(mode, "small region", small != NULL);
+
+	reg_cnt = 0;
+	large = search(&cache, region, 2 * MR_CACHE_CHUNK + 8192);
+	check(mode, "large region", large != NULL && reg_cnt == 1);
+
+	reg_cnt = 0;
+	entry = search(&cache, region + 2 * MR_CACHE_CHUNK, 4096);
+	check(mode, "superseded region", entry == large && !reg_cnt);
+	if (entry)
+		ofi_mr_cache_delete(&cache, entry);
+	if (small)
+		ofi_mr_cache_delete(&cache, small);
+	if (large)
+		ofi_mr_cache_delete(&cache, large);
+	while (ofi_mr_cache_flush(&cache, true))
+		;
+
+	/* Look up offsets inside a 4 MiB registration from every chunk */
+	reg_cnt = 0;
+	large = search(&cache, region, 2 * MR_CACHE_CHUNK);
+	check(mode, "4 MiB region", large != NULL && reg_cnt == 1);
+	for (cnt = 0; cnt < 2 * MR_CACHE_CHUNK; cnt += MR_CACHE_CHUNK / 4) {
+		entry = search(&cache, region + cnt, 4096);
+		check(mode, "offset in 4 MiB region", entry == large);
+		if (entry)
+			ofi_mr_cache_delete(&cache, entry);
+	}
+	check(mode, "no extra registration", reg_cnt == 1);
+	if (large)
+		ofi_mr_cache_delete(&cache, large);
+
+	ofi_mr_cache_cleanup(&cache);
+}
+
+int main(int argc, char **argv)
+{
+	char *buf;
+
+	fi_ini();
+	ofi_monitor_init(&test_monitor);
+	if (!ofi_hmem_is_initialized(FI_HMEM_SYSTEM)) {
+		printf("system memory support not initialized\n");
+		return EXIT_FAILURE;
+	}
+
+	if (ofi_memalign((void **) &buf, MR_CACHE_CHUNK, MR_CACHE_BUF))
+		return EXIT_FAILURE;
+
+	cache_params.max_cnt = 1024;
+	cache_params.max_size = SIZE_MAX;
+	cache_params.merge_max_size = 0;
+	test_cache("unsharded", 0, buf);
+	test_cache("sharded", 4, buf);
+	ofi_freealign(buf);
+
+	printf("mr_cache: %s\n", errors ? "FAIL" : "PASS");
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
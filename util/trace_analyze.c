@@ -0,0 +1,511 @@
+/*
+ * Copyright (c) 2026 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ofi_trace_rec.h"
+#include "uthash.h"
+
+#define TRACE_HIST_BUCKETS	40
+#define TRACE_BAR_WIDTH		50
+#define TRACE_MAX_PROCS		4096
+
+struct trace_event {
+	struct ofi_trace_rec	rec;
+	uint32_t		thread;
+};
+
+/* The records of all the threads of one process, merged by time */
+struct trace_proc {
+	char			host[sizeof(((struct ofi_trace_hdr *) 0)->host) + 1];
+	uint32_t		pid;
+	uint64_t		start_time;
+	struct trace_event	*events;
+	size_t			cnt;
+};
+
+struct trace_pending {
+	uint64_t		context;
+	uint64_t		time;
+	uint16_t		op;
+	UT_hash_handle		hh;
+};
+
+struct trace_lat {
+	uint64_t		*ns;
+	size_t			cnt;
+	size_t			size;
+};
+
+static struct trace_proc procs[TRACE_MAX_PROCS];
+static size_t proc_cnt;
+
+static const char *op_str[OFI_TRACE_OP_MAX] = {
+	[OFI_TRACE_RECV] = "recv",
+	[OFI_TRACE_SEND] = "send",
+	[OFI_TRACE_INJECT] = "inject",
+	[OFI_TRACE_READ] = "read",
+	[OFI_TRACE_WRITE] = "write",
+	[OFI_TRACE_INJECT_WRITE] = "inject_write",
+	[OFI_TRACE_TRECV] = "trecv",
+	[OFI_TRACE_TSEND] = "tsend",
+	[OFI_TRACE_TINJECT] = "tinject",
+	[OFI_TRACE_COMP] = "comp",
+	[OFI_TRACE_COMP_ERR] = "comp_err",
+};
+
+static void usage(const char *argv0)
+{
+	printf("Usage: %s [OPTIONS] FILE...\n", argv0);
+	printf("\n");
+	printf("Analyzes the binary records written by the trace hook\n");
+	printf("(FI_OFI_HOOK_TRACE_RECORD_FILE).  The files of all the threads\n");
+	printf("of a process are merged.  Without options, the latency\n");
+	printf("distributions and the message matrix are displayed.\n");
+	printf("\n");
+	printf("  -t, --timeline\tdisplay the timeline of every process\n");
+	printf("  -l, --latency\t\tdisplay the latency from post to completion\n");
+	printf("  -m, --matrix\t\tdisplay the messages and bytes per peer\n");
+	printf("  -h, --help\t\tdisplay this help and exit\n");
+}
+
+static const char *trace_op_str(uint16_t op)
+{
+	return op < OFI_TRACE_OP_MAX ? op_str[op] : "unknown";
+}
+
+/* Operations that generate a completion with their context */
+static int trace_op_completes(uint16_t op)
+{
+	return op == OFI_TRACE_RECV || op == OFI_TRACE_SEND ||
+	       op == OFI_TRACE_READ || op == OFI_TRACE_WRITE ||
+	       op == OFI_TRACE_TRECV || op == OFI_TRACE_TSEND;
+}
+
+/* Operations initiated toward a peer */
+static int trace_op_outbound(uint16_t op)
+{
+	return op == OFI_TRACE_SEND || op == OFI_TRACE_INJECT ||
+	       op == OFI_TRACE_READ || op == OFI_TRACE_WRITE ||
+	       op == OFI_TRACE_INJECT_WRITE || op == OFI_TRACE_TSEND ||
+	       op == OFI_TRACE_TINJECT;
+}
+
+static struct trace_proc *trace_get_proc(const struct ofi_trace_hdr *hdr)
+{
+	struct trace_proc *proc;
+	size_t i;
+
+	for (i = 0; i < proc_cnt; i++) {
+		if (procs[i].pid == hdr->pid &&
+		    !strncmp(procs[i].host, hdr->host, sizeof(hdr->host)))
+			return &procs[i];
+	}
+
+	if (proc_cnt == TRACE_MAX_PROCS)
+		return NULL;
+
+	proc = &procs[proc_cnt++];
+	memcpy(proc->host, hdr->host, sizeof(hdr->host));
+	proc->pid = hdr->pid;
+	proc->start_time = hdr->start_time;
+	return proc;
+}
+
+static int trace_load(const char *path)
+{
+	struct ofi_trace_hdr hdr;
+	struct ofi_trace_rec *rec = NULL;
+	struct trace_event *events;
+	struct trace_proc *proc;
+	size_t cnt, first, i;
+	FILE *file;
+	int ret = -1;
+
+	file = fopen(path, "r");
+	if (!file) {
+		perror(path);
+		return -1;
+	}
+
+	if (fread(&hdr, sizeof(hdr), 1, file) != 1 ||
+	    hdr.magic != OFI_TRACE_MAGIC || hdr.version != OFI_TRACE_VERSION ||
+	    hdr.rec_size != sizeof(*rec) || !hdr.capacity ||
+	    (hdr.capacity & (hdr.capacity - 1))) {
+		fprintf(stderr, "%s: not a trace record file\n", path);
+		goto out;
+	}
+
+	rec = calloc(hdr.capacity, sizeof(*rec));
+	if (!rec || fread(rec, sizeof(*rec), hdr.capacity, file) !=
+		    hdr.capacity) {
+		fprintf(stderr, "%s: unable to read records\n", path);
+		goto out;
+	}
+
+	proc = trace_get_proc(&hdr);
+	if (!proc) {
+		fprintf(stderr, "%s: too many processes\n", path);
+		goto out;
+	}
+
+	cnt = hdr.head < hdr.capacity ? hdr.head : hdr.capacity;
+	events = realloc(proc->events, (proc->cnt + cnt) * sizeof(*events));
+	if (!events) {
+		fprintf(stderr, "%s: out of memory\n", path);
+		goto out;
+	}
+	proc->events = events;
+
+	first = hdr.head - cnt;
+	for (i = 0; i < cnt; i++) {
+		events[proc->cnt].rec = rec[(first + i) & (hdr.capacity - 1)];
+		events[proc->cnt++].thread = hdr.thread;
+	}
+	if (hdr.start_time < proc->start_time)
+		proc->start_time = hdr.start_time;
+	ret = 0;
+out:
+	free(rec);
+	fclose(file);
+	return ret;
+}
+
+static int trace_cmp_time(const void *a, const void *b)
+{
+	const struct trace_event *ev1 = a, *ev2 = b;
+
+	if (ev1->rec.time == ev2->rec.time)
+		return ev1->thread < ev2->thread ? -1 :
+		       ev1->thread > ev2->thread;
+	return ev1->rec.time < ev2->rec.time ? -1 : 1;
+}
+
+static int trace_cmp_u64(const void *a, const void *b)
+{
+	uint64_t val1 = *(const uint64_t *) a, val2 = *(const uint64_t *) b;
+
+	return val1 < val2 ? -1 : val1 > val2;
+}
+
+static int trace_cmp_u32(const void *a, const void *b)
+{
+	uint32_t val1 = *(const uint32_t *) a, val2 = *(const uint32_t *) b;
+
+	return val1 < val2 ? -1 : val1 > val2;
+}
+
+static void trace_print_peer(uint32_t peer, int width)
+{
+	if (peer == OFI_TRACE_PEER_UNSPEC)
+		printf("%*s", width, "-");
+	else
+		printf("%*" PRIu32, width, peer);
+}
+
+static void trace_timeline(struct trace_proc *proc)
+{
+	struct ofi_trace_rec *rec;
+	size_t i;
+
+	printf("\n%s:%" PRIu32 " timeline (us)\n", proc->host, proc->pid);
+	printf("%14s %6s %-12s %12s %8s %18s\n", "time", "thread", "op",
+	       "len", "peer", "context");
+
+	for (i = 0; i < proc->cnt; i++) {
+		rec = &proc->events[i].rec;
+		printf("%14.3f %6" PRIu32 " %-12s %12" PRIu64 " ",
+		       (double) (rec->time - proc->start_time) / 1000,
+		       proc->events[i].thread, trace_op_str(rec->op), rec->len);
+		trace_print_peer(rec->peer, 8);
+		printf(" 0x%016" PRIx64, rec->context);
+		if (rec->err)
+			printf(" err %" PRIu16, rec->err);
+		printf("\n");
+	}
+}
+
+static int trace_lat_add(struct trace_lat *lat, uint64_t ns)
+{
+	uint64_t *buf;
+
+	if (lat->cnt == lat->size) {
+		lat->size = lat->size ? lat->size * 2 : 1024;
+		buf = realloc(lat->ns, lat->size * sizeof(*buf));
+		if (!buf)
+			return -1;
+		lat->ns = buf;
+	}
+	lat->ns[lat->cnt++] = ns;
+	return 0;
+}
+
+static void trace_lat_print(const char *name, struct trace_lat *lat)
+{
+	size_t hist[TRACE_HIST_BUCKETS] = {0};
+	size_t i, bucket, max = 0;
+	uint64_t sum = 0;
+
+	qsort(lat->ns, lat->cnt, sizeof(*lat->ns), trace_cmp_u64);
+	for (i = 0; i < lat->cnt; i++) {
+		sum += lat->ns[i];
+		bucket = lat->ns[i] ? 64 - __builtin_clzll(lat->ns[i]) : 0;
+		if (bucket >= TRACE_HIST_BUCKETS)
+			bucket = TRACE_HIST_BUCKETS - 1;
+		if (++hist[bucket] > max)
+			max = hist[bucket];
+	}
+
+	printf("  %-8s count %zu avg %.3f min %.3f p50 %.3f p90 %.3f "
+	       "p99 %.3f max %.3f\n", name, lat->cnt,
+	       (double) sum / lat->cnt / 1000, (double) lat->ns[0] / 1000,
+	       (double) lat->ns[lat->cnt / 2] / 1000,
+	       (double) lat->ns[lat->cnt * 9 / 10] / 1000,
+	       (double) lat->ns[lat->cnt * 99 / 100] / 1000,
+	       (double) lat->ns[lat->cnt - 1] / 1000);
+
+	for (i = 0; i < TRACE_HIST_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		printf("    < %12.3f %10zu ", (double) (1ULL << i) / 1000,
+		       hist[i]);
+		for (bucket = 0; bucket < hist[i] * TRACE_BAR_WIDTH / max;
+		     bucket++)
+			putchar('#');
+		printf("\n");
+	}
+}
+
+/*
+ * A post is matched with the next completion that reports its context.
+ * Posts without completion, such as injects, are not matched.
+ */
+static void trace_latency(struct trace_proc *proc)
+{
+	struct trace_lat lat[OFI_TRACE_OP_MAX] = {0};
+	struct trace_pending *pending = NULL, *entry, *tmp;
+	struct ofi_trace_rec *rec;
+	size_t i, errors = 0, unmatched = 0;
+
+	for (i = 0; i < proc->cnt; i++) {
+		rec = &proc->events[i].rec;
+		if (trace_op_completes(rec->op) && rec->context) {
+			HASH_FIND(hh, pending, &rec->context,
+				  sizeof(rec->context), entry);
+			if (!entry) {
+				entry = calloc(1, sizeof(*entry));
+				if (!entry)
+					break;
+				entry->context = rec->context;
+				HASH_ADD(hh, pending, context,
+					 sizeof(entry->context), entry);
+			}
+			entry->time = rec->time;
+			entry->op = rec->op;
+		} else if (rec->op == OFI_TRACE_COMP ||
+			   rec->op == OFI_TRACE_COMP_ERR) {
+			if (rec->op == OFI_TRACE_COMP_ERR)
+				errors++;
+			HASH_FIND(hh, pending, &rec->context,
+				  sizeof(rec->context), entry);
+			if (!entry)
+				continue;
+			trace_lat_add(&lat[entry->op], rec->time - entry->time);
+			HASH_DEL(pending, entry);
+			free(entry);
+		}
+	}
+
+	HASH_ITER(hh, pending, entry, tmp) {
+		unmatched++;
+		HASH_DEL(pending, entry);
+		free(entry);
+	}
+
+	printf("\n%s:%" PRIu32 " latency from post to completion (us)\n",
+	       proc->host, proc->pid);
+	for (i = 0; i < OFI_TRACE_OP_MAX; i++) {
+		if (lat[i].cnt)
+			trace_lat_print(op_str[i], &lat[i]);
+		free(lat[i].ns);
+	}
+	printf("  completions in error %zu, posts without completion %zu\n",
+	       errors, unmatched);
+}
+
+static int trace_peer_index(const uint32_t *peers, size_t cnt, uint32_t peer)
+{
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		if (peers[i] == peer)
+			return i;
+	}
+	return -1;
+}
+
+/* Rows are processes, columns are the peer addresses they targeted */
+static void trace_matrix(void)
+{
+	uint32_t *peers = NULL, *tmp;
+	uint64_t *msgs, *bytes;
+	size_t peer_cnt = 0, p, i, idx;
+	struct ofi_trace_rec *rec;
+
+	for (p = 0; p < proc_cnt; p++) {
+		for (i = 0; i < procs[p].cnt; i++) {
+			rec = &procs[p].events[i].rec;
+			if (!trace_op_outbound(rec->op) ||
+			    trace_peer_index(peers, peer_cnt, rec->peer) >= 0)
+				continue;
+			tmp = realloc(peers, (peer_cnt + 1) * sizeof(*peers));
+			if (!tmp)
+				goto out;
+			peers = tmp;
+			peers[peer_cnt++] = rec->peer;
+		}
+	}
+	qsort(peers, peer_cnt, sizeof(*peers), trace_cmp_u32);
+
+	msgs = calloc(proc_cnt * peer_cnt + 1, sizeof(*msgs));
+	bytes = calloc(proc_cnt * peer_cnt + 1, sizeof(*bytes));
+	if (!msgs || !bytes)
+		goto free;
+
+	for (p = 0; p < proc_cnt; p++) {
+		for (i = 0; i < procs[p].cnt; i++) {
+			rec = &procs[p].events[i].rec;
+			if (!trace_op_outbound(rec->op))
+				continue;
+			idx = (uint32_t *) bsearch(&rec->peer, peers, peer_cnt,
+						   sizeof(*peers),
+						   trace_cmp_u32) - peers;
+			msgs[p * peer_cnt + idx]++;
+			bytes[p * peer_cnt + idx] += rec->len;
+		}
+	}
+
+	printf("\nmessage matrix (messages/bytes initiated per peer)\n");
+	printf("%-32s", "process \\ peer");
+	for (i = 0; i < peer_cnt; i++) {
+		printf(" ");
+		trace_print_peer(peers[i], 20);
+	}
+	printf("\n");
+
+	for (p = 0; p < proc_cnt; p++) {
+		printf("%24s:%-7" PRIu32, procs[p].host, procs[p].pid);
+		for (i = 0; i < peer_cnt; i++) {
+			char cell[48];
+
+			snprintf(cell, sizeof(cell), "%" PRIu64 "/%" PRIu64,
+				 msgs[p * peer_cnt + i], bytes[p * peer_cnt + i]);
+			printf(" %20s", cell);
+		}
+		printf("\n");
+	}
+free:
+	free(msgs);
+	free(bytes);
+out:
+	free(peers);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct option longopts[] = {
+		{ "timeline", no_argument, NULL, 't' },
+		{ "latency", no_argument, NULL, 'l' },
+		{ "matrix", no_argument, NULL, 'm' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	int timeline = 0, latency = 0, matrix = 0;
+	size_t i;
+	int op;
+
+	while ((op = getopt_long(argc, argv, "tlmh", longopts, NULL)) != -1) {
+		switch (op) {
+		case 't':
+			timeline = 1;
+			break;
+		case 'l':
+			latency = 1;
+			break;
+		case 'm':
+			matrix = 1;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return EXIT_SUCCESS;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind == argc) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!timeline && !latency && !matrix)
+		latency = matrix = 1;
+
+	for (; optind < argc; optind++) {
+		if (trace_load(argv[optind]))
+			return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < proc_cnt; i++) {
+		qsort(procs[i].events, procs[i].cnt, sizeof(*procs[i].events),
+		      trace_cmp_time);
+		if (timeline)
+			trace_timeline(&procs[i]);
+		if (latency)
+			trace_latency(&procs[i]);
+	}
+
+	if (matrix)
+		trace_matrix();
+
+	for (i = 0; i < proc_cnt; i++)
+		free(procs[i].events);
+	return EXIT_SUCCESS;
+}